@@ -0,0 +1,464 @@
+#ifndef SVFRT_SINGLE_FILE
+  #include "svf_runtime.h"
+  #include "svf_internal.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// #archive
+//
+// Records are written through the archive writer itself, which forwards to the
+// user's writer, counting the bytes, so that it always knows the offset of the
+// next part. Every part ends padded, so every part also starts aligned.
+//
+// The index is only written at the end, which means an archive that was not
+// finished can't be opened. In exchange, it costs nothing to append a record,
+// and the file never needs to be seeked or rewritten.
+
+static
+uint32_t SVFRT_archive_write_part(void *writer_ptr, SVFRT_Bytes data) {
+  SVFRT_ArchiveWriter *writer = (SVFRT_ArchiveWriter *) writer_ptr;
+  uint32_t written = writer->writer_fn(writer->writer_ptr, data);
+  writer->bytes_written += written;
+  return written;
+}
+
+static
+void SVFRT_archive_write_bytes(SVFRT_ArchiveWriter *writer, void const *pointer, uint32_t size) {
+  if (writer->error_code) {
+    return;
+  }
+
+  SVFRT_Bytes bytes = {
+    /*.pointer =*/ (uint8_t *) pointer,
+    /*.count =*/ size,
+  };
+  if (size > 0 && SVFRT_archive_write_part(writer, bytes) != size) {
+    writer->error_code = SVFRT_code_write__writer_function_failed;
+    return;
+  }
+
+  // Only the remainder matters, so truncating the offset is fine.
+  writer->error_code = SVFRT_write_part_padding(
+    SVFRT_archive_write_part,
+    writer,
+    (uint32_t) writer->bytes_written
+  );
+}
+
+void SVFRT_archive_write_start(
+  SVFRT_ArchiveWriter *writer,
+  SVFRT_WriterFn *writer_fn,
+  void *writer_ptr,
+  SVFRT_ArchiveSchema *schemas,
+  uint32_t schema_capacity,
+  SVFRT_ArchiveRecord *records,
+  uint32_t record_capacity
+) {
+  writer->error_code = 0;
+  writer->record_started = false;
+  writer->writer_fn = writer_fn;
+  writer->writer_ptr = writer_ptr;
+  writer->bytes_written = 0;
+  writer->record_offset = 0;
+  writer->schemas = schemas;
+  writer->schema_capacity = schema_capacity;
+  writer->schema_count = 0;
+  writer->records = records;
+  writer->record_capacity = record_capacity;
+  writer->record_count = 0;
+
+  SVFRT_ArchiveHeader header = {
+    /*.magic =*/ { 'S', 'V', 'F', 'A' },
+    /*.version =*/ SVFRT_ARCHIVE_VERSION,
+  };
+  SVFRT_archive_write_bytes(writer, &header, sizeof(header));
+}
+
+void SVFRT_archive_record_start(
+  SVFRT_ArchiveWriter *writer,
+  SVFRT_WriteContext *ctx,
+  uint64_t schema_content_hash,
+  SVFRT_Bytes schema_bytes,
+  uint64_t entry_struct_id
+) {
+  // Make sure `ctx` is usable (and does nothing), even if we fail early.
+  ctx->finished = false;
+  ctx->writer_ptr = writer;
+  ctx->writer_fn = SVFRT_archive_write_part;
+  ctx->data_bytes_written = 0;
+  ctx->buffer.pointer = NULL;
+  ctx->buffer.count = 0;
+  ctx->buffer_used = 0;
+  ctx->grow_fn = NULL;
+  ctx->grow_ptr = NULL;
+
+  if (!writer->error_code && writer->record_started) {
+    writer->error_code = SVFRT_code_archive__record_already_started;
+  }
+
+  if (!writer->error_code && writer->record_count == writer->record_capacity) {
+    writer->error_code = SVFRT_code_archive__index_full;
+  }
+
+  // Distinct schemas are few, so a linear search is fine.
+  if (!writer->error_code && schema_bytes.count > 0) {
+    bool found = false;
+    for (uint32_t i = 0; i < writer->schema_count; i++) {
+      if (writer->schemas[i].schema_content_hash == schema_content_hash) {
+        found = true;
+        break;
+      }
+    }
+
+    if (!found) {
+      if (writer->schema_count == writer->schema_capacity) {
+        writer->error_code = SVFRT_code_archive__index_full;
+      } else {
+        SVFRT_ArchiveSchema *schema = writer->schemas + writer->schema_count;
+        schema->schema_content_hash = schema_content_hash;
+        schema->schema_offset = writer->bytes_written;
+        schema->schema_length = schema_bytes.count;
+        schema->_reserved = 0;
+        SVFRT_archive_write_bytes(writer, schema_bytes.pointer, schema_bytes.count);
+        writer->schema_count++;
+      }
+    }
+  }
+
+  if (writer->error_code) {
+    ctx->error_code = writer->error_code;
+    return;
+  }
+
+  SVFRT_Bytes no_bytes = {
+    /*.pointer =*/ NULL,
+    /*.count =*/ 0,
+  };
+
+  writer->record_started = true;
+  writer->record_offset = writer->bytes_written;
+  SVFRT_write_start(
+    ctx,
+    SVFRT_archive_write_part,
+    writer,
+    schema_content_hash,
+    no_bytes,
+    no_bytes,
+    entry_struct_id
+  );
+  writer->error_code = ctx->error_code;
+}
+
+void SVFRT_archive_record_finish(
+  SVFRT_ArchiveWriter *writer,
+  SVFRT_WriteContext *ctx
+) {
+  if (writer->error_code) {
+    return;
+  }
+
+  if (!writer->record_started) {
+    writer->error_code = SVFRT_code_archive__record_not_started;
+    return;
+  }
+  writer->record_started = false;
+
+  if (ctx->error_code) {
+    writer->error_code = ctx->error_code;
+    return;
+  }
+
+  if (!ctx->finished) {
+    writer->error_code = SVFRT_code_archive__record_not_finished;
+    return;
+  }
+
+  uint64_t message_length = writer->bytes_written - writer->record_offset;
+  if (message_length > (uint64_t) UINT32_MAX) {
+    writer->error_code = SVFRT_code_write__data_would_overflow;
+    return;
+  }
+
+  SVFRT_ArchiveRecord *record = writer->records + writer->record_count;
+  record->message_offset = writer->record_offset;
+  record->message_length = (uint32_t) message_length;
+  record->_reserved = 0;
+  writer->record_count++;
+
+  SVFRT_archive_write_bytes(writer, NULL, 0);
+}
+
+SVFRT_ErrorCode SVFRT_archive_write_finish(SVFRT_ArchiveWriter *writer) {
+  if (!writer->error_code && writer->record_started) {
+    writer->error_code = SVFRT_code_archive__record_not_finished;
+  }
+
+  // Overflow is not possible, since both counts are bounded by the capacities.
+  SVFRT_archive_write_bytes(
+    writer,
+    writer->schemas,
+    writer->schema_count * (uint32_t) sizeof(SVFRT_ArchiveSchema)
+  );
+  SVFRT_archive_write_bytes(
+    writer,
+    writer->records,
+    writer->record_count * (uint32_t) sizeof(SVFRT_ArchiveRecord)
+  );
+
+  SVFRT_ArchiveFooter footer = {
+    /*.schema_count =*/ writer->schema_count,
+    /*.record_count =*/ writer->record_count,
+    /*.version =*/ SVFRT_ARCHIVE_VERSION,
+    /*.magic =*/ { 'S', 'V', 'F', 'A' },
+  };
+  SVFRT_archive_write_bytes(writer, &footer, sizeof(footer));
+
+  return writer->error_code;
+}
+
+SVFRT_ErrorCode SVFRT_archive_open(
+  SVFRT_Archive *archive,
+  SVFRT_Bytes file
+) {
+  SVFRT_Bytes64 file64 = {
+    /*.pointer =*/ file.pointer,
+    /*.count =*/ file.count,
+  };
+  return SVFRT_archive_open64(archive, file64);
+}
+
+SVFRT_ErrorCode SVFRT_archive_open64(
+  SVFRT_Archive *archive,
+  SVFRT_Bytes64 file
+) {
+  archive->file.pointer = NULL;
+  archive->file.count = 0;
+  archive->schemas = NULL;
+  archive->schema_count = 0;
+  archive->records = NULL;
+  archive->record_count = 0;
+
+  if (((uintptr_t) file.pointer) % SVFRT_MESSAGE_PART_ALIGNMENT != 0) {
+    return SVFRT_code_archive__not_aligned;
+  }
+
+  if (file.count < sizeof(SVFRT_ArchiveHeader) + sizeof(SVFRT_ArchiveFooter)) {
+    return SVFRT_code_archive__malformed;
+  }
+
+  SVFRT_ArchiveHeader const *header = (SVFRT_ArchiveHeader const *) file.pointer;
+  SVFRT_ArchiveFooter const *footer = (SVFRT_ArchiveFooter const *) (
+    file.pointer + file.count - sizeof(SVFRT_ArchiveFooter)
+  );
+  if (0
+    || file.count % SVFRT_MESSAGE_PART_ALIGNMENT != 0
+    || header->magic[0] != 'S'
+    || header->magic[1] != 'V'
+    || header->magic[2] != 'F'
+    || header->magic[3] != 'A'
+    || header->version != SVFRT_ARCHIVE_VERSION
+    || footer->magic[0] != 'S'
+    || footer->magic[1] != 'V'
+    || footer->magic[2] != 'F'
+    || footer->magic[3] != 'A'
+    || footer->version != SVFRT_ARCHIVE_VERSION
+  ) {
+    return SVFRT_code_archive__malformed;
+  }
+
+  // Prevent overflow by casting operands to `uint64_t` first.
+  uint64_t index_end = file.count - sizeof(SVFRT_ArchiveFooter);
+  uint64_t index_size = 0
+    + (uint64_t) footer->schema_count * sizeof(SVFRT_ArchiveSchema)
+    + (uint64_t) footer->record_count * sizeof(SVFRT_ArchiveRecord);
+  if (index_size > index_end - sizeof(SVFRT_ArchiveHeader)) {
+    return SVFRT_code_archive__malformed;
+  }
+
+  uint64_t index_start = index_end - index_size;
+  SVFRT_ArchiveSchema const *schemas = (SVFRT_ArchiveSchema const *) (file.pointer + index_start);
+  SVFRT_ArchiveRecord const *records = (SVFRT_ArchiveRecord const *) (schemas + footer->schema_count);
+
+  // Schemas are few, so validate them now.
+  for (uint32_t i = 0; i < footer->schema_count; i++) {
+    SVFRT_ArchiveSchema const *schema = schemas + i;
+    if (0
+      || schema->schema_offset < sizeof(SVFRT_ArchiveHeader)
+      || schema->schema_offset % SVFRT_MESSAGE_PART_ALIGNMENT != 0
+      || schema->schema_offset > index_start
+      || (uint64_t) schema->schema_length > index_start - schema->schema_offset
+    ) {
+      return SVFRT_code_archive__malformed;
+    }
+  }
+
+  // Only the part before the index is kept, which is where all parts must be.
+  archive->file.pointer = file.pointer;
+  archive->file.count = index_start;
+  archive->schemas = schemas;
+  archive->schema_count = footer->schema_count;
+  archive->records = records;
+  archive->record_count = footer->record_count;
+  return 0;
+}
+
+SVFRT_Bytes SVFRT_archive_lookup(
+  void *archive,
+  uint64_t schema_content_hash
+) {
+  SVFRT_Archive const *it = (SVFRT_Archive const *) archive;
+  SVFRT_Bytes result = {
+    /*.pointer =*/ NULL,
+    /*.count =*/ 0,
+  };
+
+  for (uint32_t i = 0; i < it->schema_count; i++) {
+    SVFRT_ArchiveSchema const *schema = it->schemas + i;
+    if (schema->schema_content_hash == schema_content_hash) {
+      result.pointer = it->file.pointer + schema->schema_offset;
+      result.count = schema->schema_length;
+      return result;
+    }
+  }
+
+  return result;
+}
+
+SVFRT_Bytes SVFRT_archive_get_message(
+  SVFRT_Archive const *archive,
+  uint32_t record_index
+) {
+  SVFRT_Bytes result = {
+    /*.pointer =*/ NULL,
+    /*.count =*/ 0,
+  };
+
+  if (record_index >= archive->record_count) {
+    return result;
+  }
+
+  // `file.count` excludes the index, see `SVFRT_archive_open`.
+  SVFRT_ArchiveRecord const *record = archive->records + record_index;
+  if (0
+    || record->message_offset < sizeof(SVFRT_ArchiveHeader)
+    || record->message_offset % SVFRT_MESSAGE_PART_ALIGNMENT != 0
+    || record->message_offset > archive->file.count
+    || (uint64_t) record->message_length > archive->file.count - record->message_offset
+  ) {
+    return result;
+  }
+
+  result.pointer = archive->file.pointer + record->message_offset;
+  result.count = record->message_length;
+  return result;
+}
+
+typedef struct SVFRT_ArchiveLookup {
+  SVFRT_Archive *archive;
+  SVFRT_SchemaLookupFn *fallback_fn;
+  void *fallback_ptr;
+} SVFRT_ArchiveLookup;
+
+static
+SVFRT_Bytes SVFRT_archive_lookup_with_fallback(void *lookup_ptr, uint64_t schema_content_hash) {
+  SVFRT_ArchiveLookup *lookup = (SVFRT_ArchiveLookup *) lookup_ptr;
+  SVFRT_Bytes result = SVFRT_archive_lookup(lookup->archive, schema_content_hash);
+  if (!result.pointer && lookup->fallback_fn) {
+    result = lookup->fallback_fn(lookup->fallback_ptr, schema_content_hash);
+  }
+  return result;
+}
+
+void SVFRT_archive_read_record(
+  SVFRT_Archive *archive,
+  SVFRT_ReadMessageParams *params,
+  SVFRT_ReadMessageResult *out_result,
+  uint32_t record_index,
+  SVFRT_Bytes scratch
+) {
+  SVFRT_Bytes message = SVFRT_archive_get_message(archive, record_index);
+  if (!message.pointer) {
+    out_result->error_code = (
+      record_index >= archive->record_count
+        ? SVFRT_code_archive__record_out_of_range
+        : SVFRT_code_archive__malformed
+    );
+    out_result->entry = NULL;
+    out_result->allocation = NULL;
+    out_result->compatibility_level = SVFRT_compatibility_none;
+    return;
+  }
+
+  SVFRT_ArchiveLookup lookup = {
+    /*.archive =*/ archive,
+    /*.fallback_fn =*/ params->schema_lookup_fn,
+    /*.fallback_ptr =*/ params->schema_lookup_ptr,
+  };
+  SVFRT_ReadMessageParams record_params = *params;
+  record_params.schema_lookup_fn = SVFRT_archive_lookup_with_fallback;
+  record_params.schema_lookup_ptr = &lookup;
+  SVFRT_read_message(&record_params, out_result, message, scratch);
+}
+
+void SVFRT_archive_iterator_init(
+  SVFRT_ArchiveIterator *iterator,
+  SVFRT_Archive *archive,
+  uint32_t read_ahead_size,
+  SVFRT_ReadAheadFn *read_ahead_fn,
+  void *read_ahead_ptr
+) {
+  iterator->archive = archive;
+  iterator->next_record = 0;
+  iterator->read_ahead_size = read_ahead_size;
+  iterator->read_ahead_end = 0;
+  iterator->read_ahead_fn = read_ahead_fn;
+  iterator->read_ahead_ptr = read_ahead_ptr;
+}
+
+bool SVFRT_archive_iterator_next(
+  SVFRT_ArchiveIterator *iterator,
+  SVFRT_ReadMessageParams *params,
+  SVFRT_ReadMessageResult *out_result,
+  SVFRT_Bytes scratch
+) {
+  SVFRT_Archive *archive = iterator->archive;
+  if (iterator->next_record >= archive->record_count) {
+    return false;
+  }
+
+  uint32_t record_index = iterator->next_record++;
+
+  // Records are in file order, so when the current one reaches past what was
+  // already requested, request the next window, starting from it.
+  SVFRT_Bytes message = SVFRT_archive_get_message(archive, record_index);
+  if (message.pointer && iterator->read_ahead_fn) {
+    uint64_t start = (uint64_t) (message.pointer - archive->file.pointer);
+    uint64_t end = start + message.count;
+    if (end > iterator->read_ahead_end) {
+      uint64_t window_end = start + iterator->read_ahead_size;
+      if (window_end < end) {
+        window_end = end;
+      }
+      if (window_end > archive->file.count) {
+        window_end = archive->file.count;
+      }
+
+      SVFRT_Bytes range = {
+        /*.pointer =*/ message.pointer,
+        /*.count =*/ (uint32_t) (window_end - start),
+      };
+      iterator->read_ahead_fn(iterator->read_ahead_ptr, range);
+      iterator->read_ahead_end = window_end;
+    }
+  }
+
+  SVFRT_archive_read_record(archive, params, out_result, record_index, scratch);
+  return true;
+}
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
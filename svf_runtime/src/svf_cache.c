@@ -0,0 +1,833 @@
+#ifndef SVFRT_SINGLE_FILE
+  #include "svf_runtime.h"
+  #include "svf_internal.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Slot states. A slot only ever moves forward: empty -> busy -> ready.
+#define SVFRT_CACHE_SLOT_EMPTY 0
+#define SVFRT_CACHE_SLOT_BUSY 1
+#define SVFRT_CACHE_SLOT_READY 2
+
+// Records are placed in storage at this alignment.
+#define SVFRT_CACHE_RECORD_ALIGNMENT 8
+
+#define SVFRT_CACHE_SNAPSHOT_VERSION 3
+
+// A cached compatibility result. It is followed by these arrays (all `uint32_t`,
+// except the tags):
+//
+// - `struct_count` struct strides.
+// - `field_matches_count != 0 ? struct_count : 0` field-matches header.
+// - `field_matches_count` field-matches.
+// - `choice_count` option-matches header.
+// - `option_matches_count` option-matches.
+// - `plan_word_capacity` conversion plan words, see #conversion-plan.
+// - `option_matches_count` option-matches tags (`uint8_t`).
+// - `schema_length_src` bytes of the src-schema.
+//
+// The arrays are only present for successful checks. For logical compatibility,
+// they contain everything needed by the conversion, and for exact and binary
+// compatibility, only the strides. The src-schema is always present: its hash
+// comes from the message, so it is not trusted, and a record is only used for
+// the exact same schema, see `SVFRT_cache_find`.
+//
+// The conversion plan is compiled once on insert. If that fails, the plan is
+// empty (`plan_word_count == 0`), and the conversion falls back to traversal.
+typedef struct SVFRT_CacheRecord {
+  SVFRT_ErrorCode error_code;
+  uint32_t level;
+  uint32_t max_schema_work; // Only used for `SVFRT_code_compatibility__max_schema_work_exceeded`.
+  uint32_t schema_length_src;
+  uint32_t schema_length_dst;
+  uint32_t entry_struct_index_src;
+  uint32_t entry_struct_index_dst;
+  uint32_t entry_struct_size_src;
+  uint32_t entry_struct_size_dst;
+  uint32_t struct_count;
+  uint32_t field_matches_count;
+  uint32_t choice_count;
+  uint32_t option_matches_count;
+  uint32_t plan_word_capacity;
+  uint32_t plan_word_count;
+  uint32_t _padding;
+} SVFRT_CacheRecord;
+
+typedef struct SVFRT_CacheKey {
+  uint64_t schema_content_hash_src;
+  uint64_t schema_content_hash_dst;
+  uint64_t entry_struct_id;
+  uint32_t required_level;
+} SVFRT_CacheKey;
+
+typedef struct SVFRT_CacheSnapshotHeader {
+  uint8_t magic[4];
+  uint32_t version;
+  uint32_t entry_count;
+  uint32_t total_size;
+} SVFRT_CacheSnapshotHeader;
+
+typedef struct SVFRT_CacheSnapshotEntry {
+  uint64_t schema_content_hash_src;
+  uint64_t schema_content_hash_dst;
+  uint64_t entry_struct_id;
+  uint32_t required_level;
+  uint32_t record_size;
+} SVFRT_CacheSnapshotEntry;
+
+static inline
+uint64_t SVFRT_cache_align_up(uint64_t value, uint64_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+// Snapshot buffers are not necessarily aligned, so copy byte-wise.
+static inline
+void SVFRT_cache_copy_bytes(void *dst, void const *src, uint32_t size) {
+  uint8_t *bytes_dst = (uint8_t *) dst;
+  uint8_t const *bytes_src = (uint8_t const *) src;
+  for (uint32_t i = 0; i < size; i++) {
+    bytes_dst[i] = bytes_src[i];
+  }
+}
+
+static inline
+uint64_t SVFRT_cache_record_size(SVFRT_CacheRecord const *record) {
+  uint64_t header_count = record->field_matches_count != 0 ? record->struct_count : 0;
+  uint64_t size = (uint64_t) sizeof(SVFRT_CacheRecord) + sizeof(uint32_t) * (
+    (uint64_t) record->struct_count
+    + header_count
+    + (uint64_t) record->field_matches_count
+    + (uint64_t) record->choice_count
+    + (uint64_t) record->option_matches_count
+    + (uint64_t) record->plan_word_capacity
+  ) + (uint64_t) record->option_matches_count * SVFRT_TAG_SIZE + (uint64_t) record->schema_length_src;
+  return SVFRT_cache_align_up(size, SVFRT_CACHE_RECORD_ALIGNMENT);
+}
+
+// The record must agree with its size, see `SVFRT_cache_record_size`.
+static inline
+uint8_t *SVFRT_cache_record_schema_src(SVFRT_CacheRecord *record) {
+  uint64_t header_count = record->field_matches_count != 0 ? record->struct_count : 0;
+  uint64_t offset = (uint64_t) sizeof(SVFRT_CacheRecord) + sizeof(uint32_t) * (
+    (uint64_t) record->struct_count
+    + header_count
+    + (uint64_t) record->field_matches_count
+    + (uint64_t) record->choice_count
+    + (uint64_t) record->option_matches_count
+    + (uint64_t) record->plan_word_capacity
+  ) + (uint64_t) record->option_matches_count * SVFRT_TAG_SIZE;
+  return ((uint8_t *) record) + offset;
+}
+
+static inline
+bool SVFRT_cache_bytes_equal(uint8_t const *a, uint8_t const *b, uint32_t size) {
+  return size == 0 || SVFRT_MEMCMP(a, b, size) == 0;
+}
+
+static inline
+uint32_t SVFRT_cache_slot_index(SVFRT_CacheKey const *key, uint32_t slot_count) {
+  // Content hashes are already well-distributed, so a cheap mix is enough.
+  uint64_t h = key->schema_content_hash_src;
+  h ^= key->schema_content_hash_dst * 0x9E3779B97F4A7C15ull;
+  h ^= key->entry_struct_id * 0xC2B2AE3D27D4EB4Full;
+  h ^= (uint64_t) key->required_level;
+  h ^= h >> 32;
+  return (uint32_t) h & (slot_count - 1);
+}
+
+static inline
+bool SVFRT_cache_key_matches(SVFRT_CompatibilityCacheSlot const *slot, SVFRT_CacheKey const *key) {
+  return (1
+    && slot->schema_content_hash_src == key->schema_content_hash_src
+    && slot->schema_content_hash_dst == key->schema_content_hash_dst
+    && slot->entry_struct_id == key->entry_struct_id
+    && slot->required_level == key->required_level
+  );
+}
+
+// A record matches, if it has the same key, and was made for the same bytes of
+// the src-schema. Otherwise, anyone could put a record for a made-up schema
+// under the hash of a real one, and have messages with the real schema rejected,
+// or converted with the wrong field matches. So there may be multiple records
+// per key, but only one per src-schema.
+static inline
+bool SVFRT_cache_record_matches(
+  SVFRT_CompatibilityCache *cache,
+  SVFRT_CompatibilityCacheSlot const *slot,
+  SVFRT_CacheKey const *key,
+  SVFRT_Bytes unsafe_schema_src
+) {
+  if (!SVFRT_cache_key_matches(slot, key)) {
+    return false;
+  }
+
+  SVFRT_CacheRecord *record = (SVFRT_CacheRecord *) (cache->storage.pointer + slot->record_offset);
+  return (1
+    && record->schema_length_src == unsafe_schema_src.count
+    && SVFRT_cache_bytes_equal(SVFRT_cache_record_schema_src(record), unsafe_schema_src.pointer, unsafe_schema_src.count)
+  );
+}
+
+static
+SVFRT_CompatibilityCacheSlot *SVFRT_cache_find(
+  SVFRT_CompatibilityCache *cache,
+  SVFRT_CacheKey const *key,
+  SVFRT_Bytes unsafe_schema_src
+) {
+  if (!cache->slots) {
+    return NULL;
+  }
+
+  uint32_t mask = cache->slot_count - 1;
+  uint32_t index = SVFRT_cache_slot_index(key, cache->slot_count);
+  for (uint32_t i = 0; i < cache->slot_count; i++) {
+    SVFRT_CompatibilityCacheSlot *slot = cache->slots + ((index + i) & mask);
+    uint32_t state = SVFRT_ATOMIC_LOAD_U32(&slot->state);
+    if (state == SVFRT_CACHE_SLOT_EMPTY) {
+      return NULL;
+    }
+
+    // Busy slots are being filled by another thread. The entry may be the one
+    // we are looking for, but we can't know yet, so treat it as a miss.
+    if (state == SVFRT_CACHE_SLOT_READY && SVFRT_cache_record_matches(cache, slot, key, unsafe_schema_src)) {
+      return slot;
+    }
+  }
+
+  return NULL;
+}
+
+// Reserve storage for a record. Storage is never given back, so reserving it
+// first means that a claimed slot can always be published.
+static
+SVFRT_ErrorCode SVFRT_cache_reserve(
+  SVFRT_CompatibilityCache *cache,
+  uint64_t record_size,
+  uint32_t *out_record_offset
+) {
+  while (1) {
+    uint32_t record_offset = SVFRT_ATOMIC_LOAD_U32(&cache->storage_used);
+    if ((uint64_t) record_offset + record_size > (uint64_t) cache->storage.count) {
+      return SVFRT_code_cache__full;
+    }
+    if (SVFRT_ATOMIC_CAS_U32(&cache->storage_used, record_offset, record_offset + (uint32_t) record_size)) {
+      *out_record_offset = record_offset;
+      return 0;
+    }
+  }
+}
+
+// Publish an already filled record under `key`. `schema_src` is the copy inside
+// of the record.
+static
+SVFRT_ErrorCode SVFRT_cache_publish(
+  SVFRT_CompatibilityCache *cache,
+  SVFRT_CacheKey const *key,
+  SVFRT_Bytes schema_src,
+  uint32_t record_offset,
+  uint32_t record_size
+) {
+  uint32_t mask = cache->slot_count - 1;
+  uint32_t index = SVFRT_cache_slot_index(key, cache->slot_count);
+  uint32_t i = 0;
+  while (i < cache->slot_count) {
+    SVFRT_CompatibilityCacheSlot *slot = cache->slots + ((index + i) & mask);
+    uint32_t state = SVFRT_ATOMIC_LOAD_U32(&slot->state);
+
+    if (state == SVFRT_CACHE_SLOT_READY && SVFRT_cache_record_matches(cache, slot, key, schema_src)) {
+      // Someone else was faster. The reserved storage is wasted, but that's rare.
+      return 0;
+    }
+
+    if (state == SVFRT_CACHE_SLOT_EMPTY) {
+      if (!SVFRT_ATOMIC_CAS_U32(&slot->state, SVFRT_CACHE_SLOT_EMPTY, SVFRT_CACHE_SLOT_BUSY)) {
+        // Lost the race for this slot, look at it again.
+        continue;
+      }
+
+      slot->record_offset = record_offset;
+      slot->record_size = record_size;
+      slot->required_level = key->required_level;
+      slot->schema_content_hash_src = key->schema_content_hash_src;
+      slot->schema_content_hash_dst = key->schema_content_hash_dst;
+      slot->entry_struct_id = key->entry_struct_id;
+      SVFRT_ATOMIC_STORE_U32(&slot->state, SVFRT_CACHE_SLOT_READY);
+      return 0;
+    }
+
+    i++;
+  }
+
+  return SVFRT_code_cache__full;
+}
+
+static inline
+uint32_t *SVFRT_cache_copy_u32(uint32_t *dst, SVFRT_RangeU32 src) {
+  for (uint32_t i = 0; i < src.count; i++) {
+    dst[i] = src.pointer[i];
+  }
+  return dst + src.count;
+}
+
+SVFRT_ErrorCode SVFRT_compatibility_cache_init(
+  SVFRT_CompatibilityCache *cache,
+  SVFRT_Bytes memory,
+  uint32_t slot_count
+) {
+  cache->slots = NULL;
+  cache->slot_count = 0;
+  cache->storage.pointer = NULL;
+  cache->storage.count = 0;
+  cache->storage_used = 0;
+
+  if (slot_count == 0 || (slot_count & (slot_count - 1)) != 0) {
+    return SVFRT_code_cache__invalid_slot_count;
+  }
+
+  uint32_t misalignment = ((uintptr_t) memory.pointer) % SVFRT_CACHE_RECORD_ALIGNMENT;
+  uint64_t padding = misalignment ? SVFRT_CACHE_RECORD_ALIGNMENT - misalignment : 0;
+  uint64_t slots_size = (uint64_t) slot_count * sizeof(SVFRT_CompatibilityCacheSlot);
+  if (padding + slots_size > (uint64_t) memory.count) {
+    return SVFRT_code_cache__not_enough_memory;
+  }
+
+  SVFRT_CompatibilityCacheSlot *slots = (SVFRT_CompatibilityCacheSlot *) (memory.pointer + padding);
+  for (uint32_t i = 0; i < slot_count; i++) {
+    slots[i].state = SVFRT_CACHE_SLOT_EMPTY;
+    slots[i].record_offset = 0;
+    slots[i].record_size = 0;
+    slots[i].required_level = 0;
+    slots[i].schema_content_hash_src = 0;
+    slots[i].schema_content_hash_dst = 0;
+    slots[i].entry_struct_id = 0;
+  }
+
+  // Storage starts right after the slots, which keeps it aligned, since the
+  // slot size is a multiple of `SVFRT_CACHE_RECORD_ALIGNMENT`.
+  cache->slots = slots;
+  cache->slot_count = slot_count;
+  cache->storage.pointer = memory.pointer + padding + slots_size;
+  cache->storage.count = memory.count - (uint32_t) (padding + slots_size);
+  return 0;
+}
+
+void SVFRT_compatibility_cache_reset(SVFRT_CompatibilityCache *cache) {
+  for (uint32_t i = 0; i < cache->slot_count; i++) {
+    cache->slots[i].state = SVFRT_CACHE_SLOT_EMPTY;
+  }
+  cache->storage_used = 0;
+}
+
+bool SVFRT_compatibility_cache_lookup(
+  SVFRT_CompatibilityCache *cache,
+  SVFRT_CompatibilityResult *out_result,
+  SVFRT_Bytes unsafe_schema_src,
+  SVFRT_Bytes schema_dst,
+  uint64_t schema_content_hash_src,
+  uint64_t schema_content_hash_dst,
+  uint64_t entry_struct_id,
+  SVFRT_CompatibilityLevel required_level,
+  uint32_t max_schema_work
+) {
+  SVFRT_CacheKey key = {
+    /*.schema_content_hash_src =*/ schema_content_hash_src,
+    /*.schema_content_hash_dst =*/ schema_content_hash_dst,
+    /*.entry_struct_id =*/ entry_struct_id,
+    /*.required_level =*/ (uint32_t) required_level,
+  };
+  SVFRT_CompatibilityCacheSlot *slot = SVFRT_cache_find(cache, &key, unsafe_schema_src);
+  if (!slot) {
+    return false;
+  }
+
+  SVFRT_CacheRecord *record = (SVFRT_CacheRecord *) (cache->storage.pointer + slot->record_offset);
+
+  // The src-schema was compared in full. The dst-schema is our own, so the hash
+  // is trusted, and this is only a cheap sanity check.
+  if (record->schema_length_dst != schema_dst.count) {
+    return false;
+  }
+
+  if (record->error_code != 0) {
+    // Running out of work is only relevant if we don't have more to spend now.
+    if (
+      record->error_code == SVFRT_code_compatibility__max_schema_work_exceeded
+      && max_schema_work > record->max_schema_work
+    ) {
+      return false;
+    }
+
+    out_result->error_code = record->error_code;
+    out_result->level = SVFRT_compatibility_none;
+    return true;
+  }
+
+  uint32_t *arrays = (uint32_t *) (record + 1);
+
+  out_result->error_code = 0;
+  out_result->level = (SVFRT_CompatibilityLevel) record->level;
+  out_result->quirky_struct_strides_dst.pointer = arrays;
+  out_result->quirky_struct_strides_dst.count = record->struct_count;
+  arrays += record->struct_count;
+
+  if (record->level == SVFRT_compatibility_logical) {
+    // Lengths were checked above, and the checked schemas were big enough.
+    out_result->logical.unsafe_schema_src = unsafe_schema_src;
+    out_result->logical.schema_dst = schema_dst;
+    out_result->logical.unsafe_definition_src = SVFRT_internal_schema_definition(unsafe_schema_src);
+    out_result->logical.definition_dst = SVFRT_internal_schema_definition(schema_dst);
+    out_result->logical.entry_struct_index_src = record->entry_struct_index_src;
+    out_result->logical.entry_struct_index_dst = record->entry_struct_index_dst;
+    out_result->logical.unsafe_entry_struct_size_src = record->entry_struct_size_src;
+    out_result->logical.entry_struct_size_dst = record->entry_struct_size_dst;
+
+    uint32_t header_count = record->field_matches_count != 0 ? record->struct_count : 0;
+    out_result->logical.field_matches_header.pointer = arrays;
+    out_result->logical.field_matches_header.count = header_count;
+    arrays += header_count;
+
+    out_result->logical.field_matches.pointer = arrays;
+    out_result->logical.field_matches.count = record->field_matches_count;
+    arrays += record->field_matches_count;
+
+    out_result->logical.option_matches_header.pointer = arrays;
+    out_result->logical.option_matches_header.count = record->choice_count;
+    arrays += record->choice_count;
+
+    out_result->logical.option_matches.pointer = arrays;
+    out_result->logical.option_matches.count = record->option_matches_count;
+    arrays += record->option_matches_count;
+
+    if (record->plan_word_count != 0) {
+      out_result->logical.conversion_plan.pointer = arrays;
+      out_result->logical.conversion_plan.count = record->plan_word_count;
+    }
+    arrays += record->plan_word_capacity;
+
+    out_result->logical.option_matches_tags.pointer = (uint8_t *) arrays;
+    out_result->logical.option_matches_tags.count = record->option_matches_count;
+  }
+
+  return true;
+}
+
+SVFRT_ErrorCode SVFRT_compatibility_cache_insert(
+  SVFRT_CompatibilityCache *cache,
+  SVFRT_CompatibilityResult *result,
+  SVFRT_Bytes unsafe_schema_src,
+  SVFRT_Bytes schema_dst,
+  uint64_t schema_content_hash_src,
+  uint64_t schema_content_hash_dst,
+  uint64_t entry_struct_id,
+  SVFRT_CompatibilityLevel required_level,
+  uint32_t max_schema_work
+) {
+  // Not a property of the schemas.
+  if (result->error_code == SVFRT_code_compatibility__not_enough_scratch_memory) {
+    return 0;
+  }
+
+  // Should not happen, see `SVFRT_code_compatibility_internal__unknown`.
+  if (result->error_code == 0 && result->level == SVFRT_compatibility_none) {
+    return 0;
+  }
+
+  SVFRT_CacheKey key = {
+    /*.schema_content_hash_src =*/ schema_content_hash_src,
+    /*.schema_content_hash_dst =*/ schema_content_hash_dst,
+    /*.entry_struct_id =*/ entry_struct_id,
+    /*.required_level =*/ (uint32_t) required_level,
+  };
+
+  if (!cache->slots) {
+    return SVFRT_code_cache__invalid_slot_count;
+  }
+
+  // Don't waste storage on entries which are already present.
+  if (SVFRT_cache_find(cache, &key, unsafe_schema_src)) {
+    return 0;
+  }
+
+  SVFRT_CacheRecord record = {0};
+  record.error_code = result->error_code;
+  record.level = (uint32_t) result->level;
+  record.max_schema_work = max_schema_work;
+  record.schema_length_src = unsafe_schema_src.count;
+  record.schema_length_dst = schema_dst.count;
+
+  if (result->error_code == 0) {
+    record.struct_count = result->quirky_struct_strides_dst.count;
+  }
+
+  bool is_logical = result->error_code == 0 && result->level == SVFRT_compatibility_logical;
+  if (is_logical) {
+    record.entry_struct_index_src = result->logical.entry_struct_index_src;
+    record.entry_struct_index_dst = result->logical.entry_struct_index_dst;
+    record.entry_struct_size_src = result->logical.unsafe_entry_struct_size_src;
+    record.entry_struct_size_dst = result->logical.entry_struct_size_dst;
+    record.field_matches_count = result->logical.field_matches.count;
+    record.choice_count = result->logical.option_matches_header.count;
+    record.option_matches_count = result->logical.option_matches.count;
+    record.plan_word_capacity = SVFRT_conversion_plan_max_words(&result->logical);
+  }
+
+  uint64_t record_size = SVFRT_cache_record_size(&record);
+  uint32_t record_offset = 0;
+  SVFRT_ErrorCode error_code = SVFRT_cache_reserve(cache, record_size, &record_offset);
+  if (error_code) {
+    return error_code;
+  }
+
+  SVFRT_CacheRecord *record_in_storage = (SVFRT_CacheRecord *) (cache->storage.pointer + record_offset);
+  *record_in_storage = record;
+
+  uint32_t *arrays = (uint32_t *) (record_in_storage + 1);
+  if (result->error_code == 0) {
+    arrays = SVFRT_cache_copy_u32(arrays, result->quirky_struct_strides_dst);
+  }
+  if (is_logical) {
+    if (record.field_matches_count != 0) {
+      arrays = SVFRT_cache_copy_u32(arrays, result->logical.field_matches_header);
+    }
+    arrays = SVFRT_cache_copy_u32(arrays, result->logical.field_matches);
+    arrays = SVFRT_cache_copy_u32(arrays, result->logical.option_matches_header);
+    arrays = SVFRT_cache_copy_u32(arrays, result->logical.option_matches);
+
+    // Compiled right into the storage, since plan words are position-independent.
+    SVFRT_RangeU32 plan_memory = { arrays, record.plan_word_capacity };
+    SVFRT_RangeU32 plan = {0};
+    if (SVFRT_conversion_plan_compile(&plan, &result->logical, plan_memory)) {
+      record_in_storage->plan_word_count = plan.count;
+    }
+    arrays += record.plan_word_capacity;
+
+    SVFRT_cache_copy_bytes(arrays, result->logical.option_matches_tags.pointer, record.option_matches_count);
+  }
+
+  SVFRT_Bytes schema_src_in_storage = {
+    /*.pointer =*/ SVFRT_cache_record_schema_src(record_in_storage),
+    /*.count =*/ record.schema_length_src,
+  };
+  SVFRT_cache_copy_bytes(schema_src_in_storage.pointer, unsafe_schema_src.pointer, unsafe_schema_src.count);
+
+  return SVFRT_cache_publish(cache, &key, schema_src_in_storage, record_offset, (uint32_t) record_size);
+}
+
+uint32_t SVFRT_compatibility_cache_snapshot(
+  SVFRT_CompatibilityCache *cache,
+  SVFRT_Bytes out_bytes,
+  SVFRT_ErrorCode *out_error_code
+) {
+  *out_error_code = 0;
+
+  // Entries published concurrently may or may not be included, but the ones
+  // that are, are always complete.
+  uint64_t total_size = sizeof(SVFRT_CacheSnapshotHeader);
+  uint32_t entry_count = 0;
+  for (uint32_t i = 0; i < cache->slot_count; i++) {
+    SVFRT_CompatibilityCacheSlot *slot = cache->slots + i;
+    if (SVFRT_ATOMIC_LOAD_U32(&slot->state) != SVFRT_CACHE_SLOT_READY) {
+      continue;
+    }
+
+    uint64_t entry_size = (uint64_t) sizeof(SVFRT_CacheSnapshotEntry) + (uint64_t) slot->record_size;
+    if (total_size + entry_size <= (uint64_t) out_bytes.count) {
+      SVFRT_CacheSnapshotEntry entry = {
+        /*.schema_content_hash_src =*/ slot->schema_content_hash_src,
+        /*.schema_content_hash_dst =*/ slot->schema_content_hash_dst,
+        /*.entry_struct_id =*/ slot->entry_struct_id,
+        /*.required_level =*/ slot->required_level,
+        /*.record_size =*/ slot->record_size,
+      };
+      uint8_t *pointer = out_bytes.pointer + total_size;
+      SVFRT_cache_copy_bytes(pointer, &entry, sizeof(entry));
+      SVFRT_cache_copy_bytes(
+        pointer + sizeof(entry),
+        cache->storage.pointer + slot->record_offset,
+        slot->record_size
+      );
+    }
+
+    total_size += entry_size;
+    entry_count++;
+  }
+
+  if (total_size > (uint64_t) UINT32_MAX) {
+    *out_error_code = SVFRT_code_cache__snapshot_buffer_too_small;
+    return UINT32_MAX;
+  }
+
+  if (total_size > (uint64_t) out_bytes.count) {
+    *out_error_code = SVFRT_code_cache__snapshot_buffer_too_small;
+    return (uint32_t) total_size;
+  }
+
+  SVFRT_CacheSnapshotHeader header = {
+    /*.magic =*/ { 'S', 'V', 'F', 'C' },
+    /*.version =*/ SVFRT_CACHE_SNAPSHOT_VERSION,
+    /*.entry_count =*/ entry_count,
+    /*.total_size =*/ (uint32_t) total_size,
+  };
+  SVFRT_cache_copy_bytes(out_bytes.pointer, &header, sizeof(header));
+  return (uint32_t) total_size;
+}
+
+SVFRT_ErrorCode SVFRT_compatibility_cache_restore(
+  SVFRT_CompatibilityCache *cache,
+  SVFRT_Bytes snapshot
+) {
+  if (!cache->slots) {
+    return SVFRT_code_cache__invalid_slot_count;
+  }
+
+  SVFRT_CacheSnapshotHeader header;
+  if (snapshot.count < sizeof(header)) {
+    return SVFRT_code_cache__snapshot_malformed;
+  }
+  SVFRT_cache_copy_bytes(&header, snapshot.pointer, sizeof(header));
+
+  if (0
+    || header.magic[0] != 'S'
+    || header.magic[1] != 'V'
+    || header.magic[2] != 'F'
+    || header.magic[3] != 'C'
+    || header.version != SVFRT_CACHE_SNAPSHOT_VERSION
+    || header.total_size != snapshot.count
+  ) {
+    return SVFRT_code_cache__snapshot_malformed;
+  }
+
+  uint64_t offset = sizeof(header);
+  for (uint32_t i = 0; i < header.entry_count; i++) {
+    SVFRT_CacheSnapshotEntry entry;
+    if (offset + sizeof(entry) > (uint64_t) snapshot.count) {
+      return SVFRT_code_cache__snapshot_malformed;
+    }
+    SVFRT_cache_copy_bytes(&entry, snapshot.pointer + offset, sizeof(entry));
+    offset += sizeof(entry);
+
+    if (0
+      || entry.record_size < sizeof(SVFRT_CacheRecord)
+      || offset + (uint64_t) entry.record_size > (uint64_t) snapshot.count
+    ) {
+      return SVFRT_code_cache__snapshot_malformed;
+    }
+
+    // Make sure the record agrees with its own size, so that lookups stay in bounds.
+    SVFRT_CacheRecord record;
+    SVFRT_cache_copy_bytes(&record, snapshot.pointer + offset, sizeof(record));
+    if (
+      SVFRT_cache_record_size(&record) != (uint64_t) entry.record_size ||
+      record.plan_word_count > record.plan_word_capacity
+    ) {
+      return SVFRT_code_cache__snapshot_malformed;
+    }
+
+    SVFRT_CacheKey key = {
+      /*.schema_content_hash_src =*/ entry.schema_content_hash_src,
+      /*.schema_content_hash_dst =*/ entry.schema_content_hash_dst,
+      /*.entry_struct_id =*/ entry.entry_struct_id,
+      /*.required_level =*/ entry.required_level,
+    };
+
+    SVFRT_Bytes schema_src = {
+      /*.pointer =*/ snapshot.pointer + offset + (SVFRT_cache_record_schema_src(&record) - (uint8_t *) &record),
+      /*.count =*/ record.schema_length_src,
+    };
+
+    if (!SVFRT_cache_find(cache, &key, schema_src)) {
+      uint32_t record_offset = 0;
+      SVFRT_ErrorCode error_code = SVFRT_cache_reserve(cache, entry.record_size, &record_offset);
+      if (error_code) {
+        return error_code;
+      }
+
+      SVFRT_cache_copy_bytes(
+        cache->storage.pointer + record_offset,
+        snapshot.pointer + offset,
+        entry.record_size
+      );
+
+      schema_src.pointer = SVFRT_cache_record_schema_src((SVFRT_CacheRecord *) (cache->storage.pointer + record_offset));
+      error_code = SVFRT_cache_publish(cache, &key, schema_src, record_offset, entry.record_size);
+      if (error_code) {
+        return error_code;
+      }
+    }
+
+    offset += entry.record_size;
+  }
+
+  if (offset != (uint64_t) snapshot.count) {
+    return SVFRT_code_cache__snapshot_malformed;
+  }
+
+  return 0;
+}
+
+// #generated-conversion.
+//
+// The converter table is filled once, and only read afterwards, so unlike the
+// cache above, it needs no atomics. Same as for the cache, a converter is only
+// used for the exact bytes of its src-schema.
+
+static inline
+uint32_t SVFRT_converter_table_slot_index(
+  uint64_t schema_content_hash_src,
+  uint64_t schema_content_hash_dst,
+  uint64_t entry_struct_id,
+  uint32_t slot_count
+) {
+  // Same mix as `SVFRT_cache_slot_index`.
+  uint64_t h = schema_content_hash_src;
+  h ^= schema_content_hash_dst * 0x9E3779B97F4A7C15ull;
+  h ^= entry_struct_id * 0xC2B2AE3D27D4EB4Full;
+  h ^= h >> 32;
+  return (uint32_t) h & (slot_count - 1);
+}
+
+static inline
+bool SVFRT_converter_matches(
+  SVFRT_GeneratedConverter const *converter,
+  uint8_t const *unsafe_schema_src,
+  uint32_t unsafe_schema_length_src,
+  uint64_t schema_content_hash_src,
+  uint64_t schema_content_hash_dst,
+  uint64_t entry_struct_id
+) {
+  return (1
+    && converter->schema_content_hash_src == schema_content_hash_src
+    && converter->schema_content_hash_dst == schema_content_hash_dst
+    && converter->entry_struct_id == entry_struct_id
+    && converter->schema_length_src == unsafe_schema_length_src
+    && SVFRT_cache_bytes_equal(converter->schema_src, unsafe_schema_src, unsafe_schema_length_src)
+  );
+}
+
+SVFRT_ErrorCode SVFRT_converter_table_init(
+  SVFRT_ConverterTable *table,
+  SVFRT_Bytes memory,
+  uint32_t slot_count
+) {
+  table->slots = NULL;
+  table->slot_count = 0;
+  table->converter_count = 0;
+
+  if (slot_count == 0 || (slot_count & (slot_count - 1)) != 0) {
+    return SVFRT_code_converter_table__invalid_slot_count;
+  }
+
+  uint32_t alignment = (uint32_t) sizeof(SVFRT_GeneratedConverter const *);
+  uint32_t misalignment = ((uintptr_t) memory.pointer) % alignment;
+  uint64_t padding = misalignment ? alignment - misalignment : 0;
+  uint64_t slots_size = (uint64_t) slot_count * sizeof(SVFRT_GeneratedConverter const *);
+  if (padding + slots_size > (uint64_t) memory.count) {
+    return SVFRT_code_converter_table__not_enough_memory;
+  }
+
+  SVFRT_GeneratedConverter const **slots = (SVFRT_GeneratedConverter const **) (memory.pointer + padding);
+  for (uint32_t i = 0; i < slot_count; i++) {
+    slots[i] = NULL;
+  }
+
+  table->slots = slots;
+  table->slot_count = slot_count;
+  return 0;
+}
+
+SVFRT_ErrorCode SVFRT_converter_table_add(
+  SVFRT_ConverterTable *table,
+  SVFRT_GeneratedConverter const *converters,
+  uint32_t converter_count
+) {
+  for (uint32_t i = 0; i < converter_count; i++) {
+    SVFRT_GeneratedConverter const *converter = converters + i;
+
+    uint32_t mask = table->slot_count - 1;
+    uint32_t index = SVFRT_converter_table_slot_index(
+      converter->schema_content_hash_src,
+      converter->schema_content_hash_dst,
+      converter->entry_struct_id,
+      table->slot_count
+    );
+
+    // Keep at least one slot empty, so that lookups always terminate.
+    bool placed = false;
+    for (uint32_t j = 0; j < table->slot_count; j++) {
+      SVFRT_GeneratedConverter const **slot = table->slots + ((index + j) & mask);
+      if (!*slot) {
+        if (table->converter_count + 1 >= table->slot_count) {
+          return SVFRT_code_converter_table__full;
+        }
+        *slot = converter;
+        table->converter_count++;
+        placed = true;
+        break;
+      }
+
+      if (SVFRT_converter_matches(
+        *slot,
+        converter->schema_src,
+        converter->schema_length_src,
+        converter->schema_content_hash_src,
+        converter->schema_content_hash_dst,
+        converter->entry_struct_id
+      )) {
+        placed = true;
+        break;
+      }
+    }
+
+    if (!placed) {
+      return SVFRT_code_converter_table__full;
+    }
+  }
+
+  return 0;
+}
+
+SVFRT_GeneratedConverter const *SVFRT_converter_table_find(
+  SVFRT_ConverterTable *table,
+  SVFRT_Bytes unsafe_schema_src,
+  uint64_t schema_content_hash_src,
+  uint64_t schema_content_hash_dst,
+  uint64_t entry_struct_id
+) {
+  if (!table->slots) {
+    return NULL;
+  }
+
+  uint32_t mask = table->slot_count - 1;
+  uint32_t index = SVFRT_converter_table_slot_index(
+    schema_content_hash_src,
+    schema_content_hash_dst,
+    entry_struct_id,
+    table->slot_count
+  );
+  for (uint32_t i = 0; i < table->slot_count; i++) {
+    SVFRT_GeneratedConverter const *converter = table->slots[(index + i) & mask];
+    if (!converter) {
+      return NULL;
+    }
+
+    if (SVFRT_converter_matches(
+      converter,
+      unsafe_schema_src.pointer,
+      unsafe_schema_src.count,
+      schema_content_hash_src,
+      schema_content_hash_dst,
+      entry_struct_id
+    )) {
+      return converter;
+    }
+  }
+
+  return NULL;
+}
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
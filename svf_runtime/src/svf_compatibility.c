@@ -26,6 +26,15 @@ typedef struct SVFRT_IndexPair {
 } SVFRT_IndexPair;
 // TODO: sizeof must be 8, and alignof must be 4. Check this at compile time.
 
+// See #compatibility-matching. IDs are split in two, so that the alignment is
+// the same as for the other scratch memory partitions.
+typedef struct SVFRT_MemberIndexEntry {
+  uint32_t id_low;
+  uint32_t id_high;
+  uint32_t index_dst;
+  uint32_t index_src;
+} SVFRT_MemberIndexEntry;
+
 typedef struct SVFRT_IndexPairQueue {
   SVFRT_IndexPair *pointer;
   uint32_t capacity;
@@ -69,6 +78,10 @@ typedef struct SVFRT_CheckContext {
   SVFRT_Bytes option_matches_tags;
   SVFRT_RangeU32 option_matches;
 
+  // Reused for each struct or choice, see #compatibility-matching.
+  SVFRT_MemberIndexEntry *member_index;
+  uint32_t member_index_capacity;
+
   // Lowest level seen so far. Should be >= required level.
   SVFRT_CompatibilityLevel current_level;
 
@@ -147,15 +160,133 @@ void SVFRT_check_add_choice(
 
 static inline
 bool SVFRT_check_work(SVFRT_CheckContext *ctx, uint32_t work_count) {
-  ctx->work_done += work_count;
-  if (ctx->work_done > ctx->max_schema_work) {
+  // Prevent addition overflow by casting operands to `uint64_t` first.
+  if ((uint64_t) ctx->work_done + (uint64_t) work_count > (uint64_t) ctx->max_schema_work) {
+    ctx->work_done = UINT32_MAX;
     ctx->error_code = SVFRT_code_compatibility__max_schema_work_exceeded;
     return false;
   }
 
+  ctx->work_done += work_count;
   return true;
 }
 
+// #compatibility-matching.
+//
+// Fields of two structs (and options of two choices) are matched by ID.
+// Instead of comparing each src-member with each dst-member, the dst-members
+// are sorted by ID into an index in scratch memory, and each src-member is
+// found there with a binary search. Only the dst-side is indexed, so the
+// scratch memory needed depends only on the dst-schema, and the potentially
+// adversarial src-schema can't make the index any larger.
+//
+// When multiple src-members have the same ID, the first one is matched, same
+// as with a linear search.
+
+static inline
+uint64_t SVFRT_member_index_id(SVFRT_MemberIndexEntry *entry) {
+  return ((uint64_t) entry->id_high << 32) | (uint64_t) entry->id_low;
+}
+
+static inline
+void SVFRT_member_index_set(
+  SVFRT_MemberIndexEntry *entry,
+  uint64_t id,
+  uint32_t index_dst
+) {
+  entry->id_low = (uint32_t) id;
+  entry->id_high = (uint32_t) (id >> 32);
+  entry->index_dst = index_dst;
+  entry->index_src = UINT32_MAX;
+}
+
+// Heapsort by ID: in-place, and no worst case to exploit.
+static
+void SVFRT_member_index_sort(SVFRT_MemberIndexEntry *entries, uint32_t count) {
+  if (count < 2) {
+    return;
+  }
+
+  // Heapify, then repeatedly move the max to the end.
+  uint32_t start = count / 2;
+  uint32_t end = count;
+  while (end > 1) {
+    if (start > 0) {
+      start--;
+    } else {
+      end--;
+      SVFRT_MemberIndexEntry temp = entries[0];
+      entries[0] = entries[end];
+      entries[end] = temp;
+    }
+
+    // Sift down from `start`.
+    uint32_t root = start;
+    for (;;) {
+      // No overflow, as `count` is limited by the scratch memory size.
+      uint32_t child = 2 * root + 1;
+      if (child >= end) {
+        break;
+      }
+      if (
+        child + 1 < end &&
+        SVFRT_member_index_id(entries + child) < SVFRT_member_index_id(entries + child + 1)
+      ) {
+        child++;
+      }
+      if (SVFRT_member_index_id(entries + root) >= SVFRT_member_index_id(entries + child)) {
+        break;
+      }
+      SVFRT_MemberIndexEntry temp = entries[root];
+      entries[root] = entries[child];
+      entries[child] = temp;
+      root = child;
+    }
+  }
+}
+
+// Returns NULL, if not found.
+static inline
+SVFRT_MemberIndexEntry *SVFRT_member_index_find(
+  SVFRT_MemberIndexEntry *entries,
+  uint32_t count,
+  uint64_t id
+) {
+  uint32_t low = 0;
+  uint32_t high = count;
+  while (low < high) {
+    uint32_t middle = low + (high - low) / 2;
+    uint64_t middle_id = SVFRT_member_index_id(entries + middle);
+    if (middle_id == id) {
+      return entries + middle;
+    }
+    if (middle_id < id) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return NULL;
+}
+
+// Work for matching members by ID, see #compatibility-matching. Roughly, one
+// unit per member, times the binary search depth. Saturates at `UINT32_MAX`.
+//
+// Should be kept in sync with `get_compatibility_work` in `svf_tools`.
+static inline
+uint32_t SVFRT_check_matching_work(uint32_t unsafe_count_src, uint32_t count_dst) {
+  uint32_t depth = 1;
+  while (depth < 32 && ((uint64_t) 1 << (depth - 1)) < (uint64_t) count_dst) {
+    depth++;
+  }
+
+  uint64_t work = ((uint64_t) unsafe_count_src + (uint64_t) count_dst) * (uint64_t) depth;
+  if (work > (uint64_t) UINT32_MAX) {
+    return UINT32_MAX;
+  }
+  return (uint32_t) work;
+}
+
 // TODO: report the specific types that did not match?
 void SVFRT_check_concrete_type(
   SVFRT_CheckContext *ctx,
@@ -291,6 +422,30 @@ void SVFRT_check_type(
   SVF_Meta_Type_tag tag_dst,
   SVF_Meta_Type_payload *payload_dst
 ) {
+  // #chunked-sequences can be converted to regular sequences, by putting all
+  // elements together.
+  if (
+    unsafe_tag_src == SVF_Meta_Type_tag_chunkedSequence &&
+    tag_dst == SVF_Meta_Type_tag_sequence
+  ) {
+    if (ctx->current_level >= SVFRT_compatibility_binary) {
+      ctx->current_level = SVFRT_compatibility_logical;
+      if (ctx->current_level < ctx->required_level) {
+        ctx->error_code = SVFRT_code_compatibility__type_mismatch;
+        return;
+      }
+    }
+
+    SVFRT_check_concrete_type(
+      ctx,
+      unsafe_payload_src->chunkedSequence.elementType_tag,
+      &unsafe_payload_src->chunkedSequence.elementType_payload,
+      payload_dst->sequence.elementType_tag,
+      &payload_dst->sequence.elementType_payload
+    );
+    return;
+  }
+
   if (unsafe_tag_src != tag_dst) {
     ctx->error_code = SVFRT_code_compatibility__type_mismatch;
     return;
@@ -317,6 +472,16 @@ void SVFRT_check_type(
       );
       return;
     }
+    case SVF_Meta_Type_tag_chunkedSequence: {
+      SVFRT_check_concrete_type(
+        ctx,
+        unsafe_payload_src->chunkedSequence.elementType_tag,
+        &unsafe_payload_src->chunkedSequence.elementType_payload,
+        payload_dst->chunkedSequence.elementType_tag,
+        &payload_dst->chunkedSequence.elementType_payload
+      );
+      return;
+    }
     case SVF_Meta_Type_tag_concrete: {
       SVFRT_check_concrete_type(
         ctx,
@@ -368,6 +533,25 @@ void SVFRT_check_struct(
     return;
   }
 
+  // See #natural-alignment. Only the dst-alignment matters when reading in
+  // place, but a src-schema with an impossible one is malformed.
+  uint32_t unsafe_alignment_src = unsafe_definition_src->alignment;
+  if (
+    unsafe_alignment_src == 0 ||
+    (unsafe_alignment_src & (unsafe_alignment_src - 1)) != 0 ||
+    unsafe_alignment_src > SVFRT_MESSAGE_PART_ALIGNMENT ||
+    unsafe_definition_src->size % unsafe_alignment_src != 0
+  ) {
+    ctx->error_code = SVFRT_code_compatibility__invalid_alignment;
+    return;
+  }
+
+  // The dst-schema is trusted, this only rules out a division by zero below.
+  if (definition_dst->alignment == 0) {
+    ctx->error_code = SVFRT_code_compatibility_internal__invalid_structs;
+    return;
+  }
+
   // Compatibility rules for structs:
   // ================================
   // TODO: Additional review for these rules. They look right, but there might be
@@ -407,92 +591,134 @@ void SVFRT_check_struct(
   // - The size of the DST-struct must be _EQUAL_ to the size of the SRC-struct.
 
   // Looping over potentially adversarial data, so limit work. #compatibility-work-fields.
-  if (!SVFRT_check_work(ctx, 2 * unsafe_fields_src.count * fields_dst.count)) {
+  if (!SVFRT_check_work(ctx, SVFRT_check_matching_work(unsafe_fields_src.count, fields_dst.count))) {
+    return;
+  }
+
+  // See #compatibility-matching. The scratch memory partition is sized for the
+  // largest dst-struct, so this should not happen.
+  if (fields_dst.count > ctx->member_index_capacity) {
+    ctx->error_code = SVFRT_code_compatibility_internal__member_index_overflow;
     return;
   }
 
+  SVFRT_MemberIndexEntry *member_index = ctx->member_index;
+  for (uint32_t i = 0; i < fields_dst.count; i++) {
+    SVFRT_member_index_set(member_index + i, fields_dst.pointer[i].fieldId, i);
+  }
+  SVFRT_member_index_sort(member_index, fields_dst.count);
+
+  // Negative-polarity src-fields must have a match. This error is reported
+  // after all of the dst-fields are checked.
+  bool src_field_cannot_be_ignored = false;
+
+  for (uint32_t j = 0; j < unsafe_fields_src.count; j++) {
+    SVF_Meta_FieldDefinition *unsafe_field_src = unsafe_fields_src.pointer + j;
+    SVFRT_MemberIndexEntry *entry = SVFRT_member_index_find(
+      member_index,
+      fields_dst.count,
+      unsafe_field_src->fieldId
+    );
+
+    if (!entry) {
+      bool inverted_polarity_src = (unsafe_field_src->fieldId & (1ull << 63)) != 0;
+      if (inverted_polarity_src) {
+        // TODO: not covered by tests yet.
+        src_field_cannot_be_ignored = true;
+      }
+      continue;
+    }
+
+    // Note: an incorrect src-schema could have multiple fields with the
+    // same ID. We will simply ignore those after the first one here.
+    //
+    // This is equivalent to having additional src-fields that do not match
+    // to anything, and should not cause any problems.
+    if (entry->index_src == UINT32_MAX) {
+      entry->index_src = j;
+    }
+  }
+
+  // Field-matches table should be valid for every possible dst-field, so no
+  // range checking is required here. For now, it holds src-indices of all
+  // matches, removed or not.
+  for (uint32_t k = 0; k < fields_dst.count; k++) {
+    SVFRT_MemberIndexEntry *entry = member_index + k;
+    ctx->field_matches.pointer[field_matches_index + entry->index_dst] = entry->index_src;
+  }
+
   for (uint32_t i = 0; i < fields_dst.count; i++) {
     SVF_Meta_FieldDefinition *field_dst = fields_dst.pointer + i;
     bool inverted_polarity_dst = (field_dst->fieldId & (1ull << 63)) != 0;
 
-    // Field-matches table should be valid for every possible dst-field, so no
-    // range checking is required here.
     uint32_t *out_match = ctx->field_matches.pointer + field_matches_index + i;
+    uint32_t j = *out_match;
 
-    bool found = false;
-    for (uint32_t j = 0; j < unsafe_fields_src.count; j++) {
+    if (j != UINT32_MAX) {
+      // Only matches of present src-fields are kept.
+      *out_match = UINT32_MAX;
+
+      // Found by index, so it's in range.
       SVF_Meta_FieldDefinition *unsafe_field_src = unsafe_fields_src.pointer + j;
 
-      if (unsafe_field_src->fieldId == field_dst->fieldId) {
-        if (!inverted_polarity_dst && !unsafe_field_src->removed && field_dst->removed) {
-          // TODO: not covered by tests yet.
-          ctx->error_code = SVFRT_code_compatibility__field_cannot_be_ignored;
-          return;
-        }
+      if (!inverted_polarity_dst && !unsafe_field_src->removed && field_dst->removed) {
+        // TODO: not covered by tests yet.
+        ctx->error_code = SVFRT_code_compatibility__field_cannot_be_ignored;
+        return;
+      }
 
-        if (inverted_polarity_dst && unsafe_field_src->removed && !field_dst->removed) {
-          ctx->error_code = SVFRT_code_compatibility__field_is_missing;
+      if (inverted_polarity_dst && unsafe_field_src->removed && !field_dst->removed) {
+        ctx->error_code = SVFRT_code_compatibility__field_is_missing;
+        return;
+      }
+
+      if (!unsafe_field_src->removed && !field_dst->removed) {
+        SVFRT_check_type(
+          ctx,
+          unsafe_field_src->type_tag,
+          &unsafe_field_src->type_payload,
+          field_dst->type_tag,
+          &field_dst->type_payload
+        );
+
+        if (ctx->error_code) {
           return;
         }
+      }
 
-        if (!unsafe_field_src->removed && !field_dst->removed) {
-          SVFRT_check_type(
-            ctx,
-            unsafe_field_src->type_tag,
-            &unsafe_field_src->type_payload,
-            field_dst->type_tag,
-            &field_dst->type_payload
-          );
+      if (ctx->current_level >= SVFRT_compatibility_binary) {
+        // Additional checks for binary compatibility, that either downgrade
+        // the current level to logical compatibility, or return an error.
 
-          if (ctx->error_code) {
+        if (unsafe_field_src->offset != field_dst->offset) {
+          ctx->current_level = SVFRT_compatibility_logical;
+          if (ctx->current_level < ctx->required_level) {
+            ctx->error_code = SVFRT_code_compatibility__field_offset_mismatch;
             return;
           }
         }
 
-        if (ctx->current_level >= SVFRT_compatibility_binary) {
-          // Additional checks for binary compatibility, that either downgrade
-          // the current level to logical compatibility, or return an error.
-
-          if (unsafe_field_src->offset != field_dst->offset) {
-            ctx->current_level = SVFRT_compatibility_logical;
-            if (ctx->current_level < ctx->required_level) {
-              ctx->error_code = SVFRT_code_compatibility__field_offset_mismatch;
-              return;
-            }
+        if (!unsafe_field_src->removed && field_dst->removed) {
+          ctx->current_level = SVFRT_compatibility_logical;
+          if (ctx->current_level < ctx->required_level) {
+            ctx->error_code = SVFRT_code_compatibility__field_cannot_be_ignored;
+            return;
           }
+        };
 
-          if (!unsafe_field_src->removed && field_dst->removed) {
-            ctx->current_level = SVFRT_compatibility_logical;
-            if (ctx->current_level < ctx->required_level) {
-              ctx->error_code = SVFRT_code_compatibility__field_cannot_be_ignored;
-              return;
-            }
-          };
-
-          if (inverted_polarity_dst && unsafe_field_src->removed && !field_dst->removed) {
-            ctx->current_level = SVFRT_compatibility_logical;
-            if (ctx->current_level < ctx->required_level) {
-              ctx->error_code = SVFRT_code_compatibility__field_is_missing;
-              return;
-            }
+        if (inverted_polarity_dst && unsafe_field_src->removed && !field_dst->removed) {
+          ctx->current_level = SVFRT_compatibility_logical;
+          if (ctx->current_level < ctx->required_level) {
+            ctx->error_code = SVFRT_code_compatibility__field_is_missing;
+            return;
           }
         }
-
-        // Note: an incorrect src-schema could have multiple fields with the
-        // same ID. We will simply ignore those after the first one here.
-        //
-        // This is equivalent to having additional src-fields that do not match
-        // to anything, and should not cause any problems.
-
-        if (!unsafe_field_src->removed) {
-          *out_match = j;
-        }
-        found = true;
-        break;
       }
-    }
 
-    if (!found) {
+      if (!unsafe_field_src->removed) {
+        *out_match = j;
+      }
+    } else {
       if (!inverted_polarity_dst) {
         ctx->error_code = SVFRT_code_compatibility__field_is_missing;
         return;
@@ -510,27 +736,9 @@ void SVFRT_check_struct(
     }
   }
 
-  for (uint32_t i = 0; i < unsafe_fields_src.count; i++) {
-    SVF_Meta_FieldDefinition *unsafe_field_src = unsafe_fields_src.pointer + i;
-    bool inverted_polarity_src = (unsafe_field_src->fieldId & (1ull << 63)) != 0;
-
-    bool found = false;
-    for (uint32_t j = 0; j < fields_dst.count; j++) {
-      SVF_Meta_FieldDefinition *field_dst = fields_dst.pointer + j;
-
-      if (unsafe_field_src->fieldId == field_dst->fieldId) {
-        found = true;
-        break;
-      }
-    }
-
-    if (!found) {
-      if (inverted_polarity_src) {
-        // TODO: not covered by tests yet.
-        ctx->error_code = SVFRT_code_compatibility__field_cannot_be_ignored;
-        return;
-      }
-    }
+  if (src_field_cannot_be_ignored) {
+    ctx->error_code = SVFRT_code_compatibility__field_cannot_be_ignored;
+    return;
   }
 
   if (ctx->current_level == SVFRT_compatibility_exact) {
@@ -557,6 +765,18 @@ void SVFRT_check_struct(
     }
   }
 
+  if (ctx->current_level == SVFRT_compatibility_binary) {
+    // Elements of a sequence are read in place with the src-stride, so it must
+    // keep them aligned for the dst-struct, see #natural-alignment.
+    if (unsafe_definition_src->size % definition_dst->alignment != 0) {
+      ctx->current_level = SVFRT_compatibility_logical;
+      if (ctx->current_level < ctx->required_level) {
+        ctx->error_code = SVFRT_code_compatibility__struct_alignment_mismatch;
+        return;
+      }
+    }
+  }
+
   ctx->unsafe_struct_strides_dst.pointer[struct_index_dst] = unsafe_definition_src->size;
 }
 
@@ -629,97 +849,140 @@ void SVFRT_check_choice(
   //   - Their types be exactly compatible.
 
   // Looping over potentially adversarial data, so limit work. #compatibility-work-options
-  if (!SVFRT_check_work(ctx, 2 * unsafe_options_src.count * options_dst.count)) {
+  if (!SVFRT_check_work(ctx, SVFRT_check_matching_work(unsafe_options_src.count, options_dst.count))) {
     return;
   }
+
+  // See #compatibility-matching. The scratch memory partition is sized for the
+  // largest dst-choice, so this should not happen.
+  if (options_dst.count > ctx->member_index_capacity) {
+    ctx->error_code = SVFRT_code_compatibility_internal__member_index_overflow;
+    return;
+  }
+
+  SVFRT_MemberIndexEntry *member_index = ctx->member_index;
+  for (uint32_t i = 0; i < options_dst.count; i++) {
+    SVFRT_member_index_set(member_index + i, options_dst.pointer[i].optionId, i);
+  }
+  SVFRT_member_index_sort(member_index, options_dst.count);
+
+  // Negative-polarity src-options must have a match. This error is reported
+  // after all of the dst-options are checked.
+  bool src_option_cannot_be_ignored = false;
+
+  for (uint32_t j = 0; j < unsafe_options_src.count; j++) {
+    SVF_Meta_OptionDefinition *unsafe_option_src = unsafe_options_src.pointer + j;
+    SVFRT_MemberIndexEntry *entry = SVFRT_member_index_find(
+      member_index,
+      options_dst.count,
+      unsafe_option_src->optionId
+    );
+
+    if (!entry) {
+      bool inverted_polarity_src = (unsafe_option_src->optionId & (1ull << 63)) != 0;
+      if (inverted_polarity_src) {
+        // TODO: not covered by tests yet.
+        src_option_cannot_be_ignored = true;
+      }
+      continue;
+    }
+
+    // Note: an incorrect src-schema could have multiple options with the
+    // same ID. We will simply ignore those after the first one here.
+    //
+    // This is equivalent to having additional src-options that do not match
+    // to anything, and should not cause any problems.
+    if (entry->index_src == UINT32_MAX) {
+      entry->index_src = j;
+    }
+  }
+
+  // Option-matches table should be valid for every possible dst-option, so no
+  // range checking is required here. For now, it holds src-indices of all
+  // matches, removed or not.
+  for (uint32_t k = 0; k < options_dst.count; k++) {
+    SVFRT_MemberIndexEntry *entry = member_index + k;
+    ctx->option_matches.pointer[option_matches_index + entry->index_dst] = entry->index_src;
+  }
+
   for (uint32_t i = 0; i < options_dst.count; i++) {
     SVF_Meta_OptionDefinition *option_dst = options_dst.pointer + i;
     bool inverted_polarity_dst = (option_dst->optionId & (1ull << 63)) != 0;
 
-    // Option-matches table should be valid for every possible dst-option, so no
-    // range checking is required here.
     uint32_t *out_match = ctx->option_matches.pointer + option_matches_index + i;
     uint8_t *out_tag = ctx->option_matches_tags.pointer + option_matches_index + i;
+    uint32_t j = *out_match;
+
+    if (j != UINT32_MAX) {
+      // Only matches of present src-options are kept.
+      *out_match = UINT32_MAX;
 
-    bool found = false;
-    for (uint32_t j = 0; j < unsafe_options_src.count; j++) {
+      // Found by index, so it's in range.
       SVF_Meta_OptionDefinition *unsafe_option_src = unsafe_options_src.pointer + j;
 
-      if (unsafe_option_src->optionId == option_dst->optionId) {
-        if (!inverted_polarity_dst && !unsafe_option_src->removed && option_dst->removed) {
-          // TODO: not covered by tests yet.
-          ctx->error_code = SVFRT_code_compatibility__option_cannot_be_ignored;
-          return;
-        }
+      if (!inverted_polarity_dst && !unsafe_option_src->removed && option_dst->removed) {
+        // TODO: not covered by tests yet.
+        ctx->error_code = SVFRT_code_compatibility__option_cannot_be_ignored;
+        return;
+      }
 
-        if (inverted_polarity_dst && unsafe_option_src->removed && !option_dst->removed) {
-          ctx->error_code = SVFRT_code_compatibility__option_is_missing;
+      if (inverted_polarity_dst && unsafe_option_src->removed && !option_dst->removed) {
+        ctx->error_code = SVFRT_code_compatibility__option_is_missing;
+        return;
+      }
+
+      if (!unsafe_option_src->removed && !option_dst->removed) {
+        SVFRT_check_type(
+          ctx,
+          unsafe_option_src->type_tag,
+          &unsafe_option_src->type_payload,
+          option_dst->type_tag,
+          &option_dst->type_payload
+        );
+
+        if (ctx->error_code) {
           return;
         }
+      }
 
-        if (!unsafe_option_src->removed && !option_dst->removed) {
-          SVFRT_check_type(
-            ctx,
-            unsafe_option_src->type_tag,
-            &unsafe_option_src->type_payload,
-            option_dst->type_tag,
-            &option_dst->type_payload
-          );
+      if (ctx->current_level >= SVFRT_compatibility_binary) {
+        // Additional checks for binary compatibility, that either downgrade
+        // the current level to logical compatibility, or return an error.
 
-          if (ctx->error_code) {
+        if (unsafe_option_src->tag != option_dst->tag) {
+          ctx->current_level = SVFRT_compatibility_logical;
+          if (ctx->current_level < ctx->required_level) {
+            ctx->error_code = SVFRT_code_compatibility__option_tag_mismatch;
             return;
           }
         }
 
-        if (ctx->current_level >= SVFRT_compatibility_binary) {
-          // Additional checks for binary compatibility, that either downgrade
-          // the current level to logical compatibility, or return an error.
-
-          if (unsafe_option_src->tag != option_dst->tag) {
-            ctx->current_level = SVFRT_compatibility_logical;
-            if (ctx->current_level < ctx->required_level) {
-              ctx->error_code = SVFRT_code_compatibility__option_tag_mismatch;
-              return;
-            }
+        if (!unsafe_option_src->removed && option_dst->removed) {
+          ctx->current_level = SVFRT_compatibility_logical;
+          if (ctx->current_level < ctx->required_level) {
+            ctx->error_code = SVFRT_code_compatibility__option_cannot_be_ignored;
+            return;
           }
+        };
 
-          if (!unsafe_option_src->removed && option_dst->removed) {
-            ctx->current_level = SVFRT_compatibility_logical;
-            if (ctx->current_level < ctx->required_level) {
-              ctx->error_code = SVFRT_code_compatibility__option_cannot_be_ignored;
-              return;
-            }
-          };
-
-          if (inverted_polarity_dst && unsafe_option_src->removed && !option_dst->removed) {
-            ctx->current_level = SVFRT_compatibility_logical;
-            if (ctx->current_level < ctx->required_level) {
-              ctx->error_code = SVFRT_code_compatibility__option_is_missing;
-              return;
-            }
+        if (inverted_polarity_dst && unsafe_option_src->removed && !option_dst->removed) {
+          ctx->current_level = SVFRT_compatibility_logical;
+          if (ctx->current_level < ctx->required_level) {
+            ctx->error_code = SVFRT_code_compatibility__option_is_missing;
+            return;
           }
         }
+      }
 
-        // Note: an incorrect src-schema could have multiple options with the
-        // same ID. We will simply ignore those after the first one here.
-        //
-        // This is equivalent to having additional src-options that do not match
-        // to anything, and should not cause any problems.
-
-        if (!unsafe_option_src->removed) {
-          if (unsafe_option_src->tag == 0) {
-            ctx->error_code = SVFRT_code_compatibility__invalid_tag;
-          }
-
-          *out_tag = unsafe_option_src->tag;
-          *out_match = j;
+      if (!unsafe_option_src->removed) {
+        if (unsafe_option_src->tag == 0) {
+          ctx->error_code = SVFRT_code_compatibility__invalid_tag;
         }
-        found = true;
-        break;
-      }
-    }
 
-    if (!found) {
+        *out_tag = unsafe_option_src->tag;
+        *out_match = j;
+      }
+    } else {
       if (!inverted_polarity_dst) {
         ctx->error_code = SVFRT_code_compatibility__option_is_missing;
         return;
@@ -727,27 +990,9 @@ void SVFRT_check_choice(
     }
   }
 
-  for (uint32_t i = 0; i < unsafe_options_src.count; i++) {
-    SVF_Meta_OptionDefinition *unsafe_option_src = unsafe_options_src.pointer + i;
-    bool inverted_polarity_src = (unsafe_option_src->optionId & (1ull << 63)) != 0;
-
-    bool found = false;
-    for (uint32_t j = 0; j < options_dst.count; j++) {
-      SVF_Meta_OptionDefinition *option_dst = options_dst.pointer + j;
-
-      if (unsafe_option_src->optionId == option_dst->optionId) {
-        found = true;
-        break;
-      }
-    }
-
-    if (!found) {
-      if (inverted_polarity_src) {
-        // TODO: not covered by tests yet.
-        ctx->error_code = SVFRT_code_compatibility__option_cannot_be_ignored;
-        return;
-      }
-    }
+  if (src_option_cannot_be_ignored) {
+    ctx->error_code = SVFRT_code_compatibility__option_cannot_be_ignored;
+    return;
   }
 }
 
@@ -777,23 +1022,21 @@ void SVFRT_check_compatibility(
     out_result->error_code = SVFRT_code_compatibility__schema_too_small;
     return;
   }
-  // TODO @proper-alignment: struct access.
-  SVF_Meta_SchemaDefinition *unsafe_definition_src = (SVF_Meta_SchemaDefinition *) (
-    unsafe_schema_src.pointer
-    + unsafe_schema_src.count
-    - sizeof(SVF_Meta_SchemaDefinition)
-  );
+  SVF_Meta_SchemaDefinition *unsafe_definition_src = SVFRT_internal_schema_definition(unsafe_schema_src);
+  if (!unsafe_definition_src) {
+    out_result->error_code = SVFRT_code_compatibility__schema_not_aligned;
+    return;
+  }
 
   if (schema_dst.count < sizeof(SVF_Meta_SchemaDefinition)) {
     out_result->error_code = SVFRT_code_compatibility_internal__schema_too_small;
     return;
   }
-  // TODO @proper-alignment: struct access.
-  SVF_Meta_SchemaDefinition *definition_dst = (SVF_Meta_SchemaDefinition *) (
-    schema_dst.pointer
-    + schema_dst.count
-    - sizeof(SVF_Meta_SchemaDefinition)
-  );
+  SVF_Meta_SchemaDefinition *definition_dst = SVFRT_internal_schema_definition(schema_dst);
+  if (!definition_dst) {
+    out_result->error_code = SVFRT_code_compatibility_internal__schema_not_aligned;
+    return;
+  }
 
   // Safety: out-of-bounds access will be caught, and `.pointer` will be NULL.
   SVFRT_RangeStructDefinition unsafe_structs_src = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
@@ -840,23 +1083,32 @@ void SVFRT_check_compatibility(
     return;
   }
 
+  // The member index is shared, see #compatibility-matching.
+  uint32_t max_member_count = 0;
+
   uint32_t field_matches_count = 0;
   for (uint32_t i = 0; i < structs_dst.count; i++) {
     SVF_Meta_StructDefinition *definition_dst = structs_dst.pointer + i;
     field_matches_count += definition_dst->fields.count;
+    if (definition_dst->fields.count > max_member_count) {
+      max_member_count = definition_dst->fields.count;
+    }
   }
 
   uint32_t option_matches_count = 0;
   for (uint32_t i = 0; i < choices_dst.count; i++) {
     SVF_Meta_ChoiceDefinition *definition_dst = choices_dst.pointer + i;
     option_matches_count += definition_dst->options.count;
+    if (definition_dst->options.count > max_member_count) {
+      max_member_count = definition_dst->options.count;
+    }
   }
 
   uint32_t scratch_misalignment = ((uintptr_t) scratch_memory.pointer) % sizeof(uint32_t);
   uint32_t scratch_padding = scratch_misalignment ? sizeof(uint32_t) - scratch_misalignment : 0;
 
   // See #scratch-memory-partitions.
-  size_t partitions[10] = {
+  size_t partitions[11] = {
     sizeof(uint32_t) * definition_dst->structs.count, // Strides.
     sizeof(uint32_t) * definition_dst->structs.count, // Matches.
     sizeof(uint32_t) * definition_dst->choices.count, // Matches.
@@ -866,6 +1118,7 @@ void SVFRT_check_compatibility(
     sizeof(uint32_t) * field_matches_count, // Field-matches.
     sizeof(uint32_t) * definition_dst->choices.count, // Option-matches header.
     sizeof(uint32_t) * option_matches_count, // Option-matches.
+    sizeof(SVFRT_MemberIndexEntry) * max_member_count, // Member index.
     sizeof(uint8_t) * option_matches_count // Option-matches tags.
   };
 
@@ -881,6 +1134,7 @@ void SVFRT_check_compatibility(
     + partitions[7]
     + partitions[8]
     + partitions[9]
+    + partitions[10]
   );
   if (scratch_memory.count < total_scratch_needed) {
     out_result->error_code = SVFRT_code_compatibility__not_enough_scratch_memory;
@@ -944,6 +1198,9 @@ void SVFRT_check_compatibility(
   };
 
   partition_pointer += partitions[8];
+  SVFRT_MemberIndexEntry *member_index = (SVFRT_MemberIndexEntry *) partition_pointer;
+
+  partition_pointer += partitions[9];
   SVFRT_Bytes option_matches_tags = {
     /*.pointer =*/ (uint8_t *) partition_pointer,
     /*.count =*/ option_matches_count
@@ -1005,6 +1262,8 @@ void SVFRT_check_compatibility(
     .option_matches_header = option_matches_header,
     .option_matches_tags = option_matches_tags,
     .option_matches = option_matches,
+    .member_index = member_index,
+    .member_index_capacity = max_member_count,
     .current_level = sufficient_level,
     .required_level = required_level,
     .max_schema_work = max_schema_work,
@@ -1,14 +1,13 @@
-#ifndef SVFRT_NO_LIBC
-  #ifdef __cplusplus
-    #include <cstring>
-  #else
-    #include <string.h>
-  #endif
-  #define SVFRT_MEMSET memset
-  #define SVFRT_MEMCPY memcpy
-#else
-  #if !defined(SVFRT_MEMSET) || !defined(SVFRT_MEMCPY)
-    #error "When compiling with SVFRT_NO_LIBC, make sure to #define SVFRT_MEMCPY/SVFRT_MEMSET."
+#ifndef SVFRT_NO_SIMD
+  #if defined(__AVX2__)
+    #include <immintrin.h>
+    #define SVFRT_SIMD_AVX2
+  #elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define SVFRT_SIMD_SSE2
+  #elif defined(__ARM_NEON) && defined(__aarch64__)
+    #include <arm_neon.h>
+    #define SVFRT_SIMD_NEON
   #endif
 #endif
 
@@ -41,9 +40,8 @@
 // ease-of-use, while providing no real benefit in most cases (and huge benefit in
 // a few marginal cases, of course).
 //
-// TODO (low priority until a real use case happens): Reimplement with custom
-// stack. There probably should be a (compile-time?) switch to use one
-// implementation or the other.
+// This is now available with the compile-time switch `SVFRT_ITERATIVE_CONVERSION`,
+// see #iterative-conversion. The recursive implementation stays the default.
 
 // Note: after the conversion, the value tree will be suballocated parent-before-child,
 // i.e. the parent's suballocation bytes come before the child suballocation bytes.
@@ -65,6 +63,78 @@
 // TODO: what would break if we treated src- and dst-schemas equally here?
 // The answer to this question would make everything more clear.
 
+// See #iterative-conversion.
+#define SVFRT_FRAME_STRUCT 1
+#define SVFRT_FRAME_SEQUENCE 2
+#define SVFRT_FRAME_CHOICE 3
+#define SVFRT_FRAME_CHUNKED_SEQUENCE 4
+
+typedef struct SVFRT_ConversionFrame {
+  uint32_t kind;
+  uint32_t recursion_depth;
+  uint32_t next_index;
+  uint32_t count;
+
+  // Struct: the struct bytes. Choice: the data range with the choice in it.
+  // Sequence: unused, elements are always in `ctx->data_bytes`.
+  SVFRT_Bytes bytes_src;
+
+  // Phase 2 only. Struct: the struct bytes. Choice: the data range with the
+  // choice in it. Sequence: the suballocation.
+  SVFRT_Bytes bytes_dst;
+
+  // Sequence: offset of the elements. Chunked sequence: offset of the
+  // elements of the current chunk. Choice: offset of the payload.
+  uint32_t unsafe_offset_src;
+
+  // Choice: offset of the payload. Chunked sequence: index of the first
+  // element of the current chunk in the suballocation.
+  uint32_t offset_dst;
+
+  // Sequence and chunked sequence only.
+  uint32_t unsafe_size_src;
+  uint32_t size_dst;
+  SVF_Meta_Type_payload *unsafe_type_payload_src;
+  SVF_Meta_Type_payload *type_payload_dst;
+
+  // Chunked sequence only, see #chunked-sequences. `count` is the count of
+  // the current chunk.
+  SVFRT_ChunkIterator unsafe_chunk_iterator;
+
+  // Struct only.
+  uint32_t field_matches_index;
+  SVFRT_RangeFieldDefinition unsafe_fields_src;
+  SVFRT_RangeFieldDefinition fields_dst;
+
+  // Choice only.
+  SVF_Meta_OptionDefinition *unsafe_option_src;
+  SVF_Meta_OptionDefinition *option_dst;
+} SVFRT_ConversionFrame;
+
+// See #parallel-conversion.
+#define SVFRT_PARALLEL_MIN_ELEMENTS_PER_TASK 64
+#define SVFRT_PARALLEL_MAX_CHECKPOINTS 256
+
+typedef struct SVFRT_ConversionCheckpoint {
+  uint32_t tally_src;
+  uint32_t tally_dst;
+
+  // Only for the results of tasks.
+  SVFRT_ErrorCode error_code;
+} SVFRT_ConversionCheckpoint;
+
+// See #conversion-memoization.
+#define SVFRT_CONVERSION_MEMO_MAX_PROBES 16
+
+typedef struct SVFRT_ConversionMemoEntry {
+  uint32_t offset_src;
+  uint32_t count; // Zero for an empty slot.
+  uint32_t size_src;
+  uint32_t type_src;
+  uint32_t type_dst;
+  uint32_t offset_dst; // Phase 2 only.
+} SVFRT_ConversionMemoEntry;
+
 typedef struct SVFRT_ConversionContext {
   SVFRT_LogicalCompatibilityInfo *info;
   SVFRT_Bytes data_bytes;
@@ -85,6 +155,34 @@ typedef struct SVFRT_ConversionContext {
   // For Phase 2 only.
   SVFRT_Bytes allocation;
 
+  // Optional, see #conversion-plan.
+  SVFRT_RangeU32 plan;
+
+  // See #single-pass-conversion. Phase 1 is skipped, and Phase 2 tallies
+  // against `total_data_size_limit_dst` instead of an exact allocation.
+  bool single_pass;
+
+  // Optional, see #iterative-conversion. Caller-supplied memory.
+  SVFRT_ConversionFrame *frames;
+  uint32_t frame_capacity;
+  uint32_t frame_count;
+
+  // Optional, see #parallel-conversion. Phase 1 records the checkpoints, and
+  // Phase 2 consumes them in the same order. Caller-supplied memory.
+  SVFRT_SpawnTasksFn *spawn_fn;
+  void *spawn_ptr;
+  uint32_t task_count;
+  bool in_split;
+  SVFRT_ConversionCheckpoint *checkpoints;
+  uint32_t checkpoint_count;
+  uint32_t checkpoint_index;
+  SVFRT_ConversionCheckpoint *task_results;
+
+  // Optional, see #conversion-memoization. Caller-supplied memory, cleared
+  // before each phase. Capacity is a power of two.
+  SVFRT_ConversionMemoEntry *memo;
+  uint32_t memo_capacity;
+
   SVFRT_ErrorCode error_code;
 } SVFRT_ConversionContext;
 
@@ -140,6 +238,24 @@ uint32_t SVFRT_conversion_get_type_size(
   }
 }
 
+// Returns 0 on an error.
+uint32_t SVFRT_conversion_get_type_alignment(
+  SVFRT_RangeStructDefinition structs,
+  SVF_Meta_ConcreteType_tag type_tag,
+  SVF_Meta_ConcreteType_payload *type_payload
+) {
+  if (type_tag == SVF_Meta_ConcreteType_tag_definedStruct) {
+    uint32_t index = type_payload->definedStruct.index;
+    if (index >= structs.count) {
+      return 0;
+    }
+    return structs.pointer[index].alignment;
+  }
+
+  // Primitives are aligned to their size.
+  return SVFRT_conversion_get_type_size(structs, type_tag, type_payload);
+}
+
 static inline
 uint8_t SVFRT_conversion_read_uint8_t (
   SVFRT_ConversionContext *ctx,
@@ -155,7 +271,7 @@ uint8_t SVFRT_conversion_read_uint8_t (
 }
 
 static inline
-uint8_t SVFRT_conversion_read_int8_t (
+int8_t SVFRT_conversion_read_int8_t (
   SVFRT_ConversionContext *ctx,
   SVFRT_Bytes range_src,
   uint32_t unsafe_offset_src
@@ -238,6 +354,365 @@ void SVFRT_conversion_copy_exact(
   SVFRT_MEMCPY(pointer_dst, pointer_src, size);
 }
 
+// All primitive conversions, that are not exact copies. Must be in sync with
+// `SVFRT_conversion_traverse_concrete_type`.
+//
+// The last column tells the kernels below how to widen a value.
+#define SVFRT_CONVERSION_WIDENINGS(X) \
+  X(1, u8, uint8_t, u16, uint16_t, ZERO) \
+  X(2, u8, uint8_t, u32, uint32_t, ZERO) \
+  X(3, u8, uint8_t, u64, uint64_t, ZERO) \
+  X(4, u16, uint16_t, u32, uint32_t, ZERO) \
+  X(5, u16, uint16_t, u64, uint64_t, ZERO) \
+  X(6, u32, uint32_t, u64, uint64_t, ZERO) \
+  X(7, i8, int8_t, i16, int16_t, SIGN) \
+  X(8, i8, int8_t, i32, int32_t, SIGN) \
+  X(9, i8, int8_t, i64, int64_t, SIGN) \
+  X(10, i16, int16_t, i32, int32_t, SIGN) \
+  X(11, i16, int16_t, i64, int64_t, SIGN) \
+  X(12, i32, int32_t, i64, int64_t, SIGN) \
+  X(13, u8, uint8_t, i16, int16_t, ZERO) \
+  X(14, u8, uint8_t, i32, int32_t, ZERO) \
+  X(15, u8, uint8_t, i64, int64_t, ZERO) \
+  X(16, u16, uint16_t, i32, int32_t, ZERO) \
+  X(17, u16, uint16_t, i64, int64_t, ZERO) \
+  X(18, u32, uint32_t, i64, int64_t, ZERO) \
+  X(19, f32, float, f64, double, FLOAT)
+
+#define SVFRT_WIDEN_KIND_ZERO 0  // Zero-extend an integer.
+#define SVFRT_WIDEN_KIND_SIGN 1  // Sign-extend an integer.
+#define SVFRT_WIDEN_KIND_FLOAT 2 // Convert `float` to `double`.
+
+// Returns 0 if there is no such widening.
+static inline
+uint32_t SVFRT_conversion_get_widening(
+  SVF_Meta_ConcreteType_tag unsafe_type_tag_src,
+  SVF_Meta_ConcreteType_tag type_tag_dst
+) {
+  #define SVFRT_X(number, name_src, type_src, name_dst, type_dst, kind) \
+    if ( \
+      unsafe_type_tag_src == SVF_Meta_ConcreteType_tag_##name_src && \
+      type_tag_dst == SVF_Meta_ConcreteType_tag_##name_dst \
+    ) return number;
+  SVFRT_CONVERSION_WIDENINGS(SVFRT_X)
+  #undef SVFRT_X
+  return 0;
+}
+
+// Returns false for an unknown widening.
+static inline
+bool SVFRT_conversion_get_widening_info(
+  uint32_t widening,
+  uint32_t *out_size_src,
+  uint32_t *out_size_dst,
+  uint32_t *out_kind
+) {
+  switch (widening) {
+    #define SVFRT_X(number, name_src, type_src, name_dst, type_dst, kind) \
+      case number: { \
+        *out_size_src = sizeof(type_src); \
+        *out_size_dst = sizeof(type_dst); \
+        *out_kind = SVFRT_WIDEN_KIND_##kind; \
+        return true; \
+      }
+    SVFRT_CONVERSION_WIDENINGS(SVFRT_X)
+    #undef SVFRT_X
+    default: {
+      return false;
+    }
+  }
+}
+
+// Vectorized widening kernels. They only handle whole vectors, and return the
+// number of values converted, the rest is done by the scalar loop in
+// `SVFRT_conversion_widen`. Pointers may be misaligned.
+//
+// The instruction set is chosen at compile time. Define `SVFRT_NO_SIMD` to
+// only use the scalar loop.
+
+#if defined(SVFRT_SIMD_AVX2)
+
+static
+uint32_t SVFRT_conversion_widen_simd(
+  uint8_t *pointer_dst,
+  uint8_t const *pointer_src,
+  uint32_t count,
+  uint32_t size_src,
+  uint32_t size_dst,
+  uint32_t kind
+) {
+  uint32_t i = 0;
+
+  if (kind == SVFRT_WIDEN_KIND_FLOAT) {
+    for (; i + 4 <= count; i += 4) {
+      __m128 x = _mm_loadu_ps((float const *) (pointer_src + i * 4));
+      _mm256_storeu_pd((double *) (pointer_dst + i * 8), _mm256_cvtps_pd(x));
+    }
+    return i;
+  }
+
+  // Each step produces one 256-bit vector of dst-values.
+  uint32_t step = 32 / size_dst;
+  uint32_t step_bytes_src = step * size_src;
+  bool is_signed = kind == SVFRT_WIDEN_KIND_SIGN;
+
+  for (; i + step <= count; i += step) {
+    uint8_t const *src = pointer_src + i * size_src;
+
+    __m128i x;
+    if (step_bytes_src == 16) {
+      x = _mm_loadu_si128((__m128i const *) src);
+    } else if (step_bytes_src == 8) {
+      x = _mm_loadl_epi64((__m128i const *) src);
+    } else {
+      int32_t low = 0;
+      SVFRT_MEMCPY(&low, src, sizeof(low));
+      x = _mm_cvtsi32_si128(low);
+    }
+
+    __m256i y;
+    switch (size_src * 16 + size_dst) {
+      case 0x12: y = is_signed ? _mm256_cvtepi8_epi16(x) : _mm256_cvtepu8_epi16(x); break;
+      case 0x14: y = is_signed ? _mm256_cvtepi8_epi32(x) : _mm256_cvtepu8_epi32(x); break;
+      case 0x18: y = is_signed ? _mm256_cvtepi8_epi64(x) : _mm256_cvtepu8_epi64(x); break;
+      case 0x24: y = is_signed ? _mm256_cvtepi16_epi32(x) : _mm256_cvtepu16_epi32(x); break;
+      case 0x28: y = is_signed ? _mm256_cvtepi16_epi64(x) : _mm256_cvtepu16_epi64(x); break;
+      case 0x48: y = is_signed ? _mm256_cvtepi32_epi64(x) : _mm256_cvtepu32_epi64(x); break;
+      default: return i;
+    }
+
+    _mm256_storeu_si256((__m256i *) (pointer_dst + i * size_dst), y);
+  }
+
+  return i;
+}
+
+#elif defined(SVFRT_SIMD_SSE2)
+
+// Widen each lane of `x` to double its size, producing two vectors.
+static inline
+void SVFRT_conversion_widen_step_sse2(
+  __m128i x,
+  uint32_t lane_size,
+  bool is_signed,
+  __m128i *out_low,
+  __m128i *out_high
+) {
+  // SSE2 has no sign-extension, so interleave with a vector of sign bits.
+  __m128i zero = _mm_setzero_si128();
+  switch (lane_size) {
+    case 1: {
+      __m128i extension = is_signed ? _mm_cmpgt_epi8(zero, x) : zero;
+      *out_low = _mm_unpacklo_epi8(x, extension);
+      *out_high = _mm_unpackhi_epi8(x, extension);
+      return;
+    }
+    case 2: {
+      __m128i extension = is_signed ? _mm_cmpgt_epi16(zero, x) : zero;
+      *out_low = _mm_unpacklo_epi16(x, extension);
+      *out_high = _mm_unpackhi_epi16(x, extension);
+      return;
+    }
+    default: {
+      __m128i extension = is_signed ? _mm_srai_epi32(x, 31) : zero;
+      *out_low = _mm_unpacklo_epi32(x, extension);
+      *out_high = _mm_unpackhi_epi32(x, extension);
+      return;
+    }
+  }
+}
+
+static
+uint32_t SVFRT_conversion_widen_simd(
+  uint8_t *pointer_dst,
+  uint8_t const *pointer_src,
+  uint32_t count,
+  uint32_t size_src,
+  uint32_t size_dst,
+  uint32_t kind
+) {
+  uint32_t i = 0;
+
+  if (kind == SVFRT_WIDEN_KIND_FLOAT) {
+    for (; i + 4 <= count; i += 4) {
+      __m128 x = _mm_loadu_ps((float const *) (pointer_src + i * 4));
+      _mm_storeu_pd((double *) (pointer_dst + i * 8), _mm_cvtps_pd(x));
+      _mm_storeu_pd((double *) (pointer_dst + i * 8 + 16), _mm_cvtps_pd(_mm_movehl_ps(x, x)));
+    }
+    return i;
+  }
+
+  // Each step consumes one 128-bit vector of src-values, and widens it
+  // repeatedly, into up to 8 vectors of dst-values.
+  uint32_t step = 16 / size_src;
+  bool is_signed = kind == SVFRT_WIDEN_KIND_SIGN;
+
+  for (; i + step <= count; i += step) {
+    __m128i parts[8];
+    uint32_t part_count = 1;
+    parts[0] = _mm_loadu_si128((__m128i const *) (pointer_src + i * size_src));
+
+    for (uint32_t lane_size = size_src; lane_size < size_dst; lane_size *= 2) {
+      // Backwards, so that each part is read before it is overwritten.
+      for (uint32_t j = part_count; j > 0; j--) {
+        __m128i x = parts[j - 1];
+        SVFRT_conversion_widen_step_sse2(x, lane_size, is_signed, &parts[2 * (j - 1)], &parts[2 * (j - 1) + 1]);
+      }
+      part_count *= 2;
+    }
+
+    for (uint32_t j = 0; j < part_count; j++) {
+      _mm_storeu_si128((__m128i *) (pointer_dst + i * size_dst + j * 16), parts[j]);
+    }
+  }
+
+  return i;
+}
+
+#elif defined(SVFRT_SIMD_NEON)
+
+// Widen each lane of `x` to double its size, producing two vectors.
+static inline
+void SVFRT_conversion_widen_step_neon(
+  uint8x16_t x,
+  uint32_t lane_size,
+  bool is_signed,
+  uint8x16_t *out_low,
+  uint8x16_t *out_high
+) {
+  switch (lane_size) {
+    case 1: {
+      if (is_signed) {
+        *out_low = vreinterpretq_u8_s16(vmovl_s8(vget_low_s8(vreinterpretq_s8_u8(x))));
+        *out_high = vreinterpretq_u8_s16(vmovl_high_s8(vreinterpretq_s8_u8(x)));
+      } else {
+        *out_low = vreinterpretq_u8_u16(vmovl_u8(vget_low_u8(x)));
+        *out_high = vreinterpretq_u8_u16(vmovl_high_u8(x));
+      }
+      return;
+    }
+    case 2: {
+      if (is_signed) {
+        *out_low = vreinterpretq_u8_s32(vmovl_s16(vget_low_s16(vreinterpretq_s16_u8(x))));
+        *out_high = vreinterpretq_u8_s32(vmovl_high_s16(vreinterpretq_s16_u8(x)));
+      } else {
+        *out_low = vreinterpretq_u8_u32(vmovl_u16(vget_low_u16(vreinterpretq_u16_u8(x))));
+        *out_high = vreinterpretq_u8_u32(vmovl_high_u16(vreinterpretq_u16_u8(x)));
+      }
+      return;
+    }
+    default: {
+      if (is_signed) {
+        *out_low = vreinterpretq_u8_s64(vmovl_s32(vget_low_s32(vreinterpretq_s32_u8(x))));
+        *out_high = vreinterpretq_u8_s64(vmovl_high_s32(vreinterpretq_s32_u8(x)));
+      } else {
+        *out_low = vreinterpretq_u8_u64(vmovl_u32(vget_low_u32(vreinterpretq_u32_u8(x))));
+        *out_high = vreinterpretq_u8_u64(vmovl_high_u32(vreinterpretq_u32_u8(x)));
+      }
+      return;
+    }
+  }
+}
+
+static
+uint32_t SVFRT_conversion_widen_simd(
+  uint8_t *pointer_dst,
+  uint8_t const *pointer_src,
+  uint32_t count,
+  uint32_t size_src,
+  uint32_t size_dst,
+  uint32_t kind
+) {
+  uint32_t i = 0;
+
+  if (kind == SVFRT_WIDEN_KIND_FLOAT) {
+    for (; i + 4 <= count; i += 4) {
+      float32x4_t x = vreinterpretq_f32_u8(vld1q_u8(pointer_src + i * 4));
+      vst1q_u8(pointer_dst + i * 8, vreinterpretq_u8_f64(vcvt_f64_f32(vget_low_f32(x))));
+      vst1q_u8(pointer_dst + i * 8 + 16, vreinterpretq_u8_f64(vcvt_high_f64_f32(x)));
+    }
+    return i;
+  }
+
+  // Same approach as the SSE2 kernel.
+  uint32_t step = 16 / size_src;
+  bool is_signed = kind == SVFRT_WIDEN_KIND_SIGN;
+
+  for (; i + step <= count; i += step) {
+    uint8x16_t parts[8];
+    uint32_t part_count = 1;
+    parts[0] = vld1q_u8(pointer_src + i * size_src);
+
+    for (uint32_t lane_size = size_src; lane_size < size_dst; lane_size *= 2) {
+      // Backwards, so that each part is read before it is overwritten.
+      for (uint32_t j = part_count; j > 0; j--) {
+        uint8x16_t x = parts[j - 1];
+        SVFRT_conversion_widen_step_neon(x, lane_size, is_signed, &parts[2 * (j - 1)], &parts[2 * (j - 1) + 1]);
+      }
+      part_count *= 2;
+    }
+
+    for (uint32_t j = 0; j < part_count; j++) {
+      vst1q_u8(pointer_dst + i * size_dst + j * 16, parts[j]);
+    }
+  }
+
+  return i;
+}
+
+#else
+
+static
+uint32_t SVFRT_conversion_widen_simd(
+  uint8_t *pointer_dst,
+  uint8_t const *pointer_src,
+  uint32_t count,
+  uint32_t size_src,
+  uint32_t size_dst,
+  uint32_t kind
+) {
+  (void) pointer_dst;
+  (void) pointer_src;
+  (void) count;
+  (void) size_src;
+  (void) size_dst;
+  (void) kind;
+  return 0;
+}
+
+#endif
+
+// Widen `count` values. Pointers may be misaligned. The widening must be valid.
+static inline
+void SVFRT_conversion_widen(uint32_t widening, uint8_t *pointer_dst, uint8_t const *pointer_src, uint32_t count) {
+  uint32_t size_src = 0;
+  uint32_t size_dst = 0;
+  uint32_t kind = 0;
+  if (!SVFRT_conversion_get_widening_info(widening, &size_src, &size_dst, &kind)) {
+    return;
+  }
+
+  uint32_t start = SVFRT_conversion_widen_simd(pointer_dst, pointer_src, count, size_src, size_dst, kind);
+
+  switch (widening) {
+    #define SVFRT_X(number, name_src, type_src, name_dst, type_dst, kind) \
+      case number: { \
+        for (uint32_t i = start; i < count; i++) { \
+          type_src value_src; \
+          SVFRT_MEMCPY(&value_src, pointer_src + i * sizeof(type_src), sizeof(type_src)); \
+          type_dst value_dst = (type_dst) value_src; \
+          SVFRT_MEMCPY(pointer_dst + i * sizeof(type_dst), &value_dst, sizeof(type_dst)); \
+        } \
+        return; \
+      }
+    SVFRT_CONVERSION_WIDENINGS(SVFRT_X)
+    #undef SVFRT_X
+    default: {
+      return;
+    }
+  }
+}
+
 void SVFRT_conversion_tally(
   SVFRT_ConversionContext *ctx,
   uint32_t unsafe_size_src,
@@ -247,8 +722,14 @@ void SVFRT_conversion_tally(
 ) {
   // Prevent multiply-add overflow by casting operands to `uint64_t` first. It
   // works, because `UINT64_MAX == UINT32_MAX * UINT32_MAX + UINT32_MAX + UINT32_MAX`.
+  //
+  // The dst-suballocation is padded to its #natural-alignment, same as the
+  // writer does, so converted data can be read in place with aligned loads.
+  uint32_t alignment_dst = SVFRT_natural_alignment(size_dst);
+  uint32_t padding_dst = unsafe_count == 0 ? 0 : (alignment_dst - ctx->tally_dst % alignment_dst) % alignment_dst;
+  uint64_t start_dst = (uint64_t) ctx->tally_dst + (uint64_t) padding_dst;
   uint64_t sum_src = (uint64_t) ctx->tally_src + (uint64_t) unsafe_size_src * (uint64_t) unsafe_count;
-  uint64_t sum_dst = (uint64_t) ctx->tally_dst + (uint64_t) size_dst * (uint64_t) unsafe_count;
+  uint64_t sum_dst = start_dst + (uint64_t) size_dst * (uint64_t) unsafe_count;
 
   if (sum_src > (uint64_t) ctx->data_bytes.count) {
     ctx->error_code = SVFRT_code_conversion__data_aliasing_detected;
@@ -261,15 +742,28 @@ void SVFRT_conversion_tally(
     //
     // #phase2-reasonable-dst-sum: after this value is checked, `size_dst * unsafe_count`
     // is also proven not to overflow `uint32_t`.
+    //
+    // For #single-pass-conversion, the allocation is an upper bound, and the
+    // limit is within it, so this holds as well.
+    if (ctx->single_pass && sum_dst > (uint64_t) ctx->total_data_size_limit_dst) {
+      ctx->error_code = SVFRT_code_conversion__total_data_size_limit_exceeded;
+      ctx->tally_dst = UINT32_MAX;
+      return;
+    }
+
     if (sum_dst > (uint64_t) ctx->allocation.count) {
       ctx->error_code = SVFRT_code_conversion_internal__suballocation_mismatch;
       ctx->tally_dst = UINT32_MAX;
       return;
     }
 
+    // Padding is never written to otherwise, so zero it here, to not leak
+    // whatever was in the allocation before.
+    SVFRT_MEMSET(ctx->allocation.pointer + ctx->tally_dst, 0, padding_dst);
+
     // No risk of overflow, see #phase2-reasonable-dst-sum.
     phase2_out_suballocation->count = size_dst * unsafe_count;
-    phase2_out_suballocation->pointer = ctx->allocation.pointer + ctx->tally_dst;
+    phase2_out_suballocation->pointer = ctx->allocation.pointer + start_dst;
   } else {
     // Phase 1, we don't have the exact allocation count yet here.
 
@@ -285,6 +779,157 @@ void SVFRT_conversion_tally(
   ctx->tally_dst = (uint32_t) sum_dst;
 }
 
+// Phase 2 only: point the dst-representation of a reference or sequence at its
+// suballocation. Offsets are relative to the allocation, which becomes the data
+// range of the converted message.
+static inline
+void SVFRT_conversion_write_representation(
+  SVFRT_ConversionContext *ctx,
+  SVFRT_Bytes range_dst,
+  uint64_t offset_dst,
+  SVFRT_Bytes suballocation,
+  uint32_t count,
+  bool is_sequence
+) {
+  uint32_t size = is_sequence ? sizeof(SVFRT_Sequence) : sizeof(SVFRT_Reference);
+  if (offset_dst + (uint64_t) size > (uint64_t) range_dst.count) {
+    ctx->error_code = SVFRT_code_conversion_internal__suballocation_out_of_bounds;
+    return;
+  }
+
+  // Suballocations are always within the allocation, see `SVFRT_conversion_tally`.
+  SVFRT_Sequence representation = {
+    /*.data_offset_complement =*/ ~((uint32_t) (suballocation.pointer - ctx->allocation.pointer)),
+    /*.count =*/ count
+  };
+
+  // Untrusted src-data may be misaligned, hence `SVFRT_MEMCPY`. See #natural-alignment.
+  SVFRT_MEMCPY(range_dst.pointer + offset_dst, &representation, size);
+}
+
+// #conversion-memoization.
+//
+// A message may have several handles to the same range (e.g. written with
+// #write-interning), which is normally rejected with
+// `SVFRT_code_conversion__data_aliasing_detected`. With memo memory, each
+// distinct range is converted only once, and all of its dst-handles point to
+// the same suballocation, so the output is shared the same way as the input.
+// Ranges are only the same, if they have the same offset, count and types, so
+// partially overlapping ones are still tallied separately, and rejected.
+//
+// Repeated handles are not tallied, so the work is still bounded by the data
+// size: each distinct range is tallied once, and each repeat only costs the
+// handle itself, which lives in a distinct range as well.
+//
+// Both phases must make the same decisions, so the table is cleared before
+// each of them, and nothing is ever evicted. When there is no room, ranges are
+// not remembered, and repeats of them are tallied (and rejected) as usual.
+//
+// Memoization is only done for references and sequences. Chunked sequences
+// are always tallied.
+
+static inline
+void SVFRT_conversion_memo_clear(SVFRT_ConversionContext *ctx) {
+  if (ctx->memo) {
+    SVFRT_MEMSET(ctx->memo, 0, ctx->memo_capacity * sizeof(SVFRT_ConversionMemoEntry));
+  }
+}
+
+// Type of a reference or sequence element, for the memo key.
+static inline
+uint32_t SVFRT_conversion_memo_type(
+  SVF_Meta_ConcreteType_tag type_tag,
+  SVF_Meta_ConcreteType_payload *type_payload
+) {
+  if (type_tag == SVF_Meta_ConcreteType_tag_definedStruct) {
+    return 0x80000000u | type_payload->definedStruct.index;
+  }
+  return (uint32_t) type_tag;
+}
+
+// Look `key` up. Returns the matching entry and sets `*out_found`, or returns
+// the empty slot for it, which the caller fills after the range is tallied.
+// Returns NULL, if there is no memo, or no room.
+static inline
+SVFRT_ConversionMemoEntry *SVFRT_conversion_memo_find(
+  SVFRT_ConversionContext *ctx,
+  SVFRT_ConversionMemoEntry const *key,
+  bool *out_found
+) {
+  *out_found = false;
+  if (!ctx->memo || key->count == 0) {
+    return NULL;
+  }
+
+  uint64_t hash = (
+    (((uint64_t) key->offset_src << 32) | key->count) * 0x9E3779B97F4A7C15ull ^
+    (((uint64_t) key->type_src << 32) | key->type_dst) * 0xC2B2AE3D27D4EB4Full ^
+    (uint64_t) key->size_src
+  );
+  uint32_t mask = ctx->memo_capacity - 1;
+  uint32_t home = (uint32_t) (hash >> 32) & mask;
+
+  for (uint32_t i = 0; i < SVFRT_CONVERSION_MEMO_MAX_PROBES && i < ctx->memo_capacity; i++) {
+    SVFRT_ConversionMemoEntry *entry = ctx->memo + ((home + i) & mask);
+    if (entry->count == 0) {
+      return entry;
+    }
+    if (
+      entry->offset_src == key->offset_src &&
+      entry->count == key->count &&
+      entry->size_src == key->size_src &&
+      entry->type_src == key->type_src &&
+      entry->type_dst == key->type_dst
+    ) {
+      *out_found = true;
+      return entry;
+    }
+  }
+  return NULL;
+}
+
+// Phase 2 only: point the dst-representation at the suballocation of a range
+// that was converted before.
+static inline
+void SVFRT_conversion_memo_reuse(
+  SVFRT_ConversionContext *ctx,
+  SVFRT_Bytes range_dst,
+  uint64_t offset_dst,
+  SVFRT_ConversionMemoEntry const *entry,
+  bool is_sequence
+) {
+  SVFRT_Bytes suballocation = {
+    /*.pointer =*/ ctx->allocation.pointer + entry->offset_dst,
+    /*.count =*/ 0,
+  };
+  SVFRT_conversion_write_representation(
+    ctx,
+    range_dst,
+    offset_dst,
+    suballocation,
+    entry->count,
+    is_sequence
+  );
+}
+
+// Remember a range after it was tallied.
+static inline
+void SVFRT_conversion_memo_insert(
+  SVFRT_ConversionContext *ctx,
+  SVFRT_ConversionMemoEntry *slot,
+  SVFRT_ConversionMemoEntry const *key,
+  SVFRT_Bytes *phase2_suballocation
+) {
+  if (!slot) {
+    return;
+  }
+  *slot = *key;
+  if (phase2_suballocation) {
+    // Suballocations are always within the allocation, see `SVFRT_conversion_tally`.
+    slot->offset_dst = (uint32_t) (phase2_suballocation->pointer - ctx->allocation.pointer);
+  }
+}
+
 typedef struct SVFRT_Phase2_TraverseAnyType {
   SVFRT_Bytes data_range_dst;
   uint32_t data_offset_dst;
@@ -309,29 +954,34 @@ typedef struct SVFRT_Phase2_TraverseStruct {
   SVFRT_Bytes struct_bytes_dst;
 } SVFRT_Phase2_TraverseStruct;
 
-void SVFRT_conversion_traverse_struct(
+// Look up everything needed to go over the fields of a struct. Shared between
+// the recursive and the #iterative-conversion traversals.
+//
+// Returns false on an error.
+static inline
+bool SVFRT_conversion_prepare_struct(
   SVFRT_ConversionContext *ctx,
-  uint32_t recursion_depth,
   uint32_t unsafe_struct_index_src,
   uint32_t struct_index_dst,
-  SVFRT_Bytes struct_bytes_src,
-  SVFRT_Phase2_TraverseStruct *phase2
+  SVFRT_RangeFieldDefinition *out_unsafe_fields_src,
+  SVFRT_RangeFieldDefinition *out_fields_dst,
+  uint32_t *out_field_matches_index
 ) {
   if (unsafe_struct_index_src >= ctx->unsafe_structs_src.count) {
     ctx->error_code = SVFRT_code_conversion__bad_schema_struct_index;
-    return;
+    return false;
   }
   SVF_Meta_StructDefinition *unsafe_definition_src = ctx->unsafe_structs_src.pointer + unsafe_struct_index_src;
 
   if (struct_index_dst >= ctx->structs_dst.count) {
     ctx->error_code = SVFRT_code_conversion_internal__bad_schema_struct_index;
-    return;
+    return false;
   }
   SVF_Meta_StructDefinition *definition_dst = ctx->structs_dst.pointer + struct_index_dst;
 
   // Field-matches header should have valid indices for every dst-struct, so no
   // range checking is required here.
-  uint32_t field_matches_index = ctx->info->field_matches_header.pointer[struct_index_dst];
+  *out_field_matches_index = ctx->info->field_matches_header.pointer[struct_index_dst];
 
   SVFRT_RangeFieldDefinition unsafe_fields_src = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
     ctx->info->unsafe_schema_src,
@@ -340,7 +990,7 @@ void SVFRT_conversion_traverse_struct(
   );
   if (!unsafe_fields_src.pointer && unsafe_fields_src.count) {
     ctx->error_code = SVFRT_code_conversion__bad_schema_field_index;
-    return;
+    return false;
   }
 
   SVFRT_RangeFieldDefinition fields_dst = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
@@ -350,39 +1000,96 @@ void SVFRT_conversion_traverse_struct(
   );
   if (!fields_dst.pointer && fields_dst.count) {
     ctx->error_code = SVFRT_code_conversion_internal__bad_schema_field_index;
-    return;
+    return false;
   }
 
-  // Go over all fields. We have a precomputed table of src-indices available to
-  // us here.
-  for (uint32_t i = 0; i < fields_dst.count; i++) {
-    SVF_Meta_FieldDefinition *field_dst = fields_dst.pointer + i;
+  *out_unsafe_fields_src = unsafe_fields_src;
+  *out_fields_dst = fields_dst;
+  return true;
+}
 
-    if (field_dst->removed) {
-      continue;
-    }
+// Find the src-field for the `i`-th dst-field. We have a precomputed table of
+// src-indices available to us here.
+//
+// Returns NULL, if there is nothing to convert, or on an error.
+static inline
+SVF_Meta_FieldDefinition *SVFRT_conversion_match_field(
+  SVFRT_ConversionContext *ctx,
+  SVFRT_RangeFieldDefinition unsafe_fields_src,
+  SVFRT_RangeFieldDefinition fields_dst,
+  uint32_t field_matches_index,
+  uint32_t i
+) {
+  SVF_Meta_FieldDefinition *field_dst = fields_dst.pointer + i;
 
-    // Field-matches table should be valid for every possible dst-field, so no
-    // range checking is required here.
-    uint32_t j = ctx->info->field_matches.pointer[field_matches_index + i];
+  if (field_dst->removed) {
+    return NULL;
+  }
 
-    if (j == UINT32_MAX) {
-      // Field was missing, and we are allowed to zero-initialize it. Before
-      // Phase 2, all data is already zero-initialized, so nothing needs to be
-      // done here.
-      continue;
-    }
+  // Field-matches table should be valid for every possible dst-field, so no
+  // range checking is required here.
+  uint32_t j = ctx->info->field_matches.pointer[field_matches_index + i];
 
-    if (j >= unsafe_fields_src.count) {
-      ctx->error_code = SVFRT_code_conversion_internal__schema_field_missing;
-      return;
-    }
+  if (j == UINT32_MAX) {
+    // Field was missing, and we are allowed to zero-initialize it. Before
+    // Phase 2, all data is already zero-initialized, so nothing needs to be
+    // done here.
+    return NULL;
+  }
 
-    SVF_Meta_FieldDefinition *unsafe_field_src = unsafe_fields_src.pointer + j;
+  if (j >= unsafe_fields_src.count) {
+    ctx->error_code = SVFRT_code_conversion_internal__schema_field_missing;
+    return NULL;
+  }
 
-    if (unsafe_field_src->fieldId != field_dst->fieldId) {
-      ctx->error_code = SVFRT_code_conversion_internal__schema_field_missing;
-      return;
+  SVF_Meta_FieldDefinition *unsafe_field_src = unsafe_fields_src.pointer + j;
+
+  if (unsafe_field_src->fieldId != field_dst->fieldId) {
+    ctx->error_code = SVFRT_code_conversion_internal__schema_field_missing;
+    return NULL;
+  }
+
+  return unsafe_field_src;
+}
+
+void SVFRT_conversion_traverse_struct(
+  SVFRT_ConversionContext *ctx,
+  uint32_t recursion_depth,
+  uint32_t unsafe_struct_index_src,
+  uint32_t struct_index_dst,
+  SVFRT_Bytes struct_bytes_src,
+  SVFRT_Phase2_TraverseStruct *phase2
+) {
+  SVFRT_RangeFieldDefinition unsafe_fields_src;
+  SVFRT_RangeFieldDefinition fields_dst;
+  uint32_t field_matches_index;
+  if (!SVFRT_conversion_prepare_struct(
+    ctx,
+    unsafe_struct_index_src,
+    struct_index_dst,
+    &unsafe_fields_src,
+    &fields_dst,
+    &field_matches_index
+  )) {
+    return;
+  }
+
+  // Go over all fields.
+  for (uint32_t i = 0; i < fields_dst.count; i++) {
+    SVF_Meta_FieldDefinition *field_dst = fields_dst.pointer + i;
+    SVF_Meta_FieldDefinition *unsafe_field_src = SVFRT_conversion_match_field(
+      ctx,
+      unsafe_fields_src,
+      fields_dst,
+      field_matches_index,
+      i
+    );
+
+    if (!unsafe_field_src) {
+      if (ctx->error_code) {
+        return;
+      }
+      continue;
     }
 
     SVFRT_Phase2_TraverseAnyType phase2_inner = {0};
@@ -415,19 +1122,25 @@ typedef struct SVFRT_Phase2_TraverseConcreteType {
   uint32_t data_offset_dst;
 } SVFRT_Phase2_TraverseConcreteType;
 
-void SVFRT_conversion_traverse_choice(
+// Find the pair of options to convert, and in Phase 2, write the dst-tag.
+// Shared between the recursive and the #iterative-conversion traversals.
+//
+// Returns false, if there is no payload to convert, or on an error.
+static inline
+bool SVFRT_conversion_resolve_choice(
   SVFRT_ConversionContext *ctx,
-  uint32_t recursion_depth,
   uint32_t unsafe_choice_index_src,
   uint32_t choice_index_dst,
   SVFRT_Bytes data_range_src,
   uint32_t unsafe_data_offset_src,
-  SVFRT_Phase2_TraverseConcreteType *phase2
+  SVFRT_Phase2_TraverseConcreteType *phase2,
+  SVF_Meta_OptionDefinition **out_unsafe_option_src,
+  SVF_Meta_OptionDefinition **out_option_dst
 ) {
   // Prevent addition overflow by casting operands to `uint64_t` first.
   if ((uint64_t) unsafe_data_offset_src + (uint64_t) SVFRT_TAG_SIZE > (uint64_t) data_range_src.count) {
     ctx->error_code = SVFRT_code_conversion__data_out_of_bounds;
-    return;
+    return false;
   }
 
   SVFRT_Bytes choice_tag_bytes_src = {
@@ -439,19 +1152,19 @@ void SVFRT_conversion_traverse_choice(
 
   if (unsafe_choice_index_src >= ctx->unsafe_choices_src.count) {
     ctx->error_code = SVFRT_code_conversion__bad_schema_choice_index;
-    return;
+    return false;
   }
   SVF_Meta_ChoiceDefinition *unsafe_definition_src = ctx->unsafe_choices_src.pointer + unsafe_choice_index_src;
 
   if (choice_index_dst >= ctx->choices_dst.count) {
     ctx->error_code = SVFRT_code_conversion_internal__bad_schema_choice_index;
-    return;
+    return false;
   }
   SVF_Meta_ChoiceDefinition *definition_dst = ctx->choices_dst.pointer + choice_index_dst;
 
   // Option-matches header should have valid indices for every dst-choice, so
   // no range checking is required here.
-  uint32_t option_matches_index = ctx->info->field_matches_header.pointer[choice_index_dst];
+  uint32_t option_matches_index = ctx->info->option_matches_header.pointer[choice_index_dst];
 
   SVFRT_RangeOptionDefinition unsafe_options_src = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
     ctx->info->unsafe_schema_src,
@@ -460,7 +1173,7 @@ void SVFRT_conversion_traverse_choice(
   );
   if (!unsafe_options_src.pointer && unsafe_options_src.count) {
     ctx->error_code = SVFRT_code_conversion__bad_schema_options;
-    return;
+    return false;
   }
 
   SVFRT_RangeOptionDefinition options_dst = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
@@ -470,7 +1183,7 @@ void SVFRT_conversion_traverse_choice(
   );
   if (!options_dst.pointer && options_dst.count) {
     ctx->error_code = SVFRT_code_conversion_internal__bad_schema_options;
-    return;
+    return false;
   }
 
   uint32_t src_index = UINT32_MAX;
@@ -490,7 +1203,7 @@ void SVFRT_conversion_traverse_choice(
   if (src_index == UINT32_MAX) {
     // We did not find the tag, so defaulting to the zero tag. In Phase 2, all
     // data is already zero-initialized, so nothing needs to be done here.
-    return;
+    return false;
   }
 
   SVF_Meta_OptionDefinition *unsafe_option_src = unsafe_options_src.pointer + src_index;
@@ -499,43 +1212,124 @@ void SVFRT_conversion_traverse_choice(
   // Any conversion only needs to happen, if both options are normal (not
   // removed). For Phase 2, data is already zero-initialized, so nothing needs
   // to happen here as well.
-  if (!unsafe_option_src->removed && !option_dst->removed) {
-    SVFRT_Phase2_TraverseAnyType phase2_inner = {0};
-    if (phase2) {
-      // Make sure we can at least write the tag.
-      //
-      // Prevent addition overflow by casting operands to `uint64_t` first.
-      //
-      // In this case, it looks rather silly, as we are adding _one_. But
-      // proving an overflow can't happen is much harder that just checking.
-      if ((uint64_t) phase2->data_offset_dst + (uint64_t) SVFRT_TAG_SIZE > (uint64_t) phase2->data_range_dst.count) {
-        ctx->error_code = SVFRT_code_conversion_internal__suballocation_out_of_bounds;
-        return;
-      }
+  if (unsafe_option_src->removed || option_dst->removed) {
+    return false;
+  }
+
+  if (phase2) {
+    // Make sure we can at least write the tag.
+    //
+    // Prevent addition overflow by casting operands to `uint64_t` first.
+    //
+    // In this case, it looks rather silly, as we are adding _one_. But
+    // proving an overflow can't happen is much harder that just checking.
+    if ((uint64_t) phase2->data_offset_dst + (uint64_t) SVFRT_TAG_SIZE > (uint64_t) phase2->data_range_dst.count) {
+      ctx->error_code = SVFRT_code_conversion_internal__suballocation_out_of_bounds;
+      return false;
+    }
+
+    // Write the tag.
+    *(phase2->data_range_dst.pointer + phase2->data_offset_dst) = option_dst->tag;
+  }
+
+  *out_unsafe_option_src = unsafe_option_src;
+  *out_option_dst = option_dst;
+  return true;
+}
+
+void SVFRT_conversion_traverse_choice(
+  SVFRT_ConversionContext *ctx,
+  uint32_t recursion_depth,
+  uint32_t unsafe_choice_index_src,
+  uint32_t choice_index_dst,
+  SVFRT_Bytes data_range_src,
+  uint32_t unsafe_data_offset_src,
+  SVFRT_Phase2_TraverseConcreteType *phase2
+) {
+  SVF_Meta_OptionDefinition *unsafe_option_src;
+  SVF_Meta_OptionDefinition *option_dst;
+  if (!SVFRT_conversion_resolve_choice(
+    ctx,
+    unsafe_choice_index_src,
+    choice_index_dst,
+    data_range_src,
+    unsafe_data_offset_src,
+    phase2,
+    &unsafe_option_src,
+    &option_dst
+  )) {
+    return;
+  }
+
+  SVFRT_Phase2_TraverseAnyType phase2_inner = {0};
+  if (phase2) {
+    phase2_inner.data_range_dst = phase2->data_range_dst;
+
+    phase2_inner.data_offset_dst = phase2->data_offset_dst + SVFRT_TAG_SIZE;
+  }
+
+  SVFRT_conversion_traverse_any_type(
+    ctx,
+    recursion_depth,
+    data_range_src,
+    unsafe_data_offset_src + SVFRT_TAG_SIZE,
+    unsafe_option_src->type_tag,
+    &unsafe_option_src->type_payload,
+    option_dst->type_tag,
+    &option_dst->type_payload,
+    phase2 ? &phase2_inner : NULL
+  );
+}
+
+// Find the bytes of a struct value in the src-data, and in Phase 2, in the
+// dst-data as well. Shared between the recursive and the #iterative-conversion
+// traversals.
+//
+// Returns false on an error.
+static inline
+bool SVFRT_conversion_locate_struct(
+  SVFRT_ConversionContext *ctx,
+  uint32_t unsafe_struct_index_src,
+  uint32_t struct_index_dst,
+  SVFRT_Bytes data_range_src,
+  uint32_t unsafe_data_offset_src,
+  SVFRT_Phase2_TraverseConcreteType *phase2,
+  SVFRT_Bytes *out_struct_bytes_src,
+  SVFRT_Bytes *phase2_out_struct_bytes_dst
+) {
+  if (unsafe_struct_index_src >= ctx->unsafe_structs_src.count) {
+    ctx->error_code = SVFRT_code_conversion__bad_schema_struct_index;
+    return false;
+  }
+  uint32_t unsafe_struct_size_src = ctx->unsafe_structs_src.pointer[unsafe_struct_index_src].size;
 
-      // Write the tag.
-      // TODO @proper-alignment: tags.
-      *(phase2->data_range_dst.pointer + phase2->data_offset_dst) = option_dst->tag;
+  // Prevent addition overflow by casting operands to `uint64_t` first.
+  if ((uint64_t) unsafe_data_offset_src + (uint64_t) unsafe_struct_size_src > (uint64_t) data_range_src.count) {
+    ctx->error_code = SVFRT_code_conversion__data_out_of_bounds;
+    return false;
+  }
 
-      phase2_inner.data_range_dst = phase2->data_range_dst;
+  out_struct_bytes_src->pointer = (uint8_t *) data_range_src.pointer + unsafe_data_offset_src;
+  out_struct_bytes_src->count = unsafe_struct_size_src;
 
-      // TODO @proper-alignment: tags.
-      phase2_inner.data_offset_dst = phase2->data_offset_dst + SVFRT_TAG_SIZE;
+  if (phase2) {
+    if (struct_index_dst >= ctx->structs_dst.count) {
+      ctx->error_code = SVFRT_code_conversion_internal__bad_schema_struct_index;
+      return false;
     }
+    uint32_t struct_size_dst = ctx->structs_dst.pointer[struct_index_dst].size;
 
-    SVFRT_conversion_traverse_any_type(
-      ctx,
-      recursion_depth,
-      data_range_src,
-      // TODO: @proper-alignment: tags.
-      unsafe_data_offset_src + SVFRT_TAG_SIZE,
-      unsafe_option_src->type_tag,
-      &unsafe_option_src->type_payload,
-      option_dst->type_tag,
-      &option_dst->type_payload,
-      phase2 ? &phase2_inner : NULL
-    );
+    // Prevent addition overflow by casting operands to `uint64_t` first.
+    if ((uint64_t) phase2->data_offset_dst + (uint64_t) struct_size_dst > (uint64_t) phase2->data_range_dst.count) {
+      ctx->error_code = SVFRT_code_conversion_internal__suballocation_out_of_bounds;
+      return false;
+    }
+
+    phase2_out_struct_bytes_dst->pointer = (uint8_t *) phase2->data_range_dst.pointer + phase2->data_offset_dst;
+    phase2_out_struct_bytes_dst->count = struct_size_dst;
   }
+
+  return true;
 }
 
 void SVFRT_conversion_traverse_concrete_type(
@@ -561,43 +1355,19 @@ void SVFRT_conversion_traverse_concrete_type(
       uint32_t unsafe_struct_index_src = unsafe_type_payload_src->definedStruct.index;
       uint32_t struct_index_dst = type_payload_dst->definedStruct.index;
 
-      if (unsafe_struct_index_src >= ctx->unsafe_structs_src.count) {
-        ctx->error_code = SVFRT_code_conversion__bad_schema_struct_index;
-        return;
-      }
-      uint32_t unsafe_struct_size_src = ctx->unsafe_structs_src.pointer[unsafe_struct_index_src].size;
-
-      // Prevent addition overflow by casting operands to `uint64_t` first.
-      if ((uint64_t) unsafe_data_offset_src + (uint64_t) unsafe_struct_size_src > (uint64_t) data_range_src.count) {
-        ctx->error_code = SVFRT_code_conversion__data_out_of_bounds;
-        return;
-      }
-
-      SVFRT_Bytes struct_bytes_src = {
-        /*.pointer =*/ (uint8_t *) data_range_src.pointer + unsafe_data_offset_src,
-        /*.count =*/ unsafe_struct_size_src
-      };
-
       SVFRT_Phase2_TraverseStruct phase2_inner = {0};
-      if (phase2) {
-        if (struct_index_dst >= ctx->structs_dst.count) {
-          ctx->error_code = SVFRT_code_conversion_internal__bad_schema_struct_index;
-          return;
-        }
-        uint32_t struct_size_dst = ctx->structs_dst.pointer[struct_index_dst].size;
-
-        // Prevent addition overflow by casting operands to `uint64_t` first.
-        if ((uint64_t) phase2->data_offset_dst + (uint64_t) struct_size_dst > (uint64_t) phase2->data_range_dst.count) {
-          ctx->error_code = SVFRT_code_conversion_internal__suballocation_out_of_bounds;
-          return;
-        }
-
-        SVFRT_Bytes struct_bytes_dst = {
-          /*.pointer =*/ (uint8_t *) phase2->data_range_dst.pointer + phase2->data_offset_dst,
-          /*.count =*/ struct_size_dst
-        };
-
-        phase2_inner.struct_bytes_dst = struct_bytes_dst;
+      SVFRT_Bytes struct_bytes_src;
+      if (!SVFRT_conversion_locate_struct(
+        ctx,
+        unsafe_struct_index_src,
+        struct_index_dst,
+        data_range_src,
+        unsafe_data_offset_src,
+        phase2,
+        &struct_bytes_src,
+        &phase2_inner.struct_bytes_dst
+      )) {
+        return;
       }
 
       SVFRT_conversion_traverse_struct(
@@ -952,426 +1722,4250 @@ void SVFRT_conversion_traverse_concrete_type(
   }
 }
 
-void SVFRT_conversion_traverse_any_type(
+// Tally the suballocation for a reference, and in Phase 2, point the
+// dst-representation at it. Shared between the recursive and the
+// #iterative-conversion traversals.
+//
+// Returns false, if there is nothing to traverse, or on an error.
+static inline
+bool SVFRT_conversion_start_reference(
   SVFRT_ConversionContext *ctx,
-  uint32_t recursion_depth,
   SVFRT_Bytes data_range_src,
   uint32_t unsafe_data_offset_src,
-  SVF_Meta_Type_tag unsafe_type_tag_src,
   SVF_Meta_Type_payload *unsafe_type_payload_src,
-  SVF_Meta_Type_tag type_tag_dst,
   SVF_Meta_Type_payload *type_payload_dst,
-  SVFRT_Phase2_TraverseAnyType *phase2
+  SVFRT_Phase2_TraverseAnyType *phase2,
+  uint32_t *out_unsafe_final_offset_src,
+  SVFRT_Bytes *phase2_out_suballocation
 ) {
-  recursion_depth += 1;
-  if (recursion_depth > ctx->max_recursion_depth) {
-    ctx->error_code = SVFRT_code_conversion__max_recursion_depth_exceeded;
-    return;
+  // Prevent addition overflow by casting operands to `uint64_t` first.
+  if ((uint64_t) unsafe_data_offset_src + (uint64_t) sizeof(SVFRT_Reference) > (uint64_t) data_range_src.count) {
+    ctx->error_code = SVFRT_code_conversion__data_out_of_bounds;
+    return false;
   }
 
-  switch (unsafe_type_tag_src) {
-    case SVF_Meta_Type_tag_concrete: {
-      // Sanity check.
-      if (type_tag_dst != SVF_Meta_Type_tag_concrete) {
-        ctx->error_code = SVFRT_code_conversion__schema_type_tag_mismatch;
-        return;
-      }
+  // Untrusted src-data may be misaligned, hence `SVFRT_MEMCPY`. See #natural-alignment.
+  SVFRT_Reference unsafe_representation_src = {0};
+  SVFRT_MEMCPY(&unsafe_representation_src, data_range_src.pointer + unsafe_data_offset_src, sizeof(unsafe_representation_src));
 
-      SVFRT_Phase2_TraverseConcreteType phase2_inner = {0};
-      if (phase2) {
-        phase2_inner.data_range_dst = phase2->data_range_dst;
-        phase2_inner.data_offset_dst = phase2->data_offset_dst;
-      }
+  if (unsafe_representation_src.data_offset_complement == 0) {
+    // Allow invalid references, but only if the representation is zero.
 
-      SVFRT_conversion_traverse_concrete_type(
-        ctx,
-        recursion_depth,
-        data_range_src,
-        unsafe_data_offset_src,
-        unsafe_type_payload_src->concrete.type_tag,
-        &unsafe_type_payload_src->concrete.type_payload,
-        type_payload_dst->concrete.type_tag,
-        &type_payload_dst->concrete.type_payload,
-        phase2 ? &phase2_inner : NULL
-      );
+    // For Phase 1, nothing needs to be done here.
+    // For Phase 2, the dst-representation is zero already, which is fine.
+    return false;
+  }
 
-      return;
+  uint32_t unsafe_size_src = SVFRT_conversion_get_type_size(
+    ctx->unsafe_structs_src,
+    unsafe_type_payload_src->reference.type_tag,
+    &unsafe_type_payload_src->reference.type_payload
+  );
+  if (unsafe_size_src == 0) {
+    ctx->error_code = SVFRT_code_conversion__bad_type;
+    return false;
+  }
+
+  uint32_t size_dst = SVFRT_conversion_get_type_size(
+    ctx->structs_dst,
+    type_payload_dst->reference.type_tag,
+    &type_payload_dst->reference.type_payload
+  );
+  if (size_dst == 0) {
+    ctx->error_code = SVFRT_code_conversion_internal__bad_type;
+    return false;
+  }
+
+  // See #conversion-memoization.
+  SVFRT_ConversionMemoEntry memo_key = {
+    /*.offset_src =*/ ~unsafe_representation_src.data_offset_complement,
+    /*.count =*/ 1,
+    /*.size_src =*/ unsafe_size_src,
+    /*.type_src =*/ SVFRT_conversion_memo_type(unsafe_type_payload_src->reference.type_tag, &unsafe_type_payload_src->reference.type_payload),
+    /*.type_dst =*/ SVFRT_conversion_memo_type(type_payload_dst->reference.type_tag, &type_payload_dst->reference.type_payload),
+    /*.offset_dst =*/ 0,
+  };
+  bool memo_found = false;
+  SVFRT_ConversionMemoEntry *memo_slot = SVFRT_conversion_memo_find(ctx, &memo_key, &memo_found);
+  if (memo_found) {
+    if (phase2) {
+      SVFRT_conversion_memo_reuse(ctx, phase2->data_range_dst, phase2->data_offset_dst, memo_slot, false);
     }
-    case SVF_Meta_Type_tag_reference: {
-      // Sanity check.
-      if (type_tag_dst != SVF_Meta_Type_tag_reference) {
-        ctx->error_code = SVFRT_code_conversion__schema_type_tag_mismatch;
-        return;
-      }
+    return false;
+  }
 
-      // Prevent addition overflow by casting operands to `uint64_t` first.
-      if ((uint64_t) unsafe_data_offset_src + (uint64_t) sizeof(SVFRT_Reference) > (uint64_t) data_range_src.count) {
-        ctx->error_code = SVFRT_code_conversion__data_out_of_bounds;
-        return;
-      }
+  SVFRT_conversion_tally(
+    ctx,
+    unsafe_size_src,
+    size_dst,
+    1,
+    phase2 ? phase2_out_suballocation : NULL
+  );
+  if (ctx->error_code) {
+    return false;
+  }
+  SVFRT_conversion_memo_insert(ctx, memo_slot, &memo_key, phase2 ? phase2_out_suballocation : NULL);
 
-      // TODO @proper-alignment: potentially misaligned reference.
-      SVFRT_Reference unsafe_representation_src = *((SVFRT_Reference *) (data_range_src.pointer + unsafe_data_offset_src));
+  if (phase2) {
+    SVFRT_conversion_write_representation(
+      ctx,
+      phase2->data_range_dst,
+      phase2->data_offset_dst,
+      *phase2_out_suballocation,
+      1,
+      false
+    );
+    if (ctx->error_code) {
+      return false;
+    }
+  }
 
-      if (unsafe_representation_src.data_offset_complement == 0) {
-        // Allow invalid references, but only if the representation is zero.
+  *out_unsafe_final_offset_src = ~unsafe_representation_src.data_offset_complement;
+  return true;
+}
 
-        // For Phase 1, nothing needs to be done here.
-        // For Phase 2, the dst-representation is zero already, which is fine.
-        return;
-      }
+// Tally the suballocation for a sequence, and in Phase 2, point the
+// dst-representation at it. Sequences of primitives are converted right here,
+// all at once. Shared between the recursive and the #iterative-conversion
+// traversals.
+//
+// Returns false, if there are no elements left to traverse one by one, or on
+// an error.
+static inline
+bool SVFRT_conversion_start_sequence(
+  SVFRT_ConversionContext *ctx,
+  SVFRT_Bytes data_range_src,
+  uint32_t unsafe_data_offset_src,
+  SVF_Meta_Type_payload *unsafe_type_payload_src,
+  SVF_Meta_Type_payload *type_payload_dst,
+  SVFRT_Phase2_TraverseAnyType *phase2,
+  SVFRT_Sequence *out_unsafe_representation_src,
+  uint32_t *out_unsafe_size_src,
+  uint32_t *out_size_dst,
+  SVFRT_Bytes *phase2_out_suballocation
+) {
+  // Prevent addition overflow by casting operands to `uint64_t` first.
+  if ((uint64_t) unsafe_data_offset_src + (uint64_t) sizeof(SVFRT_Sequence) > (uint64_t) data_range_src.count) {
+    ctx->error_code = SVFRT_code_conversion__data_out_of_bounds;
+    return false;
+  }
 
-      uint32_t unsafe_size_src = SVFRT_conversion_get_type_size(
-        ctx->unsafe_structs_src,
-        unsafe_type_payload_src->reference.type_tag,
-        &unsafe_type_payload_src->reference.type_payload
-      );
-      if (unsafe_size_src == 0) {
-        ctx->error_code = SVFRT_code_conversion__bad_type;
-        return;
-      }
+  // Untrusted src-data may be misaligned, hence `SVFRT_MEMCPY`. See #natural-alignment.
+  SVFRT_Sequence unsafe_representation_src = {0};
+  SVFRT_MEMCPY(&unsafe_representation_src, data_range_src.pointer + unsafe_data_offset_src, sizeof(unsafe_representation_src));
 
-      uint32_t size_dst = SVFRT_conversion_get_type_size(
-        ctx->structs_dst,
-        type_payload_dst->reference.type_tag,
-        &type_payload_dst->reference.type_payload
-      );
-      if (size_dst == 0) {
-        ctx->error_code = SVFRT_code_conversion_internal__bad_type;
-        return;
-      }
+  // Allow invalid sequences, but only if the representation is zero.
+  if (unsafe_representation_src.data_offset_complement == 0 && unsafe_representation_src.count == 0) {
+    // For Phase 1, nothing needs to be done here.
+    // For Phase 2, the dst-representation is zero already, which is fine.
+    return false;
+  }
 
-      SVFRT_Phase2_TraverseConcreteType phase2_inner = {0};
-      SVFRT_conversion_tally(
-        ctx,
-        unsafe_size_src,
-        size_dst,
-        1,
-        phase2 ? &phase2_inner.data_range_dst : NULL
-      );
-      if (ctx->error_code) {
-        return;
-      }
+  uint32_t unsafe_size_src = SVFRT_conversion_get_type_size(
+    ctx->unsafe_structs_src,
+    unsafe_type_payload_src->reference.type_tag,
+    &unsafe_type_payload_src->reference.type_payload
+  );
+  if (unsafe_size_src == 0) {
+    ctx->error_code = SVFRT_code_conversion__bad_type;
+    return false;
+  }
 
-      // For Phase 2:
-      // `phase2_inner.data_range_dst` was filled by `SVFRT_conversion_tally`.
-      // `phase2_inner.data_offset_dst` is zero by default
+  uint32_t size_dst = SVFRT_conversion_get_type_size(
+    ctx->structs_dst,
+    type_payload_dst->reference.type_tag,
+    &type_payload_dst->reference.type_payload
+  );
+  if (size_dst == 0) {
+    ctx->error_code = SVFRT_code_conversion_internal__bad_type;
+    return false;
+  }
 
-      SVFRT_conversion_traverse_concrete_type(
-        ctx,
-        recursion_depth,
-        ctx->data_bytes,
-        ~unsafe_representation_src.data_offset_complement,
-        unsafe_type_payload_src->reference.type_tag,
-        &unsafe_type_payload_src->reference.type_payload,
-        type_payload_dst->reference.type_tag,
-        &type_payload_dst->reference.type_payload,
-        phase2 ? &phase2_inner : NULL
-      );
-      return;
+  // See #conversion-memoization.
+  SVFRT_ConversionMemoEntry memo_key = {
+    /*.offset_src =*/ ~unsafe_representation_src.data_offset_complement,
+    /*.count =*/ unsafe_representation_src.count,
+    /*.size_src =*/ unsafe_size_src,
+    /*.type_src =*/ SVFRT_conversion_memo_type(unsafe_type_payload_src->reference.type_tag, &unsafe_type_payload_src->reference.type_payload),
+    /*.type_dst =*/ SVFRT_conversion_memo_type(type_payload_dst->reference.type_tag, &type_payload_dst->reference.type_payload),
+    /*.offset_dst =*/ 0,
+  };
+  bool memo_found = false;
+  SVFRT_ConversionMemoEntry *memo_slot = SVFRT_conversion_memo_find(ctx, &memo_key, &memo_found);
+  if (memo_found) {
+    if (phase2) {
+      SVFRT_conversion_memo_reuse(ctx, phase2->data_range_dst, phase2->data_offset_dst, memo_slot, true);
     }
-    case SVF_Meta_Type_tag_sequence: {
-      // Sanity check.
-      if (type_tag_dst != SVF_Meta_Type_tag_sequence) {
-        ctx->error_code = SVFRT_code_conversion__schema_type_tag_mismatch;
-        return;
-      }
+    return false;
+  }
 
-      // Prevent addition overflow by casting operands to `uint64_t` first.
-      if ((uint64_t) unsafe_data_offset_src + (uint64_t) sizeof(SVFRT_Sequence) > (uint64_t) data_range_src.count) {
-        ctx->error_code = SVFRT_code_conversion__data_out_of_bounds;
-        return;
-      }
+  SVFRT_conversion_tally(
+    ctx,
+    unsafe_size_src,
+    size_dst,
+    unsafe_representation_src.count,
+    phase2 ? phase2_out_suballocation : NULL
+  );
+  if (ctx->error_code) {
+    return false;
+  }
+  SVFRT_conversion_memo_insert(ctx, memo_slot, &memo_key, phase2 ? phase2_out_suballocation : NULL);
 
-      // TODO @proper-alignment: potentially misaligned sequence.
-      SVFRT_Sequence unsafe_representation_src = *((SVFRT_Sequence *) (data_range_src.pointer + unsafe_data_offset_src));
+  if (phase2) {
+    SVFRT_conversion_write_representation(
+      ctx,
+      phase2->data_range_dst,
+      phase2->data_offset_dst,
+      *phase2_out_suballocation,
+      unsafe_representation_src.count,
+      true
+    );
+    if (ctx->error_code) {
+      return false;
+    }
+  }
 
-      // Allow invalid sequences, but only if the representation is zero.
-      if (unsafe_representation_src.data_offset_complement == 0 && unsafe_representation_src.count == 0) {
-        // For Phase 1, nothing needs to be done here.
-        // For Phase 2, the dst-representation is zero already, which is fine.
-        return;
-      }
+  uint32_t data_offset = ~unsafe_representation_src.data_offset_complement;
+  uint64_t unsafe_end_offset_src = (
+    (uint64_t) data_offset +
+    (uint64_t) unsafe_representation_src.count * (uint64_t) unsafe_size_src
+  );
 
-      uint32_t unsafe_size_src = SVFRT_conversion_get_type_size(
-        ctx->unsafe_structs_src,
-        unsafe_type_payload_src->reference.type_tag,
-        &unsafe_type_payload_src->reference.type_payload
-      );
-      if (unsafe_size_src == 0) {
-        ctx->error_code = SVFRT_code_conversion__bad_type;
-        return;
-      }
+  // Prevent multiply-add overflow by casting operands to `uint64_t` first. It
+  // works, because `UINT64_MAX == UINT32_MAX * UINT32_MAX + UINT32_MAX + UINT32_MAX`.
+  if (unsafe_end_offset_src > (uint64_t) UINT32_MAX) {
+    ctx->error_code = SVFRT_code_conversion__data_out_of_bounds;
+    return false;
+  }
 
-      uint32_t size_dst = SVFRT_conversion_get_type_size(
-        ctx->structs_dst,
-        type_payload_dst->reference.type_tag,
-        &type_payload_dst->reference.type_payload
-      );
-      if (size_dst == 0) {
-        ctx->error_code = SVFRT_code_conversion_internal__bad_type;
-        return;
-      }
+  // Sequences of primitives are converted all at once, either by copying,
+  // or by widening. Same as in `SVFRT_conversion_traverse_concrete_type`,
+  // nothing needs to be done for them in Phase 1.
+  SVF_Meta_ConcreteType_tag unsafe_element_tag_src = unsafe_type_payload_src->reference.type_tag;
+  SVF_Meta_ConcreteType_tag element_tag_dst = type_payload_dst->reference.type_tag;
+  bool is_exact_copy = (
+    unsafe_element_tag_src == element_tag_dst &&
+    element_tag_dst != SVF_Meta_ConcreteType_tag_definedStruct
+  );
+  uint32_t widening = SVFRT_conversion_get_widening(unsafe_element_tag_src, element_tag_dst);
+  if (is_exact_copy || widening) {
+    if (!phase2) return false;
 
-      SVFRT_Phase2_TraverseConcreteType phase2_inner = {0};
-      SVFRT_conversion_tally(
+    if (unsafe_end_offset_src > (uint64_t) ctx->data_bytes.count) {
+      ctx->error_code = SVFRT_code_conversion__data_out_of_bounds;
+      return false;
+    }
+
+    uint8_t *pointer_src = ctx->data_bytes.pointer + data_offset;
+
+    // No overflow possible, see #phase2-reasonable-dst-sum. The
+    // suballocation is exactly `size_dst * count` bytes.
+    if (is_exact_copy) {
+      SVFRT_MEMCPY(phase2_out_suballocation->pointer, pointer_src, size_dst * unsafe_representation_src.count);
+    } else {
+      SVFRT_conversion_widen(widening, phase2_out_suballocation->pointer, pointer_src, unsafe_representation_src.count);
+    }
+    return false;
+  }
+
+  *out_unsafe_representation_src = unsafe_representation_src;
+  *out_unsafe_size_src = unsafe_size_src;
+  *out_size_dst = size_dst;
+  return true;
+}
+
+// Go to the next chunk of a #chunked-sequences src-representation, and tally
+// both its link and its elements. The elements of the chunk come at
+// `*out_first` in the dst-suballocation, since the chain is walked backwards.
+// Shared between the recursive and the #iterative-conversion traversals.
+//
+// Returns false at the end, or on an error.
+static inline
+bool SVFRT_conversion_next_chunk(
+  SVFRT_ConversionContext *ctx,
+  SVFRT_ChunkIterator *unsafe_iterator,
+  uint32_t unsafe_size_src,
+  SVFRT_Sequence *out_unsafe_chunk_src,
+  uint32_t *out_first
+) {
+  SVFRT_ReadContext read_ctx = {0};
+  read_ctx.data_range = ctx->data_bytes;
+
+  if (!SVFRT_chunk_iterator_next(&read_ctx, unsafe_iterator, out_unsafe_chunk_src)) {
+    if (unsafe_iterator->remaining != 0) {
+      ctx->error_code = SVFRT_code_conversion__bad_chunk_link;
+    }
+    return false;
+  }
+
+  // Links are tallied as well, so a chain can't be longer than the data.
+  // Prevent multiply-add overflow by casting operands to `uint64_t` first.
+  uint64_t sum_src = (
+    (uint64_t) ctx->tally_src +
+    (uint64_t) sizeof(SVFRT_ChunkLink) +
+    (uint64_t) unsafe_size_src * (uint64_t) out_unsafe_chunk_src->count
+  );
+  if (sum_src > (uint64_t) ctx->data_bytes.count) {
+    ctx->error_code = SVFRT_code_conversion__data_aliasing_detected;
+    ctx->tally_src = UINT32_MAX;
+    return false;
+  }
+  ctx->tally_src = (uint32_t) sum_src;
+
+  // The link itself was bounds-checked by `SVFRT_chunk_iterator_next`.
+  uint64_t unsafe_end_offset_src = (
+    (uint64_t) ~out_unsafe_chunk_src->data_offset_complement +
+    (uint64_t) unsafe_size_src * (uint64_t) out_unsafe_chunk_src->count
+  );
+  if (unsafe_end_offset_src > (uint64_t) ctx->data_bytes.count) {
+    ctx->error_code = SVFRT_code_conversion__data_out_of_bounds;
+    return false;
+  }
+
+  *out_first = unsafe_iterator->remaining;
+  return true;
+}
+
+// Same as `SVFRT_conversion_start_sequence`, but for #chunked-sequences, which
+// are converted either to chunked sequences with a single chunk, or to regular
+// sequences. Either way, the elements end up in a single suballocation.
+//
+// Returns false, if there are no elements left to traverse one by one, or on
+// an error. Otherwise, the caller goes over the chunks with
+// `SVFRT_conversion_next_chunk`.
+static inline
+bool SVFRT_conversion_start_chunked_sequence(
+  SVFRT_ConversionContext *ctx,
+  SVFRT_Bytes data_range_src,
+  uint32_t unsafe_data_offset_src,
+  SVF_Meta_Type_payload *unsafe_type_payload_src,
+  SVF_Meta_Type_tag type_tag_dst,
+  SVF_Meta_Type_payload *type_payload_dst,
+  SVFRT_Phase2_TraverseAnyType *phase2,
+  SVFRT_ChunkIterator *out_unsafe_iterator,
+  uint32_t *out_unsafe_size_src,
+  uint32_t *out_size_dst,
+  SVFRT_Bytes *phase2_out_suballocation
+) {
+  // Prevent addition overflow by casting operands to `uint64_t` first.
+  if ((uint64_t) unsafe_data_offset_src + (uint64_t) sizeof(SVFRT_ChunkedSequence) > (uint64_t) data_range_src.count) {
+    ctx->error_code = SVFRT_code_conversion__data_out_of_bounds;
+    return false;
+  }
+
+  // Untrusted src-data may be misaligned, hence `SVFRT_MEMCPY`. See #natural-alignment.
+  SVFRT_ChunkedSequence unsafe_representation_src = {0};
+  SVFRT_MEMCPY(&unsafe_representation_src, data_range_src.pointer + unsafe_data_offset_src, sizeof(unsafe_representation_src));
+
+  // Empty, the dst-representation is zero already.
+  if (unsafe_representation_src.count == 0) {
+    return false;
+  }
+
+  // Note: chunked sequence payloads are laid out the same as reference payloads.
+  uint32_t unsafe_size_src = SVFRT_conversion_get_type_size(
+    ctx->unsafe_structs_src,
+    unsafe_type_payload_src->reference.type_tag,
+    &unsafe_type_payload_src->reference.type_payload
+  );
+  if (unsafe_size_src == 0) {
+    ctx->error_code = SVFRT_code_conversion__bad_type;
+    return false;
+  }
+
+  uint32_t size_dst = SVFRT_conversion_get_type_size(
+    ctx->structs_dst,
+    type_payload_dst->reference.type_tag,
+    &type_payload_dst->reference.type_payload
+  );
+  if (size_dst == 0) {
+    ctx->error_code = SVFRT_code_conversion_internal__bad_type;
+    return false;
+  }
+
+  // Src-data is tallied chunk by chunk, in `SVFRT_conversion_next_chunk`.
+  SVFRT_conversion_tally(
+    ctx,
+    0,
+    size_dst,
+    unsafe_representation_src.count,
+    phase2 ? phase2_out_suballocation : NULL
+  );
+  if (ctx->error_code) {
+    return false;
+  }
+
+  if (type_tag_dst == SVF_Meta_Type_tag_chunkedSequence) {
+    SVFRT_Bytes link_suballocation = {0};
+    SVFRT_conversion_tally(
+      ctx,
+      0,
+      sizeof(SVFRT_ChunkLink),
+      1,
+      phase2 ? &link_suballocation : NULL
+    );
+    if (ctx->error_code) {
+      return false;
+    }
+
+    if (phase2) {
+      SVFRT_ChunkLink link = {
+        /*.previous_complement =*/ 0,
+        /*.data_offset_complement =*/ ~((uint32_t) (phase2_out_suballocation->pointer - ctx->allocation.pointer)),
+        /*.count =*/ unsafe_representation_src.count,
+        /*.index =*/ 0,
+      };
+      SVFRT_MEMCPY(link_suballocation.pointer, &link, sizeof(link));
+
+      // Same layout as a sequence.
+      SVFRT_conversion_write_representation(
         ctx,
-        unsafe_size_src,
-        size_dst,
+        phase2->data_range_dst,
+        phase2->data_offset_dst,
+        link_suballocation,
         unsafe_representation_src.count,
-        phase2 ? &phase2_inner.data_range_dst : NULL
+        true
       );
-      if (ctx->error_code) {
+    }
+  } else if (phase2) {
+    SVFRT_conversion_write_representation(
+      ctx,
+      phase2->data_range_dst,
+      phase2->data_offset_dst,
+      *phase2_out_suballocation,
+      unsafe_representation_src.count,
+      true
+    );
+  }
+  if (ctx->error_code) {
+    return false;
+  }
+
+  *out_unsafe_iterator = SVFRT_chunk_iterator_begin(unsafe_representation_src);
+
+  // Same as in `SVFRT_conversion_start_sequence`, chunks of primitives are
+  // converted all at once.
+  SVF_Meta_ConcreteType_tag unsafe_element_tag_src = unsafe_type_payload_src->reference.type_tag;
+  SVF_Meta_ConcreteType_tag element_tag_dst = type_payload_dst->reference.type_tag;
+  bool is_exact_copy = (
+    unsafe_element_tag_src == element_tag_dst &&
+    element_tag_dst != SVF_Meta_ConcreteType_tag_definedStruct
+  );
+  uint32_t widening = SVFRT_conversion_get_widening(unsafe_element_tag_src, element_tag_dst);
+  if (is_exact_copy || widening) {
+    SVFRT_Sequence unsafe_chunk_src;
+    uint32_t first;
+    while (SVFRT_conversion_next_chunk(ctx, out_unsafe_iterator, unsafe_size_src, &unsafe_chunk_src, &first)) {
+      if (!phase2) continue;
+
+      uint8_t *pointer_src = ctx->data_bytes.pointer + ~unsafe_chunk_src.data_offset_complement;
+
+      // No overflow possible, see #phase2-reasonable-dst-sum. The chunks
+      // together have exactly the count that was tallied.
+      uint8_t *pointer_dst = phase2_out_suballocation->pointer + size_dst * first;
+      if (is_exact_copy) {
+        SVFRT_MEMCPY(pointer_dst, pointer_src, size_dst * unsafe_chunk_src.count);
+      } else {
+        SVFRT_conversion_widen(widening, pointer_dst, pointer_src, unsafe_chunk_src.count);
+      }
+    }
+    return false;
+  }
+
+  *out_unsafe_size_src = unsafe_size_src;
+  *out_size_dst = size_dst;
+  return true;
+}
+
+void SVFRT_conversion_traverse_any_type(
+  SVFRT_ConversionContext *ctx,
+  uint32_t recursion_depth,
+  SVFRT_Bytes data_range_src,
+  uint32_t unsafe_data_offset_src,
+  SVF_Meta_Type_tag unsafe_type_tag_src,
+  SVF_Meta_Type_payload *unsafe_type_payload_src,
+  SVF_Meta_Type_tag type_tag_dst,
+  SVF_Meta_Type_payload *type_payload_dst,
+  SVFRT_Phase2_TraverseAnyType *phase2
+) {
+  recursion_depth += 1;
+  if (recursion_depth > ctx->max_recursion_depth) {
+    ctx->error_code = SVFRT_code_conversion__max_recursion_depth_exceeded;
+    return;
+  }
+
+  switch (unsafe_type_tag_src) {
+    case SVF_Meta_Type_tag_concrete: {
+      // Sanity check.
+      if (type_tag_dst != SVF_Meta_Type_tag_concrete) {
+        ctx->error_code = SVFRT_code_conversion__schema_type_tag_mismatch;
+        return;
+      }
+
+      SVFRT_Phase2_TraverseConcreteType phase2_inner = {0};
+      if (phase2) {
+        phase2_inner.data_range_dst = phase2->data_range_dst;
+        phase2_inner.data_offset_dst = phase2->data_offset_dst;
+      }
+
+      SVFRT_conversion_traverse_concrete_type(
+        ctx,
+        recursion_depth,
+        data_range_src,
+        unsafe_data_offset_src,
+        unsafe_type_payload_src->concrete.type_tag,
+        &unsafe_type_payload_src->concrete.type_payload,
+        type_payload_dst->concrete.type_tag,
+        &type_payload_dst->concrete.type_payload,
+        phase2 ? &phase2_inner : NULL
+      );
+
+      return;
+    }
+    case SVF_Meta_Type_tag_reference: {
+      // Sanity check.
+      if (type_tag_dst != SVF_Meta_Type_tag_reference) {
+        ctx->error_code = SVFRT_code_conversion__schema_type_tag_mismatch;
+        return;
+      }
+
+      SVFRT_Phase2_TraverseConcreteType phase2_inner = {0};
+      uint32_t unsafe_final_offset_src;
+      if (!SVFRT_conversion_start_reference(
+        ctx,
+        data_range_src,
+        unsafe_data_offset_src,
+        unsafe_type_payload_src,
+        type_payload_dst,
+        phase2,
+        &unsafe_final_offset_src,
+        &phase2_inner.data_range_dst
+      )) {
         return;
       }
 
-      uint32_t data_offset = ~unsafe_representation_src.data_offset_complement;
-      uint64_t unsafe_end_offset_src = (
-        (uint64_t) data_offset +
-        (uint64_t) unsafe_representation_src.count * (uint64_t) unsafe_size_src
+      // For Phase 2:
+      // `phase2_inner.data_range_dst` was filled by `SVFRT_conversion_tally`.
+      // `phase2_inner.data_offset_dst` is zero by default
+
+      SVFRT_conversion_traverse_concrete_type(
+        ctx,
+        recursion_depth,
+        ctx->data_bytes,
+        unsafe_final_offset_src,
+        unsafe_type_payload_src->reference.type_tag,
+        &unsafe_type_payload_src->reference.type_payload,
+        type_payload_dst->reference.type_tag,
+        &type_payload_dst->reference.type_payload,
+        phase2 ? &phase2_inner : NULL
       );
+      return;
+    }
+    case SVF_Meta_Type_tag_sequence: {
+      // Sanity check.
+      if (type_tag_dst != SVF_Meta_Type_tag_sequence) {
+        ctx->error_code = SVFRT_code_conversion__schema_type_tag_mismatch;
+        return;
+      }
+
+      SVFRT_Phase2_TraverseConcreteType phase2_inner = {0};
+      SVFRT_Sequence unsafe_representation_src;
+      uint32_t unsafe_size_src;
+      uint32_t size_dst;
+      if (!SVFRT_conversion_start_sequence(
+        ctx,
+        data_range_src,
+        unsafe_data_offset_src,
+        unsafe_type_payload_src,
+        type_payload_dst,
+        phase2,
+        &unsafe_representation_src,
+        &unsafe_size_src,
+        &size_dst,
+        &phase2_inner.data_range_dst
+      )) {
+        return;
+      }
+
+      for (uint32_t i = 0; i < unsafe_representation_src.count; i++) {
+        // No overflow possible, see the `unsafe_end_offset_src` check in
+        // `SVFRT_conversion_start_sequence`.
+        uint32_t unsafe_final_offset_src = (
+          ~unsafe_representation_src.data_offset_complement +
+          i * unsafe_size_src
+        );
+
+        if (phase2) {
+          // `phase2_inner.data_range_dst` was filled by `SVFRT_conversion_tally`.
+
+          // No overflow possible:
+          //
+          // Let `C = unsafe_representation_src.count`.  We know that `i < C`.
+          // And we know that `size_dst * C` does not overflow, because
+          // `SVFRT_conversion_tally` has succeeded, see #phase2-reasonable-dst-sum.
+          phase2_inner.data_offset_dst = size_dst * i;
+        }
+
+        SVFRT_conversion_traverse_concrete_type(
+          ctx,
+          recursion_depth,
+          ctx->data_bytes,
+          unsafe_final_offset_src,
+          unsafe_type_payload_src->reference.type_tag,
+          &unsafe_type_payload_src->reference.type_payload,
+          type_payload_dst->reference.type_tag,
+          &type_payload_dst->reference.type_payload,
+          phase2 ? &phase2_inner : NULL
+        );
+
+        if (ctx->error_code) {
+          // Exit early on any error. This would include any tally limit checks,
+          // so it's fine to loop even though the count might be malicious.
+          return;
+        }
+      }
+      return;
+    }
+    case SVF_Meta_Type_tag_chunkedSequence: {
+      // Sanity check.
+      if (
+        type_tag_dst != SVF_Meta_Type_tag_chunkedSequence &&
+        type_tag_dst != SVF_Meta_Type_tag_sequence
+      ) {
+        ctx->error_code = SVFRT_code_conversion__schema_type_tag_mismatch;
+        return;
+      }
 
-      // Prevent multiply-add overflow by casting operands to `uint64_t` first. It
-      // works, because `UINT64_MAX == UINT32_MAX * UINT32_MAX + UINT32_MAX + UINT32_MAX`.
-      if (unsafe_end_offset_src > (uint64_t) UINT32_MAX) {
-        ctx->error_code = SVFRT_code_conversion__data_out_of_bounds;
+      SVFRT_Phase2_TraverseConcreteType phase2_inner = {0};
+      SVFRT_ChunkIterator unsafe_iterator;
+      uint32_t unsafe_size_src;
+      uint32_t size_dst;
+      if (!SVFRT_conversion_start_chunked_sequence(
+        ctx,
+        data_range_src,
+        unsafe_data_offset_src,
+        unsafe_type_payload_src,
+        type_tag_dst,
+        type_payload_dst,
+        phase2,
+        &unsafe_iterator,
+        &unsafe_size_src,
+        &size_dst,
+        &phase2_inner.data_range_dst
+      )) {
         return;
       }
 
-      for (uint32_t i = 0; i < unsafe_representation_src.count; i++) {
-        // No overflow possible, see the `unsafe_end_offset_src` check above.
-        uint32_t unsafe_final_offset_src = (
-          ~unsafe_representation_src.data_offset_complement +
-          i * unsafe_size_src
-        );
+      SVFRT_Sequence unsafe_chunk_src;
+      uint32_t first;
+      while (SVFRT_conversion_next_chunk(ctx, &unsafe_iterator, unsafe_size_src, &unsafe_chunk_src, &first)) {
+        for (uint32_t i = 0; i < unsafe_chunk_src.count; i++) {
+          // No overflow possible, see the bounds check in `SVFRT_conversion_next_chunk`.
+          uint32_t unsafe_final_offset_src = (
+            ~unsafe_chunk_src.data_offset_complement +
+            i * unsafe_size_src
+          );
+
+          // No overflow possible, `first + i` is less than the tallied count,
+          // see #phase2-reasonable-dst-sum.
+          phase2_inner.data_offset_dst = size_dst * (first + i);
+
+          SVFRT_conversion_traverse_concrete_type(
+            ctx,
+            recursion_depth,
+            ctx->data_bytes,
+            unsafe_final_offset_src,
+            unsafe_type_payload_src->reference.type_tag,
+            &unsafe_type_payload_src->reference.type_payload,
+            type_payload_dst->reference.type_tag,
+            &type_payload_dst->reference.type_payload,
+            phase2 ? &phase2_inner : NULL
+          );
+
+          if (ctx->error_code) {
+            return;
+          }
+        }
+      }
+      return;
+    }
+    default: {
+      ctx->error_code = SVFRT_code_conversion__bad_schema_type_tag;
+    }
+  }
+}
+
+// #iterative-conversion.
+//
+// The traversal above makes a native call per nested value, so the depth it
+// can handle is limited by the call stack, which is not under our control. With
+// `SVFRT_ITERATIVE_CONVERSION` defined, and `conversion_stack` provided in
+// `SVFRT_ReadMessageParams`, the same traversal runs as a loop instead, with
+// frames in the caller-supplied memory.
+//
+// Only structs, sequences and chunked sequences of non-primitives, and choice
+// payloads get a frame.
+// Everything else is handled in place. Same as the plan, this mirrors the
+// traversal exactly: same order of tallies, same recursion depth accounting,
+// same error codes.
+//
+// At each recursion depth, there can be at most two frames on the stack: a
+// (chunked) sequence, and a struct or choice as its element. Plus one for the entry. So
+// the stack size needed only depends on `max_recursion_depth`.
+
+// Memory for the stack should be aligned to this.
+#define SVFRT_FRAME_ALIGNMENT 8
+
+uint32_t SVFRT_conversion_stack_size(uint32_t max_recursion_depth) {
+  uint64_t frame_count = 1 + 2 * (uint64_t) max_recursion_depth;
+  uint64_t size = frame_count * (uint64_t) sizeof(SVFRT_ConversionFrame);
+  if (size > (uint64_t) UINT32_MAX) {
+    return UINT32_MAX;
+  }
+  return (uint32_t) size;
+}
+
+#ifdef SVFRT_ITERATIVE_CONVERSION
+
+// Returns NULL, if there is no space left.
+static inline
+SVFRT_ConversionFrame *SVFRT_iterative_push(
+  SVFRT_ConversionContext *ctx,
+  uint32_t kind,
+  uint32_t recursion_depth
+) {
+  if (ctx->frame_count >= ctx->frame_capacity) {
+    ctx->error_code = SVFRT_code_conversion__not_enough_stack_memory;
+    return NULL;
+  }
+
+  SVFRT_ConversionFrame *frame = ctx->frames + ctx->frame_count;
+  SVFRT_MEMSET(frame, 0, sizeof(*frame));
+  frame->kind = kind;
+  frame->recursion_depth = recursion_depth;
+  ctx->frame_count += 1;
+  return frame;
+}
+
+// Same as `SVFRT_conversion_traverse_concrete_type`, but pushes frames for
+// structs and choices instead of going into them.
+static
+void SVFRT_iterative_visit_concrete_type(
+  SVFRT_ConversionContext *ctx,
+  uint32_t recursion_depth,
+  SVFRT_Bytes data_range_src,
+  uint32_t unsafe_data_offset_src,
+  SVF_Meta_ConcreteType_tag unsafe_type_tag_src,
+  SVF_Meta_ConcreteType_payload *unsafe_type_payload_src,
+  SVF_Meta_ConcreteType_tag type_tag_dst,
+  SVF_Meta_ConcreteType_payload *type_payload_dst,
+  SVFRT_Phase2_TraverseConcreteType *phase2
+) {
+  switch (type_tag_dst) {
+    case SVF_Meta_ConcreteType_tag_definedStruct: {
+      // Sanity check.
+      if (unsafe_type_tag_src != SVF_Meta_ConcreteType_tag_definedStruct) {
+        ctx->error_code = SVFRT_code_conversion__schema_concrete_type_tag_mismatch;
+        return;
+      }
+
+      uint32_t unsafe_struct_index_src = unsafe_type_payload_src->definedStruct.index;
+      uint32_t struct_index_dst = type_payload_dst->definedStruct.index;
+
+      SVFRT_Bytes struct_bytes_src;
+      SVFRT_Bytes struct_bytes_dst = {0};
+      if (!SVFRT_conversion_locate_struct(
+        ctx,
+        unsafe_struct_index_src,
+        struct_index_dst,
+        data_range_src,
+        unsafe_data_offset_src,
+        phase2,
+        &struct_bytes_src,
+        &struct_bytes_dst
+      )) {
+        return;
+      }
+
+      SVFRT_ConversionFrame *frame = SVFRT_iterative_push(ctx, SVFRT_FRAME_STRUCT, recursion_depth);
+      if (!frame) {
+        return;
+      }
+
+      if (!SVFRT_conversion_prepare_struct(
+        ctx,
+        unsafe_struct_index_src,
+        struct_index_dst,
+        &frame->unsafe_fields_src,
+        &frame->fields_dst,
+        &frame->field_matches_index
+      )) {
+        return;
+      }
+
+      frame->count = frame->fields_dst.count;
+      frame->bytes_src = struct_bytes_src;
+      frame->bytes_dst = struct_bytes_dst;
+      return;
+    }
+    case SVF_Meta_ConcreteType_tag_definedChoice: {
+      // Sanity check.
+      if (unsafe_type_tag_src != SVF_Meta_ConcreteType_tag_definedChoice) {
+        ctx->error_code = SVFRT_code_conversion__schema_concrete_type_tag_mismatch;
+        return;
+      }
+
+      SVF_Meta_OptionDefinition *unsafe_option_src;
+      SVF_Meta_OptionDefinition *option_dst;
+      if (!SVFRT_conversion_resolve_choice(
+        ctx,
+        unsafe_type_payload_src->definedChoice.index,
+        type_payload_dst->definedChoice.index,
+        data_range_src,
+        unsafe_data_offset_src,
+        phase2,
+        &unsafe_option_src,
+        &option_dst
+      )) {
+        return;
+      }
+
+      SVFRT_ConversionFrame *frame = SVFRT_iterative_push(ctx, SVFRT_FRAME_CHOICE, recursion_depth);
+      if (!frame) {
+        return;
+      }
+
+      frame->count = 1;
+      frame->bytes_src = data_range_src;
+      frame->unsafe_offset_src = unsafe_data_offset_src + SVFRT_TAG_SIZE;
+      frame->unsafe_option_src = unsafe_option_src;
+      frame->option_dst = option_dst;
+      if (phase2) {
+        frame->bytes_dst = phase2->data_range_dst;
+        frame->offset_dst = phase2->data_offset_dst + SVFRT_TAG_SIZE;
+      }
+      return;
+    }
+    default: {
+      // Primitives, and everything else, don't go any deeper.
+      SVFRT_conversion_traverse_concrete_type(
+        ctx,
+        recursion_depth,
+        data_range_src,
+        unsafe_data_offset_src,
+        unsafe_type_tag_src,
+        unsafe_type_payload_src,
+        type_tag_dst,
+        type_payload_dst,
+        phase2
+      );
+    }
+  }
+}
+
+// Same as `SVFRT_conversion_traverse_any_type`, but pushes frames instead of
+// going deeper.
+static
+void SVFRT_iterative_visit_any_type(
+  SVFRT_ConversionContext *ctx,
+  uint32_t recursion_depth,
+  SVFRT_Bytes data_range_src,
+  uint32_t unsafe_data_offset_src,
+  SVF_Meta_Type_tag unsafe_type_tag_src,
+  SVF_Meta_Type_payload *unsafe_type_payload_src,
+  SVF_Meta_Type_tag type_tag_dst,
+  SVF_Meta_Type_payload *type_payload_dst,
+  SVFRT_Phase2_TraverseAnyType *phase2
+) {
+  recursion_depth += 1;
+  if (recursion_depth > ctx->max_recursion_depth) {
+    ctx->error_code = SVFRT_code_conversion__max_recursion_depth_exceeded;
+    return;
+  }
+
+  switch (unsafe_type_tag_src) {
+    case SVF_Meta_Type_tag_concrete: {
+      // Sanity check.
+      if (type_tag_dst != SVF_Meta_Type_tag_concrete) {
+        ctx->error_code = SVFRT_code_conversion__schema_type_tag_mismatch;
+        return;
+      }
+
+      SVFRT_Phase2_TraverseConcreteType phase2_inner = {0};
+      if (phase2) {
+        phase2_inner.data_range_dst = phase2->data_range_dst;
+        phase2_inner.data_offset_dst = phase2->data_offset_dst;
+      }
+
+      SVFRT_iterative_visit_concrete_type(
+        ctx,
+        recursion_depth,
+        data_range_src,
+        unsafe_data_offset_src,
+        unsafe_type_payload_src->concrete.type_tag,
+        &unsafe_type_payload_src->concrete.type_payload,
+        type_payload_dst->concrete.type_tag,
+        &type_payload_dst->concrete.type_payload,
+        phase2 ? &phase2_inner : NULL
+      );
+      return;
+    }
+    case SVF_Meta_Type_tag_reference: {
+      // Sanity check.
+      if (type_tag_dst != SVF_Meta_Type_tag_reference) {
+        ctx->error_code = SVFRT_code_conversion__schema_type_tag_mismatch;
+        return;
+      }
+
+      SVFRT_Phase2_TraverseConcreteType phase2_inner = {0};
+      uint32_t unsafe_final_offset_src;
+      if (!SVFRT_conversion_start_reference(
+        ctx,
+        data_range_src,
+        unsafe_data_offset_src,
+        unsafe_type_payload_src,
+        type_payload_dst,
+        phase2,
+        &unsafe_final_offset_src,
+        &phase2_inner.data_range_dst
+      )) {
+        return;
+      }
+
+      SVFRT_iterative_visit_concrete_type(
+        ctx,
+        recursion_depth,
+        ctx->data_bytes,
+        unsafe_final_offset_src,
+        unsafe_type_payload_src->reference.type_tag,
+        &unsafe_type_payload_src->reference.type_payload,
+        type_payload_dst->reference.type_tag,
+        &type_payload_dst->reference.type_payload,
+        phase2 ? &phase2_inner : NULL
+      );
+      return;
+    }
+    case SVF_Meta_Type_tag_sequence: {
+      // Sanity check.
+      if (type_tag_dst != SVF_Meta_Type_tag_sequence) {
+        ctx->error_code = SVFRT_code_conversion__schema_type_tag_mismatch;
+        return;
+      }
+
+      SVFRT_Sequence unsafe_representation_src;
+      uint32_t unsafe_size_src;
+      uint32_t size_dst;
+      SVFRT_Bytes suballocation_dst = {0};
+      if (!SVFRT_conversion_start_sequence(
+        ctx,
+        data_range_src,
+        unsafe_data_offset_src,
+        unsafe_type_payload_src,
+        type_payload_dst,
+        phase2,
+        &unsafe_representation_src,
+        &unsafe_size_src,
+        &size_dst,
+        &suballocation_dst
+      )) {
+        return;
+      }
+
+      SVFRT_ConversionFrame *frame = SVFRT_iterative_push(ctx, SVFRT_FRAME_SEQUENCE, recursion_depth);
+      if (!frame) {
+        return;
+      }
+
+      frame->count = unsafe_representation_src.count;
+      frame->bytes_dst = suballocation_dst;
+      frame->unsafe_offset_src = ~unsafe_representation_src.data_offset_complement;
+      frame->unsafe_size_src = unsafe_size_src;
+      frame->size_dst = size_dst;
+      frame->unsafe_type_payload_src = unsafe_type_payload_src;
+      frame->type_payload_dst = type_payload_dst;
+      return;
+    }
+    case SVF_Meta_Type_tag_chunkedSequence: {
+      // Sanity check.
+      if (
+        type_tag_dst != SVF_Meta_Type_tag_chunkedSequence &&
+        type_tag_dst != SVF_Meta_Type_tag_sequence
+      ) {
+        ctx->error_code = SVFRT_code_conversion__schema_type_tag_mismatch;
+        return;
+      }
+
+      SVFRT_ChunkIterator unsafe_iterator;
+      uint32_t unsafe_size_src;
+      uint32_t size_dst;
+      SVFRT_Bytes suballocation_dst = {0};
+      if (!SVFRT_conversion_start_chunked_sequence(
+        ctx,
+        data_range_src,
+        unsafe_data_offset_src,
+        unsafe_type_payload_src,
+        type_tag_dst,
+        type_payload_dst,
+        phase2,
+        &unsafe_iterator,
+        &unsafe_size_src,
+        &size_dst,
+        &suballocation_dst
+      )) {
+        return;
+      }
+
+      SVFRT_ConversionFrame *frame = SVFRT_iterative_push(ctx, SVFRT_FRAME_CHUNKED_SEQUENCE, recursion_depth);
+      if (!frame) {
+        return;
+      }
+
+      // `count` is the current chunk, and it's empty until the first one is
+      // read when running the frame.
+      frame->bytes_dst = suballocation_dst;
+      frame->unsafe_size_src = unsafe_size_src;
+      frame->size_dst = size_dst;
+      frame->unsafe_type_payload_src = unsafe_type_payload_src;
+      frame->type_payload_dst = type_payload_dst;
+      frame->unsafe_chunk_iterator = unsafe_iterator;
+      return;
+    }
+    default: {
+      ctx->error_code = SVFRT_code_conversion__bad_schema_type_tag;
+    }
+  }
+}
+
+// Same as `SVFRT_conversion_traverse_struct` on the entry, but with a loop. This
+// only pushes the entry frame, see `SVFRT_iterative_step` for the loop.
+static
+void SVFRT_iterative_begin_entry(
+  SVFRT_ConversionContext *ctx,
+  SVFRT_Bytes entry_bytes_src,
+  SVFRT_Bytes *phase2_entry_bytes_dst
+) {
+  ctx->frame_count = 0;
+
+  SVFRT_ConversionFrame *entry_frame = SVFRT_iterative_push(ctx, SVFRT_FRAME_STRUCT, 0);
+  if (!entry_frame) {
+    return;
+  }
+
+  if (!SVFRT_conversion_prepare_struct(
+    ctx,
+    ctx->info->entry_struct_index_src,
+    ctx->info->entry_struct_index_dst,
+    &entry_frame->unsafe_fields_src,
+    &entry_frame->fields_dst,
+    &entry_frame->field_matches_index
+  )) {
+    return;
+  }
+
+  entry_frame->count = entry_frame->fields_dst.count;
+  entry_frame->bytes_src = entry_bytes_src;
+  if (phase2_entry_bytes_dst) {
+    entry_frame->bytes_dst = *phase2_entry_bytes_dst;
+  }
+}
+
+// Run the loop until the stack is empty, or until `*inout_budget` runs out.
+// Each iteration visits one field, element, or chunk, and costs one unit of
+// the budget. Returns true, if the phase is done (or failed).
+static
+bool SVFRT_iterative_step(
+  SVFRT_ConversionContext *ctx,
+  bool phase2,
+  uint32_t *inout_budget
+) {
+  while (ctx->frame_count && !ctx->error_code) {
+    if (*inout_budget == 0) {
+      return false;
+    }
+    *inout_budget -= 1;
+
+    SVFRT_ConversionFrame *frame = ctx->frames + ctx->frame_count - 1;
+
+    if (frame->next_index >= frame->count) {
+      // Chunked sequences go on with the next chunk, if there is one.
+      if (frame->kind == SVFRT_FRAME_CHUNKED_SEQUENCE) {
+        SVFRT_Sequence unsafe_chunk_src;
+        if (SVFRT_conversion_next_chunk(
+          ctx,
+          &frame->unsafe_chunk_iterator,
+          frame->unsafe_size_src,
+          &unsafe_chunk_src,
+          &frame->offset_dst
+        )) {
+          frame->next_index = 0;
+          frame->count = unsafe_chunk_src.count;
+          frame->unsafe_offset_src = ~unsafe_chunk_src.data_offset_complement;
+          continue;
+        }
+      }
+
+      ctx->frame_count -= 1;
+      continue;
+    }
+
+    uint32_t i = frame->next_index;
+    frame->next_index += 1;
+
+    switch (frame->kind) {
+      case SVFRT_FRAME_STRUCT: {
+        SVF_Meta_FieldDefinition *field_dst = frame->fields_dst.pointer + i;
+        SVF_Meta_FieldDefinition *unsafe_field_src = SVFRT_conversion_match_field(
+          ctx,
+          frame->unsafe_fields_src,
+          frame->fields_dst,
+          frame->field_matches_index,
+          i
+        );
+        if (!unsafe_field_src) {
+          break;
+        }
+
+        SVFRT_Phase2_TraverseAnyType phase2_inner = {0};
+        phase2_inner.data_range_dst = frame->bytes_dst;
+        phase2_inner.data_offset_dst = field_dst->offset;
+
+        SVFRT_iterative_visit_any_type(
+          ctx,
+          frame->recursion_depth,
+          frame->bytes_src,
+          unsafe_field_src->offset,
+          unsafe_field_src->type_tag,
+          &unsafe_field_src->type_payload,
+          field_dst->type_tag,
+          &field_dst->type_payload,
+          phase2 ? &phase2_inner : NULL
+        );
+        break;
+      }
+      case SVFRT_FRAME_SEQUENCE: {
+        // No overflow possible, see the `unsafe_end_offset_src` check in
+        // `SVFRT_conversion_start_sequence`, and #phase2-reasonable-dst-sum.
+        SVFRT_Phase2_TraverseConcreteType phase2_inner = {0};
+        phase2_inner.data_range_dst = frame->bytes_dst;
+        phase2_inner.data_offset_dst = frame->size_dst * i;
+
+        SVFRT_iterative_visit_concrete_type(
+          ctx,
+          frame->recursion_depth,
+          ctx->data_bytes,
+          frame->unsafe_offset_src + i * frame->unsafe_size_src,
+          frame->unsafe_type_payload_src->reference.type_tag,
+          &frame->unsafe_type_payload_src->reference.type_payload,
+          frame->type_payload_dst->reference.type_tag,
+          &frame->type_payload_dst->reference.type_payload,
+          phase2 ? &phase2_inner : NULL
+        );
+        break;
+      }
+      case SVFRT_FRAME_CHUNKED_SEQUENCE: {
+        // No overflow possible, see the bounds check in `SVFRT_conversion_next_chunk`,
+        // and #phase2-reasonable-dst-sum.
+        SVFRT_Phase2_TraverseConcreteType phase2_inner = {0};
+        phase2_inner.data_range_dst = frame->bytes_dst;
+        phase2_inner.data_offset_dst = frame->size_dst * (frame->offset_dst + i);
+
+        SVFRT_iterative_visit_concrete_type(
+          ctx,
+          frame->recursion_depth,
+          ctx->data_bytes,
+          frame->unsafe_offset_src + i * frame->unsafe_size_src,
+          frame->unsafe_type_payload_src->reference.type_tag,
+          &frame->unsafe_type_payload_src->reference.type_payload,
+          frame->type_payload_dst->reference.type_tag,
+          &frame->type_payload_dst->reference.type_payload,
+          phase2 ? &phase2_inner : NULL
+        );
+        break;
+      }
+      case SVFRT_FRAME_CHOICE: {
+        SVFRT_Phase2_TraverseAnyType phase2_inner = {0};
+        phase2_inner.data_range_dst = frame->bytes_dst;
+        phase2_inner.data_offset_dst = frame->offset_dst;
+
+        SVFRT_iterative_visit_any_type(
+          ctx,
+          frame->recursion_depth,
+          frame->bytes_src,
+          frame->unsafe_offset_src,
+          frame->unsafe_option_src->type_tag,
+          &frame->unsafe_option_src->type_payload,
+          frame->option_dst->type_tag,
+          &frame->option_dst->type_payload,
+          phase2 ? &phase2_inner : NULL
+        );
+        break;
+      }
+    }
+  }
+
+  return true;
+}
+
+#endif // SVFRT_ITERATIVE_CONVERSION
+
+// #conversion-plan.
+//
+// Interpreting the schemas (see the traversal functions above) means switching
+// on type tags and resolving definitions for every single value. A conversion
+// plan is the same traversal, compiled once per pair of schemas into a flat
+// stream of operations, so that converting each message only walks the data.
+//
+// The plan is an array of `uint32_t` words:
+//
+// - Header: `SVFRT_PLAN_HEADER_WORDS` words, see `SVFRT_PLAN_HEADER_*`.
+// - Per dst-struct: matched src-struct index (or `UINT32_MAX`).
+// - Per dst-struct: routine offset (or 0 if unreachable).
+// - Per dst-choice: matched src-choice index (or `UINT32_MAX`).
+// - Per dst-choice: choice table offset (or 0 if unreachable).
+// - Routines and choice tables.
+//
+// A routine is a header (`SVFRT_PLAN_ROUTINE_*`) followed by ops. A choice
+// table is an entry count, followed by entries: a header (`SVFRT_PLAN_ENTRY_*`)
+// followed by ops for the option payload. Each op starts with an opcode, and
+// then src- and dst-offsets relative to the current base.
+//
+// Execution mirrors the traversal exactly: same order of tallies (and so, the
+// same output layout), same recursion depth accounting, same error codes. All
+// offsets and indices from the plan are bounds-checked during execution, so a
+// plan can't cause out-of-bounds access, even if it's wrong.
+
+#define SVFRT_PLAN_HEADER_WORD_COUNT 0
+#define SVFRT_PLAN_HEADER_STRUCT_COUNT 1
+#define SVFRT_PLAN_HEADER_CHOICE_COUNT 2
+// Largest `size_dst / size_src` of any reference or sequence element, as a
+// fraction. See #single-pass-conversion.
+#define SVFRT_PLAN_HEADER_GROWTH_SIZE_DST 3
+#define SVFRT_PLAN_HEADER_GROWTH_SIZE_SRC 4
+#define SVFRT_PLAN_HEADER_WORDS 6
+
+#define SVFRT_PLAN_ROUTINE_SIZE_SRC 0
+#define SVFRT_PLAN_ROUTINE_SIZE_DST 1
+#define SVFRT_PLAN_ROUTINE_FLAGS 2
+#define SVFRT_PLAN_ROUTINE_OP_WORDS 3
+#define SVFRT_PLAN_ROUTINE_WORDS 4
+
+#define SVFRT_PLAN_ENTRY_TAG_SRC 0
+#define SVFRT_PLAN_ENTRY_TAG_DST 1
+#define SVFRT_PLAN_ENTRY_CONVERT 2
+#define SVFRT_PLAN_ENTRY_OP_WORDS 3
+#define SVFRT_PLAN_ENTRY_WORDS 4
+
+// Routine contains references, sequences or choices (possibly nested), so it
+// has something to do in Phase 1.
+#define SVFRT_PLAN_FLAG_INDIRECT 1
+
+// Routine is a single copy of the whole struct, so a sequence of these structs
+// can be copied all at once.
+#define SVFRT_PLAN_FLAG_MEMCPY 2
+
+// [opcode, offset_src, offset_dst, size].
+#define SVFRT_PLAN_OP_COPY 1
+// [opcode, offset_src, offset_dst, widening].
+#define SVFRT_PLAN_OP_WIDEN 2
+// [opcode, offset_src, offset_dst, struct_index_dst].
+#define SVFRT_PLAN_OP_STRUCT 3
+// [opcode, offset_src, offset_dst, choice_index_dst].
+#define SVFRT_PLAN_OP_CHOICE 4
+// [opcode, offset_src, offset_dst, element_kind, element_arg, size_src, size_dst].
+#define SVFRT_PLAN_OP_REFERENCE 5
+#define SVFRT_PLAN_OP_SEQUENCE 6
+
+#define SVFRT_PLAN_ELEMENT_STRUCT 1 // `element_arg` is the dst-struct index.
+#define SVFRT_PLAN_ELEMENT_COPY 2   // `element_arg` is unused.
+#define SVFRT_PLAN_ELEMENT_WIDEN 3  // `element_arg` is the widening.
+
+// Upper bounds for the size of ops and choice entries.
+#define SVFRT_PLAN_MAX_OP_WORDS 7
+#define SVFRT_PLAN_MAX_ENTRY_WORDS (SVFRT_PLAN_ENTRY_WORDS + SVFRT_PLAN_MAX_OP_WORDS)
+
+static inline
+uint32_t SVFRT_plan_get_op_words(uint32_t opcode) {
+  switch (opcode) {
+    case SVFRT_PLAN_OP_COPY:
+    case SVFRT_PLAN_OP_WIDEN:
+    case SVFRT_PLAN_OP_STRUCT:
+    case SVFRT_PLAN_OP_CHOICE: {
+      return 4;
+    }
+    case SVFRT_PLAN_OP_REFERENCE:
+    case SVFRT_PLAN_OP_SEQUENCE: {
+      return 7;
+    }
+    default: {
+      return 0;
+    }
+  }
+}
+
+typedef struct SVFRT_PlanCompileContext {
+  SVFRT_LogicalCompatibilityInfo *info;
+
+  SVFRT_RangeStructDefinition unsafe_structs_src;
+  SVFRT_RangeStructDefinition structs_dst;
+
+  SVFRT_RangeChoiceDefinition unsafe_choices_src;
+  SVFRT_RangeChoiceDefinition choices_dst;
+
+  SVFRT_RangeU32 words;
+  uint32_t word_count;
+
+  // Word index of the last op, if it is a copy, otherwise 0. Used to merge
+  // adjacent copies into one.
+  uint32_t last_copy;
+
+  // See `SVFRT_PLAN_HEADER_GROWTH_SIZE_DST`.
+  uint32_t growth_size_dst;
+  uint32_t growth_size_src;
+
+  bool failed;
+} SVFRT_PlanCompileContext;
+
+static inline
+uint32_t *SVFRT_plan_emit(SVFRT_PlanCompileContext *ctx, uint32_t count) {
+  if ((uint64_t) ctx->word_count + (uint64_t) count > (uint64_t) ctx->words.count) {
+    ctx->failed = true;
+    return NULL;
+  }
+  uint32_t *result = ctx->words.pointer + ctx->word_count;
+  ctx->word_count += count;
+  ctx->last_copy = 0;
+  return result;
+}
+
+// Make sure the pair gets a routine. Each dst-struct can only match a single
+// src-struct, which the compatibility check ensures.
+static inline
+void SVFRT_plan_request_struct(
+  SVFRT_PlanCompileContext *ctx,
+  uint32_t unsafe_struct_index_src,
+  uint32_t struct_index_dst
+) {
+  if (unsafe_struct_index_src >= ctx->unsafe_structs_src.count || struct_index_dst >= ctx->structs_dst.count) {
+    ctx->failed = true;
+    return;
+  }
+  uint32_t *matched = ctx->words.pointer + SVFRT_PLAN_HEADER_WORDS + struct_index_dst;
+  if (*matched == UINT32_MAX) {
+    *matched = unsafe_struct_index_src;
+  } else if (*matched != unsafe_struct_index_src) {
+    ctx->failed = true;
+  }
+}
+
+static inline
+void SVFRT_plan_request_choice(
+  SVFRT_PlanCompileContext *ctx,
+  uint32_t unsafe_choice_index_src,
+  uint32_t choice_index_dst
+) {
+  if (unsafe_choice_index_src >= ctx->unsafe_choices_src.count || choice_index_dst >= ctx->choices_dst.count) {
+    ctx->failed = true;
+    return;
+  }
+  uint32_t *matched = ctx->words.pointer + SVFRT_PLAN_HEADER_WORDS + 2 * ctx->structs_dst.count + choice_index_dst;
+  if (*matched == UINT32_MAX) {
+    *matched = unsafe_choice_index_src;
+  } else if (*matched != unsafe_choice_index_src) {
+    ctx->failed = true;
+  }
+}
+
+void SVFRT_plan_compile_concrete_type(
+  SVFRT_PlanCompileContext *ctx,
+  uint32_t unsafe_offset_src,
+  uint32_t offset_dst,
+  SVF_Meta_ConcreteType_tag unsafe_type_tag_src,
+  SVF_Meta_ConcreteType_payload *unsafe_type_payload_src,
+  SVF_Meta_ConcreteType_tag type_tag_dst,
+  SVF_Meta_ConcreteType_payload *type_payload_dst
+) {
+  switch (type_tag_dst) {
+    case SVF_Meta_ConcreteType_tag_definedStruct:
+    case SVF_Meta_ConcreteType_tag_definedChoice: {
+      if (unsafe_type_tag_src != type_tag_dst) {
+        ctx->failed = true;
+        return;
+      }
+
+      bool is_struct = type_tag_dst == SVF_Meta_ConcreteType_tag_definedStruct;
+      uint32_t index_dst;
+      if (is_struct) {
+        index_dst = type_payload_dst->definedStruct.index;
+        SVFRT_plan_request_struct(ctx, unsafe_type_payload_src->definedStruct.index, index_dst);
+      } else {
+        index_dst = type_payload_dst->definedChoice.index;
+        SVFRT_plan_request_choice(ctx, unsafe_type_payload_src->definedChoice.index, index_dst);
+      }
+
+      uint32_t *op = SVFRT_plan_emit(ctx, 4);
+      if (!op) return;
+      op[0] = is_struct ? SVFRT_PLAN_OP_STRUCT : SVFRT_PLAN_OP_CHOICE;
+      op[1] = unsafe_offset_src;
+      op[2] = offset_dst;
+      op[3] = index_dst;
+      return;
+    }
+    case SVF_Meta_ConcreteType_tag_nothing: {
+      if (unsafe_type_tag_src != SVF_Meta_ConcreteType_tag_nothing) {
+        ctx->failed = true;
+      }
+      return;
+    }
+    default: {
+      if (unsafe_type_tag_src == type_tag_dst) {
+        uint32_t size = SVFRT_conversion_get_type_size(ctx->structs_dst, type_tag_dst, type_payload_dst);
+        if (size == 0) {
+          ctx->failed = true;
+          return;
+        }
+
+        // Extend the previous copy, if it's adjacent in both src and dst.
+        if (ctx->last_copy) {
+          uint32_t *previous = ctx->words.pointer + ctx->last_copy;
+          if (
+            (uint64_t) previous[1] + (uint64_t) previous[3] == (uint64_t) unsafe_offset_src &&
+            (uint64_t) previous[2] + (uint64_t) previous[3] == (uint64_t) offset_dst
+          ) {
+            previous[3] += size;
+            return;
+          }
+        }
+
+        uint32_t *op = SVFRT_plan_emit(ctx, 4);
+        if (!op) return;
+        op[0] = SVFRT_PLAN_OP_COPY;
+        op[1] = unsafe_offset_src;
+        op[2] = offset_dst;
+        op[3] = size;
+        ctx->last_copy = (uint32_t) (op - ctx->words.pointer);
+        return;
+      }
+
+      uint32_t widening = SVFRT_conversion_get_widening(unsafe_type_tag_src, type_tag_dst);
+      if (widening == 0) {
+        ctx->failed = true;
+        return;
+      }
+
+      uint32_t *op = SVFRT_plan_emit(ctx, 4);
+      if (!op) return;
+      op[0] = SVFRT_PLAN_OP_WIDEN;
+      op[1] = unsafe_offset_src;
+      op[2] = offset_dst;
+      op[3] = widening;
+      return;
+    }
+  }
+}
+
+void SVFRT_plan_compile_any_type(
+  SVFRT_PlanCompileContext *ctx,
+  uint32_t unsafe_offset_src,
+  uint32_t offset_dst,
+  SVF_Meta_Type_tag unsafe_type_tag_src,
+  SVF_Meta_Type_payload *unsafe_type_payload_src,
+  SVF_Meta_Type_tag type_tag_dst,
+  SVF_Meta_Type_payload *type_payload_dst
+) {
+  if (unsafe_type_tag_src != type_tag_dst) {
+    ctx->failed = true;
+    return;
+  }
+
+  switch (type_tag_dst) {
+    case SVF_Meta_Type_tag_concrete: {
+      SVFRT_plan_compile_concrete_type(
+        ctx,
+        unsafe_offset_src,
+        offset_dst,
+        unsafe_type_payload_src->concrete.type_tag,
+        &unsafe_type_payload_src->concrete.type_payload,
+        type_payload_dst->concrete.type_tag,
+        &type_payload_dst->concrete.type_payload
+      );
+      return;
+    }
+    case SVF_Meta_Type_tag_reference:
+    case SVF_Meta_Type_tag_sequence: {
+      // Note: sequence payloads are laid out the same as reference payloads.
+      SVF_Meta_ConcreteType_tag unsafe_element_tag_src = unsafe_type_payload_src->reference.type_tag;
+      SVF_Meta_ConcreteType_tag element_tag_dst = type_payload_dst->reference.type_tag;
+
+      uint32_t unsafe_size_src = SVFRT_conversion_get_type_size(
+        ctx->unsafe_structs_src,
+        unsafe_element_tag_src,
+        &unsafe_type_payload_src->reference.type_payload
+      );
+      uint32_t size_dst = SVFRT_conversion_get_type_size(
+        ctx->structs_dst,
+        element_tag_dst,
+        &type_payload_dst->reference.type_payload
+      );
+      if (unsafe_size_src == 0 || size_dst == 0) {
+        ctx->failed = true;
+        return;
+      }
+
+      uint32_t element_kind;
+      uint32_t element_arg = 0;
+      if (element_tag_dst == SVF_Meta_ConcreteType_tag_definedStruct) {
+        if (unsafe_element_tag_src != SVF_Meta_ConcreteType_tag_definedStruct) {
+          ctx->failed = true;
+          return;
+        }
+        element_kind = SVFRT_PLAN_ELEMENT_STRUCT;
+        element_arg = type_payload_dst->reference.type_payload.definedStruct.index;
+        SVFRT_plan_request_struct(
+          ctx,
+          unsafe_type_payload_src->reference.type_payload.definedStruct.index,
+          element_arg
+        );
+      } else if (unsafe_element_tag_src == element_tag_dst) {
+        element_kind = SVFRT_PLAN_ELEMENT_COPY;
+      } else {
+        element_kind = SVFRT_PLAN_ELEMENT_WIDEN;
+        element_arg = SVFRT_conversion_get_widening(unsafe_element_tag_src, element_tag_dst);
+        if (element_arg == 0) {
+          ctx->failed = true;
+          return;
+        }
+      }
+
+      // Compare the fractions without dividing. Sizes are non-zero here.
+      if ((uint64_t) size_dst * (uint64_t) ctx->growth_size_src > (uint64_t) ctx->growth_size_dst * (uint64_t) unsafe_size_src) {
+        ctx->growth_size_dst = size_dst;
+        ctx->growth_size_src = unsafe_size_src;
+      }
+
+      uint32_t *op = SVFRT_plan_emit(ctx, 7);
+      if (!op) return;
+      op[0] = type_tag_dst == SVF_Meta_Type_tag_reference ? SVFRT_PLAN_OP_REFERENCE : SVFRT_PLAN_OP_SEQUENCE;
+      op[1] = unsafe_offset_src;
+      op[2] = offset_dst;
+      op[3] = element_kind;
+      op[4] = element_arg;
+      op[5] = unsafe_size_src;
+      op[6] = size_dst;
+      return;
+    }
+    default: {
+      // Also #chunked-sequences, which are only converted by the traversal.
+      ctx->failed = true;
+      return;
+    }
+  }
+}
+
+void SVFRT_plan_compile_struct(SVFRT_PlanCompileContext *ctx, uint32_t struct_index_dst) {
+  uint32_t *table = ctx->words.pointer + SVFRT_PLAN_HEADER_WORDS;
+  uint32_t unsafe_struct_index_src = table[struct_index_dst];
+
+  SVF_Meta_StructDefinition *unsafe_definition_src = ctx->unsafe_structs_src.pointer + unsafe_struct_index_src;
+  SVF_Meta_StructDefinition *definition_dst = ctx->structs_dst.pointer + struct_index_dst;
+
+  SVFRT_RangeFieldDefinition unsafe_fields_src = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
+    ctx->info->unsafe_schema_src,
+    unsafe_definition_src->fields,
+    SVF_Meta_FieldDefinition
+  );
+  SVFRT_RangeFieldDefinition fields_dst = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
+    ctx->info->schema_dst,
+    definition_dst->fields,
+    SVF_Meta_FieldDefinition
+  );
+  if ((!unsafe_fields_src.pointer && unsafe_fields_src.count) || (!fields_dst.pointer && fields_dst.count)) {
+    ctx->failed = true;
+    return;
+  }
+
+  if (struct_index_dst >= ctx->info->field_matches_header.count) {
+    ctx->failed = true;
+    return;
+  }
+  uint32_t field_matches_index = ctx->info->field_matches_header.pointer[struct_index_dst];
+  if ((uint64_t) field_matches_index + (uint64_t) fields_dst.count > (uint64_t) ctx->info->field_matches.count) {
+    ctx->failed = true;
+    return;
+  }
+
+  uint32_t *routine = SVFRT_plan_emit(ctx, SVFRT_PLAN_ROUTINE_WORDS);
+  if (!routine) return;
+  uint32_t routine_offset = (uint32_t) (routine - ctx->words.pointer);
+  routine[SVFRT_PLAN_ROUTINE_SIZE_SRC] = unsafe_definition_src->size;
+  routine[SVFRT_PLAN_ROUTINE_SIZE_DST] = definition_dst->size;
+  routine[SVFRT_PLAN_ROUTINE_FLAGS] = 0;
+  routine[SVFRT_PLAN_ROUTINE_OP_WORDS] = 0;
+  table[ctx->structs_dst.count + struct_index_dst] = routine_offset;
+
+  // Same as `SVFRT_conversion_traverse_struct`.
+  for (uint32_t i = 0; i < fields_dst.count; i++) {
+    SVF_Meta_FieldDefinition *field_dst = fields_dst.pointer + i;
+
+    if (field_dst->removed) {
+      continue;
+    }
+
+    uint32_t j = ctx->info->field_matches.pointer[field_matches_index + i];
+    if (j == UINT32_MAX) {
+      continue;
+    }
+
+    if (j >= unsafe_fields_src.count) {
+      ctx->failed = true;
+      return;
+    }
+
+    SVF_Meta_FieldDefinition *unsafe_field_src = unsafe_fields_src.pointer + j;
+    if (unsafe_field_src->fieldId != field_dst->fieldId) {
+      ctx->failed = true;
+      return;
+    }
+
+    SVFRT_plan_compile_any_type(
+      ctx,
+      unsafe_field_src->offset,
+      field_dst->offset,
+      unsafe_field_src->type_tag,
+      &unsafe_field_src->type_payload,
+      field_dst->type_tag,
+      &field_dst->type_payload
+    );
+    if (ctx->failed) {
+      return;
+    }
+  }
+
+  // Note: `routine` pointer is still valid, as `ctx->words` never moves.
+  routine[SVFRT_PLAN_ROUTINE_OP_WORDS] = ctx->word_count - routine_offset - SVFRT_PLAN_ROUTINE_WORDS;
+}
+
+void SVFRT_plan_compile_choice(SVFRT_PlanCompileContext *ctx, uint32_t choice_index_dst) {
+  uint32_t *table = ctx->words.pointer + SVFRT_PLAN_HEADER_WORDS + 2 * ctx->structs_dst.count;
+  uint32_t unsafe_choice_index_src = table[choice_index_dst];
+
+  SVF_Meta_ChoiceDefinition *unsafe_definition_src = ctx->unsafe_choices_src.pointer + unsafe_choice_index_src;
+  SVF_Meta_ChoiceDefinition *definition_dst = ctx->choices_dst.pointer + choice_index_dst;
+
+  SVFRT_RangeOptionDefinition unsafe_options_src = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
+    ctx->info->unsafe_schema_src,
+    unsafe_definition_src->options,
+    SVF_Meta_OptionDefinition
+  );
+  SVFRT_RangeOptionDefinition options_dst = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
+    ctx->info->schema_dst,
+    definition_dst->options,
+    SVF_Meta_OptionDefinition
+  );
+  if ((!unsafe_options_src.pointer && unsafe_options_src.count) || (!options_dst.pointer && options_dst.count)) {
+    ctx->failed = true;
+    return;
+  }
+
+  if (choice_index_dst >= ctx->info->option_matches_header.count) {
+    ctx->failed = true;
+    return;
+  }
+  uint32_t option_matches_index = ctx->info->option_matches_header.pointer[choice_index_dst];
+  if (
+    (uint64_t) option_matches_index + (uint64_t) options_dst.count > (uint64_t) ctx->info->option_matches.count ||
+    (uint64_t) option_matches_index + (uint64_t) options_dst.count > (uint64_t) ctx->info->option_matches_tags.count
+  ) {
+    ctx->failed = true;
+    return;
+  }
+
+  uint32_t *entry_count = SVFRT_plan_emit(ctx, 1);
+  if (!entry_count) return;
+  uint32_t table_offset = (uint32_t) (entry_count - ctx->words.pointer);
+  *entry_count = 0;
+  table[ctx->choices_dst.count + choice_index_dst] = table_offset;
+
+  // Same as `SVFRT_conversion_traverse_choice`. Entries are kept in order, and
+  // the last match wins during execution.
+  for (uint32_t i = 0; i < options_dst.count; i++) {
+    uint8_t src_tag = ctx->info->option_matches_tags.pointer[option_matches_index + i];
+    if (!src_tag) {
+      continue;
+    }
+
+    uint32_t src_index = ctx->info->option_matches.pointer[option_matches_index + i];
+    if (src_index >= unsafe_options_src.count) {
+      ctx->failed = true;
+      return;
+    }
+
+    SVF_Meta_OptionDefinition *unsafe_option_src = unsafe_options_src.pointer + src_index;
+    SVF_Meta_OptionDefinition *option_dst = options_dst.pointer + i;
+
+    uint32_t *entry = SVFRT_plan_emit(ctx, SVFRT_PLAN_ENTRY_WORDS);
+    if (!entry) return;
+    uint32_t entry_offset = (uint32_t) (entry - ctx->words.pointer);
+    entry[SVFRT_PLAN_ENTRY_TAG_SRC] = src_tag;
+    entry[SVFRT_PLAN_ENTRY_TAG_DST] = option_dst->tag;
+    entry[SVFRT_PLAN_ENTRY_CONVERT] = !unsafe_option_src->removed && !option_dst->removed;
+    entry[SVFRT_PLAN_ENTRY_OP_WORDS] = 0;
+
+    if (entry[SVFRT_PLAN_ENTRY_CONVERT]) {
+      // Offsets are relative to the payload, i.e. right after the tag.
+      SVFRT_plan_compile_any_type(
+        ctx,
+        0,
+        0,
+        unsafe_option_src->type_tag,
+        &unsafe_option_src->type_payload,
+        option_dst->type_tag,
+        &option_dst->type_payload
+      );
+      if (ctx->failed) {
+        return;
+      }
+    }
+
+    entry[SVFRT_PLAN_ENTRY_OP_WORDS] = ctx->word_count - entry_offset - SVFRT_PLAN_ENTRY_WORDS;
+    *entry_count += 1;
+  }
+}
+
+uint32_t SVFRT_conversion_plan_max_words(SVFRT_LogicalCompatibilityInfo *info) {
+  SVFRT_RangeStructDefinition structs_dst = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
+    info->schema_dst,
+    info->definition_dst->structs,
+    SVF_Meta_StructDefinition
+  );
+  SVFRT_RangeChoiceDefinition choices_dst = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
+    info->schema_dst,
+    info->definition_dst->choices,
+    SVF_Meta_ChoiceDefinition
+  );
+  if ((!structs_dst.pointer && structs_dst.count) || (!choices_dst.pointer && choices_dst.count)) {
+    return 0;
+  }
+
+  uint64_t total = SVFRT_PLAN_HEADER_WORDS + 2 * (uint64_t) structs_dst.count + 2 * (uint64_t) choices_dst.count;
+  for (uint32_t i = 0; i < structs_dst.count; i++) {
+    total += SVFRT_PLAN_ROUTINE_WORDS + SVFRT_PLAN_MAX_OP_WORDS * (uint64_t) structs_dst.pointer[i].fields.count;
+  }
+  for (uint32_t i = 0; i < choices_dst.count; i++) {
+    total += 1 + SVFRT_PLAN_MAX_ENTRY_WORDS * (uint64_t) choices_dst.pointer[i].options.count;
+  }
+
+  if (total > (uint64_t) UINT32_MAX / sizeof(uint32_t)) {
+    return 0;
+  }
+  return (uint32_t) total;
+}
+
+bool SVFRT_conversion_plan_compile(
+  SVFRT_RangeU32 *out_plan,
+  SVFRT_LogicalCompatibilityInfo *info,
+  SVFRT_RangeU32 memory
+) {
+  out_plan->pointer = NULL;
+  out_plan->count = 0;
+
+  SVFRT_PlanCompileContext ctx_val = {0};
+  ctx_val.info = info;
+  ctx_val.words = memory;
+  ctx_val.growth_size_dst = 0;
+  ctx_val.growth_size_src = 1;
+  SVFRT_PlanCompileContext *ctx = &ctx_val;
+
+  SVFRT_RangeStructDefinition unsafe_structs_src = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
+    info->unsafe_schema_src,
+    info->unsafe_definition_src->structs,
+    SVF_Meta_StructDefinition
+  );
+  SVFRT_RangeStructDefinition structs_dst = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
+    info->schema_dst,
+    info->definition_dst->structs,
+    SVF_Meta_StructDefinition
+  );
+  SVFRT_RangeChoiceDefinition unsafe_choices_src = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
+    info->unsafe_schema_src,
+    info->unsafe_definition_src->choices,
+    SVF_Meta_ChoiceDefinition
+  );
+  SVFRT_RangeChoiceDefinition choices_dst = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
+    info->schema_dst,
+    info->definition_dst->choices,
+    SVF_Meta_ChoiceDefinition
+  );
+  ctx->unsafe_structs_src = unsafe_structs_src;
+  ctx->structs_dst = structs_dst;
+  ctx->unsafe_choices_src = unsafe_choices_src;
+  ctx->choices_dst = choices_dst;
+  if (0
+    || (!ctx->unsafe_structs_src.pointer && ctx->unsafe_structs_src.count)
+    || (!ctx->structs_dst.pointer && ctx->structs_dst.count)
+    || (!ctx->unsafe_choices_src.pointer && ctx->unsafe_choices_src.count)
+    || (!ctx->choices_dst.pointer && ctx->choices_dst.count)
+  ) {
+    return false;
+  }
+
+  uint32_t struct_count = ctx->structs_dst.count;
+  uint32_t choice_count = ctx->choices_dst.count;
+  uint32_t *header = SVFRT_plan_emit(ctx, SVFRT_PLAN_HEADER_WORDS + 2 * struct_count + 2 * choice_count);
+  if (!header) {
+    return false;
+  }
+  header[SVFRT_PLAN_HEADER_WORD_COUNT] = 0;
+  header[SVFRT_PLAN_HEADER_STRUCT_COUNT] = struct_count;
+  header[SVFRT_PLAN_HEADER_CHOICE_COUNT] = choice_count;
+  header[SVFRT_PLAN_HEADER_GROWTH_SIZE_DST] = 0;
+  header[SVFRT_PLAN_HEADER_GROWTH_SIZE_SRC] = 0;
+  header[5] = 0;
+
+  uint32_t *struct_table = header + SVFRT_PLAN_HEADER_WORDS;
+  uint32_t *choice_table = struct_table + 2 * struct_count;
+  for (uint32_t i = 0; i < struct_count; i++) {
+    struct_table[i] = UINT32_MAX;
+    struct_table[struct_count + i] = 0;
+  }
+  for (uint32_t i = 0; i < choice_count; i++) {
+    choice_table[i] = UINT32_MAX;
+    choice_table[choice_count + i] = 0;
+  }
+
+  SVFRT_plan_request_struct(ctx, info->entry_struct_index_src, info->entry_struct_index_dst);
+
+  // Compile everything reachable. Each dst-struct and dst-choice is compiled at
+  // most once, so this terminates. The loop repeats, because compiling may
+  // request more structs and choices.
+  bool progress = true;
+  while (progress && !ctx->failed) {
+    progress = false;
+    for (uint32_t i = 0; i < struct_count && !ctx->failed; i++) {
+      if (struct_table[i] != UINT32_MAX && struct_table[struct_count + i] == 0) {
+        SVFRT_plan_compile_struct(ctx, i);
+        progress = true;
+      }
+    }
+    for (uint32_t i = 0; i < choice_count && !ctx->failed; i++) {
+      if (choice_table[i] != UINT32_MAX && choice_table[choice_count + i] == 0) {
+        SVFRT_plan_compile_choice(ctx, i);
+        progress = true;
+      }
+    }
+  }
+
+  if (ctx->failed) {
+    return false;
+  }
+
+  // Compute routine flags. `SVFRT_PLAN_FLAG_INDIRECT` propagates through nested
+  // structs, so repeat until nothing changes.
+  progress = true;
+  while (progress) {
+    progress = false;
+    for (uint32_t i = 0; i < struct_count; i++) {
+      uint32_t routine_offset = struct_table[struct_count + i];
+      if (routine_offset == 0) {
+        continue;
+      }
+
+      uint32_t *routine = ctx->words.pointer + routine_offset;
+      uint32_t *ops = routine + SVFRT_PLAN_ROUTINE_WORDS;
+      uint32_t op_words = routine[SVFRT_PLAN_ROUTINE_OP_WORDS];
+      uint32_t flags = 0;
+
+      if (
+        op_words == 4 &&
+        ops[0] == SVFRT_PLAN_OP_COPY &&
+        ops[1] == 0 &&
+        ops[2] == 0 &&
+        ops[3] == routine[SVFRT_PLAN_ROUTINE_SIZE_SRC] &&
+        ops[3] == routine[SVFRT_PLAN_ROUTINE_SIZE_DST]
+      ) {
+        flags |= SVFRT_PLAN_FLAG_MEMCPY;
+      }
+
+      for (uint32_t j = 0; j < op_words; j += SVFRT_plan_get_op_words(ops[j])) {
+        uint32_t opcode = ops[j];
+        if (opcode == SVFRT_PLAN_OP_STRUCT) {
+          uint32_t nested_offset = struct_table[struct_count + ops[j + 3]];
+          if (ctx->words.pointer[nested_offset + SVFRT_PLAN_ROUTINE_FLAGS] & SVFRT_PLAN_FLAG_INDIRECT) {
+            flags |= SVFRT_PLAN_FLAG_INDIRECT;
+          }
+        } else if (opcode != SVFRT_PLAN_OP_COPY && opcode != SVFRT_PLAN_OP_WIDEN) {
+          flags |= SVFRT_PLAN_FLAG_INDIRECT;
+        }
+      }
+
+      if (flags != routine[SVFRT_PLAN_ROUTINE_FLAGS]) {
+        routine[SVFRT_PLAN_ROUTINE_FLAGS] = flags;
+        progress = true;
+      }
+    }
+  }
+
+  header[SVFRT_PLAN_HEADER_WORD_COUNT] = ctx->word_count;
+  header[SVFRT_PLAN_HEADER_GROWTH_SIZE_DST] = ctx->growth_size_dst;
+  header[SVFRT_PLAN_HEADER_GROWTH_SIZE_SRC] = ctx->growth_size_src;
+  out_plan->pointer = ctx->words.pointer;
+  out_plan->count = ctx->word_count;
+  return true;
+}
+
+// Returns NULL (and sets an error) if the words are out of the plan bounds.
+static inline
+uint32_t const *SVFRT_plan_get_words(SVFRT_ConversionContext *ctx, uint64_t offset, uint64_t count) {
+  if (offset + count > (uint64_t) ctx->plan.count) {
+    ctx->error_code = SVFRT_code_conversion_internal__bad_plan;
+    return NULL;
+  }
+  return ctx->plan.pointer + offset;
+}
+
+// Returns NULL (and sets an error) if the routine does not exist.
+static inline
+uint32_t const *SVFRT_plan_get_routine(SVFRT_ConversionContext *ctx, uint32_t struct_index_dst) {
+  uint32_t struct_count = ctx->plan.pointer[SVFRT_PLAN_HEADER_STRUCT_COUNT];
+  if (struct_index_dst >= struct_count) {
+    ctx->error_code = SVFRT_code_conversion_internal__bad_plan;
+    return NULL;
+  }
+  uint32_t const *routine_offset = SVFRT_plan_get_words(
+    ctx,
+    (uint64_t) SVFRT_PLAN_HEADER_WORDS + (uint64_t) struct_count + (uint64_t) struct_index_dst,
+    1
+  );
+  if (!routine_offset) {
+    return NULL;
+  }
+  uint32_t const *routine = SVFRT_plan_get_words(ctx, *routine_offset, SVFRT_PLAN_ROUTINE_WORDS);
+  if (!routine || *routine_offset == 0) {
+    ctx->error_code = SVFRT_code_conversion_internal__bad_plan;
+    return NULL;
+  }
+  return routine;
+}
+
+// These declarations are needed because of recursive calls during execution.
+// `recursion_depth` is accounted the same way as in the traversal functions.
+void SVFRT_plan_run_ops(
+  SVFRT_ConversionContext *ctx,
+  uint32_t recursion_depth,
+  uint32_t const *ops,
+  uint32_t op_words,
+  SVFRT_Bytes data_range_src,
+  uint64_t base_offset_src,
+  SVFRT_Bytes *phase2_data_range_dst,
+  uint64_t base_offset_dst
+);
+
+void SVFRT_plan_run_struct(
+  SVFRT_ConversionContext *ctx,
+  uint32_t recursion_depth,
+  uint32_t struct_index_dst,
+  SVFRT_Bytes data_range_src,
+  uint64_t unsafe_data_offset_src,
+  SVFRT_Bytes *phase2_data_range_dst,
+  uint64_t data_offset_dst
+) {
+  uint32_t const *routine = SVFRT_plan_get_routine(ctx, struct_index_dst);
+  if (!routine) {
+    return;
+  }
+
+  uint32_t unsafe_size_src = routine[SVFRT_PLAN_ROUTINE_SIZE_SRC];
+  uint32_t size_dst = routine[SVFRT_PLAN_ROUTINE_SIZE_DST];
+
+  if (unsafe_data_offset_src + (uint64_t) unsafe_size_src > (uint64_t) data_range_src.count) {
+    ctx->error_code = SVFRT_code_conversion__data_out_of_bounds;
+    return;
+  }
+  SVFRT_Bytes struct_bytes_src = {
+    /*.pointer =*/ data_range_src.pointer + unsafe_data_offset_src,
+    /*.count =*/ unsafe_size_src
+  };
+
+  SVFRT_Bytes struct_bytes_dst = {0};
+  if (phase2_data_range_dst) {
+    if (data_offset_dst + (uint64_t) size_dst > (uint64_t) phase2_data_range_dst->count) {
+      ctx->error_code = SVFRT_code_conversion_internal__suballocation_out_of_bounds;
+      return;
+    }
+    struct_bytes_dst.pointer = phase2_data_range_dst->pointer + data_offset_dst;
+    struct_bytes_dst.count = size_dst;
+  } else if (!(routine[SVFRT_PLAN_ROUTINE_FLAGS] & SVFRT_PLAN_FLAG_INDIRECT)) {
+    // Nothing to do for Phase 1.
+    return;
+  }
+
+  uint32_t const *ops = SVFRT_plan_get_words(
+    ctx,
+    (uint64_t) (routine - ctx->plan.pointer) + SVFRT_PLAN_ROUTINE_WORDS,
+    routine[SVFRT_PLAN_ROUTINE_OP_WORDS]
+  );
+  if (!ops) {
+    return;
+  }
+
+  SVFRT_plan_run_ops(
+    ctx,
+    recursion_depth + 1,
+    ops,
+    routine[SVFRT_PLAN_ROUTINE_OP_WORDS],
+    struct_bytes_src,
+    0,
+    phase2_data_range_dst ? &struct_bytes_dst : NULL,
+    0
+  );
+}
+
+void SVFRT_plan_run_choice(
+  SVFRT_ConversionContext *ctx,
+  uint32_t recursion_depth,
+  uint32_t choice_index_dst,
+  SVFRT_Bytes data_range_src,
+  uint64_t unsafe_data_offset_src,
+  SVFRT_Bytes *phase2_data_range_dst,
+  uint64_t data_offset_dst
+) {
+  if (unsafe_data_offset_src + (uint64_t) SVFRT_TAG_SIZE > (uint64_t) data_range_src.count) {
+    ctx->error_code = SVFRT_code_conversion__data_out_of_bounds;
+    return;
+  }
+  uint8_t choice_tag = data_range_src.pointer[unsafe_data_offset_src];
+
+  uint32_t struct_count = ctx->plan.pointer[SVFRT_PLAN_HEADER_STRUCT_COUNT];
+  uint32_t choice_count = ctx->plan.pointer[SVFRT_PLAN_HEADER_CHOICE_COUNT];
+  if (choice_index_dst >= choice_count) {
+    ctx->error_code = SVFRT_code_conversion_internal__bad_plan;
+    return;
+  }
+  uint32_t const *table_offset = SVFRT_plan_get_words(
+    ctx,
+    (uint64_t) SVFRT_PLAN_HEADER_WORDS + 2 * (uint64_t) struct_count + (uint64_t) choice_count + (uint64_t) choice_index_dst,
+    1
+  );
+  if (!table_offset) {
+    return;
+  }
+  if (*table_offset == 0) {
+    ctx->error_code = SVFRT_code_conversion_internal__bad_plan;
+    return;
+  }
+  uint32_t const *entry_count = SVFRT_plan_get_words(ctx, *table_offset, 1);
+  if (!entry_count) {
+    return;
+  }
+
+  // The last match wins, see `SVFRT_conversion_traverse_choice`.
+  uint32_t const *match = NULL;
+  uint64_t entry_offset = (uint64_t) *table_offset + 1;
+  for (uint32_t i = 0; i < *entry_count; i++) {
+    uint32_t const *entry = SVFRT_plan_get_words(ctx, entry_offset, SVFRT_PLAN_ENTRY_WORDS);
+    if (!entry) {
+      return;
+    }
+    if (entry[SVFRT_PLAN_ENTRY_TAG_SRC] == choice_tag) {
+      match = entry;
+    }
+    entry_offset += SVFRT_PLAN_ENTRY_WORDS + (uint64_t) entry[SVFRT_PLAN_ENTRY_OP_WORDS];
+  }
+
+  if (!match || !match[SVFRT_PLAN_ENTRY_CONVERT]) {
+    // Defaulting to the zero tag. Data is already zero-initialized.
+    return;
+  }
+
+  if (phase2_data_range_dst) {
+    if (data_offset_dst + (uint64_t) SVFRT_TAG_SIZE > (uint64_t) phase2_data_range_dst->count) {
+      ctx->error_code = SVFRT_code_conversion_internal__suballocation_out_of_bounds;
+      return;
+    }
+
+    phase2_data_range_dst->pointer[data_offset_dst] = (uint8_t) match[SVFRT_PLAN_ENTRY_TAG_DST];
+  }
+
+  uint32_t const *ops = SVFRT_plan_get_words(
+    ctx,
+    (uint64_t) (match - ctx->plan.pointer) + SVFRT_PLAN_ENTRY_WORDS,
+    match[SVFRT_PLAN_ENTRY_OP_WORDS]
+  );
+  if (!ops) {
+    return;
+  }
+
+  SVFRT_plan_run_ops(
+    ctx,
+    recursion_depth + 1,
+    ops,
+    match[SVFRT_PLAN_ENTRY_OP_WORDS],
+    data_range_src,
+    unsafe_data_offset_src + SVFRT_TAG_SIZE,
+    phase2_data_range_dst,
+    data_offset_dst + SVFRT_TAG_SIZE
+  );
+}
+
+// #parallel-conversion.
+//
+// After Phase 1, every suballocation offset is known, so Phase 2 could write
+// any part of the output independently. But each offset depends on everything
+// tallied before it, so for a sequence that is split into tasks, Phase 1
+// records a checkpoint of both tallies where each task will start, and the
+// tasks start from those in Phase 2. Both phases decide to split the same
+// sequences in the same order, so the checkpoints are consumed in the order
+// they were recorded. When there is no more room for checkpoints, sequences are
+// just not split.
+//
+// Only sequences of structs are split, and only outside of other split
+// sequences. Each task works on a copy of the context, and writes to its own
+// part of the allocation, so the output is the same as the serial one. If some
+// tasks fail, the error of the first one of them is reported, which is what the
+// serial conversion would have reported.
+//
+// Structs without references or sequences inside don't change the tallies, so
+// they need no checkpoints, and are only split in Phase 2.
+typedef struct SVFRT_ConversionSplit {
+  SVFRT_ConversionContext *ctx; // Only read while the tasks run.
+  uint32_t recursion_depth;
+  uint32_t struct_index_dst;
+  uint64_t data_offset_src;
+  uint32_t unsafe_size_src;
+  uint32_t size_dst;
+  SVFRT_Bytes *phase2_suballocation;
+  uint32_t count;
+  uint32_t task_count;
+  SVFRT_ConversionCheckpoint *starts; // NULL, if the tallies don't change.
+} SVFRT_ConversionSplit;
+
+static inline
+uint32_t SVFRT_conversion_split_begin(uint32_t count, uint32_t task_count, uint32_t task_index) {
+  return (uint32_t) ((uint64_t) count * (uint64_t) task_index / (uint64_t) task_count);
+}
+
+// Returns how many tasks a sequence of structs should be split into, or 1, if
+// it should not be split. Both phases must come to the same decision.
+static inline
+uint32_t SVFRT_conversion_split_count(
+  SVFRT_ConversionContext *ctx,
+  uint32_t count,
+  bool indirect,
+  bool phase2
+) {
+  // Tasks can't share the #conversion-memoization table.
+  if (!ctx->spawn_fn || ctx->in_split || ctx->single_pass || ctx->memo || (!phase2 && !indirect)) {
+    return 1;
+  }
+
+  uint32_t task_count = count / SVFRT_PARALLEL_MIN_ELEMENTS_PER_TASK;
+  if (task_count > ctx->task_count) {
+    task_count = ctx->task_count;
+  }
+  if (task_count < 2) {
+    return 1;
+  }
+
+  if (indirect) {
+    // Phase 1 refuses exactly when there was no room to record, and then
+    // nothing more than that is recorded, so Phase 2 refuses as well.
+    uint32_t available = (
+      phase2
+        ? ctx->checkpoint_count - ctx->checkpoint_index
+        : SVFRT_PARALLEL_MAX_CHECKPOINTS - ctx->checkpoint_count
+    );
+    if (task_count > available) {
+      return 1;
+    }
+  }
+
+  return task_count;
+}
+
+static
+void SVFRT_conversion_split_task(void *task_ptr, uint32_t task_index) {
+  SVFRT_ConversionSplit *split = (SVFRT_ConversionSplit *) task_ptr;
+  SVFRT_ConversionContext task_ctx = *split->ctx;
+  if (split->starts) {
+    task_ctx.tally_src = split->starts[task_index].tally_src;
+    task_ctx.tally_dst = split->starts[task_index].tally_dst;
+  }
+
+  uint32_t begin = SVFRT_conversion_split_begin(split->count, split->task_count, task_index);
+  uint32_t end = SVFRT_conversion_split_begin(split->count, split->task_count, task_index + 1);
+  for (uint32_t i = begin; i < end; i++) {
+    SVFRT_plan_run_struct(
+      &task_ctx,
+      split->recursion_depth,
+      split->struct_index_dst,
+      task_ctx.data_bytes,
+      split->data_offset_src + (uint64_t) i * (uint64_t) split->unsafe_size_src,
+      split->phase2_suballocation,
+      (uint64_t) i * (uint64_t) split->size_dst
+    );
+
+    if (task_ctx.error_code) {
+      break;
+    }
+  }
+
+  SVFRT_ConversionCheckpoint *result = task_ctx.task_results + task_index;
+  result->tally_src = task_ctx.tally_src;
+  result->tally_dst = task_ctx.tally_dst;
+  result->error_code = task_ctx.error_code;
+}
+
+// Phase 2 only.
+static
+void SVFRT_conversion_run_split(SVFRT_ConversionSplit *split) {
+  SVFRT_ConversionContext *ctx = split->ctx;
+
+  // Phase 1 recorded the first checkpoint right after tallying the sequence.
+  if (split->starts && (
+    split->starts[0].tally_src != ctx->tally_src ||
+    split->starts[0].tally_dst != ctx->tally_dst
+  )) {
+    ctx->error_code = SVFRT_code_conversion_internal__suballocation_mismatch;
+    return;
+  }
+
+  ctx->in_split = true;
+  ctx->spawn_fn(ctx->spawn_ptr, SVFRT_conversion_split_task, split, split->task_count);
+  ctx->in_split = false;
+
+  for (uint32_t i = 0; i < split->task_count; i++) {
+    SVFRT_ConversionCheckpoint *result = ctx->task_results + i;
+    if (result->error_code) {
+      ctx->error_code = result->error_code;
+      return;
+    }
+
+    // Each task must end where the next one starts.
+    if (i + 1 < split->task_count) {
+      SVFRT_ConversionCheckpoint *next = split->starts ? split->starts + i + 1 : NULL;
+      uint32_t next_tally_src = next ? next->tally_src : ctx->tally_src;
+      uint32_t next_tally_dst = next ? next->tally_dst : ctx->tally_dst;
+      if (result->tally_src != next_tally_src || result->tally_dst != next_tally_dst) {
+        ctx->error_code = SVFRT_code_conversion_internal__suballocation_mismatch;
+        return;
+      }
+    }
+  }
+
+  SVFRT_ConversionCheckpoint *last = ctx->task_results + split->task_count - 1;
+  ctx->tally_src = last->tally_src;
+  ctx->tally_dst = last->tally_dst;
+}
+
+void SVFRT_plan_run_indirect(
+  SVFRT_ConversionContext *ctx,
+  uint32_t recursion_depth,
+  uint32_t const *op,
+  SVFRT_Bytes data_range_src,
+  uint64_t base_offset_src,
+  SVFRT_Bytes *phase2_data_range_dst,
+  uint64_t base_offset_dst
+) {
+  bool is_sequence = op[0] == SVFRT_PLAN_OP_SEQUENCE;
+  uint32_t element_kind = op[3];
+  uint32_t element_arg = op[4];
+  uint32_t unsafe_size_src = op[5];
+  uint32_t size_dst = op[6];
+
+  uint64_t unsafe_offset_src = base_offset_src + (uint64_t) op[1];
+  uint64_t representation_size = is_sequence ? sizeof(SVFRT_Sequence) : sizeof(SVFRT_Reference);
+  if (unsafe_offset_src + representation_size > (uint64_t) data_range_src.count) {
+    ctx->error_code = SVFRT_code_conversion__data_out_of_bounds;
+    return;
+  }
+
+  // Untrusted src-data may be misaligned, hence `SVFRT_MEMCPY`. See #natural-alignment.
+  SVFRT_Sequence unsafe_representation_src = {0};
+  SVFRT_MEMCPY(&unsafe_representation_src, data_range_src.pointer + unsafe_offset_src, representation_size);
+  if (!is_sequence) {
+    unsafe_representation_src.count = 1;
+  }
+
+  // Allow invalid references and sequences, but only if the representation is zero.
+  if (unsafe_representation_src.data_offset_complement == 0 && (!is_sequence || unsafe_representation_src.count == 0)) {
+    return;
+  }
+
+  uint32_t count = unsafe_representation_src.count;
+
+  // See #conversion-memoization. The element kind and argument identify both
+  // element types, together with the src-size.
+  SVFRT_ConversionMemoEntry memo_key = {
+    /*.offset_src =*/ ~unsafe_representation_src.data_offset_complement,
+    /*.count =*/ count,
+    /*.size_src =*/ unsafe_size_src,
+    /*.type_src =*/ element_kind,
+    /*.type_dst =*/ element_arg,
+    /*.offset_dst =*/ 0,
+  };
+  bool memo_found = false;
+  SVFRT_ConversionMemoEntry *memo_slot = SVFRT_conversion_memo_find(ctx, &memo_key, &memo_found);
+  if (memo_found) {
+    if (phase2_data_range_dst) {
+      SVFRT_conversion_memo_reuse(ctx, *phase2_data_range_dst, base_offset_dst + (uint64_t) op[2], memo_slot, is_sequence);
+    }
+    return;
+  }
+
+  SVFRT_Bytes phase2_suballocation = {0};
+  SVFRT_conversion_tally(
+    ctx,
+    unsafe_size_src,
+    size_dst,
+    count,
+    phase2_data_range_dst ? &phase2_suballocation : NULL
+  );
+  if (ctx->error_code) {
+    return;
+  }
+  SVFRT_conversion_memo_insert(ctx, memo_slot, &memo_key, phase2_data_range_dst ? &phase2_suballocation : NULL);
+
+  if (phase2_data_range_dst) {
+    SVFRT_conversion_write_representation(
+      ctx,
+      *phase2_data_range_dst,
+      base_offset_dst + (uint64_t) op[2],
+      phase2_suballocation,
+      count,
+      is_sequence
+    );
+    if (ctx->error_code) {
+      return;
+    }
+  }
+
+  if (count == 0) {
+    return;
+  }
+
+  uint64_t data_offset = (uint64_t) ~unsafe_representation_src.data_offset_complement;
+  if (data_offset + (uint64_t) count * (uint64_t) unsafe_size_src > (uint64_t) ctx->data_bytes.count) {
+    ctx->error_code = SVFRT_code_conversion__data_out_of_bounds;
+    return;
+  }
+  uint8_t *pointer_src = ctx->data_bytes.pointer + data_offset;
+
+  // No overflow possible from here on, since `SVFRT_conversion_tally` has
+  // succeeded, see #phase2-reasonable-dst-sum, and the src-range is in bounds.
+  switch (element_kind) {
+    case SVFRT_PLAN_ELEMENT_STRUCT: {
+      uint32_t const *routine = SVFRT_plan_get_routine(ctx, element_arg);
+      if (!routine) {
+        return;
+      }
+
+      uint32_t flags = routine[SVFRT_PLAN_ROUTINE_FLAGS];
+      bool sizes_match = (
+        routine[SVFRT_PLAN_ROUTINE_SIZE_SRC] == unsafe_size_src &&
+        routine[SVFRT_PLAN_ROUTINE_SIZE_DST] == size_dst
+      );
+
+      if (!phase2_data_range_dst && sizes_match && !(flags & SVFRT_PLAN_FLAG_INDIRECT)) {
+        // Nothing to do for Phase 1.
+        return;
+      }
+
+      if (phase2_data_range_dst && sizes_match && (flags & SVFRT_PLAN_FLAG_MEMCPY)) {
+        SVFRT_MEMCPY(phase2_suballocation.pointer, pointer_src, count * size_dst);
+        return;
+      }
+
+      if (ctx->single_pass) {
+        // Fields may be missing, so zero the structs first. Their nested
+        // suballocations come later, so this does not overwrite anything.
+        SVFRT_MEMSET(phase2_suballocation.pointer, 0, count * size_dst);
+      }
+
+      // See #parallel-conversion.
+      bool indirect = (flags & SVFRT_PLAN_FLAG_INDIRECT) != 0;
+      uint32_t task_count = SVFRT_conversion_split_count(ctx, count, indirect, phase2_data_range_dst != NULL);
+      SVFRT_ConversionCheckpoint *phase1_checkpoints = NULL;
+      if (task_count > 1 && phase2_data_range_dst) {
+        SVFRT_ConversionSplit split = {0};
+        split.ctx = ctx;
+        split.recursion_depth = recursion_depth;
+        split.struct_index_dst = element_arg;
+        split.data_offset_src = data_offset;
+        split.unsafe_size_src = unsafe_size_src;
+        split.size_dst = size_dst;
+        split.phase2_suballocation = &phase2_suballocation;
+        split.count = count;
+        split.task_count = task_count;
+        if (indirect) {
+          split.starts = ctx->checkpoints + ctx->checkpoint_index;
+          ctx->checkpoint_index += task_count;
+        }
+        SVFRT_conversion_run_split(&split);
+        return;
+      } else if (task_count > 1) {
+        phase1_checkpoints = ctx->checkpoints + ctx->checkpoint_count;
+        ctx->checkpoint_count += task_count;
+        ctx->in_split = true;
+      }
+
+      uint32_t next_task = 0;
+      for (uint32_t i = 0; i < count; i++) {
+        if (
+          phase1_checkpoints &&
+          next_task < task_count &&
+          i == SVFRT_conversion_split_begin(count, task_count, next_task)
+        ) {
+          phase1_checkpoints[next_task].tally_src = ctx->tally_src;
+          phase1_checkpoints[next_task].tally_dst = ctx->tally_dst;
+          phase1_checkpoints[next_task].error_code = 0;
+          next_task++;
+        }
+
+        SVFRT_plan_run_struct(
+          ctx,
+          recursion_depth,
+          element_arg,
+          ctx->data_bytes,
+          data_offset + (uint64_t) i * (uint64_t) unsafe_size_src,
+          phase2_data_range_dst ? &phase2_suballocation : NULL,
+          (uint64_t) i * (uint64_t) size_dst
+        );
+
+        if (ctx->error_code) {
+          break;
+        }
+      }
+
+      if (phase1_checkpoints) {
+        ctx->in_split = false;
+      }
+      return;
+    }
+    case SVFRT_PLAN_ELEMENT_COPY: {
+      if (unsafe_size_src != size_dst) {
+        ctx->error_code = SVFRT_code_conversion_internal__bad_plan;
+        return;
+      }
+      if (phase2_data_range_dst) {
+        SVFRT_MEMCPY(phase2_suballocation.pointer, pointer_src, count * size_dst);
+      }
+      return;
+    }
+    case SVFRT_PLAN_ELEMENT_WIDEN: {
+      uint32_t widening_size_src = 0;
+      uint32_t widening_size_dst = 0;
+      uint32_t widening_kind = 0;
+      if (
+        !SVFRT_conversion_get_widening_info(element_arg, &widening_size_src, &widening_size_dst, &widening_kind) ||
+        widening_size_src != unsafe_size_src ||
+        widening_size_dst != size_dst
+      ) {
+        ctx->error_code = SVFRT_code_conversion_internal__bad_plan;
+        return;
+      }
+      if (phase2_data_range_dst) {
+        SVFRT_conversion_widen(element_arg, phase2_suballocation.pointer, pointer_src, count);
+      }
+      return;
+    }
+    default: {
+      ctx->error_code = SVFRT_code_conversion_internal__bad_plan;
+      return;
+    }
+  }
+}
+
+void SVFRT_plan_run_ops(
+  SVFRT_ConversionContext *ctx,
+  uint32_t recursion_depth,
+  uint32_t const *ops,
+  uint32_t op_words,
+  SVFRT_Bytes data_range_src,
+  uint64_t base_offset_src,
+  SVFRT_Bytes *phase2_data_range_dst,
+  uint64_t base_offset_dst
+) {
+  // Each op corresponds to one `SVFRT_conversion_traverse_any_type` call.
+  if (op_words > 0 && recursion_depth > ctx->max_recursion_depth) {
+    ctx->error_code = SVFRT_code_conversion__max_recursion_depth_exceeded;
+    return;
+  }
+
+  uint32_t i = 0;
+  while (i < op_words) {
+    uint32_t const *op = ops + i;
+    uint32_t words = SVFRT_plan_get_op_words(op[0]);
+    if (words == 0 || (uint64_t) i + (uint64_t) words > (uint64_t) op_words) {
+      ctx->error_code = SVFRT_code_conversion_internal__bad_plan;
+      return;
+    }
+    i += words;
+
+    uint64_t unsafe_offset_src = base_offset_src + (uint64_t) op[1];
+    uint64_t offset_dst = base_offset_dst + (uint64_t) op[2];
+
+    switch (op[0]) {
+      case SVFRT_PLAN_OP_COPY:
+      case SVFRT_PLAN_OP_WIDEN: {
+        if (!phase2_data_range_dst) {
+          continue;
+        }
+
+        uint32_t unsafe_size_src = op[3];
+        uint32_t size_dst = op[3];
+        uint32_t widening_kind = 0;
+        if (
+          op[0] == SVFRT_PLAN_OP_WIDEN &&
+          !SVFRT_conversion_get_widening_info(op[3], &unsafe_size_src, &size_dst, &widening_kind)
+        ) {
+          ctx->error_code = SVFRT_code_conversion_internal__bad_plan;
+          return;
+        }
+
+        if (unsafe_offset_src + (uint64_t) unsafe_size_src > (uint64_t) data_range_src.count) {
+          ctx->error_code = SVFRT_code_conversion__data_out_of_bounds;
+          return;
+        }
+        if (offset_dst + (uint64_t) size_dst > (uint64_t) phase2_data_range_dst->count) {
+          ctx->error_code = SVFRT_code_conversion_internal__suballocation_out_of_bounds;
+          return;
+        }
+
+        uint8_t *pointer_src = data_range_src.pointer + unsafe_offset_src;
+        uint8_t *pointer_dst = phase2_data_range_dst->pointer + offset_dst;
+        if (op[0] == SVFRT_PLAN_OP_COPY) {
+          SVFRT_MEMCPY(pointer_dst, pointer_src, size_dst);
+        } else {
+          SVFRT_conversion_widen(op[3], pointer_dst, pointer_src, 1);
+        }
+        continue;
+      }
+      case SVFRT_PLAN_OP_STRUCT: {
+        SVFRT_plan_run_struct(
+          ctx,
+          recursion_depth,
+          op[3],
+          data_range_src,
+          unsafe_offset_src,
+          phase2_data_range_dst,
+          offset_dst
+        );
+        break;
+      }
+      case SVFRT_PLAN_OP_CHOICE: {
+        SVFRT_plan_run_choice(
+          ctx,
+          recursion_depth,
+          op[3],
+          data_range_src,
+          unsafe_offset_src,
+          phase2_data_range_dst,
+          offset_dst
+        );
+        break;
+      }
+      case SVFRT_PLAN_OP_REFERENCE:
+      case SVFRT_PLAN_OP_SEQUENCE: {
+        SVFRT_plan_run_indirect(
+          ctx,
+          recursion_depth,
+          op,
+          data_range_src,
+          base_offset_src,
+          phase2_data_range_dst,
+          base_offset_dst
+        );
+        break;
+      }
+    }
+
+    if (ctx->error_code) {
+      // Early exit on any error.
+      return;
+    }
+  }
+}
+
+// Run one of the phases on the entry, either iteratively, with the plan, or by
+// traversal.
+static
+void SVFRT_conversion_run_entry(
+  SVFRT_ConversionContext *ctx,
+  SVFRT_Bytes entry_bytes_src,
+  SVFRT_Bytes *phase2_entry_bytes_dst
+) {
+  uint32_t recursion_depth = 0;
+
+#ifdef SVFRT_ITERATIVE_CONVERSION
+  if (ctx->frames) {
+    SVFRT_iterative_begin_entry(ctx, entry_bytes_src, phase2_entry_bytes_dst);
+    uint32_t budget = UINT32_MAX;
+    while (!SVFRT_iterative_step(ctx, phase2_entry_bytes_dst != NULL, &budget)) {
+      budget = UINT32_MAX;
+    }
+    return;
+  }
+#endif
+
+  if (ctx->plan.pointer) {
+    SVFRT_plan_run_struct(
+      ctx,
+      recursion_depth,
+      ctx->info->entry_struct_index_dst,
+      entry_bytes_src,
+      0,
+      phase2_entry_bytes_dst,
+      0
+    );
+    return;
+  }
+
+  SVFRT_Phase2_TraverseStruct phase2 = {0};
+  if (phase2_entry_bytes_dst) {
+    phase2.struct_bytes_dst = *phase2_entry_bytes_dst;
+  }
+  SVFRT_conversion_traverse_struct(
+    ctx,
+    recursion_depth,
+    ctx->info->entry_struct_index_src,
+    ctx->info->entry_struct_index_dst,
+    entry_bytes_src,
+    phase2_entry_bytes_dst ? &phase2 : NULL
+  );
+}
+
+// #single-pass-conversion.
+//
+// Phase 1 only exists to find out the exact allocation size, so that Phase 2
+// can write into it. But with a conversion plan, we know the largest growth of
+// any suballocation, and since all src-suballocations together are limited by
+// the data size (see `SVFRT_code_conversion__data_aliasing_detected`), we can
+// bound the total size up front. Then, the data only needs to be traversed once.
+//
+// The entry is converted at the very end of the allocation, and then moved
+// down right after the last suballocation, so the output is still laid out
+// exactly the same as with two phases. Only the bytes that are not entirely
+// overwritten get zeroed, and the unused rest of the allocation is left as-is.
+//
+// Returns false, if single-pass conversion is not possible, and nothing was done.
+static
+bool SVFRT_conversion_single_pass(
+  SVFRT_ConversionResult *out_result,
+  SVFRT_ConversionContext *ctx,
+  SVFRT_Bytes entry_bytes_src,
+  SVFRT_AllocatorFn *allocator_fn,
+  void *allocator_ptr
+) {
+  uint32_t growth_size_dst = ctx->plan.pointer[SVFRT_PLAN_HEADER_GROWTH_SIZE_DST];
+  uint32_t growth_size_src = ctx->plan.pointer[SVFRT_PLAN_HEADER_GROWTH_SIZE_SRC];
+  if (growth_size_src == 0) {
+    return false;
+  }
+
+  uint32_t entry_size_dst = ctx->info->entry_struct_size_dst;
+  uint64_t suballocations_bound = (
+    (uint64_t) ctx->data_bytes.count * (uint64_t) growth_size_dst / (uint64_t) growth_size_src
+  );
+
+  // Each suballocation may be padded to its #natural-alignment, but by less
+  // than its own size. Also, each one is pointed to by a distinct reference or
+  // sequence in the src-data, so there can't be more of them than would fit.
+  uint64_t padding_bound = (
+    (uint64_t) ctx->data_bytes.count / sizeof(SVFRT_Reference) * (SVFRT_MESSAGE_PART_ALIGNMENT - 1)
+  );
+  if (padding_bound > suballocations_bound) {
+    padding_bound = suballocations_bound;
+  }
+
+  // The entry may be padded as well.
+  uint64_t upper_bound = (
+    (uint64_t) entry_size_dst + (SVFRT_MESSAGE_PART_ALIGNMENT - 1) +
+    suballocations_bound + padding_bound
+  );
+
+  // No need to allocate more than the limit. Exceeding it will be detected
+  // by `SVFRT_conversion_tally`.
+  if (upper_bound > (uint64_t) ctx->total_data_size_limit_dst) {
+    upper_bound = (uint64_t) ctx->total_data_size_limit_dst;
+  }
+
+  if ((uint64_t) entry_size_dst > upper_bound) {
+    out_result->error_code = SVFRT_code_conversion__total_data_size_limit_exceeded;
+    return true;
+  }
+
+  void *allocated_pointer = allocator_fn(allocator_ptr, (uint32_t) upper_bound);
+  if (!allocated_pointer) {
+    out_result->error_code = SVFRT_code_conversion__allocation_failed;
+    return true;
+  }
+
+  ctx->allocation.pointer = (uint8_t *) allocated_pointer;
+  ctx->allocation.count = (uint32_t) upper_bound;
+  out_result->output_bytes = ctx->allocation;
+
+  // Suballocations must stay clear of the entry.
+  ctx->single_pass = true;
+  ctx->total_data_size_limit_dst = ctx->allocation.count - entry_size_dst;
+
+  SVFRT_Bytes entry_bytes_dst = {
+    /*.pointer =*/ ctx->allocation.pointer + ctx->allocation.count - entry_size_dst,
+    /*.count =*/ entry_size_dst,
+  };
+  SVFRT_MEMSET(entry_bytes_dst.pointer, 0, entry_bytes_dst.count);
+
+  SVFRT_conversion_memo_clear(ctx);
+  SVFRT_conversion_run_entry(ctx, entry_bytes_src, &entry_bytes_dst);
+  if (ctx->error_code) {
+    out_result->error_code = ctx->error_code;
+    return true;
+  }
+
+  // Tally the entry the same way as Phase 1 does, to run the same checks.
+  ctx->single_pass = false;
+  ctx->total_data_size_limit_dst = ctx->allocation.count;
+  SVFRT_conversion_tally(
+    ctx,
+    ctx->info->unsafe_entry_struct_size_src,
+    entry_size_dst,
+    1,
+    NULL
+  );
+  if (ctx->error_code) {
+    out_result->error_code = ctx->error_code;
+    return true;
+  }
+
+  // Now, `ctx->tally_dst` is the exact output size, and it fits the allocation.
+  uint8_t *final_entry_pointer = ctx->allocation.pointer + ctx->tally_dst - entry_size_dst;
+
+  // The ranges may overlap, but the entry only moves down, so a forward copy
+  // is fine. Entries are small, so this is cheap.
+  for (uint32_t i = 0; i < entry_size_dst; i++) {
+    final_entry_pointer[i] = entry_bytes_dst.pointer[i];
+  }
+
+  out_result->output_bytes.count = ctx->tally_dst;
+  out_result->success = true;
+  return true;
+}
+
+// Set up the ranges of both schemas in the context. Shared with #wide-conversion.
+static
+SVFRT_ErrorCode SVFRT_conversion_init_schemas(
+  SVFRT_ConversionContext *ctx,
+  SVFRT_LogicalCompatibilityInfo *info
+) {
+  SVFRT_RangeStructDefinition unsafe_structs_src = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
+    info->unsafe_schema_src,
+    info->unsafe_definition_src->structs,
+    SVF_Meta_StructDefinition
+  );
+  if (!unsafe_structs_src.pointer && unsafe_structs_src.count) {
+    return SVFRT_code_conversion__bad_schema_structs;
+  };
+
+  SVFRT_RangeStructDefinition structs_dst = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
+    info->schema_dst,
+    info->definition_dst->structs,
+    SVF_Meta_StructDefinition
+  );
+  if (!structs_dst.pointer && structs_dst.count) {
+    return SVFRT_code_conversion_internal__bad_schema_structs;
+  }
+
+  SVFRT_RangeChoiceDefinition unsafe_choices_src = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
+    info->unsafe_schema_src,
+    info->unsafe_definition_src->choices,
+    SVF_Meta_ChoiceDefinition
+  );
+  if (!unsafe_choices_src.pointer && unsafe_choices_src.count) {
+    return SVFRT_code_conversion__bad_schema_choices;
+  };
+
+  SVFRT_RangeChoiceDefinition choices_dst = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
+    info->schema_dst,
+    info->definition_dst->choices,
+    SVF_Meta_ChoiceDefinition
+  );
+  if (!choices_dst.pointer && choices_dst.count) {
+    return SVFRT_code_conversion_internal__bad_schema_choices;
+  }
+
+  ctx->info = info;
+  ctx->unsafe_structs_src = unsafe_structs_src;
+  ctx->structs_dst = structs_dst;
+  ctx->unsafe_choices_src = unsafe_choices_src;
+  ctx->choices_dst = choices_dst;
+  return 0;
+}
+
+// Validate the inputs, and set up the context, including the plan and the memo.
+// Returns false on errors, with `out_result->error_code` set.
+static
+bool SVFRT_conversion_init(
+  SVFRT_ConversionContext *ctx,
+  SVFRT_ConversionResult *out_result,
+  SVFRT_CompatibilityResult *check_result,
+  SVFRT_Bytes data_bytes,
+  uint32_t max_recursion_depth,
+  uint32_t total_data_size_limit,
+  SVFRT_Bytes conversion_memo,
+  SVFRT_Bytes *out_entry_bytes_src
+) {
+  // A previously passed compatibility check allows us to reuse some data, and
+  // also make some assumptions.
+  if (check_result->level != SVFRT_compatibility_logical) {
+    out_result->error_code = SVFRT_code_conversion_internal__need_logical_compatibility;
+    return false;
+  }
+
+  SVFRT_LogicalCompatibilityInfo *info = &check_result->logical;
+
+  uint32_t unsafe_entry_struct_size = info->unsafe_entry_struct_size_src;
+
+  if (unsafe_entry_struct_size > data_bytes.count) {
+    out_result->error_code = SVFRT_code_conversion__data_out_of_bounds;
+    return false;
+  }
+
+  // Now, `unsafe_entry_size` can be considered safe.
+  SVFRT_Bytes entry_bytes_src = {
+    /*.pointer =*/ data_bytes.pointer + data_bytes.count - unsafe_entry_struct_size,
+    /*.count =*/ unsafe_entry_struct_size,
+  };
+
+  SVFRT_ErrorCode error_code = SVFRT_conversion_init_schemas(ctx, info);
+  if (error_code != 0) {
+    out_result->error_code = error_code;
+    return false;
+  }
+
+  ctx->data_bytes = data_bytes;
+  ctx->max_recursion_depth = max_recursion_depth;
+  ctx->total_data_size_limit_dst = total_data_size_limit;
+
+  // The plan is only usable if it has at least a header.
+  if (info->conversion_plan.pointer && info->conversion_plan.count >= SVFRT_PLAN_HEADER_WORDS) {
+    ctx->plan = info->conversion_plan;
+  }
+
+  // See #conversion-memoization. Without room for a single entry, it's off.
+  if (conversion_memo.pointer) {
+    uintptr_t misalignment = ((uintptr_t) conversion_memo.pointer) % sizeof(uint32_t);
+    uint32_t padding = misalignment ? (uint32_t) (sizeof(uint32_t) - misalignment) : 0;
+    uint32_t usable = conversion_memo.count > padding ? conversion_memo.count - padding : 0;
+    uint32_t available = usable / (uint32_t) sizeof(SVFRT_ConversionMemoEntry);
+    if (available > 0) {
+      uint32_t capacity = 1;
+      while (capacity <= available / 2) {
+        capacity *= 2;
+      }
+      ctx->memo = (SVFRT_ConversionMemoEntry *) (conversion_memo.pointer + padding);
+      ctx->memo_capacity = capacity;
+    }
+  }
+
+  *out_entry_bytes_src = entry_bytes_src;
+  return true;
+}
+
+#ifdef SVFRT_ITERATIVE_CONVERSION
+// See #iterative-conversion.
+static
+void SVFRT_conversion_use_stack(SVFRT_ConversionContext *ctx, SVFRT_Bytes conversion_stack) {
+  uintptr_t misalignment = ((uintptr_t) conversion_stack.pointer) % SVFRT_FRAME_ALIGNMENT;
+  uint32_t padding = misalignment ? (uint32_t) (SVFRT_FRAME_ALIGNMENT - misalignment) : 0;
+  uint32_t usable = conversion_stack.count > padding ? conversion_stack.count - padding : 0;
+  ctx->frames = (SVFRT_ConversionFrame *) (conversion_stack.pointer + padding);
+  ctx->frame_capacity = usable / (uint32_t) sizeof(SVFRT_ConversionFrame);
+}
+#endif
+
+// After Phase 1: account for the entry, allocate, and prepare the context for
+// Phase 2. Returns false on errors, with `out_result->error_code` set.
+static
+bool SVFRT_conversion_allocate(
+  SVFRT_ConversionResult *out_result,
+  SVFRT_ConversionContext *ctx,
+  SVFRT_AllocatorFn *allocator_fn,
+  void *allocator_ptr,
+  SVFRT_Bytes *out_entry_bytes_dst
+) {
+  SVFRT_conversion_tally(
+    ctx,
+    ctx->info->unsafe_entry_struct_size_src,
+    ctx->info->entry_struct_size_dst,
+    1,
+    NULL
+  );
+  if (ctx->error_code) {
+    out_result->error_code = ctx->error_code;
+    return false;
+  }
+
+  void *allocated_pointer = allocator_fn(allocator_ptr, ctx->tally_dst);
+  if (!allocated_pointer) {
+    out_result->error_code = SVFRT_code_conversion__allocation_failed;
+    return false;
+  }
+
+  ctx->allocation.pointer = (uint8_t *) allocated_pointer;
+  ctx->allocation.count = ctx->tally_dst;
+  out_result->output_bytes = ctx->allocation;
+
+  // Zero out the memory.
+  SVFRT_MEMSET(ctx->allocation.pointer, 0, ctx->allocation.count);
+
+  // Reset tallies (and the memo) between the phases.
+  ctx->tally_src = 0;
+  ctx->tally_dst = 0;
+  SVFRT_conversion_memo_clear(ctx);
+
+  SVF_Meta_StructDefinition *definition_dst = ctx->structs_dst.pointer + ctx->info->entry_struct_index_dst;
+
+  // Entry is special, as it always resides at the end of the data range.
+  SVFRT_Bytes entry_bytes_dst = {
+    /*.pointer =*/ ctx->allocation.pointer + ctx->allocation.count - definition_dst->size,
+    /*.size =*/ definition_dst->size,
+  };
+  *out_entry_bytes_dst = entry_bytes_dst;
+  return true;
+}
+
+// After Phase 2: account for the entry, and check that everything adds up.
+static
+void SVFRT_conversion_complete(
+  SVFRT_ConversionResult *out_result,
+  SVFRT_ConversionContext *ctx,
+  SVFRT_Bytes entry_bytes_dst
+) {
+  SVFRT_Bytes entry_bytes_dst_alternate = {0};
+  SVFRT_conversion_tally(
+    ctx,
+    ctx->info->unsafe_entry_struct_size_src,
+    ctx->info->entry_struct_size_dst,
+    1,
+    &entry_bytes_dst_alternate
+  );
+  if (ctx->error_code) {
+    out_result->error_code = ctx->error_code;
+    return;
+  }
+
+  // Sanity checks.
+  if (
+    (entry_bytes_dst.pointer != entry_bytes_dst_alternate.pointer) ||
+    (entry_bytes_dst.count != entry_bytes_dst_alternate.count) ||
+    (ctx->tally_dst != ctx->allocation.count)
+  ) {
+    // Something went terribly wrong.
+    // TODO: should this kind of "fatal" error be separate?
+    out_result->error_code = SVFRT_code_conversion_internal__suballocation_mismatch;
+    return;
+  }
+
+  out_result->success = true;
+}
+
+// Both phases, after `SVFRT_conversion_init`. Shared between
+// `SVFRT_convert_message` and `SVFRT_convert_struct`.
+static
+void SVFRT_conversion_run(
+  SVFRT_ConversionResult *out_result,
+  SVFRT_ConversionContext *ctx,
+  SVFRT_Bytes entry_bytes_src,
+  bool single_pass,
+  SVFRT_SpawnTasksFn *spawn_fn,
+  void *spawn_ptr,
+  uint32_t task_count,
+  SVFRT_AllocatorFn *allocator_fn,
+  void *allocator_ptr
+) {
+  // See #single-pass-conversion. It needs a plan, otherwise we fall back to
+  // two phases.
+  if (
+    single_pass &&
+    ctx->plan.pointer &&
+    SVFRT_conversion_single_pass(out_result, ctx, entry_bytes_src, allocator_fn, allocator_ptr)
+  ) {
+    return;
+  }
+
+  // See #parallel-conversion. It needs a plan as well. Splits never nest, so
+  // one set of task results is enough.
+  SVFRT_ConversionCheckpoint checkpoints[SVFRT_PARALLEL_MAX_CHECKPOINTS];
+  SVFRT_ConversionCheckpoint task_results[SVFRT_MAX_CONVERSION_TASKS];
+  if (spawn_fn && task_count > 1 && ctx->plan.pointer) {
+    ctx->spawn_fn = spawn_fn;
+    ctx->spawn_ptr = spawn_ptr;
+    ctx->task_count = task_count < SVFRT_MAX_CONVERSION_TASKS ? task_count : SVFRT_MAX_CONVERSION_TASKS;
+    ctx->checkpoints = checkpoints;
+    ctx->task_results = task_results;
+  }
+
+  //
+  // Phase 1: calculate size needed for the allocation.
+  //
+
+  SVFRT_conversion_memo_clear(ctx);
+  SVFRT_conversion_run_entry(ctx, entry_bytes_src, NULL);
+  if (ctx->error_code) {
+    out_result->error_code = ctx->error_code;
+    return;
+  }
+
+  SVFRT_Bytes entry_bytes_dst = {0};
+  if (!SVFRT_conversion_allocate(out_result, ctx, allocator_fn, allocator_ptr, &entry_bytes_dst)) {
+    return;
+  }
+
+  //
+  // Phase 2: actually copy the data.
+  //
+
+  SVFRT_conversion_run_entry(ctx, entry_bytes_src, &entry_bytes_dst);
+  if (ctx->error_code) {
+    out_result->error_code = ctx->error_code;
+    return;
+  }
+
+  SVFRT_conversion_complete(out_result, ctx, entry_bytes_dst);
+}
+
+void SVFRT_convert_message(
+  SVFRT_ConversionResult *out_result,
+  SVFRT_CompatibilityResult *check_result,
+  SVFRT_Bytes data_bytes,
+  uint32_t max_recursion_depth,
+  uint32_t total_data_size_limit,
+  bool single_pass,
+  SVFRT_Bytes conversion_stack,
+  SVFRT_Bytes conversion_memo,
+  SVFRT_SpawnTasksFn *spawn_fn,
+  void *spawn_ptr,
+  uint32_t task_count,
+  SVFRT_AllocatorFn *allocator_fn, // Non-NULL.
+  void *allocator_ptr
+) {
+  SVFRT_ConversionContext ctx_val = {0};
+  SVFRT_ConversionContext *ctx = &ctx_val;
+  SVFRT_Bytes entry_bytes_src = {0};
+  if (!SVFRT_conversion_init(
+    ctx,
+    out_result,
+    check_result,
+    data_bytes,
+    max_recursion_depth,
+    total_data_size_limit,
+    conversion_memo,
+    &entry_bytes_src
+  )) {
+    return;
+  }
+
+#ifdef SVFRT_ITERATIVE_CONVERSION
+  // See #iterative-conversion.
+  if (conversion_stack.pointer) {
+    SVFRT_conversion_use_stack(ctx, conversion_stack);
+  }
+#else
+  (void) conversion_stack;
+#endif
+
+  SVFRT_conversion_run(
+    out_result,
+    ctx,
+    entry_bytes_src,
+    single_pass,
+    spawn_fn,
+    spawn_ptr,
+    task_count,
+    allocator_fn,
+    allocator_ptr
+  );
+}
+
+// #wide-conversion.
+//
+// Logical conversion of #wide-messages. Both schemas are laid out with
+// `SVFRT_Reference64` and `SVFRT_Sequence64`, and the data may be larger than
+// `UINT32_MAX` bytes, so handles, offsets into the data, and tallies are all
+// 64-bit here. Otherwise, the two phases are the same as for the recursive
+// traversal above. Values are always addressed through the small range of the
+// struct or element they are in, so the helpers for schemas and primitives are
+// shared with it.
+//
+// There are no plan, iterative, single-pass, parallel, or memoized variants.
+// Chunked sequences are never wide, and fail with `SVFRT_code_conversion__bad_schema_type_tag`.
+
+typedef struct SVFRT_ConversionContext64 {
+  // Only `info`, the schema ranges, `max_recursion_depth`, and `error_code`
+  // are used, by the shared helpers.
+  SVFRT_ConversionContext base;
+
+  SVFRT_Bytes64 data_bytes;
+  uint64_t total_data_size_limit_dst;
+
+  // Both for Phase 1 and 2. Should be reset in-between.
+  uint64_t tally_src;
+  uint64_t tally_dst;
+
+  // For Phase 2 only.
+  SVFRT_Bytes64 allocation;
+} SVFRT_ConversionContext64;
+
+// Same as `SVFRT_conversion_tally`, with 64-bit counts. Products of them may
+// overflow, so counts are checked against the room that is left, before
+// multiplying.
+static
+void SVFRT_conversion64_tally(
+  SVFRT_ConversionContext64 *ctx,
+  uint32_t unsafe_size_src,
+  uint32_t size_dst,
+  uint64_t unsafe_count,
+  SVFRT_Bytes64 *phase2_out_suballocation // Should be non-NULL for Phase 2.
+) {
+  // Both tallies never exceed their limits, so the subtractions can't wrap.
+  uint64_t room_src = ctx->data_bytes.count - ctx->tally_src;
+  if (unsafe_size_src != 0 && unsafe_count > room_src / unsafe_size_src) {
+    ctx->base.error_code = SVFRT_code_conversion__data_aliasing_detected;
+    return;
+  }
+
+  uint64_t limit_dst = phase2_out_suballocation ? ctx->allocation.count : ctx->total_data_size_limit_dst;
+  uint32_t alignment_dst = SVFRT_natural_alignment(size_dst);
+  uint64_t padding_dst = unsafe_count == 0 ? 0 : (alignment_dst - ctx->tally_dst % alignment_dst) % alignment_dst;
+  uint64_t room_dst = limit_dst - ctx->tally_dst;
+  if (padding_dst > room_dst || (size_dst != 0 && unsafe_count > (room_dst - padding_dst) / size_dst)) {
+    ctx->base.error_code = phase2_out_suballocation
+      ? SVFRT_code_conversion_internal__suballocation_mismatch
+      : SVFRT_code_conversion__total_data_size_limit_exceeded;
+    return;
+  }
+
+  uint64_t start_dst = ctx->tally_dst + padding_dst;
+  uint64_t size_total_dst = (uint64_t) size_dst * unsafe_count;
+
+  if (phase2_out_suballocation) {
+    // Padding is never written to otherwise, so zero it here, to not leak
+    // whatever was in the allocation before.
+    SVFRT_MEMSET(ctx->allocation.pointer + ctx->tally_dst, 0, (size_t) padding_dst);
+
+    phase2_out_suballocation->pointer = ctx->allocation.pointer + start_dst;
+    phase2_out_suballocation->count = size_total_dst;
+  }
+
+  ctx->tally_src += (uint64_t) unsafe_size_src * unsafe_count;
+  ctx->tally_dst = start_dst + size_total_dst;
+}
+
+// Phase 2 only: same as `SVFRT_conversion_write_representation`.
+static inline
+void SVFRT_conversion64_write_representation(
+  SVFRT_ConversionContext64 *ctx,
+  SVFRT_Bytes range_dst,
+  uint32_t offset_dst,
+  SVFRT_Bytes64 suballocation,
+  uint64_t count,
+  bool is_sequence
+) {
+  uint32_t size = is_sequence ? sizeof(SVFRT_Sequence64) : sizeof(SVFRT_Reference64);
+  if ((uint64_t) offset_dst + (uint64_t) size > (uint64_t) range_dst.count) {
+    ctx->base.error_code = SVFRT_code_conversion_internal__suballocation_out_of_bounds;
+    return;
+  }
+
+  // Suballocations are always within the allocation, see `SVFRT_conversion64_tally`.
+  SVFRT_Sequence64 representation = {
+    /*.data_offset_complement =*/ ~((uint64_t) (suballocation.pointer - ctx->allocation.pointer)),
+    /*.count =*/ count
+  };
+
+  SVFRT_MEMCPY(range_dst.pointer + offset_dst, &representation, size);
+}
+
+// Forward declaration, because of recursive calls during traversal.
+static
+void SVFRT_conversion64_traverse_any_type(
+  SVFRT_ConversionContext64 *ctx,
+  uint32_t recursion_depth,
+  SVFRT_Bytes data_range_src,
+  uint32_t unsafe_data_offset_src,
+  SVF_Meta_Type_tag unsafe_type_tag_src,
+  SVF_Meta_Type_payload *unsafe_type_payload_src,
+  SVF_Meta_Type_tag type_tag_dst,
+  SVF_Meta_Type_payload *type_payload_dst,
+  SVFRT_Phase2_TraverseAnyType *phase2
+);
+
+static
+void SVFRT_conversion64_traverse_struct(
+  SVFRT_ConversionContext64 *ctx,
+  uint32_t recursion_depth,
+  uint32_t unsafe_struct_index_src,
+  uint32_t struct_index_dst,
+  SVFRT_Bytes struct_bytes_src,
+  SVFRT_Phase2_TraverseStruct *phase2
+) {
+  SVFRT_RangeFieldDefinition unsafe_fields_src;
+  SVFRT_RangeFieldDefinition fields_dst;
+  uint32_t field_matches_index;
+  if (!SVFRT_conversion_prepare_struct(
+    &ctx->base,
+    unsafe_struct_index_src,
+    struct_index_dst,
+    &unsafe_fields_src,
+    &fields_dst,
+    &field_matches_index
+  )) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < fields_dst.count; i++) {
+    SVF_Meta_FieldDefinition *field_dst = fields_dst.pointer + i;
+    SVF_Meta_FieldDefinition *unsafe_field_src = SVFRT_conversion_match_field(
+      &ctx->base,
+      unsafe_fields_src,
+      fields_dst,
+      field_matches_index,
+      i
+    );
+
+    if (!unsafe_field_src) {
+      if (ctx->base.error_code) {
+        return;
+      }
+      continue;
+    }
+
+    SVFRT_Phase2_TraverseAnyType phase2_inner = {0};
+    if (phase2) {
+      phase2_inner.data_range_dst = phase2->struct_bytes_dst;
+      phase2_inner.data_offset_dst = field_dst->offset;
+    }
+
+    SVFRT_conversion64_traverse_any_type(
+      ctx,
+      recursion_depth,
+      struct_bytes_src,
+      unsafe_field_src->offset,
+      unsafe_field_src->type_tag,
+      &unsafe_field_src->type_payload,
+      field_dst->type_tag,
+      &field_dst->type_payload,
+      phase2 ? &phase2_inner : NULL
+    );
+
+    if (ctx->base.error_code) {
+      return;
+    }
+  }
+}
+
+static
+void SVFRT_conversion64_traverse_concrete_type(
+  SVFRT_ConversionContext64 *ctx,
+  uint32_t recursion_depth,
+  SVFRT_Bytes data_range_src,
+  uint32_t unsafe_data_offset_src,
+  SVF_Meta_ConcreteType_tag unsafe_type_tag_src,
+  SVF_Meta_ConcreteType_payload *unsafe_type_payload_src,
+  SVF_Meta_ConcreteType_tag type_tag_dst,
+  SVF_Meta_ConcreteType_payload *type_payload_dst,
+  SVFRT_Phase2_TraverseConcreteType *phase2
+) {
+  switch (type_tag_dst) {
+    case SVF_Meta_ConcreteType_tag_definedStruct: {
+      // Sanity check.
+      if (unsafe_type_tag_src != SVF_Meta_ConcreteType_tag_definedStruct) {
+        ctx->base.error_code = SVFRT_code_conversion__schema_concrete_type_tag_mismatch;
+        return;
+      }
+
+      uint32_t unsafe_struct_index_src = unsafe_type_payload_src->definedStruct.index;
+      uint32_t struct_index_dst = type_payload_dst->definedStruct.index;
+
+      SVFRT_Phase2_TraverseStruct phase2_inner = {0};
+      SVFRT_Bytes struct_bytes_src;
+      if (!SVFRT_conversion_locate_struct(
+        &ctx->base,
+        unsafe_struct_index_src,
+        struct_index_dst,
+        data_range_src,
+        unsafe_data_offset_src,
+        phase2,
+        &struct_bytes_src,
+        &phase2_inner.struct_bytes_dst
+      )) {
+        return;
+      }
+
+      SVFRT_conversion64_traverse_struct(
+        ctx,
+        recursion_depth,
+        unsafe_struct_index_src,
+        struct_index_dst,
+        struct_bytes_src,
+        phase2 ? &phase2_inner : NULL
+      );
+      return;
+    }
+    case SVF_Meta_ConcreteType_tag_definedChoice: {
+      // Sanity check.
+      if (unsafe_type_tag_src != SVF_Meta_ConcreteType_tag_definedChoice) {
+        ctx->base.error_code = SVFRT_code_conversion__schema_concrete_type_tag_mismatch;
+        return;
+      }
+
+      SVF_Meta_OptionDefinition *unsafe_option_src;
+      SVF_Meta_OptionDefinition *option_dst;
+      if (!SVFRT_conversion_resolve_choice(
+        &ctx->base,
+        unsafe_type_payload_src->definedChoice.index,
+        type_payload_dst->definedChoice.index,
+        data_range_src,
+        unsafe_data_offset_src,
+        phase2,
+        &unsafe_option_src,
+        &option_dst
+      )) {
+        return;
+      }
+
+      SVFRT_Phase2_TraverseAnyType phase2_inner = {0};
+      if (phase2) {
+        phase2_inner.data_range_dst = phase2->data_range_dst;
+
+        phase2_inner.data_offset_dst = phase2->data_offset_dst + SVFRT_TAG_SIZE;
+      }
+
+      SVFRT_conversion64_traverse_any_type(
+        ctx,
+        recursion_depth,
+        data_range_src,
+        unsafe_data_offset_src + SVFRT_TAG_SIZE,
+        unsafe_option_src->type_tag,
+        &unsafe_option_src->type_payload,
+        option_dst->type_tag,
+        &option_dst->type_payload,
+        phase2 ? &phase2_inner : NULL
+      );
+      return;
+    }
+    default: {
+      // Primitives have no handles, so they are converted the same way as in
+      // regular messages.
+      SVFRT_conversion_traverse_concrete_type(
+        &ctx->base,
+        recursion_depth,
+        data_range_src,
+        unsafe_data_offset_src,
+        unsafe_type_tag_src,
+        unsafe_type_payload_src,
+        type_tag_dst,
+        type_payload_dst,
+        phase2
+      );
+      return;
+    }
+  }
+}
+
+// A reference is treated as a sequence with one element.
+static
+void SVFRT_conversion64_traverse_handle(
+  SVFRT_ConversionContext64 *ctx,
+  uint32_t recursion_depth,
+  SVFRT_Bytes data_range_src,
+  uint32_t unsafe_data_offset_src,
+  SVF_Meta_ConcreteType_tag unsafe_element_tag_src,
+  SVF_Meta_ConcreteType_payload *unsafe_element_payload_src,
+  SVF_Meta_ConcreteType_tag element_tag_dst,
+  SVF_Meta_ConcreteType_payload *element_payload_dst,
+  SVFRT_Phase2_TraverseAnyType *phase2,
+  bool is_sequence
+) {
+  uint32_t representation_size = is_sequence ? sizeof(SVFRT_Sequence64) : sizeof(SVFRT_Reference64);
+
+  // Prevent addition overflow by casting operands to `uint64_t` first.
+  if ((uint64_t) unsafe_data_offset_src + (uint64_t) representation_size > (uint64_t) data_range_src.count) {
+    ctx->base.error_code = SVFRT_code_conversion__data_out_of_bounds;
+    return;
+  }
+
+  SVFRT_Sequence64 unsafe_representation_src = {0};
+  SVFRT_MEMCPY(&unsafe_representation_src, data_range_src.pointer + unsafe_data_offset_src, representation_size);
+
+  // Allow invalid references and sequences, but only if the representation is
+  // zero. For Phase 2, the dst-representation is zero already, which is fine.
+  if (unsafe_representation_src.data_offset_complement == 0 && unsafe_representation_src.count == 0) {
+    return;
+  }
+  if (!is_sequence) {
+    unsafe_representation_src.count = 1;
+  }
+
+  uint32_t unsafe_size_src = SVFRT_conversion_get_type_size(
+    ctx->base.unsafe_structs_src,
+    unsafe_element_tag_src,
+    unsafe_element_payload_src
+  );
+  if (unsafe_size_src == 0) {
+    ctx->base.error_code = SVFRT_code_conversion__bad_type;
+    return;
+  }
+
+  uint32_t size_dst = SVFRT_conversion_get_type_size(
+    ctx->base.structs_dst,
+    element_tag_dst,
+    element_payload_dst
+  );
+  if (size_dst == 0) {
+    ctx->base.error_code = SVFRT_code_conversion_internal__bad_type;
+    return;
+  }
+
+  uint64_t unsafe_count = unsafe_representation_src.count;
+  SVFRT_Bytes64 suballocation = {0};
+  SVFRT_conversion64_tally(
+    ctx,
+    unsafe_size_src,
+    size_dst,
+    unsafe_count,
+    phase2 ? &suballocation : NULL
+  );
+  if (ctx->base.error_code) {
+    return;
+  }
+
+  if (phase2) {
+    SVFRT_conversion64_write_representation(
+      ctx,
+      phase2->data_range_dst,
+      phase2->data_offset_dst,
+      suballocation,
+      unsafe_count,
+      is_sequence
+    );
+    if (ctx->base.error_code) {
+      return;
+    }
+  }
+
+  // The tally above proves that `unsafe_size_src * unsafe_count` does not
+  // overflow, and is within the data.
+  uint64_t unsafe_offset_src = ~unsafe_representation_src.data_offset_complement;
+  uint64_t size_total_src = (uint64_t) unsafe_size_src * unsafe_count;
+  if (unsafe_offset_src > ctx->data_bytes.count - size_total_src) {
+    ctx->base.error_code = SVFRT_code_conversion__data_out_of_bounds;
+    return;
+  }
+  uint8_t *pointer_src = ctx->data_bytes.pointer + unsafe_offset_src;
+
+  // Sequences of primitives are converted all at once, same as in
+  // `SVFRT_conversion_start_sequence`.
+  bool is_exact_copy = (
+    unsafe_element_tag_src == element_tag_dst &&
+    element_tag_dst != SVF_Meta_ConcreteType_tag_definedStruct
+  );
+  uint32_t widening = SVFRT_conversion_get_widening(unsafe_element_tag_src, element_tag_dst);
+  if (is_sequence && (is_exact_copy || widening)) {
+    if (!phase2) return;
+
+    if (is_exact_copy) {
+      SVFRT_MEMCPY(suballocation.pointer, pointer_src, (size_t) suballocation.count);
+      return;
+    }
+
+    // `SVFRT_conversion_widen` takes 32-bit counts.
+    uint8_t *pointer_dst = suballocation.pointer;
+    uint64_t remaining = unsafe_count;
+    while (remaining > 0) {
+      uint32_t chunk = remaining < UINT32_MAX ? (uint32_t) remaining : UINT32_MAX;
+      SVFRT_conversion_widen(widening, pointer_dst, pointer_src, chunk);
+      pointer_src += (size_t) chunk * unsafe_size_src;
+      pointer_dst += (size_t) chunk * size_dst;
+      remaining -= chunk;
+    }
+    return;
+  }
+
+  for (uint64_t i = 0; i < unsafe_count; i++) {
+    SVFRT_Bytes element_bytes_src = {
+      /*.pointer =*/ pointer_src + i * unsafe_size_src,
+      /*.count =*/ unsafe_size_src,
+    };
+
+    SVFRT_Phase2_TraverseConcreteType phase2_inner = {0};
+    if (phase2) {
+      phase2_inner.data_range_dst.pointer = suballocation.pointer + i * size_dst;
+      phase2_inner.data_range_dst.count = size_dst;
+    }
+
+    SVFRT_conversion64_traverse_concrete_type(
+      ctx,
+      recursion_depth,
+      element_bytes_src,
+      0,
+      unsafe_element_tag_src,
+      unsafe_element_payload_src,
+      element_tag_dst,
+      element_payload_dst,
+      phase2 ? &phase2_inner : NULL
+    );
+
+    if (ctx->base.error_code) {
+      // Exit early on any error. The count is within the data, see above.
+      return;
+    }
+  }
+}
+
+static
+void SVFRT_conversion64_traverse_any_type(
+  SVFRT_ConversionContext64 *ctx,
+  uint32_t recursion_depth,
+  SVFRT_Bytes data_range_src,
+  uint32_t unsafe_data_offset_src,
+  SVF_Meta_Type_tag unsafe_type_tag_src,
+  SVF_Meta_Type_payload *unsafe_type_payload_src,
+  SVF_Meta_Type_tag type_tag_dst,
+  SVF_Meta_Type_payload *type_payload_dst,
+  SVFRT_Phase2_TraverseAnyType *phase2
+) {
+  recursion_depth += 1;
+  if (recursion_depth > ctx->base.max_recursion_depth) {
+    ctx->base.error_code = SVFRT_code_conversion__max_recursion_depth_exceeded;
+    return;
+  }
+
+  if (unsafe_type_tag_src != type_tag_dst) {
+    ctx->base.error_code = SVFRT_code_conversion__schema_type_tag_mismatch;
+    return;
+  }
+
+  switch (unsafe_type_tag_src) {
+    case SVF_Meta_Type_tag_concrete: {
+      SVFRT_Phase2_TraverseConcreteType phase2_inner = {0};
+      if (phase2) {
+        phase2_inner.data_range_dst = phase2->data_range_dst;
+        phase2_inner.data_offset_dst = phase2->data_offset_dst;
+      }
+
+      SVFRT_conversion64_traverse_concrete_type(
+        ctx,
+        recursion_depth,
+        data_range_src,
+        unsafe_data_offset_src,
+        unsafe_type_payload_src->concrete.type_tag,
+        &unsafe_type_payload_src->concrete.type_payload,
+        type_payload_dst->concrete.type_tag,
+        &type_payload_dst->concrete.type_payload,
+        phase2 ? &phase2_inner : NULL
+      );
+      return;
+    }
+    case SVF_Meta_Type_tag_reference: {
+      SVFRT_conversion64_traverse_handle(
+        ctx,
+        recursion_depth,
+        data_range_src,
+        unsafe_data_offset_src,
+        unsafe_type_payload_src->reference.type_tag,
+        &unsafe_type_payload_src->reference.type_payload,
+        type_payload_dst->reference.type_tag,
+        &type_payload_dst->reference.type_payload,
+        phase2,
+        false
+      );
+      return;
+    }
+    case SVF_Meta_Type_tag_sequence: {
+      SVFRT_conversion64_traverse_handle(
+        ctx,
+        recursion_depth,
+        data_range_src,
+        unsafe_data_offset_src,
+        unsafe_type_payload_src->sequence.elementType_tag,
+        &unsafe_type_payload_src->sequence.elementType_payload,
+        type_payload_dst->sequence.elementType_tag,
+        &type_payload_dst->sequence.elementType_payload,
+        phase2,
+        true
+      );
+      return;
+    }
+    default: {
+      ctx->base.error_code = SVFRT_code_conversion__bad_schema_type_tag;
+    }
+  }
+}
+
+void SVFRT_convert_message64(
+  SVFRT_ConversionResult64 *out_result,
+  SVFRT_CompatibilityResult *check_result,
+  SVFRT_Bytes64 data_bytes,
+  uint32_t max_recursion_depth,
+  uint64_t total_data_size_limit,
+  SVFRT_AllocatorFn *allocator_fn, // Non-NULL.
+  void *allocator_ptr
+) {
+  if (check_result->level != SVFRT_compatibility_logical) {
+    out_result->error_code = SVFRT_code_conversion_internal__need_logical_compatibility;
+    return;
+  }
+
+  SVFRT_ConversionContext64 ctx_val = {0};
+  SVFRT_ConversionContext64 *ctx = &ctx_val;
+  SVFRT_LogicalCompatibilityInfo *info = &check_result->logical;
+
+  SVFRT_ErrorCode error_code = SVFRT_conversion_init_schemas(&ctx->base, info);
+  if (error_code != 0) {
+    out_result->error_code = error_code;
+    return;
+  }
+  ctx->base.max_recursion_depth = max_recursion_depth;
+  ctx->data_bytes = data_bytes;
+  ctx->total_data_size_limit_dst = total_data_size_limit;
+
+  uint32_t unsafe_entry_struct_size_src = info->unsafe_entry_struct_size_src;
+  uint32_t entry_struct_size_dst = info->entry_struct_size_dst;
+  if ((uint64_t) unsafe_entry_struct_size_src > data_bytes.count) {
+    out_result->error_code = SVFRT_code_conversion__data_out_of_bounds;
+    return;
+  }
+
+  SVFRT_Bytes entry_bytes_src = {
+    /*.pointer =*/ data_bytes.pointer + data_bytes.count - unsafe_entry_struct_size_src,
+    /*.count =*/ unsafe_entry_struct_size_src,
+  };
+
+  //
+  // Phase 1: calculate size needed for the allocation.
+  //
+
+  SVFRT_conversion64_traverse_struct(
+    ctx,
+    0,
+    info->entry_struct_index_src,
+    info->entry_struct_index_dst,
+    entry_bytes_src,
+    NULL
+  );
+  if (!ctx->base.error_code) {
+    SVFRT_conversion64_tally(ctx, unsafe_entry_struct_size_src, entry_struct_size_dst, 1, NULL);
+  }
+  if (ctx->base.error_code) {
+    out_result->error_code = ctx->base.error_code;
+    return;
+  }
+
+  // The size may not fit into `size_t` on 32-bit platforms.
+  void *allocated_pointer = NULL;
+  if ((uint64_t) (size_t) ctx->tally_dst == ctx->tally_dst) {
+    allocated_pointer = allocator_fn(allocator_ptr, (size_t) ctx->tally_dst);
+  }
+  if (!allocated_pointer) {
+    out_result->error_code = SVFRT_code_conversion__allocation_failed;
+    return;
+  }
+
+  ctx->allocation.pointer = (uint8_t *) allocated_pointer;
+  ctx->allocation.count = ctx->tally_dst;
+  out_result->output_bytes = ctx->allocation;
+
+  // Zero out the memory, and reset the tallies between the phases.
+  SVFRT_MEMSET(ctx->allocation.pointer, 0, (size_t) ctx->allocation.count);
+  ctx->tally_src = 0;
+  ctx->tally_dst = 0;
+
+  // Entry is special, as it always resides at the end of the data range.
+  SVFRT_Bytes entry_bytes_dst = {
+    /*.pointer =*/ ctx->allocation.pointer + ctx->allocation.count - entry_struct_size_dst,
+    /*.count =*/ entry_struct_size_dst,
+  };
+
+  //
+  // Phase 2: actually copy the data.
+  //
+
+  SVFRT_Phase2_TraverseStruct phase2 = {0};
+  phase2.struct_bytes_dst = entry_bytes_dst;
+  SVFRT_conversion64_traverse_struct(
+    ctx,
+    0,
+    info->entry_struct_index_src,
+    info->entry_struct_index_dst,
+    entry_bytes_src,
+    &phase2
+  );
+
+  SVFRT_Bytes64 entry_bytes_dst_alternate = {0};
+  if (!ctx->base.error_code) {
+    SVFRT_conversion64_tally(
+      ctx,
+      unsafe_entry_struct_size_src,
+      entry_struct_size_dst,
+      1,
+      &entry_bytes_dst_alternate
+    );
+  }
+  if (ctx->base.error_code) {
+    out_result->error_code = ctx->base.error_code;
+    return;
+  }
+
+  // Sanity checks, same as in `SVFRT_conversion_complete`.
+  if (
+    (entry_bytes_dst.pointer != entry_bytes_dst_alternate.pointer) ||
+    ((uint64_t) entry_bytes_dst.count != entry_bytes_dst_alternate.count) ||
+    (ctx->tally_dst != ctx->allocation.count)
+  ) {
+    out_result->error_code = SVFRT_code_conversion_internal__suballocation_mismatch;
+    return;
+  }
+
+  out_result->success = true;
+}
+
+// #generated-conversion.
+//
+// The generated code does the traversal with hard-coded offsets, and calls back
+// here for handles. Everything else is the same as for the recursive traversal
+// above: the tallies, the suballocation order, and the checks, so the output is
+// the same as well. The schemas are only checked at build time, so the struct
+// layouts are trusted, but the data is not, and handles are bounds-checked here.
+//
+// There are no plan, iterative, single-pass, parallel, or memoized variants.
+
+struct SVFRT_GeneratedConversion {
+  // Only the data, the limits, the tallies, and the allocation are used.
+  SVFRT_ConversionContext base;
+};
+
+bool SVFRT_generated_enter(SVFRT_GeneratedConversion *ctx, uint32_t recursion_depth) {
+  if (recursion_depth > ctx->base.max_recursion_depth) {
+    ctx->base.error_code = SVFRT_code_conversion__max_recursion_depth_exceeded;
+    return false;
+  }
+  return true;
+}
+
+bool SVFRT_generated_handle(
+  SVFRT_GeneratedConversion *generated,
+  uint8_t const *representation_src,
+  uint8_t *representation_dst,
+  bool is_sequence,
+  uint32_t element_size_src,
+  uint32_t element_size_dst,
+  uint32_t element_tag_src,
+  uint32_t element_tag_dst,
+  SVFRT_GeneratedElements *out_elements
+) {
+  SVFRT_ConversionContext *ctx = &generated->base;
+  out_elements->pointer_src = NULL;
+  out_elements->pointer_dst = NULL;
+  out_elements->count = 0;
+
+  // The representation itself is within a struct value, which is trusted.
+  SVFRT_Sequence unsafe_representation_src = {0};
+  SVFRT_MEMCPY(
+    &unsafe_representation_src,
+    representation_src,
+    is_sequence ? sizeof(SVFRT_Sequence) : sizeof(SVFRT_Reference)
+  );
+
+  // Allow invalid references and sequences, but only if the representation is
+  // zero. For Phase 2, the dst-representation is zero already, which is fine.
+  if (unsafe_representation_src.data_offset_complement == 0 && unsafe_representation_src.count == 0) {
+    return true;
+  }
+  if (!is_sequence) {
+    if (unsafe_representation_src.data_offset_complement == 0) {
+      return true;
+    }
+    unsafe_representation_src.count = 1;
+  }
+
+  SVFRT_Bytes suballocation = {0};
+  SVFRT_conversion_tally(
+    ctx,
+    element_size_src,
+    element_size_dst,
+    unsafe_representation_src.count,
+    representation_dst ? &suballocation : NULL
+  );
+  if (ctx->error_code) {
+    return false;
+  }
+
+  if (representation_dst) {
+    SVFRT_Bytes range_dst = {
+      /*.pointer =*/ representation_dst,
+      /*.count =*/ (uint32_t) (is_sequence ? sizeof(SVFRT_Sequence) : sizeof(SVFRT_Reference)),
+    };
+    SVFRT_conversion_write_representation(
+      ctx,
+      range_dst,
+      0,
+      suballocation,
+      unsafe_representation_src.count,
+      is_sequence
+    );
+    if (ctx->error_code) {
+      return false;
+    }
+  }
+
+  // Prevent multiply-add overflow by casting operands to `uint64_t` first.
+  uint32_t unsafe_offset_src = ~unsafe_representation_src.data_offset_complement;
+  uint64_t unsafe_end_offset_src = (
+    (uint64_t) unsafe_offset_src +
+    (uint64_t) unsafe_representation_src.count * (uint64_t) element_size_src
+  );
+  if (unsafe_end_offset_src > (uint64_t) ctx->data_bytes.count) {
+    ctx->error_code = SVFRT_code_conversion__data_out_of_bounds;
+    return false;
+  }
+  uint8_t *pointer_src = ctx->data_bytes.pointer + unsafe_offset_src;
+
+  if (element_tag_dst == SVF_Meta_ConcreteType_tag_definedStruct) {
+    out_elements->pointer_src = pointer_src;
+    out_elements->pointer_dst = representation_dst ? suballocation.pointer : NULL;
+    out_elements->count = unsafe_representation_src.count;
+    return true;
+  }
+
+  // Primitives are converted all at once, same as in `SVFRT_conversion_start_sequence`.
+  if (!representation_dst) {
+    return true;
+  }
+
+  // No overflow possible, see #phase2-reasonable-dst-sum.
+  if (element_tag_src == element_tag_dst) {
+    SVFRT_MEMCPY(suballocation.pointer, pointer_src, suballocation.count);
+    return true;
+  }
+
+  uint32_t widening = SVFRT_conversion_get_widening(
+    (SVF_Meta_ConcreteType_tag) element_tag_src,
+    (SVF_Meta_ConcreteType_tag) element_tag_dst
+  );
+  if (!widening) {
+    ctx->error_code = SVFRT_code_conversion__bad_type;
+    return false;
+  }
+  SVFRT_conversion_widen(widening, suballocation.pointer, pointer_src, unsafe_representation_src.count);
+  return true;
+}
+
+void SVFRT_convert_message_generated(
+  SVFRT_ConversionResult *out_result,
+  SVFRT_GeneratedConverter const *converter,
+  SVFRT_Bytes data_bytes,
+  uint32_t max_recursion_depth,
+  uint32_t total_data_size_limit,
+  SVFRT_AllocatorFn *allocator_fn, // Non-NULL.
+  void *allocator_ptr
+) {
+  SVFRT_GeneratedConversion generated = {0};
+  SVFRT_ConversionContext *ctx = &generated.base;
+  ctx->data_bytes = data_bytes;
+  ctx->max_recursion_depth = max_recursion_depth;
+  ctx->total_data_size_limit_dst = total_data_size_limit;
+
+  uint32_t entry_struct_size_src = converter->entry_struct_size_src;
+  uint32_t entry_struct_size_dst = converter->entry_struct_size_dst;
+  if (entry_struct_size_src > data_bytes.count) {
+    out_result->error_code = SVFRT_code_conversion__data_out_of_bounds;
+    return;
+  }
+
+  uint8_t *entry_src = data_bytes.pointer + data_bytes.count - entry_struct_size_src;
+
+  //
+  // Phase 1: calculate size needed for the allocation.
+  //
+
+  if (converter->convert_entry(&generated, 0, entry_src, NULL)) {
+    SVFRT_conversion_tally(ctx, entry_struct_size_src, entry_struct_size_dst, 1, NULL);
+  }
+  if (ctx->error_code) {
+    out_result->error_code = ctx->error_code;
+    return;
+  }
+
+  void *allocated_pointer = allocator_fn(allocator_ptr, ctx->tally_dst);
+  if (!allocated_pointer) {
+    out_result->error_code = SVFRT_code_conversion__allocation_failed;
+    return;
+  }
 
-        if (phase2) {
-          // `phase2_inner.data_range_dst` was filled by `SVFRT_conversion_tally`.
+  ctx->allocation.pointer = (uint8_t *) allocated_pointer;
+  ctx->allocation.count = ctx->tally_dst;
+  out_result->output_bytes = ctx->allocation;
 
-          // No overflow possible:
-          //
-          // Let `C = unsafe_representation_src.count`.  We know that `i < C`.
-          // And we know that `size_dst * C` does not overflow, because
-          // `SVFRT_conversion_tally` has succeeded, see #phase2-reasonable-dst-sum.
-          phase2_inner.data_offset_dst = size_dst * i;
-        }
+  // Zero out the memory, and reset the tallies between the phases.
+  SVFRT_MEMSET(ctx->allocation.pointer, 0, ctx->allocation.count);
+  ctx->tally_src = 0;
+  ctx->tally_dst = 0;
 
-        // TODO: for a sequence of primitives, this is far from optimal. If the
-        // types match, we can just `memcpy` the whole thing instead of looping.
-        //
-        // Typical example would be a long U8 sequence.
+  // Entry is special, as it always resides at the end of the data range.
+  uint8_t *entry_dst = ctx->allocation.pointer + ctx->allocation.count - entry_struct_size_dst;
 
-        SVFRT_conversion_traverse_concrete_type(
-          ctx,
-          recursion_depth,
-          ctx->data_bytes,
-          unsafe_final_offset_src,
-          unsafe_type_payload_src->reference.type_tag,
-          &unsafe_type_payload_src->reference.type_payload,
-          type_payload_dst->reference.type_tag,
-          &type_payload_dst->reference.type_payload,
-          phase2 ? &phase2_inner : NULL
-        );
+  //
+  // Phase 2: actually copy the data.
+  //
 
-        if (ctx->error_code) {
-          // Exit early on any error. This would include any tally limit checks,
-          // so it's fine to loop even though the count might be malicious.
-          return;
-        }
-      }
-      return;
-    }
-    default: {
-      ctx->error_code = SVFRT_code_conversion__bad_schema_type_tag;
-    }
+  SVFRT_Bytes entry_bytes_dst_alternate = {0};
+  if (converter->convert_entry(&generated, 0, entry_src, entry_dst)) {
+    SVFRT_conversion_tally(ctx, entry_struct_size_src, entry_struct_size_dst, 1, &entry_bytes_dst_alternate);
+  }
+  if (ctx->error_code) {
+    out_result->error_code = ctx->error_code;
+    return;
   }
+
+  // Sanity checks, same as in `SVFRT_conversion_complete`.
+  if (
+    (entry_dst != entry_bytes_dst_alternate.pointer) ||
+    (entry_struct_size_dst != entry_bytes_dst_alternate.count) ||
+    (ctx->tally_dst != ctx->allocation.count)
+  ) {
+    out_result->error_code = SVFRT_code_conversion_internal__suballocation_mismatch;
+    return;
+  }
+
+  out_result->success = true;
 }
 
-void SVFRT_convert_message(
+// #lazy-view conversions.
+//
+// A view converts parts of a message only when they are accessed: single values
+// without handles straight into the caller's memory, and whole subtrees as if
+// their root struct was the entry. Both reuse the regular conversion, so the
+// results are the same as in the fully converted message.
+
+void SVFRT_convert_struct(
   SVFRT_ConversionResult *out_result,
   SVFRT_CompatibilityResult *check_result,
   SVFRT_Bytes data_bytes,
+  uint32_t unsafe_data_offset_src,
+  uint32_t unsafe_struct_index_src,
+  uint32_t struct_index_dst,
   uint32_t max_recursion_depth,
   uint32_t total_data_size_limit,
   SVFRT_AllocatorFn *allocator_fn, // Non-NULL.
   void *allocator_ptr
 ) {
-  // A previously passed compatibility check allows us to reuse some data, and
-  // also make some assumptions.
   if (check_result->level != SVFRT_compatibility_logical) {
     out_result->error_code = SVFRT_code_conversion_internal__need_logical_compatibility;
     return;
   }
 
-  SVFRT_LogicalCompatibilityInfo *info = &check_result->logical;
-
-  uint32_t unsafe_entry_struct_size = info->unsafe_entry_struct_size_src;
-
-  if (unsafe_entry_struct_size > data_bytes.count) {
-    out_result->error_code = SVFRT_code_conversion__data_out_of_bounds;
-    return;
-  }
-
-  // Now, `unsafe_entry_size` can be considered safe.
-  // TODO @proper-alignment: struct access.
-  SVFRT_Bytes entry_bytes_src = {
-    /*.pointer =*/ data_bytes.pointer + data_bytes.count - unsafe_entry_struct_size,
-    /*.count =*/ unsafe_entry_struct_size,
-  };
+  // The subtree is converted as if its root was the entry, so substitute it.
+  SVFRT_CompatibilityResult subtree_check_result = *check_result;
+  SVFRT_LogicalCompatibilityInfo *info = &subtree_check_result.logical;
 
   SVFRT_RangeStructDefinition unsafe_structs_src = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
     info->unsafe_schema_src,
     info->unsafe_definition_src->structs,
     SVF_Meta_StructDefinition
   );
-  if (!unsafe_structs_src.pointer && unsafe_structs_src.count) {
-    out_result->error_code = SVFRT_code_conversion__bad_schema_structs;
+  if (unsafe_struct_index_src >= unsafe_structs_src.count || !unsafe_structs_src.pointer) {
+    out_result->error_code = SVFRT_code_conversion__bad_schema_struct_index;
     return;
-  };
+  }
 
   SVFRT_RangeStructDefinition structs_dst = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
     info->schema_dst,
     info->definition_dst->structs,
     SVF_Meta_StructDefinition
   );
-  if (!structs_dst.pointer && structs_dst.count) {
-    out_result->error_code = SVFRT_code_conversion_internal__bad_schema_structs;
+  if (struct_index_dst >= structs_dst.count || !structs_dst.pointer) {
+    out_result->error_code = SVFRT_code_conversion_internal__bad_schema_struct_index;
     return;
   }
 
-  SVFRT_RangeChoiceDefinition unsafe_choices_src = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
-    info->unsafe_schema_src,
-    info->unsafe_definition_src->choices,
-    SVF_Meta_ChoiceDefinition
-  );
-  if (!unsafe_choices_src.pointer && unsafe_choices_src.count) {
-    out_result->error_code = SVFRT_code_conversion__bad_schema_choices;
+  info->entry_struct_index_src = unsafe_struct_index_src;
+  info->entry_struct_index_dst = struct_index_dst;
+  info->unsafe_entry_struct_size_src = unsafe_structs_src.pointer[unsafe_struct_index_src].size;
+  info->entry_struct_size_dst = structs_dst.pointer[struct_index_dst].size;
+
+  // The plan starts at the entry, see #conversion-plan, so traverse instead.
+  info->conversion_plan.pointer = NULL;
+  info->conversion_plan.count = 0;
+
+  SVFRT_Bytes no_memo = {0};
+  SVFRT_ConversionContext ctx_val = {0};
+  SVFRT_ConversionContext *ctx = &ctx_val;
+  SVFRT_Bytes entry_bytes_src = {0};
+  if (!SVFRT_conversion_init(
+    ctx,
+    out_result,
+    &subtree_check_result,
+    data_bytes,
+    max_recursion_depth,
+    total_data_size_limit,
+    no_memo,
+    &entry_bytes_src
+  )) {
     return;
-  };
+  }
 
-  SVFRT_RangeChoiceDefinition choices_dst = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
-    info->schema_dst,
-    info->definition_dst->choices,
-    SVF_Meta_ChoiceDefinition
-  );
-  if (!choices_dst.pointer && choices_dst.count) {
-    out_result->error_code = SVFRT_code_conversion_internal__bad_schema_choices;
+  // The root is not at the end of the data range, unlike the entry.
+  //
+  // Prevent addition overflow by casting operands to `uint64_t` first.
+  if ((uint64_t) unsafe_data_offset_src + (uint64_t) entry_bytes_src.count > (uint64_t) data_bytes.count) {
+    out_result->error_code = SVFRT_code_conversion__data_out_of_bounds;
     return;
   }
+  entry_bytes_src.pointer = data_bytes.pointer + unsafe_data_offset_src;
+
+  SVFRT_conversion_run(out_result, ctx, entry_bytes_src, false, NULL, NULL, 0, allocator_fn, allocator_ptr);
+}
 
+SVFRT_ErrorCode SVFRT_convert_flat_values(
+  SVFRT_CompatibilityResult *check_result,
+  SVFRT_Bytes data_bytes,
+  SVFRT_Bytes range_src,
+  uint32_t unsafe_offset_src,
+  uint32_t unsafe_stride_src,
+  SVF_Meta_ConcreteType_tag unsafe_type_tag_src,
+  SVF_Meta_ConcreteType_payload *unsafe_type_payload_src,
+  SVF_Meta_ConcreteType_tag type_tag_dst,
+  SVF_Meta_ConcreteType_payload *type_payload_dst,
+  uint32_t count,
+  uint32_t max_recursion_depth,
+  SVFRT_Bytes out_bytes
+) {
+  SVFRT_ConversionResult result = {0};
+  SVFRT_Bytes no_memo = {0};
   SVFRT_ConversionContext ctx_val = {0};
-  ctx_val.info = info;
-  ctx_val.data_bytes = data_bytes;
-  ctx_val.max_recursion_depth = max_recursion_depth;
-  ctx_val.unsafe_structs_src = unsafe_structs_src;
-  ctx_val.structs_dst = structs_dst;
-  ctx_val.unsafe_choices_src = unsafe_choices_src;
-  ctx_val.choices_dst = choices_dst;
-  ctx_val.total_data_size_limit_dst = total_data_size_limit;
   SVFRT_ConversionContext *ctx = &ctx_val;
+  SVFRT_Bytes entry_bytes_src = {0};
+  if (!SVFRT_conversion_init(
+    ctx,
+    &result,
+    check_result,
+    data_bytes,
+    max_recursion_depth,
+    SVFRT_NO_SIZE_LIMIT,
+    no_memo,
+    &entry_bytes_src
+  )) {
+    return result.error_code;
+  }
 
-  //
-  // Phase 1: calculate size needed for the allocation.
-  //
+  // Without any handles, Phase 2 only writes into `out_bytes`, and Phase 1
+  // would do nothing. All offsets are bounds-checked by the traversal.
+  uint32_t size_dst = count ? out_bytes.count / count : 0;
+  for (uint32_t i = 0; i < count; i++) {
+    uint64_t offset_src = (uint64_t) unsafe_offset_src + (uint64_t) i * (uint64_t) unsafe_stride_src;
+    if (offset_src > (uint64_t) range_src.count) {
+      return SVFRT_code_conversion__data_out_of_bounds;
+    }
 
-  uint32_t recursion_depth = 0;
-  SVFRT_conversion_traverse_struct(
-    ctx,
-    recursion_depth,
-    info->entry_struct_index_src,
-    info->entry_struct_index_dst,
-    entry_bytes_src,
-    NULL
-  );
-  if (ctx->error_code) {
-    out_result->error_code = ctx->error_code;
-    return;
+    SVFRT_Phase2_TraverseConcreteType phase2 = {0};
+    phase2.data_range_dst = out_bytes;
+    phase2.data_offset_dst = i * size_dst;
+    SVFRT_conversion_traverse_concrete_type(
+      ctx,
+      0, // `recursion_depth`.
+      range_src,
+      (uint32_t) offset_src,
+      unsafe_type_tag_src,
+      unsafe_type_payload_src,
+      type_tag_dst,
+      type_payload_dst,
+      &phase2
+    );
+    if (ctx->error_code) {
+      return ctx->error_code;
+    }
   }
+  return 0;
+}
 
-  SVFRT_conversion_tally(
-    ctx,
-    info->unsafe_entry_struct_size_src,
-    info->entry_struct_size_dst,
-    1,
-    NULL
-  );
-  if (ctx->error_code) {
-    out_result->error_code = ctx->error_code;
-    return;
+// #resumable-conversion.
+//
+// Both phases of the conversion, but run a limited amount at a time, with all
+// of the state kept in caller-supplied memory: the context, and the stack for
+// the #iterative-conversion. `SVFRT_convert_message_step` can then be called
+// repeatedly until it's done, with other work in between.
+//
+// The plan, #single-pass-conversion and #parallel-conversion are not used,
+// since they run to completion. That does not change the output, which is the
+// same as from `SVFRT_convert_message`.
+//
+// Without `SVFRT_ITERATIVE_CONVERSION`, there is no stack to resume from, so
+// each phase is done in a single step instead.
+
+#define SVFRT_RESUMABLE_PHASE1 1
+#define SVFRT_RESUMABLE_PHASE2 2
+#define SVFRT_RESUMABLE_DONE 3
+
+struct SVFRT_ResumableConversion {
+  SVFRT_ConversionContext ctx;
+  SVFRT_ConversionResult result;
+  uint32_t stage;
+
+  SVFRT_Bytes entry_bytes_src;
+  SVFRT_Bytes entry_bytes_dst; // Phase 2 only.
+
+  SVFRT_AllocatorFn *allocator_fn;
+  void *allocator_ptr;
+};
+
+// The frames follow the state, see `SVFRT_resumable_conversion_size`.
+#define SVFRT_RESUMABLE_STATE_SIZE \
+  ((sizeof(SVFRT_ResumableConversion) + SVFRT_FRAME_ALIGNMENT - 1) / SVFRT_FRAME_ALIGNMENT * SVFRT_FRAME_ALIGNMENT)
+
+uint32_t SVFRT_resumable_conversion_size(uint32_t max_recursion_depth) {
+  uint64_t size = (SVFRT_FRAME_ALIGNMENT - 1) + SVFRT_RESUMABLE_STATE_SIZE;
+#ifdef SVFRT_ITERATIVE_CONVERSION
+  size += SVFRT_conversion_stack_size(max_recursion_depth);
+#else
+  (void) max_recursion_depth;
+#endif
+  if (size > (uint64_t) UINT32_MAX) {
+    return UINT32_MAX;
   }
+  return (uint32_t) size;
+}
 
-  void *allocated_pointer = allocator_fn(allocator_ptr, ctx->tally_dst);
-  if (!allocated_pointer) {
-    out_result->error_code = SVFRT_code_conversion__allocation_failed;
-    return;
+// Run the current phase on the entry, as far as `*inout_budget` allows.
+// Returns true, if the phase is done (or failed).
+static
+bool SVFRT_resumable_run_phase(SVFRT_ResumableConversion *conversion, uint32_t *inout_budget) {
+  SVFRT_ConversionContext *ctx = &conversion->ctx;
+  bool phase2 = conversion->stage == SVFRT_RESUMABLE_PHASE2;
+#ifdef SVFRT_ITERATIVE_CONVERSION
+  return SVFRT_iterative_step(ctx, phase2, inout_budget);
+#else
+  if (*inout_budget == 0) {
+    return false;
   }
+  *inout_budget -= 1;
+  SVFRT_conversion_run_entry(ctx, conversion->entry_bytes_src, phase2 ? &conversion->entry_bytes_dst : NULL);
+  return true;
+#endif
+}
 
-  ctx->allocation.pointer = (uint8_t *) allocated_pointer;
-  ctx->allocation.count = ctx->tally_dst;
-  out_result->output_bytes = ctx->allocation;
+SVFRT_ResumableConversion *SVFRT_convert_message_begin(
+  SVFRT_ConversionResult *out_result,
+  SVFRT_CompatibilityResult *check_result,
+  SVFRT_Bytes data_bytes,
+  uint32_t max_recursion_depth,
+  uint32_t total_data_size_limit,
+  SVFRT_Bytes memory,
+  SVFRT_Bytes conversion_memo,
+  SVFRT_AllocatorFn *allocator_fn,
+  void *allocator_ptr
+) {
+  uintptr_t misalignment = ((uintptr_t) memory.pointer) % SVFRT_FRAME_ALIGNMENT;
+  uint32_t padding = misalignment ? (uint32_t) (SVFRT_FRAME_ALIGNMENT - misalignment) : 0;
+  if (!memory.pointer || memory.count < padding + SVFRT_RESUMABLE_STATE_SIZE) {
+    return NULL;
+  }
 
-  // Zero out the memory.
-  SVFRT_MEMSET(ctx->allocation.pointer, 0, ctx->allocation.count);
+  SVFRT_ResumableConversion *conversion = (SVFRT_ResumableConversion *) (memory.pointer + padding);
+  SVFRT_MEMSET(conversion, 0, sizeof(*conversion));
+  conversion->allocator_fn = allocator_fn;
+  conversion->allocator_ptr = allocator_ptr;
+  conversion->stage = SVFRT_RESUMABLE_PHASE1;
 
-  // Reset tallies between the phases.
-  ctx->tally_src = 0;
-  ctx->tally_dst = 0;
-  recursion_depth = 0;
+  SVFRT_ConversionContext *ctx = &conversion->ctx;
+  if (!SVFRT_conversion_init(
+    ctx,
+    &conversion->result,
+    check_result,
+    data_bytes,
+    max_recursion_depth,
+    total_data_size_limit,
+    conversion_memo,
+    &conversion->entry_bytes_src
+  )) {
+    conversion->stage = SVFRT_RESUMABLE_DONE;
+    *out_result = conversion->result;
+    return conversion;
+  }
+
+  // Only the traversal can be resumed.
+  ctx->plan.pointer = NULL;
+  ctx->plan.count = 0;
+
+#ifdef SVFRT_ITERATIVE_CONVERSION
+  SVFRT_Bytes stack = {
+    /*.pointer =*/ memory.pointer + padding + SVFRT_RESUMABLE_STATE_SIZE,
+    /*.count =*/ memory.count - padding - (uint32_t) SVFRT_RESUMABLE_STATE_SIZE,
+  };
+  SVFRT_conversion_use_stack(ctx, stack);
+#endif
 
   //
-  // Phase 2: actually copy the data.
+  // Phase 1: calculate size needed for the allocation.
   //
 
-  SVF_Meta_StructDefinition *definition_dst = ctx->structs_dst.pointer + ctx->info->entry_struct_index_dst;
+  SVFRT_conversion_memo_clear(ctx);
+#ifdef SVFRT_ITERATIVE_CONVERSION
+  SVFRT_iterative_begin_entry(ctx, conversion->entry_bytes_src, NULL);
+#endif
 
-  // Entry is special, as it always resides at the end of the data range.
-  //
-  // TODO: @proper-alignment: struct access.
-  SVFRT_Bytes entry_bytes_dst = {
-    /*.pointer =*/ ctx->allocation.pointer + ctx->allocation.count - definition_dst->size,
-    /*.size =*/ definition_dst->size,
-  };
+  *out_result = conversion->result;
+  return conversion;
+}
 
-  SVFRT_Phase2_TraverseStruct phase2 = {
-    /*.struct_bytes_dst =*/ entry_bytes_dst
-  };
-  SVFRT_conversion_traverse_struct(
-    ctx,
-    recursion_depth,
-    info->entry_struct_index_src,
-    info->entry_struct_index_dst,
-    entry_bytes_src,
-    &phase2
-  );
-  if (ctx->error_code) {
-    out_result->error_code = ctx->error_code;
-    return;
-  }
+bool SVFRT_convert_message_step(
+  SVFRT_ResumableConversion *conversion,
+  SVFRT_ConversionResult *out_result,
+  uint32_t budget
+) {
+  SVFRT_ConversionContext *ctx = &conversion->ctx;
 
-  SVFRT_Bytes entry_bytes_dst_alternate = {0};
-  SVFRT_conversion_tally(
-    ctx,
-    info->unsafe_entry_struct_size_src,
-    info->entry_struct_size_dst,
-    1,
-    &entry_bytes_dst_alternate
-  );
-  if (ctx->error_code) {
-    out_result->error_code = ctx->error_code;
-    return;
+  if (conversion->stage == SVFRT_RESUMABLE_PHASE1) {
+    if (!SVFRT_resumable_run_phase(conversion, &budget)) {
+      *out_result = conversion->result;
+      return false;
+    }
+
+    if (ctx->error_code) {
+      conversion->result.error_code = ctx->error_code;
+      conversion->stage = SVFRT_RESUMABLE_DONE;
+    } else if (!SVFRT_conversion_allocate(
+      &conversion->result,
+      ctx,
+      conversion->allocator_fn,
+      conversion->allocator_ptr,
+      &conversion->entry_bytes_dst
+    )) {
+      conversion->stage = SVFRT_RESUMABLE_DONE;
+    } else {
+      //
+      // Phase 2: actually copy the data.
+      //
+
+      conversion->stage = SVFRT_RESUMABLE_PHASE2;
+#ifdef SVFRT_ITERATIVE_CONVERSION
+      SVFRT_iterative_begin_entry(ctx, conversion->entry_bytes_src, &conversion->entry_bytes_dst);
+#endif
+    }
   }
 
-  // Sanity checks.
-  if (
-    (entry_bytes_dst.pointer != entry_bytes_dst_alternate.pointer) ||
-    (entry_bytes_dst.count != entry_bytes_dst_alternate.count) ||
-    (ctx->tally_dst != ctx->allocation.count)
-  ) {
-    // Something went terribly wrong.
-    // TODO: should this kind of "fatal" error be separate?
-    out_result->error_code = SVFRT_code_conversion_internal__suballocation_mismatch;
-    return;
+  if (conversion->stage == SVFRT_RESUMABLE_PHASE2) {
+    if (!SVFRT_resumable_run_phase(conversion, &budget)) {
+      *out_result = conversion->result;
+      return false;
+    }
+
+    if (ctx->error_code) {
+      conversion->result.error_code = ctx->error_code;
+    } else {
+      SVFRT_conversion_complete(&conversion->result, ctx, conversion->entry_bytes_dst);
+    }
+    conversion->stage = SVFRT_RESUMABLE_DONE;
   }
 
-  out_result->success = true;
+  *out_result = conversion->result;
+  return true;
 }
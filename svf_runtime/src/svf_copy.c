@@ -0,0 +1,590 @@
+#ifndef SVFRT_SINGLE_FILE
+  #include "svf_runtime.h"
+  #include "svf_internal.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// #subtree-copying
+//
+// Data is written bottom-up, since a handle can only be written once its
+// target is. So for a range with handles in it, all of its targets are copied
+// first, and the range itself is written last, from its copy in `scratch`.
+// Source handles are read from that copy as well, so the source data is never
+// read twice.
+//
+// Same as for #message-verification, all source ranges together may not be
+// larger than the source data, which bounds the total work.
+
+typedef struct SVFRT_CopyContext {
+  SVFRT_WriteContext *dst;
+  SVFRT_Bytes schema;
+  SVFRT_RangeStructDefinition structs;
+  SVFRT_RangeChoiceDefinition choices;
+  SVFRT_Bytes data_range;
+  SVFRT_RangeU32 struct_strides;
+  SVFRT_Bytes scratch;
+  uint32_t scratch_used;
+  uint32_t max_recursion_depth;
+  uint64_t tally;
+} SVFRT_CopyContext;
+
+// Forward declarations.
+static
+void SVFRT_copy_fix_any_type(
+  SVFRT_CopyContext *ctx,
+  uint32_t recursion_depth,
+  uint8_t *item,
+  SVF_Meta_Type_tag type_tag,
+  SVF_Meta_Type_payload *type_payload
+);
+
+static
+void SVFRT_copy_fix_concrete_type(
+  SVFRT_CopyContext *ctx,
+  uint32_t recursion_depth,
+  uint8_t *item,
+  SVF_Meta_ConcreteType_tag type_tag,
+  SVF_Meta_ConcreteType_payload *type_payload
+);
+
+static
+void SVFRT_copy_fail(SVFRT_CopyContext *ctx, SVFRT_ErrorCode error_code) {
+  if (!ctx->dst->error_code) {
+    ctx->dst->error_code = error_code;
+  }
+}
+
+// Check that `[data_offset, data_offset + stride * count)` is inside of the
+// source data, and account for it in the tally. Returns `false` on an error.
+static inline
+bool SVFRT_copy_suballocation(
+  SVFRT_CopyContext *ctx,
+  uint32_t data_offset,
+  uint32_t stride,
+  uint32_t count
+) {
+  // Prevent multiply-add overflow by casting operands to `uint64_t` first. It
+  // works, because `UINT64_MAX == UINT32_MAX * UINT32_MAX + UINT32_MAX + UINT32_MAX`.
+  uint64_t total_size = (uint64_t) stride * (uint64_t) count;
+  if ((uint64_t) data_offset + total_size > (uint64_t) ctx->data_range.count) {
+    SVFRT_copy_fail(ctx, SVFRT_code_write__bad_subtree);
+    return false;
+  }
+
+  // Both operands are at most `UINT32_MAX`, so this can't overflow.
+  ctx->tally += total_size;
+  if (ctx->tally > (uint64_t) ctx->data_range.count) {
+    SVFRT_copy_fail(ctx, SVFRT_code_write__bad_subtree);
+    return false;
+  }
+
+  return true;
+}
+
+// Take `size` bytes from the top of `scratch`, or return NULL.
+static
+uint8_t *SVFRT_copy_push_scratch(SVFRT_CopyContext *ctx, uint64_t size) {
+  if (size > (uint64_t) (ctx->scratch.count - ctx->scratch_used)) {
+    SVFRT_copy_fail(ctx, SVFRT_code_write__not_enough_scratch);
+    return NULL;
+  }
+  uint8_t *pointer = ctx->scratch.pointer + ctx->scratch_used;
+  ctx->scratch_used += (uint32_t) size;
+  return pointer;
+}
+
+// Write `count` items to `dst`, either as a sequence, or appended to `builder`.
+static
+SVFRT_Sequence SVFRT_copy_write_items(
+  SVFRT_CopyContext *ctx,
+  SVFRT_ChunkedSequenceBuilder *builder, // Optional.
+  uint8_t *pointer,
+  uint32_t size,
+  uint32_t count
+) {
+  SVFRT_Sequence result = { 0, 0 };
+  if (builder) {
+    SVFRT_write_chunked_sequence_elements(ctx->dst, builder, pointer, size, count);
+    return result;
+  }
+  return SVFRT_write_sequence(ctx->dst, pointer, size, count);
+}
+
+// Copy `count` items at `data_offset` in the source, and everything they refer
+// to. With `builder`, they are appended to it.
+static
+SVFRT_Sequence SVFRT_copy_items(
+  SVFRT_CopyContext *ctx,
+  uint32_t recursion_depth,
+  uint32_t data_offset,
+  uint32_t count,
+  SVF_Meta_ConcreteType_tag type_tag,
+  SVF_Meta_ConcreteType_payload *type_payload,
+  SVFRT_ChunkedSequenceBuilder *builder // Optional.
+) {
+  SVFRT_Sequence result = { 0, UINT32_MAX };
+
+  // Strides in the data can be larger than the sizes in the schema with
+  // `SVFRT_compatibility_binary`, see #logical-compatibility-stride-quirk.
+  uint32_t size = SVFRT_conversion_get_type_size(ctx->structs, type_tag, type_payload);
+  uint32_t stride = size;
+  if (type_tag == SVF_Meta_ConcreteType_tag_definedStruct) {
+    uint32_t struct_index = type_payload->definedStruct.index;
+    stride = struct_index < ctx->struct_strides.count ? ctx->struct_strides.pointer[struct_index] : 0;
+  }
+  if (size == 0 || stride < size) {
+    SVFRT_copy_fail(ctx, SVFRT_code_write__bad_subtree);
+    return result;
+  }
+
+  if (count == 0) {
+    return SVFRT_copy_write_items(ctx, builder, NULL, size, 0);
+  }
+
+  if (!SVFRT_copy_suballocation(ctx, data_offset, stride, count)) {
+    return result;
+  }
+  uint8_t *src = ctx->data_range.pointer + data_offset;
+
+  bool is_flat = SVFRT_internal_is_flat(
+    ctx->schema,
+    ctx->structs,
+    ctx->choices,
+    recursion_depth,
+    ctx->max_recursion_depth,
+    type_tag,
+    type_payload
+  );
+
+  // Fast path: one copy for the whole range.
+  if (is_flat && stride == size) {
+    return SVFRT_copy_write_items(ctx, builder, src, size, count);
+  }
+
+  // Flat, but only a part of each item is copied. Items are written one by
+  // one, which keeps them contiguous, since nothing else is written meanwhile.
+  if (is_flat) {
+    SVFRT_Sequence sequence = { 0, 0 };
+    for (uint32_t i = 0; i < count && !ctx->dst->error_code; i++) {
+      if (builder) {
+        SVFRT_write_chunked_sequence_elements(ctx->dst, builder, src + i * stride, size, 1);
+      } else {
+        SVFRT_write_sequence_element(ctx->dst, src + i * stride, size, &sequence);
+      }
+    }
+    return sequence;
+  }
+
+  // Prevent multiplication overflow by casting operands to `uint64_t` first.
+  uint64_t total_size = (uint64_t) size * (uint64_t) count;
+  uint32_t scratch_before = ctx->scratch_used;
+  uint8_t *copy = SVFRT_copy_push_scratch(ctx, total_size);
+  if (!copy) {
+    return result;
+  }
+
+  for (uint32_t i = 0; i < count; i++) {
+    SVFRT_MEMCPY(copy + i * size, src + i * stride, size);
+  }
+
+  for (uint32_t i = 0; i < count; i++) {
+    SVFRT_copy_fix_concrete_type(ctx, recursion_depth, copy + i * size, type_tag, type_payload);
+    if (ctx->dst->error_code) {
+      ctx->scratch_used = scratch_before;
+      return result;
+    }
+  }
+
+  result = SVFRT_copy_write_items(ctx, builder, copy, size, count);
+  ctx->scratch_used = scratch_before;
+  return result;
+}
+
+static
+SVFRT_ChunkedSequence SVFRT_copy_chunks(
+  SVFRT_CopyContext *ctx,
+  uint32_t recursion_depth,
+  SVFRT_ChunkedSequence sequence,
+  SVF_Meta_ConcreteType_tag type_tag,
+  SVF_Meta_ConcreteType_payload *type_payload
+) {
+  SVFRT_ChunkedSequence result = { 0, UINT32_MAX };
+  if (sequence.count == 0) {
+    result.count = 0;
+    return result;
+  }
+
+  // Chunks are collected first, so that they are copied in order.
+  SVFRT_ReadContext read_ctx = { ctx->data_range, ctx->struct_strides };
+  uint32_t chunk_count = SVFRT_read_chunked_sequence_chunk_count(&read_ctx, sequence);
+  uint32_t scratch_before = ctx->scratch_used;
+  SVFRT_Sequence *chunks = (SVFRT_Sequence *) SVFRT_copy_push_scratch(
+    ctx,
+    (uint64_t) chunk_count * (uint64_t) sizeof(SVFRT_Sequence)
+  );
+  if (!chunks) {
+    return result;
+  }
+
+  if (
+    chunk_count == 0 ||
+    SVFRT_read_chunked_sequence_chunks(&read_ctx, sequence, chunks, chunk_count) != chunk_count
+  ) {
+    SVFRT_copy_fail(ctx, SVFRT_code_write__bad_subtree);
+    ctx->scratch_used = scratch_before;
+    return result;
+  }
+
+  // The links are in bounds, since they were read, but they are tallied too.
+  ctx->tally += (uint64_t) chunk_count * (uint64_t) sizeof(SVFRT_ChunkLink);
+  if (ctx->tally > (uint64_t) ctx->data_range.count) {
+    SVFRT_copy_fail(ctx, SVFRT_code_write__bad_subtree);
+    ctx->scratch_used = scratch_before;
+    return result;
+  }
+
+  SVFRT_ChunkedSequenceBuilder builder = {0};
+  for (uint32_t i = 0; i < chunk_count && !ctx->dst->error_code; i++) {
+    SVFRT_copy_items(
+      ctx,
+      recursion_depth,
+      ~chunks[i].data_offset_complement,
+      chunks[i].count,
+      type_tag,
+      type_payload,
+      &builder
+    );
+  }
+  ctx->scratch_used = scratch_before;
+
+  if (ctx->dst->error_code) {
+    return result;
+  }
+  return SVFRT_write_chunked_sequence_finish(ctx->dst, &builder);
+}
+
+static
+void SVFRT_copy_fix_struct(
+  SVFRT_CopyContext *ctx,
+  uint32_t recursion_depth,
+  uint32_t struct_index,
+  uint8_t *item
+) {
+  if (recursion_depth >= ctx->max_recursion_depth || struct_index >= ctx->structs.count) {
+    SVFRT_copy_fail(ctx, SVFRT_code_write__bad_subtree);
+    return;
+  }
+
+  SVF_Meta_StructDefinition *definition = ctx->structs.pointer + struct_index;
+  SVFRT_RangeFieldDefinition fields = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
+    ctx->schema,
+    definition->fields,
+    SVF_Meta_FieldDefinition
+  );
+  if (!fields.pointer && fields.count) {
+    SVFRT_copy_fail(ctx, SVFRT_code_write__bad_subtree);
+    return;
+  }
+
+  for (uint32_t i = 0; i < fields.count; i++) {
+    SVF_Meta_FieldDefinition *field = fields.pointer + i;
+    if (field->removed) {
+      continue;
+    }
+
+    if (field->offset >= definition->size) {
+      SVFRT_copy_fail(ctx, SVFRT_code_write__bad_subtree);
+      return;
+    }
+
+    SVFRT_copy_fix_any_type(
+      ctx,
+      recursion_depth + 1,
+      item + field->offset,
+      field->type_tag,
+      &field->type_payload
+    );
+
+    if (ctx->dst->error_code) {
+      return;
+    }
+  }
+}
+
+static
+void SVFRT_copy_fix_choice(
+  SVFRT_CopyContext *ctx,
+  uint32_t recursion_depth,
+  uint32_t choice_index,
+  uint8_t *item
+) {
+  if (recursion_depth >= ctx->max_recursion_depth || choice_index >= ctx->choices.count) {
+    SVFRT_copy_fail(ctx, SVFRT_code_write__bad_subtree);
+    return;
+  }
+
+  uint8_t choice_tag = *item;
+
+  SVFRT_RangeOptionDefinition options = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
+    ctx->schema,
+    ctx->choices.pointer[choice_index].options,
+    SVF_Meta_OptionDefinition
+  );
+  if (!options.pointer && options.count) {
+    SVFRT_copy_fail(ctx, SVFRT_code_write__bad_subtree);
+    return;
+  }
+
+  for (uint32_t i = 0; i < options.count; i++) {
+    SVF_Meta_OptionDefinition *option = options.pointer + i;
+    if (option->tag != choice_tag) {
+      continue;
+    }
+    if (option->removed) {
+      return;
+    }
+
+    SVFRT_copy_fix_any_type(
+      ctx,
+      recursion_depth + 1,
+      item + SVFRT_TAG_SIZE,
+      option->type_tag,
+      &option->type_payload
+    );
+    return;
+  }
+}
+
+static
+void SVFRT_copy_fix_concrete_type(
+  SVFRT_CopyContext *ctx,
+  uint32_t recursion_depth,
+  uint8_t *item,
+  SVF_Meta_ConcreteType_tag type_tag,
+  SVF_Meta_ConcreteType_payload *type_payload
+) {
+  switch (type_tag) {
+    case SVF_Meta_ConcreteType_tag_definedStruct: {
+      SVFRT_copy_fix_struct(ctx, recursion_depth, type_payload->definedStruct.index, item);
+      return;
+    }
+    case SVF_Meta_ConcreteType_tag_definedChoice: {
+      SVFRT_copy_fix_choice(ctx, recursion_depth, type_payload->definedChoice.index, item);
+      return;
+    }
+    default: {
+      // Primitives, nothing to do.
+      return;
+    }
+  }
+}
+
+// Replace the handles in `item`, which is a copy in `scratch`, with ones for
+// `dst`, copying their targets. Handles are copied with `SVFRT_MEMCPY`, since
+// they may be unaligned.
+static
+void SVFRT_copy_fix_any_type(
+  SVFRT_CopyContext *ctx,
+  uint32_t recursion_depth,
+  uint8_t *item,
+  SVF_Meta_Type_tag type_tag,
+  SVF_Meta_Type_payload *type_payload
+) {
+  switch (type_tag) {
+    case SVF_Meta_Type_tag_concrete: {
+      SVFRT_copy_fix_concrete_type(
+        ctx,
+        recursion_depth,
+        item,
+        type_payload->concrete.type_tag,
+        &type_payload->concrete.type_payload
+      );
+      return;
+    }
+    case SVF_Meta_Type_tag_reference: {
+      SVFRT_Reference reference;
+      SVFRT_MEMCPY(&reference, item, sizeof(reference));
+
+      SVFRT_Sequence copied = SVFRT_copy_items(
+        ctx,
+        recursion_depth,
+        ~reference.data_offset_complement,
+        1,
+        type_payload->reference.type_tag,
+        &type_payload->reference.type_payload,
+        NULL
+      );
+      reference.data_offset_complement = copied.data_offset_complement;
+      SVFRT_MEMCPY(item, &reference, sizeof(reference));
+      return;
+    }
+    case SVF_Meta_Type_tag_sequence: {
+      SVFRT_Sequence sequence;
+      SVFRT_MEMCPY(&sequence, item, sizeof(sequence));
+
+      sequence = SVFRT_copy_items(
+        ctx,
+        recursion_depth,
+        ~sequence.data_offset_complement,
+        sequence.count,
+        type_payload->sequence.elementType_tag,
+        &type_payload->sequence.elementType_payload,
+        NULL
+      );
+      SVFRT_MEMCPY(item, &sequence, sizeof(sequence));
+      return;
+    }
+    case SVF_Meta_Type_tag_chunkedSequence: {
+      SVFRT_ChunkedSequence sequence;
+      SVFRT_MEMCPY(&sequence, item, sizeof(sequence));
+
+      sequence = SVFRT_copy_chunks(
+        ctx,
+        recursion_depth,
+        sequence,
+        type_payload->chunkedSequence.elementType_tag,
+        &type_payload->chunkedSequence.elementType_payload
+      );
+      SVFRT_MEMCPY(item, &sequence, sizeof(sequence));
+      return;
+    }
+    case SVF_Meta_Type_tag_nothing:
+    default: {
+      return;
+    }
+  }
+}
+
+static
+bool SVFRT_copy_start(
+  SVFRT_CopyContext *ctx,
+  SVFRT_WriteContext *dst,
+  SVFRT_CopyParams *params,
+  SVFRT_ReadContext *src
+) {
+  ctx->dst = dst;
+  ctx->schema = params->schema;
+  ctx->data_range = src->data_range;
+  ctx->struct_strides = src->struct_strides;
+  ctx->scratch = params->scratch;
+  ctx->scratch_used = 0;
+  ctx->max_recursion_depth = params->max_recursion_depth;
+  ctx->tally = 0;
+
+  if (dst->error_code) {
+    return false;
+  }
+
+  SVF_Meta_SchemaDefinition *definition = SVFRT_internal_schema_definition(params->schema);
+  if (!definition) {
+    SVFRT_copy_fail(ctx, SVFRT_code_write__bad_subtree);
+    return false;
+  }
+
+  SVFRT_RangeStructDefinition structs = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
+    params->schema,
+    definition->structs,
+    SVF_Meta_StructDefinition
+  );
+  SVFRT_RangeChoiceDefinition choices = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
+    params->schema,
+    definition->choices,
+    SVF_Meta_ChoiceDefinition
+  );
+  if ((!structs.pointer && structs.count) || (!choices.pointer && choices.count)) {
+    SVFRT_copy_fail(ctx, SVFRT_code_write__bad_subtree);
+    return false;
+  }
+  ctx->structs = structs;
+  ctx->choices = choices;
+  return true;
+}
+
+SVFRT_Reference SVFRT_copy_reference(
+  SVFRT_WriteContext *dst,
+  SVFRT_CopyParams *params,
+  SVFRT_ReadContext *src,
+  SVFRT_Reference reference,
+  uint32_t struct_index
+) {
+  SVFRT_Reference result = { 0 };
+  SVFRT_CopyContext ctx;
+  if (!SVFRT_copy_start(&ctx, dst, params, src)) {
+    return result;
+  }
+
+  SVF_Meta_ConcreteType_payload payload;
+  payload.definedStruct.index = struct_index;
+  SVFRT_Sequence copied = SVFRT_copy_items(
+    &ctx,
+    0,
+    ~reference.data_offset_complement,
+    1,
+    SVF_Meta_ConcreteType_tag_definedStruct,
+    &payload,
+    NULL
+  );
+  if (!dst->error_code) {
+    result.data_offset_complement = copied.data_offset_complement;
+  }
+  return result;
+}
+
+SVFRT_Sequence SVFRT_copy_sequence(
+  SVFRT_WriteContext *dst,
+  SVFRT_CopyParams *params,
+  SVFRT_ReadContext *src,
+  SVFRT_Sequence sequence,
+  uint32_t struct_index
+) {
+  SVFRT_Sequence result = { 0, UINT32_MAX };
+  SVFRT_CopyContext ctx;
+  if (!SVFRT_copy_start(&ctx, dst, params, src)) {
+    return result;
+  }
+
+  SVF_Meta_ConcreteType_payload payload;
+  payload.definedStruct.index = struct_index;
+  SVFRT_Sequence copied = SVFRT_copy_items(
+    &ctx,
+    0,
+    ~sequence.data_offset_complement,
+    sequence.count,
+    SVF_Meta_ConcreteType_tag_definedStruct,
+    &payload,
+    NULL
+  );
+  return dst->error_code ? result : copied;
+}
+
+SVFRT_ChunkedSequence SVFRT_copy_chunked_sequence(
+  SVFRT_WriteContext *dst,
+  SVFRT_CopyParams *params,
+  SVFRT_ReadContext *src,
+  SVFRT_ChunkedSequence sequence,
+  uint32_t struct_index
+) {
+  SVFRT_ChunkedSequence result = { 0, UINT32_MAX };
+  SVFRT_CopyContext ctx;
+  if (!SVFRT_copy_start(&ctx, dst, params, src)) {
+    return result;
+  }
+
+  SVF_Meta_ConcreteType_payload payload;
+  payload.definedStruct.index = struct_index;
+  SVFRT_ChunkedSequence copied = SVFRT_copy_chunks(
+    &ctx,
+    0,
+    sequence,
+    SVF_Meta_ConcreteType_tag_definedStruct,
+    &payload
+  );
+  return dst->error_code ? result : copied;
+}
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
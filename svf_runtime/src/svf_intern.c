@@ -0,0 +1,292 @@
+#ifndef SVFRT_SINGLE_FILE
+  #include "svf_runtime.h"
+  #include "svf_internal.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// #write-interning
+//
+// The table is open-addressed, with a short linear probe from the slot given
+// by the hash. A miss goes into the first empty slot on the way, or into one
+// with a range that was flushed already, or else replaces the first slot. So
+// the table never fills up, and recent ranges are preferred.
+//
+// The hash is only used to find candidates, a match is always confirmed by
+// comparing the bytes, so collisions can't produce wrong handles.
+
+// Ranges are matched only among this many slots.
+#define SVFRT_INTERN_MAX_PROBES 8
+
+#define SVFRT_INTERN_PRIME1 0x9E3779B185EBCA87ull
+#define SVFRT_INTERN_PRIME2 0xC2B2AE3D27D4EB4Full
+#define SVFRT_INTERN_PRIME3 0x165667B19E3779F9ull
+#define SVFRT_INTERN_PRIME4 0x85EBCA77C2B2AE63ull
+
+static inline
+uint64_t SVFRT_intern_load(uint8_t const *pointer) {
+  uint64_t result;
+  SVFRT_MEMCPY(&result, pointer, sizeof(result));
+  return result;
+}
+
+static inline
+uint64_t SVFRT_intern_mix(uint64_t lane, uint64_t word) {
+  lane += word * SVFRT_INTERN_PRIME2;
+  lane = (lane << 31) | (lane >> 33);
+  return lane * SVFRT_INTERN_PRIME1;
+}
+
+// Hash 8 bytes at a time, in four independent lanes, so that the
+// multiplications don't wait on each other (and can be vectorized).
+static
+uint64_t SVFRT_intern_hash(SVFRT_Bytes bytes) {
+  uint64_t lanes[4] = {
+    SVFRT_INTERN_PRIME1 + SVFRT_INTERN_PRIME2,
+    SVFRT_INTERN_PRIME2,
+    0,
+    0 - SVFRT_INTERN_PRIME1,
+  };
+
+  uint32_t i = 0;
+  for (; bytes.count - i >= 32; i += 32) {
+    lanes[0] = SVFRT_intern_mix(lanes[0], SVFRT_intern_load(bytes.pointer + i));
+    lanes[1] = SVFRT_intern_mix(lanes[1], SVFRT_intern_load(bytes.pointer + i + 8));
+    lanes[2] = SVFRT_intern_mix(lanes[2], SVFRT_intern_load(bytes.pointer + i + 16));
+    lanes[3] = SVFRT_intern_mix(lanes[3], SVFRT_intern_load(bytes.pointer + i + 24));
+  }
+
+  uint64_t result = (uint64_t) bytes.count * SVFRT_INTERN_PRIME4;
+  for (uint32_t j = 0; j < 4; j++) {
+    result = SVFRT_intern_mix(result, lanes[j]);
+  }
+  for (; bytes.count - i >= 8; i += 8) {
+    result = SVFRT_intern_mix(result, SVFRT_intern_load(bytes.pointer + i));
+  }
+  if (i < bytes.count) {
+    uint64_t tail = 0;
+    SVFRT_MEMCPY(&tail, bytes.pointer + i, bytes.count - i);
+    result = SVFRT_intern_mix(result, tail);
+  }
+
+  // Final avalanche, since the slot is taken from the low bits.
+  result ^= result >> 33;
+  result *= SVFRT_INTERN_PRIME3;
+  result ^= result >> 29;
+  return result;
+}
+
+static
+bool SVFRT_intern_equal(uint8_t const *a, uint8_t const *b, uint32_t count) {
+  uint32_t i = 0;
+  for (; count - i >= 8; i += 8) {
+    if (SVFRT_intern_load(a + i) != SVFRT_intern_load(b + i)) {
+      return false;
+    }
+  }
+  for (; i < count; i++) {
+    if (a[i] != b[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// The buffer holds the last `buffer_used` bytes written, see #buffered-writing.
+// Returns NULL if the range was flushed already.
+static
+uint8_t const *SVFRT_intern_buffered(
+  SVFRT_WriteContext *ctx,
+  SVFRT_InternEntry const *entry
+) {
+  uint32_t back = ctx->data_bytes_written - entry->data_offset;
+  if (back > ctx->buffer_used) {
+    return NULL;
+  }
+  return ctx->buffer.pointer + ctx->buffer_used - back;
+}
+
+// Returns true and sets `*out_data_offset` on a match. Otherwise, sets
+// `*out_slot` to where the range should go after it's written.
+static
+bool SVFRT_intern_find(
+  SVFRT_WriteContext *ctx,
+  SVFRT_InternTable *table,
+  SVFRT_Bytes bytes,
+  uint32_t type_size,
+  uint64_t hash,
+  uint32_t *out_slot,
+  uint32_t *out_data_offset
+) {
+  uint32_t mask = table->capacity - 1;
+  uint32_t home = (uint32_t) hash & mask;
+  uint32_t alignment = SVFRT_natural_alignment(type_size);
+  bool have_slot = false;
+  *out_slot = home;
+
+  for (uint32_t i = 0; i < SVFRT_INTERN_MAX_PROBES && i < table->capacity; i++) {
+    uint32_t slot = (home + i) & mask;
+    SVFRT_InternEntry *entry = table->entries + slot;
+    if (entry->size == 0) {
+      if (!have_slot) {
+        *out_slot = slot;
+      }
+      return false;
+    }
+
+    uint8_t const *existing = SVFRT_intern_buffered(ctx, entry);
+    if (!existing) {
+      if (!have_slot) {
+        *out_slot = slot;
+        have_slot = true;
+      }
+      continue;
+    }
+
+    if (
+      entry->hash != hash ||
+      entry->size != bytes.count ||
+      entry->data_offset % alignment != 0 ||
+      !SVFRT_intern_equal(existing, bytes.pointer, bytes.count)
+    ) {
+      continue;
+    }
+
+    *out_data_offset = entry->data_offset;
+    table->hit_count++;
+    table->bytes_saved += bytes.count;
+    return true;
+  }
+  return false;
+}
+
+// Returns true and sets `*out_data_offset` if the range was found. Otherwise,
+// the range must be written by the caller, and then passed to `SVFRT_intern_insert`.
+static
+bool SVFRT_intern_lookup(
+  SVFRT_WriteContext *ctx,
+  SVFRT_InternTable *table,
+  SVFRT_Bytes bytes,
+  uint32_t type_size,
+  uint64_t *out_hash,
+  uint32_t *out_slot,
+  uint32_t *out_data_offset
+) {
+  // Errors are left to the regular writing functions.
+  if (
+    !table ||
+    !table->capacity ||
+    !ctx->buffer.pointer ||
+    ctx->error_code ||
+    ctx->finished ||
+    bytes.count == 0 ||
+    bytes.count < table->min_size
+  ) {
+    *out_slot = UINT32_MAX;
+    return false;
+  }
+
+  *out_hash = SVFRT_intern_hash(bytes);
+  return SVFRT_intern_find(ctx, table, bytes, type_size, *out_hash, out_slot, out_data_offset);
+}
+
+static
+void SVFRT_intern_insert(
+  SVFRT_WriteContext *ctx,
+  SVFRT_InternTable *table,
+  uint32_t slot,
+  uint64_t hash,
+  uint32_t data_offset,
+  uint32_t size
+) {
+  if (ctx->error_code || slot == UINT32_MAX) {
+    return;
+  }
+  SVFRT_InternEntry *entry = table->entries + slot;
+  entry->hash = hash;
+  entry->data_offset = data_offset;
+  entry->size = size;
+}
+
+bool SVFRT_intern_table_init(
+  SVFRT_InternTable *result,
+  SVFRT_Bytes memory,
+  uint32_t min_size
+) {
+  result->entries = NULL;
+  result->capacity = 0;
+  result->min_size = min_size;
+  result->hit_count = 0;
+  result->bytes_saved = 0;
+
+  uintptr_t misalignment = ((uintptr_t) memory.pointer) % sizeof(uint64_t);
+  uint32_t skip = misalignment == 0 ? 0 : (uint32_t) (sizeof(uint64_t) - misalignment);
+  if (!memory.pointer || memory.count < skip + sizeof(SVFRT_InternEntry)) {
+    return false;
+  }
+
+  uint32_t available = (uint32_t) ((memory.count - skip) / sizeof(SVFRT_InternEntry));
+  uint32_t capacity = 1;
+  while (capacity <= available / 2) {
+    capacity *= 2;
+  }
+
+  result->entries = (SVFRT_InternEntry *) (memory.pointer + skip);
+  result->capacity = capacity;
+  SVFRT_MEMSET(result->entries, 0, capacity * sizeof(SVFRT_InternEntry));
+  return true;
+}
+
+SVFRT_Reference SVFRT_write_reference_interned(
+  SVFRT_WriteContext *ctx,
+  SVFRT_InternTable *table,
+  void *pointer,
+  uint32_t type_size
+) {
+  SVFRT_Bytes bytes = { (uint8_t *) pointer, type_size };
+  uint64_t hash = 0;
+  uint32_t slot = 0;
+  uint32_t data_offset = 0;
+  if (SVFRT_intern_lookup(ctx, table, bytes, type_size, &hash, &slot, &data_offset)) {
+    SVFRT_Reference result = { ~data_offset };
+    return result;
+  }
+
+  SVFRT_Reference result = SVFRT_write_reference(ctx, pointer, type_size);
+  SVFRT_intern_insert(ctx, table, slot, hash, ~result.data_offset_complement, bytes.count);
+  return result;
+}
+
+SVFRT_Sequence SVFRT_write_sequence_interned(
+  SVFRT_WriteContext *ctx,
+  SVFRT_InternTable *table,
+  void *pointer,
+  uint32_t type_size,
+  uint32_t count
+) {
+  // Prevent addition overflow by casting operands to `uint64_t` first. Too
+  // large sequences are rejected by `SVFRT_write_sequence`.
+  uint64_t total_size = (uint64_t) type_size * (uint64_t) count;
+  if (total_size > (uint64_t) UINT32_MAX) {
+    return SVFRT_write_sequence(ctx, pointer, type_size, count);
+  }
+
+  SVFRT_Bytes bytes = { (uint8_t *) pointer, (uint32_t) total_size };
+  uint64_t hash = 0;
+  uint32_t slot = 0;
+  uint32_t data_offset = 0;
+  if (SVFRT_intern_lookup(ctx, table, bytes, type_size, &hash, &slot, &data_offset)) {
+    SVFRT_Sequence result = { ~data_offset, count };
+    return result;
+  }
+
+  SVFRT_Sequence result = SVFRT_write_sequence(ctx, pointer, type_size, count);
+  SVFRT_intern_insert(ctx, table, slot, hash, ~result.data_offset_complement, bytes.count);
+  return result;
+}
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -42,6 +42,119 @@ void *SVFRT_internal_from_sequence(
   return (void *) (bytes.pointer + data_offset);
 }
 
+SVF_Meta_SchemaDefinition *SVFRT_internal_schema_definition(SVFRT_Bytes schema) {
+  if (schema.count < sizeof(SVF_Meta_SchemaDefinition)) {
+    return NULL;
+  }
+
+  return (SVF_Meta_SchemaDefinition *) SVFRT_read_check_alignment(
+    schema.pointer + schema.count - sizeof(SVF_Meta_SchemaDefinition),
+    SVFRT_ALIGNOF(SVF_Meta_SchemaDefinition)
+  );
+}
+
+// Can a concrete type be skipped as a whole, i.e. it does not contain any
+// references or sequences, even when nested? Used to avoid walking elements of
+// large sequences, where there is nothing to check or fix up. Errs on the side
+// of `false`.
+bool SVFRT_internal_is_flat(
+  SVFRT_Bytes schema,
+  SVFRT_RangeStructDefinition structs,
+  SVFRT_RangeChoiceDefinition choices,
+  uint32_t recursion_depth,
+  uint32_t max_recursion_depth,
+  SVF_Meta_ConcreteType_tag type_tag,
+  SVF_Meta_ConcreteType_payload *type_payload
+) {
+  if (recursion_depth >= max_recursion_depth) {
+    return false;
+  }
+
+  switch (type_tag) {
+    case SVF_Meta_ConcreteType_tag_definedStruct: {
+      uint32_t struct_index = type_payload->definedStruct.index;
+      if (struct_index >= structs.count) {
+        return false;
+      }
+
+      SVFRT_RangeFieldDefinition fields = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
+        schema,
+        structs.pointer[struct_index].fields,
+        SVF_Meta_FieldDefinition
+      );
+      if (!fields.pointer && fields.count) {
+        return false;
+      }
+
+      for (uint32_t i = 0; i < fields.count; i++) {
+        SVF_Meta_FieldDefinition *field = fields.pointer + i;
+        if (field->removed) {
+          continue;
+        }
+        if (field->type_tag != SVF_Meta_Type_tag_concrete) {
+          return false;
+        }
+        if (!SVFRT_internal_is_flat(
+          schema,
+          structs,
+          choices,
+          recursion_depth + 1,
+          max_recursion_depth,
+          field->type_payload.concrete.type_tag,
+          &field->type_payload.concrete.type_payload
+        )) {
+          return false;
+        }
+      }
+      return true;
+    }
+    case SVF_Meta_ConcreteType_tag_definedChoice: {
+      uint32_t choice_index = type_payload->definedChoice.index;
+      if (choice_index >= choices.count) {
+        return false;
+      }
+
+      SVFRT_RangeOptionDefinition options = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
+        schema,
+        choices.pointer[choice_index].options,
+        SVF_Meta_OptionDefinition
+      );
+      if (!options.pointer && options.count) {
+        return false;
+      }
+
+      for (uint32_t i = 0; i < options.count; i++) {
+        SVF_Meta_OptionDefinition *option = options.pointer + i;
+        if (option->removed || option->type_tag == SVF_Meta_Type_tag_nothing) {
+          continue;
+        }
+        if (option->type_tag != SVF_Meta_Type_tag_concrete) {
+          return false;
+        }
+        if (!SVFRT_internal_is_flat(
+          schema,
+          structs,
+          choices,
+          recursion_depth + 1,
+          max_recursion_depth,
+          option->type_payload.concrete.type_tag,
+          &option->type_payload.concrete.type_payload
+        )) {
+          return false;
+        }
+      }
+      return true;
+    }
+    case SVF_Meta_ConcreteType_tag_nothing: {
+      return false;
+    }
+    default: {
+      // Primitives.
+      return true;
+    }
+  }
+}
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -6,10 +6,56 @@
   #include "svf_meta.h"
 #endif
 
+#if defined(_MSC_VER) && !defined(__clang__)
+  #include <intrin.h>
+#endif
+
+#ifndef SVFRT_NO_LIBC
+  #ifdef __cplusplus
+    #include <cstring>
+  #else
+    #include <string.h>
+  #endif
+  #define SVFRT_MEMSET memset
+  #define SVFRT_MEMCPY memcpy
+  #define SVFRT_MEMCMP memcmp
+#else
+  #if !defined(SVFRT_MEMSET) || !defined(SVFRT_MEMCPY) || !defined(SVFRT_MEMCMP)
+    #error "When compiling with SVFRT_NO_LIBC, make sure to #define SVFRT_MEMCPY/SVFRT_MEMSET/SVFRT_MEMCMP."
+  #endif
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// Minimal 32-bit atomics, only as much as the runtime needs. Loads have acquire
+// semantics, stores have release semantics, read-modify-write operations are
+// sequentially consistent.
+//
+// TODO @support: C11 `<stdatomic.h>` would be cleaner, but we target C99.
+#if defined(__GNUC__) || defined(__clang__)
+  #define SVFRT_ATOMIC_LOAD_U32(pointer) __atomic_load_n((pointer), __ATOMIC_ACQUIRE)
+  #define SVFRT_ATOMIC_STORE_U32(pointer, value) __atomic_store_n((pointer), (value), __ATOMIC_RELEASE)
+  #define SVFRT_ATOMIC_FETCH_ADD_U32(pointer, value) __atomic_fetch_add((pointer), (value), __ATOMIC_SEQ_CST)
+  #define SVFRT_ATOMIC_CAS_U32(pointer, expected, desired) SVFRT_internal_atomic_cas_u32((pointer), (expected), (desired))
+
+  static inline
+  bool SVFRT_internal_atomic_cas_u32(uint32_t *pointer, uint32_t expected, uint32_t desired) {
+    return __atomic_compare_exchange_n(pointer, &expected, desired, 0, __ATOMIC_SEQ_CST, __ATOMIC_ACQUIRE);
+  }
+#elif defined(_MSC_VER)
+  #define SVFRT_ATOMIC_LOAD_U32(pointer) ((uint32_t) _InterlockedOr((long volatile *) (pointer), 0))
+  #define SVFRT_ATOMIC_STORE_U32(pointer, value) ((void) _InterlockedExchange((long volatile *) (pointer), (long) (value)))
+  #define SVFRT_ATOMIC_FETCH_ADD_U32(pointer, value) ((uint32_t) _InterlockedExchangeAdd((long volatile *) (pointer), (long) (value)))
+  #define SVFRT_ATOMIC_CAS_U32(pointer, expected, desired) ( \
+    (uint32_t) _InterlockedCompareExchange((long volatile *) (pointer), (long) (desired), (long) (expected)) \
+    == (uint32_t) (expected) \
+  )
+#else
+  #error "Atomics are not implemented for this compiler."
+#endif
+
 typedef struct SVFRT_RangeStructDefinition {
   SVF_Meta_StructDefinition *pointer;
   uint32_t count;
@@ -46,13 +92,33 @@ void *SVFRT_internal_from_sequence(
   (type *) SVFRT_internal_from_reference((bytes), (reference), sizeof(type)), \
 )
 
-// Caveat: may return { NULL, count }.
+// Caveat: may return { NULL, count }. Only for schemas, which are read in place,
+// so the pointer is also NULL if it is misaligned, see #natural-alignment.
 // TODO: use macro tricks to force to return { NULL, 0 } in this case?
 #define SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(bytes, sequence, type) { \
-  /*.pointer = */ (type *) SVFRT_internal_from_sequence((bytes), (sequence), sizeof(type)), \
+  /*.pointer = */ (type *) SVFRT_read_check_alignment( \
+    SVFRT_internal_from_sequence((bytes), (sequence), sizeof(type)), \
+    SVFRT_ALIGNOF(type) \
+  ), \
   /*.count = */ (sequence).count \
 }
 
+// The definition is the last struct in a schema. NULL, if the schema is too
+// small, or misaligned, see #natural-alignment.
+SVF_Meta_SchemaDefinition *SVFRT_internal_schema_definition(SVFRT_Bytes schema);
+
+// Can a concrete type be skipped as a whole, i.e. it does not contain any
+// references or sequences, even when nested? Errs on the side of `false`.
+bool SVFRT_internal_is_flat(
+  SVFRT_Bytes schema,
+  SVFRT_RangeStructDefinition structs,
+  SVFRT_RangeChoiceDefinition choices,
+  uint32_t recursion_depth,
+  uint32_t max_recursion_depth,
+  SVF_Meta_ConcreteType_tag type_tag,
+  SVF_Meta_ConcreteType_payload *type_payload
+);
+
 typedef struct SVFRT_LogicalCompatibilityInfo {
   SVFRT_Bytes unsafe_schema_src;
   SVFRT_Bytes schema_dst;
@@ -67,6 +133,10 @@ typedef struct SVFRT_LogicalCompatibilityInfo {
   SVFRT_RangeU32 option_matches_header;
   SVFRT_Bytes option_matches_tags;
   SVFRT_RangeU32 option_matches;
+
+  // Optional, see #conversion-plan. If present, it is used for conversion
+  // instead of interpreting the schemas.
+  SVFRT_RangeU32 conversion_plan;
 } SVFRT_LogicalCompatibilityInfo;
 
 typedef struct SVFRT_CompatibilityResult {
@@ -100,6 +170,35 @@ void SVFRT_check_compatibility(
   uint32_t max_schema_work
 );
 
+// Try to find a previously cached compatibility result. On success, `out_result`
+// is filled as if `SVFRT_check_compatibility` was called (it will refer to cache
+// memory and the passed schemas), and `true` is returned.
+bool SVFRT_compatibility_cache_lookup(
+  SVFRT_CompatibilityCache *cache,
+  SVFRT_CompatibilityResult *out_result,
+  SVFRT_Bytes unsafe_schema_src,
+  SVFRT_Bytes schema_dst,
+  uint64_t schema_content_hash_src,
+  uint64_t schema_content_hash_dst,
+  uint64_t entry_struct_id,
+  SVFRT_CompatibilityLevel required_level,
+  uint32_t max_schema_work
+);
+
+// Remember the result of `SVFRT_check_compatibility`. Not all results are
+// cached, e.g. running out of scratch memory is not a property of the schemas.
+SVFRT_ErrorCode SVFRT_compatibility_cache_insert(
+  SVFRT_CompatibilityCache *cache,
+  SVFRT_CompatibilityResult *result,
+  SVFRT_Bytes unsafe_schema_src,
+  SVFRT_Bytes schema_dst,
+  uint64_t schema_content_hash_src,
+  uint64_t schema_content_hash_dst,
+  uint64_t entry_struct_id,
+  SVFRT_CompatibilityLevel required_level,
+  uint32_t max_schema_work
+);
+
 typedef struct SVFRT_ConversionResult {
   SVFRT_Bytes output_bytes; // Note: may refer to allocated memory even on failure.
   bool success;
@@ -112,10 +211,193 @@ void SVFRT_convert_message(
   SVFRT_Bytes data_bytes,
   uint32_t max_recursion_depth,
   uint32_t total_data_size_limit,
+  bool single_pass, // Only used with a conversion plan, see #single-pass-conversion.
+  SVFRT_Bytes conversion_stack, // Only used with `SVFRT_ITERATIVE_CONVERSION`, see #iterative-conversion.
+  SVFRT_Bytes conversion_memo, // Optional, see #conversion-memoization.
+  SVFRT_SpawnTasksFn *spawn_fn, // Optional, only used with a conversion plan, see #parallel-conversion.
+  void *spawn_ptr,
+  uint32_t task_count,
+  SVFRT_AllocatorFn *allocator_fn,
+  void *allocator_ptr
+);
+
+typedef struct SVFRT_ConversionResult64 {
+  SVFRT_Bytes64 output_bytes; // Note: may refer to allocated memory even on failure.
+  bool success;
+  SVFRT_ErrorCode error_code;
+} SVFRT_ConversionResult64;
+
+// Same as `SVFRT_convert_message`, but for #wide-messages, without the plan,
+// iterative, single-pass, parallel and memoization options. See #wide-conversion.
+void SVFRT_convert_message64(
+  SVFRT_ConversionResult64 *out_result,
+  SVFRT_CompatibilityResult *check_result,
+  SVFRT_Bytes64 data_bytes,
+  uint32_t max_recursion_depth,
+  uint64_t total_data_size_limit,
+  SVFRT_AllocatorFn *allocator_fn,
+  void *allocator_ptr
+);
+
+// Same as `SVFRT_convert_message`, but with a converter from svfc instead of
+// a compatibility result. See #generated-conversion.
+void SVFRT_convert_message_generated(
+  SVFRT_ConversionResult *out_result,
+  SVFRT_GeneratedConverter const *converter,
+  SVFRT_Bytes data_bytes,
+  uint32_t max_recursion_depth,
+  uint32_t total_data_size_limit,
+  SVFRT_AllocatorFn *allocator_fn,
+  void *allocator_ptr
+);
+
+// See #resumable-conversion. Lives in caller-supplied memory.
+typedef struct SVFRT_ResumableConversion SVFRT_ResumableConversion;
+
+// Size of `memory` for `SVFRT_convert_message_begin`, including the alignment.
+uint32_t SVFRT_resumable_conversion_size(uint32_t max_recursion_depth);
+
+// Same as `SVFRT_convert_message`, without the plan, single-pass and parallel
+// options. Returns NULL if `memory` is too small, otherwise, call
+// `SVFRT_convert_message_step` until it returns true, and then `out_result` is
+// final. `check_result`, `data_bytes`, `memory`, and `conversion_memo` must stay
+// alive and unchanged until then.
+SVFRT_ResumableConversion *SVFRT_convert_message_begin(
+  SVFRT_ConversionResult *out_result,
+  SVFRT_CompatibilityResult *check_result,
+  SVFRT_Bytes data_bytes,
+  uint32_t max_recursion_depth,
+  uint32_t total_data_size_limit,
+  SVFRT_Bytes memory,
+  SVFRT_Bytes conversion_memo, // Optional, see #conversion-memoization.
+  SVFRT_AllocatorFn *allocator_fn,
+  void *allocator_ptr
+);
+
+// Do up to `budget` units of work. Returns true when done (or failed). The
+// allocation is in `out_result->output_bytes` as soon as it's made.
+bool SVFRT_convert_message_step(
+  SVFRT_ResumableConversion *conversion,
+  SVFRT_ConversionResult *out_result,
+  uint32_t budget
+);
+
+// Same as `SVFRT_convert_message`, but for the subtree of a struct anywhere in
+// the data, which is converted as if it was the entry. See #lazy-view.
+void SVFRT_convert_struct(
+  SVFRT_ConversionResult *out_result,
+  SVFRT_CompatibilityResult *check_result,
+  SVFRT_Bytes data_bytes,
+  uint32_t unsafe_data_offset_src,
+  uint32_t unsafe_struct_index_src,
+  uint32_t struct_index_dst,
+  uint32_t max_recursion_depth,
+  uint32_t total_data_size_limit,
   SVFRT_AllocatorFn *allocator_fn,
   void *allocator_ptr
 );
 
+// Convert `count` values, `unsafe_stride_src` apart in `range_src` (a part
+// of `data_bytes`), straight into `out_bytes`, which must be zeroed and hold
+// exactly `count` dst-values. The dst-type must not have any handles in it
+// (see `SVFRT_internal_is_flat`), since there is nowhere to put their targets.
+// See #lazy-view.
+SVFRT_ErrorCode SVFRT_convert_flat_values(
+  SVFRT_CompatibilityResult *check_result,
+  SVFRT_Bytes data_bytes,
+  SVFRT_Bytes range_src,
+  uint32_t unsafe_offset_src,
+  uint32_t unsafe_stride_src,
+  SVF_Meta_ConcreteType_tag unsafe_type_tag_src,
+  SVF_Meta_ConcreteType_payload *unsafe_type_payload_src,
+  SVF_Meta_ConcreteType_tag type_tag_dst,
+  SVF_Meta_ConcreteType_payload *type_payload_dst,
+  uint32_t count,
+  uint32_t max_recursion_depth,
+  SVFRT_Bytes out_bytes
+);
+
+// A struct materialized by `SVFRT_view_materialize`, see #lazy-view.
+typedef struct SVFRT_LazyMemoEntry {
+  uint32_t data_offset;
+  uint32_t unsafe_struct_index_src;
+  uint32_t struct_index_dst;
+  uint32_t used; // Zero for an empty slot.
+  SVFRT_Bytes output_bytes;
+} SVFRT_LazyMemoEntry;
+
+// Everything a #lazy-view needs, in the caller-supplied memory of
+// `SVFRT_read_message_lazy`. Without a conversion, the src-schema is the same
+// as the dst-schema, and only the struct strides differ.
+typedef struct SVFRT_LazyReadState {
+  SVFRT_CompatibilityResult check_result;
+  bool converting; // With `SVFRT_compatibility_logical`.
+  SVFRT_Bytes data_range;
+  SVFRT_Bytes unsafe_schema_src;
+  SVFRT_Bytes schema_dst;
+  SVFRT_RangeStructDefinition unsafe_structs_src;
+  SVFRT_RangeStructDefinition structs_dst;
+  SVFRT_RangeChoiceDefinition unsafe_choices_src;
+  SVFRT_RangeChoiceDefinition choices_dst;
+  uint32_t max_recursion_depth;
+  uint32_t max_output_size;
+  SVFRT_AllocatorFn *allocator_fn;
+  void *allocator_ptr;
+
+  // Optional, the rest of the caller-supplied memory.
+  SVFRT_LazyMemoEntry *memo;
+  uint32_t memo_capacity;
+} SVFRT_LazyReadState;
+
+// Fill the rest of `state` after a successful compatibility check, and set up
+// `out_read->entry`. Errors are set on `out_read`.
+void SVFRT_lazy_read_init(
+  SVFRT_LazyRead *out_read,
+  SVFRT_LazyReadState *state,
+  SVFRT_ReadMessageParams *params,
+  SVFRT_Bytes data_range
+);
+
+// Write zeros after a message part of `written_part` bytes, up to
+// `SVFRT_MESSAGE_PART_ALIGNMENT`.
+SVFRT_ErrorCode SVFRT_write_part_padding(
+  SVFRT_WriterFn *writer_fn,
+  void *writer_ptr,
+  uint32_t written_part
+);
+
+// Size of a primitive or a struct, as defined by the schema (`structs`). Returns 0
+// on an error, and for types that don't have a size on their own (choices).
+uint32_t SVFRT_conversion_get_type_size(
+  SVFRT_RangeStructDefinition structs,
+  SVF_Meta_ConcreteType_tag type_tag,
+  SVF_Meta_ConcreteType_payload *type_payload
+);
+
+// Alignment of a primitive or a struct, see #natural-alignment. Returns 0 in the
+// same cases as `SVFRT_conversion_get_type_size`.
+uint32_t SVFRT_conversion_get_type_alignment(
+  SVFRT_RangeStructDefinition structs,
+  SVF_Meta_ConcreteType_tag type_tag,
+  SVF_Meta_ConcreteType_payload *type_payload
+);
+
+// Upper bound of the conversion plan size in words (`uint32_t`), which only
+// depends on the dst-schema. Returns 0 if the schema is malformed.
+uint32_t SVFRT_conversion_plan_max_words(SVFRT_LogicalCompatibilityInfo *info);
+
+// Compile `info` into a conversion plan inside `memory`, which should have at
+// least `SVFRT_conversion_plan_max_words(info)` words. On success, returns `true`
+// and sets `out_plan` to the used part of `memory`.
+//
+// The plan does not refer to either schema, so it can be reused for all
+// messages with the same pair of schemas. See #conversion-plan.
+bool SVFRT_conversion_plan_compile(
+  SVFRT_RangeU32 *out_plan,
+  SVFRT_LogicalCompatibilityInfo *info,
+  SVFRT_RangeU32 memory
+);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
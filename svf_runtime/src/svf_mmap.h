@@ -0,0 +1,452 @@
+#ifndef SVF_MMAP_H
+#define SVF_MMAP_H
+
+// Optional helpers to map a whole file into memory read-only, e.g. for
+// `SVFRT_schema_registry_open` or `SVFRT_archive_open`. Mappings are page-aligned, which satisfies
+// `SVFRT_MESSAGE_PART_ALIGNMENT`. There is also a writer that builds a message
+// directly inside a mapped file, see `SVFRT_MappedFileWriter`.
+//
+// Not a part of the single-file "svf.h", since it pulls in platform headers, so
+// include it separately when needed.
+
+#ifndef SVFRT_NO_LIBC
+
+#ifdef _WIN32
+  #ifndef WIN32_LEAN_AND_MEAN
+    #define WIN32_LEAN_AND_MEAN
+  #endif
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+#ifndef SVFRT_SINGLE_FILE
+  #include "svf_runtime.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Map up to `max_size` bytes. Returns NULL on failure, or if the file is empty
+// or larger than that.
+static inline
+uint8_t *SVFRT_internal_map_file(char const *path, uint64_t max_size, uint64_t *out_size) {
+#ifdef _WIN32
+  HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    return NULL;
+  }
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size) || size.QuadPart <= 0 || (uint64_t) size.QuadPart > max_size) {
+    CloseHandle(file);
+    return NULL;
+  }
+
+  HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  CloseHandle(file);
+  if (!mapping) {
+    return NULL;
+  }
+
+  // The view keeps the mapping alive.
+  void *pointer = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+  if (!pointer) {
+    return NULL;
+  }
+
+  *out_size = (uint64_t) size.QuadPart;
+  return (uint8_t *) pointer;
+#else
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return NULL;
+  }
+
+  struct stat info;
+  if (0
+    || fstat(fd, &info) != 0
+    || info.st_size <= 0
+    || (uint64_t) info.st_size > max_size
+    || (uint64_t) info.st_size > (uint64_t) SIZE_MAX
+  ) {
+    close(fd);
+    return NULL;
+  }
+
+  // The mapping stays valid after closing the descriptor.
+  void *pointer = mmap(NULL, (size_t) info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (pointer == MAP_FAILED) {
+    return NULL;
+  }
+
+  *out_size = (uint64_t) info.st_size;
+  return (uint8_t *) pointer;
+#endif
+}
+
+static inline
+void SVFRT_internal_unmap_file(uint8_t *pointer, uint64_t size) {
+  if (!pointer) {
+    return;
+  }
+
+#ifdef _WIN32
+  (void) size;
+  UnmapViewOfFile(pointer);
+#else
+  munmap(pointer, (size_t) size);
+#endif
+}
+
+// Returns empty bytes on failure. Empty files and files larger than
+// `UINT32_MAX` bytes can't be mapped.
+static inline
+SVFRT_Bytes SVFRT_map_file(char const *path) {
+  uint64_t size = 0;
+  uint8_t *pointer = SVFRT_internal_map_file(path, UINT32_MAX, &size);
+  SVFRT_Bytes result = {
+    /*.pointer =*/ pointer,
+    /*.count =*/ pointer ? (uint32_t) size : 0,
+  };
+  return result;
+}
+
+static inline
+void SVFRT_unmap_file(SVFRT_Bytes bytes) {
+  SVFRT_internal_unmap_file(bytes.pointer, bytes.count);
+}
+
+// Same as `SVFRT_map_file`, but for files of any size, e.g. for
+// `SVFRT_read_message64`, see #wide-messages. On 32-bit platforms, this is
+// still limited by the address space.
+static inline
+SVFRT_Bytes64 SVFRT_map_file64(char const *path) {
+  uint64_t size = 0;
+  uint8_t *pointer = SVFRT_internal_map_file(path, UINT64_MAX, &size);
+  SVFRT_Bytes64 result = {
+    /*.pointer =*/ pointer,
+    /*.count =*/ pointer ? size : 0,
+  };
+  return result;
+}
+
+static inline
+void SVFRT_unmap_file64(SVFRT_Bytes64 bytes) {
+  SVFRT_internal_unmap_file(bytes.pointer, bytes.count);
+}
+
+// Compatible with `SVFRT_ReadAheadFn`, for a range inside a mapping returned by
+// `SVFRT_map_file`. Asks the OS to start paging it in, without waiting for it.
+// `read_ahead_ptr` is not used.
+static inline
+void SVFRT_read_ahead_mapped(void *read_ahead_ptr, SVFRT_Bytes range) {
+  (void) read_ahead_ptr;
+  if (!range.pointer || range.count == 0) {
+    return;
+  }
+
+#ifdef _WIN32
+  #if defined(_WIN32_WINNT) && _WIN32_WINNT >= 0x0602
+    WIN32_MEMORY_RANGE_ENTRY entry;
+    entry.VirtualAddress = range.pointer;
+    entry.NumberOfBytes = range.count;
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &entry, 0);
+  #endif
+#else
+  // The advice may be hidden by strict standard modes (e.g. `-std=c99` without
+  // `_POSIX_C_SOURCE`), in which case this does nothing.
+  #if defined(POSIX_MADV_WILLNEED) || defined(MADV_WILLNEED)
+    // The start must be page-aligned. The mapping itself is, so this stays
+    // inside of it.
+    uintptr_t page_size = (uintptr_t) sysconf(_SC_PAGESIZE);
+    uintptr_t start = (uintptr_t) range.pointer / page_size * page_size;
+    uintptr_t end = (uintptr_t) range.pointer + range.count;
+    #ifdef POSIX_MADV_WILLNEED
+      posix_madvise((void *) start, (size_t) (end - start), POSIX_MADV_WILLNEED);
+    #else
+      madvise((void *) start, (size_t) (end - start), MADV_WILLNEED);
+    #endif
+  #endif
+#endif
+}
+
+// The mapped file writer needs `ftruncate`, which strict standard modes (e.g.
+// `-std=c99` without `_POSIX_C_SOURCE`) hide, so it is only available when
+// that is declared.
+#if defined(_WIN32) || defined(__APPLE__) || (defined(_POSIX_C_SOURCE) && _POSIX_C_SOURCE >= 200112L)
+  #define SVFRT_MAPPED_FILE_WRITER_AVAILABLE 1
+#endif
+
+#ifdef SVFRT_MAPPED_FILE_WRITER_AVAILABLE
+
+// A sink for `SVFRT_write_start_buffered`, that writes a message straight into
+// a mapped file, so that the data is only written once, into the page cache.
+// The file is extended as needed (sparsely, where the file system supports
+// it), and trimmed to the message size when closing.
+//
+// Usage:
+// - `SVFRT_mapped_file_writer_open`.
+// - `SVFRT_write_start_buffered` with `writer.buffer` as the buffer,
+//   `SVFRT_mapped_file_writer_grow` as `grow_fn` and the writer as `grow_ptr`,
+//   and no `writer_fn`. The buffered writer grows the buffer geometrically.
+// - Write the message as usual, up to and including `SVFRT_write_finish`.
+// - `SVFRT_mapped_file_writer_close` with `ctx.buffer_used` as the size, or
+//   with zero if writing failed.
+//
+// For #message-patching, open an existing file with
+// `SVFRT_mapped_file_writer_open_existing`, and pass `writer.buffer`, its size,
+// `SVFRT_mapped_file_writer_grow` and the writer to `SVFRT_patch_start`. Close
+// with `ctx.write.buffer_used` as the size after `SVFRT_patch_finish` succeeds,
+// or with the original size otherwise.
+//
+// Limited to `UINT32_MAX` bytes, same as the buffered writer itself.
+typedef struct SVFRT_MappedFileWriter {
+#ifdef _WIN32
+  HANDLE file;
+#else
+  int fd;
+#endif
+  SVFRT_Bytes buffer;
+} SVFRT_MappedFileWriter;
+
+// Map a view of the whole file, which must already be `size` bytes, or be
+// extended to that on Windows.
+static inline
+uint8_t *SVFRT_internal_map_file_writable(SVFRT_MappedFileWriter *writer, uint32_t size) {
+#ifdef _WIN32
+  // Creating a mapping larger than the file extends the file.
+  HANDLE mapping = CreateFileMappingA(writer->file, NULL, PAGE_READWRITE, 0, size, NULL);
+  if (!mapping) {
+    return NULL;
+  }
+
+  // The view keeps the mapping alive.
+  void *pointer = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, 0);
+  CloseHandle(mapping);
+  return (uint8_t *) pointer;
+#else
+  void *pointer = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, writer->fd, 0);
+  if (pointer == MAP_FAILED) {
+    return NULL;
+  }
+  return (uint8_t *) pointer;
+#endif
+}
+
+// Create or truncate the file at `path`, and map the first `initial_size`
+// bytes of it, which must not be zero. Returns false on failure, in which case
+// there is nothing to close.
+static inline
+bool SVFRT_mapped_file_writer_open(
+  SVFRT_MappedFileWriter *writer,
+  char const *path,
+  uint32_t initial_size
+) {
+  SVFRT_Bytes empty = {0};
+  writer->buffer = empty;
+  if (initial_size == 0) {
+    return false;
+  }
+
+#ifdef _WIN32
+  writer->file = CreateFileA(
+    path,
+    GENERIC_READ | GENERIC_WRITE,
+    0,
+    NULL,
+    CREATE_ALWAYS,
+    FILE_ATTRIBUTE_NORMAL,
+    NULL
+  );
+  if (writer->file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+#else
+  writer->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0666);
+  if (writer->fd < 0) {
+    return false;
+  }
+  if (ftruncate(writer->fd, (off_t) initial_size) != 0) {
+    close(writer->fd);
+    return false;
+  }
+#endif
+
+  uint8_t *pointer = SVFRT_internal_map_file_writable(writer, initial_size);
+  if (!pointer) {
+#ifdef _WIN32
+    CloseHandle(writer->file);
+#else
+    close(writer->fd);
+#endif
+    return false;
+  }
+
+  writer->buffer.pointer = pointer;
+  writer->buffer.count = initial_size;
+  return true;
+}
+
+// Open the existing file at `path`, and map all of it, e.g. for
+// #message-patching. Its size is returned in `out_size`, and the mapping can
+// grow with `SVFRT_mapped_file_writer_grow`, same as for writing. Returns false
+// on failure, or if the file is empty or larger than `UINT32_MAX` bytes, in
+// which case there is nothing to close.
+static inline
+bool SVFRT_mapped_file_writer_open_existing(
+  SVFRT_MappedFileWriter *writer,
+  char const *path,
+  uint32_t *out_size
+) {
+  SVFRT_Bytes empty = {0};
+  writer->buffer = empty;
+
+#ifdef _WIN32
+  writer->file = CreateFileA(
+    path,
+    GENERIC_READ | GENERIC_WRITE,
+    0,
+    NULL,
+    OPEN_EXISTING,
+    FILE_ATTRIBUTE_NORMAL,
+    NULL
+  );
+  if (writer->file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(writer->file, &size) || size.QuadPart <= 0 || (uint64_t) size.QuadPart > UINT32_MAX) {
+    CloseHandle(writer->file);
+    return false;
+  }
+  uint32_t file_size = (uint32_t) size.QuadPart;
+#else
+  writer->fd = open(path, O_RDWR);
+  if (writer->fd < 0) {
+    return false;
+  }
+
+  struct stat info;
+  if (fstat(writer->fd, &info) != 0 || info.st_size <= 0 || (uint64_t) info.st_size > UINT32_MAX) {
+    close(writer->fd);
+    return false;
+  }
+  uint32_t file_size = (uint32_t) info.st_size;
+#endif
+
+  uint8_t *pointer = SVFRT_internal_map_file_writable(writer, file_size);
+  if (!pointer) {
+#ifdef _WIN32
+    CloseHandle(writer->file);
+#else
+    close(writer->fd);
+#endif
+    return false;
+  }
+
+  writer->buffer.pointer = pointer;
+  writer->buffer.count = file_size;
+  *out_size = file_size;
+  return true;
+}
+
+// Compatible with `SVFRT_GrowBufferFn`, `grow_ptr` is the writer. Extends the
+// file, and remaps it. On Linux, `mremap` is used when it's declared (needs
+// `_GNU_SOURCE`), otherwise the file is mapped again before unmapping the
+// old view. The data stays in the file either way, so nothing is copied.
+static inline
+bool SVFRT_mapped_file_writer_grow(void *grow_ptr, SVFRT_Bytes *inout_buffer, uint32_t min_count) {
+  SVFRT_MappedFileWriter *writer = (SVFRT_MappedFileWriter *) grow_ptr;
+  if (inout_buffer->pointer != writer->buffer.pointer || min_count <= writer->buffer.count) {
+    return false;
+  }
+
+#ifdef _WIN32
+  uint8_t *pointer = SVFRT_internal_map_file_writable(writer, min_count);
+  if (!pointer) {
+    return false;
+  }
+  UnmapViewOfFile(writer->buffer.pointer);
+#else
+  if (ftruncate(writer->fd, (off_t) min_count) != 0) {
+    return false;
+  }
+
+  #if defined(__linux__) && defined(MREMAP_MAYMOVE)
+    void *remapped = mremap(writer->buffer.pointer, writer->buffer.count, min_count, MREMAP_MAYMOVE);
+    if (remapped == MAP_FAILED) {
+      return false;
+    }
+    uint8_t *pointer = (uint8_t *) remapped;
+  #else
+    uint8_t *pointer = SVFRT_internal_map_file_writable(writer, min_count);
+    if (!pointer) {
+      return false;
+    }
+    munmap(writer->buffer.pointer, writer->buffer.count);
+  #endif
+#endif
+
+  writer->buffer.pointer = pointer;
+  writer->buffer.count = min_count;
+  *inout_buffer = writer->buffer;
+  return true;
+}
+
+// Unmap the file, and trim it to `size` bytes, which is usually
+// `ctx.buffer_used` after `SVFRT_write_finish`. With `flush`, writing the data
+// back to disk is started, but not waited for. Returns false if anything
+// failed, but always releases everything.
+static inline
+bool SVFRT_mapped_file_writer_close(SVFRT_MappedFileWriter *writer, uint32_t size, bool flush) {
+  bool ok = size <= writer->buffer.count;
+  if (!ok) {
+    size = writer->buffer.count;
+  }
+
+#ifdef _WIN32
+  if (flush && size > 0 && !FlushViewOfFile(writer->buffer.pointer, size)) {
+    ok = false;
+  }
+  UnmapViewOfFile(writer->buffer.pointer);
+
+  LARGE_INTEGER end;
+  end.QuadPart = size;
+  if (!SetFilePointerEx(writer->file, end, NULL, FILE_BEGIN) || !SetEndOfFile(writer->file)) {
+    ok = false;
+  }
+  CloseHandle(writer->file);
+#else
+  if (flush && size > 0 && msync(writer->buffer.pointer, size, MS_ASYNC) != 0) {
+    ok = false;
+  }
+  munmap(writer->buffer.pointer, writer->buffer.count);
+
+  if (ftruncate(writer->fd, (off_t) size) != 0) {
+    ok = false;
+  }
+  close(writer->fd);
+#endif
+
+  SVFRT_Bytes empty = {0};
+  writer->buffer = empty;
+  return ok;
+}
+
+#endif // SVFRT_MAPPED_FILE_WRITER_AVAILABLE
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // SVFRT_NO_LIBC
+
+#endif // SVF_MMAP_H
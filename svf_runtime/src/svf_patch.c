@@ -0,0 +1,763 @@
+#ifndef SVFRT_SINGLE_FILE
+  #include "svf_runtime.h"
+  #include "svf_internal.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// #message-patching
+//
+// The compaction has four steps:
+// - Walk the data from the entry, same as for #message-verification, and
+//   collect the target range of each handle, with the entry itself.
+// - Sort the ranges by offset, and check that they don't overlap, since the
+//   data can't be aliased. Assign each one a new offset, packing them in the
+//   same order while keeping their #natural-alignment.
+// - Walk the data again, replacing each handle with the new offset of its
+//   target. Each handle is visited exactly once, because of no aliasing.
+// - Move the ranges down, in order, so that none of them is overwritten before
+//   it's moved.
+//
+// Everything that can fail is checked in the first two steps, so the message
+// is only changed when the compaction is going to succeed.
+
+void SVFRT_patch_start(
+  SVFRT_PatchContext *result,
+  SVFRT_Bytes buffer,
+  uint32_t message_size,
+  SVFRT_GrowBufferFn *grow_fn,
+  void *grow_ptr,
+  uint64_t schema_content_hash,
+  SVFRT_Bytes schema_bytes,
+  uint64_t entry_struct_id,
+  uint32_t entry_struct_index
+) {
+  result->write.error_code = 0;
+  result->write.finished = false;
+  result->write.writer_ptr = NULL;
+  result->write.writer_fn = NULL;
+  result->write.data_bytes_written = 0;
+  result->write.buffer = buffer;
+  result->write.buffer_used = message_size;
+  result->write.grow_fn = grow_fn;
+  result->write.grow_ptr = grow_ptr;
+  result->schema = schema_bytes;
+  result->entry_struct_index = entry_struct_index;
+  result->entry_size = 0;
+  result->entry_offset = 0;
+  result->data_start = 0;
+  result->dead_bytes = 0;
+  result->max_recursion_depth = SVFRT_DEFAULT_MAX_RECURSION_DEPTH;
+
+  if (!buffer.pointer || message_size > buffer.count) {
+    result->write.error_code = SVFRT_code_write__buffer_full;
+    return;
+  }
+
+  SVFRT_MessageHeader *header = (SVFRT_MessageHeader *) buffer.pointer;
+  if (0
+    || message_size < sizeof(SVFRT_MessageHeader)
+    || header->magic[0] != 'S'
+    || header->magic[1] != 'V'
+    || header->magic[2] != 'F'
+    || header->version != 0
+    || (header->flags & SVFRT_MESSAGE_FLAG_WIDE) != 0
+    || header->schema_content_hash != schema_content_hash
+    || header->entry_struct_id != entry_struct_id
+    || !SVFRT_internal_schema_definition(schema_bytes)
+  ) {
+    result->write.error_code = SVFRT_code_write__patch_mismatch;
+    return;
+  }
+
+  // The data starts after the schema and the appendix, both padded, see
+  // `SVFRT_write_start`.
+  uint64_t alignment = SVFRT_MESSAGE_PART_ALIGNMENT;
+  uint64_t schema_end = (uint64_t) sizeof(SVFRT_MessageHeader) + (uint64_t) header->schema_length;
+  uint64_t data_start = (
+    (schema_end + alignment - 1) / alignment * alignment + (uint64_t) header->appendix_length
+    + alignment - 1
+  ) / alignment * alignment;
+  if (data_start > (uint64_t) message_size) {
+    result->write.error_code = SVFRT_code_write__patch_mismatch;
+    return;
+  }
+
+  SVF_Meta_SchemaDefinition *definition = SVFRT_internal_schema_definition(schema_bytes);
+  SVFRT_RangeStructDefinition structs = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
+    schema_bytes,
+    definition->structs,
+    SVF_Meta_StructDefinition
+  );
+  if (!structs.pointer || entry_struct_index >= structs.count) {
+    result->write.error_code = SVFRT_code_write__patch_mismatch;
+    return;
+  }
+
+  // The entry is always written last, see `SVFRT_write_finish`.
+  uint32_t data_size = message_size - (uint32_t) data_start;
+  uint32_t entry_size = structs.pointer[entry_struct_index].size;
+  if (entry_size == 0 || entry_size > data_size) {
+    result->write.error_code = SVFRT_code_write__patch_mismatch;
+    return;
+  }
+
+  result->write.data_bytes_written = data_size;
+  result->entry_size = entry_size;
+  result->entry_offset = data_size - entry_size;
+  result->data_start = (uint32_t) data_start;
+}
+
+typedef struct SVFRT_CompactRange {
+  uint32_t offset;
+  uint32_t size;
+  uint32_t alignment;
+  uint32_t new_offset;
+} SVFRT_CompactRange;
+
+typedef struct SVFRT_CompactContext {
+  SVFRT_Bytes schema;
+  SVFRT_RangeStructDefinition structs;
+  SVFRT_RangeChoiceDefinition choices;
+  SVFRT_Bytes data_range;
+  SVFRT_CompactRange *ranges;
+  uint32_t range_count;
+  uint32_t range_capacity;
+  bool fix; // Replace handles, instead of collecting ranges.
+  uint32_t max_recursion_depth;
+  uint64_t tally;
+  SVFRT_ErrorCode error_code;
+} SVFRT_CompactContext;
+
+// Forward declaration.
+static
+void SVFRT_compact_any_type(
+  SVFRT_CompactContext *ctx,
+  uint32_t recursion_depth,
+  uint32_t data_offset,
+  SVF_Meta_Type_tag type_tag,
+  SVF_Meta_Type_payload *type_payload
+);
+
+// Find the range starting at `data_offset`, or NULL. Only after sorting.
+static
+SVFRT_CompactRange *SVFRT_compact_find_range(SVFRT_CompactContext *ctx, uint32_t data_offset) {
+  uint32_t low = 0;
+  uint32_t high = ctx->range_count;
+  while (low < high) {
+    uint32_t middle = low + (high - low) / 2;
+    SVFRT_CompactRange *range = ctx->ranges + middle;
+    if (data_offset < range->offset) {
+      high = middle;
+    } else if (data_offset > range->offset) {
+      low = middle + 1;
+    } else {
+      return range;
+    }
+  }
+  return NULL;
+}
+
+// Collect the target of a handle, `count` items of `stride` bytes, or replace
+// `*inout_complement` with its new offset. It is a copy, since handles in the
+// data may be unaligned. Returns `false` on an error.
+static
+bool SVFRT_compact_target(
+  SVFRT_CompactContext *ctx,
+  uint32_t *inout_complement,
+  uint32_t stride,
+  uint32_t count
+) {
+  uint32_t data_offset = ~*inout_complement;
+
+  if (ctx->fix) {
+    SVFRT_CompactRange *range = SVFRT_compact_find_range(ctx, data_offset);
+    if (!range) {
+      ctx->error_code = SVFRT_code_write__compaction_failed;
+      return false;
+    }
+    *inout_complement = ~range->new_offset;
+    return true;
+  }
+
+  // Prevent multiply-add overflow by casting operands to `uint64_t` first. It
+  // works, because `UINT64_MAX == UINT32_MAX * UINT32_MAX + UINT32_MAX + UINT32_MAX`.
+  uint64_t total_size = (uint64_t) stride * (uint64_t) count;
+  if ((uint64_t) data_offset + total_size > (uint64_t) ctx->data_range.count) {
+    ctx->error_code = SVFRT_code_write__compaction_failed;
+    return false;
+  }
+
+  // Both operands are at most `UINT32_MAX`, so this can't overflow.
+  ctx->tally += total_size;
+  if (ctx->tally > (uint64_t) ctx->data_range.count) {
+    ctx->error_code = SVFRT_code_write__compaction_failed;
+    return false;
+  }
+
+  if (ctx->range_count >= ctx->range_capacity) {
+    ctx->error_code = SVFRT_code_write__not_enough_scratch;
+    return false;
+  }
+
+  // Data from older writers may not be naturally aligned, in which case it is
+  // not aligned after moving either.
+  uint32_t alignment = SVFRT_natural_alignment(stride);
+  SVFRT_CompactRange *range = ctx->ranges + ctx->range_count;
+  range->offset = data_offset;
+  range->size = (uint32_t) total_size;
+  range->alignment = data_offset % alignment == 0 ? alignment : 1;
+  range->new_offset = 0;
+  ctx->range_count++;
+  return true;
+}
+
+static
+void SVFRT_compact_struct(
+  SVFRT_CompactContext *ctx,
+  uint32_t recursion_depth,
+  uint32_t struct_index,
+  uint32_t data_offset
+) {
+  if (recursion_depth >= ctx->max_recursion_depth || struct_index >= ctx->structs.count) {
+    ctx->error_code = SVFRT_code_write__compaction_failed;
+    return;
+  }
+
+  SVFRT_RangeFieldDefinition fields = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
+    ctx->schema,
+    ctx->structs.pointer[struct_index].fields,
+    SVF_Meta_FieldDefinition
+  );
+  if (!fields.pointer && fields.count) {
+    ctx->error_code = SVFRT_code_write__compaction_failed;
+    return;
+  }
+
+  for (uint32_t i = 0; i < fields.count; i++) {
+    SVF_Meta_FieldDefinition *field = fields.pointer + i;
+    if (field->removed) {
+      continue;
+    }
+
+    // Prevent addition overflow by casting operands to `uint64_t` first.
+    if ((uint64_t) data_offset + (uint64_t) field->offset > (uint64_t) ctx->data_range.count) {
+      ctx->error_code = SVFRT_code_write__compaction_failed;
+      return;
+    }
+
+    SVFRT_compact_any_type(
+      ctx,
+      recursion_depth + 1,
+      data_offset + field->offset,
+      field->type_tag,
+      &field->type_payload
+    );
+
+    if (ctx->error_code) {
+      return;
+    }
+  }
+}
+
+static
+void SVFRT_compact_choice(
+  SVFRT_CompactContext *ctx,
+  uint32_t recursion_depth,
+  uint32_t choice_index,
+  uint32_t data_offset
+) {
+  if (recursion_depth >= ctx->max_recursion_depth || choice_index >= ctx->choices.count) {
+    ctx->error_code = SVFRT_code_write__compaction_failed;
+    return;
+  }
+
+  // Prevent addition overflow by casting operands to `uint64_t` first.
+  if ((uint64_t) data_offset + (uint64_t) SVFRT_TAG_SIZE > (uint64_t) ctx->data_range.count) {
+    ctx->error_code = SVFRT_code_write__compaction_failed;
+    return;
+  }
+
+  uint8_t choice_tag = *(ctx->data_range.pointer + data_offset);
+
+  SVFRT_RangeOptionDefinition options = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
+    ctx->schema,
+    ctx->choices.pointer[choice_index].options,
+    SVF_Meta_OptionDefinition
+  );
+  if (!options.pointer && options.count) {
+    ctx->error_code = SVFRT_code_write__compaction_failed;
+    return;
+  }
+
+  for (uint32_t i = 0; i < options.count; i++) {
+    SVF_Meta_OptionDefinition *option = options.pointer + i;
+    if (option->tag != choice_tag) {
+      continue;
+    }
+    if (option->removed) {
+      return;
+    }
+
+    SVFRT_compact_any_type(
+      ctx,
+      recursion_depth + 1,
+      data_offset + SVFRT_TAG_SIZE,
+      option->type_tag,
+      &option->type_payload
+    );
+    return;
+  }
+}
+
+static
+void SVFRT_compact_concrete_type(
+  SVFRT_CompactContext *ctx,
+  uint32_t recursion_depth,
+  uint32_t data_offset,
+  SVF_Meta_ConcreteType_tag type_tag,
+  SVF_Meta_ConcreteType_payload *type_payload
+) {
+  switch (type_tag) {
+    case SVF_Meta_ConcreteType_tag_definedStruct: {
+      SVFRT_compact_struct(ctx, recursion_depth, type_payload->definedStruct.index, data_offset);
+      return;
+    }
+    case SVF_Meta_ConcreteType_tag_definedChoice: {
+      SVFRT_compact_choice(ctx, recursion_depth, type_payload->definedChoice.index, data_offset);
+      return;
+    }
+    default: {
+      // Primitives, nothing to do.
+      return;
+    }
+  }
+}
+
+// Walk `count` items at `data_offset`, unless there are no handles in them.
+// The range is already checked.
+static
+void SVFRT_compact_items(
+  SVFRT_CompactContext *ctx,
+  uint32_t recursion_depth,
+  uint32_t data_offset,
+  uint32_t stride,
+  uint32_t count,
+  SVF_Meta_ConcreteType_tag type_tag,
+  SVF_Meta_ConcreteType_payload *type_payload
+) {
+  if (SVFRT_internal_is_flat(
+    ctx->schema,
+    ctx->structs,
+    ctx->choices,
+    recursion_depth,
+    ctx->max_recursion_depth,
+    type_tag,
+    type_payload
+  )) {
+    return;
+  }
+
+  // The whole range is in bounds, so this can't overflow.
+  for (uint32_t i = 0; i < count; i++) {
+    SVFRT_compact_concrete_type(ctx, recursion_depth, data_offset + i * stride, type_tag, type_payload);
+    if (ctx->error_code) {
+      return;
+    }
+  }
+}
+
+static
+void SVFRT_compact_chunked_sequence(
+  SVFRT_CompactContext *ctx,
+  uint32_t recursion_depth,
+  uint32_t data_offset,
+  SVF_Meta_ConcreteType_tag type_tag,
+  SVF_Meta_ConcreteType_payload *type_payload
+) {
+  // Handles are accessed through `SVFRT_MEMCPY`, see #natural-alignment.
+  uint8_t *sequence_pointer = ctx->data_range.pointer + data_offset;
+  SVFRT_ChunkedSequence sequence = {0};
+  SVFRT_MEMCPY(&sequence, sequence_pointer, sizeof(sequence));
+  if (sequence.count == 0) {
+    if (ctx->fix) {
+      sequence.data_offset_complement = 0;
+      SVFRT_MEMCPY(sequence_pointer, &sequence, sizeof(sequence));
+    }
+    return;
+  }
+
+  uint32_t stride = SVFRT_conversion_get_type_size(ctx->structs, type_tag, type_payload);
+  if (stride == 0) {
+    ctx->error_code = SVFRT_code_write__compaction_failed;
+    return;
+  }
+
+  // The iterator reads each link before it is changed, so the chain is always
+  // followed through the old offsets.
+  SVFRT_ReadContext read_ctx = { ctx->data_range, { NULL, 0 } };
+  SVFRT_ChunkIterator iterator = SVFRT_chunk_iterator_begin(sequence);
+
+  uint32_t complement = sequence.data_offset_complement;
+  if (!SVFRT_compact_target(ctx, &complement, sizeof(SVFRT_ChunkLink), 1)) {
+    return;
+  }
+  sequence.data_offset_complement = complement;
+  SVFRT_MEMCPY(sequence_pointer, &sequence, sizeof(sequence));
+
+  SVFRT_Sequence chunk;
+  while (iterator.link_complement != 0) {
+    uint32_t link_offset = ~iterator.link_complement;
+    if (!SVFRT_chunk_iterator_next(&read_ctx, &iterator, &chunk)) {
+      ctx->error_code = SVFRT_code_write__compaction_failed;
+      return;
+    }
+
+    uint32_t data_complement = chunk.data_offset_complement;
+    if (!SVFRT_compact_target(ctx, &data_complement, stride, chunk.count)) {
+      return;
+    }
+
+    SVFRT_compact_items(
+      ctx,
+      recursion_depth,
+      ~chunk.data_offset_complement,
+      stride,
+      chunk.count,
+      type_tag,
+      type_payload
+    );
+    if (ctx->error_code) {
+      return;
+    }
+
+    uint32_t previous_complement = iterator.link_complement;
+    if (
+      previous_complement != 0 &&
+      !SVFRT_compact_target(ctx, &previous_complement, sizeof(SVFRT_ChunkLink), 1)
+    ) {
+      return;
+    }
+
+    if (ctx->fix) {
+      SVFRT_ChunkLink link = {0};
+      SVFRT_MEMCPY(&link, ctx->data_range.pointer + link_offset, sizeof(link));
+      link.data_offset_complement = data_complement;
+      link.previous_complement = previous_complement;
+      SVFRT_MEMCPY(ctx->data_range.pointer + link_offset, &link, sizeof(link));
+    }
+  }
+
+  if (iterator.remaining != 0) {
+    ctx->error_code = SVFRT_code_write__compaction_failed;
+  }
+}
+
+static
+void SVFRT_compact_any_type(
+  SVFRT_CompactContext *ctx,
+  uint32_t recursion_depth,
+  uint32_t data_offset,
+  SVF_Meta_Type_tag type_tag,
+  SVF_Meta_Type_payload *type_payload
+) {
+  uint32_t handle_size = 0;
+  switch (type_tag) {
+    case SVF_Meta_Type_tag_reference: {
+      handle_size = sizeof(SVFRT_Reference);
+      break;
+    }
+    case SVF_Meta_Type_tag_sequence: {
+      handle_size = sizeof(SVFRT_Sequence);
+      break;
+    }
+    case SVF_Meta_Type_tag_chunkedSequence: {
+      handle_size = sizeof(SVFRT_ChunkedSequence);
+      break;
+    }
+    default: {
+      break;
+    }
+  }
+
+  // Prevent addition overflow by casting operands to `uint64_t` first.
+  if ((uint64_t) data_offset + (uint64_t) handle_size > (uint64_t) ctx->data_range.count) {
+    ctx->error_code = SVFRT_code_write__compaction_failed;
+    return;
+  }
+
+  switch (type_tag) {
+    case SVF_Meta_Type_tag_concrete: {
+      SVFRT_compact_concrete_type(
+        ctx,
+        recursion_depth,
+        data_offset,
+        type_payload->concrete.type_tag,
+        &type_payload->concrete.type_payload
+      );
+      return;
+    }
+    case SVF_Meta_Type_tag_reference: {
+      SVFRT_Reference reference = {0};
+      SVFRT_MEMCPY(&reference, ctx->data_range.pointer + data_offset, sizeof(reference));
+
+      uint32_t size = SVFRT_conversion_get_type_size(
+        ctx->structs,
+        type_payload->reference.type_tag,
+        &type_payload->reference.type_payload
+      );
+      if (size == 0) {
+        ctx->error_code = SVFRT_code_write__compaction_failed;
+        return;
+      }
+
+      uint32_t complement = reference.data_offset_complement;
+      if (!SVFRT_compact_target(ctx, &complement, size, 1)) {
+        return;
+      }
+
+      SVFRT_compact_concrete_type(
+        ctx,
+        recursion_depth,
+        ~reference.data_offset_complement,
+        type_payload->reference.type_tag,
+        &type_payload->reference.type_payload
+      );
+      reference.data_offset_complement = complement;
+      SVFRT_MEMCPY(ctx->data_range.pointer + data_offset, &reference, sizeof(reference));
+      return;
+    }
+    case SVF_Meta_Type_tag_sequence: {
+      SVFRT_Sequence sequence = {0};
+      SVFRT_MEMCPY(&sequence, ctx->data_range.pointer + data_offset, sizeof(sequence));
+
+      uint32_t stride = SVFRT_conversion_get_type_size(
+        ctx->structs,
+        type_payload->sequence.elementType_tag,
+        &type_payload->sequence.elementType_payload
+      );
+      if (stride == 0) {
+        ctx->error_code = SVFRT_code_write__compaction_failed;
+        return;
+      }
+
+      // Empty sequences don't point anywhere after moving.
+      if (sequence.count == 0) {
+        if (ctx->fix) {
+          sequence.data_offset_complement = 0;
+          SVFRT_MEMCPY(ctx->data_range.pointer + data_offset, &sequence, sizeof(sequence));
+        }
+        return;
+      }
+
+      uint32_t complement = sequence.data_offset_complement;
+      if (!SVFRT_compact_target(ctx, &complement, stride, sequence.count)) {
+        return;
+      }
+
+      SVFRT_compact_items(
+        ctx,
+        recursion_depth,
+        ~sequence.data_offset_complement,
+        stride,
+        sequence.count,
+        type_payload->sequence.elementType_tag,
+        &type_payload->sequence.elementType_payload
+      );
+      sequence.data_offset_complement = complement;
+      SVFRT_MEMCPY(ctx->data_range.pointer + data_offset, &sequence, sizeof(sequence));
+      return;
+    }
+    case SVF_Meta_Type_tag_chunkedSequence: {
+      SVFRT_compact_chunked_sequence(
+        ctx,
+        recursion_depth,
+        data_offset,
+        type_payload->chunkedSequence.elementType_tag,
+        &type_payload->chunkedSequence.elementType_payload
+      );
+      return;
+    }
+    case SVF_Meta_Type_tag_nothing:
+    default: {
+      return;
+    }
+  }
+}
+
+// Heapsort by offset: in-place, and no worst case to exploit.
+static
+void SVFRT_compact_sort(SVFRT_CompactRange *ranges, uint32_t count) {
+  if (count < 2) {
+    return;
+  }
+
+  // Heapify, then repeatedly move the max to the end.
+  uint32_t start = count / 2;
+  uint32_t end = count;
+  while (end > 1) {
+    if (start > 0) {
+      start--;
+    } else {
+      end--;
+      SVFRT_CompactRange temp = ranges[0];
+      ranges[0] = ranges[end];
+      ranges[end] = temp;
+    }
+
+    // Sift down from `start`.
+    uint32_t root = start;
+    for (;;) {
+      // No overflow, as `count` is limited by the scratch memory size.
+      uint32_t child = 2 * root + 1;
+      if (child >= end) {
+        break;
+      }
+      if (child + 1 < end && ranges[child].offset < ranges[child + 1].offset) {
+        child++;
+      }
+      if (ranges[root].offset >= ranges[child].offset) {
+        break;
+      }
+      SVFRT_CompactRange temp = ranges[root];
+      ranges[root] = ranges[child];
+      ranges[child] = temp;
+      root = child;
+    }
+  }
+}
+
+static
+void SVFRT_patch_compact(SVFRT_PatchContext *ctx, SVFRT_Bytes scratch) {
+  // The schema was checked in `SVFRT_patch_begin`.
+  SVF_Meta_SchemaDefinition *definition = SVFRT_internal_schema_definition(ctx->schema);
+
+  SVFRT_RangeStructDefinition structs = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
+    ctx->schema,
+    definition->structs,
+    SVF_Meta_StructDefinition
+  );
+  SVFRT_RangeChoiceDefinition choices = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
+    ctx->schema,
+    definition->choices,
+    SVF_Meta_ChoiceDefinition
+  );
+  if (!choices.pointer && choices.count) {
+    ctx->write.error_code = SVFRT_code_write__compaction_failed;
+    return;
+  }
+
+  SVFRT_CompactContext compact = {0};
+  compact.schema = ctx->schema;
+  compact.structs = structs;
+  compact.choices = choices;
+  compact.data_range.pointer = ctx->write.buffer.pointer + ctx->data_start;
+  compact.data_range.count = ctx->write.data_bytes_written;
+  compact.max_recursion_depth = ctx->max_recursion_depth;
+
+  // Ranges are kept in `scratch`, aligned for `uint32_t`.
+  uint32_t misalignment = (uint32_t) ((uintptr_t) scratch.pointer % sizeof(uint32_t));
+  uint32_t padding = misalignment ? (uint32_t) sizeof(uint32_t) - misalignment : 0;
+  if (scratch.pointer && scratch.count > padding) {
+    compact.ranges = (SVFRT_CompactRange *) (scratch.pointer + padding);
+    compact.range_capacity = (scratch.count - padding) / sizeof(SVFRT_CompactRange);
+  }
+
+  // Collect everything that is reachable from the entry.
+  uint32_t entry_complement = ~ctx->entry_offset;
+  if (!SVFRT_compact_target(&compact, &entry_complement, ctx->entry_size, 1)) {
+    ctx->write.error_code = compact.error_code;
+    return;
+  }
+  SVFRT_compact_struct(&compact, 0, ctx->entry_struct_index, ctx->entry_offset);
+  if (compact.error_code) {
+    ctx->write.error_code = compact.error_code;
+    return;
+  }
+
+  SVFRT_compact_sort(compact.ranges, compact.range_count);
+  uint32_t new_size = 0;
+  for (uint32_t i = 0; i < compact.range_count; i++) {
+    SVFRT_CompactRange *range = compact.ranges + i;
+    if (i > 0 && range[-1].offset + range[-1].size > range->offset) {
+      ctx->write.error_code = SVFRT_code_write__compaction_failed;
+      return;
+    }
+
+    // Ranges are packed in order, so they only ever move down.
+    range->new_offset = (new_size + range->alignment - 1) / range->alignment * range->alignment;
+    new_size = range->new_offset + range->size;
+  }
+
+  // The entry is at the very end, so it is the last range.
+  SVFRT_CompactRange *entry_range = compact.ranges + compact.range_count - 1;
+  if (entry_range->offset != ctx->entry_offset) {
+    ctx->write.error_code = SVFRT_code_write__compaction_failed;
+    return;
+  }
+
+  // Nothing can fail after this point, since the walk is the same, and all the
+  // targets are known.
+  compact.fix = true;
+  SVFRT_compact_struct(&compact, 0, ctx->entry_struct_index, ctx->entry_offset);
+  if (compact.error_code) {
+    ctx->write.error_code = compact.error_code;
+    return;
+  }
+
+  uint8_t *data = compact.data_range.pointer;
+  uint32_t previous_end = 0;
+  for (uint32_t i = 0; i < compact.range_count; i++) {
+    SVFRT_CompactRange *range = compact.ranges + i;
+    SVFRT_MEMSET(data + previous_end, 0, range->new_offset - previous_end);
+    if (range->new_offset + range->size <= range->offset) {
+      SVFRT_MEMCPY(data + range->new_offset, data + range->offset, range->size);
+    } else if (range->new_offset != range->offset) {
+      // Overlapping, but moving down, so copying forward is fine.
+      for (uint32_t j = 0; j < range->size; j++) {
+        data[range->new_offset + j] = data[range->offset + j];
+      }
+    }
+    previous_end = range->new_offset + range->size;
+  }
+
+  ctx->write.data_bytes_written = new_size;
+  ctx->write.buffer_used = ctx->data_start + new_size;
+  ctx->entry_offset = entry_range->new_offset;
+  ctx->dead_bytes = 0;
+}
+
+void SVFRT_patch_finish(
+  SVFRT_PatchContext *ctx,
+  SVFRT_Bytes scratch,
+  uint32_t compaction_threshold
+) {
+  if (ctx->write.error_code) {
+    return;
+  }
+
+  // Move the entry to the end, if it's not there anymore.
+  uint32_t entry_end = ctx->entry_offset + ctx->entry_size;
+  if (ctx->write.data_bytes_written != entry_end) {
+    SVFRT_Reference reference = {0};
+    void *pointer = SVFRT_write_reference_reserve(&ctx->write, ctx->entry_size, &reference);
+    if (!pointer) {
+      return;
+    }
+
+    // The buffer may have grown, so the old entry is found again.
+    SVFRT_MEMCPY(pointer, ctx->write.buffer.pointer + ctx->data_start + ctx->entry_offset, ctx->entry_size);
+    SVFRT_patch_release(ctx, ctx->entry_size);
+    ctx->entry_offset = ~reference.data_offset_complement;
+  }
+
+  if (ctx->dead_bytes > compaction_threshold) {
+    SVFRT_patch_compact(ctx, scratch);
+  }
+}
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,227 @@
+#ifndef SVFRT_SINGLE_FILE
+  #include "svf_runtime.h"
+  #include "svf_internal.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// #schema-registry
+//
+// The file is written once as a whole, so the table never needs to grow in
+// place. It is sized to at least twice the entry count, which keeps probe
+// sequences short, and guarantees that every probe sequence ends at an empty
+// slot.
+
+static inline
+uint64_t SVFRT_registry_align_up(uint64_t value, uint64_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+static inline
+uint32_t SVFRT_registry_slot_index(uint64_t schema_content_hash, uint32_t slot_count) {
+  // Content hashes are already well-distributed, so a cheap mix is enough.
+  uint64_t h = schema_content_hash;
+  h ^= h >> 32;
+  return (uint32_t) h & (slot_count - 1);
+}
+
+static inline
+uint64_t SVFRT_registry_table_end(uint32_t slot_count) {
+  return (uint64_t) sizeof(SVFRT_SchemaRegistryHeader)
+    + (uint64_t) slot_count * sizeof(SVFRT_SchemaRegistrySlot);
+}
+
+// Output buffers are not necessarily aligned, so copy byte-wise.
+static inline
+void SVFRT_registry_copy_bytes(uint8_t *dst, void const *src, uint32_t size) {
+  uint8_t const *bytes_src = (uint8_t const *) src;
+  for (uint32_t i = 0; i < size; i++) {
+    dst[i] = bytes_src[i];
+  }
+}
+
+SVFRT_ErrorCode SVFRT_schema_registry_open(
+  SVFRT_SchemaRegistry *registry,
+  SVFRT_Bytes file
+) {
+  registry->file.pointer = NULL;
+  registry->file.count = 0;
+  registry->slots = NULL;
+  registry->slot_count = 0;
+  registry->entry_count = 0;
+
+  if (((uintptr_t) file.pointer) % SVFRT_MESSAGE_PART_ALIGNMENT != 0) {
+    return SVFRT_code_registry__not_aligned;
+  }
+
+  if (file.count < sizeof(SVFRT_SchemaRegistryHeader)) {
+    return SVFRT_code_registry__malformed;
+  }
+
+  SVFRT_SchemaRegistryHeader const *header = (SVFRT_SchemaRegistryHeader const *) file.pointer;
+  if (0
+    || header->magic[0] != 'S'
+    || header->magic[1] != 'V'
+    || header->magic[2] != 'F'
+    || header->magic[3] != 'R'
+    || header->version != SVFRT_SCHEMA_REGISTRY_VERSION
+    || header->slot_count == 0
+    || (header->slot_count & (header->slot_count - 1)) != 0
+    || header->entry_count >= header->slot_count
+  ) {
+    return SVFRT_code_registry__malformed;
+  }
+
+  uint64_t table_end = SVFRT_registry_table_end(header->slot_count);
+  if (table_end > (uint64_t) file.count) {
+    return SVFRT_code_registry__malformed;
+  }
+
+  SVFRT_SchemaRegistrySlot const *slots = (SVFRT_SchemaRegistrySlot const *) (header + 1);
+  uint32_t entry_count = 0;
+  for (uint32_t i = 0; i < header->slot_count; i++) {
+    SVFRT_SchemaRegistrySlot const *slot = slots + i;
+    if (slot->schema_offset == 0) {
+      if (slot->schema_length != 0 || slot->schema_content_hash != 0) {
+        return SVFRT_code_registry__malformed;
+      }
+      continue;
+    }
+
+    if (0
+      || (uint64_t) slot->schema_offset < table_end
+      || slot->schema_offset % SVFRT_MESSAGE_PART_ALIGNMENT != 0
+      || (uint64_t) slot->schema_offset + (uint64_t) slot->schema_length > (uint64_t) file.count
+    ) {
+      return SVFRT_code_registry__malformed;
+    }
+
+    entry_count++;
+  }
+
+  if (entry_count != header->entry_count) {
+    return SVFRT_code_registry__malformed;
+  }
+
+  registry->file = file;
+  registry->slots = slots;
+  registry->slot_count = header->slot_count;
+  registry->entry_count = entry_count;
+  return 0;
+}
+
+SVFRT_Bytes SVFRT_schema_registry_lookup(
+  void *registry,
+  uint64_t schema_content_hash
+) {
+  SVFRT_SchemaRegistry const *it = (SVFRT_SchemaRegistry const *) registry;
+  SVFRT_Bytes result = {
+    /*.pointer =*/ NULL,
+    /*.count =*/ 0,
+  };
+
+  if (!it->slots) {
+    return result;
+  }
+
+  // The table is never full (see `SVFRT_schema_registry_open`), so this always
+  // ends at an empty slot.
+  uint32_t mask = it->slot_count - 1;
+  uint32_t index = SVFRT_registry_slot_index(schema_content_hash, it->slot_count);
+  while (1) {
+    SVFRT_SchemaRegistrySlot const *slot = it->slots + index;
+    if (slot->schema_offset == 0) {
+      return result;
+    }
+
+    if (slot->schema_content_hash == schema_content_hash) {
+      result.pointer = it->file.pointer + slot->schema_offset;
+      result.count = slot->schema_length;
+      return result;
+    }
+
+    index = (index + 1) & mask;
+  }
+}
+
+uint32_t SVFRT_schema_registry_write(
+  SVFRT_Bytes const *schemas,
+  uint64_t const *schema_content_hashes,
+  uint32_t schema_count,
+  SVFRT_Bytes out_bytes,
+  SVFRT_ErrorCode *out_error_code
+) {
+  *out_error_code = 0;
+
+  uint64_t slot_count = 1;
+  while (slot_count < 2 * (uint64_t) schema_count) {
+    slot_count *= 2;
+  }
+
+  uint64_t total_size = SVFRT_registry_table_end(slot_count > UINT32_MAX ? 0 : (uint32_t) slot_count);
+  for (uint32_t i = 0; i < schema_count; i++) {
+    total_size = SVFRT_registry_align_up(total_size, SVFRT_MESSAGE_PART_ALIGNMENT);
+    total_size += schemas[i].count;
+  }
+  total_size = SVFRT_registry_align_up(total_size, SVFRT_MESSAGE_PART_ALIGNMENT);
+
+  if (slot_count > UINT32_MAX || total_size > UINT32_MAX) {
+    *out_error_code = SVFRT_code_registry__too_large;
+    return 0;
+  }
+
+  if (total_size > (uint64_t) out_bytes.count) {
+    *out_error_code = SVFRT_code_registry__buffer_too_small;
+    return (uint32_t) total_size;
+  }
+
+  for (uint32_t i = 0; i < (uint32_t) total_size; i++) {
+    out_bytes.pointer[i] = 0;
+  }
+
+  SVFRT_SchemaRegistryHeader header = {
+    /*.magic =*/ { 'S', 'V', 'F', 'R' },
+    /*.version =*/ SVFRT_SCHEMA_REGISTRY_VERSION,
+    /*.slot_count =*/ (uint32_t) slot_count,
+    /*.entry_count =*/ schema_count,
+  };
+  SVFRT_registry_copy_bytes(out_bytes.pointer, &header, sizeof(header));
+
+  uint8_t *slots = out_bytes.pointer + sizeof(SVFRT_SchemaRegistryHeader);
+  uint32_t mask = (uint32_t) slot_count - 1;
+  uint64_t schema_offset = SVFRT_registry_table_end((uint32_t) slot_count);
+  for (uint32_t i = 0; i < schema_count; i++) {
+    schema_offset = SVFRT_registry_align_up(schema_offset, SVFRT_MESSAGE_PART_ALIGNMENT);
+
+    uint32_t index = SVFRT_registry_slot_index(schema_content_hashes[i], (uint32_t) slot_count);
+    while (1) {
+      SVFRT_SchemaRegistrySlot slot;
+      SVFRT_registry_copy_bytes((uint8_t *) &slot, slots + index * sizeof(slot), sizeof(slot));
+      if (slot.schema_offset == 0) {
+        break;
+      }
+      if (slot.schema_content_hash == schema_content_hashes[i]) {
+        *out_error_code = SVFRT_code_registry__duplicate_schema;
+        return (uint32_t) total_size;
+      }
+      index = (index + 1) & mask;
+    }
+
+    SVFRT_SchemaRegistrySlot slot = {
+      /*.schema_content_hash =*/ schema_content_hashes[i],
+      /*.schema_offset =*/ (uint32_t) schema_offset,
+      /*.schema_length =*/ schemas[i].count,
+    };
+    SVFRT_registry_copy_bytes(slots + index * sizeof(slot), &slot, sizeof(slot));
+    SVFRT_registry_copy_bytes(out_bytes.pointer + schema_offset, schemas[i].pointer, schemas[i].count);
+    schema_offset += schemas[i].count;
+  }
+
+  return (uint32_t) total_size;
+}
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -18,30 +18,24 @@ uint64_t SVFRT_align_up(uint64_t value, uint64_t alignment) {
   return SVFRT_align_down(value - 1, alignment) + alignment;
 }
 
-void SVFRT_read_message(
+// Validate the header, and find the schema and data ranges. The schema range is
+// empty, if the schema was not included in the message. The message must be
+// wide exactly when `wide` is set, see #wide-messages.
+static
+SVFRT_ErrorCode SVFRT_read_header_any(
   SVFRT_ReadMessageParams *params,
-  SVFRT_ReadMessageResult *out_result,
-  SVFRT_Bytes message,
-  SVFRT_Bytes scratch
+  SVFRT_Bytes64 message,
+  bool wide,
+  uint64_t *out_schema_content_hash,
+  SVFRT_Bytes *out_schema_range,
+  SVFRT_Bytes64 *out_data_range
 ) {
-  out_result->error_code = 0;
-  out_result->entry = NULL;
-  out_result->allocation = NULL;
-  out_result->compatibility_level = SVFRT_compatibility_none;
-
-  if (params->required_level == SVFRT_compatibility_logical && !params->allocator_fn) {
-    out_result->error_code = SVFRT_code_read__no_allocator_function;
-    return;
-  }
-
   if (message.count < sizeof(SVFRT_MessageHeader)) {
-    out_result->error_code = SVFRT_code_read__header_too_small;
-    return;
+    return SVFRT_code_read__header_too_small;
   }
 
   if (((uintptr_t) message.pointer) % SVFRT_MESSAGE_PART_ALIGNMENT != 0) {
-    out_result->error_code = SVFRT_code_read__header_not_aligned;
-    return;
+    return SVFRT_code_read__header_not_aligned;
   }
 
   SVFRT_MessageHeader *header = (SVFRT_MessageHeader *) message.pointer;
@@ -50,21 +44,28 @@ void SVFRT_read_message(
     || header->magic[1] != 'V'
     || header->magic[2] != 'F'
   ) {
-    out_result->error_code = SVFRT_code_read__header_magic_mismatch;
-    return;
+    return SVFRT_code_read__header_magic_mismatch;
   }
 
   // For now, versions must match exactly. Version 0 is for development only and
   // does not come with any guarantees.
   if (header->version != 0) {
-    out_result->error_code = SVFRT_code_read__header_version_mismatch;
-    return;
+    return SVFRT_code_read__header_version_mismatch;
+  }
+
+  // References and sequences have a different size in wide messages, so they
+  // can't be read the other way.
+  bool is_wide = (header->flags & SVFRT_MESSAGE_FLAG_WIDE) != 0;
+  if (is_wide && !wide) {
+    return SVFRT_code_read__wide_message;
+  }
+  if (!is_wide && wide) {
+    return SVFRT_code_read__not_wide_message;
   }
 
   // Make sure the declared entry is the same as we expect.
   if (header->entry_struct_id != params->entry_struct_id) {
-    out_result->error_code = SVFRT_code_read__entry_struct_id_mismatch;
-    return;
+    return SVFRT_code_read__entry_struct_id_mismatch;
   }
 
   // Prevent addition overflow by casting operands to `uint64_t` first.
@@ -77,50 +78,108 @@ void SVFRT_read_message(
   );
 
   // Make sure everything is in-bounds.
-  if (appendix_padded_end_offset > (uint64_t) message.count) {
-    out_result->error_code = SVFRT_code_read__bad_schema_length;
-    return;
+  if (appendix_padded_end_offset > message.count) {
+    return SVFRT_code_read__bad_schema_length;
   }
 
   // We now have a valid schema and data ranges. The data range is implicit,
   // from the padded end of the appendix, to the end of the message.
-  SVFRT_Bytes schema_range = {
-    /*.pointer =*/ message.pointer + sizeof(SVFRT_MessageHeader),
-    /*.count =*/ header->schema_length,
-  };
-  SVFRT_Bytes data_range = {
-    /*.pointer =*/ message.pointer + appendix_padded_end_offset,
-    /*.count =*/ message.count - (uint32_t) appendix_padded_end_offset,
+  out_schema_range->pointer = message.pointer + sizeof(SVFRT_MessageHeader);
+  out_schema_range->count = header->schema_length;
+  out_data_range->pointer = message.pointer + appendix_padded_end_offset;
+  out_data_range->count = message.count - appendix_padded_end_offset;
+  *out_schema_content_hash = header->schema_content_hash;
+  return 0;
+}
+
+static
+SVFRT_ErrorCode SVFRT_read_header(
+  SVFRT_ReadMessageParams *params,
+  SVFRT_Bytes message,
+  uint64_t *out_schema_content_hash,
+  SVFRT_Bytes *out_schema_range,
+  SVFRT_Bytes *out_data_range
+) {
+  SVFRT_Bytes64 message64 = {
+    /*.pointer =*/ message.pointer,
+    /*.count =*/ message.count,
   };
+  SVFRT_Bytes64 data_range = {0};
+  SVFRT_ErrorCode error_code = SVFRT_read_header_any(
+    params,
+    message64,
+    false, // `wide`.
+    out_schema_content_hash,
+    out_schema_range,
+    &data_range
+  );
+
+  // Can't be larger than the message.
+  out_data_range->pointer = data_range.pointer;
+  out_data_range->count = (uint32_t) data_range.count;
+  return error_code;
+}
+
+// Decide on the compatibility level of the message schema: via the quick path,
+// via the cache, or by checking it in `scratch`. If `scratch` is NULL, the
+// latter is not possible, and fails with `SVFRT_code_read__batch_scratch_in_use`.
+//
+// `*out_used_scratch` is set, if the result refers to scratch memory. If the
+// schema was looked up, `*inout_schema_range` is set to it.
+static
+void SVFRT_read_check(
+  SVFRT_ReadMessageParams *params,
+  SVFRT_CompatibilityResult *out_check_result,
+  bool *out_used_scratch,
+  uint64_t schema_content_hash,
+  SVFRT_Bytes *inout_schema_range,
+  SVFRT_Bytes *scratch
+) {
+  *out_used_scratch = false;
 
+  SVFRT_Bytes schema_range = *inout_schema_range;
   if (schema_range.count == 0) {
     // Only a reference to the schema is available, so we have to rely on the
     // user-provided lookup function.
 
     if (!params->schema_lookup_fn) {
-      out_result->error_code = SVFRT_code_read__no_schema_lookup_function;
+      out_check_result->error_code = SVFRT_code_read__no_schema_lookup_function;
       return;
     }
 
-    schema_range = params->schema_lookup_fn(params->schema_lookup_ptr, header->schema_content_hash);
+    schema_range = params->schema_lookup_fn(params->schema_lookup_ptr, schema_content_hash);
 
     if (!schema_range.pointer) {
-      out_result->error_code = SVFRT_code_read__schema_lookup_failed;
+      out_check_result->error_code = SVFRT_code_read__schema_lookup_failed;
       return;
     }
-  }
 
-  SVFRT_CompatibilityResult check_result = {0};
+    *inout_schema_range = schema_range;
+  }
 
-  if (params->expected_schema_content_hash == header->schema_content_hash) {
+  if (params->expected_schema_content_hash == schema_content_hash) {
     // Quick path.
-    check_result.level = SVFRT_compatibility_exact;
-    check_result.quirky_struct_strides_dst = params->expected_schema_struct_strides;
+    out_check_result->level = SVFRT_compatibility_exact;
+    out_check_result->quirky_struct_strides_dst = params->expected_schema_struct_strides;
+  } else if (params->compatibility_cache && SVFRT_compatibility_cache_lookup(
+    params->compatibility_cache,
+    out_check_result,
+    schema_range,
+    params->expected_schema,
+    schema_content_hash,
+    params->expected_schema_content_hash,
+    params->entry_struct_id,
+    params->required_level,
+    params->max_schema_work
+  )) {
+    // Cached path, `out_check_result` is already filled.
+  } else if (!scratch) {
+    out_check_result->error_code = SVFRT_code_read__batch_scratch_in_use;
   } else {
     // Slow path.
     SVFRT_check_compatibility(
-      &check_result,
-      scratch,
+      out_check_result,
+      *scratch,
       schema_range,
       params->expected_schema,
       params->entry_struct_id,
@@ -128,24 +187,125 @@ void SVFRT_read_message(
       SVFRT_compatibility_exact, // `sufficient_level`.
       params->max_schema_work
     );
+    *out_used_scratch = true;
+
+    if (params->compatibility_cache) {
+      // Failing to cache is not an error, e.g. when the cache is full.
+      SVFRT_compatibility_cache_insert(
+        params->compatibility_cache,
+        out_check_result,
+        schema_range,
+        params->expected_schema,
+        schema_content_hash,
+        params->expected_schema_content_hash,
+        params->entry_struct_id,
+        params->required_level,
+        params->max_schema_work
+      );
+    }
   }
+}
 
+// Returns false, and sets the error, if the compatibility check failed. Shared
+// between the regular and the wide results, so it takes their fields.
+static
+bool SVFRT_read_check_level(
+  SVFRT_ErrorCode *out_error_code,
+  SVFRT_CompatibilityLevel *out_compatibility_level,
+  SVFRT_CompatibilityResult *check_result
+) {
   // Set this here in case of early exits.
-  out_result->compatibility_level = check_result.level;
+  *out_compatibility_level = check_result->level;
 
-  if (check_result.error_code != 0) {
-    out_result->error_code = check_result.error_code;
-    return;
+  if (check_result->error_code != 0) {
+    *out_error_code = check_result->error_code;
+    return false;
   }
 
-  if (check_result.level == 0) {
+  if (check_result->level == 0) {
     // No compatibility, but `error_code` was not set, which should not happen.
-    out_result->error_code = SVFRT_code_compatibility_internal__unknown;
+    *out_error_code = SVFRT_code_compatibility_internal__unknown;
+    return false;
+  }
+
+  return true;
+}
+
+// The entry is read in place as the dst-struct, see #natural-alignment. The
+// expected schema was already checked for compatibility, so it is valid.
+static
+uint32_t SVFRT_read_entry_alignment(SVFRT_ReadMessageParams *params) {
+  SVF_Meta_SchemaDefinition *definition_dst = SVFRT_internal_schema_definition(params->expected_schema);
+  SVFRT_RangeStructDefinition structs_dst = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
+    params->expected_schema,
+    definition_dst->structs,
+    SVF_Meta_StructDefinition
+  );
+  return structs_dst.pointer[params->entry_struct_index].alignment;
+}
+
+// Locate the entry in the final data range, after the conversion, if any.
+static
+void SVFRT_read_locate_entry(
+  SVFRT_ReadMessageParams *params,
+  SVFRT_ReadMessageResult *out_result,
+  SVFRT_CompatibilityResult *check_result,
+  SVFRT_Bytes final_data_range
+) {
+  // For at least binary compatibility, this will be the size of the entry in
+  // the dst-schema. However, for logical compatibility, this will be the size
+  // of the entry in the src-schema.
+  //
+  // This is non-obvious. See #logical-compatibility-stride-quirk.
+  uint32_t entry_size = check_result->quirky_struct_strides_dst.pointer[params->entry_struct_index];
+
+  if (final_data_range.count < entry_size) {
+    out_result->error_code = SVFRT_code_read__data_too_small;
+    return;
+  }
+
+  uint32_t entry_alignment = SVFRT_read_entry_alignment(params);
+
+  uint32_t final_entry_offset = (uint32_t) SVFRT_align_down(
+    final_data_range.count - entry_size,
+    entry_alignment
+  );
+
+  uint8_t *entry = final_data_range.pointer + final_entry_offset;
+  if (((uintptr_t) entry) % entry_alignment != 0) {
+    out_result->error_code = SVFRT_code_read__entry_not_aligned;
+    return;
+  }
+
+  out_result->entry = (void *) entry;
+
+  if (check_result->level == SVFRT_compatibility_logical) {
+    out_result->allocation = final_data_range.pointer;
+  }
+
+  // `out_result->compatibility_level` is already set in `SVFRT_read_check_level`.
+
+  out_result->context.data_range = final_data_range;
+  out_result->context.struct_strides = check_result->quirky_struct_strides_dst;
+}
+
+// Everything after the compatibility decision: conversion, if needed, and
+// locating the entry.
+static
+void SVFRT_read_finish(
+  SVFRT_ReadMessageParams *params,
+  SVFRT_ReadMessageResult *out_result,
+  SVFRT_CompatibilityResult *check_result,
+  SVFRT_Bytes data_range,
+  SVFRT_Bytes conversion_stack,
+  SVFRT_Bytes conversion_memo
+) {
+  if (!SVFRT_read_check_level(&out_result->error_code, &out_result->compatibility_level, check_result)) {
     return;
   }
 
   SVFRT_Bytes final_data_range = data_range;
-  if (check_result.level == SVFRT_compatibility_logical) {
+  if (check_result->level == SVFRT_compatibility_logical) {
     // We have to convert the message.
 
     // `params->allocator_fn` has already been checked to be non-null, see
@@ -154,10 +314,16 @@ void SVFRT_read_message(
     SVFRT_ConversionResult conversion_result = {0};
     SVFRT_convert_message(
       &conversion_result,
-      &check_result,
+      check_result,
       data_range,
       params->max_recursion_depth,
       params->max_output_size,
+      params->single_pass_conversion,
+      conversion_stack,
+      conversion_memo,
+      params->conversion_spawn_fn,
+      params->conversion_spawn_ptr,
+      params->conversion_task_count,
       params->allocator_fn,
       params->allocator_ptr
     );
@@ -171,38 +337,714 @@ void SVFRT_read_message(
     final_data_range = conversion_result.output_bytes;
   }
 
-  // For at least binary compatibility, this will be the size of the entry in
-  // the dst-schema. However, for logical compatibility, this will be the size
-  // of the entry in the src-schema.
-  //
-  // This is non-obvious. See #logical-compatibility-stride-quirk.
-  uint32_t entry_size = check_result.quirky_struct_strides_dst.pointer[params->entry_struct_index];
+  SVFRT_read_locate_entry(params, out_result, check_result, final_data_range);
+}
 
-  if (final_data_range.count < entry_size) {
-    out_result->error_code = SVFRT_code_read__data_too_small;
+// Find a converter for the message, see #generated-conversion. Returns NULL,
+// if it should be checked and converted as usual instead. If the schema was
+// looked up, `*inout_schema_range` is set to it, same as in `SVFRT_read_check`.
+static
+SVFRT_GeneratedConverter const *SVFRT_read_find_converter(
+  SVFRT_ReadMessageParams *params,
+  uint64_t schema_content_hash,
+  SVFRT_Bytes *inout_schema_range
+) {
+  if (
+    !params->converter_table ||
+    params->required_level != SVFRT_compatibility_logical ||
+    params->conversion_memo.pointer ||
+    // The quick path is faster still.
+    params->expected_schema_content_hash == schema_content_hash
+  ) {
+    return NULL;
+  }
+
+  SVFRT_Bytes schema_range = *inout_schema_range;
+  if (schema_range.count == 0) {
+    if (!params->schema_lookup_fn) {
+      return NULL;
+    }
+
+    schema_range = params->schema_lookup_fn(params->schema_lookup_ptr, schema_content_hash);
+    if (!schema_range.pointer) {
+      return NULL;
+    }
+
+    *inout_schema_range = schema_range;
+  }
+
+  return SVFRT_converter_table_find(
+    params->converter_table,
+    schema_range,
+    schema_content_hash,
+    params->expected_schema_content_hash,
+    params->entry_struct_id
+  );
+}
+
+// Same as `SVFRT_read_finish`, but with a converter instead of a compatibility
+// result.
+static
+void SVFRT_read_finish_generated(
+  SVFRT_ReadMessageParams *params,
+  SVFRT_ReadMessageResult *out_result,
+  SVFRT_GeneratedConverter const *converter,
+  SVFRT_Bytes data_range
+) {
+  // The schemas were checked by svfc, and need a logical conversion.
+  out_result->compatibility_level = SVFRT_compatibility_logical;
+
+  SVFRT_ConversionResult conversion_result = {0};
+  SVFRT_convert_message_generated(
+    &conversion_result,
+    converter,
+    data_range,
+    params->max_recursion_depth,
+    params->max_output_size,
+    params->allocator_fn,
+    params->allocator_ptr
+  );
+
+  if (!conversion_result.success) {
+    out_result->allocation = conversion_result.output_bytes.pointer;
+    out_result->error_code = conversion_result.error_code;
     return;
   }
 
-  // TODO @proper-alignment: struct access.
-  uint32_t entry_alignment = 1;
+  // The output is laid out in the dst-schema, see #logical-compatibility-stride-quirk.
+  SVFRT_CompatibilityResult check_result = {0};
+  check_result.level = SVFRT_compatibility_logical;
+  check_result.quirky_struct_strides_dst = params->expected_schema_struct_strides;
+  SVFRT_read_locate_entry(params, out_result, &check_result, conversion_result.output_bytes);
+}
 
-  uint32_t final_entry_offset = (uint32_t) SVFRT_align_down(
-    final_data_range.count - entry_size,
-    entry_alignment
+static inline
+void SVFRT_read_reset_result(SVFRT_ReadMessageResult *out_result) {
+  out_result->error_code = 0;
+  out_result->entry = NULL;
+  out_result->allocation = NULL;
+  out_result->compatibility_level = SVFRT_compatibility_none;
+}
+
+void SVFRT_read_message(
+  SVFRT_ReadMessageParams *params,
+  SVFRT_ReadMessageResult *out_result,
+  SVFRT_Bytes message,
+  SVFRT_Bytes scratch
+) {
+  SVFRT_read_reset_result(out_result);
+
+  if (params->required_level == SVFRT_compatibility_logical && !params->allocator_fn) {
+    out_result->error_code = SVFRT_code_read__no_allocator_function;
+    return;
+  }
+
+  uint64_t schema_content_hash = 0;
+  SVFRT_Bytes schema_range = {0};
+  SVFRT_Bytes data_range = {0};
+  SVFRT_ErrorCode error_code = SVFRT_read_header(
+    params,
+    message,
+    &schema_content_hash,
+    &schema_range,
+    &data_range
   );
+  if (error_code != 0) {
+    out_result->error_code = error_code;
+    return;
+  }
+
+  SVFRT_GeneratedConverter const *converter = SVFRT_read_find_converter(params, schema_content_hash, &schema_range);
+  if (converter) {
+    SVFRT_read_finish_generated(params, out_result, converter, data_range);
+    return;
+  }
+
+  SVFRT_CompatibilityResult check_result = {0};
+  bool used_scratch = false;
+  SVFRT_read_check(params, &check_result, &used_scratch, schema_content_hash, &schema_range, &scratch);
+  SVFRT_read_finish(params, out_result, &check_result, data_range, params->conversion_stack, params->conversion_memo);
+}
+
+// #resumable-read.
+//
+// The compatibility result is copied into the state, since the conversion
+// refers to it, and `SVFRT_read_check` only fills a local one.
+
+typedef struct SVFRT_ResumableReadState {
+  SVFRT_CompatibilityResult check_result;
+  SVFRT_ResumableConversion *conversion; // NULL, unless converting.
+} SVFRT_ResumableReadState;
+
+#define SVFRT_RESUMABLE_READ_ALIGNMENT 8
+
+#define SVFRT_RESUMABLE_READ_STATE_SIZE \
+  ((sizeof(SVFRT_ResumableReadState) + SVFRT_RESUMABLE_READ_ALIGNMENT - 1) \
+    / SVFRT_RESUMABLE_READ_ALIGNMENT * SVFRT_RESUMABLE_READ_ALIGNMENT)
+
+uint32_t SVFRT_resumable_read_memory_size(uint32_t max_recursion_depth) {
+  uint64_t size = (uint64_t) (SVFRT_RESUMABLE_READ_ALIGNMENT - 1) + SVFRT_RESUMABLE_READ_STATE_SIZE;
+  size += SVFRT_resumable_conversion_size(max_recursion_depth);
+  if (size > (uint64_t) UINT32_MAX) {
+    return UINT32_MAX;
+  }
+  return (uint32_t) size;
+}
 
-  out_result->entry = (void *) (final_data_range.pointer + final_entry_offset);
+void SVFRT_read_message_begin(
+  SVFRT_ResumableRead *out_read,
+  SVFRT_ReadMessageParams *params,
+  SVFRT_Bytes message,
+  SVFRT_Bytes scratch,
+  SVFRT_Bytes memory
+) {
+  out_read->params = params;
+  out_read->state = NULL;
+  out_read->done = true;
+  SVFRT_read_reset_result(&out_read->result);
+  SVFRT_ReadMessageResult *out_result = &out_read->result;
+
+  if (params->required_level == SVFRT_compatibility_logical && !params->allocator_fn) {
+    out_result->error_code = SVFRT_code_read__no_allocator_function;
+    return;
+  }
+
+  uintptr_t misalignment = ((uintptr_t) memory.pointer) % SVFRT_RESUMABLE_READ_ALIGNMENT;
+  uint32_t padding = misalignment ? (uint32_t) (SVFRT_RESUMABLE_READ_ALIGNMENT - misalignment) : 0;
+  if (!memory.pointer || memory.count < padding + SVFRT_RESUMABLE_READ_STATE_SIZE) {
+    out_result->error_code = SVFRT_code_read__not_enough_resumable_memory;
+    return;
+  }
+
+  SVFRT_ResumableReadState *state = (SVFRT_ResumableReadState *) (memory.pointer + padding);
+  SVFRT_MEMSET(state, 0, sizeof(*state));
+  out_read->state = state;
+
+  uint64_t schema_content_hash = 0;
+  SVFRT_Bytes schema_range = {0};
+  SVFRT_Bytes data_range = {0};
+  SVFRT_ErrorCode error_code = SVFRT_read_header(
+    params,
+    message,
+    &schema_content_hash,
+    &schema_range,
+    &data_range
+  );
+  if (error_code != 0) {
+    out_result->error_code = error_code;
+    return;
+  }
+
+  bool used_scratch = false;
+  SVFRT_read_check(params, &state->check_result, &used_scratch, schema_content_hash, &schema_range, &scratch);
+  if (!SVFRT_read_check_level(&out_result->error_code, &out_result->compatibility_level, &state->check_result)) {
+    return;
+  }
+
+  if (state->check_result.level != SVFRT_compatibility_logical) {
+    SVFRT_read_locate_entry(params, out_result, &state->check_result, data_range);
+    return;
+  }
+
+  SVFRT_Bytes conversion_memory = {
+    /*.pointer =*/ memory.pointer + padding + SVFRT_RESUMABLE_READ_STATE_SIZE,
+    /*.count =*/ memory.count - padding - (uint32_t) SVFRT_RESUMABLE_READ_STATE_SIZE,
+  };
+  SVFRT_ConversionResult conversion_result = {0};
+  state->conversion = SVFRT_convert_message_begin(
+    &conversion_result,
+    &state->check_result,
+    data_range,
+    params->max_recursion_depth,
+    params->max_output_size,
+    conversion_memory,
+    params->conversion_memo,
+    params->allocator_fn,
+    params->allocator_ptr
+  );
+  if (!state->conversion) {
+    out_result->error_code = SVFRT_code_read__not_enough_resumable_memory;
+    return;
+  }
+
+  out_read->done = false;
+}
+
+bool SVFRT_read_message_step(SVFRT_ResumableRead *read, uint32_t budget) {
+  if (read->done) {
+    return true;
+  }
+
+  SVFRT_ResumableReadState *state = (SVFRT_ResumableReadState *) read->state;
+  SVFRT_ConversionResult conversion_result = {0};
+  if (!SVFRT_convert_message_step(state->conversion, &conversion_result, budget)) {
+    // Let the caller free the allocation, if they give up before it's done.
+    read->result.allocation = conversion_result.output_bytes.pointer;
+    return false;
+  }
+
+  read->done = true;
+  if (!conversion_result.success) {
+    read->result.allocation = conversion_result.output_bytes.pointer;
+    read->result.error_code = conversion_result.error_code;
+    return true;
+  }
+
+  SVFRT_read_locate_entry(read->params, &read->result, &state->check_result, conversion_result.output_bytes);
+  return true;
+}
+
+void SVFRT_read_message_finish(SVFRT_ResumableRead *read, SVFRT_ReadMessageResult *out_result) {
+  while (!SVFRT_read_message_step(read, UINT32_MAX)) {
+    // Keep going.
+  }
+  *out_result = read->result;
+}
+
+// #lazy-view.
+//
+// Only the compatibility check happens here. The state lives in the caller's
+// memory, since views refer to it, see `svf_view.c`.
+
+#define SVFRT_LAZY_READ_ALIGNMENT 8
+
+#define SVFRT_LAZY_READ_STATE_SIZE \
+  ((sizeof(SVFRT_LazyReadState) + SVFRT_LAZY_READ_ALIGNMENT - 1) \
+    / SVFRT_LAZY_READ_ALIGNMENT * SVFRT_LAZY_READ_ALIGNMENT)
+
+uint32_t SVFRT_lazy_read_memory_size(uint32_t memo_count) {
+  uint64_t size = (uint64_t) (SVFRT_LAZY_READ_ALIGNMENT - 1) + SVFRT_LAZY_READ_STATE_SIZE;
+  size += (uint64_t) memo_count * sizeof(SVFRT_LazyMemoEntry);
+  if (size > (uint64_t) UINT32_MAX) {
+    return UINT32_MAX;
+  }
+  return (uint32_t) size;
+}
+
+void SVFRT_read_message_lazy(
+  SVFRT_LazyRead *out_read,
+  SVFRT_ReadMessageParams *params,
+  SVFRT_Bytes message,
+  SVFRT_Bytes scratch,
+  SVFRT_Bytes memory
+) {
+  out_read->error_code = 0;
+  out_read->compatibility_level = SVFRT_compatibility_none;
+  out_read->entry.read = out_read;
+  out_read->entry.data_offset = 0;
+  out_read->entry.unsafe_struct_index_src = UINT32_MAX;
+  out_read->entry.struct_index_dst = params->entry_struct_index;
+  out_read->state = NULL;
+
+  uintptr_t misalignment = ((uintptr_t) memory.pointer) % SVFRT_LAZY_READ_ALIGNMENT;
+  uint32_t padding = misalignment ? (uint32_t) (SVFRT_LAZY_READ_ALIGNMENT - misalignment) : 0;
+  if (!memory.pointer || memory.count < padding + SVFRT_LAZY_READ_STATE_SIZE) {
+    out_read->error_code = SVFRT_code_read__not_enough_lazy_memory;
+    return;
+  }
+
+  SVFRT_LazyReadState *state = (SVFRT_LazyReadState *) (memory.pointer + padding);
+  SVFRT_MEMSET(state, 0, sizeof(*state));
+  out_read->state = state;
+
+  uint32_t memo_capacity = (uint32_t) (
+    (memory.count - padding - SVFRT_LAZY_READ_STATE_SIZE) / sizeof(SVFRT_LazyMemoEntry)
+  );
+  if (memo_capacity) {
+    state->memo = (SVFRT_LazyMemoEntry *) (memory.pointer + padding + SVFRT_LAZY_READ_STATE_SIZE);
+    state->memo_capacity = memo_capacity;
+    SVFRT_MEMSET(state->memo, 0, memo_capacity * sizeof(SVFRT_LazyMemoEntry));
+  }
+
+  uint64_t schema_content_hash = 0;
+  SVFRT_Bytes schema_range = {0};
+  SVFRT_Bytes data_range = {0};
+  SVFRT_ErrorCode error_code = SVFRT_read_header(
+    params,
+    message,
+    &schema_content_hash,
+    &schema_range,
+    &data_range
+  );
+  if (error_code != 0) {
+    out_read->error_code = error_code;
+    return;
+  }
 
+  bool used_scratch = false;
+  SVFRT_read_check(params, &state->check_result, &used_scratch, schema_content_hash, &schema_range, &scratch);
+
+  if (!SVFRT_read_check_level(&out_read->error_code, &out_read->compatibility_level, &state->check_result)) {
+    return;
+  }
+
+  SVFRT_lazy_read_init(out_read, state, params, data_range);
+}
+
+// #wide-messages.
+//
+// Same as `SVFRT_read_message`, except that logical conversions are done by
+// #wide-conversion, which has none of the optional conversion parameters.
+// Otherwise, the data is never copied, so a wide message can be read directly
+// from a mapping of a file that is larger than `UINT32_MAX` bytes.
+void SVFRT_read_message64(
+  SVFRT_ReadMessageParams *params,
+  SVFRT_ReadMessageResult64 *out_result,
+  SVFRT_Bytes64 message,
+  SVFRT_Bytes scratch
+) {
+  out_result->error_code = 0;
+  out_result->entry = NULL;
+  out_result->allocation = NULL;
+  out_result->compatibility_level = SVFRT_compatibility_none;
+
+  if (params->required_level == SVFRT_compatibility_logical && !params->allocator_fn) {
+    out_result->error_code = SVFRT_code_read__no_allocator_function;
+    return;
+  }
+
+  uint64_t schema_content_hash = 0;
+  SVFRT_Bytes schema_range = {0};
+  SVFRT_Bytes64 data_range = {0};
+  SVFRT_ErrorCode error_code = SVFRT_read_header_any(
+    params,
+    message,
+    true, // `wide`.
+    &schema_content_hash,
+    &schema_range,
+    &data_range
+  );
+  if (error_code != 0) {
+    out_result->error_code = error_code;
+    return;
+  }
+
+  SVFRT_CompatibilityResult check_result = {0};
+  bool used_scratch = false;
+  SVFRT_read_check(params, &check_result, &used_scratch, schema_content_hash, &schema_range, &scratch);
+
+  if (!SVFRT_read_check_level(&out_result->error_code, &out_result->compatibility_level, &check_result)) {
+    return;
+  }
+
+  SVFRT_Bytes64 final_data_range = data_range;
   if (check_result.level == SVFRT_compatibility_logical) {
-    out_result->allocation = final_data_range.pointer;
+    // The limit is 32-bit, so for wide messages, `SVFRT_NO_SIZE_LIMIT` really
+    // means no limit.
+    uint64_t max_output_size = (
+      params->max_output_size == SVFRT_NO_SIZE_LIMIT
+        ? UINT64_MAX
+        : (uint64_t) params->max_output_size
+    );
+
+    SVFRT_ConversionResult64 conversion_result = {0};
+    SVFRT_convert_message64(
+      &conversion_result,
+      &check_result,
+      data_range,
+      params->max_recursion_depth,
+      max_output_size,
+      params->allocator_fn,
+      params->allocator_ptr
+    );
+
+    out_result->allocation = conversion_result.output_bytes.pointer;
+    if (!conversion_result.success) {
+      out_result->error_code = conversion_result.error_code;
+      return;
+    }
+
+    final_data_range = conversion_result.output_bytes;
+  }
+
+  // Same as `SVFRT_read_locate_entry`, see #logical-compatibility-stride-quirk.
+  uint32_t entry_size = check_result.quirky_struct_strides_dst.pointer[params->entry_struct_index];
+
+  if (final_data_range.count < entry_size) {
+    out_result->error_code = SVFRT_code_read__data_too_small;
+    return;
   }
 
-  // `out_result->compatibility_level` is already set above.
+  uint8_t *entry = final_data_range.pointer + (size_t) (final_data_range.count - entry_size);
+  if (((uintptr_t) entry) % SVFRT_read_entry_alignment(params) != 0) {
+    out_result->error_code = SVFRT_code_read__entry_not_aligned;
+    return;
+  }
 
+  out_result->entry = (void *) entry;
   out_result->context.data_range = final_data_range;
   out_result->context.struct_strides = check_result.quirky_struct_strides_dst;
 }
 
+// #batch-read.
+//
+// Headers are validated in one loop, and the compatibility decision is made
+// once per distinct schema (up to `SVFRT_READ_BATCH_MAX_SCHEMAS`, then once per
+// message). The hash comes from the message, so it is not trusted to identify
+// the schema: a decision is only shared between messages with the same schema
+// bytes, see `SVFRT_read_batch_find`.
+//
+// Decisions that had to be checked in scratch memory refer to it, so only one
+// such decision can be alive at a time. Others come from the cache, if there is
+// one. Otherwise, the group of messages which refers to scratch is finished
+// first, and its decision is forgotten, so that scratch can be reused. Mixing
+// foreign schemas without a cache may thus check the same schema again.
+//
+// If a spawn function is given (and no conversion memo), logical conversions
+// are deferred, and then run as tasks. Each task finds its decision again by re-reading the (already
+// validated) header, since the decisions are read-only by then.
+
+#define SVFRT_READ_BATCH_MAX_SCHEMAS 8
+
+typedef struct SVFRT_ReadBatchSchema {
+  uint64_t schema_content_hash;
+  SVFRT_Bytes schema_range; // From the header, i.e. empty if it was looked up.
+  SVFRT_CompatibilityResult check_result;
+} SVFRT_ReadBatchSchema;
+
+typedef struct SVFRT_ReadBatch {
+  SVFRT_ReadMessageParams *params;
+  SVFRT_ReadMessageResult *out_results;
+  SVFRT_Bytes const *messages;
+  SVFRT_ReadBatchSchema schemas[SVFRT_READ_BATCH_MAX_SCHEMAS];
+  uint32_t schema_count;
+  bool any_deferred;
+  bool scratch_in_use;
+  uint32_t scratch_schema_index;
+} SVFRT_ReadBatch;
+
+// A decision is shared if the hash matches, and either the hash is trusted (the
+// quick path, or a schema that was looked up by it), or the schema bytes in the
+// header are the same. Otherwise, a made-up schema sent under the hash of a real
+// one would decide for the messages with the real schema, or the other way
+// around, same as described for `SVFRT_CompatibilityCache`.
+static inline
+SVFRT_ReadBatchSchema *SVFRT_read_batch_find(
+  SVFRT_ReadBatch *batch,
+  uint64_t schema_content_hash,
+  SVFRT_Bytes schema_range
+) {
+  for (uint32_t i = 0; i < batch->schema_count; i++) {
+    SVFRT_ReadBatchSchema *schema = batch->schemas + i;
+    if (schema->schema_content_hash != schema_content_hash) {
+      continue;
+    }
+
+    if (schema_content_hash == batch->params->expected_schema_content_hash) {
+      return schema;
+    }
+
+    if (
+      schema->schema_range.count == schema_range.count
+      && (schema_range.count == 0 || SVFRT_MEMCMP(schema->schema_range.pointer, schema_range.pointer, schema_range.count) == 0)
+    ) {
+      return schema;
+    }
+  }
+  return NULL;
+}
+
+static inline
+bool SVFRT_read_batch_is_deferred(SVFRT_ReadMessageResult *result) {
+  return (1
+    && result->error_code == 0
+    && result->entry == NULL
+    && result->compatibility_level == SVFRT_compatibility_logical
+  );
+}
+
+static
+void SVFRT_read_batch_task(void *task_ptr, uint32_t task_index) {
+  SVFRT_ReadBatch *batch = (SVFRT_ReadBatch *) task_ptr;
+  SVFRT_ReadMessageResult *out_result = batch->out_results + task_index;
+  if (!SVFRT_read_batch_is_deferred(out_result)) {
+    return;
+  }
+
+  uint64_t schema_content_hash = 0;
+  SVFRT_Bytes schema_range = {0};
+  SVFRT_Bytes data_range = {0};
+  SVFRT_ErrorCode error_code = SVFRT_read_header(
+    batch->params,
+    batch->messages[task_index],
+    &schema_content_hash,
+    &schema_range,
+    &data_range
+  );
+
+  // Only decisions in the table are deferred.
+  SVFRT_ReadBatchSchema *schema = SVFRT_read_batch_find(batch, schema_content_hash, schema_range);
+  if (error_code != 0 || !schema) {
+    out_result->error_code = SVFRT_code_compatibility_internal__unknown;
+    return;
+  }
+
+  // The conversion stack and memo can't be shared between tasks. Messages are
+  // not deferred when there is a memo, see `SVFRT_read_messages`.
+  SVFRT_Bytes no_stack = {0};
+  SVFRT_Bytes no_memo = {0};
+  SVFRT_read_finish(batch->params, out_result, &schema->check_result, data_range, no_stack, no_memo);
+}
+
+// Finish the messages before `message_index` which were deferred, and forget
+// the decision which refers to scratch, so that it can be reused.
+static
+void SVFRT_read_batch_release_scratch(
+  SVFRT_ReadBatch *batch,
+  uint32_t message_index,
+  SVFRT_SpawnTasksFn *spawn_fn,
+  void *spawn_ptr
+) {
+  if (batch->any_deferred) {
+    spawn_fn(spawn_ptr, SVFRT_read_batch_task, batch, message_index);
+    batch->any_deferred = false;
+  }
+
+  if (batch->scratch_in_use) {
+    // Nothing refers to the table entries between messages, so the order does
+    // not need to be kept. Only this entry is ever removed, so its index stays
+    // valid until then.
+    batch->schema_count--;
+    batch->schemas[batch->scratch_schema_index] = batch->schemas[batch->schema_count];
+  }
+
+  batch->scratch_in_use = false;
+}
+
+void SVFRT_read_messages(
+  SVFRT_ReadMessageParams *params,
+  SVFRT_ReadMessageResult *out_results,
+  SVFRT_Bytes const *messages,
+  uint32_t message_count,
+  SVFRT_Bytes scratch,
+  SVFRT_SpawnTasksFn *spawn_fn,
+  void *spawn_ptr
+) {
+  SVFRT_ReadBatch batch_value = {0};
+  SVFRT_ReadBatch *batch = &batch_value;
+  batch->params = params;
+  batch->out_results = out_results;
+  batch->messages = messages;
+
+  for (uint32_t i = 0; i < message_count; i++) {
+    SVFRT_ReadMessageResult *out_result = out_results + i;
+    SVFRT_read_reset_result(out_result);
+
+    if (params->required_level == SVFRT_compatibility_logical && !params->allocator_fn) {
+      out_result->error_code = SVFRT_code_read__no_allocator_function;
+      continue;
+    }
+
+    uint64_t schema_content_hash = 0;
+    SVFRT_Bytes schema_range = {0};
+    SVFRT_Bytes data_range = {0};
+    SVFRT_ErrorCode error_code = SVFRT_read_header(
+      params,
+      messages[i],
+      &schema_content_hash,
+      &schema_range,
+      &data_range
+    );
+    if (error_code != 0) {
+      out_result->error_code = error_code;
+      continue;
+    }
+
+    // `SVFRT_read_check` replaces `schema_range` with the looked-up one.
+    SVFRT_Bytes header_schema_range = schema_range;
+
+    SVFRT_CompatibilityResult local_check_result = {0};
+    SVFRT_CompatibilityResult *check_result = NULL;
+    SVFRT_ReadBatchSchema *schema = SVFRT_read_batch_find(batch, schema_content_hash, header_schema_range);
+    if (schema) {
+      check_result = &schema->check_result;
+    } else {
+      bool used_scratch = false;
+      SVFRT_read_check(
+        params,
+        &local_check_result,
+        &used_scratch,
+        schema_content_hash,
+        &schema_range,
+        batch->scratch_in_use ? NULL : &scratch
+      );
+
+      if (local_check_result.error_code == SVFRT_code_read__batch_scratch_in_use) {
+        SVFRT_read_batch_release_scratch(batch, i, spawn_fn, spawn_ptr);
+
+        SVFRT_CompatibilityResult zero_check_result = {0};
+        local_check_result = zero_check_result;
+        SVFRT_read_check(
+          params,
+          &local_check_result,
+          &used_scratch,
+          schema_content_hash,
+          &schema_range,
+          &scratch
+        );
+      }
+
+      if (used_scratch && local_check_result.error_code == 0 && params->compatibility_cache) {
+        // Prefer the cached copy, so that scratch stays available.
+        SVFRT_CompatibilityResult cached_check_result = {0};
+        if (SVFRT_compatibility_cache_lookup(
+          params->compatibility_cache,
+          &cached_check_result,
+          schema_range,
+          params->expected_schema,
+          schema_content_hash,
+          params->expected_schema_content_hash,
+          params->entry_struct_id,
+          params->required_level,
+          params->max_schema_work
+        )) {
+          local_check_result = cached_check_result;
+          used_scratch = false;
+        }
+      }
+
+      // Lookup failures are not remembered, since they are not decisions.
+      bool is_lookup_failure = (
+        local_check_result.error_code == SVFRT_code_read__no_schema_lookup_function
+        || local_check_result.error_code == SVFRT_code_read__schema_lookup_failed
+      );
+
+      if (!is_lookup_failure && batch->schema_count < SVFRT_READ_BATCH_MAX_SCHEMAS) {
+        schema = batch->schemas + batch->schema_count;
+        batch->schema_count++;
+        schema->schema_content_hash = schema_content_hash;
+        schema->schema_range = header_schema_range;
+        schema->check_result = local_check_result;
+        check_result = &schema->check_result;
+
+        if (used_scratch) {
+          batch->scratch_in_use = true;
+          batch->scratch_schema_index = batch->schema_count - 1;
+        }
+      } else {
+        // Not remembered, so scratch is free again after this message.
+        check_result = &local_check_result;
+      }
+    }
+
+    // The memo can't be shared between tasks, and without it, messages with
+    // sharing would fail, so they are finished right here instead.
+    bool can_defer = spawn_fn && schema && !params->conversion_memo.pointer;
+    if (can_defer && check_result->error_code == 0 && check_result->level == SVFRT_compatibility_logical) {
+      // Defer, see `SVFRT_read_batch_is_deferred`.
+      out_result->compatibility_level = SVFRT_compatibility_logical;
+      batch->any_deferred = true;
+      continue;
+    }
+
+    SVFRT_read_finish(params, out_result, check_result, data_range, params->conversion_stack, params->conversion_memo);
+  }
+
+  if (batch->any_deferred) {
+    spawn_fn(spawn_ptr, SVFRT_read_batch_task, batch, message_count);
+  }
+}
+
 SVFRT_ErrorCode SVFRT_write_part_padding(
   SVFRT_WriterFn *writer_fn,
   void *writer_ptr,
@@ -224,10 +1066,11 @@ SVFRT_ErrorCode SVFRT_write_part_padding(
   return 0;
 }
 
-void SVFRT_write_start(
-  SVFRT_WriteContext *result,
+static
+SVFRT_ErrorCode SVFRT_write_header(
   SVFRT_WriterFn *writer_fn,
   void *writer_ptr,
+  uint8_t flags,
   uint64_t schema_content_hash,
   SVFRT_Bytes schema_bytes,
   SVFRT_Bytes appendix_bytes,
@@ -236,6 +1079,7 @@ void SVFRT_write_start(
   SVFRT_MessageHeader header = {
     /*.magic =*/ { 'S', 'V', 'F' },
     /*.version =*/ 0,
+    /*.flags =*/ flags,
     /*._reserved =*/ {0},
     /*.schema_length =*/ schema_bytes.count,
     /*.appendix_length =*/ appendix_bytes.count,
@@ -273,7 +1117,277 @@ void SVFRT_write_start(
     }
   }
 
-  result->error_code = error_code;
+  return error_code;
+}
+
+void SVFRT_write_start(
+  SVFRT_WriteContext *result,
+  SVFRT_WriterFn *writer_fn,
+  void *writer_ptr,
+  uint64_t schema_content_hash,
+  SVFRT_Bytes schema_bytes,
+  SVFRT_Bytes appendix_bytes,
+  uint64_t entry_struct_id
+) {
+  result->error_code = SVFRT_write_header(
+    writer_fn,
+    writer_ptr,
+    0, // `flags`.
+    schema_content_hash,
+    schema_bytes,
+    appendix_bytes,
+    entry_struct_id
+  );
+  result->finished = false;
+  result->writer_ptr = writer_ptr;
+  result->writer_fn = writer_fn;
+  result->data_bytes_written = 0;
+  result->buffer.pointer = NULL;
+  result->buffer.count = 0;
+  result->buffer_used = 0;
+  result->grow_fn = NULL;
+  result->grow_ptr = NULL;
+}
+
+// #buffered-writing.
+//
+// The buffer takes the place of `writer_fn` for all the writing functions,
+// including the header, so this is how header bytes get into the buffer.
+static
+uint32_t SVFRT_write_buffered_part(void *writer_ptr, SVFRT_Bytes data) {
+  SVFRT_WriteContext *ctx = (SVFRT_WriteContext *) writer_ptr;
+  return SVFRT_internal_write_buffered(ctx, data) ? data.count : 0;
+}
+
+void SVFRT_write_start_buffered(
+  SVFRT_WriteContext *result,
+  SVFRT_Bytes buffer,
+  SVFRT_GrowBufferFn *grow_fn,
+  void *grow_ptr,
+  SVFRT_WriterFn *writer_fn,
+  void *writer_ptr,
+  uint64_t schema_content_hash,
+  SVFRT_Bytes schema_bytes,
+  SVFRT_Bytes appendix_bytes,
+  uint64_t entry_struct_id
+) {
+  result->error_code = 0;
+  result->finished = false;
+  result->writer_ptr = writer_ptr;
+  result->writer_fn = writer_fn;
+  result->data_bytes_written = 0;
+  result->buffer = buffer;
+  result->buffer_used = 0;
+  result->grow_fn = grow_fn;
+  result->grow_ptr = grow_ptr;
+
+  // With a writer, the buffer must fit a bit more than what may be left in it
+  // after a flush.
+  if (!buffer.pointer || (writer_fn && buffer.count < 2 * SVFRT_MESSAGE_PART_ALIGNMENT)) {
+    result->error_code = SVFRT_code_write__buffer_full;
+    return;
+  }
+
+  SVFRT_ErrorCode error_code = SVFRT_write_header(
+    SVFRT_write_buffered_part,
+    result,
+    0, // `flags`.
+    schema_content_hash,
+    schema_bytes,
+    appendix_bytes,
+    entry_struct_id
+  );
+
+  // A more specific error might have been set already.
+  if (!result->error_code) {
+    result->error_code = error_code;
+  }
+}
+
+// Without `everything`, a few bytes may stay in the buffer, so that the data
+// in the buffer stays at the same alignment as in the message, which is
+// needed for #reserved-writing.
+static
+void SVFRT_write_flush_part(SVFRT_WriteContext *ctx, bool everything) {
+  if (ctx->error_code || !ctx->buffer.pointer || !ctx->writer_fn) {
+    return;
+  }
+
+  uint32_t rest = everything ? 0 : ctx->buffer_used % SVFRT_MESSAGE_PART_ALIGNMENT;
+  SVFRT_Bytes bytes = { ctx->buffer.pointer, ctx->buffer_used - rest };
+  if (bytes.count == 0) {
+    return;
+  }
+
+  uint32_t written = ctx->writer_fn(ctx->writer_ptr, bytes);
+  if (written != bytes.count) {
+    ctx->error_code = SVFRT_code_write__writer_function_failed;
+    return;
+  }
+
+  // No overlap, since `bytes.count` is a non-zero multiple of the alignment,
+  // and `rest` is less than that.
+  SVFRT_MEMCPY(ctx->buffer.pointer, ctx->buffer.pointer + bytes.count, rest);
+  ctx->buffer_used = rest;
+}
+
+void SVFRT_write_flush(SVFRT_WriteContext *ctx) {
+  SVFRT_write_flush_part(ctx, ctx->finished);
+}
+
+// Make sure `count` more bytes fit into the buffer, by flushing or growing it.
+static
+bool SVFRT_write_make_room(SVFRT_WriteContext *ctx, uint32_t count) {
+  if (count <= ctx->buffer.count - ctx->buffer_used) {
+    return true;
+  }
+
+  if (ctx->writer_fn) {
+    SVFRT_write_flush_part(ctx, false);
+    if (ctx->error_code) {
+      return false;
+    }
+    if (count <= ctx->buffer.count - ctx->buffer_used) {
+      return true;
+    }
+  }
+
+  // Prevent addition overflow by casting operands to `uint64_t` first.
+  uint64_t needed = (uint64_t) ctx->buffer_used + (uint64_t) count;
+  uint64_t doubled = 2 * (uint64_t) ctx->buffer.count;
+  uint64_t min_count = needed > doubled ? needed : doubled;
+  if (min_count > (uint64_t) UINT32_MAX) {
+    min_count = needed;
+  }
+
+  SVFRT_Bytes grown = ctx->buffer;
+  if (
+    !ctx->grow_fn ||
+    needed > (uint64_t) UINT32_MAX ||
+    !ctx->grow_fn(ctx->grow_ptr, &grown, (uint32_t) min_count) ||
+    !grown.pointer ||
+    (uint64_t) grown.count < needed
+  ) {
+    ctx->error_code = SVFRT_code_write__buffer_full;
+    return false;
+  }
+  ctx->buffer = grown;
+  return true;
+}
+
+bool SVFRT_internal_write_buffered(SVFRT_WriteContext *ctx, SVFRT_Bytes bytes) {
+  if (ctx->error_code) {
+    return false;
+  }
+
+  // With a writer, large data goes through the buffer piece by piece. The
+  // buffer is at least two alignments large, so each flush makes room.
+  uint32_t done = 0;
+  while (ctx->writer_fn && bytes.count - done > ctx->buffer.count - ctx->buffer_used) {
+    uint32_t piece = ctx->buffer.count - ctx->buffer_used;
+    SVFRT_MEMCPY(ctx->buffer.pointer + ctx->buffer_used, bytes.pointer + done, piece);
+    ctx->buffer_used += piece;
+    done += piece;
+
+    SVFRT_write_flush_part(ctx, false);
+    if (ctx->error_code) {
+      return false;
+    }
+  }
+
+  uint32_t rest = bytes.count - done;
+  if (!SVFRT_write_make_room(ctx, rest)) {
+    return false;
+  }
+
+  SVFRT_MEMCPY(ctx->buffer.pointer + ctx->buffer_used, bytes.pointer + done, rest);
+  ctx->buffer_used += rest;
+  return true;
+}
+
+// #reserved-writing.
+//
+// Same as writing, except that the data is not copied from anywhere, so the
+// tally and the padding work exactly the same way.
+static
+uint8_t *SVFRT_write_reserve(
+  SVFRT_WriteContext *ctx,
+  uint32_t type_size,
+  uint32_t count,
+  uint32_t *out_data_offset
+) {
+  if (!ctx->error_code && !ctx->buffer.pointer) {
+    ctx->error_code = SVFRT_code_write__not_buffered;
+  }
+
+  if (count > 0) {
+    SVFRT_internal_write_align(ctx, type_size);
+  }
+  if (ctx->error_code) {
+    return NULL;
+  }
+
+  // Prevent multiplication overflow by casting operands to `uint64_t` first.
+  uint64_t total_size = (uint64_t) type_size * (uint64_t) count;
+  if (total_size > (uint64_t) UINT32_MAX) {
+    ctx->error_code = SVFRT_code_write__data_would_overflow;
+    return NULL;
+  }
+
+  uint32_t data_offset = ctx->data_bytes_written;
+  SVFRT_internal_write_tally(ctx, (uint32_t) total_size);
+  if (ctx->error_code || !SVFRT_write_make_room(ctx, (uint32_t) total_size)) {
+    return NULL;
+  }
+
+  uint8_t *pointer = ctx->buffer.pointer + ctx->buffer_used;
+  ctx->buffer_used += (uint32_t) total_size;
+  *out_data_offset = data_offset;
+  return pointer;
+}
+
+void *SVFRT_write_reference_reserve(
+  SVFRT_WriteContext *ctx,
+  uint32_t type_size,
+  SVFRT_Reference *out_reference
+) {
+  uint32_t data_offset = 0;
+  uint8_t *pointer = SVFRT_write_reserve(ctx, type_size, 1, &data_offset);
+  out_reference->data_offset_complement = pointer ? ~data_offset : 0;
+  return pointer;
+}
+
+void *SVFRT_write_sequence_reserve(
+  SVFRT_WriteContext *ctx,
+  uint32_t type_size,
+  uint32_t count,
+  SVFRT_Sequence *out_sequence
+) {
+  uint32_t data_offset = 0;
+  uint8_t *pointer = SVFRT_write_reserve(ctx, type_size, count, &data_offset);
+  out_sequence->data_offset_complement = pointer ? ~data_offset : 0;
+  out_sequence->count = pointer ? count : UINT32_MAX;
+  return pointer;
+}
+
+void SVFRT_write_start64(
+  SVFRT_WriteContext64 *result,
+  SVFRT_WriterFn *writer_fn,
+  void *writer_ptr,
+  uint64_t schema_content_hash,
+  SVFRT_Bytes schema_bytes,
+  SVFRT_Bytes appendix_bytes,
+  uint64_t entry_struct_id
+) {
+  result->error_code = SVFRT_write_header(
+    writer_fn,
+    writer_ptr,
+    SVFRT_MESSAGE_FLAG_WIDE,
+    schema_content_hash,
+    schema_bytes,
+    appendix_bytes,
+    entry_struct_id
+  );
   result->finished = false;
   result->writer_ptr = writer_ptr;
   result->writer_fn = writer_fn;
@@ -42,7 +42,6 @@ extern "C" {
 
 #ifndef SVF_COMMON_C_TYPES_INCLUDED
 #define SVF_COMMON_C_TYPES_INCLUDED
-#pragma pack(push, 1)
 
 typedef struct SVFRT_Reference {
   uint32_t data_offset_complement;
@@ -53,9 +52,44 @@ typedef struct SVFRT_Sequence {
   uint32_t count;
 } SVFRT_Sequence;
 
-#pragma pack(pop)
+// Binary schemas are read in place, so they are aligned the same way as the
+// message parts, see #natural-alignment.
+#if defined(__cplusplus) && __cplusplus >= 201103L
+  #define SVF_SCHEMA_ALIGNAS alignas(8)
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+  #define SVF_SCHEMA_ALIGNAS _Alignas(8)
+#elif defined(_MSC_VER)
+  #define SVF_SCHEMA_ALIGNAS __declspec(align(8))
+#else
+  #define SVF_SCHEMA_ALIGNAS __attribute__((aligned(8)))
+#endif
+
 #endif // SVF_COMMON_C_TYPES_INCLUDED
 
+// Only used by #wide-messages.
+#ifndef SVF_WIDE_C_TYPES_INCLUDED
+#define SVF_WIDE_C_TYPES_INCLUDED
+
+typedef struct SVFRT_Reference64 {
+  uint64_t data_offset_complement;
+} SVFRT_Reference64;
+
+typedef struct SVFRT_Sequence64 {
+  uint64_t data_offset_complement;
+  uint64_t count;
+} SVFRT_Sequence64;
+#endif // SVF_WIDE_C_TYPES_INCLUDED
+
+// Only used by #chunked-sequences.
+#ifndef SVF_CHUNKED_C_TYPES_INCLUDED
+#define SVF_CHUNKED_C_TYPES_INCLUDED
+
+typedef struct SVFRT_ChunkedSequence {
+  uint32_t data_offset_complement;
+  uint32_t count;
+} SVFRT_ChunkedSequence;
+#endif // SVF_CHUNKED_C_TYPES_INCLUDED
+
 typedef struct SVFRT_Bytes {
   uint8_t *pointer;
   uint32_t count;
@@ -66,11 +100,18 @@ typedef struct SVFRT_RangeU32 {
   uint32_t count;
 } SVFRT_RangeU32;
 
+// Only used by #wide-messages, and for archives, see `SVFRT_archive_open64`.
+typedef struct SVFRT_Bytes64 {
+  uint8_t *pointer;
+  uint64_t count;
+} SVFRT_Bytes64;
+
 #pragma pack(push, 1)
 typedef struct SVFRT_MessageHeader {
   uint8_t magic[3];
   uint8_t version;
-  uint8_t _reserved[4];
+  uint8_t flags; // See `SVFRT_MESSAGE_FLAG_*`.
+  uint8_t _reserved[3];
   uint32_t schema_length;
   uint32_t appendix_length;
   uint64_t schema_content_hash;
@@ -83,9 +124,77 @@ typedef struct SVFRT_MessageHeader {
 
 // TODO: check `sizeof(SVFRT_MessageHeader) % SVFRT_MESSAGE_PART_ALIGNMENT == 0`.
 
+// The message is wide, see #wide-messages.
+#define SVFRT_MESSAGE_FLAG_WIDE 0x01
+
+// #natural-alignment: structs are laid out the same way a C compiler would,
+// without `#pragma pack`. Each field is at a multiple of its alignment, and the
+// size of a struct is a multiple of its own alignment, which is the largest one
+// of its fields. Both are recorded in the schema. Alignments are:
+// - Primitives: their size.
+// - References, sequences, and chunked sequences: 4, or 8 in #wide-messages.
+// - Choices: the largest alignment of the options. The tag is not aligned, but
+//   goes immediately before the payload (at `SVFRT_TAG_SIZE` less than its
+//   offset), and the payload is aligned. `svfc` pads the gap explicitly.
+//
+// The writer and the conversion pad data in front of each reference and
+// sequence, so that it starts at a multiple of this, relative to the data
+// range (which itself is aligned to `SVFRT_MESSAGE_PART_ALIGNMENT`). It is
+// derived from the type size (or stride): the largest power of two that
+// divides it, up to `SVFRT_MESSAGE_PART_ALIGNMENT`, which is never less than
+// the alignment of the type.
+//
+// Data can be read in place this way. The typed accessors (`SVFRT_READ_*`
+// macros, and `read_*` in C++) fail with NULL for misaligned data, and
+// `SVFRT_verify_message` rejects it. Untrusted data is still only accessed via
+// `SVFRT_MEMCPY` internally, as a malformed schema may claim any layout.
+//
+// The macro is a constant expression for a constant `type_size`, which some
+// compilers require for `SVFRT_ASSUME_ALIGNED`.
+#define SVFRT_NATURAL_ALIGNMENT(type_size) ( \
+  (type_size) == 0 ? 1 : \
+  ((type_size) & (~(type_size) + 1)) > SVFRT_MESSAGE_PART_ALIGNMENT ? SVFRT_MESSAGE_PART_ALIGNMENT : \
+  ((type_size) & (~(type_size) + 1)) /* Lowest set bit. */ \
+)
+
+static inline
+uint32_t SVFRT_natural_alignment(uint32_t type_size) {
+  return SVFRT_NATURAL_ALIGNMENT(type_size);
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+  #define SVFRT_ASSUME_ALIGNED(pointer, alignment) __builtin_assume_aligned((pointer), (alignment))
+#else
+  #define SVFRT_ASSUME_ALIGNED(pointer, alignment) ((void *) (pointer))
+#endif
+
+// Alignment of a type, as a constant expression, see #natural-alignment.
+#if defined(__cplusplus) && __cplusplus >= 201103L
+  #define SVFRT_ALIGNOF(type_name) alignof(type_name)
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+  #define SVFRT_ALIGNOF(type_name) _Alignof(type_name)
+#elif defined(__GNUC__) || defined(__clang__)
+  #define SVFRT_ALIGNOF(type_name) __alignof__(type_name)
+#elif defined(_MSC_VER)
+  #define SVFRT_ALIGNOF(type_name) __alignof(type_name)
+#else
+  #define SVFRT_ALIGNOF(type_name) offsetof(struct { char c; type_name t; }, t)
+#endif
+
+// Typed access needs data to be aligned for the type, see #natural-alignment.
+// Returns NULL otherwise, and also passes NULL through.
+static inline
+void const *SVFRT_read_check_alignment(void const *pointer, uint32_t type_alignment) {
+  if (((uintptr_t) pointer) % type_alignment != 0) {
+    return NULL;
+  }
+  return pointer;
+}
+
 // If tags ever become capable of being > 1 byte wide, this macro needs to be
 // removed altogether. Code that relies on it being exactly 1 byte currently,
-// needs to reference this macro.
+// needs to reference this macro. The payload of a choice always follows its tag
+// immediately, see #natural-alignment.
 #define SVFRT_TAG_SIZE 1
 
 // By default, fail, if checking an untrusted schema for compatibility is more
@@ -144,6 +253,9 @@ typedef uint32_t SVFRT_ErrorCode;
 #define SVFRT_code_compatibility__field_cannot_be_ignored             0x00010017
 #define SVFRT_code_compatibility__option_cannot_be_ignored            0x00010018
 #define SVFRT_code_compatibility__invalid_tag                         0x00010019
+#define SVFRT_code_compatibility__schema_not_aligned                  0x0001001A
+#define SVFRT_code_compatibility__invalid_alignment                   0x0001001B
+#define SVFRT_code_compatibility__struct_alignment_mismatch           0x0001001C
 
 #define SVFRT_code_compatibility_internal__unknown                    0x00020001
 #define SVFRT_code_compatibility_internal__invalid_type_tag           0x00020002
@@ -153,7 +265,9 @@ typedef uint32_t SVFRT_ErrorCode;
 #define SVFRT_code_compatibility_internal__invalid_options            0x0002000A
 #define SVFRT_code_compatibility_internal__queue_overflow             0x0002000B
 #define SVFRT_code_compatibility_internal__queue_unhandled            0x0002000C
+#define SVFRT_code_compatibility_internal__member_index_overflow      0x0002000D
 #define SVFRT_code_compatibility_internal__schema_too_small           0x00020015
+#define SVFRT_code_compatibility_internal__schema_not_aligned         0x0002001A
 
 #define SVFRT_code_conversion__allocation_failed                      0x00030001
 #define SVFRT_code_conversion__total_data_size_limit_exceeded         0x00030002
@@ -172,6 +286,8 @@ typedef uint32_t SVFRT_ErrorCode;
 #define SVFRT_code_conversion__max_recursion_depth_exceeded           0x00030010
 #define SVFRT_code_conversion__bad_type                               0x00030011
 #define SVFRT_code_conversion__data_aliasing_detected                 0x00030012
+#define SVFRT_code_conversion__not_enough_stack_memory                0x00030013
+#define SVFRT_code_conversion__bad_chunk_link                         0x00030014
 
 #define SVFRT_code_conversion_internal__suballocation_mismatch        0x00040001
 #define SVFRT_code_conversion_internal__suballocation_failed          0x00040002
@@ -190,6 +306,7 @@ typedef uint32_t SVFRT_ErrorCode;
 #define SVFRT_code_conversion_internal__suballocation_out_of_bounds   0x0004000F
 #define SVFRT_code_conversion_internal__bad_type                      0x00040010
 #define SVFRT_code_conversion_internal__need_logical_compatibility    0x00040011
+#define SVFRT_code_conversion_internal__bad_plan                      0x00040012
 
 #define SVFRT_code_read__header_too_small                             0x00050001
 #define SVFRT_code_read__header_not_aligned                           0x00050002
@@ -201,11 +318,319 @@ typedef uint32_t SVFRT_ErrorCode;
 #define SVFRT_code_read__schema_lookup_failed                         0x00050008
 #define SVFRT_code_read__no_allocator_function                        0x00050009
 #define SVFRT_code_read__data_too_small                               0x0005000A
+#define SVFRT_code_read__batch_scratch_in_use                         0x0005000B
+#define SVFRT_code_read__wide_message                                 0x0005000C
+#define SVFRT_code_read__not_wide_message                             0x0005000D
+#define SVFRT_code_read__not_enough_resumable_memory                  0x0005000F
+#define SVFRT_code_read__not_enough_lazy_memory                       0x00050010
+#define SVFRT_code_read__entry_not_aligned                            0x00050011
 
 #define SVFRT_code_write__writer_function_failed                      0x00060001
 #define SVFRT_code_write__data_would_overflow                         0x00060002
 #define SVFRT_code_write__sequence_non_contiguous                     0x00060003
 #define SVFRT_code_write__already_finished                            0x00060004
+#define SVFRT_code_write__buffer_full                                 0x00060005
+#define SVFRT_code_write__not_buffered                                0x00060006
+#define SVFRT_code_write__bad_shard_handle                            0x00060007
+#define SVFRT_code_write__relocation_failed                           0x00060008
+#define SVFRT_code_write__bad_subtree                                 0x00060009
+#define SVFRT_code_write__not_enough_scratch                          0x0006000A
+#define SVFRT_code_write__patch_mismatch                              0x0006000B
+#define SVFRT_code_write__compaction_failed                           0x0006000C
+
+#define SVFRT_code_cache__not_enough_memory                           0x00070001
+#define SVFRT_code_cache__invalid_slot_count                          0x00070002
+#define SVFRT_code_cache__snapshot_malformed                          0x00070003
+#define SVFRT_code_cache__snapshot_buffer_too_small                   0x00070004
+#define SVFRT_code_cache__full                                        0x00070005
+
+#define SVFRT_code_registry__not_aligned                              0x00080001
+#define SVFRT_code_registry__malformed                                0x00080002
+#define SVFRT_code_registry__buffer_too_small                         0x00080003
+#define SVFRT_code_registry__duplicate_schema                         0x00080004
+#define SVFRT_code_registry__too_large                                0x00080005
+
+#define SVFRT_code_verify__no_entry                                   0x00090001
+#define SVFRT_code_verify__bad_schema                                 0x00090002
+#define SVFRT_code_verify__data_out_of_bounds                         0x00090003
+#define SVFRT_code_verify__max_recursion_depth_exceeded               0x00090004
+#define SVFRT_code_verify__data_aliasing_detected                     0x00090005
+#define SVFRT_code_verify__bad_chunk_link                             0x00090006
+#define SVFRT_code_verify__data_not_aligned                           0x00090007
+
+#define SVFRT_code_archive__not_aligned                               0x000A0001
+#define SVFRT_code_archive__malformed                                 0x000A0002
+#define SVFRT_code_archive__index_full                                0x000A0003
+#define SVFRT_code_archive__record_already_started                    0x000A0004
+#define SVFRT_code_archive__record_not_started                        0x000A0005
+#define SVFRT_code_archive__record_not_finished                       0x000A0006
+#define SVFRT_code_archive__record_out_of_range                       0x000A0007
+
+#define SVFRT_code_view__field_not_found                              0x000B0001
+#define SVFRT_code_view__type_mismatch                                0x000B0002
+#define SVFRT_code_view__size_mismatch                                0x000B0003
+#define SVFRT_code_view__not_flat                                     0x000B0004
+#define SVFRT_code_view__index_out_of_bounds                          0x000B0005
+#define SVFRT_code_view__data_out_of_bounds                           0x000B0006
+#define SVFRT_code_view__bad_schema                                   0x000B0007
+#define SVFRT_code_view__no_allocator_function                        0x000B0008
+#define SVFRT_code_view__absent                                       0x000B0009
+
+#define SVFRT_code_converter_table__not_enough_memory                 0x000C0001
+#define SVFRT_code_converter_table__invalid_slot_count                0x000C0002
+#define SVFRT_code_converter_table__full                              0x000C0003
+
+// Compatibility cache.
+//
+// Remembers the outcome of `SVFRT_check_compatibility` per key of
+// (src-schema content hash, dst-schema content hash, entry struct ID, required
+// level), so that messages from a known producer skip the compatibility check
+// altogether. Failed checks are remembered as well (negative cache), so that
+// repeated incompatible or adversarial schemas are rejected cheaply.
+//
+// Thread safety: lookups are lock-free and may run concurrently with each other
+// and with insertions. Entries are never removed or modified after being
+// published, so results obtained from the cache stay valid until the cache is
+// reset, see `SVFRT_compatibility_cache_reset`.
+//
+// The src-schema content hash comes from the message, so it is not trusted to
+// identify the schema: each entry keeps the src-schema bytes, and is only used
+// for the exact same bytes. A made-up schema sent under the hash of a real one
+// gets an entry of its own, and can't affect messages with the real schema.
+
+typedef struct SVFRT_CompatibilityCacheSlot {
+  uint32_t state; // Accessed atomically. See `SVFRT_CACHE_SLOT_*` in "svf_cache.c".
+  uint32_t record_offset;
+  uint32_t record_size;
+  uint32_t required_level;
+  uint64_t schema_content_hash_src;
+  uint64_t schema_content_hash_dst;
+  uint64_t entry_struct_id;
+} SVFRT_CompatibilityCacheSlot;
+
+typedef struct SVFRT_CompatibilityCache {
+  SVFRT_CompatibilityCacheSlot *slots;
+  uint32_t slot_count; // Power of two.
+  SVFRT_Bytes storage;
+  uint32_t storage_used; // Accessed atomically.
+} SVFRT_CompatibilityCache;
+
+// Initialize the cache inside of user-provided `memory`, which must stay alive
+// as long as the cache (and any results read through it) is used. The memory is
+// split between `slot_count` slots (must be a power of two), and the storage for
+// cached results. Some rough guidance for sizing: each cached result takes
+// about `4 * (2 * struct_count + 2 * choice_count + field_count + option_count)`
+// bytes of the read schema, plus the size of the src-schema, plus a small
+// constant.
+//
+// Initialization is not thread-safe, everything else is.
+SVFRT_ErrorCode SVFRT_compatibility_cache_init(
+  SVFRT_CompatibilityCache *cache,
+  SVFRT_Bytes memory,
+  uint32_t slot_count
+);
+
+// Serialize all published entries into `out_bytes`. Returns the number of bytes
+// needed for the whole snapshot. If `out_bytes` is too small, nothing useful is
+// written, and `*out_error_code` is set to `SVFRT_code_cache__snapshot_buffer_too_small`,
+// so this can be first called with empty `out_bytes` to learn the size.
+uint32_t SVFRT_compatibility_cache_snapshot(
+  SVFRT_CompatibilityCache *cache,
+  SVFRT_Bytes out_bytes,
+  SVFRT_ErrorCode *out_error_code
+);
+
+// Insert all entries from a snapshot into the cache, e.g. at startup. Snapshots
+// are validated structurally, but their contents are trusted, so they should
+// come from a trusted source (e.g. written by the same program).
+SVFRT_ErrorCode SVFRT_compatibility_cache_restore(
+  SVFRT_CompatibilityCache *cache,
+  SVFRT_Bytes snapshot
+);
+
+// Remove all entries. There is no eviction, so once the storage is used up,
+// nothing new gets cached, and each new schema needs the full check again. A
+// producer sending made-up schemas can get there quickly, since failed checks
+// are remembered as well. So, when `storage_used` gets close to `storage.count`,
+// call this at a point where no reads are in flight (e.g. between batches), and
+// optionally restore a snapshot of the known-good entries afterwards.
+//
+// Not thread-safe, and results obtained from the cache before are invalidated.
+void SVFRT_compatibility_cache_reset(SVFRT_CompatibilityCache *cache);
+
+// #generated-conversion: when both schema versions are known at build time,
+// `svfc convert-gen old.txt new.txt out.h` outputs specialized C functions,
+// which convert messages from the old layout to the new one with hard-coded
+// offsets, widenings and tag remaps, instead of interpreting both schemas. The
+// header lists them in `SVF_<Old>_to_<New>_converters`, one for each entry
+// struct that needs a logical conversion (binary-compatible ones don't).
+//
+// Add them to a `SVFRT_ConverterTable`, and pass it in `SVFRT_ReadMessageParams`.
+// `SVFRT_read_message` then looks up the converter by (src-schema content
+// hash, dst-schema content hash, entry struct ID), and uses it instead of the
+// compatibility check and the generic conversion. The output is the same.
+//
+// Each converter keeps the bytes of the old schema, and is only used for
+// messages with exactly the same schema, since the hash comes from the message.
+// Entries that reach #chunked-sequences get no converter, and neither do wide
+// schemas, so these are converted by the runtime as usual.
+
+// Opaque, only passed around by the generated code.
+typedef struct SVFRT_GeneratedConversion SVFRT_GeneratedConversion;
+
+// Convert a struct value from `src` to `dst`. In Phase 1, `dst` is NULL, and
+// only the suballocations are tallied. Returns false on an error.
+typedef bool (SVFRT_GeneratedConvertFn)(
+  SVFRT_GeneratedConversion *ctx,
+  uint32_t recursion_depth,
+  uint8_t const *src,
+  uint8_t *dst
+);
+
+typedef struct SVFRT_GeneratedConverter {
+  uint64_t schema_content_hash_src;
+  uint64_t schema_content_hash_dst;
+  uint64_t entry_struct_id;
+  uint8_t const *schema_src;
+  uint32_t schema_length_src;
+  uint32_t entry_struct_size_src;
+  uint32_t entry_struct_size_dst;
+  SVFRT_GeneratedConvertFn *convert_entry;
+} SVFRT_GeneratedConverter;
+
+typedef struct SVFRT_ConverterTable {
+  SVFRT_GeneratedConverter const **slots;
+  uint32_t slot_count; // Power of two.
+  uint32_t converter_count;
+} SVFRT_ConverterTable;
+
+// Initialize the table inside of user-provided `memory`, which must fit
+// `slot_count` pointers (must be a power of two), and stay alive as long as the
+// table is used.
+//
+// Adding converters is not thread-safe, so it's best done at startup. Lookups
+// are, as long as nothing is added at the same time.
+SVFRT_ErrorCode SVFRT_converter_table_init(
+  SVFRT_ConverterTable *table,
+  SVFRT_Bytes memory,
+  uint32_t slot_count
+);
+
+// Add all `converters`, e.g. `SVF_<Old>_to_<New>_converters`. They must stay
+// alive as long as the table is used. Converters with the same key as one
+// already in the table are skipped.
+SVFRT_ErrorCode SVFRT_converter_table_add(
+  SVFRT_ConverterTable *table,
+  SVFRT_GeneratedConverter const *converters,
+  uint32_t converter_count
+);
+
+// Returns NULL, if there is no converter for exactly this src-schema.
+SVFRT_GeneratedConverter const *SVFRT_converter_table_find(
+  SVFRT_ConverterTable *table,
+  SVFRT_Bytes unsafe_schema_src,
+  uint64_t schema_content_hash_src,
+  uint64_t schema_content_hash_dst,
+  uint64_t entry_struct_id
+);
+
+// Only for the generated code: the elements of a reference or a sequence,
+// which are left to convert one by one.
+typedef struct SVFRT_GeneratedElements {
+  uint8_t const *pointer_src;
+  uint8_t *pointer_dst; // NULL in Phase 1.
+  uint32_t count;
+} SVFRT_GeneratedElements;
+
+// Only for the generated code: check the depth of a value about to be
+// converted. Returns false, if it's too deep.
+bool SVFRT_generated_enter(SVFRT_GeneratedConversion *ctx, uint32_t recursion_depth);
+
+// Only for the generated code: tally the suballocation of a reference or a
+// sequence, and in Phase 2, point `representation_dst` at it. Elements of
+// primitive types (`SVF_Meta_ConcreteType_tag_*`) are converted right here,
+// struct elements are left in `*out_elements`. Returns false on an error.
+bool SVFRT_generated_handle(
+  SVFRT_GeneratedConversion *ctx,
+  uint8_t const *representation_src,
+  uint8_t *representation_dst, // NULL in Phase 1.
+  bool is_sequence,
+  uint32_t element_size_src,
+  uint32_t element_size_dst,
+  uint32_t element_tag_src,
+  uint32_t element_tag_dst,
+  SVFRT_GeneratedElements *out_elements
+);
+
+// Schema registry, see #schema-registry.
+//
+// A file of schemas, indexed by their content hash, so that messages can be
+// written without the schema part (see `SVFRT_write_start`), and readers can
+// still find the schema cheaply. The file is meant to be mapped into memory
+// as-is (see "svf_mmap.h"), and can be used directly as a lookup function:
+//
+//   params.schema_lookup_fn = SVFRT_schema_registry_lookup;
+//   params.schema_lookup_ptr = &registry;
+//
+// Layout: the header, then `slot_count` slots (an open-addressing table with
+// linear probing), then the schemas, each aligned to `SVFRT_MESSAGE_PART_ALIGNMENT`.
+// All offsets are from the start of the file.
+//
+// Thread safety: an opened registry is read-only, so lookups may run
+// concurrently. The file must not be modified while mapped, so writers should
+// replace it as a whole instead.
+
+#define SVFRT_SCHEMA_REGISTRY_VERSION 1
+
+typedef struct SVFRT_SchemaRegistryHeader {
+  uint8_t magic[4]; // "SVFR".
+  uint32_t version;
+  uint32_t slot_count; // Power of two.
+  uint32_t entry_count;
+} SVFRT_SchemaRegistryHeader;
+
+typedef struct SVFRT_SchemaRegistrySlot {
+  uint64_t schema_content_hash;
+  uint32_t schema_offset; // Zero for empty slots.
+  uint32_t schema_length;
+} SVFRT_SchemaRegistrySlot;
+
+typedef struct SVFRT_SchemaRegistry {
+  SVFRT_Bytes file;
+  SVFRT_SchemaRegistrySlot const *slots;
+  uint32_t slot_count;
+  uint32_t entry_count;
+} SVFRT_SchemaRegistry;
+
+// Open a registry from the contents of the whole file, which must be aligned
+// to `SVFRT_MESSAGE_PART_ALIGNMENT`, and stay alive as long as the registry
+// (and any schemas looked up through it) is used. The table is validated here,
+// once, so that lookups don't have to. The schemas themselves are not, since
+// reading a message checks them anyway.
+SVFRT_ErrorCode SVFRT_schema_registry_open(
+  SVFRT_SchemaRegistry *registry,
+  SVFRT_Bytes file
+);
+
+// Compatible with `SVFRT_SchemaLookupFn`, with `registry` pointing to an opened
+// `SVFRT_SchemaRegistry`. Returns empty bytes if the schema is not found.
+SVFRT_Bytes SVFRT_schema_registry_lookup(
+  void *registry,
+  uint64_t schema_content_hash
+);
+
+// Write a whole registry file containing `schema_count` schemas into
+// `out_bytes`. Returns the number of bytes needed for the file. If `out_bytes`
+// is too small, nothing useful is written, and `*out_error_code` is set to
+// `SVFRT_code_registry__buffer_too_small`, so this can be first called with
+// empty `out_bytes` to learn the size. Content hashes must be unique.
+uint32_t SVFRT_schema_registry_write(
+  SVFRT_Bytes const *schemas,
+  uint64_t const *schema_content_hashes,
+  uint32_t schema_count,
+  SVFRT_Bytes out_bytes,
+  SVFRT_ErrorCode *out_error_code
+);
 
 typedef struct SVFRT_ReadMessageResult {
   SVFRT_ErrorCode error_code;
@@ -225,6 +650,20 @@ typedef struct SVFRT_ReadMessageResult {
   SVFRT_ReadContext context;
 } SVFRT_ReadMessageResult;
 
+// Optional for `SVFRT_read_messages` and #parallel-conversion. Must call
+// `task_fn(task_ptr, i)` exactly once for each `i` in `[0, task_count)`, on any
+// threads, and only return after all of the calls have returned.
+typedef void (SVFRT_TaskFn)(void *task_ptr, uint32_t task_index);
+typedef void (SVFRT_SpawnTasksFn)(
+  void *spawn_ptr,
+  SVFRT_TaskFn *task_fn,
+  void *task_ptr,
+  uint32_t task_count
+);
+
+// Upper bound for `conversion_task_count` in `SVFRT_ReadMessageParams`.
+#define SVFRT_MAX_CONVERSION_TASKS 64
+
 typedef struct SVFRT_ReadMessageParams {
   uint64_t expected_schema_content_hash;
   SVFRT_RangeU32 expected_schema_struct_strides;
@@ -243,6 +682,58 @@ typedef struct SVFRT_ReadMessageParams {
 
   SVFRT_SchemaLookupFn *schema_lookup_fn; // Optional. TODO: describe.
   void *schema_lookup_ptr;                // Optional.
+
+  // Optional. If present, it is consulted before checking compatibility, and
+  // filled after the check. See `SVFRT_CompatibilityCache`.
+  SVFRT_CompatibilityCache *compatibility_cache;
+
+  // Optional. For `SVFRT_compatibility_logical`, convert the message in one
+  // pass instead of two. This needs a conversion plan, which is currently only
+  // available from `compatibility_cache`, otherwise it has no effect.
+  //
+  // The allocation is then an upper bound of the output size, and may be
+  // larger than the data range in the result, up to a few times the message
+  // size (but never more than `max_output_size`).
+  bool single_pass_conversion;
+
+  // Optional. Only used when the runtime is compiled with `SVFRT_ITERATIVE_CONVERSION`,
+  // for `SVFRT_compatibility_logical`. If present, the conversion does not
+  // recurse, and keeps its stack in this memory instead, which allows for a
+  // much larger `max_recursion_depth`. See `SVFRT_conversion_stack_size`.
+  //
+  // Should be aligned to 8 bytes. Must not be used by another read at the same
+  // time, but can be reused afterwards.
+  SVFRT_Bytes conversion_stack;
+
+  // Optional. For `SVFRT_compatibility_logical`, split the second phase of the
+  // conversion over up to `conversion_task_count` tasks per large sequence,
+  // spawned through `conversion_spawn_fn`. See #parallel-conversion. The output
+  // is exactly the same as without it.
+  //
+  // Like `single_pass_conversion`, this needs a conversion plan, otherwise it
+  // has no effect. Single-pass conversion takes precedence, when it's possible.
+  SVFRT_SpawnTasksFn *conversion_spawn_fn;
+  void *conversion_spawn_ptr;
+  uint32_t conversion_task_count; // At most `SVFRT_MAX_CONVERSION_TASKS`.
+
+  // Optional. For `SVFRT_compatibility_logical`, accept messages in which
+  // several handles point to the same range (e.g. from #write-interning),
+  // instead of failing with `SVFRT_code_conversion__data_aliasing_detected`.
+  // Each such range is converted once, and the output is shared the same way.
+  // See #conversion-memoization. Also turns off #parallel-conversion.
+  //
+  // This memory holds a table of the distinct ranges, 24 bytes per entry. It
+  // needs one entry per shared range, and more room makes lookups faster. If
+  // it is too small, some messages with sharing are still rejected. Must not
+  // be used by another read at the same time. `SVFRT_read_messages` does not
+  // spawn tasks when it is present.
+  SVFRT_Bytes conversion_memo;
+
+  // Optional. For `SVFRT_compatibility_logical`, `SVFRT_read_message` looks
+  // for a converter here first, see #generated-conversion. The options for the
+  // generic conversion above have no effect on it, and it is skipped when
+  // `conversion_memo` is present, since it does not accept aliasing.
+  SVFRT_ConverterTable *converter_table;
 } SVFRT_ReadMessageParams;
 
 // Read the message.
@@ -260,14 +751,268 @@ void SVFRT_read_message(
   SVFRT_Bytes scratch
 );
 
+// Read many messages with the same `params`, filling `out_results[i]` for each
+// of `messages[i]`, same as `SVFRT_read_message` would. The compatibility
+// decision is only made once per distinct schema hash. See #batch-read.
+//
+// `scratch` is the same as for `SVFRT_read_message`, and can only hold one
+// checked schema at a time. With `compatibility_cache`, each distinct schema is
+// checked once. Without it, a message which needs a second check first
+// finishes the messages before it (including spawned tasks), and then reuses
+// scratch, so a schema may be checked again when it shows up later.
+//
+// If `spawn_fn` is given, logical conversions are run as tasks through it,
+// so `allocator_fn` must be thread-safe then, and `conversion_stack` is not
+// used for those. If `params->conversion_spawn_fn` is given as well, it gets
+// called from within those tasks. If `params->conversion_memo` is given,
+// `spawn_fn` is not used, since the memo can't be shared between tasks.
+void SVFRT_read_messages(
+  SVFRT_ReadMessageParams *params,
+  SVFRT_ReadMessageResult *out_results,
+  SVFRT_Bytes const *messages,
+  uint32_t message_count,
+  SVFRT_Bytes scratch,
+  SVFRT_SpawnTasksFn *spawn_fn, // Optional.
+  void *spawn_ptr               // Optional.
+);
+
+// Verify the whole message after a successful `SVFRT_read_message` with the
+// same `params`, see #message-verification. Every reference and sequence that
+// is reachable from the entry (through the read schema) is checked to be in
+// bounds, so afterwards, the `*_unchecked` accessors may be used instead of the
+// checked ones for the data in `result->context`.
+//
+// The work is linear in the data size. Fails on messages where referenced data
+// overlaps, same as the conversion.
+SVFRT_ErrorCode SVFRT_verify_message(
+  SVFRT_ReadMessageParams *params,
+  SVFRT_ReadMessageResult *result
+);
+
+// #wide-messages: a variant of messages for data larger than 4 GiB. The header
+// has `SVFRT_MESSAGE_FLAG_WIDE` set, and all offsets and counts in the data are
+// 64-bit, i.e. `SVFRT_Reference64` and `SVFRT_Sequence64` take the place of
+// `SVFRT_Reference` and `SVFRT_Sequence`. Schemas for them are generated from
+// text with a `#wide` directive, and must only be used with the `*64` functions.
+//
+// Regular functions fail on wide messages, and vice versa. Wide messages that
+// are only logically compatible are converted by #wide-conversion, and can be
+// verified with `SVFRT_verify_message64`.
+
+typedef struct SVFRT_ReadContext64 {
+  SVFRT_Bytes64 data_range;
+  SVFRT_RangeU32 struct_strides;
+} SVFRT_ReadContext64;
+
+typedef struct SVFRT_ReadMessageResult64 {
+  SVFRT_ErrorCode error_code;
+
+  // NULL in case of any errors.
+  void *entry;
+
+  // Same as for `SVFRT_ReadMessageResult`.
+  void *allocation;
+
+  // Greater or equal to the required level.
+  SVFRT_CompatibilityLevel compatibility_level;
+
+  // This context is only valid, if there were no errors.
+  SVFRT_ReadContext64 context;
+} SVFRT_ReadMessageResult64;
+
+// Read a wide message. Same as `SVFRT_read_message`, except that for logical
+// compatibility, only `allocator_fn` and the limits are used, and none of the
+// optional conversion parameters. `SVFRT_NO_SIZE_LIMIT` really means no limit
+// here, so the output may be larger than `UINT32_MAX` bytes.
+void SVFRT_read_message64(
+  SVFRT_ReadMessageParams *params,
+  SVFRT_ReadMessageResult64 *out_result,
+  SVFRT_Bytes64 message,
+  SVFRT_Bytes scratch
+);
+
+// Same as `SVFRT_verify_message`, for a wide message after a successful
+// `SVFRT_read_message64` with the same `params`.
+SVFRT_ErrorCode SVFRT_verify_message64(
+  SVFRT_ReadMessageParams *params,
+  SVFRT_ReadMessageResult64 *result
+);
+
+// Exact size of `conversion_stack` in `SVFRT_ReadMessageParams` needed for any
+// message, given `max_recursion_depth`. Returns `UINT32_MAX` if it's too large.
+//
+// If the stack is smaller, reading may fail with `SVFRT_code_conversion__not_enough_stack_memory`,
+// depending on the message.
+uint32_t SVFRT_conversion_stack_size(uint32_t max_recursion_depth);
+
+// #resumable-read: same as `SVFRT_read_message`, but a logical conversion can
+// be spread over many calls, e.g. one per frame, with other work in between.
+// Call `SVFRT_read_message_begin`, then `SVFRT_read_message_step` until it
+// returns true, then `SVFRT_read_message_finish`. The result is exactly the
+// same as from `SVFRT_read_message` with the same `params`.
+//
+// All of the state is kept in `memory`, so any number of reads can be in
+// progress at the same time. `memory` must have at least the size given by
+// `SVFRT_resumable_read_memory_size`, and stay alive and unmoved until the read
+// is finished, same as `params`, `message`, `scratch`, and `conversion_memo`
+// in `params`. `conversion_stack`, `single_pass_conversion`, and the parallel
+// conversion parameters are not used.
+//
+// The work is done in two phases, like the regular conversion, and `budget`
+// counts the fields, sequence elements, and chunks visited. A sequence of
+// primitives is converted as a single element. Without `SVFRT_ITERATIVE_CONVERSION`,
+// a step always finishes a whole phase, so there are at most two steps.
+//
+// Messages which don't need a conversion are read in `SVFRT_read_message_begin`
+// already, and so are errors found there.
+
+typedef struct SVFRT_ResumableRead {
+  SVFRT_ReadMessageParams *params;
+
+  // Final, once `done` is set. Before that, `allocation` may already be set,
+  // and must be freed by the caller, if it gives up on the read.
+  SVFRT_ReadMessageResult result;
+
+  void *state; // Internal, in the memory passed to `SVFRT_read_message_begin`.
+  bool done;
+} SVFRT_ResumableRead;
+
+// Size of `memory` for `SVFRT_read_message_begin`, given `max_recursion_depth`
+// in the params. Returns `UINT32_MAX` if it's too large.
+uint32_t SVFRT_resumable_read_memory_size(uint32_t max_recursion_depth);
+
+// Fails with `SVFRT_code_read__not_enough_resumable_memory`, if `memory` is
+// too small.
+void SVFRT_read_message_begin(
+  SVFRT_ResumableRead *out_read,
+  SVFRT_ReadMessageParams *params,
+  SVFRT_Bytes message,
+  SVFRT_Bytes scratch,
+  SVFRT_Bytes memory
+);
+
+// Do up to `budget` units of work. Returns true, when the read is done.
+bool SVFRT_read_message_step(SVFRT_ResumableRead *read, uint32_t budget);
+
+// Do whatever work is left, without a budget, and return the result.
+void SVFRT_read_message_finish(SVFRT_ResumableRead *read, SVFRT_ReadMessageResult *out_result);
+
+// #lazy-view: read a message without converting it up front. Values are
+// converted one at a time when they are accessed, so reading a few fields of a
+// large message that needs `SVFRT_compatibility_logical` only costs as much as
+// those fields. Messages which don't need a conversion are viewed in place, so
+// the same code works for any compatibility level.
+//
+// A view is a struct in the message. Fields are named by their offset in the
+// read schema, i.e. `offsetof` of the generated struct member (generated C++
+// headers have these as `<Struct>_fields::<field>` constants). For a choice,
+// that is the offset of its tag, and the payload is at the next byte. Values
+// without handles in them (primitives, and structs and choices of those) are
+// read with `SVFRT_view_read`, into memory of exactly their size in the read
+// schema. Everything else is reached through nested views, and any struct can
+// be converted as a whole with `SVFRT_view_materialize`, e.g. to keep it.
+//
+// Missing fields and options read as zero, same as after a conversion. A view
+// of a missing struct is "absent": everything in it reads as zero as well.
+//
+// Errors are sticky: the first one is kept in `error_code`, and from then on,
+// all reads give zeros and all views are absent, so accesses can be checked
+// once at the end. `message`, `scratch` (unless the compatibility cache was
+// used), and `memory` must stay alive and unmoved while views are in use, and
+// so must the `SVFRT_LazyRead` itself, since views point to it.
+
+typedef struct SVFRT_LazyRead SVFRT_LazyRead;
+
+typedef struct SVFRT_LazyView {
+  SVFRT_LazyRead *read;
+  uint32_t data_offset; // Of the struct, in the data part of the message.
+  uint32_t unsafe_struct_index_src; // `UINT32_MAX` if absent.
+  uint32_t struct_index_dst;
+} SVFRT_LazyView;
+
+struct SVFRT_LazyRead {
+  SVFRT_ErrorCode error_code;
+  SVFRT_CompatibilityLevel compatibility_level;
+  SVFRT_LazyView entry;
+  void *state; // Internal, in the memory passed to `SVFRT_read_message_lazy`.
+};
+
+// Size of `memory` for `SVFRT_read_message_lazy`, including the alignment,
+// with room for up to `memo_count` structs kept by `SVFRT_view_materialize`.
+// With a `memo_count` of zero, every call converts again.
+uint32_t SVFRT_lazy_read_memory_size(uint32_t memo_count);
+
+// Same parameters as `SVFRT_read_message`. `allocator_fn` is only needed for
+// `SVFRT_view_materialize`. The conversion parameters are not used. Fails with
+// `SVFRT_code_read__not_enough_lazy_memory`, if `memory` is too small.
+void SVFRT_read_message_lazy(
+  SVFRT_LazyRead *out_read,
+  SVFRT_ReadMessageParams *params,
+  SVFRT_Bytes message,
+  SVFRT_Bytes scratch,
+  SVFRT_Bytes memory
+);
+
+// Convert a value without handles into `out`, which must be exactly its size.
+// For a choice, `out_size` may also be `SVFRT_TAG_SIZE`, to only read the tag.
+void SVFRT_view_read(SVFRT_LazyView view, uint32_t offset, void *out, uint32_t out_size);
+
+// View a struct value in the struct itself, or as the payload of a choice.
+SVFRT_LazyView SVFRT_view_struct(SVFRT_LazyView view, uint32_t offset);
+
+// View the target of a reference to a struct.
+SVFRT_LazyView SVFRT_view_reference(SVFRT_LazyView view, uint32_t offset);
+
+uint32_t SVFRT_view_sequence_count(SVFRT_LazyView view, uint32_t offset);
+
+// View an element of a sequence of structs.
+SVFRT_LazyView SVFRT_view_sequence_element(SVFRT_LazyView view, uint32_t offset, uint32_t index);
+
+// Convert `count` elements of a sequence starting at `first`, like `SVFRT_view_read`.
+// `out_size` must be exactly `count` elements.
+void SVFRT_view_sequence_read(
+  SVFRT_LazyView view,
+  uint32_t offset,
+  uint32_t first,
+  uint32_t count,
+  void *out,
+  uint32_t out_size
+);
+
+// Convert the struct with everything reachable from it into an allocation from
+// `allocator_fn` in the params, so it can be read like the entry of a message.
+// The result is the same as for that part of the fully converted message.
+// Without a conversion, nothing is allocated, and the result is in the message.
+//
+// Allocations must be freed by the caller, same as for `SVFRT_read_message`.
+// If there is room for a memo in the memory given to `SVFRT_read_message_lazy`,
+// each converted struct is kept there, and materializing it again (e.g. when
+// it's reached by another reference) returns the same result without
+// converting or allocating, so `allocation` is NULL. The first allocation must
+// then stay alive as long as any of these results are used, which suits an
+// arena allocator. Without room, the struct is converted again.
+void SVFRT_view_materialize(SVFRT_LazyView view, SVFRT_ReadMessageResult *out_result);
+
 typedef uint32_t (SVFRT_WriterFn)(void *write_pointer, SVFRT_Bytes data);
 
+// Must replace `*inout_buffer` with a buffer of at least `min_count` bytes,
+// which starts with the contents of the old one (e.g. using `realloc`), or
+// return false. See #buffered-writing.
+typedef bool (SVFRT_GrowBufferFn)(void *grow_ptr, SVFRT_Bytes *inout_buffer, uint32_t min_count);
+
 typedef struct SVFRT_WriteContext {
   SVFRT_ErrorCode error_code;
   bool finished;
   void *writer_ptr;
   SVFRT_WriterFn *writer_fn;
   uint32_t data_bytes_written;
+
+  // Only for #buffered-writing, zero otherwise. The first `buffer_used` bytes
+  // of `buffer` are written, but not yet flushed to `writer_fn`.
+  SVFRT_Bytes buffer;
+  uint32_t buffer_used;
+  SVFRT_GrowBufferFn *grow_fn;
+  void *grow_ptr;
 } SVFRT_WriteContext;
 
 // Start writing a message. Intended to be followed by `SVFRT_write_*` calls,
@@ -286,6 +1031,268 @@ void SVFRT_write_start(
   uint64_t entry_struct_id
 );
 
+// #buffered-writing: same as `SVFRT_write_start`, but the message is written
+// to the caller-owned `buffer` with plain copies, instead of calling a function
+// for each piece of data.
+//
+// When the buffer is full, it is flushed to `writer_fn`, if given. Otherwise,
+// it is grown with `grow_fn`, if given, at least twice as large. Otherwise,
+// writing fails with `SVFRT_code_write__buffer_full`. Without `writer_fn`, the
+// whole message is in `result->buffer` after `SVFRT_write_finish`, and takes
+// up `result->buffer_used` bytes.
+//
+// With `writer_fn`, the buffer must be at least `2 * SVFRT_MESSAGE_PART_ALIGNMENT`
+// bytes large. It should be aligned to `SVFRT_MESSAGE_PART_ALIGNMENT`, so that
+// pointers from #reserved-writing are aligned.
+void SVFRT_write_start_buffered(
+  SVFRT_WriteContext *result,
+  SVFRT_Bytes buffer,
+  SVFRT_GrowBufferFn *grow_fn, // Optional.
+  void *grow_ptr,              // Optional.
+  SVFRT_WriterFn *writer_fn,   // Optional.
+  void *writer_ptr,            // Optional.
+  uint64_t schema_content_hash,
+  SVFRT_Bytes schema_bytes,
+  SVFRT_Bytes appendix_bytes,
+  uint64_t entry_struct_id
+);
+
+// Pass buffered bytes on to `writer_fn`. Until the message is finished, up to
+// `SVFRT_MESSAGE_PART_ALIGNMENT - 1` bytes may stay in the buffer, to keep it
+// aligned the same way as the message. Does nothing without a buffer or
+// without `writer_fn`. Called by `SVFRT_write_finish`.
+void SVFRT_write_flush(SVFRT_WriteContext *ctx);
+
+// #reserved-writing: same as `SVFRT_write_reference` and `SVFRT_write_sequence`,
+// but instead of copying the data, return a pointer to where it goes in the
+// buffer, so it can be filled in place. Only for #buffered-writing, otherwise
+// fails with `SVFRT_code_write__not_buffered`. Returns NULL on an error.
+//
+// The pointer is only valid until the next call with `ctx`, since the buffer
+// may be flushed or grown then, so the data must be filled before that. The
+// reserved bytes are not initialized, so all of them must be filled, including
+// any padding inside of structs. With `writer_fn` and without `grow_fn`, the
+// reserved data must fit into the buffer.
+void *SVFRT_write_reference_reserve(
+  SVFRT_WriteContext *ctx,
+  uint32_t type_size,
+  SVFRT_Reference *out_reference
+);
+
+void *SVFRT_write_sequence_reserve(
+  SVFRT_WriteContext *ctx,
+  uint32_t type_size,
+  uint32_t count,
+  SVFRT_Sequence *out_sequence
+);
+
+// Slow path of the inline writing functions below, for #buffered-writing,
+// when the data is large, or does not fit. Returns false on an error.
+bool SVFRT_internal_write_buffered(SVFRT_WriteContext *ctx, SVFRT_Bytes bytes);
+
+typedef struct SVFRT_WriteContext64 {
+  SVFRT_ErrorCode error_code;
+  bool finished;
+  void *writer_ptr;
+  SVFRT_WriterFn *writer_fn;
+  uint64_t data_bytes_written;
+} SVFRT_WriteContext64;
+
+// Same as `SVFRT_write_start`, but for a wide message, see #wide-messages.
+// Intended to be followed by `SVFRT_write_*64` calls. `writer_fn` is called
+// with at most `SVFRT_WRITE_CHUNK_SIZE64` bytes at a time.
+void SVFRT_write_start64(
+  SVFRT_WriteContext64 *result,
+  SVFRT_WriterFn *writer_fn,
+  void *writer_ptr,
+  uint64_t schema_content_hash,
+  SVFRT_Bytes schema_bytes,
+  SVFRT_Bytes appendix_bytes,
+  uint64_t entry_struct_id
+);
+
+// Archive, see #archive.
+//
+// A file of many messages ("records"), appended one by one. Each distinct
+// schema is stored once per archive, and records are regular messages without
+// the schema part, so the archive itself serves as their schema lookup. The
+// index is written at the very end, so writing stays append-only, and reading
+// any record by its number is O(1).
+//
+// Layout: the header, then schemas and records in the order they were
+// appended, each aligned to `SVFRT_MESSAGE_PART_ALIGNMENT`, then the schema
+// index, the record index, and finally the footer, which takes up the last
+// `sizeof(SVFRT_ArchiveFooter)` bytes. All offsets are from the start of the file.
+//
+// Thread safety: an opened archive is read-only, same as the schema registry.
+
+#define SVFRT_ARCHIVE_VERSION 1
+
+typedef struct SVFRT_ArchiveHeader {
+  uint8_t magic[4]; // "SVFA".
+  uint32_t version;
+} SVFRT_ArchiveHeader;
+
+typedef struct SVFRT_ArchiveSchema {
+  uint64_t schema_content_hash;
+  uint64_t schema_offset;
+  uint32_t schema_length;
+  uint32_t _reserved;
+} SVFRT_ArchiveSchema;
+
+typedef struct SVFRT_ArchiveRecord {
+  uint64_t message_offset;
+  uint32_t message_length;
+  uint32_t _reserved;
+} SVFRT_ArchiveRecord;
+
+typedef struct SVFRT_ArchiveFooter {
+  uint32_t schema_count;
+  uint32_t record_count;
+  uint32_t version;
+  uint8_t magic[4]; // "SVFA", so that the file also ends with it.
+} SVFRT_ArchiveFooter;
+
+typedef struct SVFRT_ArchiveWriter {
+  SVFRT_ErrorCode error_code;
+  bool record_started;
+  SVFRT_WriterFn *writer_fn;
+  void *writer_ptr;
+  uint64_t bytes_written;
+  uint64_t record_offset;
+
+  // The index is kept in user-provided memory until `SVFRT_archive_write_finish`.
+  SVFRT_ArchiveSchema *schemas;
+  uint32_t schema_capacity;
+  uint32_t schema_count;
+  SVFRT_ArchiveRecord *records;
+  uint32_t record_capacity;
+  uint32_t record_count;
+} SVFRT_ArchiveWriter;
+
+// Start writing an archive, by writing its header. `schemas` and `records`
+// must have room for as many distinct schemas and records as will be appended,
+// otherwise appending fails with `SVFRT_code_archive__index_full`.
+//
+// Errors are sticky: after the first one, all further calls do nothing, and
+// `writer->error_code` keeps it.
+void SVFRT_archive_write_start(
+  SVFRT_ArchiveWriter *writer,
+  SVFRT_WriterFn *writer_fn,
+  void *writer_ptr,
+  SVFRT_ArchiveSchema *schemas,
+  uint32_t schema_capacity,
+  SVFRT_ArchiveRecord *records,
+  uint32_t record_capacity
+);
+
+// Start appending a record, same as `SVFRT_write_start`, with `ctx` then used
+// for `SVFRT_write_*` calls and `SVFRT_write_finish`, followed by
+// `SVFRT_archive_record_finish`. The schema is written to the archive, unless
+// it is already there. It may be empty, same as for `SVFRT_write_start`, in
+// which case, readers will need another way to look it up.
+void SVFRT_archive_record_start(
+  SVFRT_ArchiveWriter *writer,
+  SVFRT_WriteContext *ctx,
+  uint64_t schema_content_hash,
+  SVFRT_Bytes schema_bytes,
+  uint64_t entry_struct_id
+);
+
+// Finish appending the record, after `SVFRT_write_finish` on `ctx`. If writing
+// the record failed, the archive fails with the same error.
+void SVFRT_archive_record_finish(
+  SVFRT_ArchiveWriter *writer,
+  SVFRT_WriteContext *ctx
+);
+
+// Finish the archive, by writing the index and the footer. Returns the error
+// code, if anything failed along the way.
+SVFRT_ErrorCode SVFRT_archive_write_finish(SVFRT_ArchiveWriter *writer);
+
+typedef struct SVFRT_Archive {
+  SVFRT_Bytes64 file;
+  SVFRT_ArchiveSchema const *schemas;
+  uint32_t schema_count;
+  SVFRT_ArchiveRecord const *records;
+  uint32_t record_count;
+} SVFRT_Archive;
+
+// Open an archive from the contents of the whole file, which must be aligned to
+// `SVFRT_MESSAGE_PART_ALIGNMENT`, and stay alive as long as the archive (and
+// anything read from it) is used. The index itself is validated here, but
+// individual records are only validated when accessed, so that opening does not
+// depend on the record count.
+SVFRT_ErrorCode SVFRT_archive_open(
+  SVFRT_Archive *archive,
+  SVFRT_Bytes file
+);
+
+// Same as `SVFRT_archive_open`, but for archives of any size, e.g. from
+// `SVFRT_map_file64`. The writer has no such limit, since each record is a
+// separate message, so archives larger than `UINT32_MAX` bytes need this.
+SVFRT_ErrorCode SVFRT_archive_open64(
+  SVFRT_Archive *archive,
+  SVFRT_Bytes64 file
+);
+
+// Compatible with `SVFRT_SchemaLookupFn`, with `archive` pointing to an opened
+// `SVFRT_Archive`. Returns empty bytes if the schema is not found.
+SVFRT_Bytes SVFRT_archive_lookup(
+  void *archive,
+  uint64_t schema_content_hash
+);
+
+// The whole message of the record, or empty bytes, if `record_index` is out of
+// range, or the record is malformed.
+SVFRT_Bytes SVFRT_archive_get_message(
+  SVFRT_Archive const *archive,
+  uint32_t record_index
+);
+
+// Read the record, same as `SVFRT_read_message` would. Schemas are looked up in
+// the archive first, and then via `params->schema_lookup_fn`, if present.
+void SVFRT_archive_read_record(
+  SVFRT_Archive *archive,
+  SVFRT_ReadMessageParams *params,
+  SVFRT_ReadMessageResult *out_result,
+  uint32_t record_index,
+  SVFRT_Bytes scratch
+);
+
+// Called by `SVFRT_ArchiveIterator` ahead of the records it is about to read,
+// e.g. to prefetch a mapped file. See `SVFRT_read_ahead_mapped` in "svf_mmap.h".
+typedef void (SVFRT_ReadAheadFn)(void *read_ahead_ptr, SVFRT_Bytes range);
+
+typedef struct SVFRT_ArchiveIterator {
+  SVFRT_Archive *archive;
+  uint32_t next_record;
+  uint32_t read_ahead_size;
+  uint64_t read_ahead_end;
+  SVFRT_ReadAheadFn *read_ahead_fn;
+  void *read_ahead_ptr;
+} SVFRT_ArchiveIterator;
+
+// Start iterating over all records in order. Every `read_ahead_size` bytes of
+// records (roughly), `read_ahead_fn` is called for the next ones.
+void SVFRT_archive_iterator_init(
+  SVFRT_ArchiveIterator *iterator,
+  SVFRT_Archive *archive,
+  uint32_t read_ahead_size,
+  SVFRT_ReadAheadFn *read_ahead_fn, // Optional.
+  void *read_ahead_ptr              // Optional.
+);
+
+// Read the next record, same as `SVFRT_archive_read_record`. Returns false,
+// when there are no more records. If `scratch` is reused between calls, the
+// previous result can't be used anymore.
+bool SVFRT_archive_iterator_next(
+  SVFRT_ArchiveIterator *iterator,
+  SVFRT_ReadMessageParams *params,
+  SVFRT_ReadMessageResult *out_result,
+  SVFRT_Bytes scratch
+);
+
 static inline
 void SVFRT_internal_write_tally(
   SVFRT_WriteContext *ctx,
@@ -310,12 +1317,72 @@ void SVFRT_internal_write_tally(
   }
 }
 
+// Larger pieces of data are copied by `SVFRT_internal_write_buffered`.
+#define SVFRT_WRITE_INLINE_COPY_SIZE 64
+
+// Pass already tallied bytes on, either to the buffer, see #buffered-writing,
+// or to `writer_fn`. Returns false on an error.
+static inline
+bool SVFRT_internal_write_bytes(
+  SVFRT_WriteContext *ctx,
+  SVFRT_Bytes bytes
+) {
+  if (ctx->buffer.pointer) {
+    if (
+      bytes.count <= SVFRT_WRITE_INLINE_COPY_SIZE &&
+      bytes.count <= ctx->buffer.count - ctx->buffer_used
+    ) {
+      uint8_t *dst = ctx->buffer.pointer + ctx->buffer_used;
+      for (uint32_t i = 0; i < bytes.count; i++) {
+        dst[i] = bytes.pointer[i];
+      }
+      ctx->buffer_used += bytes.count;
+      return true;
+    }
+    return SVFRT_internal_write_buffered(ctx, bytes);
+  }
+
+  uint32_t written = ctx->writer_fn(ctx->writer_ptr, bytes);
+  if (written != bytes.count) {
+    ctx->error_code = SVFRT_code_write__writer_function_failed;
+    return false;
+  }
+  return true;
+}
+
+// Pad the data up to the #natural-alignment of `type_size`.
+static inline
+void SVFRT_internal_write_align(
+  SVFRT_WriteContext *ctx,
+  uint32_t type_size
+) {
+  uint8_t zeros[SVFRT_MESSAGE_PART_ALIGNMENT] = {0};
+  uint32_t alignment = SVFRT_natural_alignment(type_size);
+  SVFRT_Bytes padding_bytes = {
+    /*.pointer =*/ (uint8_t *) zeros,
+    /*.count =*/ (alignment - ctx->data_bytes_written % alignment) % alignment,
+  };
+
+  if (ctx->error_code || padding_bytes.count == 0) {
+    return;
+  }
+
+  SVFRT_internal_write_tally(ctx, padding_bytes.count);
+  if (ctx->error_code) {
+    return;
+  }
+
+  SVFRT_internal_write_bytes(ctx, padding_bytes);
+}
+
 static inline
 SVFRT_Reference SVFRT_write_reference(
   SVFRT_WriteContext *ctx,
   void *pointer,
   uint32_t type_size
 ) {
+  SVFRT_internal_write_align(ctx, type_size);
+
   SVFRT_Reference result = { ~ctx->data_bytes_written };
   SVFRT_Bytes bytes = { (uint8_t *) pointer, type_size };
 
@@ -325,11 +1392,7 @@ SVFRT_Reference SVFRT_write_reference(
     return result;
   }
 
-  // TODO @proper-alignment: align up first.
-  uint32_t written = ctx->writer_fn(ctx->writer_ptr, bytes);
-
-  if (written != bytes.count) {
-    ctx->error_code = SVFRT_code_write__writer_function_failed;
+  if (!SVFRT_internal_write_bytes(ctx, bytes)) {
     result.data_offset_complement = 0;
   }
 
@@ -343,6 +1406,10 @@ SVFRT_Sequence SVFRT_write_sequence(
   uint32_t type_size,
   uint32_t count
 ) {
+  if (count > 0) {
+    SVFRT_internal_write_align(ctx, type_size);
+  }
+
   SVFRT_Sequence result = { ~ctx->data_bytes_written, count };
 
   // Prevent addition overflow by casting operands to `uint64_t` first.
@@ -363,11 +1430,7 @@ SVFRT_Sequence SVFRT_write_sequence(
     return result;
   }
 
-  // TODO @proper-alignment: align up first.
-  uint32_t written = ctx->writer_fn(ctx->writer_ptr, bytes);
-
-  if (written != bytes.count) {
-    ctx->error_code = SVFRT_code_write__writer_function_failed;
+  if (!SVFRT_internal_write_bytes(ctx, bytes)) {
     result.count = UINT32_MAX;
     result.data_offset_complement = 0;
   }
@@ -407,6 +1470,15 @@ void SVFRT_write_sequence_element(
     // tally will overflow anyway, so we don't need to check it explicitly here.
     inout_sequence->count += 1;
   } else {
+    // Only the first element needs padding, the rest stay aligned, since the
+    // alignment divides the type size.
+    SVFRT_internal_write_align(ctx, type_size);
+    if (ctx->error_code) {
+      inout_sequence->count = UINT32_MAX;
+      inout_sequence->data_offset_complement = 0;
+      return;
+    }
+
     inout_sequence->data_offset_complement = ~ctx->data_bytes_written;
     inout_sequence->count = 1;
   }
@@ -420,11 +1492,7 @@ void SVFRT_write_sequence_element(
     return;
   }
 
-  // TODO @proper-alignment: align up first.
-  uint32_t written = ctx->writer_fn(ctx->writer_ptr, bytes);
-
-  if (written != bytes.count) {
-    ctx->error_code = SVFRT_code_write__writer_function_failed;
+  if (!SVFRT_internal_write_bytes(ctx, bytes)) {
     inout_sequence->count = UINT32_MAX;
     inout_sequence->data_offset_complement = 0;
     return;
@@ -441,6 +1509,10 @@ void SVFRT_write_finish(
   if (!ctx->error_code) {
     ctx->finished = true;
   }
+  if (ctx->finished && ctx->buffer.pointer && ctx->writer_fn) {
+    SVFRT_write_flush(ctx);
+    ctx->finished = !ctx->error_code;
+  }
 }
 
 static inline
@@ -530,6 +1602,923 @@ void const *SVFRT_read_sequence_element(
   return (void *) (ctx->data_range.pointer + (uint32_t) item_end_offset - stride);
 }
 
+// Same as `SVFRT_read_sequence_raw`, but also fails (returns NULL), unless the
+// data is aligned to the #natural-alignment of `type_stride`, so that it can be
+// read in place with aligned (e.g. vector) loads. Data from the writer and from
+// the conversion always is, unless the sequence is empty.
+static inline
+void const *SVFRT_read_sequence_aligned(
+  SVFRT_ReadContext *ctx,
+  SVFRT_Sequence sequence,
+  uint32_t type_stride
+) {
+  void const *pointer = SVFRT_read_sequence_raw(ctx, sequence, type_stride);
+  if (((uintptr_t) pointer) % SVFRT_natural_alignment(type_stride) != 0) {
+    return NULL;
+  }
+  return pointer;
+}
+
+// #chunked-sequences: `T[~]` in a schema. Unlike `T[]`, the elements don't
+// have to be written back to back, so any number of chunked sequences can be
+// appended to at the same time, in any order, with constant memory per
+// sequence on the writer side.
+//
+// Layout: the elements are stored in chunks, each of them contiguous. Every
+// chunk is followed (not necessarily immediately) by its link, see
+// `SVFRT_ChunkLink`. The field points to the link of the last chunk, and has
+// the total count of elements. Each link points to the previous one, so the
+// chain can be written without going back, but is read from the end. Links of
+// earlier chunks are always at lower offsets, and their indices go down by
+// one, so that malformed chains can't loop. An empty chunked sequence has no
+// links, and is `{0, 0}`.
+//
+// Chunks are read as regular `SVFRT_Sequence`s, so all the `SVFRT_read_sequence_*`
+// functions apply to them. Getting a chunk by its index walks the chain, so for
+// repeated random access, collect all of them with `SVFRT_read_chunked_sequence_chunks`.
+//
+// Compatibility: `T[~]` can be read as `T[]` with `SVFRT_compatibility_logical`,
+// then the conversion puts all elements into a single contiguous sequence. It
+// can't be used with #wide-messages.
+
+typedef struct SVFRT_ChunkLink {
+  uint32_t previous_complement; // Link of the previous chunk, zero for the first one.
+  uint32_t data_offset_complement;
+  uint32_t count; // Never zero.
+  uint32_t index; // Of this chunk, from zero.
+} SVFRT_ChunkLink;
+
+// Writer side state of a chunked sequence. Must be zero-initialized. Elements
+// are added to the current chunk, while they are written contiguously, and a
+// new chunk starts otherwise.
+typedef struct SVFRT_ChunkedSequenceBuilder {
+  uint32_t last_link_complement;
+  uint32_t chunk_offset; // Of the current chunk, which is not linked yet.
+  uint32_t chunk_count;  // Zero if there is no current chunk.
+  uint32_t chunk_index;
+  uint32_t count;
+} SVFRT_ChunkedSequenceBuilder;
+
+// Write the link of the current chunk, if there is one.
+static inline
+void SVFRT_internal_write_chunk_link(
+  SVFRT_WriteContext *ctx,
+  SVFRT_ChunkedSequenceBuilder *builder
+) {
+  if (builder->chunk_count == 0) {
+    return;
+  }
+
+  SVFRT_ChunkLink link = {
+    /*.previous_complement =*/ builder->last_link_complement,
+    /*.data_offset_complement =*/ ~builder->chunk_offset,
+    /*.count =*/ builder->chunk_count,
+    /*.index =*/ builder->chunk_index,
+  };
+
+  SVFRT_Reference reference = SVFRT_write_reference(ctx, &link, sizeof(link));
+  if (ctx->error_code) {
+    return;
+  }
+
+  builder->last_link_complement = reference.data_offset_complement;
+  builder->chunk_count = 0;
+  builder->chunk_index += 1;
+}
+
+static inline
+void SVFRT_write_chunked_sequence_elements(
+  SVFRT_WriteContext *ctx,
+  SVFRT_ChunkedSequenceBuilder *builder,
+  void *pointer,
+  uint32_t type_size,
+  uint32_t count
+) {
+  if (ctx->error_code || count == 0) {
+    return;
+  }
+
+  // Prevent addition overflow by casting operands to `uint64_t` first.
+  uint64_t total_size = (uint64_t) type_size * (uint64_t) count;
+  if (total_size > (uint64_t) UINT32_MAX || builder->count + count < count) {
+    ctx->error_code = SVFRT_code_write__data_would_overflow;
+    return;
+  }
+
+  // Prevent multiply-add overflow, same as in `SVFRT_write_sequence_element`.
+  uint64_t chunk_end_offset = (uint64_t) builder->chunk_offset + (
+    (uint64_t) type_size * (uint64_t) builder->chunk_count
+  );
+
+  // Continue the current chunk, if nothing else was written since.
+  if (
+    builder->chunk_count == 0 ||
+    chunk_end_offset != (uint64_t) ctx->data_bytes_written
+  ) {
+    SVFRT_internal_write_chunk_link(ctx, builder);
+    SVFRT_internal_write_align(ctx, type_size);
+    if (ctx->error_code) {
+      return;
+    }
+    builder->chunk_offset = ctx->data_bytes_written;
+  }
+
+  SVFRT_Bytes bytes = { (uint8_t *) pointer, (uint32_t) total_size };
+
+  SVFRT_internal_write_tally(ctx, bytes.count);
+  if (ctx->error_code) {
+    return;
+  }
+
+  if (!SVFRT_internal_write_bytes(ctx, bytes)) {
+    return;
+  }
+
+  builder->chunk_count += count;
+  builder->count += count;
+}
+
+// Write the link of the last chunk, and return the value for the field. Must
+// be called once, after all elements are written, and before the struct with
+// the field is written. Returns `{0, UINT32_MAX}` on an error.
+static inline
+SVFRT_ChunkedSequence SVFRT_write_chunked_sequence_finish(
+  SVFRT_WriteContext *ctx,
+  SVFRT_ChunkedSequenceBuilder *builder
+) {
+  SVFRT_internal_write_chunk_link(ctx, builder);
+
+  SVFRT_ChunkedSequence result = { builder->last_link_complement, builder->count };
+  if (ctx->error_code) {
+    result.data_offset_complement = 0;
+    result.count = UINT32_MAX;
+  }
+  return result;
+}
+
+// Walks the chunks of a chunked sequence, from the last one to the first one.
+typedef struct SVFRT_ChunkIterator {
+  uint32_t link_complement; // Next link to read, zero at the end.
+  uint32_t remaining;       // Elements in the chunks not visited yet.
+  uint32_t chunk_index;     // Of the chunk returned last.
+  bool started;
+} SVFRT_ChunkIterator;
+
+static inline
+SVFRT_ChunkIterator SVFRT_chunk_iterator_begin(SVFRT_ChunkedSequence sequence) {
+  SVFRT_ChunkIterator result = {
+    /*.link_complement =*/ sequence.count ? sequence.data_offset_complement : 0,
+    /*.remaining =*/ sequence.count,
+    /*.chunk_index =*/ 0,
+    /*.started =*/ false,
+  };
+  return result;
+}
+
+// Get the next chunk (going backwards), and its index in `iterator->chunk_index`.
+// Returns false at the end. If the chain is malformed, also returns false, but
+// `iterator->remaining` is not zero then.
+static inline
+bool SVFRT_chunk_iterator_next(
+  SVFRT_ReadContext *ctx,
+  SVFRT_ChunkIterator *iterator,
+  SVFRT_Sequence *out_chunk
+) {
+  if (iterator->link_complement == 0) {
+    return false;
+  }
+
+  uint32_t link_offset = ~iterator->link_complement;
+  iterator->link_complement = 0;
+
+  // Prevent addition overflow by casting operands to `uint64_t` first.
+  if (
+    (uint64_t) link_offset + sizeof(SVFRT_ChunkLink) >
+    (uint64_t) ctx->data_range.count
+  ) {
+    return false;
+  }
+
+  SVFRT_ChunkLink const *link_pointer = (SVFRT_ChunkLink const *) SVFRT_read_check_alignment(
+    ctx->data_range.pointer + link_offset,
+    SVFRT_ALIGNOF(SVFRT_ChunkLink)
+  );
+  if (!link_pointer) {
+    return false;
+  }
+
+  SVFRT_ChunkLink link = *link_pointer;
+
+  // The first chunk must have exactly the remaining elements.
+  if (
+    link.count == 0 ||
+    link.count > iterator->remaining ||
+    (iterator->started && link.index != iterator->chunk_index - 1) ||
+    ((link.index == 0) != (link.count == iterator->remaining)) ||
+    ((link.index == 0) != (link.previous_complement == 0)) ||
+    (link.index != 0 && ~link.previous_complement >= link_offset)
+  ) {
+    return false;
+  }
+
+  out_chunk->data_offset_complement = link.data_offset_complement;
+  out_chunk->count = link.count;
+  iterator->link_complement = link.previous_complement;
+  iterator->remaining -= link.count;
+  iterator->chunk_index = link.index;
+  iterator->started = true;
+  return true;
+}
+
+// Number of chunks, or zero if the sequence is empty, or its last link can't
+// be read. The rest of the chain is not checked.
+static inline
+uint32_t SVFRT_read_chunked_sequence_chunk_count(
+  SVFRT_ReadContext *ctx,
+  SVFRT_ChunkedSequence sequence
+) {
+  SVFRT_ChunkIterator iterator = SVFRT_chunk_iterator_begin(sequence);
+  SVFRT_Sequence chunk;
+  if (!SVFRT_chunk_iterator_next(ctx, &iterator, &chunk)) {
+    return 0;
+  }
+  return iterator.chunk_index + 1;
+}
+
+// Get a chunk by its index. This walks the chain from the end, so it takes
+// longer for earlier chunks. Returns false if there is no such chunk, or the
+// chain is malformed.
+static inline
+bool SVFRT_read_chunked_sequence_chunk(
+  SVFRT_ReadContext *ctx,
+  SVFRT_ChunkedSequence sequence,
+  uint32_t chunk_index,
+  SVFRT_Sequence *out_chunk
+) {
+  SVFRT_ChunkIterator iterator = SVFRT_chunk_iterator_begin(sequence);
+  while (SVFRT_chunk_iterator_next(ctx, &iterator, out_chunk)) {
+    if (iterator.chunk_index == chunk_index) {
+      return true;
+    }
+    if (iterator.chunk_index < chunk_index) {
+      break;
+    }
+  }
+  return false;
+}
+
+// Get all chunks, in order, for random access. `out_chunks` must have room for
+// at least `SVFRT_read_chunked_sequence_chunk_count` elements. Returns the
+// number of chunks, or `UINT32_MAX` if they don't fit, or the chain is malformed.
+static inline
+uint32_t SVFRT_read_chunked_sequence_chunks(
+  SVFRT_ReadContext *ctx,
+  SVFRT_ChunkedSequence sequence,
+  SVFRT_Sequence *out_chunks,
+  uint32_t capacity
+) {
+  SVFRT_ChunkIterator iterator = SVFRT_chunk_iterator_begin(sequence);
+  uint32_t chunk_count = 0;
+  SVFRT_Sequence chunk;
+  while (SVFRT_chunk_iterator_next(ctx, &iterator, &chunk)) {
+    if (iterator.chunk_index >= capacity) {
+      return UINT32_MAX;
+    }
+    if (chunk_count == 0) {
+      chunk_count = iterator.chunk_index + 1;
+    }
+    out_chunks[iterator.chunk_index] = chunk;
+  }
+  if (iterator.remaining != 0) {
+    return UINT32_MAX;
+  }
+  return chunk_count;
+}
+
+// #sharded-writing: build parts of a message on several threads at once.
+//
+// Each thread writes subtrees into its own shard, with the regular `SVFRT_write_*`
+// functions on `shard->ctx`. The handles it gets are relative to the shard.
+// When all threads are done, the shards are appended to the message with
+// `SVFRT_write_shards`. This sets `base` of each shard, so that the handles of
+// subtree roots can be turned into message handles, e.g. `SVFRT_shard_reference`,
+// for use in the rest of the message. After `SVFRT_write_finish`, the handles
+// inside of shards are fixed up by `SVFRT_write_relocate_shards`, which walks
+// the finished message from the entry, using the schema.
+//
+// Data in a shard may only refer to data in the same shard. Like any message,
+// the data must not be aliased, see `SVFRT_code_verify__data_aliasing_detected`.
+// Until relocated, the message can't be read.
+
+typedef struct SVFRT_WriteShard {
+  SVFRT_WriteContext ctx;
+  uint32_t base; // Data offset of the shard in the message, see `SVFRT_write_shards`.
+} SVFRT_WriteShard;
+
+// Start writing a shard. Same as #buffered-writing without `writer_fn`, but
+// there is no header, so the data starts at the beginning of `buffer`.
+void SVFRT_write_shard_start(
+  SVFRT_WriteShard *result,
+  SVFRT_Bytes buffer,
+  SVFRT_GrowBufferFn *grow_fn, // Optional.
+  void *grow_ptr               // Optional.
+);
+
+// Append the data of `shard_count` shards to the message, in order, each one
+// aligned to `SVFRT_MESSAGE_PART_ALIGNMENT`, and set their `base`. If any of
+// the shards has an error, it is passed on to `ctx`. Afterwards, the shard
+// buffers are not used anymore, but `shards` must be passed on to
+// `SVFRT_write_relocate_shards` later.
+void SVFRT_write_shards(
+  SVFRT_WriteContext *ctx,
+  SVFRT_WriteShard *shards,
+  uint32_t shard_count
+);
+
+// Fix up all handles inside of shards in a finished `message`, which must
+// have been written with `schema`. `shards` must be in the order they were
+// appended. Handles outside of shards are not changed. Returns
+// `SVFRT_code_write__bad_shard_handle`, if a handle in a shard points outside
+// of it, and `SVFRT_code_write__relocation_failed`, if the message can't be
+// walked. In both cases, the message is partially relocated.
+SVFRT_ErrorCode SVFRT_write_relocate_shards(
+  SVFRT_Bytes message,
+  SVFRT_WriteShard const *shards,
+  uint32_t shard_count,
+  SVFRT_Bytes schema,
+  uint32_t entry_struct_index,
+  uint32_t max_recursion_depth
+);
+
+// Turn a handle from `shard` into a message handle, after `SVFRT_write_shards`.
+static inline
+SVFRT_Reference SVFRT_shard_reference(
+  SVFRT_WriteShard const *shard,
+  SVFRT_Reference reference
+) {
+  SVFRT_Reference result = { ~(~reference.data_offset_complement + shard->base) };
+  return result;
+}
+
+static inline
+SVFRT_Sequence SVFRT_shard_sequence(
+  SVFRT_WriteShard const *shard,
+  SVFRT_Sequence sequence
+) {
+  SVFRT_Sequence result = {
+    /*.data_offset_complement =*/ ~(~sequence.data_offset_complement + shard->base),
+    /*.count =*/ sequence.count,
+  };
+  return result;
+}
+
+// Empty chunked sequences are `{0, 0}` anywhere, so they stay as they are.
+static inline
+SVFRT_ChunkedSequence SVFRT_shard_chunked_sequence(
+  SVFRT_WriteShard const *shard,
+  SVFRT_ChunkedSequence sequence
+) {
+  if (sequence.count == 0) {
+    return sequence;
+  }
+  SVFRT_ChunkedSequence result = {
+    /*.data_offset_complement =*/ ~(~sequence.data_offset_complement + shard->base),
+    /*.count =*/ sequence.count,
+  };
+  return result;
+}
+
+// #subtree-copying: copy everything reachable from a handle in a message that
+// is being read into a message that is being written, e.g. to forward a part
+// of it. The result is a handle in the new message.
+//
+// Ranges without any handles in them, even nested (e.g. strings, or sequences
+// of flat structs), are copied as a whole. Other ranges are copied to `scratch`
+// first, where their handles are replaced with ones for the new message, after
+// copying what they point to. So `scratch` must fit the largest such range at
+// each level of nesting, all at once. Chunked sequences also need room for all
+// of their chunks, see `SVFRT_read_chunked_sequence_chunks`.
+//
+// The data is written with the schema it is read with, so with
+// `SVFRT_compatibility_binary`, only the known part of each struct is copied.
+// With `SVFRT_compatibility_logical`, the data is already converted when the
+// message is read.
+//
+// Errors are set on `dst`: `SVFRT_code_write__bad_subtree` if the source can't
+// be walked (see #message-verification), `SVFRT_code_write__not_enough_scratch`,
+// or any of the writing errors.
+
+typedef struct SVFRT_CopyParams {
+  SVFRT_Bytes schema; // The schema `src` is read with, and `dst` is written with.
+  SVFRT_Bytes scratch;
+  uint32_t max_recursion_depth;
+} SVFRT_CopyParams;
+
+SVFRT_Reference SVFRT_copy_reference(
+  SVFRT_WriteContext *dst,
+  SVFRT_CopyParams *params,
+  SVFRT_ReadContext *src,
+  SVFRT_Reference reference,
+  uint32_t struct_index
+);
+
+SVFRT_Sequence SVFRT_copy_sequence(
+  SVFRT_WriteContext *dst,
+  SVFRT_CopyParams *params,
+  SVFRT_ReadContext *src,
+  SVFRT_Sequence sequence,
+  uint32_t struct_index
+);
+
+SVFRT_ChunkedSequence SVFRT_copy_chunked_sequence(
+  SVFRT_WriteContext *dst,
+  SVFRT_CopyParams *params,
+  SVFRT_ReadContext *src,
+  SVFRT_ChunkedSequence sequence,
+  uint32_t struct_index
+);
+
+// #write-interning: opt-in deduplication of repeated data while writing, e.g.
+// strings that occur many times. `SVFRT_write_reference_interned` and
+// `SVFRT_write_sequence_interned` look the bytes up in a table of ranges that
+// were written the same way before, and return a handle to the existing range
+// on a match, instead of writing it again. Structs that only differ in handles
+// to interned data become identical too, so whole subtrees are shared when
+// written bottom-up.
+//
+// The table has a fixed size, provided by the caller, and is never grown. When
+// its slots are taken, newer ranges replace older ones. Only ranges that are
+// still in the buffer can be matched, since the bytes are always compared, so
+// this needs #buffered-writing (otherwise, it's the same as regular writing).
+// With `writer_fn`, only the part of the message which has not been flushed
+// yet is considered.
+//
+// Warning! An interned message has aliased data, which the format otherwise
+// rules out, see `SVFRT_code_verify__data_aliasing_detected`. Such a message
+// can still be read with the exact or a binary-compatible schema, and the
+// checked accessors, and with logical conversion, if the reader provides
+// `conversion_memo` (see #conversion-memoization). But anything else that
+// walks the whole message (verification, #subtree-copying, #sharded-writing
+// relocation, and #message-patching compaction) rejects it, because its work
+// is bounded by the data size. So only intern data for readers that are known
+// to support it, and patch such messages in place only, since a change to a
+// shared range is seen through all handles to it.
+
+typedef struct SVFRT_InternEntry {
+  uint64_t hash;
+  uint32_t data_offset;
+  uint32_t size; // Zero for an empty slot.
+} SVFRT_InternEntry;
+
+typedef struct SVFRT_InternTable {
+  SVFRT_InternEntry *entries;
+  uint32_t capacity; // Power of two.
+  uint32_t min_size; // Smaller ranges are written as usual.
+
+  // Statistics, for tuning `min_size` and the table size.
+  uint32_t hit_count;
+  uint64_t bytes_saved;
+} SVFRT_InternTable;
+
+// Use `memory` for the table entries, as many as fit, rounded down to a power
+// of two. The memory must stay valid while the table is used. A table must
+// only be used with one write context. Returns false if `memory` is too small.
+bool SVFRT_intern_table_init(
+  SVFRT_InternTable *result,
+  SVFRT_Bytes memory,
+  uint32_t min_size
+);
+
+// Same as `SVFRT_write_reference`, but see #write-interning.
+SVFRT_Reference SVFRT_write_reference_interned(
+  SVFRT_WriteContext *ctx,
+  SVFRT_InternTable *table,
+  void *pointer,
+  uint32_t type_size
+);
+
+// Same as `SVFRT_write_sequence`, but see #write-interning.
+SVFRT_Sequence SVFRT_write_sequence_interned(
+  SVFRT_WriteContext *ctx,
+  SVFRT_InternTable *table,
+  void *pointer,
+  uint32_t type_size,
+  uint32_t count
+);
+
+// #message-patching: change a finished message, which is in a writable buffer
+// (e.g. a mapped file, see `SVFRT_mapped_file_writer_open_existing`), without
+// writing it again. Only messages with the exact schema can be patched.
+//
+// Fixed-size parts are changed in place, through pointers from
+// `SVFRT_patch_entry`, `SVFRT_patch_reference`, and `SVFRT_patch_sequence_element`,
+// which are checked the same way as for reading. Variable-size parts are
+// replaced by appending new data with the regular `SVFRT_write_*` functions on
+// `ctx->write`, see #buffered-writing, and changing the handles to point to it.
+// Pointers are only valid until the next write, since the buffer may grow.
+//
+// Since the entry must stay at the end of the data, `SVFRT_patch_finish` moves
+// it there after appending, which leaves the old one behind as dead bytes.
+// Replaced data is dead as well, but only the caller knows about it, so it
+// should be reported with `SVFRT_patch_release`. Once the dead bytes are over
+// a threshold, `SVFRT_patch_finish` compacts the message in place: live data
+// is found by walking it from the entry, same as for #message-verification,
+// moved down, and all handles are fixed up. So a patch costs about as much as
+// the change itself, and only the compaction is proportional to the message.
+//
+// Errors are set on `ctx->write`: `SVFRT_code_write__patch_mismatch` if the
+// message does not match the schema and the entry, and the writing errors.
+// Compaction may also fail with `SVFRT_code_write__not_enough_scratch`, or with
+// `SVFRT_code_write__compaction_failed` for malformed data, in which case the
+// message is left as it was.
+
+typedef struct SVFRT_PatchContext {
+  SVFRT_WriteContext write; // Appends after the message, see #buffered-writing.
+  SVFRT_Bytes schema;
+  uint32_t entry_struct_index;
+  uint32_t entry_size;
+  uint32_t entry_offset; // In the data, which starts at `data_start` in the buffer.
+  uint32_t data_start;
+  uint32_t dead_bytes; // Approximate, see `SVFRT_patch_release`.
+  uint32_t max_recursion_depth; // For compaction.
+} SVFRT_PatchContext;
+
+// Start patching the message in the first `message_size` bytes of `buffer`. The
+// rest of `buffer`, and whatever `grow_fn` adds, is used for appending. After
+// `SVFRT_patch_finish`, the message takes up `ctx->write.buffer_used` bytes.
+void SVFRT_patch_start(
+  SVFRT_PatchContext *result,
+  SVFRT_Bytes buffer,
+  uint32_t message_size,
+  SVFRT_GrowBufferFn *grow_fn, // Optional.
+  void *grow_ptr,              // Optional.
+  uint64_t schema_content_hash,
+  SVFRT_Bytes schema_bytes,
+  uint64_t entry_struct_id,
+  uint32_t entry_struct_index
+);
+
+// Move the entry to the end of the data, if anything was appended, and compact
+// the message if there are more than `compaction_threshold` dead bytes. Pass
+// `UINT32_MAX` to never compact, or zero to always do it. `scratch` must fit
+// 16 bytes for the entry, and for each reference, non-empty sequence, chunk,
+// and chunk link in the message. The context can be used for more patching
+// afterwards.
+void SVFRT_patch_finish(
+  SVFRT_PatchContext *ctx,
+  SVFRT_Bytes scratch,
+  uint32_t compaction_threshold
+);
+
+// Report `size` bytes of data which are no longer referenced, e.g. the old
+// target of a changed handle. It only affects when the compaction happens.
+static inline
+void SVFRT_patch_release(SVFRT_PatchContext *ctx, uint32_t size) {
+  uint32_t dead_bytes = ctx->dead_bytes + size;
+  ctx->dead_bytes = dead_bytes < size ? UINT32_MAX : dead_bytes;
+}
+
+static inline
+SVFRT_ReadContext SVFRT_patch_read_context(SVFRT_PatchContext *ctx) {
+  SVFRT_ReadContext result = {
+    /*.data_range =*/ {
+      /*.pointer =*/ ctx->write.buffer.pointer + ctx->data_start,
+      /*.count =*/ ctx->write.data_bytes_written,
+    },
+    /*.struct_strides =*/ { NULL, 0 },
+  };
+  return result;
+}
+
+// Returns NULL on an error.
+static inline
+void *SVFRT_patch_entry(SVFRT_PatchContext *ctx) {
+  if (ctx->write.error_code) {
+    return NULL;
+  }
+  return (void *) (ctx->write.buffer.pointer + ctx->data_start + ctx->entry_offset);
+}
+
+// Returns NULL on an error.
+static inline
+void *SVFRT_patch_reference(
+  SVFRT_PatchContext *ctx,
+  SVFRT_Reference reference,
+  uint32_t type_size
+) {
+  SVFRT_ReadContext read_ctx = SVFRT_patch_read_context(ctx);
+  if (ctx->write.error_code) {
+    return NULL;
+  }
+  return (void *) SVFRT_read_reference(&read_ctx, reference, type_size);
+}
+
+// Strides are equal to the type sizes, since the schema is exact. Returns NULL
+// on an error.
+static inline
+void *SVFRT_patch_sequence_element(
+  SVFRT_PatchContext *ctx,
+  SVFRT_Sequence sequence,
+  uint32_t type_size,
+  uint32_t element_index
+) {
+  SVFRT_ReadContext read_ctx = SVFRT_patch_read_context(ctx);
+  if (ctx->write.error_code || element_index >= sequence.count) {
+    return NULL;
+  }
+
+  // Prevent multiply-add overflow by casting operands to `uint64_t` first.
+  uint64_t data_offset = (uint64_t) ~sequence.data_offset_complement;
+  uint64_t end_offset = data_offset + (uint64_t) type_size * (uint64_t) (element_index + 1);
+  if (end_offset > (uint64_t) read_ctx.data_range.count) {
+    return NULL;
+  }
+  return (void *) (read_ctx.data_range.pointer + (uint32_t) end_offset - type_size);
+}
+
+#define SVFRT_WRITE_CHUNK_SIZE64 (1u << 30)
+
+static inline
+void SVFRT_internal_write_bytes64(
+  SVFRT_WriteContext64 *ctx,
+  uint8_t *pointer,
+  uint64_t size
+) {
+  if (ctx->error_code) {
+    return;
+  }
+
+  if (ctx->finished) {
+    ctx->error_code = SVFRT_code_write__already_finished;
+    return;
+  }
+
+  if (ctx->data_bytes_written + size < size) {
+    ctx->error_code = SVFRT_code_write__data_would_overflow;
+    return;
+  }
+
+  // The writer function only takes 32-bit sizes.
+  while (size > 0) {
+    SVFRT_Bytes bytes = {
+      /*.pointer =*/ pointer,
+      /*.count =*/ size < SVFRT_WRITE_CHUNK_SIZE64 ? (uint32_t) size : SVFRT_WRITE_CHUNK_SIZE64,
+    };
+
+    uint32_t written = ctx->writer_fn(ctx->writer_ptr, bytes);
+    ctx->data_bytes_written += written;
+    if (written != bytes.count) {
+      ctx->error_code = SVFRT_code_write__writer_function_failed;
+      return;
+    }
+
+    pointer += bytes.count;
+    size -= bytes.count;
+  }
+}
+
+// Pad the data up to the #natural-alignment of `type_size`.
+static inline
+void SVFRT_internal_write_align64(
+  SVFRT_WriteContext64 *ctx,
+  uint32_t type_size
+) {
+  uint8_t zeros[SVFRT_MESSAGE_PART_ALIGNMENT] = {0};
+  uint32_t alignment = SVFRT_natural_alignment(type_size);
+  uint32_t padding = (uint32_t) ((alignment - ctx->data_bytes_written % alignment) % alignment);
+  if (padding > 0) {
+    SVFRT_internal_write_bytes64(ctx, zeros, padding);
+  }
+}
+
+static inline
+SVFRT_Reference64 SVFRT_write_reference64(
+  SVFRT_WriteContext64 *ctx,
+  void *pointer,
+  uint32_t type_size
+) {
+  SVFRT_internal_write_align64(ctx, type_size);
+
+  SVFRT_Reference64 result = { ~ctx->data_bytes_written };
+  SVFRT_internal_write_bytes64(ctx, (uint8_t *) pointer, type_size);
+  if (ctx->error_code) {
+    result.data_offset_complement = 0;
+  }
+
+  return result;
+}
+
+static inline
+SVFRT_Sequence64 SVFRT_write_sequence64(
+  SVFRT_WriteContext64 *ctx,
+  void *pointer,
+  uint32_t type_size,
+  uint64_t count
+) {
+  if (count > 0) {
+    SVFRT_internal_write_align64(ctx, type_size);
+  }
+
+  SVFRT_Sequence64 result = { ~ctx->data_bytes_written, count };
+
+  if (type_size != 0 && count > UINT64_MAX / type_size) {
+    ctx->error_code = SVFRT_code_write__data_would_overflow;
+  }
+
+  SVFRT_internal_write_bytes64(ctx, (uint8_t *) pointer, (uint64_t) type_size * count);
+  if (ctx->error_code) {
+    result.count = UINT64_MAX;
+    result.data_offset_complement = 0;
+  }
+
+  return result;
+}
+
+static inline
+void SVFRT_write_sequence_element64(
+  SVFRT_WriteContext64 *ctx,
+  void *pointer,
+  uint32_t type_size,
+  SVFRT_Sequence64 *inout_sequence
+) {
+  if (inout_sequence->count != 0) {
+    uint64_t data_offset = ~inout_sequence->data_offset_complement;
+
+    // Make sure we write contiguously. Divide instead of multiplying, to
+    // prevent an overflow.
+    uint64_t size = ctx->data_bytes_written - data_offset;
+    if (0
+      || data_offset > ctx->data_bytes_written
+      || (type_size == 0 && size != 0)
+      || (type_size != 0 && (size % type_size != 0 || size / type_size != inout_sequence->count))
+    ) {
+      ctx->error_code = SVFRT_code_write__sequence_non_contiguous;
+    }
+  } else {
+    // Only the first element needs padding, see `SVFRT_write_sequence_element`.
+    SVFRT_internal_write_align64(ctx, type_size);
+    inout_sequence->data_offset_complement = ~ctx->data_bytes_written;
+  }
+
+  SVFRT_internal_write_bytes64(ctx, (uint8_t *) pointer, type_size);
+  if (ctx->error_code) {
+    inout_sequence->count = UINT64_MAX;
+    inout_sequence->data_offset_complement = 0;
+    return;
+  }
+
+  inout_sequence->count += 1;
+}
+
+static inline
+void SVFRT_write_finish64(
+  SVFRT_WriteContext64 *ctx,
+  void *pointer,
+  uint32_t type_size
+) {
+  SVFRT_write_reference64(ctx, pointer, type_size);
+  if (!ctx->error_code) {
+    ctx->finished = true;
+  }
+}
+
+static inline
+void const *SVFRT_read_reference64(
+  SVFRT_ReadContext64 *ctx,
+  SVFRT_Reference64 reference,
+  uint32_t type_size
+) {
+  uint64_t data_offset = ~reference.data_offset_complement;
+
+  // Subtract instead of adding, to prevent an overflow.
+  if (data_offset > ctx->data_range.count || type_size > ctx->data_range.count - data_offset) {
+    return NULL;
+  }
+
+  return (void *) (ctx->data_range.pointer + (size_t) data_offset);
+}
+
+// Warning! See `SVFRT_read_sequence_raw` for caveats.
+static inline
+void const *SVFRT_read_sequence_raw64(
+  SVFRT_ReadContext64 *ctx,
+  SVFRT_Sequence64 sequence,
+  uint32_t type_stride
+) {
+  uint64_t data_offset = ~sequence.data_offset_complement;
+  if (data_offset > ctx->data_range.count) {
+    return NULL;
+  }
+
+  // Divide instead of multiplying, to prevent an overflow.
+  uint64_t available = ctx->data_range.count - data_offset;
+  if (type_stride != 0 && sequence.count > available / type_stride) {
+    return NULL;
+  }
+
+  return (void *) (ctx->data_range.pointer + (size_t) data_offset);
+}
+
+static inline
+void const *SVFRT_read_sequence_element64(
+  SVFRT_ReadContext64 *ctx,
+  SVFRT_Sequence64 sequence,
+  uint32_t struct_index,
+  uint64_t element_index
+) {
+  if (struct_index >= ctx->struct_strides.count) {
+    return NULL;
+  }
+
+  uint32_t stride = ctx->struct_strides.pointer[struct_index];
+
+  if (element_index >= sequence.count) {
+    return NULL;
+  }
+
+  uint64_t data_offset = ~sequence.data_offset_complement;
+  if (data_offset > ctx->data_range.count) {
+    return NULL;
+  }
+
+  // Divide instead of multiplying, to prevent an overflow.
+  uint64_t available = ctx->data_range.count - data_offset;
+  if (stride != 0 && element_index >= available / stride) {
+    return NULL;
+  }
+
+  return (void *) (ctx->data_range.pointer + (size_t) (data_offset + (uint64_t) stride * element_index));
+}
+
+// Unchecked variants of the accessors above, which are just pointer arithmetic.
+// Only valid for a context after `SVFRT_verify_message` succeeded, and only for
+// references and sequences that were read from the verified data. Sequence
+// element indices are still up to the caller to check against the count.
+static inline
+void const *SVFRT_read_reference_unchecked(
+  SVFRT_ReadContext *ctx,
+  SVFRT_Reference reference
+) {
+  return (void *) (ctx->data_range.pointer + ~reference.data_offset_complement);
+}
+
+// Warning! See `SVFRT_read_sequence_raw` for caveats.
+static inline
+void const *SVFRT_read_sequence_raw_unchecked(
+  SVFRT_ReadContext *ctx,
+  SVFRT_Sequence sequence
+) {
+  return (void *) (ctx->data_range.pointer + ~sequence.data_offset_complement);
+}
+
+static inline
+void const *SVFRT_read_sequence_element_unchecked(
+  SVFRT_ReadContext *ctx,
+  SVFRT_Sequence sequence,
+  uint32_t struct_index,
+  uint32_t element_index
+) {
+  uint32_t stride = ctx->struct_strides.pointer[struct_index];
+  return (void *) (
+    ctx->data_range.pointer
+    + ~sequence.data_offset_complement
+    + (size_t) stride * (size_t) element_index
+  );
+}
+
+// Wide variants, only after `SVFRT_verify_message64` succeeded.
+static inline
+void const *SVFRT_read_reference_unchecked64(
+  SVFRT_ReadContext64 *ctx,
+  SVFRT_Reference64 reference
+) {
+  return (void *) (ctx->data_range.pointer + (size_t) ~reference.data_offset_complement);
+}
+
+// Warning! See `SVFRT_read_sequence_raw` for caveats.
+static inline
+void const *SVFRT_read_sequence_raw_unchecked64(
+  SVFRT_ReadContext64 *ctx,
+  SVFRT_Sequence64 sequence
+) {
+  return (void *) (ctx->data_range.pointer + (size_t) ~sequence.data_offset_complement);
+}
+
+static inline
+void const *SVFRT_read_sequence_element_unchecked64(
+  SVFRT_ReadContext64 *ctx,
+  SVFRT_Sequence64 sequence,
+  uint32_t struct_index,
+  uint64_t element_index
+) {
+  uint32_t stride = ctx->struct_strides.pointer[struct_index];
+  return (void *) (
+    ctx->data_range.pointer
+    + (size_t) ~sequence.data_offset_complement
+    + (size_t) stride * (size_t) element_index
+  );
+}
+
 #define SVFRT_WRITE_START(schema_name, entry_name, ctx, writer_fn, writer_ptr) \
   SVFRT_write_start( \
     (ctx), \
@@ -558,6 +2547,9 @@ void const *SVFRT_read_sequence_element(
 #define SVFRT_WRITE_SEQUENCE_ELEMENT(ctx, data_ptr, inout_sequence) \
   SVFRT_write_sequence_element((ctx), (void *) (data_ptr), sizeof(*(data_ptr)), (inout_sequence))
 
+#define SVFRT_WRITE_CHUNKED_SEQUENCE_ELEMENTS(ctx, builder, data_ptr, count) \
+  SVFRT_write_chunked_sequence_elements((ctx), (builder), (void *) (data_ptr), sizeof(*(data_ptr)), (count))
+
 #define SVFRT_WRITE_FINISH(ctx, data_ptr) \
   SVFRT_write_finish((ctx), (void *) (data_ptr), sizeof(*(data_ptr)))
 
@@ -578,17 +2570,101 @@ void const *SVFRT_read_sequence_element(
     (out_params)->allocator_ptr = NULL; \
     (out_params)->schema_lookup_fn = NULL; \
     (out_params)->schema_lookup_ptr = NULL; \
+    (out_params)->compatibility_cache = NULL; \
+    (out_params)->single_pass_conversion = false; \
+    (out_params)->conversion_stack.pointer = NULL; \
+    (out_params)->conversion_stack.count = 0; \
+    (out_params)->conversion_spawn_fn = NULL; \
+    (out_params)->conversion_spawn_ptr = NULL; \
+    (out_params)->conversion_task_count = 0; \
+    (out_params)->conversion_memo.pointer = NULL; \
+    (out_params)->conversion_memo.count = 0; \
+    (out_params)->converter_table = NULL; \
   } while(0)
 
+// The typed accessors also fail (return NULL) for misaligned data, see
+// #natural-alignment.
 #define SVFRT_READ_REFERENCE(type_name, ctx, reference) \
-  ((type_name const *) SVFRT_read_reference((ctx), (reference), sizeof(type_name)))
+  ((type_name const *) SVFRT_read_check_alignment( \
+    SVFRT_read_reference((ctx), (reference), sizeof(type_name)), \
+    SVFRT_ALIGNOF(type_name) \
+  ))
 
 #define SVFRT_READ_SEQUENCE_ELEMENT(type_name, ctx, sequence, element_index) \
-  ((type_name const *) SVFRT_read_sequence_element((ctx), (sequence), type_name ## _struct_index, element_index))
+  ((type_name const *) SVFRT_read_check_alignment( \
+    SVFRT_read_sequence_element((ctx), (sequence), type_name ## _struct_index, element_index), \
+    SVFRT_ALIGNOF(type_name) \
+  ))
 
 // Warning! See `SVFRT_read_sequence_raw` for caveats.
 #define SVFRT_READ_SEQUENCE_RAW(type_name, ctx, sequence) \
-  ((type_name const *) SVFRT_read_sequence_raw((ctx), (sequence), sizeof(type_name)))
+  ((type_name const *) SVFRT_read_check_alignment( \
+    SVFRT_read_sequence_raw((ctx), (sequence), sizeof(type_name)), \
+    SVFRT_ALIGNOF(type_name) \
+  ))
+
+// Warning! See `SVFRT_read_sequence_raw` for caveats. The result is NULL, unless
+// the data is aligned, see `SVFRT_read_sequence_aligned`.
+#define SVFRT_READ_SEQUENCE_ALIGNED(type_name, ctx, sequence) \
+  ((type_name const *) SVFRT_ASSUME_ALIGNED( \
+    SVFRT_read_sequence_aligned((ctx), (sequence), sizeof(type_name)), \
+    SVFRT_NATURAL_ALIGNMENT(sizeof(type_name)) \
+  ))
+
+// Warning! Only after `SVFRT_verify_message`, see `SVFRT_read_reference_unchecked`.
+#define SVFRT_READ_REFERENCE_UNCHECKED(type_name, ctx, reference) \
+  ((type_name const *) SVFRT_read_reference_unchecked((ctx), (reference)))
+
+// Warning! Only after `SVFRT_verify_message`, see `SVFRT_read_reference_unchecked`.
+#define SVFRT_READ_SEQUENCE_ELEMENT_UNCHECKED(type_name, ctx, sequence, element_index) \
+  ((type_name const *) SVFRT_read_sequence_element_unchecked((ctx), (sequence), type_name ## _struct_index, element_index))
+
+// Warning! Only after `SVFRT_verify_message`, see `SVFRT_read_reference_unchecked`.
+// Also see `SVFRT_read_sequence_raw` for caveats.
+#define SVFRT_READ_SEQUENCE_RAW_UNCHECKED(type_name, ctx, sequence) \
+  ((type_name const *) SVFRT_read_sequence_raw_unchecked((ctx), (sequence)))
+
+#define SVFRT_WRITE_START64(schema_name, entry_name, ctx, writer_fn, writer_ptr) \
+  SVFRT_write_start64( \
+    (ctx), \
+    (writer_fn), \
+    (writer_ptr), \
+    (schema_name ## _schema_content_hash), \
+    (SVFRT_Bytes) { (void *) schema_name ## _schema_binary_array, schema_name ## _schema_binary_size }, \
+    (SVFRT_Bytes) {0}, \
+    entry_name ## _type_id \
+  )
+
+#define SVFRT_WRITE_REFERENCE64(ctx, data_ptr) \
+  SVFRT_write_reference64((ctx), (void *) (data_ptr), sizeof(*(data_ptr)))
+
+#define SVFRT_WRITE_FIXED_SIZE_ARRAY64(ctx, array) \
+  SVFRT_write_sequence64((ctx), (void *) (array), sizeof(*(array)), sizeof(array) / sizeof(*(array)))
+
+#define SVFRT_WRITE_SEQUENCE_ELEMENT64(ctx, data_ptr, inout_sequence) \
+  SVFRT_write_sequence_element64((ctx), (void *) (data_ptr), sizeof(*(data_ptr)), (inout_sequence))
+
+#define SVFRT_WRITE_FINISH64(ctx, data_ptr) \
+  SVFRT_write_finish64((ctx), (void *) (data_ptr), sizeof(*(data_ptr)))
+
+#define SVFRT_READ_REFERENCE64(type_name, ctx, reference) \
+  ((type_name const *) SVFRT_read_check_alignment( \
+    SVFRT_read_reference64((ctx), (reference), sizeof(type_name)), \
+    SVFRT_ALIGNOF(type_name) \
+  ))
+
+#define SVFRT_READ_SEQUENCE_ELEMENT64(type_name, ctx, sequence, element_index) \
+  ((type_name const *) SVFRT_read_check_alignment( \
+    SVFRT_read_sequence_element64((ctx), (sequence), type_name ## _struct_index, element_index), \
+    SVFRT_ALIGNOF(type_name) \
+  ))
+
+// Warning! See `SVFRT_read_sequence_raw` for caveats.
+#define SVFRT_READ_SEQUENCE_RAW64(type_name, ctx, sequence) \
+  ((type_name const *) SVFRT_read_check_alignment( \
+    SVFRT_read_sequence_raw64((ctx), (sequence), sizeof(type_name)), \
+    SVFRT_ALIGNOF(type_name) \
+  ))
 
 #ifdef __cplusplus
 } // extern "C"
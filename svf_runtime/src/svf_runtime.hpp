@@ -18,7 +18,6 @@ namespace runtime {
 
 #ifndef SVF_COMMON_CPP_TYPES_INCLUDED
 #define SVF_COMMON_CPP_TYPES_INCLUDED
-#pragma pack(push, 1)
 
 template<typename T>
 struct Reference {
@@ -33,9 +32,40 @@ struct Sequence {
 
 template<typename T> struct GetSchemaFromType;
 
-#pragma pack(pop)
+// A field of struct `S` with type `M`, by its offset. See #lazy-view.
+template<typename S, typename M>
+struct Field {
+  uint32_t offset;
+};
 #endif // SVF_COMMON_CPP_TYPES_INCLUDED
 
+// Only used by #wide-messages.
+#ifndef SVF_WIDE_CPP_TYPES_INCLUDED
+#define SVF_WIDE_CPP_TYPES_INCLUDED
+
+template<typename T>
+struct Reference64 {
+  uint64_t data_offset_complement;
+};
+
+template<typename T>
+struct Sequence64 {
+  uint64_t data_offset_complement;
+  uint64_t count;
+};
+#endif // SVF_WIDE_CPP_TYPES_INCLUDED
+
+// Only used by #chunked-sequences.
+#ifndef SVF_CHUNKED_CPP_TYPES_INCLUDED
+#define SVF_CHUNKED_CPP_TYPES_INCLUDED
+
+template<typename T>
+struct ChunkedSequence {
+  uint32_t data_offset_complement;
+  uint32_t count;
+};
+#endif // SVF_CHUNKED_CPP_TYPES_INCLUDED
+
 template<typename T> struct IsPrimitive { using No = char; };
 template<> struct IsPrimitive<uint8_t> { using Yes = char; };
 template<> struct IsPrimitive<uint16_t> { using Yes = char; };
@@ -57,11 +87,26 @@ template<typename T> struct Range {
   uint32_t count;
 };
 
+template<typename T> struct Range64 {
+  T *pointer;
+  uint64_t count;
+};
+
 typedef Range<uint8_t> Bytes;
+typedef Range64<uint8_t> Bytes64;
 typedef SVFRT_ReadContext ReadContext;
+typedef SVFRT_ReadContext64 ReadContext64;
 typedef SVFRT_AllocatorFn AllocatorFn;
 typedef SVFRT_WriterFn WriterFn;
+typedef SVFRT_GrowBufferFn GrowBufferFn;
 typedef SVFRT_SchemaLookupFn SchemaLookupFn;
+typedef SVFRT_CompatibilityCache CompatibilityCache;
+typedef SVFRT_ConverterTable ConverterTable;
+typedef SVFRT_SchemaRegistry SchemaRegistry;
+typedef SVFRT_SpawnTasksFn SpawnTasksFn;
+typedef SVFRT_Archive Archive;
+typedef SVFRT_ArchiveWriter ArchiveWriter;
+typedef SVFRT_ArchiveIterator ArchiveIterator;
 
 enum class CompatibilityLevel {
   compatibility_none = SVFRT_compatibility_none,
@@ -81,22 +126,40 @@ struct ReadMessageResult {
   ReadContext context;
 };
 
+template<typename T>
+struct ReadMessageResult64 {
+  SVFRT_ErrorCode error_code;
+  T const *entry;
+  void *allocation;
+  CompatibilityLevel compatibility_level;
+  ReadContext64 context;
+};
+
 template<typename T> struct WriteContext: SVFRT_WriteContext {};
+template<typename T> struct WriteContext64: SVFRT_WriteContext64 {};
+template<typename T> struct ChunkedSequenceBuilder: SVFRT_ChunkedSequenceBuilder {};
+template<typename T> struct ChunkIterator: SVFRT_ChunkIterator {};
+template<typename T> struct PatchContext: SVFRT_PatchContext {};
+
+// Same layout as `SVFRT_WriteShard`, so make sure to edit them in sync.
+template<typename Entry>
+struct WriteShard {
+  WriteContext<Entry> ctx;
+  uint32_t base;
+};
 
 template<typename Entry>
 static inline
-ReadMessageResult<Entry> read_message(
-  Range<uint8_t> message,
-  Range<uint8_t> scratch,
+SVFRT_ReadMessageParams get_read_message_params(
   CompatibilityLevel required_level,
-  AllocatorFn *allocator_fn = NULL,
-  void *allocator_ptr = NULL,
-  SchemaLookupFn *schema_lookup_fn = NULL,
-  void *schema_lookup_ptr = NULL
+  AllocatorFn *allocator_fn,
+  void *allocator_ptr,
+  SchemaLookupFn *schema_lookup_fn,
+  void *schema_lookup_ptr,
+  CompatibilityCache *compatibility_cache
 ) noexcept {
   using SchemaDescription = typename svf::runtime::GetSchemaFromType<Entry>::SchemaDescription;
   SVFRT_ReadMessageParams params;
-  SVFRT_ReadMessageResult result;
   params.expected_schema_content_hash = SchemaDescription::content_hash;
   params.expected_schema_struct_strides.pointer = (uint32_t *) SchemaDescription::schema_struct_strides;
   params.expected_schema_struct_strides.count = SchemaDescription::schema_struct_count;
@@ -112,6 +175,42 @@ ReadMessageResult<Entry> read_message(
   params.allocator_ptr = allocator_ptr;
   params.schema_lookup_fn = schema_lookup_fn;
   params.schema_lookup_ptr = schema_lookup_ptr;
+  params.compatibility_cache = compatibility_cache;
+  params.single_pass_conversion = false;
+  params.conversion_stack.pointer = NULL;
+  params.conversion_stack.count = 0;
+  params.conversion_spawn_fn = NULL;
+  params.conversion_spawn_ptr = NULL;
+  params.conversion_task_count = 0;
+  params.conversion_memo.pointer = NULL;
+  params.conversion_memo.count = 0;
+  params.converter_table = NULL;
+  return params;
+}
+
+template<typename Entry>
+static inline
+ReadMessageResult<Entry> read_message(
+  Range<uint8_t> message,
+  Range<uint8_t> scratch,
+  CompatibilityLevel required_level,
+  AllocatorFn *allocator_fn = NULL,
+  void *allocator_ptr = NULL,
+  SchemaLookupFn *schema_lookup_fn = NULL,
+  void *schema_lookup_ptr = NULL,
+  CompatibilityCache *compatibility_cache = NULL,
+  ConverterTable *converter_table = NULL
+) noexcept {
+  SVFRT_ReadMessageParams params = get_read_message_params<Entry>(
+    required_level,
+    allocator_fn,
+    allocator_ptr,
+    schema_lookup_fn,
+    schema_lookup_ptr,
+    compatibility_cache
+  );
+  params.converter_table = converter_table;
+  SVFRT_ReadMessageResult result;
   SVFRT_read_message(
     &params,
     &result,
@@ -133,16 +232,107 @@ ReadMessageResult<Entry> read_message(
   };
 }
 
+// See `SVFRT_read_messages`. Results are written in place, which relies on
+// `ReadMessageResult` having the same layout as `SVFRT_ReadMessageResult`.
+template<typename Entry>
+static inline
+void read_messages(
+  Range<Bytes const> messages,
+  ReadMessageResult<Entry> *out_results,
+  Range<uint8_t> scratch,
+  CompatibilityLevel required_level,
+  AllocatorFn *allocator_fn = NULL,
+  void *allocator_ptr = NULL,
+  SchemaLookupFn *schema_lookup_fn = NULL,
+  void *schema_lookup_ptr = NULL,
+  CompatibilityCache *compatibility_cache = NULL,
+  SpawnTasksFn *spawn_fn = NULL,
+  void *spawn_ptr = NULL
+) noexcept {
+  static_assert(sizeof(ReadMessageResult<Entry>) == sizeof(SVFRT_ReadMessageResult));
+  static_assert(sizeof(CompatibilityLevel) == sizeof(SVFRT_CompatibilityLevel));
+  static_assert(sizeof(Bytes) == sizeof(SVFRT_Bytes));
+
+  SVFRT_ReadMessageParams params = get_read_message_params<Entry>(
+    required_level,
+    allocator_fn,
+    allocator_ptr,
+    schema_lookup_fn,
+    schema_lookup_ptr,
+    compatibility_cache
+  );
+  SVFRT_read_messages(
+    &params,
+    (SVFRT_ReadMessageResult *) out_results,
+    (SVFRT_Bytes const *) messages.pointer,
+    messages.count,
+    SVFRT_Bytes {
+      /*.pointer =*/ scratch.pointer,
+      /*.count =*/ scratch.count,
+    },
+    spawn_fn,
+    spawn_ptr
+  );
+}
+
+// See `SVFRT_read_message64`. The wide counterparts of the accessors below are
+// overloads for `ReadContext64`.
+template<typename Entry>
+static inline
+ReadMessageResult64<Entry> read_message64(
+  Range64<uint8_t> message,
+  Range<uint8_t> scratch,
+  CompatibilityLevel required_level,
+  AllocatorFn *allocator_fn = NULL,
+  void *allocator_ptr = NULL,
+  SchemaLookupFn *schema_lookup_fn = NULL,
+  void *schema_lookup_ptr = NULL,
+  CompatibilityCache *compatibility_cache = NULL
+) noexcept {
+  SVFRT_ReadMessageParams params = get_read_message_params<Entry>(
+    required_level,
+    allocator_fn,
+    allocator_ptr,
+    schema_lookup_fn,
+    schema_lookup_ptr,
+    compatibility_cache
+  );
+  SVFRT_ReadMessageResult64 result;
+  SVFRT_read_message64(
+    &params,
+    &result,
+    SVFRT_Bytes64 {
+      /*.pointer =*/ message.pointer,
+      /*.count =*/ message.count,
+    },
+    SVFRT_Bytes {
+      /*.pointer =*/ scratch.pointer,
+      /*.count =*/ scratch.count,
+    }
+  );
+  return ReadMessageResult64<Entry> {
+    /*.error_code =*/ result.error_code,
+    /*.entry =*/ (Entry *) result.entry,
+    /*.allocation =*/ result.allocation,
+    /*.compatibility_level =*/ (CompatibilityLevel) result.compatibility_level,
+    /*.context =*/ result.context,
+  };
+}
+
 template<typename T>
 static inline
 T const *read_reference(
   ReadContext *ctx,
   Reference<T> reference
 ) noexcept {
-  return (T *) SVFRT_read_reference(
-    ctx,
-    SVFRT_Reference { reference.data_offset_complement },
-    sizeof(T)
+  // Also fails for misaligned data, see #natural-alignment.
+  return (T const *) SVFRT_read_check_alignment(
+    SVFRT_read_reference(
+      ctx,
+      SVFRT_Reference { reference.data_offset_complement },
+      sizeof(T)
+    ),
+    alignof(T)
   );
 }
 
@@ -156,12 +346,38 @@ Range<T const> read_sequence_raw(
   // For most other purposes, use `read_sequence_element`.
   static_assert(sizeof(typename IsPrimitive<T>::Yes) > 0);
 
-  auto pointer = SVFRT_read_sequence_raw(
+  auto pointer = SVFRT_read_check_alignment(
+    SVFRT_read_sequence_raw(
+      ctx,
+      SVFRT_Sequence { sequence.data_offset_complement, sequence.count },
+      sizeof(T)
+    ),
+    alignof(T)
+  );
+  return { (T const *) pointer, pointer ? sequence.count : 0 };
+}
+
+// Same as `read_sequence_raw`, but the range is empty, unless the data is
+// aligned, see `SVFRT_read_sequence_aligned`. The pointer is then known to the
+// compiler to be aligned, so loops over it can use aligned vector loads.
+template<typename T>
+static inline
+Range<T const> read_sequence_aligned(
+  ReadContext *ctx,
+  Sequence<T> sequence
+) noexcept {
+  static_assert(sizeof(typename IsPrimitive<T>::Yes) > 0);
+  static_assert(alignof(T) <= SVFRT_NATURAL_ALIGNMENT(sizeof(T)));
+
+  auto pointer = SVFRT_read_sequence_aligned(
     ctx,
     SVFRT_Sequence { sequence.data_offset_complement, sequence.count },
     sizeof(T)
   );
-  return { (T const *) pointer, pointer ? sequence.count : 0 };
+  return {
+    (T const *) SVFRT_ASSUME_ALIGNED(pointer, SVFRT_NATURAL_ALIGNMENT(sizeof(T))),
+    pointer ? sequence.count : 0
+  };
 }
 
 template<typename T>
@@ -172,106 +388,1049 @@ T const *read_sequence_element(
   uint32_t element_index
 ) noexcept {
   using SchemaDescription = typename svf::runtime::GetSchemaFromType<T>::SchemaDescription;
-  return (T const *) SVFRT_read_sequence_element(
-    ctx,
-    SVFRT_Sequence { sequence.data_offset_complement, sequence.count },
-    SchemaDescription::template PerType<T>::index,
-    element_index
+  return (T const *) SVFRT_read_check_alignment(
+    SVFRT_read_sequence_element(
+      ctx,
+      SVFRT_Sequence { sequence.data_offset_complement, sequence.count },
+      SchemaDescription::template PerType<T>::index,
+      element_index
+    ),
+    alignof(T)
   );
 }
 
-template<typename Entry>
+template<typename T>
 static inline
-WriteContext<Entry> write_start(
-  WriterFn *writer_fn,
-  void *writer_ptr
+T const *read_reference(
+  ReadContext64 *ctx,
+  Reference64<T> reference
 ) noexcept {
-  using SchemaDescription = typename svf::runtime::GetSchemaFromType<Entry>::SchemaDescription;
-  WriteContext<Entry> ctx_value = {};
-  SVFRT_write_start(
-    &ctx_value,
-    writer_fn,
-    writer_ptr,
-    SchemaDescription::content_hash,
-    { SchemaDescription::schema_binary_array, SchemaDescription::schema_binary_size },
-    {},
-    SchemaDescription::template PerType<Entry>::type_id
+  return (T const *) SVFRT_read_check_alignment(
+    SVFRT_read_reference64(
+      ctx,
+      SVFRT_Reference64 { reference.data_offset_complement },
+      sizeof(T)
+    ),
+    alignof(T)
   );
-  return ctx_value;
 }
 
-template<typename T, typename E>
+template<typename T>
 static inline
-Reference<T> write_reference(
-  WriteContext<E> *ctx,
-  T const *pointer
+Range64<T const> read_sequence_raw(
+  ReadContext64 *ctx,
+  Sequence64<T> sequence
 ) noexcept {
-  auto result = SVFRT_write_reference(ctx, (void *) pointer, sizeof(T));
-  return { result.data_offset_complement };
+  static_assert(sizeof(typename IsPrimitive<T>::Yes) > 0);
+
+  auto pointer = SVFRT_read_check_alignment(
+    SVFRT_read_sequence_raw64(
+      ctx,
+      SVFRT_Sequence64 { sequence.data_offset_complement, sequence.count },
+      sizeof(T)
+    ),
+    alignof(T)
+  );
+  return { (T const *) pointer, pointer ? sequence.count : 0 };
 }
 
 template<typename T>
 static inline
-void write_finish(
-  WriteContext<T> *ctx,
-  T const *pointer
+T const *read_sequence_element(
+  ReadContext64 *ctx,
+  Sequence64<T> sequence,
+  uint64_t element_index
 ) noexcept {
-  SVFRT_write_finish(ctx, (void *) pointer, sizeof(T));
+  using SchemaDescription = typename svf::runtime::GetSchemaFromType<T>::SchemaDescription;
+  return (T const *) SVFRT_read_check_alignment(
+    SVFRT_read_sequence_element64(
+      ctx,
+      SVFRT_Sequence64 { sequence.data_offset_complement, sequence.count },
+      SchemaDescription::template PerType<T>::index,
+      element_index
+    ),
+    alignof(T)
+  );
 }
 
-template<typename T, typename E>
+// #lazy-view, see `SVFRT_read_message_lazy`. Fields are named by the constants
+// generated for each struct, e.g. `view_read(view, Entry_fields::field)`.
+// Errors are sticky in the `SVFRT_LazyRead`, so check it once at the end.
+template<typename T>
+struct LazyView {
+  SVFRT_LazyView view;
+};
+
+template<typename Entry>
 static inline
-Sequence<T> write_sequence(
-  WriteContext<E> *ctx,
-  T const *pointer,
+LazyView<Entry> read_message_lazy(
+  SVFRT_LazyRead *out_read,
+  Range<uint8_t> message,
+  Range<uint8_t> scratch,
+  Range<uint8_t> memory,
+  CompatibilityLevel required_level,
+  AllocatorFn *allocator_fn = NULL,
+  void *allocator_ptr = NULL,
+  SchemaLookupFn *schema_lookup_fn = NULL,
+  void *schema_lookup_ptr = NULL,
+  CompatibilityCache *compatibility_cache = NULL
+) noexcept {
+  SVFRT_ReadMessageParams params = get_read_message_params<Entry>(
+    required_level,
+    allocator_fn,
+    allocator_ptr,
+    schema_lookup_fn,
+    schema_lookup_ptr,
+    compatibility_cache
+  );
+  SVFRT_read_message_lazy(
+    out_read,
+    &params,
+    SVFRT_Bytes {
+      /*.pointer =*/ message.pointer,
+      /*.count =*/ message.count,
+    },
+    SVFRT_Bytes {
+      /*.pointer =*/ scratch.pointer,
+      /*.count =*/ scratch.count,
+    },
+    SVFRT_Bytes {
+      /*.pointer =*/ memory.pointer,
+      /*.count =*/ memory.count,
+    }
+  );
+  return LazyView<Entry> { out_read->entry };
+}
+
+// A value without references or sequences in it. For a choice, read the tag
+// first, since the payload is read as whichever option is present.
+template<typename S, typename M>
+static inline
+M view_read(LazyView<S> view, Field<S, M> field) noexcept {
+  M result;
+  SVFRT_view_read(view.view, field.offset, &result, sizeof(M));
+  return result;
+}
+
+template<typename S, typename P, typename T>
+static inline
+T view_read(LazyView<S> view, Field<S, P> payload, T P::* /*option*/) noexcept {
+  T result;
+  SVFRT_view_read(view.view, payload.offset, &result, sizeof(T));
+  return result;
+}
+
+// Same as `SVFRT_view_sequence_read`, for `count` elements into `out`.
+template<typename S, typename T>
+static inline
+void view_read(
+  LazyView<S> view,
+  Field<S, Sequence<T>> field,
+  uint32_t first,
+  T *out,
   uint32_t count
 ) noexcept {
-  auto result = SVFRT_write_sequence(ctx, (void *) pointer, sizeof(T), count);
-  return {
-    /*.data_offset_complement =*/ result.data_offset_complement,
-    /*.count =*/ result.count,
+  SVFRT_view_sequence_read(
+    view.view,
+    field.offset,
+    first,
+    count,
+    (void *) out,
+    (uint32_t) sizeof(T) * count
+  );
+}
+
+template<typename S, typename T>
+static inline
+uint32_t view_count(LazyView<S> view, Field<S, Sequence<T>> field) noexcept {
+  return SVFRT_view_sequence_count(view.view, field.offset);
+}
+
+template<typename S, typename M>
+static inline
+LazyView<M> view_get(LazyView<S> view, Field<S, M> field) noexcept {
+  return LazyView<M> { SVFRT_view_struct(view.view, field.offset) };
+}
+
+template<typename S, typename T>
+static inline
+LazyView<T> view_get(LazyView<S> view, Field<S, Reference<T>> field) noexcept {
+  return LazyView<T> { SVFRT_view_reference(view.view, field.offset) };
+}
+
+template<typename S, typename T>
+static inline
+LazyView<T> view_get(LazyView<S> view, Field<S, Sequence<T>> field, uint32_t index) noexcept {
+  return LazyView<T> { SVFRT_view_sequence_element(view.view, field.offset, index) };
+}
+
+// The payload of a choice as a struct option. If another option is present,
+// the view is absent, same as reading an inactive union member as zeros.
+template<typename S, typename P, typename T>
+static inline
+LazyView<T> view_get(LazyView<S> view, Field<S, P> payload, T P::* /*option*/) noexcept {
+  using SchemaDescription = typename svf::runtime::GetSchemaFromType<T>::SchemaDescription;
+  uint32_t struct_index = SchemaDescription::template PerType<T>::index;
+  auto result = SVFRT_view_struct(view.view, payload.offset);
+  if (result.struct_index_dst != struct_index) {
+    result.data_offset = 0;
+    result.unsafe_struct_index_src = UINT32_MAX;
+    result.struct_index_dst = struct_index;
+  }
+  return LazyView<T> { result };
+}
+
+// See `SVFRT_view_materialize`.
+template<typename T>
+static inline
+ReadMessageResult<T> view_materialize(LazyView<T> view) noexcept {
+  SVFRT_ReadMessageResult result;
+  SVFRT_view_materialize(view.view, &result);
+  return ReadMessageResult<T> {
+    /*.error_code =*/ result.error_code,
+    /*.entry =*/ (T *) result.entry,
+    /*.allocation =*/ result.allocation,
+    /*.compatibility_level =*/ (CompatibilityLevel) result.compatibility_level,
+    /*.context =*/ result.context,
   };
 }
 
-template<typename T, typename E, int N>
+// See `SVFRT_verify_message`. Uses the same parameters as `read_message`.
+template<typename Entry>
 static inline
-Sequence<T> write_fixed_size_array(
-  WriteContext<E> *ctx,
-  T const (&array)[N]
+SVFRT_ErrorCode verify_message(
+  ReadMessageResult<Entry> *result
 ) noexcept {
-  return write_sequence(ctx, (T const *) array, (uint32_t) N);
+  using SchemaDescription = typename svf::runtime::GetSchemaFromType<Entry>::SchemaDescription;
+  SVFRT_ReadMessageParams params = {};
+  params.expected_schema.pointer = (uint8_t *) SchemaDescription::schema_binary_array;
+  params.expected_schema.count = SchemaDescription::schema_binary_size;
+  params.entry_struct_index = SchemaDescription::template PerType<Entry>::index;
+  params.max_recursion_depth = SVFRT_DEFAULT_MAX_RECURSION_DEPTH;
+  SVFRT_ReadMessageResult c_result = {};
+  c_result.error_code = result->error_code;
+  c_result.entry = (void *) result->entry;
+  c_result.context = result->context;
+  return SVFRT_verify_message(&params, &c_result);
 }
 
-// Same as `write_fixed_size_array`, but with casting. Intended for use with
-// C++ string literals.
-template<typename S, typename T, typename E, int N>
+// See `SVFRT_verify_message64`. Uses the same parameters as `read_message64`.
+template<typename Entry>
 static inline
-Sequence<S> write_fixed_size_string(
-  WriteContext<E> *ctx,
-  T const (&array)[N],
-  bool termination_type = !0 // Mnemonic: 0 for zero-terminated strings, !0 ("not zero") otherwise.
+SVFRT_ErrorCode verify_message64(
+  ReadMessageResult64<Entry> *result
 ) noexcept {
-  static_assert(sizeof(typename IsPrimitive<S>::Yes) > 0);
-  static_assert(sizeof(S) == sizeof(T));
-  static_assert(N > 0);
-
-  return write_sequence(ctx, (S const *) array, (uint32_t) (termination_type == 0 ? N - 1 : N));
+  using SchemaDescription = typename svf::runtime::GetSchemaFromType<Entry>::SchemaDescription;
+  SVFRT_ReadMessageParams params = {};
+  params.expected_schema.pointer = (uint8_t *) SchemaDescription::schema_binary_array;
+  params.expected_schema.count = SchemaDescription::schema_binary_size;
+  params.entry_struct_index = SchemaDescription::template PerType<Entry>::index;
+  params.max_recursion_depth = SVFRT_DEFAULT_MAX_RECURSION_DEPTH;
+  SVFRT_ReadMessageResult64 c_result = {};
+  c_result.error_code = result->error_code;
+  c_result.entry = (void *) result->entry;
+  c_result.context = result->context;
+  return SVFRT_verify_message64(&params, &c_result);
 }
 
-template<typename T, typename E>
+// Unchecked variants, only after `verify_message` succeeded. See
+// `SVFRT_read_reference_unchecked`.
+template<typename T>
 static inline
-void write_sequence_element(
-  WriteContext<E> *ctx,
-  T const *pointer,
-  Sequence<T> *inout_sequence
+T const *read_reference_unchecked(
+  ReadContext *ctx,
+  Reference<T> reference
 ) noexcept {
-  // TODO: this back-and-forth conversion sure is clumsy. Improve this somehow?
-  SVFRT_Sequence sequence = {
-    /*.data_offset_complement =*/ inout_sequence->data_offset_complement,
-    /*.count =*/ inout_sequence->count,
-  };
+  return (T const *) (ctx->data_range.pointer + ~reference.data_offset_complement);
+}
 
-  SVFRT_write_sequence_element(ctx, (void *) pointer, sizeof(T), &sequence);
+template<typename T>
+static inline
+T const *read_sequence_raw_unchecked(
+  ReadContext *ctx,
+  Sequence<T> sequence
+) noexcept {
+  // `T` must be primitive, see caveats for `SVFRT_read_sequence_raw`.
+  static_assert(sizeof(typename IsPrimitive<T>::Yes) > 0);
+
+  return (T const *) (ctx->data_range.pointer + ~sequence.data_offset_complement);
+}
+
+template<typename T>
+static inline
+T const *read_sequence_element_unchecked(
+  ReadContext *ctx,
+  Sequence<T> sequence,
+  uint32_t element_index
+) noexcept {
+  using SchemaDescription = typename svf::runtime::GetSchemaFromType<T>::SchemaDescription;
+  uint32_t stride = ctx->struct_strides.pointer[SchemaDescription::template PerType<T>::index];
+  return (T const *) (
+    ctx->data_range.pointer
+    + ~sequence.data_offset_complement
+    + (size_t) stride * (size_t) element_index
+  );
+}
+
+template<typename T>
+static inline
+T const *read_reference_unchecked(
+  ReadContext64 *ctx,
+  Reference64<T> reference
+) noexcept {
+  return (T const *) (ctx->data_range.pointer + (size_t) ~reference.data_offset_complement);
+}
+
+template<typename T>
+static inline
+T const *read_sequence_raw_unchecked(
+  ReadContext64 *ctx,
+  Sequence64<T> sequence
+) noexcept {
+  // `T` must be primitive, see caveats for `SVFRT_read_sequence_raw`.
+  static_assert(sizeof(typename IsPrimitive<T>::Yes) > 0);
+
+  return (T const *) (ctx->data_range.pointer + (size_t) ~sequence.data_offset_complement);
+}
+
+template<typename T>
+static inline
+T const *read_sequence_element_unchecked(
+  ReadContext64 *ctx,
+  Sequence64<T> sequence,
+  uint64_t element_index
+) noexcept {
+  using SchemaDescription = typename svf::runtime::GetSchemaFromType<T>::SchemaDescription;
+  uint32_t stride = ctx->struct_strides.pointer[SchemaDescription::template PerType<T>::index];
+  return (T const *) (
+    ctx->data_range.pointer
+    + (size_t) ~sequence.data_offset_complement
+    + (size_t) stride * (size_t) element_index
+  );
+}
+
+// #chunked-sequences, see `SVFRT_read_chunked_sequence_chunk_count`.
+template<typename T>
+static inline
+uint32_t read_chunk_count(
+  ReadContext *ctx,
+  ChunkedSequence<T> sequence
+) noexcept {
+  return SVFRT_read_chunked_sequence_chunk_count(
+    ctx,
+    SVFRT_ChunkedSequence { sequence.data_offset_complement, sequence.count }
+  );
+}
+
+// See `SVFRT_read_chunked_sequence_chunk`. The chunk is a regular sequence.
+template<typename T>
+static inline
+bool read_chunk(
+  ReadContext *ctx,
+  ChunkedSequence<T> sequence,
+  uint32_t chunk_index,
+  Sequence<T> *out_chunk
+) noexcept {
+  SVFRT_Sequence chunk = {0};
+  bool result = SVFRT_read_chunked_sequence_chunk(
+    ctx,
+    SVFRT_ChunkedSequence { sequence.data_offset_complement, sequence.count },
+    chunk_index,
+    &chunk
+  );
+  out_chunk->data_offset_complement = chunk.data_offset_complement;
+  out_chunk->count = chunk.count;
+  return result;
+}
+
+// See `SVFRT_read_chunked_sequence_chunks`.
+template<typename T>
+static inline
+uint32_t read_chunks(
+  ReadContext *ctx,
+  ChunkedSequence<T> sequence,
+  Range<Sequence<T>> out_chunks
+) noexcept {
+  static_assert(sizeof(Sequence<T>) == sizeof(SVFRT_Sequence));
+  return SVFRT_read_chunked_sequence_chunks(
+    ctx,
+    SVFRT_ChunkedSequence { sequence.data_offset_complement, sequence.count },
+    (SVFRT_Sequence *) out_chunks.pointer,
+    out_chunks.count
+  );
+}
+
+// See `SVFRT_chunk_iterator_next`. Goes from the last chunk to the first one.
+template<typename T>
+static inline
+ChunkIterator<T> chunk_iterator_begin(
+  ChunkedSequence<T> sequence
+) noexcept {
+  ChunkIterator<T> result = {};
+  static_cast<SVFRT_ChunkIterator &>(result) = SVFRT_chunk_iterator_begin(
+    SVFRT_ChunkedSequence { sequence.data_offset_complement, sequence.count }
+  );
+  return result;
+}
+
+template<typename T>
+static inline
+bool chunk_iterator_next(
+  ReadContext *ctx,
+  ChunkIterator<T> *iterator,
+  Sequence<T> *out_chunk
+) noexcept {
+  SVFRT_Sequence chunk = {0};
+  bool result = SVFRT_chunk_iterator_next(ctx, iterator, &chunk);
+  out_chunk->data_offset_complement = chunk.data_offset_complement;
+  out_chunk->count = chunk.count;
+  return result;
+}
+
+template<typename Entry>
+static inline
+WriteContext<Entry> write_start(
+  WriterFn *writer_fn,
+  void *writer_ptr
+) noexcept {
+  using SchemaDescription = typename svf::runtime::GetSchemaFromType<Entry>::SchemaDescription;
+  WriteContext<Entry> ctx_value = {};
+  SVFRT_write_start(
+    &ctx_value,
+    writer_fn,
+    writer_ptr,
+    SchemaDescription::content_hash,
+    { SchemaDescription::schema_binary_array, SchemaDescription::schema_binary_size },
+    {},
+    SchemaDescription::template PerType<Entry>::type_id
+  );
+  return ctx_value;
+}
+
+// See `SVFRT_write_start_buffered`, and #buffered-writing. The same writing
+// functions work on the result.
+template<typename Entry>
+static inline
+WriteContext<Entry> write_start_buffered(
+  Bytes buffer,
+  GrowBufferFn *grow_fn = NULL,
+  void *grow_ptr = NULL,
+  WriterFn *writer_fn = NULL,
+  void *writer_ptr = NULL
+) noexcept {
+  using SchemaDescription = typename svf::runtime::GetSchemaFromType<Entry>::SchemaDescription;
+  WriteContext<Entry> ctx_value = {};
+  SVFRT_write_start_buffered(
+    &ctx_value,
+    { buffer.pointer, buffer.count },
+    grow_fn,
+    grow_ptr,
+    writer_fn,
+    writer_ptr,
+    SchemaDescription::content_hash,
+    { SchemaDescription::schema_binary_array, SchemaDescription::schema_binary_size },
+    {},
+    SchemaDescription::template PerType<Entry>::type_id
+  );
+  return ctx_value;
+}
+
+// See `SVFRT_write_start64`. The wide counterparts of the writing functions
+// below are overloads for `WriteContext64`.
+template<typename Entry>
+static inline
+WriteContext64<Entry> write_start64(
+  WriterFn *writer_fn,
+  void *writer_ptr
+) noexcept {
+  using SchemaDescription = typename svf::runtime::GetSchemaFromType<Entry>::SchemaDescription;
+  WriteContext64<Entry> ctx_value = {};
+  SVFRT_write_start64(
+    &ctx_value,
+    writer_fn,
+    writer_ptr,
+    SchemaDescription::content_hash,
+    { SchemaDescription::schema_binary_array, SchemaDescription::schema_binary_size },
+    {},
+    SchemaDescription::template PerType<Entry>::type_id
+  );
+  return ctx_value;
+}
+
+// See `SVFRT_archive_record_start`. The schema is stored in the archive once.
+template<typename Entry>
+static inline
+WriteContext<Entry> archive_record_start(ArchiveWriter *writer) noexcept {
+  using SchemaDescription = typename svf::runtime::GetSchemaFromType<Entry>::SchemaDescription;
+  WriteContext<Entry> ctx_value = {};
+  SVFRT_archive_record_start(
+    writer,
+    &ctx_value,
+    SchemaDescription::content_hash,
+    { SchemaDescription::schema_binary_array, SchemaDescription::schema_binary_size },
+    SchemaDescription::template PerType<Entry>::type_id
+  );
+  return ctx_value;
+}
+
+// See `SVFRT_archive_read_record`.
+template<typename Entry>
+static inline
+ReadMessageResult<Entry> read_archive_record(
+  Archive *archive,
+  uint32_t record_index,
+  Range<uint8_t> scratch,
+  CompatibilityLevel required_level,
+  AllocatorFn *allocator_fn = NULL,
+  void *allocator_ptr = NULL,
+  SchemaLookupFn *schema_lookup_fn = NULL,
+  void *schema_lookup_ptr = NULL,
+  CompatibilityCache *compatibility_cache = NULL
+) noexcept {
+  static_assert(sizeof(ReadMessageResult<Entry>) == sizeof(SVFRT_ReadMessageResult));
+
+  SVFRT_ReadMessageParams params = get_read_message_params<Entry>(
+    required_level,
+    allocator_fn,
+    allocator_ptr,
+    schema_lookup_fn,
+    schema_lookup_ptr,
+    compatibility_cache
+  );
+  ReadMessageResult<Entry> result;
+  SVFRT_archive_read_record(
+    archive,
+    &params,
+    (SVFRT_ReadMessageResult *) &result,
+    record_index,
+    SVFRT_Bytes {
+      /*.pointer =*/ scratch.pointer,
+      /*.count =*/ scratch.count,
+    }
+  );
+  return result;
+}
+
+// See `SVFRT_archive_iterator_next`.
+template<typename Entry>
+static inline
+bool archive_iterator_next(
+  ArchiveIterator *iterator,
+  ReadMessageResult<Entry> *out_result,
+  Range<uint8_t> scratch,
+  CompatibilityLevel required_level,
+  AllocatorFn *allocator_fn = NULL,
+  void *allocator_ptr = NULL,
+  SchemaLookupFn *schema_lookup_fn = NULL,
+  void *schema_lookup_ptr = NULL,
+  CompatibilityCache *compatibility_cache = NULL
+) noexcept {
+  static_assert(sizeof(ReadMessageResult<Entry>) == sizeof(SVFRT_ReadMessageResult));
+
+  SVFRT_ReadMessageParams params = get_read_message_params<Entry>(
+    required_level,
+    allocator_fn,
+    allocator_ptr,
+    schema_lookup_fn,
+    schema_lookup_ptr,
+    compatibility_cache
+  );
+  return SVFRT_archive_iterator_next(
+    iterator,
+    &params,
+    (SVFRT_ReadMessageResult *) out_result,
+    SVFRT_Bytes {
+      /*.pointer =*/ scratch.pointer,
+      /*.count =*/ scratch.count,
+    }
+  );
+}
+
+template<typename T, typename E>
+static inline
+Reference<T> write_reference(
+  WriteContext<E> *ctx,
+  T const *pointer
+) noexcept {
+  auto result = SVFRT_write_reference(ctx, (void *) pointer, sizeof(T));
+  return { result.data_offset_complement };
+}
+
+template<typename T>
+static inline
+void write_finish(
+  WriteContext<T> *ctx,
+  T const *pointer
+) noexcept {
+  SVFRT_write_finish(ctx, (void *) pointer, sizeof(T));
+}
+
+template<typename T, typename E>
+static inline
+Sequence<T> write_sequence(
+  WriteContext<E> *ctx,
+  T const *pointer,
+  uint32_t count
+) noexcept {
+  auto result = SVFRT_write_sequence(ctx, (void *) pointer, sizeof(T), count);
+  return {
+    /*.data_offset_complement =*/ result.data_offset_complement,
+    /*.count =*/ result.count,
+  };
+}
+
+template<typename T, typename E, int N>
+static inline
+Sequence<T> write_fixed_size_array(
+  WriteContext<E> *ctx,
+  T const (&array)[N]
+) noexcept {
+  return write_sequence(ctx, (T const *) array, (uint32_t) N);
+}
+
+// Same as `write_fixed_size_array`, but with casting. Intended for use with
+// C++ string literals.
+template<typename S, typename T, typename E, int N>
+static inline
+Sequence<S> write_fixed_size_string(
+  WriteContext<E> *ctx,
+  T const (&array)[N],
+  bool termination_type = !0 // Mnemonic: 0 for zero-terminated strings, !0 ("not zero") otherwise.
+) noexcept {
+  static_assert(sizeof(typename IsPrimitive<S>::Yes) > 0);
+  static_assert(sizeof(S) == sizeof(T));
+  static_assert(N > 0);
+
+  return write_sequence(ctx, (S const *) array, (uint32_t) (termination_type == 0 ? N - 1 : N));
+}
+
+// See `SVFRT_write_sequence_reserve`, and #reserved-writing.
+template<typename T, typename E>
+static inline
+T *reserve_sequence(
+  WriteContext<E> *ctx,
+  uint32_t count,
+  Sequence<T> *out_sequence
+) noexcept {
+  SVFRT_Sequence sequence = {0};
+  void *pointer = SVFRT_write_sequence_reserve(ctx, sizeof(T), count, &sequence);
+  out_sequence->data_offset_complement = sequence.data_offset_complement;
+  out_sequence->count = sequence.count;
+  return (T *) pointer;
+}
+
+// See `SVFRT_write_reference_reserve`, and #reserved-writing.
+template<typename T, typename E>
+static inline
+T *reserve_reference(
+  WriteContext<E> *ctx,
+  Reference<T> *out_reference
+) noexcept {
+  SVFRT_Reference reference = {0};
+  void *pointer = SVFRT_write_reference_reserve(ctx, sizeof(T), &reference);
+  out_reference->data_offset_complement = reference.data_offset_complement;
+  return (T *) pointer;
+}
+
+template<typename T, typename E>
+static inline
+void write_sequence_element(
+  WriteContext<E> *ctx,
+  T const *pointer,
+  Sequence<T> *inout_sequence
+) noexcept {
+  // TODO: this back-and-forth conversion sure is clumsy. Improve this somehow?
+  SVFRT_Sequence sequence = {
+    /*.data_offset_complement =*/ inout_sequence->data_offset_complement,
+    /*.count =*/ inout_sequence->count,
+  };
+
+  SVFRT_write_sequence_element(ctx, (void *) pointer, sizeof(T), &sequence);
+
+  inout_sequence->data_offset_complement = sequence.data_offset_complement;
+  inout_sequence->count = sequence.count;
+}
+
+// #chunked-sequences: append to the chunked sequence of `builder`, see
+// `SVFRT_write_chunked_sequence_elements`.
+template<typename T, typename E>
+static inline
+void write_chunked_sequence_elements(
+  WriteContext<E> *ctx,
+  ChunkedSequenceBuilder<T> *builder,
+  T const *pointer,
+  uint32_t count
+) noexcept {
+  SVFRT_write_chunked_sequence_elements(ctx, builder, (void *) pointer, sizeof(T), count);
+}
+
+template<typename T, typename E>
+static inline
+void write_chunked_sequence_element(
+  WriteContext<E> *ctx,
+  ChunkedSequenceBuilder<T> *builder,
+  T const *pointer
+) noexcept {
+  SVFRT_write_chunked_sequence_elements(ctx, builder, (void *) pointer, sizeof(T), 1);
+}
+
+template<typename T, typename E>
+static inline
+ChunkedSequence<T> write_chunked_sequence_finish(
+  WriteContext<E> *ctx,
+  ChunkedSequenceBuilder<T> *builder
+) noexcept {
+  auto result = SVFRT_write_chunked_sequence_finish(ctx, builder);
+  return {
+    /*.data_offset_complement =*/ result.data_offset_complement,
+    /*.count =*/ result.count,
+  };
+}
+
+// See `SVFRT_write_shard_start`, and #sharded-writing. The same writing
+// functions work on `shard.ctx`.
+template<typename Entry>
+static inline
+WriteShard<Entry> write_shard_start(
+  Bytes buffer,
+  GrowBufferFn *grow_fn = NULL,
+  void *grow_ptr = NULL
+) noexcept {
+  static_assert(sizeof(WriteShard<Entry>) == sizeof(SVFRT_WriteShard));
+  WriteShard<Entry> shard_value = {};
+  SVFRT_write_shard_start(
+    (SVFRT_WriteShard *) &shard_value,
+    { buffer.pointer, buffer.count },
+    grow_fn,
+    grow_ptr
+  );
+  return shard_value;
+}
+
+// See `SVFRT_write_shards`.
+template<typename Entry>
+static inline
+void write_shards(
+  WriteContext<Entry> *ctx,
+  Range<WriteShard<Entry>> shards
+) noexcept {
+  SVFRT_write_shards(ctx, (SVFRT_WriteShard *) shards.pointer, shards.count);
+}
+
+// Turn a handle from `shard` into a message handle, after `write_shards`.
+template<typename T, typename E>
+static inline
+Reference<T> from_shard(
+  WriteShard<E> const *shard,
+  Reference<T> reference
+) noexcept {
+  auto result = SVFRT_shard_reference(
+    (SVFRT_WriteShard const *) shard,
+    SVFRT_Reference { reference.data_offset_complement }
+  );
+  return { result.data_offset_complement };
+}
+
+template<typename T, typename E>
+static inline
+Sequence<T> from_shard(
+  WriteShard<E> const *shard,
+  Sequence<T> sequence
+) noexcept {
+  auto result = SVFRT_shard_sequence(
+    (SVFRT_WriteShard const *) shard,
+    SVFRT_Sequence { sequence.data_offset_complement, sequence.count }
+  );
+  return {
+    /*.data_offset_complement =*/ result.data_offset_complement,
+    /*.count =*/ result.count,
+  };
+}
+
+template<typename T, typename E>
+static inline
+ChunkedSequence<T> from_shard(
+  WriteShard<E> const *shard,
+  ChunkedSequence<T> sequence
+) noexcept {
+  auto result = SVFRT_shard_chunked_sequence(
+    (SVFRT_WriteShard const *) shard,
+    SVFRT_ChunkedSequence { sequence.data_offset_complement, sequence.count }
+  );
+  return {
+    /*.data_offset_complement =*/ result.data_offset_complement,
+    /*.count =*/ result.count,
+  };
+}
+
+// See `SVFRT_write_relocate_shards`. `message` must be finished.
+template<typename Entry>
+static inline
+SVFRT_ErrorCode relocate_shards(
+  Bytes message,
+  Range<WriteShard<Entry>> shards
+) noexcept {
+  using SchemaDescription = typename svf::runtime::GetSchemaFromType<Entry>::SchemaDescription;
+  return SVFRT_write_relocate_shards(
+    { message.pointer, message.count },
+    (SVFRT_WriteShard const *) shards.pointer,
+    shards.count,
+    { SchemaDescription::schema_binary_array, SchemaDescription::schema_binary_size },
+    SchemaDescription::template PerType<Entry>::index,
+    SVFRT_DEFAULT_MAX_RECURSION_DEPTH
+  );
+}
+
+// See #subtree-copying. `src` must be read with the same schema as `dst` is
+// written with.
+template<typename T>
+static inline
+SVFRT_CopyParams get_copy_params(Bytes scratch) noexcept {
+  using SchemaDescription = typename svf::runtime::GetSchemaFromType<T>::SchemaDescription;
+  SVFRT_CopyParams params = {};
+  params.schema.pointer = (uint8_t *) SchemaDescription::schema_binary_array;
+  params.schema.count = SchemaDescription::schema_binary_size;
+  params.scratch.pointer = scratch.pointer;
+  params.scratch.count = scratch.count;
+  params.max_recursion_depth = SVFRT_DEFAULT_MAX_RECURSION_DEPTH;
+  return params;
+}
+
+template<typename T, typename E>
+static inline
+Reference<T> copy_subtree(
+  WriteContext<E> *dst,
+  ReadContext *src,
+  Reference<T> reference,
+  Bytes scratch
+) noexcept {
+  using SchemaDescription = typename svf::runtime::GetSchemaFromType<T>::SchemaDescription;
+  static_assert(SchemaDescription::content_hash == GetSchemaFromType<E>::SchemaDescription::content_hash);
+  auto params = get_copy_params<T>(scratch);
+  auto result = SVFRT_copy_reference(
+    dst,
+    &params,
+    src,
+    SVFRT_Reference { reference.data_offset_complement },
+    SchemaDescription::template PerType<T>::index
+  );
+  return { result.data_offset_complement };
+}
+
+template<typename T, typename E>
+static inline
+Sequence<T> copy_subtree(
+  WriteContext<E> *dst,
+  ReadContext *src,
+  Sequence<T> sequence,
+  Bytes scratch
+) noexcept {
+  using SchemaDescription = typename svf::runtime::GetSchemaFromType<T>::SchemaDescription;
+  static_assert(SchemaDescription::content_hash == GetSchemaFromType<E>::SchemaDescription::content_hash);
+  auto params = get_copy_params<T>(scratch);
+  auto result = SVFRT_copy_sequence(
+    dst,
+    &params,
+    src,
+    SVFRT_Sequence { sequence.data_offset_complement, sequence.count },
+    SchemaDescription::template PerType<T>::index
+  );
+  return {
+    /*.data_offset_complement =*/ result.data_offset_complement,
+    /*.count =*/ result.count,
+  };
+}
+
+template<typename T, typename E>
+static inline
+ChunkedSequence<T> copy_subtree(
+  WriteContext<E> *dst,
+  ReadContext *src,
+  ChunkedSequence<T> sequence,
+  Bytes scratch
+) noexcept {
+  using SchemaDescription = typename svf::runtime::GetSchemaFromType<T>::SchemaDescription;
+  static_assert(SchemaDescription::content_hash == GetSchemaFromType<E>::SchemaDescription::content_hash);
+  auto params = get_copy_params<T>(scratch);
+  auto result = SVFRT_copy_chunked_sequence(
+    dst,
+    &params,
+    src,
+    SVFRT_ChunkedSequence { sequence.data_offset_complement, sequence.count },
+    SchemaDescription::template PerType<T>::index
+  );
+  return {
+    /*.data_offset_complement =*/ result.data_offset_complement,
+    /*.count =*/ result.count,
+  };
+}
+
+// See `SVFRT_write_reference_interned`, and #write-interning.
+template<typename T, typename E>
+static inline
+Reference<T> write_reference_interned(
+  WriteContext<E> *ctx,
+  SVFRT_InternTable *table,
+  T const *pointer
+) noexcept {
+  auto result = SVFRT_write_reference_interned(ctx, table, (void *) pointer, sizeof(T));
+  return { result.data_offset_complement };
+}
+
+// See `SVFRT_write_sequence_interned`, and #write-interning.
+template<typename T, typename E>
+static inline
+Sequence<T> write_sequence_interned(
+  WriteContext<E> *ctx,
+  SVFRT_InternTable *table,
+  T const *pointer,
+  uint32_t count
+) noexcept {
+  auto result = SVFRT_write_sequence_interned(ctx, table, (void *) pointer, sizeof(T), count);
+  return {
+    /*.data_offset_complement =*/ result.data_offset_complement,
+    /*.count =*/ result.count,
+  };
+}
+
+// See `SVFRT_patch_start`, and #message-patching. New data is appended with the
+// usual writing functions on `patch_writer(ctx)`.
+template<typename Entry>
+static inline
+PatchContext<Entry> patch_start(
+  Bytes buffer,
+  uint32_t message_size,
+  GrowBufferFn *grow_fn = NULL,
+  void *grow_ptr = NULL
+) noexcept {
+  using SchemaDescription = typename svf::runtime::GetSchemaFromType<Entry>::SchemaDescription;
+  PatchContext<Entry> ctx_value = {};
+  SVFRT_patch_start(
+    &ctx_value,
+    { buffer.pointer, buffer.count },
+    message_size,
+    grow_fn,
+    grow_ptr,
+    SchemaDescription::content_hash,
+    { SchemaDescription::schema_binary_array, SchemaDescription::schema_binary_size },
+    SchemaDescription::template PerType<Entry>::type_id,
+    SchemaDescription::template PerType<Entry>::index
+  );
+  return ctx_value;
+}
+
+template<typename Entry>
+static inline
+WriteContext<Entry> *patch_writer(PatchContext<Entry> *ctx) noexcept {
+  return (WriteContext<Entry> *) &ctx->write;
+}
+
+template<typename Entry>
+static inline
+Entry *patch_entry(PatchContext<Entry> *ctx) noexcept {
+  return (Entry *) SVFRT_patch_entry(ctx);
+}
+
+template<typename T, typename Entry>
+static inline
+T *patch_reference(PatchContext<Entry> *ctx, Reference<T> reference) noexcept {
+  return (T *) SVFRT_patch_reference(ctx, { reference.data_offset_complement }, sizeof(T));
+}
+
+template<typename T, typename Entry>
+static inline
+T *patch_sequence_element(
+  PatchContext<Entry> *ctx,
+  Sequence<T> sequence,
+  uint32_t element_index
+) noexcept {
+  return (T *) SVFRT_patch_sequence_element(
+    ctx,
+    { sequence.data_offset_complement, sequence.count },
+    sizeof(T),
+    element_index
+  );
+}
+
+// Report the target of a replaced handle as dead, see `SVFRT_patch_release`.
+template<typename T, typename Entry>
+static inline
+void patch_release(PatchContext<Entry> *ctx, Reference<T>) noexcept {
+  SVFRT_patch_release(ctx, sizeof(T));
+}
+
+template<typename T, typename Entry>
+static inline
+void patch_release(PatchContext<Entry> *ctx, Sequence<T> sequence) noexcept {
+  uint64_t size = (uint64_t) sizeof(T) * (uint64_t) sequence.count;
+  SVFRT_patch_release(ctx, size > UINT32_MAX ? UINT32_MAX : (uint32_t) size);
+}
+
+template<typename Entry>
+static inline
+void patch_finish(
+  PatchContext<Entry> *ctx,
+  Bytes scratch = {},
+  uint32_t compaction_threshold = UINT32_MAX
+) noexcept {
+  SVFRT_patch_finish(ctx, { scratch.pointer, scratch.count }, compaction_threshold);
+}
+
+template<typename T, typename E>
+static inline
+Reference64<T> write_reference(
+  WriteContext64<E> *ctx,
+  T const *pointer
+) noexcept {
+  auto result = SVFRT_write_reference64(ctx, (void *) pointer, sizeof(T));
+  return { result.data_offset_complement };
+}
+
+template<typename T>
+static inline
+void write_finish(
+  WriteContext64<T> *ctx,
+  T const *pointer
+) noexcept {
+  SVFRT_write_finish64(ctx, (void *) pointer, sizeof(T));
+}
+
+template<typename T, typename E>
+static inline
+Sequence64<T> write_sequence(
+  WriteContext64<E> *ctx,
+  T const *pointer,
+  uint64_t count
+) noexcept {
+  auto result = SVFRT_write_sequence64(ctx, (void *) pointer, sizeof(T), count);
+  return {
+    /*.data_offset_complement =*/ result.data_offset_complement,
+    /*.count =*/ result.count,
+  };
+}
+
+template<typename T, typename E, int N>
+static inline
+Sequence64<T> write_fixed_size_array(
+  WriteContext64<E> *ctx,
+  T const (&array)[N]
+) noexcept {
+  return write_sequence(ctx, (T const *) array, (uint64_t) N);
+}
+
+template<typename T, typename E>
+static inline
+void write_sequence_element(
+  WriteContext64<E> *ctx,
+  T const *pointer,
+  Sequence64<T> *inout_sequence
+) noexcept {
+  SVFRT_Sequence64 sequence = {
+    /*.data_offset_complement =*/ inout_sequence->data_offset_complement,
+    /*.count =*/ inout_sequence->count,
+  };
+
+  SVFRT_write_sequence_element64(ctx, (void *) pointer, sizeof(T), &sequence);
 
   inout_sequence->data_offset_complement = sequence.data_offset_complement;
   inout_sequence->count = sequence.count;
@@ -0,0 +1,669 @@
+#ifndef SVFRT_SINGLE_FILE
+  #include "svf_runtime.h"
+  #include "svf_internal.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// #sharded-writing
+//
+// Shards are written independently, so the handles inside of them are relative
+// to the start of the shard. After appending, each shard occupies the range
+// `[base, base + shard->ctx.data_bytes_written)` of the message data, and any
+// handle located in that range needs `base` added to its target. Nothing in
+// the data says which bytes are handles, so the finished message is walked
+// from the entry using the schema, the same way as for #message-verification.
+//
+// Each handle inside of a shard must be fixed up exactly once, which holds
+// because the data is not aliased. This is enforced by the same tally as for
+// the verification, which also bounds the total work by the data size.
+
+void SVFRT_write_shard_start(
+  SVFRT_WriteShard *result,
+  SVFRT_Bytes buffer,
+  SVFRT_GrowBufferFn *grow_fn,
+  void *grow_ptr
+) {
+  result->ctx.error_code = 0;
+  result->ctx.finished = false;
+  result->ctx.writer_ptr = NULL;
+  result->ctx.writer_fn = NULL;
+  result->ctx.data_bytes_written = 0;
+  result->ctx.buffer = buffer;
+  result->ctx.buffer_used = 0;
+  result->ctx.grow_fn = grow_fn;
+  result->ctx.grow_ptr = grow_ptr;
+  result->base = 0;
+
+  if (!buffer.pointer) {
+    result->ctx.error_code = SVFRT_code_write__buffer_full;
+  }
+}
+
+void SVFRT_write_shards(
+  SVFRT_WriteContext *ctx,
+  SVFRT_WriteShard *shards,
+  uint32_t shard_count
+) {
+  for (uint32_t i = 0; i < shard_count; i++) {
+    SVFRT_WriteShard *shard = shards + i;
+    if (!ctx->error_code && shard->ctx.error_code) {
+      ctx->error_code = shard->ctx.error_code;
+    }
+
+    // Shards are written from offset zero, so aligning the start of each one
+    // keeps all the data in it at its #natural-alignment.
+    SVFRT_internal_write_align(ctx, SVFRT_MESSAGE_PART_ALIGNMENT);
+    if (ctx->error_code) {
+      return;
+    }
+
+    shard->base = ctx->data_bytes_written;
+    SVFRT_Bytes bytes = {
+      /*.pointer =*/ shard->ctx.buffer.pointer,
+      /*.count =*/ shard->ctx.buffer_used,
+    };
+
+    SVFRT_internal_write_tally(ctx, bytes.count);
+    if (ctx->error_code) {
+      return;
+    }
+
+    if (bytes.count > 0 && !SVFRT_internal_write_bytes(ctx, bytes)) {
+      return;
+    }
+  }
+}
+
+typedef struct SVFRT_RelocateContext {
+  SVFRT_Bytes schema;
+  SVFRT_RangeStructDefinition structs;
+  SVFRT_RangeChoiceDefinition choices;
+  SVFRT_Bytes data_range;
+  SVFRT_WriteShard const *shards;
+  uint32_t shard_count;
+  uint32_t max_recursion_depth;
+  uint64_t tally;
+  SVFRT_ErrorCode error_code;
+} SVFRT_RelocateContext;
+
+// Forward declaration.
+static
+void SVFRT_relocate_any_type(
+  SVFRT_RelocateContext *ctx,
+  uint32_t recursion_depth,
+  uint32_t data_offset,
+  SVF_Meta_Type_tag type_tag,
+  SVF_Meta_Type_payload *type_payload
+);
+
+// Find the shard containing `data_offset`, or NULL if it is outside of all of
+// them. Shards are sorted by `base`, and don't overlap.
+static
+SVFRT_WriteShard const *SVFRT_relocate_find_shard(
+  SVFRT_RelocateContext *ctx,
+  uint32_t data_offset
+) {
+  uint32_t low = 0;
+  uint32_t high = ctx->shard_count;
+  while (low < high) {
+    uint32_t middle = low + (high - low) / 2;
+    SVFRT_WriteShard const *shard = ctx->shards + middle;
+    if (data_offset < shard->base) {
+      high = middle;
+    } else if (data_offset - shard->base >= shard->ctx.data_bytes_written) {
+      low = middle + 1;
+    } else {
+      return shard;
+    }
+  }
+  return NULL;
+}
+
+// Check that `[data_offset, data_offset + size)` is in bounds, and account for
+// it in the tally. Returns `false` on an error.
+static inline
+bool SVFRT_relocate_suballocation(
+  SVFRT_RelocateContext *ctx,
+  uint32_t data_offset,
+  uint32_t size,
+  uint32_t count
+) {
+  // Prevent multiply-add overflow by casting operands to `uint64_t` first. It
+  // works, because `UINT64_MAX == UINT32_MAX * UINT32_MAX + UINT32_MAX + UINT32_MAX`.
+  uint64_t total_size = (uint64_t) size * (uint64_t) count;
+  if ((uint64_t) data_offset + total_size > (uint64_t) ctx->data_range.count) {
+    ctx->error_code = SVFRT_code_write__relocation_failed;
+    return false;
+  }
+
+  // Both operands are at most `UINT32_MAX`, so this can't overflow.
+  ctx->tally += total_size;
+  if (ctx->tally > (uint64_t) ctx->data_range.count) {
+    ctx->error_code = SVFRT_code_write__relocation_failed;
+    return false;
+  }
+
+  return true;
+}
+
+// Fix up `*inout_complement` of a handle of `handle_size` bytes at `handle_offset`
+// inside of `shard`. It is a copy, since handles in the data may be unaligned.
+// The target, `count` items of `size` bytes, must be inside of the same shard.
+// Empty handles which were never written (zero) are left alone. Returns `false`
+// on an error.
+static
+bool SVFRT_relocate_in_shard(
+  SVFRT_RelocateContext *ctx,
+  SVFRT_WriteShard const *shard,
+  uint32_t handle_offset,
+  uint32_t handle_size,
+  uint32_t *inout_complement,
+  uint32_t size,
+  uint32_t count
+) {
+  if (count == 0 && *inout_complement == 0) {
+    return true;
+  }
+
+  // Prevent addition overflow by casting operands to `uint64_t` first.
+  uint64_t shard_end = (uint64_t) shard->base + (uint64_t) shard->ctx.data_bytes_written;
+  uint64_t target_offset = (uint64_t) ~*inout_complement;
+  if (
+    (uint64_t) handle_offset + (uint64_t) handle_size > shard_end ||
+    target_offset + (uint64_t) size * (uint64_t) count > (uint64_t) shard->ctx.data_bytes_written
+  ) {
+    ctx->error_code = SVFRT_code_write__bad_shard_handle;
+    return false;
+  }
+
+  // The whole target is inside of the shard, so this can't overflow.
+  *inout_complement = ~((uint32_t) target_offset + shard->base);
+  return true;
+}
+
+// Fix up the handle at `data_offset`, if it is inside of a shard, then check
+// its target. Returns `false` on an error.
+static
+bool SVFRT_relocate_handle(
+  SVFRT_RelocateContext *ctx,
+  uint32_t data_offset,
+  uint32_t handle_size,
+  uint32_t *inout_complement,
+  uint32_t size,
+  uint32_t count
+) {
+  SVFRT_WriteShard const *shard = SVFRT_relocate_find_shard(ctx, data_offset);
+  if (shard && !SVFRT_relocate_in_shard(ctx, shard, data_offset, handle_size, inout_complement, size, count)) {
+    return false;
+  }
+
+  return SVFRT_relocate_suballocation(ctx, ~*inout_complement, size, count);
+}
+
+static
+void SVFRT_relocate_struct(
+  SVFRT_RelocateContext *ctx,
+  uint32_t recursion_depth,
+  uint32_t struct_index,
+  uint32_t data_offset
+) {
+  if (recursion_depth >= ctx->max_recursion_depth || struct_index >= ctx->structs.count) {
+    ctx->error_code = SVFRT_code_write__relocation_failed;
+    return;
+  }
+
+  SVFRT_RangeFieldDefinition fields = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
+    ctx->schema,
+    ctx->structs.pointer[struct_index].fields,
+    SVF_Meta_FieldDefinition
+  );
+  if (!fields.pointer && fields.count) {
+    ctx->error_code = SVFRT_code_write__relocation_failed;
+    return;
+  }
+
+  for (uint32_t i = 0; i < fields.count; i++) {
+    SVF_Meta_FieldDefinition *field = fields.pointer + i;
+    if (field->removed) {
+      continue;
+    }
+
+    // Prevent addition overflow by casting operands to `uint64_t` first.
+    if ((uint64_t) data_offset + (uint64_t) field->offset > (uint64_t) ctx->data_range.count) {
+      ctx->error_code = SVFRT_code_write__relocation_failed;
+      return;
+    }
+
+    SVFRT_relocate_any_type(
+      ctx,
+      recursion_depth + 1,
+      data_offset + field->offset,
+      field->type_tag,
+      &field->type_payload
+    );
+
+    if (ctx->error_code) {
+      return;
+    }
+  }
+}
+
+static
+void SVFRT_relocate_choice(
+  SVFRT_RelocateContext *ctx,
+  uint32_t recursion_depth,
+  uint32_t choice_index,
+  uint32_t data_offset
+) {
+  if (recursion_depth >= ctx->max_recursion_depth || choice_index >= ctx->choices.count) {
+    ctx->error_code = SVFRT_code_write__relocation_failed;
+    return;
+  }
+
+  // Prevent addition overflow by casting operands to `uint64_t` first.
+  if ((uint64_t) data_offset + (uint64_t) SVFRT_TAG_SIZE > (uint64_t) ctx->data_range.count) {
+    ctx->error_code = SVFRT_code_write__relocation_failed;
+    return;
+  }
+
+  uint8_t choice_tag = *(ctx->data_range.pointer + data_offset);
+
+  SVFRT_RangeOptionDefinition options = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
+    ctx->schema,
+    ctx->choices.pointer[choice_index].options,
+    SVF_Meta_OptionDefinition
+  );
+  if (!options.pointer && options.count) {
+    ctx->error_code = SVFRT_code_write__relocation_failed;
+    return;
+  }
+
+  for (uint32_t i = 0; i < options.count; i++) {
+    SVF_Meta_OptionDefinition *option = options.pointer + i;
+    if (option->tag != choice_tag) {
+      continue;
+    }
+    if (option->removed) {
+      return;
+    }
+
+    SVFRT_relocate_any_type(
+      ctx,
+      recursion_depth + 1,
+      data_offset + SVFRT_TAG_SIZE,
+      option->type_tag,
+      &option->type_payload
+    );
+    return;
+  }
+}
+
+static
+void SVFRT_relocate_concrete_type(
+  SVFRT_RelocateContext *ctx,
+  uint32_t recursion_depth,
+  uint32_t data_offset,
+  SVF_Meta_ConcreteType_tag type_tag,
+  SVF_Meta_ConcreteType_payload *type_payload
+) {
+  switch (type_tag) {
+    case SVF_Meta_ConcreteType_tag_definedStruct: {
+      SVFRT_relocate_struct(ctx, recursion_depth, type_payload->definedStruct.index, data_offset);
+      return;
+    }
+    case SVF_Meta_ConcreteType_tag_definedChoice: {
+      SVFRT_relocate_choice(ctx, recursion_depth, type_payload->definedChoice.index, data_offset);
+      return;
+    }
+    default: {
+      // Primitives, nothing to do.
+      return;
+    }
+  }
+}
+
+// Walk `count` items at `data_offset`, unless there is nothing to fix up in
+// them. The range is already checked.
+static
+void SVFRT_relocate_items(
+  SVFRT_RelocateContext *ctx,
+  uint32_t recursion_depth,
+  uint32_t data_offset,
+  uint32_t stride,
+  uint32_t count,
+  SVF_Meta_ConcreteType_tag type_tag,
+  SVF_Meta_ConcreteType_payload *type_payload
+) {
+  if (SVFRT_internal_is_flat(
+    ctx->schema,
+    ctx->structs,
+    ctx->choices,
+    recursion_depth,
+    ctx->max_recursion_depth,
+    type_tag,
+    type_payload
+  )) {
+    return;
+  }
+
+  // The whole range is in bounds, so this can't overflow.
+  for (uint32_t i = 0; i < count; i++) {
+    SVFRT_relocate_concrete_type(ctx, recursion_depth, data_offset + i * stride, type_tag, type_payload);
+    if (ctx->error_code) {
+      return;
+    }
+  }
+}
+
+static
+void SVFRT_relocate_chunked_sequence(
+  SVFRT_RelocateContext *ctx,
+  uint32_t recursion_depth,
+  uint32_t data_offset,
+  SVF_Meta_ConcreteType_tag type_tag,
+  SVF_Meta_ConcreteType_payload *type_payload
+) {
+  // Handles are accessed through `SVFRT_MEMCPY`, see #natural-alignment.
+  SVFRT_ChunkedSequence sequence = {0};
+  SVFRT_MEMCPY(&sequence, ctx->data_range.pointer + data_offset, sizeof(sequence));
+  if (sequence.count == 0) {
+    return;
+  }
+
+  uint32_t stride = SVFRT_conversion_get_type_size(ctx->structs, type_tag, type_payload);
+  if (stride == 0) {
+    ctx->error_code = SVFRT_code_write__relocation_failed;
+    return;
+  }
+
+  uint32_t complement = sequence.data_offset_complement;
+  if (!SVFRT_relocate_handle(
+    ctx,
+    data_offset,
+    sizeof(SVFRT_ChunkedSequence),
+    &complement,
+    sizeof(SVFRT_ChunkLink),
+    1
+  )) {
+    return;
+  }
+  sequence.data_offset_complement = complement;
+  SVFRT_MEMCPY(ctx->data_range.pointer + data_offset, &sequence, sizeof(sequence));
+
+  // Each link is fixed up before the iterator reads it, and the iterator does
+  // the same checks as for reading. The first link is already tallied.
+  SVFRT_ReadContext read_ctx = { ctx->data_range, { NULL, 0 } };
+  SVFRT_ChunkIterator iterator = SVFRT_chunk_iterator_begin(sequence);
+  SVFRT_Sequence chunk;
+  while (iterator.link_complement != 0) {
+    uint32_t link_offset = ~iterator.link_complement;
+    if (iterator.started && !SVFRT_relocate_suballocation(ctx, link_offset, sizeof(SVFRT_ChunkLink), 1)) {
+      return;
+    }
+
+    SVFRT_WriteShard const *shard = SVFRT_relocate_find_shard(ctx, link_offset);
+    if (shard) {
+      SVFRT_ChunkLink link = {0};
+      SVFRT_MEMCPY(&link, ctx->data_range.pointer + link_offset, sizeof(link));
+      uint32_t data_complement = link.data_offset_complement;
+      uint32_t previous_complement = link.previous_complement;
+      if (!SVFRT_relocate_in_shard(
+        ctx,
+        shard,
+        link_offset,
+        sizeof(SVFRT_ChunkLink),
+        &data_complement,
+        stride,
+        link.count
+      )) {
+        return;
+      }
+      if (previous_complement != 0 && !SVFRT_relocate_in_shard(
+        ctx,
+        shard,
+        link_offset,
+        sizeof(SVFRT_ChunkLink),
+        &previous_complement,
+        sizeof(SVFRT_ChunkLink),
+        1
+      )) {
+        return;
+      }
+      link.data_offset_complement = data_complement;
+      link.previous_complement = previous_complement;
+      SVFRT_MEMCPY(ctx->data_range.pointer + link_offset, &link, sizeof(link));
+    }
+
+    if (!SVFRT_chunk_iterator_next(&read_ctx, &iterator, &chunk)) {
+      break;
+    }
+
+    uint32_t target_offset = ~chunk.data_offset_complement;
+    if (!SVFRT_relocate_suballocation(ctx, target_offset, stride, chunk.count)) {
+      return;
+    }
+
+    SVFRT_relocate_items(ctx, recursion_depth, target_offset, stride, chunk.count, type_tag, type_payload);
+    if (ctx->error_code) {
+      return;
+    }
+  }
+
+  if (iterator.remaining != 0) {
+    ctx->error_code = SVFRT_code_write__relocation_failed;
+  }
+}
+
+static
+void SVFRT_relocate_any_type(
+  SVFRT_RelocateContext *ctx,
+  uint32_t recursion_depth,
+  uint32_t data_offset,
+  SVF_Meta_Type_tag type_tag,
+  SVF_Meta_Type_payload *type_payload
+) {
+  uint32_t handle_size = 0;
+  switch (type_tag) {
+    case SVF_Meta_Type_tag_reference: {
+      handle_size = sizeof(SVFRT_Reference);
+      break;
+    }
+    case SVF_Meta_Type_tag_sequence: {
+      handle_size = sizeof(SVFRT_Sequence);
+      break;
+    }
+    case SVF_Meta_Type_tag_chunkedSequence: {
+      handle_size = sizeof(SVFRT_ChunkedSequence);
+      break;
+    }
+    default: {
+      break;
+    }
+  }
+
+  // Prevent addition overflow by casting operands to `uint64_t` first.
+  if ((uint64_t) data_offset + (uint64_t) handle_size > (uint64_t) ctx->data_range.count) {
+    ctx->error_code = SVFRT_code_write__relocation_failed;
+    return;
+  }
+
+  switch (type_tag) {
+    case SVF_Meta_Type_tag_concrete: {
+      SVFRT_relocate_concrete_type(
+        ctx,
+        recursion_depth,
+        data_offset,
+        type_payload->concrete.type_tag,
+        &type_payload->concrete.type_payload
+      );
+      return;
+    }
+    case SVF_Meta_Type_tag_reference: {
+      SVFRT_Reference reference = {0};
+      SVFRT_MEMCPY(&reference, ctx->data_range.pointer + data_offset, sizeof(reference));
+
+      uint32_t size = SVFRT_conversion_get_type_size(
+        ctx->structs,
+        type_payload->reference.type_tag,
+        &type_payload->reference.type_payload
+      );
+      if (size == 0) {
+        ctx->error_code = SVFRT_code_write__relocation_failed;
+        return;
+      }
+
+      uint32_t complement = reference.data_offset_complement;
+      if (!SVFRT_relocate_handle(ctx, data_offset, handle_size, &complement, size, 1)) {
+        return;
+      }
+      reference.data_offset_complement = complement;
+      SVFRT_MEMCPY(ctx->data_range.pointer + data_offset, &reference, sizeof(reference));
+
+      SVFRT_relocate_concrete_type(
+        ctx,
+        recursion_depth,
+        ~complement,
+        type_payload->reference.type_tag,
+        &type_payload->reference.type_payload
+      );
+      return;
+    }
+    case SVF_Meta_Type_tag_sequence: {
+      SVFRT_Sequence sequence = {0};
+      SVFRT_MEMCPY(&sequence, ctx->data_range.pointer + data_offset, sizeof(sequence));
+
+      uint32_t stride = SVFRT_conversion_get_type_size(
+        ctx->structs,
+        type_payload->sequence.elementType_tag,
+        &type_payload->sequence.elementType_payload
+      );
+      if (stride == 0) {
+        ctx->error_code = SVFRT_code_write__relocation_failed;
+        return;
+      }
+
+      // Empty sequences which were never written have nothing to check.
+      if (sequence.count == 0 && sequence.data_offset_complement == 0) {
+        return;
+      }
+
+      uint32_t complement = sequence.data_offset_complement;
+      if (!SVFRT_relocate_handle(ctx, data_offset, handle_size, &complement, stride, sequence.count)) {
+        return;
+      }
+      sequence.data_offset_complement = complement;
+      SVFRT_MEMCPY(ctx->data_range.pointer + data_offset, &sequence, sizeof(sequence));
+
+      SVFRT_relocate_items(
+        ctx,
+        recursion_depth,
+        ~complement,
+        stride,
+        sequence.count,
+        type_payload->sequence.elementType_tag,
+        &type_payload->sequence.elementType_payload
+      );
+      return;
+    }
+    case SVF_Meta_Type_tag_chunkedSequence: {
+      SVFRT_relocate_chunked_sequence(
+        ctx,
+        recursion_depth,
+        data_offset,
+        type_payload->chunkedSequence.elementType_tag,
+        &type_payload->chunkedSequence.elementType_payload
+      );
+      return;
+    }
+    case SVF_Meta_Type_tag_nothing:
+    default: {
+      return;
+    }
+  }
+}
+
+SVFRT_ErrorCode SVFRT_write_relocate_shards(
+  SVFRT_Bytes message,
+  SVFRT_WriteShard const *shards,
+  uint32_t shard_count,
+  SVFRT_Bytes schema,
+  uint32_t entry_struct_index,
+  uint32_t max_recursion_depth
+) {
+  SVF_Meta_SchemaDefinition *definition = SVFRT_internal_schema_definition(schema);
+  if (message.count < sizeof(SVFRT_MessageHeader) || !definition) {
+    return SVFRT_code_write__relocation_failed;
+  }
+
+  // The data starts after the schema and the appendix, both padded, see
+  // `SVFRT_write_start`.
+  SVFRT_MessageHeader *header = (SVFRT_MessageHeader *) message.pointer;
+  uint64_t alignment = SVFRT_MESSAGE_PART_ALIGNMENT;
+  uint64_t schema_end = (uint64_t) sizeof(SVFRT_MessageHeader) + (uint64_t) header->schema_length;
+  uint64_t data_start = (
+    (schema_end + alignment - 1) / alignment * alignment + (uint64_t) header->appendix_length
+    + alignment - 1
+  ) / alignment * alignment;
+  if (data_start > (uint64_t) message.count) {
+    return SVFRT_code_write__relocation_failed;
+  }
+
+  SVFRT_RelocateContext ctx = {0};
+  ctx.schema = schema;
+  ctx.data_range.pointer = message.pointer + data_start;
+  ctx.data_range.count = message.count - (uint32_t) data_start;
+  ctx.shards = shards;
+  ctx.shard_count = shard_count;
+  ctx.max_recursion_depth = max_recursion_depth;
+
+  SVFRT_RangeStructDefinition structs = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
+    schema,
+    definition->structs,
+    SVF_Meta_StructDefinition
+  );
+  SVFRT_RangeChoiceDefinition choices = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
+    schema,
+    definition->choices,
+    SVF_Meta_ChoiceDefinition
+  );
+  if ((!structs.pointer && structs.count) || (!choices.pointer && choices.count)) {
+    return SVFRT_code_write__relocation_failed;
+  }
+  ctx.structs = structs;
+  ctx.choices = choices;
+
+  // Shards must be in order, and inside of the data.
+  uint64_t previous_end = 0;
+  for (uint32_t i = 0; i < shard_count; i++) {
+    uint64_t base = (uint64_t) shards[i].base;
+    uint64_t end = base + (uint64_t) shards[i].ctx.data_bytes_written;
+    if (base < previous_end || end > (uint64_t) ctx.data_range.count) {
+      return SVFRT_code_write__bad_shard_handle;
+    }
+    previous_end = end;
+  }
+
+  // The entry is always written last, see `SVFRT_write_finish`.
+  if (entry_struct_index >= structs.count) {
+    return SVFRT_code_write__relocation_failed;
+  }
+  uint32_t entry_size = structs.pointer[entry_struct_index].size;
+  if (entry_size > ctx.data_range.count) {
+    return SVFRT_code_write__relocation_failed;
+  }
+  uint32_t entry_offset = ctx.data_range.count - entry_size;
+
+  if (!SVFRT_relocate_suballocation(&ctx, entry_offset, entry_size, 1)) {
+    return ctx.error_code;
+  }
+
+  SVFRT_relocate_struct(&ctx, 0, entry_struct_index, entry_offset);
+  return ctx.error_code;
+}
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,592 @@
+#ifndef SVFRT_SINGLE_FILE
+  #include "svf_runtime.h"
+  #include "svf_internal.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// #message-verification
+//
+// The message is walked once from the entry, using the read schema (which is
+// trusted) and the strides from the read context, which are correct for the
+// data at any compatibility level (see #logical-compatibility-stride-quirk).
+// Every reference and sequence reachable through the schema is checked to be
+// in bounds, which is exactly what the `*_unchecked` accessors rely on.
+//
+// Same as for the conversion, all referenced ranges together may not be larger
+// than the data itself, which rules out aliasing and bounds the total work by
+// the data size (see `SVFRT_code_conversion__data_aliasing_detected`).
+//
+// Offsets are 64-bit, so that #wide-messages are verified by the same walk.
+// Only the size of references and sequences differs for them.
+
+typedef struct SVFRT_VerifyContext {
+  SVFRT_Bytes schema;
+  SVFRT_RangeStructDefinition structs;
+  SVFRT_RangeChoiceDefinition choices;
+  SVFRT_Bytes64 data_range;
+  SVFRT_RangeU32 struct_strides;
+  uint32_t max_recursion_depth;
+  bool wide;
+  uint64_t tally;
+  SVFRT_ErrorCode error_code;
+} SVFRT_VerifyContext;
+
+// Forward declaration.
+static
+void SVFRT_verify_any_type(
+  SVFRT_VerifyContext *ctx,
+  uint32_t recursion_depth,
+  uint64_t data_offset,
+  SVF_Meta_Type_tag type_tag,
+  SVF_Meta_Type_payload *type_payload
+);
+
+// Check that `[data_offset, data_offset + size)` is in bounds, and account for
+// it in the tally. Returns `false` on an error.
+static inline
+bool SVFRT_verify_suballocation(
+  SVFRT_VerifyContext *ctx,
+  uint64_t data_offset,
+  uint32_t size,
+  uint64_t count
+) {
+  // Counts may be 64-bit, so prevent multiply-add overflow by comparing with
+  // what fits into the data first.
+  if (size != 0 && count > ctx->data_range.count / size) {
+    ctx->error_code = SVFRT_code_verify__data_out_of_bounds;
+    return false;
+  }
+  uint64_t total_size = (uint64_t) size * count;
+  if (data_offset > ctx->data_range.count - total_size) {
+    ctx->error_code = SVFRT_code_verify__data_out_of_bounds;
+    return false;
+  }
+
+  // The tally never exceeds the data size, so this can't wrap.
+  if (total_size > ctx->data_range.count - ctx->tally) {
+    ctx->error_code = SVFRT_code_verify__data_aliasing_detected;
+    return false;
+  }
+  ctx->tally += total_size;
+
+  return true;
+}
+
+// Read the handle at `data_offset`, which is either a reference or a sequence,
+// regular or wide. References have a count of one. Returns `false` on an error.
+static inline
+bool SVFRT_verify_read_handle(
+  SVFRT_VerifyContext *ctx,
+  uint64_t data_offset,
+  bool is_sequence,
+  uint64_t *out_target_offset,
+  uint64_t *out_count
+) {
+  uint32_t size = ctx->wide
+    ? (is_sequence ? sizeof(SVFRT_Sequence64) : sizeof(SVFRT_Reference64))
+    : (is_sequence ? sizeof(SVFRT_Sequence) : sizeof(SVFRT_Reference));
+  if (size > ctx->data_range.count - data_offset) {
+    ctx->error_code = SVFRT_code_verify__data_out_of_bounds;
+    return false;
+  }
+
+  uint8_t *pointer = ctx->data_range.pointer + data_offset;
+  if (ctx->wide) {
+    SVFRT_Sequence64 handle = {0};
+    SVFRT_MEMCPY(&handle, pointer, size);
+    *out_target_offset = ~handle.data_offset_complement;
+    *out_count = is_sequence ? handle.count : 1;
+  } else {
+    SVFRT_Sequence handle = {0};
+    SVFRT_MEMCPY(&handle, pointer, size);
+    *out_target_offset = (uint32_t) ~handle.data_offset_complement;
+    *out_count = is_sequence ? handle.count : 1;
+  }
+  return true;
+}
+
+static
+void SVFRT_verify_struct(
+  SVFRT_VerifyContext *ctx,
+  uint32_t recursion_depth,
+  uint32_t struct_index,
+  uint64_t data_offset
+) {
+  if (recursion_depth >= ctx->max_recursion_depth) {
+    ctx->error_code = SVFRT_code_verify__max_recursion_depth_exceeded;
+    return;
+  }
+
+  if (struct_index >= ctx->structs.count) {
+    ctx->error_code = SVFRT_code_verify__bad_schema;
+    return;
+  }
+
+  SVFRT_RangeFieldDefinition fields = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
+    ctx->schema,
+    ctx->structs.pointer[struct_index].fields,
+    SVF_Meta_FieldDefinition
+  );
+  if (!fields.pointer && fields.count) {
+    ctx->error_code = SVFRT_code_verify__bad_schema;
+    return;
+  }
+
+  for (uint32_t i = 0; i < fields.count; i++) {
+    SVF_Meta_FieldDefinition *field = fields.pointer + i;
+    if (field->removed) {
+      continue;
+    }
+
+    // `data_offset` is always within the data, so this can't wrap.
+    if ((uint64_t) field->offset > ctx->data_range.count - data_offset) {
+      ctx->error_code = SVFRT_code_verify__data_out_of_bounds;
+      return;
+    }
+
+    SVFRT_verify_any_type(
+      ctx,
+      recursion_depth + 1,
+      data_offset + field->offset,
+      field->type_tag,
+      &field->type_payload
+    );
+
+    if (ctx->error_code) {
+      return;
+    }
+  }
+}
+
+static
+void SVFRT_verify_choice(
+  SVFRT_VerifyContext *ctx,
+  uint32_t recursion_depth,
+  uint32_t choice_index,
+  uint64_t data_offset
+) {
+  if (recursion_depth >= ctx->max_recursion_depth) {
+    ctx->error_code = SVFRT_code_verify__max_recursion_depth_exceeded;
+    return;
+  }
+
+  if (choice_index >= ctx->choices.count) {
+    ctx->error_code = SVFRT_code_verify__bad_schema;
+    return;
+  }
+
+  // `data_offset` is always within the data, so this can't wrap.
+  if ((uint64_t) SVFRT_TAG_SIZE > ctx->data_range.count - data_offset) {
+    ctx->error_code = SVFRT_code_verify__data_out_of_bounds;
+    return;
+  }
+
+  uint8_t choice_tag = *(ctx->data_range.pointer + data_offset);
+
+  SVFRT_RangeOptionDefinition options = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
+    ctx->schema,
+    ctx->choices.pointer[choice_index].options,
+    SVF_Meta_OptionDefinition
+  );
+  if (!options.pointer && options.count) {
+    ctx->error_code = SVFRT_code_verify__bad_schema;
+    return;
+  }
+
+  for (uint32_t i = 0; i < options.count; i++) {
+    SVF_Meta_OptionDefinition *option = options.pointer + i;
+    if (option->tag != choice_tag) {
+      continue;
+    }
+
+    // Unknown tags and removed options have no payload to read.
+    if (option->removed) {
+      return;
+    }
+
+    SVFRT_verify_any_type(
+      ctx,
+      recursion_depth + 1,
+      data_offset + SVFRT_TAG_SIZE,
+      option->type_tag,
+      &option->type_payload
+    );
+    return;
+  }
+}
+
+static
+void SVFRT_verify_concrete_type(
+  SVFRT_VerifyContext *ctx,
+  uint32_t recursion_depth,
+  uint64_t data_offset,
+  SVF_Meta_ConcreteType_tag type_tag,
+  SVF_Meta_ConcreteType_payload *type_payload
+) {
+  switch (type_tag) {
+    case SVF_Meta_ConcreteType_tag_definedStruct: {
+      SVFRT_verify_struct(ctx, recursion_depth, type_payload->definedStruct.index, data_offset);
+      return;
+    }
+    case SVF_Meta_ConcreteType_tag_definedChoice: {
+      SVFRT_verify_choice(ctx, recursion_depth, type_payload->definedChoice.index, data_offset);
+      return;
+    }
+    default: {
+      // Primitives, nothing to do.
+      return;
+    }
+  }
+}
+
+// Stride of a referenced type in the data. For structs, this is the stride from
+// the read context, and not the size from the schema.
+static inline
+uint32_t SVFRT_verify_get_stride(
+  SVFRT_VerifyContext *ctx,
+  SVF_Meta_ConcreteType_tag type_tag,
+  SVF_Meta_ConcreteType_payload *type_payload
+) {
+  if (type_tag == SVF_Meta_ConcreteType_tag_definedStruct) {
+    uint32_t struct_index = type_payload->definedStruct.index;
+    if (struct_index >= ctx->struct_strides.count) {
+      return 0;
+    }
+    return ctx->struct_strides.pointer[struct_index];
+  }
+  return SVFRT_conversion_get_type_size(ctx->structs, type_tag, type_payload);
+}
+
+// Check that non-empty referenced data at `target_offset` is aligned for the
+// read type, see #natural-alignment. Returns `false` on an error.
+static inline
+bool SVFRT_verify_alignment(
+  SVFRT_VerifyContext *ctx,
+  uint64_t target_offset,
+  uint64_t count,
+  SVF_Meta_ConcreteType_tag type_tag,
+  SVF_Meta_ConcreteType_payload *type_payload
+) {
+  if (count == 0) {
+    return true;
+  }
+
+  uint32_t alignment = SVFRT_conversion_get_type_alignment(ctx->structs, type_tag, type_payload);
+  if (alignment == 0) {
+    ctx->error_code = SVFRT_code_verify__bad_schema;
+    return false;
+  }
+  if (target_offset % alignment != 0) {
+    ctx->error_code = SVFRT_code_verify__data_not_aligned;
+    return false;
+  }
+  return true;
+}
+
+static
+void SVFRT_verify_any_type(
+  SVFRT_VerifyContext *ctx,
+  uint32_t recursion_depth,
+  uint64_t data_offset,
+  SVF_Meta_Type_tag type_tag,
+  SVF_Meta_Type_payload *type_payload
+) {
+  switch (type_tag) {
+    case SVF_Meta_Type_tag_concrete: {
+      SVFRT_verify_concrete_type(
+        ctx,
+        recursion_depth,
+        data_offset,
+        type_payload->concrete.type_tag,
+        &type_payload->concrete.type_payload
+      );
+      return;
+    }
+    case SVF_Meta_Type_tag_reference: {
+      uint64_t target_offset;
+      uint64_t count;
+      if (!SVFRT_verify_read_handle(ctx, data_offset, false, &target_offset, &count)) {
+        return;
+      }
+
+      uint32_t stride = SVFRT_verify_get_stride(
+        ctx,
+        type_payload->reference.type_tag,
+        &type_payload->reference.type_payload
+      );
+      if (stride == 0) {
+        ctx->error_code = SVFRT_code_verify__bad_schema;
+        return;
+      }
+
+      if (!SVFRT_verify_suballocation(ctx, target_offset, stride, count)) {
+        return;
+      }
+
+      if (!SVFRT_verify_alignment(
+        ctx,
+        target_offset,
+        count,
+        type_payload->reference.type_tag,
+        &type_payload->reference.type_payload
+      )) {
+        return;
+      }
+
+      SVFRT_verify_concrete_type(
+        ctx,
+        recursion_depth,
+        target_offset,
+        type_payload->reference.type_tag,
+        &type_payload->reference.type_payload
+      );
+      return;
+    }
+    case SVF_Meta_Type_tag_sequence: {
+      uint64_t target_offset;
+      uint64_t count;
+      if (!SVFRT_verify_read_handle(ctx, data_offset, true, &target_offset, &count)) {
+        return;
+      }
+
+      uint32_t stride = SVFRT_verify_get_stride(
+        ctx,
+        type_payload->sequence.elementType_tag,
+        &type_payload->sequence.elementType_payload
+      );
+      if (stride == 0) {
+        ctx->error_code = SVFRT_code_verify__bad_schema;
+        return;
+      }
+
+      if (!SVFRT_verify_suballocation(ctx, target_offset, stride, count)) {
+        return;
+      }
+
+      if (!SVFRT_verify_alignment(
+        ctx,
+        target_offset,
+        count,
+        type_payload->sequence.elementType_tag,
+        &type_payload->sequence.elementType_payload
+      )) {
+        return;
+      }
+
+      if (SVFRT_internal_is_flat(
+        ctx->schema,
+        ctx->structs,
+        ctx->choices,
+        recursion_depth,
+        ctx->max_recursion_depth,
+        type_payload->sequence.elementType_tag,
+        &type_payload->sequence.elementType_payload
+      )) {
+        return;
+      }
+
+      // The whole range is in bounds, so this can't overflow.
+      for (uint64_t i = 0; i < count; i++) {
+        SVFRT_verify_concrete_type(
+          ctx,
+          recursion_depth,
+          target_offset + i * stride,
+          type_payload->sequence.elementType_tag,
+          &type_payload->sequence.elementType_payload
+        );
+
+        if (ctx->error_code) {
+          return;
+        }
+      }
+      return;
+    }
+    case SVF_Meta_Type_tag_chunkedSequence: {
+      // Chunked sequences are never wide.
+      if (ctx->wide) {
+        ctx->error_code = SVFRT_code_verify__bad_schema;
+        return;
+      }
+
+      // `data_offset` is always within the data, so this can't wrap.
+      if ((uint64_t) sizeof(SVFRT_ChunkedSequence) > ctx->data_range.count - data_offset) {
+        ctx->error_code = SVFRT_code_verify__data_out_of_bounds;
+        return;
+      }
+
+      SVFRT_ChunkedSequence sequence = {0};
+      SVFRT_MEMCPY(&sequence, ctx->data_range.pointer + data_offset, sizeof(sequence));
+
+      uint32_t stride = SVFRT_verify_get_stride(
+        ctx,
+        type_payload->chunkedSequence.elementType_tag,
+        &type_payload->chunkedSequence.elementType_payload
+      );
+      if (stride == 0) {
+        ctx->error_code = SVFRT_code_verify__bad_schema;
+        return;
+      }
+
+      bool is_flat = SVFRT_internal_is_flat(
+        ctx->schema,
+        ctx->structs,
+        ctx->choices,
+        recursion_depth,
+        ctx->max_recursion_depth,
+        type_payload->chunkedSequence.elementType_tag,
+        &type_payload->chunkedSequence.elementType_payload
+      );
+
+      // Each link is tallied as well, so a chain can't be longer than the data.
+      // Regular data is never larger than `UINT32_MAX` bytes.
+      SVFRT_Bytes data_range = {
+        /*.pointer =*/ ctx->data_range.pointer,
+        /*.count =*/ (uint32_t) ctx->data_range.count,
+      };
+      SVFRT_ReadContext read_ctx = { data_range, ctx->struct_strides };
+      SVFRT_ChunkIterator iterator = SVFRT_chunk_iterator_begin(sequence);
+      SVFRT_Sequence chunk;
+      while (true) {
+        uint32_t link_offset = ~iterator.link_complement;
+        if (!SVFRT_chunk_iterator_next(&read_ctx, &iterator, &chunk)) {
+          break;
+        }
+
+        if (!SVFRT_verify_suballocation(ctx, link_offset, sizeof(SVFRT_ChunkLink), 1)) {
+          return;
+        }
+
+        uint32_t target_offset = ~chunk.data_offset_complement;
+        if (!SVFRT_verify_suballocation(ctx, target_offset, stride, chunk.count)) {
+          return;
+        }
+
+        if (!SVFRT_verify_alignment(
+          ctx,
+          target_offset,
+          chunk.count,
+          type_payload->chunkedSequence.elementType_tag,
+          &type_payload->chunkedSequence.elementType_payload
+        )) {
+          return;
+        }
+
+        if (is_flat) {
+          continue;
+        }
+
+        // The whole range is in bounds, so this can't overflow.
+        for (uint32_t i = 0; i < chunk.count; i++) {
+          SVFRT_verify_concrete_type(
+            ctx,
+            recursion_depth,
+            target_offset + i * stride,
+            type_payload->chunkedSequence.elementType_tag,
+            &type_payload->chunkedSequence.elementType_payload
+          );
+
+          if (ctx->error_code) {
+            return;
+          }
+        }
+      }
+
+      if (iterator.remaining != 0) {
+        ctx->error_code = SVFRT_code_verify__bad_chunk_link;
+      }
+      return;
+    }
+    case SVF_Meta_Type_tag_nothing:
+    default: {
+      return;
+    }
+  }
+}
+
+// Everything after the context has the data range, the strides and `wide`.
+static
+SVFRT_ErrorCode SVFRT_verify_entry(
+  SVFRT_VerifyContext *ctx,
+  SVFRT_ReadMessageParams *params,
+  void *entry_pointer
+) {
+  SVFRT_Bytes schema = params->expected_schema;
+  SVF_Meta_SchemaDefinition *definition = SVFRT_internal_schema_definition(schema);
+  if (!definition) {
+    return SVFRT_code_verify__bad_schema;
+  }
+
+  ctx->schema = schema;
+  ctx->max_recursion_depth = params->max_recursion_depth;
+
+  SVFRT_RangeStructDefinition structs = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
+    schema,
+    definition->structs,
+    SVF_Meta_StructDefinition
+  );
+  SVFRT_RangeChoiceDefinition choices = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
+    schema,
+    definition->choices,
+    SVF_Meta_ChoiceDefinition
+  );
+  if ((!structs.pointer && structs.count) || (!choices.pointer && choices.count)) {
+    return SVFRT_code_verify__bad_schema;
+  }
+  ctx->structs = structs;
+  ctx->choices = choices;
+
+  uint32_t entry_struct_index = params->entry_struct_index;
+  if (entry_struct_index >= ctx->struct_strides.count || entry_struct_index >= structs.count) {
+    return SVFRT_code_verify__bad_schema;
+  }
+
+  uint8_t *entry = (uint8_t *) entry_pointer;
+  if (entry < ctx->data_range.pointer || entry > ctx->data_range.pointer + ctx->data_range.count) {
+    return SVFRT_code_verify__data_out_of_bounds;
+  }
+  uint64_t entry_offset = (uint64_t) (entry - ctx->data_range.pointer);
+
+  if (!SVFRT_verify_suballocation(ctx, entry_offset, ctx->struct_strides.pointer[entry_struct_index], 1)) {
+    return ctx->error_code;
+  }
+
+  SVFRT_verify_struct(ctx, 0, entry_struct_index, entry_offset);
+  return ctx->error_code;
+}
+
+SVFRT_ErrorCode SVFRT_verify_message(
+  SVFRT_ReadMessageParams *params,
+  SVFRT_ReadMessageResult *result
+) {
+  if (result->error_code != 0 || !result->entry) {
+    return SVFRT_code_verify__no_entry;
+  }
+
+  SVFRT_VerifyContext ctx = {0};
+  ctx.data_range.pointer = result->context.data_range.pointer;
+  ctx.data_range.count = result->context.data_range.count;
+  ctx.struct_strides = result->context.struct_strides;
+  return SVFRT_verify_entry(&ctx, params, result->entry);
+}
+
+SVFRT_ErrorCode SVFRT_verify_message64(
+  SVFRT_ReadMessageParams *params,
+  SVFRT_ReadMessageResult64 *result
+) {
+  if (result->error_code != 0 || !result->entry) {
+    return SVFRT_code_verify__no_entry;
+  }
+
+  SVFRT_VerifyContext ctx = {0};
+  ctx.data_range = result->context.data_range;
+  ctx.struct_strides = result->context.struct_strides;
+  ctx.wide = true;
+  return SVFRT_verify_entry(&ctx, params, result->entry);
+}
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,1086 @@
+#ifndef SVFRT_SINGLE_FILE
+  #include "svf_runtime.h"
+  #include "svf_internal.h"
+  #include "svf_meta.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// #lazy-view
+//
+// Without a conversion, values are read in place. Binary compatibility means
+// that the fields of the dst-schema are at the same offsets in the data, so
+// the dst-schema is used for both sides, and only the struct strides come from
+// the compatibility result. With a conversion, fields and options are matched
+// the same way as in the regular conversion, and values are converted with it.
+
+// A value inside a struct, found by its dst-offset. `unsafe_type_payload_src`
+// is NULL if the value is missing, and then it reads as zero. `type_tag_dst` is
+// `SVF_Meta_Type_tag_nothing` if the value is not known at all, e.g. the
+// payload of an unknown option.
+typedef struct SVFRT_ViewSlot {
+  SVF_Meta_Type_tag type_tag_dst;
+  SVF_Meta_Type_payload *type_payload_dst;
+  SVF_Meta_Type_tag unsafe_type_tag_src;
+  SVF_Meta_Type_payload *unsafe_type_payload_src;
+  SVFRT_Bytes unsafe_struct_bytes_src;
+  uint32_t unsafe_offset_src; // In `unsafe_struct_bytes_src`.
+} SVFRT_ViewSlot;
+
+// Keep only the first error, see #lazy-view.
+static inline
+void SVFRT_view_fail(SVFRT_LazyRead *read, SVFRT_ErrorCode error_code) {
+  if (!read->error_code) {
+    read->error_code = error_code;
+  }
+}
+
+static inline
+SVFRT_LazyView SVFRT_view_absent(SVFRT_LazyRead *read, uint32_t struct_index_dst) {
+  SVFRT_LazyView result = {0};
+  result.read = read;
+  result.unsafe_struct_index_src = UINT32_MAX;
+  result.struct_index_dst = struct_index_dst;
+  return result;
+}
+
+// Size of a src-struct in the data.
+static
+bool SVFRT_view_struct_size_src(
+  SVFRT_LazyReadState *state,
+  uint32_t unsafe_struct_index_src,
+  uint32_t *out_size
+) {
+  if (state->converting) {
+    if (unsafe_struct_index_src >= state->unsafe_structs_src.count) {
+      return false;
+    }
+    *out_size = state->unsafe_structs_src.pointer[unsafe_struct_index_src].size;
+    return true;
+  }
+
+  // This is the src-stride. See #logical-compatibility-stride-quirk.
+  if (unsafe_struct_index_src >= state->check_result.quirky_struct_strides_dst.count) {
+    return false;
+  }
+  *out_size = state->check_result.quirky_struct_strides_dst.pointer[unsafe_struct_index_src];
+  return true;
+}
+
+// Same as `SVFRT_conversion_get_type_size`, but choices have a size as well.
+static
+uint32_t SVFRT_view_concrete_size(
+  SVFRT_RangeStructDefinition structs,
+  SVFRT_RangeChoiceDefinition choices,
+  SVF_Meta_ConcreteType_tag type_tag,
+  SVF_Meta_ConcreteType_payload *type_payload
+) {
+  if (type_tag == SVF_Meta_ConcreteType_tag_definedChoice) {
+    uint32_t index = type_payload->definedChoice.index;
+    if (index >= choices.count) {
+      return 0;
+    }
+    return SVFRT_TAG_SIZE + choices.pointer[index].payloadSize;
+  }
+  return SVFRT_conversion_get_type_size(structs, type_tag, type_payload);
+}
+
+// Stride of src-values in a sequence.
+static
+uint32_t SVFRT_view_stride_src(
+  SVFRT_LazyReadState *state,
+  SVF_Meta_ConcreteType_tag unsafe_type_tag_src,
+  SVF_Meta_ConcreteType_payload *unsafe_type_payload_src
+) {
+  if (unsafe_type_tag_src == SVF_Meta_ConcreteType_tag_definedStruct) {
+    uint32_t size = 0;
+    SVFRT_view_struct_size_src(state, unsafe_type_payload_src->definedStruct.index, &size);
+    return size;
+  }
+  return SVFRT_view_concrete_size(
+    state->unsafe_structs_src,
+    state->unsafe_choices_src,
+    unsafe_type_tag_src,
+    unsafe_type_payload_src
+  );
+}
+
+// Make a view of the struct at `unsafe_data_offset`, after checking that it's
+// in bounds.
+static
+SVFRT_LazyView SVFRT_view_make(
+  SVFRT_LazyRead *read,
+  uint32_t unsafe_data_offset,
+  uint32_t unsafe_struct_index_src,
+  uint32_t struct_index_dst
+) {
+  SVFRT_LazyReadState *state = (SVFRT_LazyReadState *) read->state;
+
+  uint32_t unsafe_size_src = 0;
+  if (
+    struct_index_dst >= state->structs_dst.count ||
+    !SVFRT_view_struct_size_src(state, unsafe_struct_index_src, &unsafe_size_src)
+  ) {
+    SVFRT_view_fail(read, SVFRT_code_view__bad_schema);
+    return SVFRT_view_absent(read, struct_index_dst);
+  }
+
+  // Prevent addition overflow by casting operands to `uint64_t` first.
+  if ((uint64_t) unsafe_data_offset + (uint64_t) unsafe_size_src > (uint64_t) state->data_range.count) {
+    SVFRT_view_fail(read, SVFRT_code_view__data_out_of_bounds);
+    return SVFRT_view_absent(read, struct_index_dst);
+  }
+
+  SVFRT_LazyView result = {0};
+  result.read = read;
+  result.data_offset = unsafe_data_offset;
+  result.unsafe_struct_index_src = unsafe_struct_index_src;
+  result.struct_index_dst = struct_index_dst;
+  return result;
+}
+
+// Find the src-field for the `i`-th dst-field, same as `SVFRT_conversion_match_field`.
+//
+// Returns NULL, if the field is missing, or on an error.
+static
+SVF_Meta_FieldDefinition *SVFRT_view_match_field(
+  SVFRT_LazyView view,
+  SVFRT_RangeFieldDefinition fields_dst,
+  uint32_t i
+) {
+  SVFRT_LazyRead *read = view.read;
+  SVFRT_LazyReadState *state = (SVFRT_LazyReadState *) read->state;
+  SVFRT_LogicalCompatibilityInfo *info = &state->check_result.logical;
+
+  if (view.struct_index_dst >= info->field_matches_header.count) {
+    SVFRT_view_fail(read, SVFRT_code_view__bad_schema);
+    return NULL;
+  }
+  uint32_t field_matches_index = info->field_matches_header.pointer[view.struct_index_dst];
+
+  // Prevent addition overflow by casting operands to `uint64_t` first.
+  if ((uint64_t) field_matches_index + (uint64_t) i >= (uint64_t) info->field_matches.count) {
+    SVFRT_view_fail(read, SVFRT_code_view__bad_schema);
+    return NULL;
+  }
+  uint32_t j = info->field_matches.pointer[field_matches_index + i];
+
+  if (j == UINT32_MAX) {
+    return NULL;
+  }
+
+  // The index was checked in `SVFRT_view_make`.
+  SVF_Meta_StructDefinition *unsafe_definition_src = state->unsafe_structs_src.pointer + view.unsafe_struct_index_src;
+  SVFRT_RangeFieldDefinition unsafe_fields_src = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
+    state->unsafe_schema_src,
+    unsafe_definition_src->fields,
+    SVF_Meta_FieldDefinition
+  );
+  if (
+    (!unsafe_fields_src.pointer && unsafe_fields_src.count) ||
+    j >= unsafe_fields_src.count ||
+    unsafe_fields_src.pointer[j].fieldId != fields_dst.pointer[i].fieldId
+  ) {
+    SVFRT_view_fail(read, SVFRT_code_view__bad_schema);
+    return NULL;
+  }
+
+  return unsafe_fields_src.pointer + j;
+}
+
+// Find the pair of options for the tag at `unsafe_tag_offset_src`, same as
+// `SVFRT_conversion_resolve_choice`.
+//
+// Returns false, if there is no payload, or on an error.
+static
+bool SVFRT_view_resolve_option(
+  SVFRT_LazyRead *read,
+  SVFRT_Bytes unsafe_struct_bytes_src,
+  uint32_t unsafe_tag_offset_src,
+  uint32_t unsafe_choice_index_src,
+  uint32_t choice_index_dst,
+  SVF_Meta_OptionDefinition **out_unsafe_option_src,
+  SVF_Meta_OptionDefinition **out_option_dst
+) {
+  SVFRT_LazyReadState *state = (SVFRT_LazyReadState *) read->state;
+
+  // Prevent addition overflow by casting operands to `uint64_t` first.
+  if ((uint64_t) unsafe_tag_offset_src + (uint64_t) SVFRT_TAG_SIZE > (uint64_t) unsafe_struct_bytes_src.count) {
+    SVFRT_view_fail(read, SVFRT_code_view__data_out_of_bounds);
+    return false;
+  }
+
+  uint8_t choice_tag = unsafe_struct_bytes_src.pointer[unsafe_tag_offset_src];
+
+  if (choice_index_dst >= state->choices_dst.count) {
+    SVFRT_view_fail(read, SVFRT_code_view__bad_schema);
+    return false;
+  }
+  SVFRT_RangeOptionDefinition options_dst = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
+    state->schema_dst,
+    state->choices_dst.pointer[choice_index_dst].options,
+    SVF_Meta_OptionDefinition
+  );
+  if (!options_dst.pointer && options_dst.count) {
+    SVFRT_view_fail(read, SVFRT_code_view__bad_schema);
+    return false;
+  }
+
+  if (!state->converting) {
+    for (uint32_t i = 0; i < options_dst.count; i++) {
+      SVF_Meta_OptionDefinition *option_dst = options_dst.pointer + i;
+      if (option_dst->tag == choice_tag && !option_dst->removed) {
+        *out_unsafe_option_src = option_dst;
+        *out_option_dst = option_dst;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  SVFRT_LogicalCompatibilityInfo *info = &state->check_result.logical;
+
+  if (unsafe_choice_index_src >= state->unsafe_choices_src.count) {
+    SVFRT_view_fail(read, SVFRT_code_view__bad_schema);
+    return false;
+  }
+  SVFRT_RangeOptionDefinition unsafe_options_src = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
+    state->unsafe_schema_src,
+    state->unsafe_choices_src.pointer[unsafe_choice_index_src].options,
+    SVF_Meta_OptionDefinition
+  );
+  if (!unsafe_options_src.pointer && unsafe_options_src.count) {
+    SVFRT_view_fail(read, SVFRT_code_view__bad_schema);
+    return false;
+  }
+
+  if (choice_index_dst >= info->option_matches_header.count) {
+    SVFRT_view_fail(read, SVFRT_code_view__bad_schema);
+    return false;
+  }
+  uint32_t option_matches_index = info->option_matches_header.pointer[choice_index_dst];
+  if (
+    (uint64_t) option_matches_index + (uint64_t) options_dst.count > (uint64_t) info->option_matches.count ||
+    (uint64_t) option_matches_index + (uint64_t) options_dst.count > (uint64_t) info->option_matches_tags.count
+  ) {
+    SVFRT_view_fail(read, SVFRT_code_view__bad_schema);
+    return false;
+  }
+
+  uint32_t src_index = UINT32_MAX;
+  uint32_t dst_index = UINT32_MAX;
+  for (uint32_t i = 0; i < options_dst.count; i++) {
+    uint8_t src_tag = info->option_matches_tags.pointer[option_matches_index + i];
+    if (src_tag && src_tag == choice_tag) {
+      src_index = info->option_matches.pointer[option_matches_index + i];
+      dst_index = i;
+    }
+  }
+
+  if (src_index == UINT32_MAX) {
+    // Unknown tag, which reads as the zero tag.
+    return false;
+  }
+
+  if (src_index >= unsafe_options_src.count) {
+    SVFRT_view_fail(read, SVFRT_code_view__bad_schema);
+    return false;
+  }
+
+  SVF_Meta_OptionDefinition *unsafe_option_src = unsafe_options_src.pointer + src_index;
+  SVF_Meta_OptionDefinition *option_dst = options_dst.pointer + dst_index;
+  if (unsafe_option_src->removed || option_dst->removed) {
+    return false;
+  }
+
+  *out_unsafe_option_src = unsafe_option_src;
+  *out_option_dst = option_dst;
+  return true;
+}
+
+// Find the dst-field at `offset`, or the payload of the choice with its tag
+// right before `offset`, and the matching src-value.
+//
+// Returns false on an error, including any earlier one.
+static
+bool SVFRT_view_locate(SVFRT_LazyView view, uint32_t offset, SVFRT_ViewSlot *out_slot) {
+  SVFRT_LazyRead *read = view.read;
+  SVFRT_MEMSET(out_slot, 0, sizeof(*out_slot));
+
+  if (read->error_code) {
+    return false;
+  }
+
+  SVFRT_LazyReadState *state = (SVFRT_LazyReadState *) read->state;
+  bool absent = view.unsafe_struct_index_src == UINT32_MAX;
+
+  if (view.struct_index_dst >= state->structs_dst.count) {
+    if (absent) {
+      // Absent view of an unknown struct, e.g. the payload of an unknown
+      // option. Everything in it reads as zero.
+      return true;
+    }
+    SVFRT_view_fail(read, SVFRT_code_view__bad_schema);
+    return false;
+  }
+
+  SVFRT_RangeFieldDefinition fields_dst = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
+    state->schema_dst,
+    state->structs_dst.pointer[view.struct_index_dst].fields,
+    SVF_Meta_FieldDefinition
+  );
+  if (!fields_dst.pointer && fields_dst.count) {
+    SVFRT_view_fail(read, SVFRT_code_view__bad_schema);
+    return false;
+  }
+
+  // Exact matches first, since a choice with an empty payload is directly
+  // followed by the next field.
+  bool payload = false;
+  uint32_t i = 0;
+  while (i < fields_dst.count && fields_dst.pointer[i].offset != offset) {
+    i++;
+  }
+  if (i == fields_dst.count) {
+    payload = true;
+    i = 0;
+    while (i < fields_dst.count) {
+      SVF_Meta_FieldDefinition *field_dst = fields_dst.pointer + i;
+      if (
+        field_dst->type_tag == SVF_Meta_Type_tag_concrete &&
+        field_dst->type_payload.concrete.type_tag == SVF_Meta_ConcreteType_tag_definedChoice &&
+        (uint64_t) field_dst->offset + (uint64_t) SVFRT_TAG_SIZE == (uint64_t) offset
+      ) {
+        break;
+      }
+      i++;
+    }
+  }
+  if (i == fields_dst.count) {
+    SVFRT_view_fail(read, SVFRT_code_view__field_not_found);
+    return false;
+  }
+
+  SVF_Meta_FieldDefinition *field_dst = fields_dst.pointer + i;
+  if (!payload) {
+    out_slot->type_tag_dst = field_dst->type_tag;
+    out_slot->type_payload_dst = &field_dst->type_payload;
+  }
+
+  if (absent || field_dst->removed) {
+    return true;
+  }
+
+  uint32_t unsafe_struct_size_src = 0;
+  SVFRT_view_struct_size_src(state, view.unsafe_struct_index_src, &unsafe_struct_size_src);
+  out_slot->unsafe_struct_bytes_src.pointer = state->data_range.pointer + view.data_offset;
+  out_slot->unsafe_struct_bytes_src.count = unsafe_struct_size_src;
+
+  SVF_Meta_FieldDefinition *unsafe_field_src = field_dst;
+  if (state->converting) {
+    unsafe_field_src = SVFRT_view_match_field(view, fields_dst, i);
+    if (!unsafe_field_src) {
+      return !read->error_code;
+    }
+  }
+
+  if (unsafe_field_src->offset > unsafe_struct_size_src) {
+    SVFRT_view_fail(read, SVFRT_code_view__data_out_of_bounds);
+    return false;
+  }
+
+  if (!payload) {
+    out_slot->unsafe_type_tag_src = unsafe_field_src->type_tag;
+    out_slot->unsafe_type_payload_src = &unsafe_field_src->type_payload;
+    out_slot->unsafe_offset_src = unsafe_field_src->offset;
+    return true;
+  }
+
+  if (
+    unsafe_field_src->type_tag != SVF_Meta_Type_tag_concrete ||
+    unsafe_field_src->type_payload.concrete.type_tag != SVF_Meta_ConcreteType_tag_definedChoice
+  ) {
+    SVFRT_view_fail(read, SVFRT_code_view__bad_schema);
+    return false;
+  }
+
+  SVF_Meta_OptionDefinition *unsafe_option_src;
+  SVF_Meta_OptionDefinition *option_dst;
+  if (!SVFRT_view_resolve_option(
+    read,
+    out_slot->unsafe_struct_bytes_src,
+    unsafe_field_src->offset,
+    unsafe_field_src->type_payload.concrete.type_payload.definedChoice.index,
+    field_dst->type_payload.concrete.type_payload.definedChoice.index,
+    &unsafe_option_src,
+    &option_dst
+  )) {
+    return !read->error_code;
+  }
+
+  out_slot->type_tag_dst = option_dst->type_tag;
+  out_slot->type_payload_dst = &option_dst->type_payload;
+  out_slot->unsafe_type_tag_src = unsafe_option_src->type_tag;
+  out_slot->unsafe_type_payload_src = &unsafe_option_src->type_payload;
+
+  out_slot->unsafe_offset_src = unsafe_field_src->offset + SVFRT_TAG_SIZE;
+  return true;
+}
+
+// Load a reference or a sequence from the src-data.
+static
+bool SVFRT_view_load_handle(SVFRT_LazyRead *read, SVFRT_ViewSlot *slot, void *out, uint32_t size) {
+  // Prevent addition overflow by casting operands to `uint64_t` first.
+  if ((uint64_t) slot->unsafe_offset_src + (uint64_t) size > (uint64_t) slot->unsafe_struct_bytes_src.count) {
+    SVFRT_view_fail(read, SVFRT_code_view__data_out_of_bounds);
+    return false;
+  }
+
+  // Untrusted src-data may be misaligned, hence `SVFRT_MEMCPY`. See #natural-alignment.
+  SVFRT_MEMCPY(out, slot->unsafe_struct_bytes_src.pointer + slot->unsafe_offset_src, size);
+  return true;
+}
+
+// Find a sequence. `*out_sequence` is empty if it's missing.
+//
+// Returns false on an error.
+static
+bool SVFRT_view_locate_sequence(
+  SVFRT_LazyView view,
+  uint32_t offset,
+  SVFRT_ViewSlot *out_slot,
+  SVFRT_Sequence *out_sequence
+) {
+  out_sequence->data_offset_complement = 0;
+  out_sequence->count = 0;
+
+  if (!SVFRT_view_locate(view, offset, out_slot)) {
+    return false;
+  }
+
+  if (out_slot->type_tag_dst == SVF_Meta_Type_tag_nothing) {
+    return true;
+  }
+
+  if (out_slot->type_tag_dst != SVF_Meta_Type_tag_sequence) {
+    SVFRT_view_fail(view.read, SVFRT_code_view__type_mismatch);
+    return false;
+  }
+
+  if (!out_slot->unsafe_type_payload_src) {
+    return true;
+  }
+
+  if (out_slot->unsafe_type_tag_src != SVF_Meta_Type_tag_sequence) {
+    SVFRT_view_fail(view.read, SVFRT_code_view__bad_schema);
+    return false;
+  }
+
+  return SVFRT_view_load_handle(view.read, out_slot, out_sequence, sizeof(*out_sequence));
+}
+
+// Convert `count` values without handles into `out`, or copy them, if there is
+// no conversion. Zeroes `out` on an error.
+static
+void SVFRT_view_copy_values(
+  SVFRT_LazyRead *read,
+  SVFRT_Bytes unsafe_range_src,
+  uint32_t unsafe_offset_src,
+  uint32_t unsafe_stride_src,
+  SVF_Meta_ConcreteType_tag unsafe_type_tag_src,
+  SVF_Meta_ConcreteType_payload *unsafe_type_payload_src,
+  SVF_Meta_ConcreteType_tag type_tag_dst,
+  SVF_Meta_ConcreteType_payload *type_payload_dst,
+  uint32_t count,
+  SVFRT_Bytes out
+) {
+  SVFRT_LazyReadState *state = (SVFRT_LazyReadState *) read->state;
+
+  if (state->converting) {
+    SVFRT_ErrorCode error_code = SVFRT_convert_flat_values(
+      &state->check_result,
+      state->data_range,
+      unsafe_range_src,
+      unsafe_offset_src,
+      unsafe_stride_src,
+      unsafe_type_tag_src,
+      unsafe_type_payload_src,
+      type_tag_dst,
+      type_payload_dst,
+      count,
+      state->max_recursion_depth,
+      out
+    );
+    if (error_code) {
+      SVFRT_MEMSET(out.pointer, 0, out.count);
+      SVFRT_view_fail(read, error_code);
+    }
+    return;
+  }
+
+  // Same layout, only the stride may be larger.
+  uint32_t size = out.count / count;
+  uint64_t end_offset = (uint64_t) unsafe_offset_src
+    + (uint64_t) (count - 1) * (uint64_t) unsafe_stride_src
+    + (uint64_t) size;
+  if ((count > 1 && unsafe_stride_src < size) || end_offset > (uint64_t) unsafe_range_src.count) {
+    SVFRT_view_fail(read, SVFRT_code_view__data_out_of_bounds);
+    return;
+  }
+
+  if (count == 1 || unsafe_stride_src == size) {
+    SVFRT_MEMCPY(out.pointer, unsafe_range_src.pointer + unsafe_offset_src, out.count);
+    return;
+  }
+
+  for (uint32_t i = 0; i < count; i++) {
+    SVFRT_MEMCPY(
+      out.pointer + i * size,
+      unsafe_range_src.pointer + unsafe_offset_src + i * unsafe_stride_src,
+      size
+    );
+  }
+}
+
+void SVFRT_lazy_read_init(
+  SVFRT_LazyRead *out_read,
+  SVFRT_LazyReadState *state,
+  SVFRT_ReadMessageParams *params,
+  SVFRT_Bytes data_range
+) {
+  state->converting = state->check_result.level == SVFRT_compatibility_logical;
+  state->data_range = data_range;
+  state->schema_dst = params->expected_schema;
+  state->max_recursion_depth = params->max_recursion_depth;
+  state->max_output_size = params->max_output_size;
+  state->allocator_fn = params->allocator_fn;
+  state->allocator_ptr = params->allocator_ptr;
+
+  SVF_Meta_SchemaDefinition *definition_dst = SVFRT_internal_schema_definition(state->schema_dst);
+  if (!definition_dst) {
+    out_read->error_code = SVFRT_code_view__bad_schema;
+    return;
+  }
+  SVFRT_RangeStructDefinition structs_dst = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
+    state->schema_dst,
+    definition_dst->structs,
+    SVF_Meta_StructDefinition
+  );
+  SVFRT_RangeChoiceDefinition choices_dst = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
+    state->schema_dst,
+    definition_dst->choices,
+    SVF_Meta_ChoiceDefinition
+  );
+  if ((!structs_dst.pointer && structs_dst.count) || (!choices_dst.pointer && choices_dst.count)) {
+    out_read->error_code = SVFRT_code_view__bad_schema;
+    return;
+  }
+  state->structs_dst = structs_dst;
+  state->choices_dst = choices_dst;
+
+  uint32_t unsafe_entry_struct_index_src = params->entry_struct_index;
+  if (state->converting) {
+    SVFRT_LogicalCompatibilityInfo *info = &state->check_result.logical;
+    SVFRT_RangeStructDefinition unsafe_structs_src = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
+      info->unsafe_schema_src,
+      info->unsafe_definition_src->structs,
+      SVF_Meta_StructDefinition
+    );
+    SVFRT_RangeChoiceDefinition unsafe_choices_src = SVFRT_INTERNAL_RANGE_FROM_SEQUENCE(
+      info->unsafe_schema_src,
+      info->unsafe_definition_src->choices,
+      SVF_Meta_ChoiceDefinition
+    );
+    if (
+      (!unsafe_structs_src.pointer && unsafe_structs_src.count) ||
+      (!unsafe_choices_src.pointer && unsafe_choices_src.count)
+    ) {
+      out_read->error_code = SVFRT_code_view__bad_schema;
+      return;
+    }
+    state->unsafe_schema_src = info->unsafe_schema_src;
+    state->unsafe_structs_src = unsafe_structs_src;
+    state->unsafe_choices_src = unsafe_choices_src;
+    unsafe_entry_struct_index_src = info->entry_struct_index_src;
+  } else {
+    state->unsafe_schema_src = state->schema_dst;
+    state->unsafe_structs_src = structs_dst;
+    state->unsafe_choices_src = choices_dst;
+  }
+
+  uint32_t unsafe_entry_size_src = 0;
+  if (!SVFRT_view_struct_size_src(state, unsafe_entry_struct_index_src, &unsafe_entry_size_src)) {
+    out_read->error_code = SVFRT_code_view__bad_schema;
+    return;
+  }
+
+  if (data_range.count < unsafe_entry_size_src) {
+    out_read->error_code = SVFRT_code_read__data_too_small;
+    return;
+  }
+
+  // The entry is at the end of the data, same as in `SVFRT_read_locate_entry`.
+  out_read->entry = SVFRT_view_make(
+    out_read,
+    data_range.count - unsafe_entry_size_src,
+    unsafe_entry_struct_index_src,
+    params->entry_struct_index
+  );
+}
+
+void SVFRT_view_read(SVFRT_LazyView view, uint32_t offset, void *out, uint32_t out_size) {
+  SVFRT_LazyRead *read = view.read;
+  SVFRT_MEMSET(out, 0, out_size);
+
+  SVFRT_ViewSlot slot;
+  if (!SVFRT_view_locate(view, offset, &slot)) {
+    return;
+  }
+
+  if (slot.type_tag_dst == SVF_Meta_Type_tag_nothing) {
+    return;
+  }
+
+  if (slot.type_tag_dst != SVF_Meta_Type_tag_concrete) {
+    SVFRT_view_fail(read, SVFRT_code_view__type_mismatch);
+    return;
+  }
+
+  SVFRT_LazyReadState *state = (SVFRT_LazyReadState *) read->state;
+  SVF_Meta_ConcreteType_tag type_tag_dst = slot.type_payload_dst->concrete.type_tag;
+  SVF_Meta_ConcreteType_payload *type_payload_dst = &slot.type_payload_dst->concrete.type_payload;
+
+  if (type_tag_dst == SVF_Meta_ConcreteType_tag_nothing) {
+    return;
+  }
+
+  if (slot.unsafe_type_payload_src && slot.unsafe_type_tag_src != SVF_Meta_Type_tag_concrete) {
+    SVFRT_view_fail(read, SVFRT_code_view__bad_schema);
+    return;
+  }
+
+  // Only the tag of a choice, which does not need the payload to be flat.
+  if (type_tag_dst == SVF_Meta_ConcreteType_tag_definedChoice && out_size == SVFRT_TAG_SIZE) {
+    if (!slot.unsafe_type_payload_src) {
+      return;
+    }
+
+    SVF_Meta_Type_Concrete *unsafe_type_src = &slot.unsafe_type_payload_src->concrete;
+    if (unsafe_type_src->type_tag != SVF_Meta_ConcreteType_tag_definedChoice) {
+      SVFRT_view_fail(read, SVFRT_code_view__bad_schema);
+      return;
+    }
+
+    SVF_Meta_OptionDefinition *unsafe_option_src;
+    SVF_Meta_OptionDefinition *option_dst;
+    if (SVFRT_view_resolve_option(
+      read,
+      slot.unsafe_struct_bytes_src,
+      slot.unsafe_offset_src,
+      unsafe_type_src->type_payload.definedChoice.index,
+      type_payload_dst->definedChoice.index,
+      &unsafe_option_src,
+      &option_dst
+    )) {
+      *((uint8_t *) out) = option_dst->tag;
+    }
+    return;
+  }
+
+  uint32_t size_dst = SVFRT_view_concrete_size(state->structs_dst, state->choices_dst, type_tag_dst, type_payload_dst);
+  if (size_dst == 0 || size_dst != out_size) {
+    SVFRT_view_fail(read, SVFRT_code_view__size_mismatch);
+    return;
+  }
+
+  if (!SVFRT_internal_is_flat(
+    state->schema_dst,
+    state->structs_dst,
+    state->choices_dst,
+    0, // `recursion_depth`.
+    state->max_recursion_depth,
+    type_tag_dst,
+    type_payload_dst
+  )) {
+    SVFRT_view_fail(read, SVFRT_code_view__not_flat);
+    return;
+  }
+
+  if (!slot.unsafe_type_payload_src) {
+    return;
+  }
+
+  SVFRT_Bytes out_bytes = {
+    /*.pointer =*/ (uint8_t *) out,
+    /*.count =*/ out_size,
+  };
+  SVFRT_view_copy_values(
+    read,
+    slot.unsafe_struct_bytes_src,
+    slot.unsafe_offset_src,
+    0, // `unsafe_stride_src`, only used for sequences.
+    slot.unsafe_type_payload_src->concrete.type_tag,
+    &slot.unsafe_type_payload_src->concrete.type_payload,
+    type_tag_dst,
+    type_payload_dst,
+    1, // `count`.
+    out_bytes
+  );
+}
+
+SVFRT_LazyView SVFRT_view_struct(SVFRT_LazyView view, uint32_t offset) {
+  SVFRT_LazyRead *read = view.read;
+
+  SVFRT_ViewSlot slot;
+  if (!SVFRT_view_locate(view, offset, &slot) || slot.type_tag_dst == SVF_Meta_Type_tag_nothing) {
+    return SVFRT_view_absent(read, UINT32_MAX);
+  }
+
+  if (
+    slot.type_tag_dst != SVF_Meta_Type_tag_concrete ||
+    slot.type_payload_dst->concrete.type_tag != SVF_Meta_ConcreteType_tag_definedStruct
+  ) {
+    SVFRT_view_fail(read, SVFRT_code_view__type_mismatch);
+    return SVFRT_view_absent(read, UINT32_MAX);
+  }
+  uint32_t struct_index_dst = slot.type_payload_dst->concrete.type_payload.definedStruct.index;
+
+  if (!slot.unsafe_type_payload_src) {
+    return SVFRT_view_absent(read, struct_index_dst);
+  }
+
+  if (
+    slot.unsafe_type_tag_src != SVF_Meta_Type_tag_concrete ||
+    slot.unsafe_type_payload_src->concrete.type_tag != SVF_Meta_ConcreteType_tag_definedStruct
+  ) {
+    SVFRT_view_fail(read, SVFRT_code_view__bad_schema);
+    return SVFRT_view_absent(read, struct_index_dst);
+  }
+
+  // Both are within the data range, see `SVFRT_view_locate`.
+  return SVFRT_view_make(
+    read,
+    view.data_offset + slot.unsafe_offset_src,
+    slot.unsafe_type_payload_src->concrete.type_payload.definedStruct.index,
+    struct_index_dst
+  );
+}
+
+SVFRT_LazyView SVFRT_view_reference(SVFRT_LazyView view, uint32_t offset) {
+  SVFRT_LazyRead *read = view.read;
+
+  SVFRT_ViewSlot slot;
+  if (!SVFRT_view_locate(view, offset, &slot) || slot.type_tag_dst == SVF_Meta_Type_tag_nothing) {
+    return SVFRT_view_absent(read, UINT32_MAX);
+  }
+
+  if (
+    slot.type_tag_dst != SVF_Meta_Type_tag_reference ||
+    slot.type_payload_dst->reference.type_tag != SVF_Meta_ConcreteType_tag_definedStruct
+  ) {
+    SVFRT_view_fail(read, SVFRT_code_view__type_mismatch);
+    return SVFRT_view_absent(read, UINT32_MAX);
+  }
+  uint32_t struct_index_dst = slot.type_payload_dst->reference.type_payload.definedStruct.index;
+
+  if (!slot.unsafe_type_payload_src) {
+    return SVFRT_view_absent(read, struct_index_dst);
+  }
+
+  if (
+    slot.unsafe_type_tag_src != SVF_Meta_Type_tag_reference ||
+    slot.unsafe_type_payload_src->reference.type_tag != SVF_Meta_ConcreteType_tag_definedStruct
+  ) {
+    SVFRT_view_fail(read, SVFRT_code_view__bad_schema);
+    return SVFRT_view_absent(read, struct_index_dst);
+  }
+  uint32_t unsafe_struct_index_src = slot.unsafe_type_payload_src->reference.type_payload.definedStruct.index;
+
+  SVFRT_Reference reference;
+  if (!SVFRT_view_load_handle(read, &slot, &reference, sizeof(reference))) {
+    return SVFRT_view_absent(read, struct_index_dst);
+  }
+
+  SVFRT_LazyReadState *state = (SVFRT_LazyReadState *) read->state;
+  uint32_t unsafe_size_src = 0;
+  if (!SVFRT_view_struct_size_src(state, unsafe_struct_index_src, &unsafe_size_src)) {
+    SVFRT_view_fail(read, SVFRT_code_view__bad_schema);
+    return SVFRT_view_absent(read, struct_index_dst);
+  }
+
+  uint8_t *pointer = (uint8_t *) SVFRT_internal_from_reference(state->data_range, reference, unsafe_size_src);
+  if (!pointer) {
+    SVFRT_view_fail(read, SVFRT_code_view__data_out_of_bounds);
+    return SVFRT_view_absent(read, struct_index_dst);
+  }
+
+  return SVFRT_view_make(
+    read,
+    (uint32_t) (pointer - state->data_range.pointer),
+    unsafe_struct_index_src,
+    struct_index_dst
+  );
+}
+
+uint32_t SVFRT_view_sequence_count(SVFRT_LazyView view, uint32_t offset) {
+  SVFRT_ViewSlot slot;
+  SVFRT_Sequence sequence;
+  if (!SVFRT_view_locate_sequence(view, offset, &slot, &sequence)) {
+    return 0;
+  }
+  return sequence.count;
+}
+
+SVFRT_LazyView SVFRT_view_sequence_element(SVFRT_LazyView view, uint32_t offset, uint32_t index) {
+  SVFRT_LazyRead *read = view.read;
+
+  SVFRT_ViewSlot slot;
+  SVFRT_Sequence sequence;
+  if (!SVFRT_view_locate_sequence(view, offset, &slot, &sequence) || slot.type_tag_dst == SVF_Meta_Type_tag_nothing) {
+    return SVFRT_view_absent(read, UINT32_MAX);
+  }
+
+  if (slot.type_payload_dst->sequence.elementType_tag != SVF_Meta_ConcreteType_tag_definedStruct) {
+    SVFRT_view_fail(read, SVFRT_code_view__type_mismatch);
+    return SVFRT_view_absent(read, UINT32_MAX);
+  }
+  uint32_t struct_index_dst = slot.type_payload_dst->sequence.elementType_payload.definedStruct.index;
+
+  // A missing sequence is empty, same as after a conversion.
+  if (index >= sequence.count) {
+    SVFRT_view_fail(read, SVFRT_code_view__index_out_of_bounds);
+    return SVFRT_view_absent(read, struct_index_dst);
+  }
+
+  if (slot.unsafe_type_payload_src->sequence.elementType_tag != SVF_Meta_ConcreteType_tag_definedStruct) {
+    SVFRT_view_fail(read, SVFRT_code_view__bad_schema);
+    return SVFRT_view_absent(read, struct_index_dst);
+  }
+  uint32_t unsafe_struct_index_src = slot.unsafe_type_payload_src->sequence.elementType_payload.definedStruct.index;
+
+  SVFRT_LazyReadState *state = (SVFRT_LazyReadState *) read->state;
+  uint32_t unsafe_stride_src = 0;
+  if (!SVFRT_view_struct_size_src(state, unsafe_struct_index_src, &unsafe_stride_src)) {
+    SVFRT_view_fail(read, SVFRT_code_view__bad_schema);
+    return SVFRT_view_absent(read, struct_index_dst);
+  }
+
+  uint8_t *pointer = (uint8_t *) SVFRT_internal_from_sequence(state->data_range, sequence, unsafe_stride_src);
+  if (!pointer) {
+    SVFRT_view_fail(read, SVFRT_code_view__data_out_of_bounds);
+    return SVFRT_view_absent(read, struct_index_dst);
+  }
+
+  // The whole sequence is within the data range, so this can't overflow.
+  return SVFRT_view_make(
+    read,
+    (uint32_t) (pointer - state->data_range.pointer) + index * unsafe_stride_src,
+    unsafe_struct_index_src,
+    struct_index_dst
+  );
+}
+
+void SVFRT_view_sequence_read(
+  SVFRT_LazyView view,
+  uint32_t offset,
+  uint32_t first,
+  uint32_t count,
+  void *out,
+  uint32_t out_size
+) {
+  SVFRT_LazyRead *read = view.read;
+  SVFRT_MEMSET(out, 0, out_size);
+
+  SVFRT_ViewSlot slot;
+  SVFRT_Sequence sequence;
+  if (!SVFRT_view_locate_sequence(view, offset, &slot, &sequence) || slot.type_tag_dst == SVF_Meta_Type_tag_nothing) {
+    return;
+  }
+
+  SVFRT_LazyReadState *state = (SVFRT_LazyReadState *) read->state;
+  SVF_Meta_ConcreteType_tag type_tag_dst = slot.type_payload_dst->sequence.elementType_tag;
+  SVF_Meta_ConcreteType_payload *type_payload_dst = &slot.type_payload_dst->sequence.elementType_payload;
+
+  uint32_t size_dst = SVFRT_view_concrete_size(state->structs_dst, state->choices_dst, type_tag_dst, type_payload_dst);
+  if (size_dst == 0 || (uint64_t) size_dst * (uint64_t) count != (uint64_t) out_size) {
+    SVFRT_view_fail(read, SVFRT_code_view__size_mismatch);
+    return;
+  }
+
+  if (!SVFRT_internal_is_flat(
+    state->schema_dst,
+    state->structs_dst,
+    state->choices_dst,
+    0, // `recursion_depth`.
+    state->max_recursion_depth,
+    type_tag_dst,
+    type_payload_dst
+  )) {
+    SVFRT_view_fail(read, SVFRT_code_view__not_flat);
+    return;
+  }
+
+  // Prevent addition overflow by casting operands to `uint64_t` first.
+  if ((uint64_t) first + (uint64_t) count > (uint64_t) sequence.count) {
+    SVFRT_view_fail(read, SVFRT_code_view__index_out_of_bounds);
+    return;
+  }
+
+  if (count == 0) {
+    return;
+  }
+
+  SVF_Meta_ConcreteType_tag unsafe_type_tag_src = slot.unsafe_type_payload_src->sequence.elementType_tag;
+  SVF_Meta_ConcreteType_payload *unsafe_type_payload_src = &slot.unsafe_type_payload_src->sequence.elementType_payload;
+
+  uint32_t unsafe_stride_src = SVFRT_view_stride_src(state, unsafe_type_tag_src, unsafe_type_payload_src);
+  if (unsafe_stride_src == 0) {
+    SVFRT_view_fail(read, SVFRT_code_view__bad_schema);
+    return;
+  }
+
+  uint8_t *pointer = (uint8_t *) SVFRT_internal_from_sequence(state->data_range, sequence, unsafe_stride_src);
+  if (!pointer) {
+    SVFRT_view_fail(read, SVFRT_code_view__data_out_of_bounds);
+    return;
+  }
+
+  // The whole sequence is within the data range, so this can't overflow.
+  SVFRT_Bytes unsafe_range_src = {
+    /*.pointer =*/ pointer,
+    /*.count =*/ sequence.count * unsafe_stride_src,
+  };
+  SVFRT_Bytes out_bytes = {
+    /*.pointer =*/ (uint8_t *) out,
+    /*.count =*/ out_size,
+  };
+  SVFRT_view_copy_values(
+    read,
+    unsafe_range_src,
+    first * unsafe_stride_src,
+    unsafe_stride_src,
+    unsafe_type_tag_src,
+    unsafe_type_payload_src,
+    type_tag_dst,
+    type_payload_dst,
+    count,
+    out_bytes
+  );
+}
+
+#define SVFRT_VIEW_MEMO_MAX_PROBES 16
+
+// Look the struct of `view` up in the memo. Returns the matching entry and sets
+// `*out_found`, or returns the empty slot for it. Returns NULL, if there is no
+// memo, or no room.
+static
+SVFRT_LazyMemoEntry *SVFRT_view_memo_find(SVFRT_LazyReadState *state, SVFRT_LazyView view, bool *out_found) {
+  *out_found = false;
+  if (!state->memo) {
+    return NULL;
+  }
+
+  uint64_t hash = (
+    (((uint64_t) view.data_offset << 32) | view.unsafe_struct_index_src) * 0x9E3779B97F4A7C15ull ^
+    (uint64_t) view.struct_index_dst
+  );
+  uint32_t home = (uint32_t) ((hash >> 32) % state->memo_capacity);
+
+  for (uint32_t i = 0; i < SVFRT_VIEW_MEMO_MAX_PROBES && i < state->memo_capacity; i++) {
+    // The capacity is at most `UINT32_MAX / sizeof(SVFRT_LazyMemoEntry)`, so this can't overflow.
+    SVFRT_LazyMemoEntry *entry = state->memo + (home + i) % state->memo_capacity;
+    if (!entry->used) {
+      return entry;
+    }
+    if (
+      entry->data_offset == view.data_offset &&
+      entry->unsafe_struct_index_src == view.unsafe_struct_index_src &&
+      entry->struct_index_dst == view.struct_index_dst
+    ) {
+      *out_found = true;
+      return entry;
+    }
+  }
+  return NULL;
+}
+
+void SVFRT_view_materialize(SVFRT_LazyView view, SVFRT_ReadMessageResult *out_result) {
+  SVFRT_LazyRead *read = view.read;
+  SVFRT_MEMSET(out_result, 0, sizeof(*out_result));
+  out_result->compatibility_level = read->compatibility_level;
+
+  if (read->error_code) {
+    out_result->error_code = read->error_code;
+    return;
+  }
+
+  if (view.unsafe_struct_index_src == UINT32_MAX) {
+    out_result->error_code = SVFRT_code_view__absent;
+    return;
+  }
+
+  SVFRT_LazyReadState *state = (SVFRT_LazyReadState *) read->state;
+  out_result->context.struct_strides = state->check_result.quirky_struct_strides_dst;
+
+  if (!state->converting) {
+    out_result->entry = (void *) (state->data_range.pointer + view.data_offset);
+    out_result->context.data_range = state->data_range;
+    return;
+  }
+
+  if (!state->allocator_fn) {
+    out_result->error_code = SVFRT_code_view__no_allocator_function;
+    return;
+  }
+
+  // The root is at the end of the output, same as the entry. The index was
+  // checked in `SVFRT_view_make`.
+  uint32_t struct_size_dst = state->structs_dst.pointer[view.struct_index_dst].size;
+
+  bool memo_found = false;
+  SVFRT_LazyMemoEntry *memo_slot = SVFRT_view_memo_find(state, view, &memo_found);
+  if (memo_found) {
+    SVFRT_Bytes output_bytes = memo_slot->output_bytes;
+    out_result->entry = (void *) (output_bytes.pointer + output_bytes.count - struct_size_dst);
+    out_result->context.data_range = output_bytes;
+    return;
+  }
+
+  SVFRT_ConversionResult conversion_result = {0};
+  SVFRT_convert_struct(
+    &conversion_result,
+    &state->check_result,
+    state->data_range,
+    view.data_offset,
+    view.unsafe_struct_index_src,
+    view.struct_index_dst,
+    state->max_recursion_depth,
+    state->max_output_size,
+    state->allocator_fn,
+    state->allocator_ptr
+  );
+
+  out_result->allocation = conversion_result.output_bytes.pointer;
+  if (!conversion_result.success) {
+    out_result->error_code = conversion_result.error_code;
+    return;
+  }
+
+  SVFRT_Bytes output_bytes = conversion_result.output_bytes;
+  out_result->entry = (void *) (output_bytes.pointer + output_bytes.count - struct_size_dst);
+  out_result->context.data_range = output_bytes;
+
+  if (memo_slot) {
+    memo_slot->data_offset = view.data_offset;
+    memo_slot->unsafe_struct_index_src = view.unsafe_struct_index_src;
+    memo_slot->struct_index_dst = view.struct_index_dst;
+    memo_slot->used = 1;
+    memo_slot->output_bytes = output_bytes;
+  }
+}
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -49,6 +49,7 @@ namespace core {
       empty_choice                                                       = 0x04,
       choice_not_allowed                                                 = 0x05,
       name_collision                                                     = 0x06,
+      chunked_sequence_not_allowed                                       = 0x07,
     };
 
     struct GenerationResult {
@@ -83,7 +84,8 @@ namespace core {
       vm::LinearArena *arena,
       Bytes schema_bytes,
       Bytes appendix_bytes,
-      validation::Result *validation_result
+      validation::Result *validation_result,
+      Bool wide
     );
   }
 
@@ -92,7 +94,21 @@ namespace core {
       vm::LinearArena *arena,
       Bytes schema_bytes,
       Bytes appendix_bytes,
-      validation::Result *validation_result
+      validation::Result *validation_result,
+      Bool wide
+    );
+  }
+
+  // Specialized conversion functions between two schemas, as a header with a
+  // table of converters. See #generated-conversion.
+  namespace output::conversion {
+    Range<U8> as_code(
+      vm::LinearArena *arena,
+      vm::LinearArena *scratch_arena,
+      Bytes schema_src,
+      Bytes appendix_src,
+      Bytes schema_dst,
+      Bytes appendix_dst
     );
   }
 
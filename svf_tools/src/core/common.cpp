@@ -7,56 +7,56 @@ TypePluralityAndSize get_plurality(
   Range<svf::Meta::StructDefinition> structs,
   Range<svf::Meta::ChoiceDefinition> choices,
   svf::Meta::Type_tag in_tag,
-  svf::Meta::Type_payload *in_payload
+  svf::Meta::Type_payload *in_payload,
+  Bool wide
 ) {
   switch (in_tag) {
     case Meta::Type_tag::concrete: {
       switch (in_payload->concrete.type_tag) {
         case Meta::ConcreteType_tag::u8: {
-          return { TypePlurality::one, 1 };
+          return { TypePlurality::one, 1, 1 };
         }
         case Meta::ConcreteType_tag::u16: {
-          return { TypePlurality::one, 2 };
+          return { TypePlurality::one, 2, 2 };
         }
         case Meta::ConcreteType_tag::u32: {
-          return { TypePlurality::one, 4 };
+          return { TypePlurality::one, 4, 4 };
         }
         case Meta::ConcreteType_tag::u64: {
-          return { TypePlurality::one, 8 };
+          return { TypePlurality::one, 8, 8 };
         }
         case Meta::ConcreteType_tag::i8: {
-          return { TypePlurality::one, 1 };
+          return { TypePlurality::one, 1, 1 };
         }
         case Meta::ConcreteType_tag::i16: {
-          return { TypePlurality::one, 2 };
+          return { TypePlurality::one, 2, 2 };
         }
         case Meta::ConcreteType_tag::i32: {
-          return { TypePlurality::one, 4 };
+          return { TypePlurality::one, 4, 4 };
         }
         case Meta::ConcreteType_tag::i64: {
-          return { TypePlurality::one, 8 };
+          return { TypePlurality::one, 8, 8 };
         }
         case Meta::ConcreteType_tag::f32: {
-          return { TypePlurality::one, 4 };
+          return { TypePlurality::one, 4, 4 };
         }
         case Meta::ConcreteType_tag::f64: {
-          return { TypePlurality::one, 8 };
+          return { TypePlurality::one, 8, 8 };
         }
         case Meta::ConcreteType_tag::nothing: {
-          return { TypePlurality::zero, 0 };
+          return { TypePlurality::zero, 0, 1 };
         }
         case Meta::ConcreteType_tag::definedStruct: {
           auto index = in_payload->concrete.type_payload.definedStruct.index;
           ASSERT(index < structs.count);
-          auto size = structs.pointer[index].size;
-          return { TypePlurality::one, size };
+          auto it = structs.pointer + index;
+          return { TypePlurality::one, it->size, it->alignment };
         }
         case Meta::ConcreteType_tag::definedChoice: {
           auto index = in_payload->concrete.type_payload.definedChoice.index;
           ASSERT(index < choices.count);
-          auto payload_size = choices.pointer[index].payloadSize;
-          // TODO @proper-alignment: tags.
-          return { TypePlurality::tag_and_payload, SVFRT_TAG_SIZE + payload_size };
+          auto it = choices.pointer + index;
+          return { TypePlurality::tag_and_payload, SVFRT_TAG_SIZE + it->payloadSize, it->payloadAlignment };
         }
         default: {
           return UNREACHABLE;
@@ -64,10 +64,13 @@ TypePluralityAndSize get_plurality(
       }
     }
     case Meta::Type_tag::reference: {
-      return { TypePlurality::one, 4 };
+      return { TypePlurality::one, wide ? 8u : 4u, wide ? 8u : 4u };
     }
     case Meta::Type_tag::sequence: {
-      return { TypePlurality::one, 8 };
+      return { TypePlurality::one, wide ? 16u : 8u, wide ? 8u : 4u };
+    }
+    case Meta::Type_tag::chunkedSequence: {
+      return { TypePlurality::one, 8u, 4u };
     }
     default: {
       return UNREACHABLE;
@@ -75,4 +78,30 @@ TypePluralityAndSize get_plurality(
   }
 }
 
+Bool uses_chunked_sequences(Bytes schema_bytes) {
+  auto schema_definition = get_last_struct<Meta::SchemaDefinition>(schema_bytes);
+
+  auto structs = to_range(schema_bytes, schema_definition->structs);
+  for (UInt i = 0; i < structs.count; i++) {
+    auto fields = to_range(schema_bytes, structs.pointer[i].fields);
+    for (UInt j = 0; j < fields.count; j++) {
+      if (fields.pointer[j].type_tag == Meta::Type_tag::chunkedSequence) {
+        return true;
+      }
+    }
+  }
+
+  auto choices = to_range(schema_bytes, schema_definition->choices);
+  for (UInt i = 0; i < choices.count; i++) {
+    auto options = to_range(schema_bytes, choices.pointer[i].options);
+    for (UInt j = 0; j < options.count; j++) {
+      if (options.pointer[j].type_tag == Meta::Type_tag::chunkedSequence) {
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
 } // namespace core
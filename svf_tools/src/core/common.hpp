@@ -14,6 +14,17 @@ Range<T> to_range(Bytes bytes, svf::runtime::Sequence<T> sequence) {
   );
 }
 
+// The last struct in `bytes`, i.e. the definition of a schema, or an appendix.
+// Both are aligned, just like the rest of the schema, see #natural-alignment.
+template<typename T>
+inline static
+T *get_last_struct(Bytes bytes) {
+  ASSERT(bytes.count >= sizeof(T));
+  auto pointer = bytes.pointer + bytes.count - sizeof(T);
+  ASSERT(UInt(pointer) % alignof(T) == 0);
+  return (T *) pointer;
+}
+
 enum class TypePlurality {
   zero,
   one,
@@ -23,15 +34,35 @@ enum class TypePlurality {
 struct TypePluralityAndSize {
   TypePlurality plurality;
   UInt size;
+
+  // See #natural-alignment. For `tag_and_payload`, this is the alignment of
+  // the payload, the tag itself is not aligned.
+  UInt alignment;
 };
 
 TypePluralityAndSize get_plurality(
   Range<svf::Meta::StructDefinition> structs,
   Range<svf::Meta::ChoiceDefinition> choices,
   svf::Meta::Type_tag in_tag,
-  svf::Meta::Type_payload *in_payload
+  svf::Meta::Type_payload *in_payload,
+  Bool wide
 );
 
+// See #natural-alignment. The offset of a field, which goes right after
+// `size_sum` bytes of the struct. For a choice, the tag goes immediately before
+// the payload, and the payload is aligned.
+static inline
+UInt get_natural_offset(UInt size_sum, TypePluralityAndSize plurality) {
+  if (plurality.plurality == TypePlurality::tag_and_payload) {
+    return align_up(size_sum + SVFRT_TAG_SIZE, plurality.alignment) - SVFRT_TAG_SIZE;
+  }
+  return align_up(size_sum, plurality.alignment);
+}
+
+// Does any field or option use a chunked sequence? Only then, the generated
+// code needs to declare the type for it.
+Bool uses_chunked_sequences(Bytes schema_bytes);
+
 static inline
 U64 get_content_hash(Bytes schema_bytes) {
   auto result = hash64::begin();
@@ -40,25 +71,29 @@ U64 get_content_hash(Bytes schema_bytes) {
   return result;
 }
 
+// See #compatibility-matching. Should be kept in sync with
+// `SVFRT_check_matching_work` in `svf_runtime`.
+static inline
+U32 get_matching_work(U32 count_src, U32 count_dst) {
+  U32 depth = 1;
+  while (depth < 32 && ((U64) 1 << (depth - 1)) < (U64) count_dst) {
+    depth++;
+  }
+
+  U64 work = ((U64) count_src + (U64) count_dst) * (U64) depth;
+  ASSERT(work <= (U64) UINT32_MAX);
+  return (U32) work;
+}
+
 // Internal usage only. Both schemas are assumed to be valid.
 static inline
 U32 get_compatibility_work(Bytes schema_src, Bytes schema_dst) {
   // Note: returns an upper bound, the real number will depend on how many
   // structs are reachable from the entry.
 
-  // TODO @proper-alignment: struct access.
-  auto definition_src = (svf::Meta::SchemaDefinition *) (
-    schema_src.pointer +
-    schema_src.count -
-    sizeof(svf::Meta::SchemaDefinition)
-  );
+  auto definition_src = get_last_struct<svf::Meta::SchemaDefinition>(schema_src);
 
-  // TODO @proper-alignment: struct access.
-  auto definition_dst = (svf::Meta::SchemaDefinition *) (
-    schema_dst.pointer +
-    schema_dst.count -
-    sizeof(svf::Meta::SchemaDefinition)
-  );
+  auto definition_dst = get_last_struct<svf::Meta::SchemaDefinition>(schema_dst);
 
   uint32_t result = definition_src->structs.count; // See #compatibility-work-entry.
 
@@ -82,7 +117,7 @@ U32 get_compatibility_work(Bytes schema_src, Bytes schema_dst) {
       found = true;
 
       // See #compatibility-work-fields.
-      result += 2 * definition_src->fields.count * definition_dst->fields.count;
+      result += get_matching_work(definition_src->fields.count, definition_dst->fields.count);
 
       break;
     }
@@ -105,7 +140,7 @@ U32 get_compatibility_work(Bytes schema_src, Bytes schema_dst) {
       found = true;
 
       // See #compatibility-work-options.
-      result += 2 * definition_src->options.count * definition_dst->options.count;
+      result += get_matching_work(definition_src->options.count, definition_dst->options.count);
 
       break;
     }
@@ -129,11 +164,14 @@ U32 get_compatibility_work_base(Bytes schema_bytes) {
 
 static inline
 UInt get_min_read_scratch_memory_size(Bytes schema, svf::Meta::SchemaDefinition *definition) {
+  U32 max_members = 0; // See #compatibility-matching.
+
   U32 total_fields = 0;
   auto structs = to_range(schema, definition->structs);
   for (U32 i = 0; i < structs.count; i++) {
     auto definition = structs.pointer + i;
     total_fields += definition->fields.count;
+    max_members = definition->fields.count > max_members ? definition->fields.count : max_members;
   }
 
   U32 total_options = 0;
@@ -141,6 +179,7 @@ UInt get_min_read_scratch_memory_size(Bytes schema, svf::Meta::SchemaDefinition
   for (U32 i = 0; i < choices.count; i++) {
     auto definition = choices.pointer + i;
     total_options += definition->options.count;
+    max_members = definition->options.count > max_members ? definition->options.count : max_members;
   }
 
   // #scratch-memory-partitions.
@@ -151,6 +190,7 @@ UInt get_min_read_scratch_memory_size(Bytes schema, svf::Meta::SchemaDefinition
     + total_fields * sizeof(U32)
     + total_options * sizeof(U32)
     + total_options * sizeof(U8)
+    + max_members * sizeof(U32) * 4 // Member index.
   );
 }
 
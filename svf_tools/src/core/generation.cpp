@@ -58,6 +58,7 @@ struct OutputTypeResult {
   FailCode fail_code;
   U32 main_size;
   U32 tag_size;
+  U32 alignment; // Of the main part, see #natural-alignment.
 };
 
 OutputTypeResult output_concrete_type(
@@ -74,47 +75,47 @@ OutputTypeResult output_concrete_type(
   switch (in_concrete->which) {
     case grammar::ConcreteType::Which::u8: {
       *out_tag = Meta::ConcreteType_tag::u8;
-      return { .main_size = 1 };
+      return { .main_size = 1, .alignment = 1 };
     }
     case grammar::ConcreteType::Which::u16: {
       *out_tag = Meta::ConcreteType_tag::u16;
-      return { .main_size = 2 };
+      return { .main_size = 2, .alignment = 2 };
     }
     case grammar::ConcreteType::Which::u32: {
       *out_tag = Meta::ConcreteType_tag::u32;
-      return { .main_size = 4 };
+      return { .main_size = 4, .alignment = 4 };
     }
     case grammar::ConcreteType::Which::u64: {
       *out_tag = Meta::ConcreteType_tag::u64;
-      return { .main_size = 8 };
+      return { .main_size = 8, .alignment = 8 };
     }
     case grammar::ConcreteType::Which::i8: {
       *out_tag = Meta::ConcreteType_tag::i8;
-      return { .main_size = 1 };
+      return { .main_size = 1, .alignment = 1 };
     }
     case grammar::ConcreteType::Which::i16: {
       *out_tag = Meta::ConcreteType_tag::i16;
-      return { .main_size = 2 };
+      return { .main_size = 2, .alignment = 2 };
     }
     case grammar::ConcreteType::Which::i32: {
       *out_tag = Meta::ConcreteType_tag::i32;
-      return { .main_size = 4 };
+      return { .main_size = 4, .alignment = 4 };
     }
     case grammar::ConcreteType::Which::i64: {
       *out_tag = Meta::ConcreteType_tag::i64;
-      return { .main_size = 8 };
+      return { .main_size = 8, .alignment = 8 };
     }
     case grammar::ConcreteType::Which::f32: {
       *out_tag = Meta::ConcreteType_tag::f32;
-      return { .main_size = 4 };
+      return { .main_size = 4, .alignment = 4 };
     }
     case grammar::ConcreteType::Which::f64: {
       *out_tag = Meta::ConcreteType_tag::f64;
-      return { .main_size = 8 };
+      return { .main_size = 8, .alignment = 8 };
     }
     case grammar::ConcreteType::Which::nothing: {
       *out_tag = Meta::ConcreteType_tag::nothing;
-      return { .main_size = 0 };
+      return { .main_size = 0, .alignment = 1 };
     }
     case grammar::ConcreteType::Which::defined: {
       auto definition = resolve_by_name_hash(
@@ -136,10 +137,11 @@ OutputTypeResult output_concrete_type(
         }
 
         // We rely on the fact that this type has already been output.
-        auto size = structs.pointer[struct_index].size;
-        ASSERT(size > 0);
+        auto it = structs.pointer + struct_index;
+        ASSERT(it->size > 0);
         return {
-          .main_size = size
+          .main_size = it->size,
+          .alignment = it->alignment,
         };
       } else if (definition->which == grammar::TopLevelDefinition::Which::a_choice) {
         if (!allow_tag) {
@@ -160,11 +162,12 @@ OutputTypeResult output_concrete_type(
         }
 
         // We rely on the fact that this type has already been output.
-        auto payload_size = choices.pointer[choice_index].payloadSize;
+        auto it = choices.pointer + choice_index;
 
         return {
-          .main_size = payload_size,
+          .main_size = it->payloadSize,
           .tag_size = SVFRT_TAG_SIZE,
+          .alignment = it->payloadAlignment,
         };
       }
     }
@@ -211,7 +214,12 @@ OutputTypeResult output_type(
         false, // allow_tag
         true // force_size
       );
-      result.main_size = sizeof(svf::runtime::Reference<void>);
+      result.main_size = in_root->wide
+        ? sizeof(SVFRT_Reference64)
+        : sizeof(svf::runtime::Reference<void>);
+      result.alignment = in_root->wide
+        ? alignof(SVFRT_Reference64)
+        : alignof(svf::runtime::Reference<void>);
       return result;
     }
     case grammar::Type::Which::sequence: {
@@ -227,7 +235,36 @@ OutputTypeResult output_type(
         false, // allow_tag
         true // force_size
       );
-      result.main_size = sizeof(svf::runtime::Sequence<void>);
+      result.main_size = in_root->wide
+        ? sizeof(SVFRT_Sequence64)
+        : sizeof(svf::runtime::Sequence<void>);
+      result.alignment = in_root->wide
+        ? alignof(SVFRT_Sequence64)
+        : alignof(svf::runtime::Sequence<void>);
+      return result;
+    }
+    case grammar::Type::Which::chunked_sequence: {
+      // Not supported by #wide-messages.
+      if (in_root->wide) {
+        return {
+          .fail_code = FailCode::chunked_sequence_not_allowed,
+        };
+      }
+
+      *out_tag = Meta::Type_tag::chunkedSequence;
+      auto result = output_concrete_type(
+        in_root,
+        structs,
+        choices,
+        assigned_indices,
+        &in_type->chunked_sequence.element_type,
+        &out_payload->chunkedSequence.elementType_tag,
+        &out_payload->chunkedSequence.elementType_payload,
+        false, // allow_tag
+        true // force_size
+      );
+      result.main_size = sizeof(SVFRT_ChunkedSequence);
+      result.alignment = alignof(SVFRT_ChunkedSequence);
       return result;
     }
   }
@@ -404,7 +441,9 @@ GenerationResult as_bytes(
           in_struct->fields.count
         );
 
+        // See #natural-alignment.
         U32 size_sum = 0;
+        U32 alignment_max = 1;
         for (U64 j = 0; j < in_struct->fields.count; j++) {
           auto in_field = in_struct->fields.pointer + j;
           auto out_field = out_fields.pointer + j;
@@ -423,7 +462,6 @@ GenerationResult as_bytes(
 
           *out_field = Meta::FieldDefinition {
             .fieldId = id,
-            .offset = size_sum,
             .removed = in_field->removed,
           };
 
@@ -438,15 +476,18 @@ GenerationResult as_bytes(
             true // allow_tag
           );
 
-          // TODO @proper-alignment: tags.
-          size_sum += result.main_size;
-          size_sum += result.tag_size;
-
           if (result.fail_code != FailCode::ok) {
             return {
               .fail_code = result.fail_code,
             };
           };
+
+          // The tag of a choice is not aligned, it goes immediately before
+          // the payload, which is.
+          U32 main_offset = safe_int_cast<U32>(align_up(size_sum + result.tag_size, result.alignment));
+          out_field->offset = main_offset - result.tag_size;
+          size_sum = main_offset + result.main_size;
+          alignment_max = maxi(alignment_max, result.alignment);
         }
 
         if (size_sum == 0) {
@@ -455,6 +496,9 @@ GenerationResult as_bytes(
           };
         }
 
+        // Padding at the end keeps all elements of a sequence aligned.
+        size_sum = safe_int_cast<U32>(align_up(size_sum, alignment_max));
+
         auto mapping = vm::one<NameMappingToWrite>(arena2);
         mapping->id = in_struct->name_hash;
         mapping->name = in_struct->name;
@@ -462,6 +506,7 @@ GenerationResult as_bytes(
         *out_struct = Meta::StructDefinition {
           .typeId = in_struct->name_hash,
           .size = size_sum,
+          .alignment = alignment_max,
           .fields = {
             .data_offset_complement = ~offset_between<U32>(start_arena_data, out_fields.pointer),
             .count = safe_int_cast<U32>(out_fields.count),
@@ -480,6 +525,7 @@ GenerationResult as_bytes(
         );
 
         U32 size_max = 0;
+        U32 alignment_max = 1;
         for (U64 j = 0; j < in_choice->options.count; j++) {
           auto in_option = in_choice->options.pointer + j;
           auto out_option = out_options.pointer + j;
@@ -521,8 +567,13 @@ GenerationResult as_bytes(
               .fail_code = result.fail_code,
             };
           };
+
+          alignment_max = maxi(alignment_max, result.alignment);
         }
 
+        // Same as a union in C, see #natural-alignment.
+        size_max = safe_int_cast<U32>(align_up(size_max, alignment_max));
+
         if (in_choice->options.count == 0) {
           return {
             .fail_code = FailCode::empty_choice,
@@ -536,6 +587,7 @@ GenerationResult as_bytes(
         *out_choice = Meta::ChoiceDefinition {
           .typeId = in_choice->name_hash,
           .payloadSize = size_max,
+          .payloadAlignment = alignment_max,
           .options = {
             .data_offset_complement = ~offset_between<U32>(start_arena_data, out_options.pointer),
             .count = safe_int_cast<U32>(out_options.count),
@@ -44,6 +44,7 @@ struct Type {
     concrete,
     reference,
     sequence,
+    chunked_sequence,
   } which;
 
   struct Concrete {
@@ -58,10 +59,15 @@ struct Type {
     ConcreteType element_type;
   };
 
+  struct ChunkedSequence {
+    ConcreteType element_type;
+  };
+
   union {
     Concrete concrete;
     Reference reference;
     Sequence sequence;
+    ChunkedSequence chunked_sequence;
   };
 };
 
@@ -108,6 +114,7 @@ struct TopLevelDefinition {
 struct Root {
   Range<U8> schema_name;
   U64 schema_name_hash; // Now called "schemaId" in the metaschema.
+  Bool wide; // See #wide-messages in the runtime.
   Range<TopLevelDefinition> definitions;
 };
 
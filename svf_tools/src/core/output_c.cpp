@@ -134,7 +134,7 @@ void output_type(Ctx ctx, Meta::Type_tag in_tag, Meta::Type_payload *in_payload)
       break;
     }
     case Meta::Type_tag::reference: {
-      output_cstring(ctx, "SVFRT_Reference /*");
+      output_cstring(ctx, ctx->wide ? "SVFRT_Reference64 /*" : "SVFRT_Reference /*");
       output_concrete_type_name(
         ctx,
         in_payload->concrete.type_tag,
@@ -144,7 +144,17 @@ void output_type(Ctx ctx, Meta::Type_tag in_tag, Meta::Type_payload *in_payload)
       break;
     }
     case Meta::Type_tag::sequence: {
-      output_cstring(ctx, "SVFRT_Sequence /*");
+      output_cstring(ctx, ctx->wide ? "SVFRT_Sequence64 /*" : "SVFRT_Sequence /*");
+      output_concrete_type_name(
+        ctx,
+        in_payload->concrete.type_tag,
+        &in_payload->concrete.type_payload
+      );
+      output_cstring(ctx, "*/");
+      break;
+    }
+    case Meta::Type_tag::chunkedSequence: {
+      output_cstring(ctx, "SVFRT_ChunkedSequence /*");
       output_concrete_type_name(
         ctx,
         in_payload->concrete.type_tag,
@@ -169,26 +179,33 @@ Bool output_struct(Ctx ctx, Meta::StructDefinition *it) {
   output_name(ctx, it->typeId);
   output_cstring(ctx, " {\n");
 
+  // See #natural-alignment.
   UInt size_sum = 0;
+  UInt alignment_max = 1;
   auto fields = to_range(ctx->schema_bytes, it->fields);
 
   for (UInt i = 0; i < fields.count; i++) {
     auto field = fields.pointer + i;
 
-    // We don't support custom struct layouts yet.
-    if (field->offset != size_sum) {
-      return false;
-    }
-
     auto plurality = get_plurality(
       structs,
       choices,
       field->type_tag,
-      &field->type_payload
+      &field->type_payload,
+      ctx->wide
     );
 
-    // TODO @proper-alignment: align up first.
-    size_sum += plurality.size;
+    // We don't support custom struct layouts yet.
+    if (field->offset != get_natural_offset(size_sum, plurality)) {
+      return false;
+    }
+
+    // Only needed in front of a choice, otherwise the compiler would add the
+    // same padding anyway.
+    output_padding(ctx, size_sum, field->offset);
+
+    size_sum = field->offset + plurality.size;
+    alignment_max = maxi(alignment_max, plurality.alignment);
 
     switch (plurality.plurality) {
       case TypePlurality::zero: {
@@ -232,7 +249,8 @@ Bool output_struct(Ctx ctx, Meta::StructDefinition *it) {
     }
   }
 
-  if (size_sum != it->size) {
+  // The compiler adds the padding at the end.
+  if (alignment_max != it->alignment || align_up(size_sum, alignment_max) != it->size) {
     return false;
   }
 
@@ -246,6 +264,7 @@ Bool output_choice(Ctx ctx, Meta::ChoiceDefinition *it) {
 
   auto options = to_range(ctx->schema_bytes, it->options);
   UInt size_max = 0;
+  UInt alignment_max = 1;
 
   output_cstring(ctx, "#define SVF_");
   output_name(ctx, ctx->schema_definition->schemaId);
@@ -278,9 +297,11 @@ Bool output_choice(Ctx ctx, Meta::ChoiceDefinition *it) {
       structs,
       choices,
       option->type_tag,
-      &option->type_payload
+      &option->type_payload,
+      ctx->wide
     );
     size_max = maxi(size_max, plurality.size);
+    alignment_max = maxi(alignment_max, plurality.alignment);
 
     if (plurality.plurality == TypePlurality::zero) {
       continue;
@@ -297,7 +318,8 @@ Bool output_choice(Ctx ctx, Meta::ChoiceDefinition *it) {
 
   }
 
-  if (size_max != it->payloadSize) {
+  // Same as above, the compiler adds the padding at the end.
+  if (alignment_max != it->payloadAlignment || align_up(size_max, alignment_max) != it->payloadSize) {
     return false;
   }
 
@@ -309,21 +331,12 @@ Bytes as_code(
   vm::LinearArena *arena,
   Bytes schema_bytes,
   Bytes appendix_bytes,
-  validation::Result *validation_result
+  validation::Result *validation_result,
+  Bool wide
 ) {
-  // TODO @proper-alignment: struct access.
-  auto schema_definition = (Meta::SchemaDefinition *) (
-    schema_bytes.pointer +
-    schema_bytes.count -
-    sizeof(Meta::SchemaDefinition)
-  );
-
-  // TODO @proper-alignment: struct access.
-  auto appendix = (Meta::Appendix *) (
-    appendix_bytes.pointer +
-    appendix_bytes.count -
-    sizeof(Meta::Appendix)
-  );
+  auto schema_definition = get_last_struct<Meta::SchemaDefinition>(schema_bytes);
+
+  auto appendix = get_last_struct<Meta::Appendix>(appendix_bytes);
 
   auto start = vm::realign(arena);
   OutputContext context_value = {
@@ -332,6 +345,7 @@ Bytes as_code(
     .schema_bytes = schema_bytes,
     .appendix = appendix,
     .appendix_bytes = appendix_bytes,
+    .wide = wide,
   };
 
   auto ctx = &context_value;
@@ -357,7 +371,6 @@ extern "C" {
 
 #ifndef SVF_COMMON_C_TYPES_INCLUDED
 #define SVF_COMMON_C_TYPES_INCLUDED
-#pragma pack(push, 1)
 
 typedef struct SVFRT_Reference {
   uint32_t data_offset_complement;
@@ -368,12 +381,53 @@ typedef struct SVFRT_Sequence {
   uint32_t count;
 } SVFRT_Sequence;
 
-#pragma pack(pop)
+// Binary schemas are read in place, so they are aligned the same way as the
+// message parts, see #natural-alignment.
+#if defined(__cplusplus) && __cplusplus >= 201103L
+  #define SVF_SCHEMA_ALIGNAS alignas(8)
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+  #define SVF_SCHEMA_ALIGNAS _Alignas(8)
+#elif defined(_MSC_VER)
+  #define SVF_SCHEMA_ALIGNAS __declspec(align(8))
+#else
+  #define SVF_SCHEMA_ALIGNAS __attribute__((aligned(8)))
+#endif
+
 #endif // SVF_COMMON_C_TYPES_INCLUDED
 
-#pragma pack(push, 1)
+)");
+
+  // Only for schemas with a #wide directive.
+  if (ctx->wide) {
+    output_cstring(ctx, R"(#ifndef SVF_WIDE_C_TYPES_INCLUDED
+#define SVF_WIDE_C_TYPES_INCLUDED
+
+typedef struct SVFRT_Reference64 {
+  uint64_t data_offset_complement;
+} SVFRT_Reference64;
+
+typedef struct SVFRT_Sequence64 {
+  uint64_t data_offset_complement;
+  uint64_t count;
+} SVFRT_Sequence64;
+#endif // SVF_WIDE_C_TYPES_INCLUDED
 
 )");
+  }
+
+  // Only for schemas with chunked sequences.
+  if (uses_chunked_sequences(schema_bytes)) {
+    output_cstring(ctx, R"(#ifndef SVF_CHUNKED_C_TYPES_INCLUDED
+#define SVF_CHUNKED_C_TYPES_INCLUDED
+
+typedef struct SVFRT_ChunkedSequence {
+  uint32_t data_offset_complement;
+  uint32_t count;
+} SVFRT_ChunkedSequence;
+#endif // SVF_CHUNKED_C_TYPES_INCLUDED
+
+)");
+  }
 
   output_cstring(ctx, "#define SVF_");
   output_name(ctx, schema_definition->schemaId);
@@ -466,9 +520,6 @@ typedef struct SVFRT_Sequence {
     }
   }
 
-  output_cstring(ctx, "#pragma pack(pop)\n");
-  output_cstring(ctx, "\n");
-
   output_cstring(ctx, "// Binary schema.\n");
   output_cstring(ctx, "#if defined(SVF_INCLUDE_BINARY_SCHEMA) || defined(SVF_IMPLEMENTATION)\n");
   output_cstring(ctx, "#ifndef SVF_");
@@ -490,7 +541,7 @@ typedef struct SVFRT_Sequence {
   output_cstring(ctx, "};\n");
   output_cstring(ctx, "\n");
 
-  output_cstring(ctx, "uint8_t const SVF_");
+  output_cstring(ctx, "SVF_SCHEMA_ALIGNAS uint8_t const SVF_");
   output_name(ctx, schema_definition->schemaId);
   output_cstring(ctx, "_schema_binary_array[] = {\n");
   output_raw_bytes(ctx, schema_bytes);
@@ -13,6 +13,7 @@ struct OutputContext {
   Bytes schema_bytes;
   Meta::Appendix *appendix;
   Bytes appendix_bytes;
+  Bool wide;
 };
 
 using Ctx = OutputContext *;
@@ -86,4 +87,19 @@ void output_raw_bytes(Ctx ctx, Bytes bytes) {
   }
 }
 
+// Explicit padding in front of a field, see #natural-alignment. Field names
+// can't start with an underscore, so there are no collisions.
+static inline
+void output_padding(Ctx ctx, UInt offset, UInt next_offset) {
+  if (next_offset == offset) {
+    return;
+  }
+
+  output_cstring(ctx, "  uint8_t _padding");
+  output_decimal(ctx, offset);
+  output_cstring(ctx, "[");
+  output_decimal(ctx, next_offset - offset);
+  output_cstring(ctx, "];\n");
+}
+
 } // namespace core::output
@@ -0,0 +1,835 @@
+#include <src/library.hpp>
+#include <src/svf_internal.h>
+#include "../core.hpp"
+#include "common.hpp"
+#include "output_common.hpp"
+
+namespace core::output::conversion {
+
+// Specialized converter functions, see #generated-conversion. Each emitted
+// function converts one dst-struct, with the same traversal order, tallies and
+// recursion depths as `SVFRT_conversion_traverse_struct`, so that the output is
+// exactly the same as that of the generic conversion.
+
+struct Generation {
+  vm::LinearArena *scratch_arena;
+  Ctx ctx_src;
+  Ctx ctx_dst;
+
+  Bytes schema_src;
+  Bytes schema_dst;
+  Range<Meta::StructDefinition> structs_src;
+  Range<Meta::StructDefinition> structs_dst;
+  Range<Meta::ChoiceDefinition> choices_src;
+  Range<Meta::ChoiceDefinition> choices_dst;
+
+  // Result of the last `check_entry`, only valid until the next one.
+  Bytes check_scratch;
+  SVFRT_CompatibilityResult check_result;
+
+  // Per dst-struct: the index of the entry which emits its function, or
+  // `UINT32_MAX`, and the index of the matching src-struct.
+  Range<U32> owners;
+  Range<U32> struct_indices_src;
+
+  // Per dst-struct, for the current walk.
+  Range<Bool> visited;
+
+  // Set by the walk, if a reachable type cannot be converted by the generated
+  // code. The runtime converts those entries as usual.
+  Bool unsupported;
+};
+
+// Check `entry_index_dst` as the entry. Returns true, if it needs a logical
+// conversion, i.e. a converter.
+Bool check_entry(Generation *g, U32 entry_index_dst) {
+  auto entry_struct_id = g->structs_dst.pointer[entry_index_dst].typeId;
+
+  Bool found = false;
+  for (UInt j = 0; j < g->structs_src.count; j++) {
+    found = found || g->structs_src.pointer[j].typeId == entry_struct_id;
+  }
+  if (!found) {
+    return false;
+  }
+
+  g->check_result = {};
+  SVFRT_check_compatibility(
+    &g->check_result,
+    { g->check_scratch.pointer, safe_int_cast<U32>(g->check_scratch.count) },
+    { g->schema_src.pointer, safe_int_cast<U32>(g->schema_src.count) },
+    { g->schema_dst.pointer, safe_int_cast<U32>(g->schema_dst.count) },
+    entry_struct_id,
+    SVFRT_compatibility_logical,
+    SVFRT_compatibility_exact, // `sufficient_level`, same as `SVFRT_read_message`.
+    UINT32_MAX
+  );
+
+  return (
+    g->check_result.error_code == 0 &&
+    g->check_result.level == SVFRT_compatibility_logical
+  );
+}
+
+// Index of the src-field matching the `i`-th field of dst-struct
+// `struct_index_dst`, or `UINT32_MAX`, if there is nothing to convert.
+U32 get_field_match(Generation *g, U32 struct_index_dst, UInt i) {
+  auto info = &g->check_result.logical;
+  auto field_dst = to_range(g->schema_dst, g->structs_dst.pointer[struct_index_dst].fields).pointer + i;
+  if (field_dst->removed) {
+    return UINT32_MAX;
+  }
+  return info->field_matches.pointer[info->field_matches_header.pointer[struct_index_dst] + i];
+}
+
+// Index of the src-option matching the `i`-th option of dst-choice
+// `choice_index_dst`, or `UINT32_MAX`, if there is nothing to convert.
+U32 get_option_match(Generation *g, U32 choice_index_src, U32 choice_index_dst, UInt i, U8 *out_tag_src) {
+  auto info = &g->check_result.logical;
+  auto index = info->option_matches_header.pointer[choice_index_dst] + i;
+  auto tag_src = info->option_matches_tags.pointer[index];
+  *out_tag_src = tag_src;
+  if (!tag_src) {
+    return UINT32_MAX;
+  }
+
+  auto j = info->option_matches.pointer[index];
+  auto option_src = to_range(g->schema_src, g->choices_src.pointer[choice_index_src].options).pointer + j;
+  auto option_dst = to_range(g->schema_dst, g->choices_dst.pointer[choice_index_dst].options).pointer + i;
+  if (option_src->removed || option_dst->removed) {
+    return UINT32_MAX;
+  }
+  return j;
+}
+
+void walk_struct(Generation *g, U32 struct_index_src, U32 struct_index_dst);
+void walk_any_type(Generation *g, Meta::Type_tag tag_src, Meta::Type_payload *payload_src, Meta::Type_payload *payload_dst);
+
+void walk_concrete_type(
+  Generation *g,
+  Meta::ConcreteType_tag tag_src,
+  Meta::ConcreteType_payload *payload_src,
+  Meta::ConcreteType_payload *payload_dst
+) {
+  if (tag_src == Meta::ConcreteType_tag::definedStruct) {
+    walk_struct(g, payload_src->definedStruct.index, payload_dst->definedStruct.index);
+    return;
+  }
+
+  if (tag_src == Meta::ConcreteType_tag::definedChoice) {
+    auto choice_index_src = payload_src->definedChoice.index;
+    auto choice_index_dst = payload_dst->definedChoice.index;
+    auto options_src = to_range(g->schema_src, g->choices_src.pointer[choice_index_src].options);
+    auto options_dst = to_range(g->schema_dst, g->choices_dst.pointer[choice_index_dst].options);
+    for (UInt i = 0; i < options_dst.count; i++) {
+      U8 tag = 0;
+      auto j = get_option_match(g, choice_index_src, choice_index_dst, i, &tag);
+      if (j == UINT32_MAX) {
+        continue;
+      }
+      walk_any_type(
+        g,
+        options_src.pointer[j].type_tag,
+        &options_src.pointer[j].type_payload,
+        &options_dst.pointer[i].type_payload
+      );
+    }
+  }
+}
+
+void walk_any_type(
+  Generation *g,
+  Meta::Type_tag tag_src,
+  Meta::Type_payload *payload_src,
+  Meta::Type_payload *payload_dst
+) {
+  switch (tag_src) {
+    case Meta::Type_tag::concrete: {
+      walk_concrete_type(
+        g,
+        payload_src->concrete.type_tag,
+        &payload_src->concrete.type_payload,
+        &payload_dst->concrete.type_payload
+      );
+      return;
+    }
+    case Meta::Type_tag::reference:
+    case Meta::Type_tag::sequence: {
+      // Same layout for both, see `SVFRT_conversion_start_sequence`.
+      auto element_tag = payload_src->reference.type_tag;
+      if (
+        element_tag == Meta::ConcreteType_tag::nothing ||
+        element_tag == Meta::ConcreteType_tag::definedChoice
+      ) {
+        g->unsupported = true;
+        return;
+      }
+      walk_concrete_type(
+        g,
+        element_tag,
+        &payload_src->reference.type_payload,
+        &payload_dst->reference.type_payload
+      );
+      return;
+    }
+    default: {
+      // Chunked sequences are left to the runtime.
+      g->unsupported = true;
+      return;
+    }
+  }
+}
+
+void walk_struct(Generation *g, U32 struct_index_src, U32 struct_index_dst) {
+  if (g->visited.pointer[struct_index_dst]) {
+    return;
+  }
+  g->visited.pointer[struct_index_dst] = true;
+  g->struct_indices_src.pointer[struct_index_dst] = struct_index_src;
+
+  auto fields_src = to_range(g->schema_src, g->structs_src.pointer[struct_index_src].fields);
+  auto fields_dst = to_range(g->schema_dst, g->structs_dst.pointer[struct_index_dst].fields);
+  for (UInt i = 0; i < fields_dst.count; i++) {
+    auto j = get_field_match(g, struct_index_dst, i);
+    if (j == UINT32_MAX) {
+      continue;
+    }
+    walk_any_type(
+      g,
+      fields_src.pointer[j].type_tag,
+      &fields_src.pointer[j].type_payload,
+      &fields_dst.pointer[i].type_payload
+    );
+  }
+}
+
+// Walk the last checked entry. Returns false, if it can't be converted.
+Bool walk_entry(Generation *g) {
+  for (UInt i = 0; i < g->visited.count; i++) {
+    g->visited.pointer[i] = false;
+  }
+  g->unsupported = false;
+
+  auto info = &g->check_result.logical;
+  walk_struct(g, info->entry_struct_index_src, info->entry_struct_index_dst);
+  return !g->unsupported;
+}
+
+// Output `SVF_<src>_to_<dst>`.
+void output_prefix(Ctx ctx_src, Ctx ctx_dst) {
+  output_cstring(ctx_src, "SVF_");
+  output_name(ctx_src, ctx_src->schema_definition->schemaId);
+  output_cstring(ctx_src, "_to_");
+  output_name(ctx_dst, ctx_dst->schema_definition->schemaId);
+}
+
+void output_function_name(Generation *g, U32 struct_index_dst) {
+  output_prefix(g->ctx_src, g->ctx_dst);
+  output_cstring(g->ctx_dst, "_convert_");
+  output_name(g->ctx_dst, g->structs_dst.pointer[struct_index_dst].typeId);
+}
+
+void output_indent(Ctx ctx, U32 indent) {
+  for (U32 i = 0; i < indent; i++) {
+    output_cstring(ctx, "  ");
+  }
+}
+
+char const *get_c_type(Meta::ConcreteType_tag tag) {
+  switch (tag) {
+    case Meta::ConcreteType_tag::u8: return "uint8_t";
+    case Meta::ConcreteType_tag::u16: return "uint16_t";
+    case Meta::ConcreteType_tag::u32: return "uint32_t";
+    case Meta::ConcreteType_tag::u64: return "uint64_t";
+    case Meta::ConcreteType_tag::i8: return "int8_t";
+    case Meta::ConcreteType_tag::i16: return "int16_t";
+    case Meta::ConcreteType_tag::i32: return "int32_t";
+    case Meta::ConcreteType_tag::i64: return "int64_t";
+    case Meta::ConcreteType_tag::f32: return "float";
+    case Meta::ConcreteType_tag::f64: return "double";
+    default: return NULL;
+  }
+}
+
+U32 get_primitive_size(Meta::ConcreteType_tag tag) {
+  switch (tag) {
+    case Meta::ConcreteType_tag::u8: return 1;
+    case Meta::ConcreteType_tag::u16: return 2;
+    case Meta::ConcreteType_tag::u32: return 4;
+    case Meta::ConcreteType_tag::u64: return 8;
+    case Meta::ConcreteType_tag::i8: return 1;
+    case Meta::ConcreteType_tag::i16: return 2;
+    case Meta::ConcreteType_tag::i32: return 4;
+    case Meta::ConcreteType_tag::i64: return 8;
+    case Meta::ConcreteType_tag::f32: return 4;
+    case Meta::ConcreteType_tag::f64: return 8;
+    default: return 0;
+  }
+}
+
+// Output `src + <offset>`, or `dst ? dst + <offset> : NULL`.
+void output_pointer(Ctx ctx, Bool is_dst, U32 offset) {
+  output_cstring(ctx, is_dst ? "dst ? dst + " : "src + ");
+  output_decimal(ctx, offset);
+  if (is_dst) {
+    output_cstring(ctx, " : NULL");
+  }
+}
+
+// Output `if (!SVFRT_generated_enter(ctx, depth + <level>)) return false;`.
+void output_enter(Ctx ctx, U32 indent, U32 level) {
+  output_indent(ctx, indent);
+  output_cstring(ctx, "if (!SVFRT_generated_enter(ctx, depth + ");
+  output_decimal(ctx, level);
+  output_cstring(ctx, ")) return false;\n");
+}
+
+void output_any_type(
+  Generation *g,
+  U32 indent,
+  U32 level,
+  U32 offset_src,
+  U32 offset_dst,
+  Meta::Type_tag tag_src,
+  Meta::Type_payload *payload_src,
+  Meta::Type_payload *payload_dst
+);
+
+// A value of `level` means, that this is converted at `depth + level`, same as
+// the `recursion_depth` in `SVFRT_conversion_traverse_concrete_type`.
+void output_concrete_type(
+  Generation *g,
+  U32 indent,
+  U32 level,
+  U32 offset_src,
+  U32 offset_dst,
+  Meta::ConcreteType_tag tag_src,
+  Meta::ConcreteType_payload *payload_src,
+  Meta::ConcreteType_tag tag_dst,
+  Meta::ConcreteType_payload *payload_dst
+) {
+  auto ctx = g->ctx_src;
+
+  switch (tag_dst) {
+    case Meta::ConcreteType_tag::nothing: {
+      return;
+    }
+    case Meta::ConcreteType_tag::definedStruct: {
+      output_indent(ctx, indent);
+      output_cstring(ctx, "if (!");
+      output_function_name(g, payload_dst->definedStruct.index);
+      output_cstring(ctx, "(ctx, depth + ");
+      output_decimal(ctx, level);
+      output_cstring(ctx, ", ");
+      output_pointer(ctx, false, offset_src);
+      output_cstring(ctx, ", ");
+      output_pointer(ctx, true, offset_dst);
+      output_cstring(ctx, ")) return false;\n");
+      return;
+    }
+    case Meta::ConcreteType_tag::definedChoice: {
+      auto choice_index_src = payload_src->definedChoice.index;
+      auto choice_index_dst = payload_dst->definedChoice.index;
+      auto options_src = to_range(g->schema_src, g->choices_src.pointer[choice_index_src].options);
+      auto options_dst = to_range(g->schema_dst, g->choices_dst.pointer[choice_index_dst].options);
+
+      // The last matching dst-option wins in `SVFRT_conversion_resolve_choice`,
+      // so go backwards, and skip the src-tags which were seen already.
+      Bool seen[256] = {};
+      Bool any = false;
+      for (UInt k = options_dst.count; k > 0; k--) {
+        auto i = k - 1;
+        U8 tag = 0;
+        auto j = get_option_match(g, choice_index_src, choice_index_dst, i, &tag);
+        if (!tag || seen[tag]) {
+          continue;
+        }
+        seen[tag] = true;
+
+        // Removed options stay zero in the output.
+        if (j == UINT32_MAX) {
+          continue;
+        }
+
+        if (!any) {
+          output_indent(ctx, indent);
+          output_cstring(ctx, "switch (src[");
+          output_decimal(ctx, offset_src);
+          output_cstring(ctx, "]) {\n");
+          any = true;
+        }
+
+        auto option_src = options_src.pointer + j;
+        auto option_dst = options_dst.pointer + i;
+        output_indent(ctx, indent + 1);
+        output_cstring(ctx, "case ");
+        output_decimal(ctx, tag);
+        output_cstring(ctx, ": { // ");
+        output_name(g->ctx_dst, option_dst->optionId);
+        output_cstring(ctx, ".\n");
+
+        output_indent(ctx, indent + 2);
+        output_cstring(ctx, "if (dst) dst[");
+        output_decimal(ctx, offset_dst);
+        output_cstring(ctx, "] = ");
+        output_decimal(ctx, option_dst->tag);
+        output_cstring(ctx, ";\n");
+        output_enter(ctx, indent + 2, level + 1);
+
+        output_any_type(
+          g,
+          indent + 2,
+          level + 1,
+          offset_src + SVFRT_TAG_SIZE,
+          offset_dst + SVFRT_TAG_SIZE,
+          option_src->type_tag,
+          &option_src->type_payload,
+          &option_dst->type_payload
+        );
+
+        output_indent(ctx, indent + 2);
+        output_cstring(ctx, "break;\n");
+        output_indent(ctx, indent + 1);
+        output_cstring(ctx, "}\n");
+      }
+
+      if (any) {
+        output_indent(ctx, indent);
+        output_cstring(ctx, "}\n");
+      }
+      return;
+    }
+    default: {
+      break;
+    }
+  }
+
+  // Primitives are only written in Phase 2.
+  auto size_src = get_primitive_size(tag_src);
+  auto size_dst = get_primitive_size(tag_dst);
+  output_indent(ctx, indent);
+  output_cstring(ctx, "if (dst) {\n");
+
+  // Untrusted src-data may be misaligned, hence `memcpy`. See #natural-alignment.
+  if (tag_src == tag_dst) {
+    output_indent(ctx, indent + 1);
+    output_cstring(ctx, "memcpy(dst + ");
+    output_decimal(ctx, offset_dst);
+    output_cstring(ctx, ", src + ");
+    output_decimal(ctx, offset_src);
+    output_cstring(ctx, ", ");
+    output_decimal(ctx, size_dst);
+    output_cstring(ctx, ");\n");
+  } else {
+    output_indent(ctx, indent + 1);
+    output_cstring(ctx, get_c_type(tag_src));
+    output_cstring(ctx, " value;\n");
+    output_indent(ctx, indent + 1);
+    output_cstring(ctx, "memcpy(&value, src + ");
+    output_decimal(ctx, offset_src);
+    output_cstring(ctx, ", ");
+    output_decimal(ctx, size_src);
+    output_cstring(ctx, ");\n");
+    output_indent(ctx, indent + 1);
+    output_cstring(ctx, get_c_type(tag_dst));
+    output_cstring(ctx, " widened = (");
+    output_cstring(ctx, get_c_type(tag_dst));
+    output_cstring(ctx, ") value;\n");
+    output_indent(ctx, indent + 1);
+    output_cstring(ctx, "memcpy(dst + ");
+    output_decimal(ctx, offset_dst);
+    output_cstring(ctx, ", &widened, ");
+    output_decimal(ctx, size_dst);
+    output_cstring(ctx, ");\n");
+  }
+
+  output_indent(ctx, indent);
+  output_cstring(ctx, "}\n");
+}
+
+void output_any_type(
+  Generation *g,
+  U32 indent,
+  U32 level,
+  U32 offset_src,
+  U32 offset_dst,
+  Meta::Type_tag tag_src,
+  Meta::Type_payload *payload_src,
+  Meta::Type_payload *payload_dst
+) {
+  auto ctx = g->ctx_src;
+
+  if (tag_src == Meta::Type_tag::concrete) {
+    output_concrete_type(
+      g,
+      indent,
+      level,
+      offset_src,
+      offset_dst,
+      payload_src->concrete.type_tag,
+      &payload_src->concrete.type_payload,
+      payload_dst->concrete.type_tag,
+      &payload_dst->concrete.type_payload
+    );
+    return;
+  }
+
+  // References and sequences, see `walk_any_type`.
+  auto element_tag_src = payload_src->reference.type_tag;
+  auto element_tag_dst = payload_dst->reference.type_tag;
+  auto is_struct = element_tag_dst == Meta::ConcreteType_tag::definedStruct;
+  U32 element_size_src = 0;
+  U32 element_size_dst = 0;
+  if (is_struct) {
+    element_size_src = g->structs_src.pointer[payload_src->reference.type_payload.definedStruct.index].size;
+    element_size_dst = g->structs_dst.pointer[payload_dst->reference.type_payload.definedStruct.index].size;
+  } else {
+    element_size_src = get_primitive_size(element_tag_src);
+    element_size_dst = get_primitive_size(element_tag_dst);
+  }
+
+  output_indent(ctx, indent);
+  output_cstring(ctx, "{\n");
+  output_indent(ctx, indent + 1);
+  output_cstring(ctx, "SVFRT_GeneratedElements elements;\n");
+  output_indent(ctx, indent + 1);
+  output_cstring(ctx, "if (!SVFRT_generated_handle(ctx, ");
+  output_pointer(ctx, false, offset_src);
+  output_cstring(ctx, ", ");
+  output_pointer(ctx, true, offset_dst);
+  output_cstring(ctx, tag_src == Meta::Type_tag::sequence ? ", true, " : ", false, ");
+  output_decimal(ctx, element_size_src);
+  output_cstring(ctx, ", ");
+  output_decimal(ctx, element_size_dst);
+  output_cstring(ctx, ", ");
+  output_decimal(ctx, (U64) element_tag_src);
+  output_cstring(ctx, ", ");
+  output_decimal(ctx, (U64) element_tag_dst);
+  output_cstring(ctx, ", &elements)) return false;\n");
+
+  if (is_struct) {
+    output_indent(ctx, indent + 1);
+    output_cstring(ctx, "for (uint32_t i = 0; i < elements.count; i++) {\n");
+    output_indent(ctx, indent + 2);
+    output_cstring(ctx, "if (!");
+    output_function_name(g, payload_dst->reference.type_payload.definedStruct.index);
+    output_cstring(ctx, "(\n");
+    output_indent(ctx, indent + 3);
+    output_cstring(ctx, "ctx,\n");
+    output_indent(ctx, indent + 3);
+    output_cstring(ctx, "depth + ");
+    output_decimal(ctx, level);
+    output_cstring(ctx, ",\n");
+    output_indent(ctx, indent + 3);
+    output_cstring(ctx, "elements.pointer_src + (size_t) i * ");
+    output_decimal(ctx, element_size_src);
+    output_cstring(ctx, ",\n");
+    output_indent(ctx, indent + 3);
+    output_cstring(ctx, "elements.pointer_dst ? elements.pointer_dst + (size_t) i * ");
+    output_decimal(ctx, element_size_dst);
+    output_cstring(ctx, " : NULL\n");
+    output_indent(ctx, indent + 2);
+    output_cstring(ctx, ")) return false;\n");
+    output_indent(ctx, indent + 1);
+    output_cstring(ctx, "}\n");
+  }
+
+  output_indent(ctx, indent);
+  output_cstring(ctx, "}\n");
+}
+
+void output_function_signature(Generation *g, U32 struct_index_dst) {
+  auto ctx = g->ctx_src;
+  output_cstring(ctx, "static bool ");
+  output_function_name(g, struct_index_dst);
+  output_cstring(ctx, "(SVFRT_GeneratedConversion *ctx, uint32_t depth, uint8_t const *src, uint8_t *dst)");
+}
+
+void output_function(Generation *g, U32 struct_index_dst) {
+  auto ctx = g->ctx_src;
+  auto struct_index_src = g->struct_indices_src.pointer[struct_index_dst];
+  auto fields_src = to_range(g->schema_src, g->structs_src.pointer[struct_index_src].fields);
+  auto fields_dst = to_range(g->schema_dst, g->structs_dst.pointer[struct_index_dst].fields);
+
+  output_function_signature(g, struct_index_dst);
+  output_cstring(ctx, " {\n");
+
+  Bool any = false;
+  for (UInt i = 0; i < fields_dst.count; i++) {
+    auto j = get_field_match(g, struct_index_dst, i);
+    if (j == UINT32_MAX) {
+      continue;
+    }
+
+    // Same depth for all fields, so it's checked only once.
+    if (!any) {
+      output_enter(ctx, 1, 1);
+      any = true;
+    }
+
+    auto field_src = fields_src.pointer + j;
+    auto field_dst = fields_dst.pointer + i;
+    output_cstring(ctx, "\n  // ");
+    output_name(g->ctx_dst, field_dst->fieldId);
+    output_cstring(ctx, ".\n");
+    output_any_type(
+      g,
+      1,
+      1,
+      field_src->offset,
+      field_dst->offset,
+      field_src->type_tag,
+      &field_src->type_payload,
+      &field_dst->type_payload
+    );
+  }
+
+  // Nothing to convert, and the output is zero already.
+  if (!any) {
+    output_cstring(ctx, "  (void) ctx;\n");
+    output_cstring(ctx, "  (void) depth;\n");
+    output_cstring(ctx, "  (void) src;\n");
+    output_cstring(ctx, "  (void) dst;\n");
+  }
+
+  output_cstring(ctx, "  return true;\n");
+  output_cstring(ctx, "}\n\n");
+}
+
+Range<U8> as_code(
+  vm::LinearArena *arena,
+  vm::LinearArena *scratch_arena,
+  Bytes schema_src,
+  Bytes appendix_src,
+  Bytes schema_dst,
+  Bytes appendix_dst
+) {
+  auto schema_definition_src = get_last_struct<Meta::SchemaDefinition>(schema_src);
+  auto schema_definition_dst = (Meta::SchemaDefinition *) (
+    schema_dst.pointer +
+    schema_dst.count -
+    sizeof(Meta::SchemaDefinition)
+  );
+
+  auto appendix_definition_src = get_last_struct<Meta::Appendix>(appendix_src);
+  auto appendix_definition_dst = (Meta::Appendix *) (
+    appendix_dst.pointer +
+    appendix_dst.count -
+    sizeof(Meta::Appendix)
+  );
+
+  // Both contexts output to the same arena, so their output is interleaved in
+  // the order of calls.
+  auto start = vm::realign(arena);
+  OutputContext context_src_value = {
+    .dedicated_arena = arena,
+    .schema_definition = schema_definition_src,
+    .schema_bytes = schema_src,
+    .appendix = appendix_definition_src,
+    .appendix_bytes = appendix_src,
+    .wide = false,
+  };
+  OutputContext context_dst_value = {
+    .dedicated_arena = arena,
+    .schema_definition = schema_definition_dst,
+    .schema_bytes = schema_dst,
+    .appendix = appendix_definition_dst,
+    .appendix_bytes = appendix_dst,
+    .wide = false,
+  };
+  auto ctx = &context_src_value;
+  auto ctx_dst = &context_dst_value;
+
+  Generation generation = {
+    .scratch_arena = scratch_arena,
+    .ctx_src = ctx,
+    .ctx_dst = ctx_dst,
+    .schema_src = schema_src,
+    .schema_dst = schema_dst,
+    .structs_src = to_range(schema_src, schema_definition_src->structs),
+    .structs_dst = to_range(schema_dst, schema_definition_dst->structs),
+    .choices_src = to_range(schema_src, schema_definition_src->choices),
+    .choices_dst = to_range(schema_dst, schema_definition_dst->choices),
+  };
+  auto g = &generation;
+  auto struct_count_dst = g->structs_dst.count;
+  g->check_scratch = vm::many<U8>(scratch_arena, get_min_read_scratch_memory_size(schema_dst, schema_definition_dst));
+  g->owners = vm::many<U32>(scratch_arena, struct_count_dst);
+  g->struct_indices_src = vm::many<U32>(scratch_arena, struct_count_dst);
+  g->visited = vm::many<Bool>(scratch_arena, struct_count_dst);
+  auto supported = vm::many<Bool>(scratch_arena, struct_count_dst);
+
+  // Find the entries which get a converter, and which one of them emits the
+  // function for each reachable dst-struct.
+  U32 converter_count = 0;
+  for (U32 i = 0; i < struct_count_dst; i++) {
+    g->owners.pointer[i] = UINT32_MAX;
+  }
+  for (U32 i = 0; i < struct_count_dst; i++) {
+    supported.pointer[i] = check_entry(g, i) && walk_entry(g);
+    if (!supported.pointer[i]) {
+      continue;
+    }
+
+    converter_count++;
+    for (U32 k = 0; k < struct_count_dst; k++) {
+      if (g->visited.pointer[k] && g->owners.pointer[k] == UINT32_MAX) {
+        g->owners.pointer[k] = i;
+      }
+    }
+  }
+
+  output_cstring(ctx, "// AUTOGENERATED by svfc.\n");
+  output_cstring(ctx, "#ifndef ");
+  output_prefix(ctx, ctx_dst);
+  output_cstring(ctx, "_H\n#define ");
+  output_prefix(ctx, ctx_dst);
+  output_cstring(ctx, "_H\n");
+  output_cstring(ctx, R"(
+#ifdef __cplusplus
+#include <cstring>
+
+extern "C" {
+#else
+#include <string.h>
+#endif
+
+)");
+
+  output_cstring(ctx, "// Generated conversions from ");
+  output_name(ctx, schema_definition_src->schemaId);
+  output_cstring(ctx, " to ");
+  output_name(ctx_dst, schema_definition_dst->schemaId);
+  output_cstring(ctx, ", see #generated-conversion.\n");
+  output_cstring(ctx, "// Include after \"svf_runtime.h\", and pass them to `SVFRT_converter_table_add`.\n");
+
+  output_cstring(ctx, "#define ");
+  output_prefix(ctx, ctx_dst);
+  output_cstring(ctx, "_schema_content_hash_src 0x");
+  output_hexadecimal(ctx, get_content_hash(schema_src));
+  output_cstring(ctx, "ull\n");
+
+  output_cstring(ctx, "#define ");
+  output_prefix(ctx, ctx_dst);
+  output_cstring(ctx, "_schema_content_hash_dst 0x");
+  output_hexadecimal(ctx, get_content_hash(schema_dst));
+  output_cstring(ctx, "ull\n");
+
+  output_cstring(ctx, "#define ");
+  output_prefix(ctx, ctx_dst);
+  output_cstring(ctx, "_converter_count ");
+  output_decimal(ctx, converter_count);
+  output_cstring(ctx, "\n");
+
+  // Binary-compatible schemas need no converters.
+  if (converter_count == 0) {
+    output_cstring(ctx, "#define ");
+    output_prefix(ctx, ctx_dst);
+    output_cstring(ctx, "_converters NULL\n");
+  } else {
+    output_cstring(ctx, "extern SVFRT_GeneratedConverter const ");
+    output_prefix(ctx, ctx_dst);
+    output_cstring(ctx, "_converters[];\n");
+  }
+  output_cstring(ctx, "\n");
+
+  if (converter_count != 0) {
+    output_cstring(ctx, "#if defined(SVF_INCLUDE_BINARY_SCHEMA) || defined(SVF_IMPLEMENTATION)\n");
+    output_cstring(ctx, "#ifndef ");
+    output_prefix(ctx, ctx_dst);
+    output_cstring(ctx, "_BINARY_INCLUDED_H\n");
+    output_cstring(ctx, "#define ");
+    output_prefix(ctx, ctx_dst);
+    output_cstring(ctx, "_BINARY_INCLUDED_H\n\n");
+
+    // Converters are only used for messages with exactly this src-schema.
+    output_cstring(ctx, "static uint8_t const ");
+    output_prefix(ctx, ctx_dst);
+    output_cstring(ctx, "_schema_src[] = {\n");
+    output_raw_bytes(ctx, schema_src);
+    output_cstring(ctx, "};\n\n");
+
+    for (U32 i = 0; i < struct_count_dst; i++) {
+      if (g->owners.pointer[i] != UINT32_MAX) {
+        output_function_signature(g, i);
+        output_cstring(ctx, ";\n");
+      }
+    }
+    output_cstring(ctx, "\n");
+
+    // The matches are only valid for the last check, so the functions are
+    // emitted entry by entry.
+    for (U32 i = 0; i < struct_count_dst; i++) {
+      if (!supported.pointer[i]) {
+        continue;
+      }
+      check_entry(g, i);
+      walk_entry(g);
+      for (U32 k = 0; k < struct_count_dst; k++) {
+        if (g->owners.pointer[k] == i) {
+          output_function(g, k);
+        }
+      }
+    }
+
+    output_cstring(ctx, "SVFRT_GeneratedConverter const ");
+    output_prefix(ctx, ctx_dst);
+    output_cstring(ctx, "_converters[] = {\n");
+    for (U32 i = 0; i < struct_count_dst; i++) {
+      if (!supported.pointer[i]) {
+        continue;
+      }
+      auto struct_index_src = g->struct_indices_src.pointer[i];
+      output_cstring(ctx, "  {\n");
+      output_cstring(ctx, "    /*.schema_content_hash_src =*/ ");
+      output_prefix(ctx, ctx_dst);
+      output_cstring(ctx, "_schema_content_hash_src,\n");
+      output_cstring(ctx, "    /*.schema_content_hash_dst =*/ ");
+      output_prefix(ctx, ctx_dst);
+      output_cstring(ctx, "_schema_content_hash_dst,\n");
+      output_cstring(ctx, "    /*.entry_struct_id =*/ 0x");
+      output_hexadecimal(ctx, g->structs_dst.pointer[i].typeId);
+      output_cstring(ctx, "ull,\n");
+      output_cstring(ctx, "    /*.schema_src =*/ ");
+      output_prefix(ctx, ctx_dst);
+      output_cstring(ctx, "_schema_src,\n");
+      output_cstring(ctx, "    /*.schema_length_src =*/ ");
+      output_decimal(ctx, schema_src.count);
+      output_cstring(ctx, ",\n");
+      output_cstring(ctx, "    /*.entry_struct_size_src =*/ ");
+      output_decimal(ctx, g->structs_src.pointer[struct_index_src].size);
+      output_cstring(ctx, ",\n");
+      output_cstring(ctx, "    /*.entry_struct_size_dst =*/ ");
+      output_decimal(ctx, g->structs_dst.pointer[i].size);
+      output_cstring(ctx, ",\n");
+      output_cstring(ctx, "    /*.convert_entry =*/ ");
+      output_function_name(g, i);
+      output_cstring(ctx, ",\n");
+      output_cstring(ctx, "  },\n");
+    }
+    output_cstring(ctx, "};\n\n");
+
+    output_cstring(ctx, "#endif // ");
+    output_prefix(ctx, ctx_dst);
+    output_cstring(ctx, "_BINARY_INCLUDED_H\n");
+    output_cstring(ctx, "#endif // defined(SVF_INCLUDE_BINARY_SCHEMA) || defined(SVF_IMPLEMENTATION)\n");
+    output_cstring(ctx, "\n");
+  }
+
+  output_cstring(ctx, "#ifdef __cplusplus\n");
+  output_cstring(ctx, "} // extern \"C\"\n");
+  output_cstring(ctx, "#endif\n");
+
+  output_cstring(ctx, "\n");
+  output_cstring(ctx, "#endif // ");
+  output_prefix(ctx, ctx_dst);
+  output_cstring(ctx, "_H\n");
+
+  auto end = arena->reserved_range.pointer + arena->waterline;
+  return {
+    .pointer = (Byte *) start,
+    .count = offset_between<U64>(start, end),
+  };
+}
+
+} // namespace output::conversion
@@ -111,7 +111,7 @@ void output_type(Ctx ctx, Meta::Type_tag in_tag, Meta::Type_payload *in_payload)
       break;
     }
     case Meta::Type_tag::reference: {
-      output_cstring(ctx, "runtime::Reference<");
+      output_cstring(ctx, ctx->wide ? "runtime::Reference64<" : "runtime::Reference<");
       output_concrete_type_name(
         ctx,
         in_payload->concrete.type_tag,
@@ -121,7 +121,17 @@ void output_type(Ctx ctx, Meta::Type_tag in_tag, Meta::Type_payload *in_payload)
       break;
     }
     case Meta::Type_tag::sequence: {
-      output_cstring(ctx, "runtime::Sequence<");
+      output_cstring(ctx, ctx->wide ? "runtime::Sequence64<" : "runtime::Sequence<");
+      output_concrete_type_name(
+        ctx,
+        in_payload->concrete.type_tag,
+        &in_payload->concrete.type_payload
+      );
+      output_cstring(ctx, ">");
+      break;
+    }
+    case Meta::Type_tag::chunkedSequence: {
+      output_cstring(ctx, "runtime::ChunkedSequence<");
       output_concrete_type_name(
         ctx,
         in_payload->concrete.type_tag,
@@ -144,27 +154,34 @@ Bool output_struct(Ctx ctx, Meta::StructDefinition *it) {
   output_name(ctx, it->typeId);
   output_cstring(ctx, " {\n");
 
+  // See #natural-alignment.
   UInt size_sum = 0;
+  UInt alignment_max = 1;
   auto fields = to_range(ctx->schema_bytes, it->fields);
 
 
   for (UInt i = 0; i < fields.count; i++) {
     auto field = fields.pointer + i;
 
-    // We don't support custom struct layouts yet.
-    if (field->offset != size_sum) {
-      return false;
-    }
-
     auto plurality = get_plurality(
       structs,
       choices,
       field->type_tag,
-      &field->type_payload
+      &field->type_payload,
+      ctx->wide
     );
 
-    // TODO @proper-alignment: align up first.
-    size_sum += plurality.size;
+    // We don't support custom struct layouts yet.
+    if (field->offset != get_natural_offset(size_sum, plurality)) {
+      return false;
+    }
+
+    // Only needed in front of a choice, otherwise the compiler would add the
+    // same padding anyway.
+    output_padding(ctx, size_sum, field->offset);
+
+    size_sum = field->offset + plurality.size;
+    alignment_max = maxi(alignment_max, plurality.alignment);
 
     switch (plurality.plurality) {
       case TypePlurality::zero: {
@@ -208,7 +225,8 @@ Bool output_struct(Ctx ctx, Meta::StructDefinition *it) {
     }
   }
 
-  if (size_sum != it->size) {
+  // The compiler adds the padding at the end.
+  if (alignment_max != it->alignment || align_up(size_sum, alignment_max) != it->size) {
     return false;
   }
 
@@ -227,6 +245,7 @@ Bool output_choice(Ctx ctx, Meta::ChoiceDefinition *it) {
 
   auto options = to_range(ctx->schema_bytes, it->options);
   UInt size_max = 0;
+  UInt alignment_max = 1;
 
   output_cstring(ctx, "  nothing = 0,\n");
 
@@ -250,9 +269,11 @@ Bool output_choice(Ctx ctx, Meta::ChoiceDefinition *it) {
       structs,
       choices,
       option->type_tag,
-      &option->type_payload
+      &option->type_payload,
+      ctx->wide
     );
     size_max = maxi(size_max, plurality.size);
+    alignment_max = maxi(alignment_max, plurality.alignment);
 
     if (plurality.plurality == TypePlurality::zero) {
       continue;
@@ -268,7 +289,8 @@ Bool output_choice(Ctx ctx, Meta::ChoiceDefinition *it) {
     output_cstring(ctx, ";\n");
   }
 
-  if (size_max != it->payloadSize) {
+  // Same as above, the compiler adds the padding at the end.
+  if (alignment_max != it->payloadAlignment || align_up(size_max, alignment_max) != it->payloadSize) {
     return false;
   }
 
@@ -276,6 +298,85 @@ Bool output_choice(Ctx ctx, Meta::ChoiceDefinition *it) {
   return true;
 }
 
+// Typed offsets of the fields, for #lazy-view in the runtime.
+void output_struct_fields(Ctx ctx, Meta::StructDefinition *it) {
+  auto structs = to_range(ctx->schema_bytes, ctx->schema_definition->structs);
+  auto choices = to_range(ctx->schema_bytes, ctx->schema_definition->choices);
+
+  output_cstring(ctx, "namespace ");
+  output_name(ctx, it->typeId);
+  output_cstring(ctx, "_fields {\n");
+
+  auto fields = to_range(ctx->schema_bytes, it->fields);
+  for (UInt i = 0; i < fields.count; i++) {
+    auto field = fields.pointer + i;
+
+    auto plurality = get_plurality(
+      structs,
+      choices,
+      field->type_tag,
+      &field->type_payload,
+      ctx->wide
+    );
+
+    switch (plurality.plurality) {
+      case TypePlurality::zero: {
+        continue;
+      }
+      case TypePlurality::one: {
+        output_cstring(ctx, "  constexpr runtime::Field<");
+        output_name(ctx, it->typeId);
+        output_cstring(ctx, ", ");
+        output_type(ctx, field->type_tag, &field->type_payload);
+        output_cstring(ctx, "> ");
+        output_name(ctx, field->fieldId);
+        output_cstring(ctx, " = { ");
+        output_decimal(ctx, field->offset);
+        output_cstring(ctx, " };\n");
+        break;
+      }
+      case TypePlurality::tag_and_payload: {
+        // Checked in `output_struct`.
+        output_cstring(ctx, "  constexpr runtime::Field<");
+        output_name(ctx, it->typeId);
+        output_cstring(ctx, ", ");
+        output_concrete_type_name(
+          ctx,
+          field->type_payload.concrete.type_tag,
+          &field->type_payload.concrete.type_payload
+        );
+        output_cstring(ctx, "_tag> ");
+        output_name(ctx, field->fieldId);
+        output_cstring(ctx, "_tag = { ");
+        output_decimal(ctx, field->offset);
+        output_cstring(ctx, " };\n");
+
+        output_cstring(ctx, "  constexpr runtime::Field<");
+        output_name(ctx, it->typeId);
+        output_cstring(ctx, ", ");
+        output_concrete_type_name(
+          ctx,
+          field->type_payload.concrete.type_tag,
+          &field->type_payload.concrete.type_payload
+        );
+        output_cstring(ctx, "_payload> ");
+        output_name(ctx, field->fieldId);
+        output_cstring(ctx, "_payload = { ");
+        output_decimal(ctx, (U64) field->offset + SVFRT_TAG_SIZE);
+        output_cstring(ctx, " };\n");
+        break;
+      }
+      default: {
+        UNREACHABLE;
+      }
+    }
+  }
+
+  output_cstring(ctx, "} // namespace ");
+  output_name(ctx, it->typeId);
+  output_cstring(ctx, "_fields\n\n");
+}
+
 char const *header = R"(// AUTOGENERATED by svfc.
 #pragma once
 #include <cstdint>
@@ -285,7 +386,6 @@ namespace svf {
 
 #ifndef SVF_COMMON_CPP_TYPES_INCLUDED
 #define SVF_COMMON_CPP_TYPES_INCLUDED
-#pragma pack(push, 1)
 namespace runtime {
 
 template<typename T>
@@ -301,31 +401,64 @@ struct Sequence {
 
 template<typename T> struct GetSchemaFromType;
 
+// A field of struct `S` with type `M`, by its offset. See #lazy-view.
+template<typename S, typename M>
+struct Field {
+  uint32_t offset;
+};
+
 } // namespace runtime
-#pragma pack(pop)
 #endif // SVF_COMMON_CPP_TYPES_INCLUDED
 
 )";
 
+// Only for schemas with a #wide directive.
+char const *wide_types = R"(#ifndef SVF_WIDE_CPP_TYPES_INCLUDED
+#define SVF_WIDE_CPP_TYPES_INCLUDED
+namespace runtime {
+
+template<typename T>
+struct Reference64 {
+  uint64_t data_offset_complement;
+};
+
+template<typename T>
+struct Sequence64 {
+  uint64_t data_offset_complement;
+  uint64_t count;
+};
+
+} // namespace runtime
+#endif // SVF_WIDE_CPP_TYPES_INCLUDED
+
+)";
+
+// Only for schemas with chunked sequences.
+char const *chunked_types = R"(#ifndef SVF_CHUNKED_CPP_TYPES_INCLUDED
+#define SVF_CHUNKED_CPP_TYPES_INCLUDED
+namespace runtime {
+
+template<typename T>
+struct ChunkedSequence {
+  uint32_t data_offset_complement;
+  uint32_t count;
+};
+
+} // namespace runtime
+#endif // SVF_CHUNKED_CPP_TYPES_INCLUDED
+
+)";
+
 Bytes as_code(
   vm::LinearArena *arena,
   Bytes schema_bytes,
   Bytes appendix_bytes,
-  validation::Result *validation_result
+  validation::Result *validation_result,
+  Bool wide
 ) {
-  // TODO @proper-alignment: struct access.
-  auto schema_definition = (Meta::SchemaDefinition *) (
-    schema_bytes.pointer +
-    schema_bytes.count -
-    sizeof(Meta::SchemaDefinition)
-  );
-
-  // TODO @proper-alignment: struct access.
-  auto appendix = (Meta::Appendix *) (
-    appendix_bytes.pointer +
-    appendix_bytes.count -
-    sizeof(Meta::Appendix)
-  );
+  auto schema_definition = get_last_struct<Meta::SchemaDefinition>(schema_bytes);
+
+  auto appendix = get_last_struct<Meta::Appendix>(appendix_bytes);
 
   auto start = vm::realign(arena);
   OutputContext context_value = {
@@ -334,6 +467,7 @@ Bytes as_code(
     .schema_bytes = schema_bytes,
     .appendix = appendix,
     .appendix_bytes = appendix_bytes,
+    .wide = wide,
   };
 
   auto ctx = &context_value;
@@ -341,12 +475,17 @@ Bytes as_code(
   auto choices = to_range(schema_bytes, schema_definition->choices);
 
   output_cstring(ctx, header);
+  if (ctx->wide) {
+    output_cstring(ctx, wide_types);
+  }
+  if (uses_chunked_sequences(schema_bytes)) {
+    output_cstring(ctx, chunked_types);
+  }
 
   output_cstring(ctx, "namespace ");
   output_name(ctx, schema_definition->schemaId);
   output_cstring(ctx, " {\n");
 
-  output_cstring(ctx, "#pragma pack(push, 1)\n");
   output_cstring(ctx, "\n");
 
   output_cstring(ctx, "extern uint32_t const struct_strides[];\n");
@@ -404,7 +543,10 @@ Bytes as_code(
     }
   }
 
-  output_cstring(ctx, "#pragma pack(pop)\n\n");
+  output_cstring(ctx, "// Fields of structs, see #lazy-view.\n");
+  for (UInt i = 0; i < structs.count; i++) {
+    output_struct_fields(ctx, structs.pointer + i);
+  }
 
   output_cstring(ctx, "// C++ trickery: _SchemaDescription.\n");
   output_cstring(ctx, R"(struct _SchemaDescription {
@@ -505,7 +647,9 @@ Bytes as_code(
   output_cstring(ctx, "namespace binary {\n");
   output_cstring(ctx, "\n");
 
-  output_cstring(ctx, "uint8_t const array[] = {\n");
+  // Read in place, so aligned the same way as the message parts, see
+  // #natural-alignment.
+  output_cstring(ctx, "alignas(8) uint8_t const array[] = {\n");
   output_raw_bytes(ctx, schema_bytes);
   output_cstring(ctx, "};\n");
 
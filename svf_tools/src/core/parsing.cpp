@@ -380,6 +380,20 @@ Type parse_type_reference(Ctx ctx) {
   } else if (byte == '[') {
     ctx->state.cursor++;
     skip_whitespace(ctx);
+
+    // `T[~]` is a chunked sequence, see #chunked-sequences in the runtime.
+    if (peek_byte(ctx) == '~') {
+      ctx->state.cursor++;
+      skip_whitespace(ctx);
+      skip_specific_character(ctx, ']', FailCode::expected_closing_square_bracket);
+      return {
+        .which = Type::Which::chunked_sequence,
+        .chunked_sequence = {
+          .element_type = concrete_type,
+        },
+      };
+    }
+
     skip_specific_character(ctx, ']', FailCode::expected_closing_square_bracket);
     return {
       .which = Type::Which::sequence,
@@ -767,6 +781,18 @@ Range<U8> parse_directive_name(Ctx ctx) {
   return result;
 }
 
+// Parse an optional #wide directive. Does nothing, if there is none.
+Bool parse_directive_wide(Ctx ctx) {
+  auto saved_state = ctx->state;
+  skip_specific_cstring(ctx, "#wide", FailCode::backtrack);
+  if (ctx->state.fail.code != FailCode::ok) {
+    ctx->state = saved_state;
+    return false;
+  }
+  skip_whitespace_and_exactly_one_newline(ctx);
+  return true;
+}
+
 // Parse the whole schema.
 ParseResult parse_input(vm::LinearArena *arena, Range<U8> input) {
   ParserContext ctx_ = {
@@ -781,6 +807,10 @@ ParseResult parse_input(vm::LinearArena *arena, Range<U8> input) {
   auto schema_name = parse_directive_name(ctx);
   skip_whitespace(ctx);
 
+  // #wide directive may follow.
+  auto wide = parse_directive_wide(ctx);
+  skip_whitespace(ctx);
+
   while (true) {
     // Stop parsing if we have encountered an error.
     if (ctx->state.fail.code != FailCode::ok) {
@@ -802,6 +832,7 @@ ParseResult parse_input(vm::LinearArena *arena, Range<U8> input) {
   *root = {
     .schema_name = schema_name,
     .schema_name_hash = hash64::from_name(schema_name),
+    .wide = wide,
     .definitions = {
       .pointer = ctx->state.top_level_definitions.pointer,
       .count = ctx->state.top_level_definitions.count,
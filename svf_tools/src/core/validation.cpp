@@ -38,12 +38,7 @@ Result validate(vm::LinearArena *arena, Bytes schema_bytes) {
 
   ASSERT(schema_bytes.count >= sizeof(Meta::SchemaDefinition));
 
-  // TODO @proper-alignment: struct access.
-  auto schema_definition = (Meta::SchemaDefinition *) (
-    schema_bytes.pointer +
-    schema_bytes.count -
-    sizeof(Meta::SchemaDefinition)
-  );
+  auto schema_definition = get_last_struct<Meta::SchemaDefinition>(schema_bytes);
 
   auto structs = to_range(schema_bytes, schema_definition->structs);
   auto choices = to_range(schema_bytes, schema_definition->choices);
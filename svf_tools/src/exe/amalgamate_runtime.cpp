@@ -86,6 +86,15 @@ int main(int argc, char *argv[]) {
 
   include_file(ctx, "svf_compatibility.c");
   include_file(ctx, "svf_conversion.c");
+  include_file(ctx, "svf_cache.c");
+  include_file(ctx, "svf_registry.c");
+  include_file(ctx, "svf_verify.c");
+  include_file(ctx, "svf_archive.c");
+  include_file(ctx, "svf_shard.c");
+  include_file(ctx, "svf_copy.c");
+  include_file(ctx, "svf_patch.c");
+  include_file(ctx, "svf_intern.c");
+  include_file(ctx, "svf_view.c");
   include_file(ctx, "svf_internal.c");
   include_file(ctx, "svf_runtime.c");
 
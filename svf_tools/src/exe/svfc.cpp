@@ -6,6 +6,7 @@
 #include <src/svf_runtime.hpp>
 #include <src/svf_stdio.h>
 #include "../core.hpp"
+#include "../core/common.hpp"
 
 struct CommandLineOptions {
   enum class Subcommand {
@@ -13,10 +14,13 @@ struct CommandLineOptions {
     c,
     cpp,
     binary,
+    registry,
+    convert_gen,
   };
 
   Subcommand subcommand;
   Range<U8> input_file_path; // Empty, if stdin.
+  Range<U8> input_dst_file_path; // Only for `convert-gen`.
   Range<U8> output_file_path; // Empty, if stdin.
 };
 
@@ -35,7 +39,7 @@ CommandLineOptions parse_command_line_options(Range<U8 *> args) {
   CommandLineOptions result = {};
 
   if (args.count < 2) {
-    printf("Error: expected subcommand (\"c\", \"cpp\", or \"binary\").\n");
+    printf("Error: expected subcommand (\"c\", \"cpp\", \"binary\", \"registry\", or \"convert-gen\").\n");
     return result;
   }
 
@@ -68,6 +72,31 @@ CommandLineOptions parse_command_line_options(Range<U8 *> args) {
       return result;
     }
     result.subcommand = CommandLineOptions::Subcommand::binary;
+  } else if (strcmp(subcommand_cstr, "registry") == 0) {
+    if (args.count != 4) {
+      printf("Error: expected input/registry file paths.\n");
+      return result;
+    }
+    result.input_file_path = parse_filename(args.pointer[2]);
+    result.output_file_path = parse_filename(args.pointer[3]);
+    if (!result.output_file_path.pointer) {
+      printf("Using stdout as the registry is not allowed for `registry` subcommand.\n");
+      return result;
+    }
+    result.subcommand = CommandLineOptions::Subcommand::registry;
+  } else if (strcmp(subcommand_cstr, "convert-gen") == 0) {
+    if (args.count != 5) {
+      printf("Error: expected old/new input file paths and output file path.\n");
+      return result;
+    }
+    result.input_file_path = parse_filename(args.pointer[2]);
+    result.input_dst_file_path = parse_filename(args.pointer[3]);
+    result.output_file_path = parse_filename(args.pointer[4]);
+    if (!result.input_file_path.pointer || !result.input_dst_file_path.pointer) {
+      printf("Reading from stdin is not allowed for `convert-gen` subcommand.\n");
+      return result;
+    }
+    result.subcommand = CommandLineOptions::Subcommand::convert_gen;
   } else {
     printf("Error: unknown subcommand '%s'.\n", subcommand_cstr);
     return result;
@@ -127,39 +156,162 @@ TextLocation get_text_location(Range<U8> text, UInt cursor) {
   };
 }
 
-int main(int argc, char *argv[]) {
-  auto options = parse_command_line_options({
-    .pointer = (U8 **) argv,
-    .count = safe_int_cast<U64>(argc),
-  });
+// Append a schema, as written by the `binary` subcommand, to a registry file,
+// creating it if needed. See #schema-registry.
+int append_to_registry(vm::LinearArena *arena, Bytes input, Range<U8> registry_file_path) {
+  // The input is a message of the meta-schema, with the schema as its data.
+  SVFRT_MessageHeader header;
+  if (input.count < sizeof(header)) {
+    printf("Error: input is too small.\n");
+    return 1;
+  }
+  memcpy(&header, input.pointer, sizeof(header));
 
-  if (options.subcommand == CommandLineOptions::Subcommand::unknown) {
-    // Already printed the message, just return.
+  if (0
+    || header.magic[0] != 'S'
+    || header.magic[1] != 'V'
+    || header.magic[2] != 'F'
+    || header.version != 0
+    || header.entry_struct_id != svf::Meta::SchemaDefinition_type_id
+  ) {
+    printf("Error: input is not an output of the `binary` subcommand.\n");
     return 1;
   }
 
-  auto arena_value = vm::create_linear_arena(1ull << 30);
-  auto arena2_value = vm::create_linear_arena(1ull << 30);
-  // never free, we will just exit the program.
+  auto alignment = svf::runtime::MESSAGE_PART_ALIGNMENT;
+  U64 data_offset = sizeof(header) + U64(header.schema_length);
+  data_offset = (data_offset + alignment - 1) / alignment * alignment;
+  data_offset += U64(header.appendix_length);
+  data_offset = (data_offset + alignment - 1) / alignment * alignment;
+  if (data_offset > input.count) {
+    printf("Error: input is malformed.\n");
+    return 1;
+  }
 
-  auto arena = &arena_value;
-  auto arena2 = &arena2_value;
-  if (!arena->reserved_range.pointer || !arena2->reserved_range.pointer) {
-    printf("Error: could not create main memory arenas.\n");
+  // Copy, to make sure the schema is aligned.
+  vm::realign(arena);
+  auto schema = vm::many<U8>(arena, input.count - data_offset);
+  range_copy(schema, range_subrange(input, data_offset, input.count - data_offset));
+
+  auto validation_result = core::validation::validate(arena, schema);
+  if (!validation_result.valid) {
+    printf("Error: input schema is not valid.\n");
+    return 1;
+  }
+
+  auto schema_content_hash = core::get_content_hash(schema);
+
+  // Read the existing registry, if there is one.
+  auto registry_path = (char const *) registry_file_path.pointer;
+  auto existing = Bytes {
+    .pointer = (U8 *) vm::realign(arena),
+    .count = 0,
+  };
+  auto registry_file = fopen(registry_path, "rb");
+  if (registry_file) {
+    while (!feof(registry_file)) {
+      auto chunk = vm::many<U8>(arena, 1024);
+      existing.count += fread(chunk.pointer, 1, 1024, registry_file);
+
+      if (ferror(registry_file)) {
+        printf("Error: failed to read registry.\n");
+        return 1;
+      }
+    }
+    fclose(registry_file);
+  }
+
+  auto schema_count = U32(0);
+  SVFRT_SchemaRegistry registry = {};
+  if (existing.count != 0) {
+    auto error_code = SVFRT_schema_registry_open(
+      &registry,
+      { existing.pointer, safe_int_cast<U32>(existing.count) }
+    );
+    if (error_code != 0) {
+      printf("Error: could not open registry. Code 0x%x\n", int(error_code));
+      return 1;
+    }
+    schema_count = registry.entry_count;
+  }
+
+  auto lookup = SVFRT_schema_registry_lookup(&registry, schema_content_hash);
+  if (lookup.pointer) {
+    // Already there, nothing to do.
+    return 0;
+  }
+
+  auto schemas = vm::many<SVFRT_Bytes>(arena, schema_count + 1);
+  auto hashes = vm::many<U64>(arena, schema_count + 1);
+  auto count = U32(0);
+  for (U32 i = 0; i < registry.slot_count; i++) {
+    auto slot = registry.slots + i;
+    if (slot->schema_offset == 0) {
+      continue;
+    }
+    schemas.pointer[count] = { registry.file.pointer + slot->schema_offset, slot->schema_length };
+    hashes.pointer[count] = slot->schema_content_hash;
+    count++;
+  }
+  ASSERT(count == schema_count);
+  schemas.pointer[count] = { schema.pointer, safe_int_cast<U32>(schema.count) };
+  hashes.pointer[count] = schema_content_hash;
+  count++;
+
+  SVFRT_ErrorCode error_code = 0;
+  auto size = SVFRT_schema_registry_write(schemas.pointer, hashes.pointer, count, {}, &error_code);
+  if (error_code != SVFRT_code_registry__buffer_too_small) {
+    printf("Error: could not write registry. Code 0x%x\n", int(error_code));
+    return 1;
+  }
+  auto output = vm::many<U8>(arena, size);
+  SVFRT_schema_registry_write(schemas.pointer, hashes.pointer, count, { output.pointer, size }, &error_code);
+  if (error_code != 0) {
+    printf("Error: could not write registry. Code 0x%x\n", int(error_code));
     return 1;
   }
 
+  // Readers may have the old file mapped, so replace it instead of overwriting.
+  auto temporary_path = vm::many<char>(arena, registry_file_path.count + 5);
+  memcpy(temporary_path.pointer, registry_path, registry_file_path.count);
+  memcpy(temporary_path.pointer + registry_file_path.count, ".tmp", 5);
+
+  auto output_file = fopen(temporary_path.pointer, "wb");
+  if (!output_file) {
+    printf("Error: could not open output file.\n");
+    return 1;
+  }
+  auto result = fwrite(output.pointer, 1, output.count, output_file);
+  if (fclose(output_file) != 0 || result != output.count) {
+    printf("Error: failed to write output.\n");
+    return 1;
+  }
+
+  if (rename(temporary_path.pointer, registry_path) != 0) {
+    // Windows does not replace existing files on `rename`.
+    remove(registry_path);
+    if (rename(temporary_path.pointer, registry_path) != 0) {
+      printf("Error: could not replace the registry file.\n");
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+// Read the whole file (or stdin, if the path is empty) into the arena.
+Bool read_input(vm::LinearArena *arena, Range<U8> input_file_path, Bytes *out_input) {
   auto input_file = stdin;
-  if (options.input_file_path.pointer) {
-    input_file = fopen((char const *) options.input_file_path.pointer, "rb");
+  if (input_file_path.pointer) {
+    input_file = fopen((char const *) input_file_path.pointer, "rb");
   }
 
   if (!input_file) {
     printf("Error: could not open input file.\n");
-    return 1;
+    return false;
   }
 
-  auto input = Bytes {
+  Bytes input = {
     .pointer = (U8 *) vm::realign(arena),
     .count = 0,
   };
@@ -170,7 +322,7 @@ int main(int argc, char *argv[]) {
 
     if (ferror(input_file)) {
       printf("Error: failed to read input.\n");
-      return 1;
+      return false;
     }
   }
 
@@ -178,6 +330,17 @@ int main(int argc, char *argv[]) {
     fclose(input_file);
   }
 
+  *out_input = input;
+  return true;
+}
+
+// Parse and generate the schema, printing the error on failure.
+core::generation::GenerationResult generate_or_print_error(
+  vm::LinearArena *arena,
+  vm::LinearArena *arena2,
+  Bytes input,
+  core::grammar::Root **out_root
+) {
   auto parse_result = core::parsing::parse_input(arena, input);
   if (!parse_result.root) {
     auto description = core::parsing::get_fail_code_description(parse_result.fail.code);
@@ -209,7 +372,7 @@ int main(int argc, char *argv[]) {
       );
     }
 
-    return 1;
+    return {};
   }
 
   auto generation_result = core::generation::as_bytes(parse_result.root, arena, arena2);
@@ -224,9 +387,112 @@ int main(int argc, char *argv[]) {
     // - `name_collision`: the offending names.
 
     printf("Error: could not generate schema. Code 0x%x\n", int(generation_result.fail_code));
+    return {};
+  }
+
+  *out_root = parse_result.root;
+  return generation_result;
+}
+
+// Output the generated conversions from the schema in `input_file_path` to
+// the one in `input_dst_file_path`.
+int convert_gen(
+  vm::LinearArena *arena,
+  vm::LinearArena *arena2,
+  core::grammar::Root *root_src,
+  core::generation::GenerationResult generation_src,
+  CommandLineOptions const &options
+) {
+  Bytes input_dst = {};
+  if (!read_input(arena, options.input_dst_file_path, &input_dst)) {
+    return 1;
+  }
+
+  core::grammar::Root *root_dst = NULL;
+  auto generation_dst = generate_or_print_error(arena, arena2, input_dst, &root_dst);
+  if (!generation_dst.schema.pointer) {
+    return 1;
+  }
+
+  if (root_src->wide || root_dst->wide) {
+    printf("Error: conversions for wide schemas are not supported.\n");
+    return 1;
+  }
+
+  auto output_range = core::output::conversion::as_code(
+    arena,
+    arena2,
+    generation_src.schema,
+    generation_src.appendix,
+    generation_dst.schema,
+    generation_dst.appendix
+  );
+  if (!output_range.pointer) {
+    printf("Error: could not generate the conversions.\n");
+    return 1;
+  }
+
+  auto output_file = stdout;
+  if (options.output_file_path.pointer) {
+    output_file = fopen((char const *) options.output_file_path.pointer, "wb");
+  }
+
+  if (!output_file) {
+    printf("Error: could not open output file.\n");
+    return 1;
+  }
+
+  auto result = fwrite(output_range.pointer, 1, output_range.count, output_file);
+  if (result != output_range.count) {
+    printf("Error: failed to write output.\n");
     return 1;
   }
 
+  fclose(output_file);
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  auto options = parse_command_line_options({
+    .pointer = (U8 **) argv,
+    .count = safe_int_cast<U64>(argc),
+  });
+
+  if (options.subcommand == CommandLineOptions::Subcommand::unknown) {
+    // Already printed the message, just return.
+    return 1;
+  }
+
+  auto arena_value = vm::create_linear_arena(1ull << 30);
+  auto arena2_value = vm::create_linear_arena(1ull << 30);
+  // never free, we will just exit the program.
+
+  auto arena = &arena_value;
+  auto arena2 = &arena2_value;
+  if (!arena->reserved_range.pointer || !arena2->reserved_range.pointer) {
+    printf("Error: could not create main memory arenas.\n");
+    return 1;
+  }
+
+  Bytes input = {};
+  if (!read_input(arena, options.input_file_path, &input)) {
+    return 1;
+  }
+
+  if (options.subcommand == CommandLineOptions::Subcommand::registry) {
+    return append_to_registry(arena, input, options.output_file_path);
+  }
+
+  core::grammar::Root *root = NULL;
+  auto generation_result = generate_or_print_error(arena, arena2, input, &root);
+  if (!generation_result.schema.pointer) {
+    return 1;
+  }
+
+  if (options.subcommand == CommandLineOptions::Subcommand::convert_gen) {
+    return convert_gen(arena, arena2, root, generation_result, options);
+  }
+
   auto schema = generation_result.schema;
   auto appendix = generation_result.appendix;
 
@@ -257,14 +523,16 @@ int main(int argc, char *argv[]) {
         arena,
         schema,
         appendix,
-        &validation_result
+        &validation_result,
+        root->wide
       );
     } else {
       output_range = core::output::c::as_code(
         arena,
         schema,
         appendix,
-        &validation_result
+        &validation_result,
+        root->wide
       );
     }
 
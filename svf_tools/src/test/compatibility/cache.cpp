@@ -0,0 +1,242 @@
+#define SVF_INCLUDE_BINARY_SCHEMA
+#include <src/svf_internal.h>
+#include "common.hpp"
+
+int main(int /*argc*/, char */*argv*/[]) {
+  auto arena_value = vm::create_linear_arena(1ull << 20);
+  auto arena = &arena_value;
+  auto schema_dst = prepare_schema(arena, 0);
+
+  U8 scratch_buffer[256];
+  SVFRT_Bytes scratch = { .pointer = scratch_buffer, .count = sizeof(scratch_buffer) };
+  SVFRT_Bytes no_scratch = { .pointer = 0, .count = 0 };
+
+  alignas(8) U8 cache_buffer[4096];
+  SVFRT_CompatibilityCache cache = {};
+
+  SVFRT_ReadMessageParams default_read_params = {};
+  default_read_params.expected_schema_content_hash = schema_dst.schema_content_hash;
+  default_read_params.expected_schema_struct_strides = schema_dst.struct_strides;
+  default_read_params.expected_schema = schema_dst.schema;
+  default_read_params.required_level = SVFRT_compatibility_binary;
+  default_read_params.entry_struct_id = schema_dst.entry_struct_id;
+  default_read_params.entry_struct_index = 0;
+  default_read_params.max_schema_work = UINT32_MAX;
+  default_read_params.max_recursion_depth = SVFRT_DEFAULT_MAX_RECURSION_DEPTH;
+  default_read_params.max_output_size = SVFRT_NO_SIZE_LIMIT;
+  default_read_params.allocator_fn = allocate_arena;
+  default_read_params.allocator_ptr = arena;
+  default_read_params.compatibility_cache = &cache;
+
+  // Fail, when the slot count is not a power of two.
+  {
+    SVFRT_ErrorCode error_code = SVFRT_compatibility_cache_init(&cache, { cache_buffer, sizeof(cache_buffer) }, 3);
+    ASSERT(error_code == SVFRT_code_cache__invalid_slot_count);
+  }
+
+  // Fail, when the memory can't hold the slots.
+  {
+    SVFRT_ErrorCode error_code = SVFRT_compatibility_cache_init(&cache, { cache_buffer, 16 }, 4);
+    ASSERT(error_code == SVFRT_code_cache__not_enough_memory);
+  }
+
+  // Success.
+  {
+    SVFRT_ErrorCode error_code = SVFRT_compatibility_cache_init(&cache, { cache_buffer, sizeof(cache_buffer) }, 16);
+    ASSERT(error_code == 0);
+  }
+
+  // Success, when the result is cached: the second read does not need scratch memory.
+  {
+    PreparedSchemaParams prepare_params = { .extra_fields = 1 };
+    auto schema_src = prepare_schema(arena, &prepare_params);
+    SVFRT_Bytes message = prepare_message(arena, &schema_src);
+    SVFRT_ReadMessageResult read_result = {};
+    SVFRT_read_message(&default_read_params, &read_result, message, no_scratch);
+    ASSERT(read_result.error_code == SVFRT_code_compatibility__not_enough_scratch_memory);
+
+    SVFRT_read_message(&default_read_params, &read_result, message, scratch);
+    ASSERT(read_result.error_code == 0);
+    ASSERT(read_result.compatibility_level == SVFRT_compatibility_binary);
+
+    read_result = {};
+    SVFRT_read_message(&default_read_params, &read_result, message, no_scratch);
+    ASSERT(read_result.error_code == 0);
+    ASSERT(read_result.compatibility_level == SVFRT_compatibility_binary);
+    ASSERT(read_result.entry != 0);
+  }
+
+  // Fail, when the incompatibility is cached (negative cache).
+  {
+    PreparedSchemaParams prepare_params = { .change_type_tag = true };
+    auto schema_src = prepare_schema(arena, &prepare_params);
+    SVFRT_Bytes message = prepare_message(arena, &schema_src);
+    SVFRT_ReadMessageResult read_result = {};
+    SVFRT_read_message(&default_read_params, &read_result, message, scratch);
+    ASSERT(read_result.error_code == SVFRT_code_compatibility__type_mismatch);
+
+    read_result = {};
+    SVFRT_read_message(&default_read_params, &read_result, message, no_scratch);
+    ASSERT(read_result.error_code == SVFRT_code_compatibility__type_mismatch);
+  }
+
+  // Success, when logical compatibility is cached, and the conversion uses the cached result.
+  {
+    PreparedSchemaParams prepare_params = { .change_field_offsets = true };
+    auto schema_src = prepare_schema(arena, &prepare_params);
+    SVFRT_Bytes message = prepare_message(arena, &schema_src);
+    SVFRT_ReadMessageResult read_result = {};
+    SVFRT_ReadMessageParams read_params = default_read_params;
+    read_params.required_level = SVFRT_compatibility_logical;
+    SVFRT_read_message(&read_params, &read_result, message, scratch);
+    ASSERT(read_result.error_code == 0);
+    ASSERT(read_result.compatibility_level == SVFRT_compatibility_logical);
+
+    SVFRT_ReadMessageResult cached_read_result = {};
+    SVFRT_read_message(&read_params, &cached_read_result, message, no_scratch);
+    ASSERT(cached_read_result.error_code == 0);
+    ASSERT(cached_read_result.compatibility_level == SVFRT_compatibility_logical);
+    for (U32 i = 0; i < schema_dst.entry_stride; i++) {
+      ASSERT(((U8 *) read_result.entry)[i] == ((U8 *) cached_read_result.entry)[i]);
+    }
+  }
+
+  // Success, when a different schema was sent under the same hash: entries are
+  // only used for the exact same src-schema, so neither the negative entry of
+  // the forged schema, nor the positive entry of the real one, is used for the
+  // other.
+  {
+    PreparedSchemaParams real_params = { .extra_fields = 1, .change_field_offsets = true };
+    auto schema_real = prepare_schema(arena, &real_params);
+    PreparedSchemaParams forged_params = { .extra_fields = 1, .change_field_offsets = true, .change_type_tag = true };
+    auto schema_forged = prepare_schema(arena, &forged_params);
+    ASSERT(schema_forged.schema.count == schema_real.schema.count);
+    schema_forged.schema_content_hash = schema_real.schema_content_hash;
+
+    SVFRT_Bytes real_message = prepare_message(arena, &schema_real);
+    SVFRT_Bytes forged_message = prepare_message(arena, &schema_forged);
+    SVFRT_ReadMessageParams read_params = default_read_params;
+    read_params.required_level = SVFRT_compatibility_logical;
+
+    SVFRT_ReadMessageResult read_result = {};
+    SVFRT_read_message(&read_params, &read_result, forged_message, scratch);
+    ASSERT(read_result.error_code == SVFRT_code_compatibility__type_mismatch);
+
+    read_result = {};
+    SVFRT_read_message(&read_params, &read_result, real_message, no_scratch);
+    ASSERT(read_result.error_code == SVFRT_code_compatibility__not_enough_scratch_memory);
+
+    read_result = {};
+    SVFRT_read_message(&read_params, &read_result, real_message, scratch);
+    ASSERT(read_result.error_code == 0);
+    ASSERT(read_result.compatibility_level == SVFRT_compatibility_logical);
+
+    read_result = {};
+    SVFRT_read_message(&read_params, &read_result, real_message, no_scratch);
+    ASSERT(read_result.error_code == 0);
+    ASSERT(read_result.compatibility_level == SVFRT_compatibility_logical);
+
+    read_result = {};
+    SVFRT_read_message(&read_params, &read_result, forged_message, no_scratch);
+    ASSERT(read_result.error_code == SVFRT_code_compatibility__type_mismatch);
+  }
+
+  // Success, when a snapshot is restored into a fresh cache.
+  {
+    SVFRT_ErrorCode error_code = 0;
+    U32 snapshot_size = SVFRT_compatibility_cache_snapshot(&cache, { 0, 0 }, &error_code);
+    ASSERT(error_code == SVFRT_code_cache__snapshot_buffer_too_small);
+
+    auto snapshot = vm::many<U8>(arena, snapshot_size);
+    U32 written = SVFRT_compatibility_cache_snapshot(&cache, { snapshot.pointer, snapshot_size }, &error_code);
+    ASSERT(error_code == 0);
+    ASSERT(written == snapshot_size);
+
+    // Fail, when the snapshot is truncated.
+    alignas(8) U8 fresh_buffer[4096];
+    SVFRT_CompatibilityCache fresh_cache = {};
+    error_code = SVFRT_compatibility_cache_init(&fresh_cache, { fresh_buffer, sizeof(fresh_buffer) }, 16);
+    ASSERT(error_code == 0);
+    error_code = SVFRT_compatibility_cache_restore(&fresh_cache, { snapshot.pointer, snapshot_size - 1 });
+    ASSERT(error_code == SVFRT_code_cache__snapshot_malformed);
+
+    error_code = SVFRT_compatibility_cache_restore(&fresh_cache, { snapshot.pointer, snapshot_size });
+    ASSERT(error_code == 0);
+
+    PreparedSchemaParams prepare_params = { .extra_fields = 1 };
+    auto schema_src = prepare_schema(arena, &prepare_params);
+    SVFRT_Bytes message = prepare_message(arena, &schema_src);
+    SVFRT_ReadMessageResult read_result = {};
+    SVFRT_ReadMessageParams read_params = default_read_params;
+    read_params.compatibility_cache = &fresh_cache;
+    SVFRT_read_message(&read_params, &read_result, message, no_scratch);
+    ASSERT(read_result.error_code == 0);
+  }
+
+  // Fail, when the cache is full: this is not an error for reading.
+  {
+    alignas(8) U8 tiny_buffer[sizeof(SVFRT_CompatibilityCacheSlot)];
+    SVFRT_CompatibilityCache tiny_cache = {};
+    SVFRT_ErrorCode error_code = SVFRT_compatibility_cache_init(&tiny_cache, { tiny_buffer, sizeof(tiny_buffer) }, 1);
+    ASSERT(error_code == 0);
+
+    PreparedSchemaParams prepare_params = { .extra_fields = 1 };
+    auto schema_src = prepare_schema(arena, &prepare_params);
+    SVFRT_Bytes message = prepare_message(arena, &schema_src);
+    SVFRT_ReadMessageResult read_result = {};
+    SVFRT_ReadMessageParams read_params = default_read_params;
+    read_params.compatibility_cache = &tiny_cache;
+    SVFRT_read_message(&read_params, &read_result, message, scratch);
+    ASSERT(read_result.error_code == 0);
+
+    read_result = {};
+    SVFRT_read_message(&read_params, &read_result, message, no_scratch);
+    ASSERT(read_result.error_code == SVFRT_code_compatibility__not_enough_scratch_memory);
+  }
+
+  // Success, when the cache was filled up with negative entries, and then reset.
+  {
+    alignas(8) U8 small_buffer[1024];
+    SVFRT_CompatibilityCache small_cache = {};
+    SVFRT_ErrorCode error_code = SVFRT_compatibility_cache_init(&small_cache, { small_buffer, sizeof(small_buffer) }, 8);
+    ASSERT(error_code == 0);
+
+    SVFRT_ReadMessageParams read_params = default_read_params;
+    read_params.compatibility_cache = &small_cache;
+
+    // Each forged schema gets an entry of its own, until the storage runs out.
+    PreparedSchemaParams forged_params = { .change_type_tag = true };
+    for (U32 i = 0; i < 64; i++) {
+      forged_params.extra_fields = i;
+      auto schema_forged = prepare_schema(arena, &forged_params);
+      SVFRT_Bytes forged_message = prepare_message(arena, &schema_forged);
+      SVFRT_ReadMessageResult read_result = {};
+      SVFRT_read_message(&read_params, &read_result, forged_message, scratch);
+    }
+    ASSERT(small_cache.storage_used > small_cache.storage.count / 2);
+
+    PreparedSchemaParams prepare_params = { .extra_fields = 1 };
+    auto schema_src = prepare_schema(arena, &prepare_params);
+    SVFRT_Bytes message = prepare_message(arena, &schema_src);
+    SVFRT_ReadMessageResult read_result = {};
+    SVFRT_read_message(&read_params, &read_result, message, scratch);
+    ASSERT(read_result.error_code == 0);
+
+    read_result = {};
+    SVFRT_read_message(&read_params, &read_result, message, no_scratch);
+    ASSERT(read_result.error_code == SVFRT_code_compatibility__not_enough_scratch_memory);
+
+    SVFRT_compatibility_cache_reset(&small_cache);
+    ASSERT(small_cache.storage_used == 0);
+
+    read_result = {};
+    SVFRT_read_message(&read_params, &read_result, message, scratch);
+    ASSERT(read_result.error_code == 0);
+
+    read_result = {};
+    SVFRT_read_message(&read_params, &read_result, message, no_scratch);
+    ASSERT(read_result.error_code == 0);
+  }
+
+  return 0;
+}
@@ -9,6 +9,9 @@ U32 write_arena(void *it, SVFRT_Bytes src) {
 
 void *allocate_arena(void *it, size_t size) {
   auto arena = (vm::LinearArena *) it;
+
+  // See `SVFRT_AllocatorFn`.
+  vm::realign(arena, SVFRT_MESSAGE_PART_ALIGNMENT);
   return (void *) vm::many<U8>(arena, size).pointer;
 };
 
@@ -137,16 +140,19 @@ PreparedSchema prepare_schema(vm::LinearArena *arena, PreparedSchemaParams *para
           + sizeof(U64)
           + (4 + params->extra_fields + end_padding) * sizeof(U8)
       ),
+      .alignment = params->entry_alignment ? params->entry_alignment : 1,
       .fields = fields,
     },
     {
       .typeId = 0x5D01, // "SD" for "Struct Definition".
       .size = 1,
+      .alignment = 1,
       // TODO: valid fields should be here.
     },
     {
       .typeId = 0x5D02, // "SD" for "Struct Definition".
       .size = 1,
+      .alignment = 1,
       // TODO: valid fields should be here.
     },
   };
@@ -161,6 +167,7 @@ PreparedSchema prepare_schema(vm::LinearArena *arena, PreparedSchemaParams *para
     svf::Meta::StructDefinition extra_struct = {
       .typeId = 0x5D00 + i, // "SD" for "Struct Definition".,
       .size = 1,
+      .alignment = 1,
       // TODO: valid fields should be here.
     };
     svf::runtime::write_sequence_element(&ctx, &extra_struct, &structs);
@@ -221,11 +228,13 @@ PreparedSchema prepare_schema(vm::LinearArena *arena, PreparedSchemaParams *para
     {
       .typeId = 0xCD00, // "CD" for "Choice Definition".
       .payloadSize = 0,
+      .payloadAlignment = 1,
       .options = options,
     },
     {
       .typeId = 0xCD01, // "CD" for "Choice Definition".
       .payloadSize = 0,
+      .payloadAlignment = 1,
       .options = options,
     },
   };
@@ -37,6 +37,9 @@ struct PreparedSchemaParams {
   Bool extra_struct_end_padding;
   Bool different_struct_refs;
   Bool different_choice_refs;
+
+  // Of the entry struct. The layout here is packed, so zero means 1.
+  U32 entry_alignment;
 };
 
 PreparedSchema prepare_schema(vm::LinearArena *arena, PreparedSchemaParams *params);
@@ -173,6 +173,30 @@ int main(int /*argc*/, char */*argv*/[]) {
     ASSERT(read_result.error_code == SVFRT_code_compatibility__struct_size_mismatch);
   }
 
+  // Fail, when the src-struct size is not a multiple of the dst-struct alignment
+  // (and binary compatibility is required), see #natural-alignment.
+  {
+    PreparedSchemaParams prepare_params_dst = {
+      .no_struct_end_padding = true,
+      .entry_alignment = 4,
+    };
+    auto schema_aligned_dst = prepare_schema(arena, &prepare_params_dst);
+    SVFRT_Bytes message = prepare_message(arena, &schema_dst);
+    SVFRT_ReadMessageResult read_result = {};
+    SVFRT_ReadMessageParams read_params = default_read_params;
+    read_params.expected_schema_content_hash = schema_aligned_dst.schema_content_hash;
+    read_params.expected_schema_struct_strides = schema_aligned_dst.struct_strides;
+    read_params.expected_schema = schema_aligned_dst.schema;
+    SVFRT_read_message(&read_params, &read_result, message, scratch);
+    ASSERT(read_result.error_code == SVFRT_code_compatibility__struct_alignment_mismatch);
+
+    // Success, when only logical compatibility is required.
+    read_params.required_level = SVFRT_compatibility_logical;
+    read_result = {};
+    SVFRT_read_message(&read_params, &read_result, message, scratch);
+    ASSERT(read_result.error_code == 0);
+  }
+
   // Fail, when two fields that refer to different src-structs, match fields that
   // refer to the same dst-struct. See comment below.
   {
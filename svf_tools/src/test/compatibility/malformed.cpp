@@ -83,6 +83,26 @@ int main(int /*argc*/, char */*argv*/[]) {
     ASSERT(read_result.error_code == SVFRT_code_compatibility__invalid_choice_index);
   }
 
+  // Fail, when a struct alignment is not a power of two.
+  {
+    PreparedSchemaParams prepare_params = { .entry_alignment = 3 };
+    auto schema_src = prepare_schema(arena, &prepare_params);
+    SVFRT_Bytes message = prepare_message(arena, &schema_src);
+    SVFRT_ReadMessageResult read_result = {};
+    SVFRT_read_message(&default_read_params, &read_result, message, scratch);
+    ASSERT(read_result.error_code == SVFRT_code_compatibility__invalid_alignment);
+  }
+
+  // Fail, when a struct size is not a multiple of its alignment.
+  {
+    PreparedSchemaParams prepare_params = { .entry_alignment = 8 };
+    auto schema_src = prepare_schema(arena, &prepare_params);
+    SVFRT_Bytes message = prepare_message(arena, &schema_src);
+    SVFRT_ReadMessageResult read_result = {};
+    SVFRT_read_message(&default_read_params, &read_result, message, scratch);
+    ASSERT(read_result.error_code == SVFRT_code_compatibility__invalid_alignment);
+  }
+
   // Success for base case.
   {
     // Use identical schemas.
@@ -53,7 +53,7 @@ int main(int /*argc*/, char */*argv*/[]) {
 
   // Fail with too many fields.
   {
-    PreparedSchemaParams prepare_params = { .extra_fields = 100 };
+    PreparedSchemaParams prepare_params = { .extra_fields = 1000 };
     auto schema_src = prepare_schema(arena, &prepare_params);
     SVFRT_Bytes message = prepare_message(arena, &schema_src);
     SVFRT_ReadMessageResult read_result = {};
@@ -0,0 +1,224 @@
+#define SVF_INCLUDE_BINARY_SCHEMA
+#include <src/svf_runtime.hpp>
+#include "common.hpp"
+
+struct SpawnControl {
+  U32 spawn_count;
+  U32 task_count;
+};
+
+// Runs the tasks in reverse, to make sure the order does not matter.
+void spawn_reversed(void *spawn_ptr, SVFRT_TaskFn *task_fn, void *task_ptr, uint32_t task_count) {
+  auto control = (SpawnControl *) spawn_ptr;
+  control->spawn_count++;
+  for (U32 i = task_count; i > 0; i--) {
+    task_fn(task_ptr, i - 1);
+    control->task_count++;
+  }
+}
+
+static
+void assert_same_as_single(
+  SVFRT_ReadMessageParams *read_params,
+  SVFRT_ReadMessageResult *batch_result,
+  SVFRT_Bytes message,
+  SVFRT_Bytes scratch
+) {
+  SVFRT_ReadMessageParams single_params = *read_params;
+  single_params.compatibility_cache = NULL;
+  SVFRT_ReadMessageResult single_result = {};
+  SVFRT_read_message(&single_params, &single_result, message, scratch);
+
+  ASSERT(batch_result->error_code == single_result.error_code);
+  ASSERT(batch_result->compatibility_level == single_result.compatibility_level);
+  if (single_result.error_code == 0) {
+    auto batch_bytes = batch_result->context.data_range;
+    auto single_bytes = single_result.context.data_range;
+    ASSERT(batch_bytes.count == single_bytes.count);
+    for (U32 i = 0; i < single_bytes.count; i++) {
+      ASSERT(batch_bytes.pointer[i] == single_bytes.pointer[i]);
+    }
+  }
+}
+
+int main(int /*argc*/, char */*argv*/[]) {
+  auto arena_value = vm::create_linear_arena(1ull << 24);
+  auto arena = &arena_value;
+  PreparedSchemaParams prepare_params_dst = {
+    .useq_type = svf::Meta::ConcreteType_tag::u64,
+    .iseq_type = svf::Meta::ConcreteType_tag::i64,
+    .fseq_type = svf::Meta::ConcreteType_tag::f64,
+  };
+  auto schema_dst = prepare_schema(arena, &prepare_params_dst);
+
+  U8 scratch_buffer[256];
+  SVFRT_Bytes scratch = { .pointer = scratch_buffer, .count = sizeof(scratch_buffer) };
+  U8 single_scratch_buffer[256];
+  SVFRT_Bytes single_scratch = { .pointer = single_scratch_buffer, .count = sizeof(single_scratch_buffer) };
+
+  SVFRT_ReadMessageParams default_read_params = prepare_read_params(arena, &schema_dst);
+
+  PreparedMessageParams message_params = {
+    .sequence_count = 3,
+    .nested_reference_count = 2,
+    .useq_count = 5,
+    .iseq_count = 6,
+    .fseq_count = 7,
+    .primitive_fill = 0x7F,
+  };
+
+  PreparedSchemaParams prepare_params_a = { .change_leading_type = true };
+  auto schema_a = prepare_schema(arena, &prepare_params_a);
+  PreparedSchemaParams prepare_params_b = { .change_leading_type = true, .useq_type = svf::Meta::ConcreteType_tag::u16 };
+  auto schema_b = prepare_schema(arena, &prepare_params_b);
+  ASSERT(schema_a.schema_content_hash != schema_b.schema_content_hash);
+
+  auto message_dst = prepare_message(arena, &schema_dst, &message_params);
+  auto message_a = prepare_message(arena, &schema_a, &message_params);
+  auto message_b = prepare_message(arena, &schema_b, &message_params);
+  SVFRT_Bytes message_bad = { message_dst.pointer, 8 };
+
+  SVFRT_Bytes messages[] = {
+    message_dst,
+    message_a,
+    message_a,
+    message_bad,
+    message_a,
+    message_dst,
+  };
+  U32 message_count = sizeof(messages) / sizeof(*messages);
+  SVFRT_ReadMessageResult results[sizeof(messages) / sizeof(*messages)];
+
+  // Success, and same results as reading one by one. One foreign schema only
+  // needs scratch once, even without a cache.
+  {
+    SVFRT_read_messages(&default_read_params, results, messages, message_count, scratch, NULL, NULL);
+    for (U32 i = 0; i < message_count; i++) {
+      assert_same_as_single(&default_read_params, results + i, messages[i], single_scratch);
+    }
+    ASSERT(results[1].compatibility_level == SVFRT_compatibility_logical);
+    ASSERT(results[3].error_code == SVFRT_code_read__header_too_small);
+  }
+
+  // Same, with logical conversions spawned as tasks.
+  {
+    SpawnControl control = {};
+    SVFRT_read_messages(&default_read_params, results, messages, message_count, scratch, spawn_reversed, &control);
+    ASSERT(control.spawn_count == 1);
+    ASSERT(control.task_count == message_count);
+    for (U32 i = 0; i < message_count; i++) {
+      assert_same_as_single(&default_read_params, results + i, messages[i], single_scratch);
+    }
+  }
+
+  SVFRT_Bytes mixed_messages[] = {
+    message_a,
+    message_b,
+    message_a,
+    message_b,
+  };
+  U32 mixed_count = sizeof(mixed_messages) / sizeof(*mixed_messages);
+
+  // Success, without a cache, when a second foreign schema needs scratch, which
+  // is in use: the messages before it are finished first.
+  {
+    SVFRT_read_messages(&default_read_params, results, mixed_messages, mixed_count, scratch, NULL, NULL);
+    for (U32 i = 0; i < mixed_count; i++) {
+      ASSERT(results[i].compatibility_level == SVFRT_compatibility_logical);
+      assert_same_as_single(&default_read_params, results + i, mixed_messages[i], single_scratch);
+    }
+  }
+
+  // Same, with logical conversions spawned as tasks: each switch of the schema
+  // runs the deferred tasks before it.
+  {
+    SpawnControl control = {};
+    SVFRT_read_messages(&default_read_params, results, mixed_messages, mixed_count, scratch, spawn_reversed, &control);
+    ASSERT(control.spawn_count == mixed_count);
+    for (U32 i = 0; i < mixed_count; i++) {
+      assert_same_as_single(&default_read_params, results + i, mixed_messages[i], single_scratch);
+    }
+  }
+
+  // Success, with a cache.
+  {
+    alignas(8) U8 cache_buffer[1 << 14];
+    SVFRT_CompatibilityCache cache = {};
+    ASSERT(SVFRT_compatibility_cache_init(&cache, { cache_buffer, sizeof(cache_buffer) }, 16) == 0);
+
+    SVFRT_ReadMessageParams read_params = default_read_params;
+    read_params.compatibility_cache = &cache;
+    SpawnControl control = {};
+    SVFRT_read_messages(&read_params, results, mixed_messages, mixed_count, scratch, spawn_reversed, &control);
+    for (U32 i = 0; i < mixed_count; i++) {
+      assert_same_as_single(&read_params, results + i, mixed_messages[i], single_scratch);
+    }
+  }
+
+  // Success, when a different schema was sent under the same hash: decisions
+  // are only shared for the same schema bytes, so neither message decides for
+  // the other.
+  {
+    PreparedSchemaParams forged_params = { .change_leading_type = true, .useq_type = svf::Meta::ConcreteType_tag::f32 };
+    auto schema_forged = prepare_schema(arena, &forged_params);
+    schema_forged.schema_content_hash = schema_a.schema_content_hash;
+    auto message_forged = prepare_message(arena, &schema_forged, &message_params);
+
+    SVFRT_Bytes forged_messages[] = {
+      message_forged,
+      message_a,
+      message_a,
+      message_forged,
+    };
+    U32 forged_count = sizeof(forged_messages) / sizeof(*forged_messages);
+
+    SVFRT_ReadMessageResult single_result = {};
+    SVFRT_read_message(&default_read_params, &single_result, message_forged, single_scratch);
+    ASSERT(single_result.error_code != 0);
+
+    SVFRT_read_messages(&default_read_params, results, forged_messages, forged_count, scratch, NULL, NULL);
+    for (U32 i = 0; i < forged_count; i++) {
+      assert_same_as_single(&default_read_params, results + i, forged_messages[i], single_scratch);
+    }
+    ASSERT(results[1].error_code == 0);
+    ASSERT(results[1].compatibility_level == SVFRT_compatibility_logical);
+
+    SpawnControl control = {};
+    SVFRT_read_messages(&default_read_params, results, forged_messages, forged_count, scratch, spawn_reversed, &control);
+    for (U32 i = 0; i < forged_count; i++) {
+      assert_same_as_single(&default_read_params, results + i, forged_messages[i], single_scratch);
+    }
+  }
+
+  // Success, when a message has sharing, and there is a conversion memo: the
+  // messages are then finished right away, instead of in tasks without a memo.
+  {
+    alignas(4) U8 memo_buffer[24 * 16];
+    SVFRT_ReadMessageParams read_params = default_read_params;
+    read_params.conversion_memo = { memo_buffer, sizeof(memo_buffer) };
+
+    PreparedMessageParams shared_params = {
+      .sequence_count = 1,
+      .alias_reference_and_sequence = true,
+      .useq_count = 3,
+    };
+    auto shared_message = prepare_message(arena, &schema_a, &shared_params);
+
+    SVFRT_Bytes shared_messages[] = {
+      shared_message,
+      message_a,
+      shared_message,
+    };
+    U32 shared_count = sizeof(shared_messages) / sizeof(*shared_messages);
+
+    SpawnControl control = {};
+    SVFRT_read_messages(&read_params, results, shared_messages, shared_count, scratch, spawn_reversed, &control);
+    ASSERT(control.spawn_count == 0);
+    for (U32 i = 0; i < shared_count; i++) {
+      ASSERT(results[i].error_code == 0);
+      assert_same_as_single(&read_params, results + i, shared_messages[i], single_scratch);
+    }
+  }
+
+  return 0;
+}
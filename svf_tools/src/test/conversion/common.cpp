@@ -9,9 +9,31 @@ U32 write_arena(void *it, SVFRT_Bytes src) {
 
 void *allocate_arena(void *it, size_t size) {
   auto arena = (vm::LinearArena *) it;
+
+  // See `SVFRT_AllocatorFn`.
+  vm::realign(arena, SVFRT_MESSAGE_PART_ALIGNMENT);
   return (void *) vm::many<U8>(arena, size).pointer;
 };
 
+static
+U32 primitive_size(svf::Meta::ConcreteType_tag type_tag) {
+  switch (type_tag) {
+    case svf::Meta::ConcreteType_tag::u8: return 1;
+    case svf::Meta::ConcreteType_tag::u16: return 2;
+    case svf::Meta::ConcreteType_tag::u32: return 4;
+    case svf::Meta::ConcreteType_tag::u64: return 8;
+    case svf::Meta::ConcreteType_tag::i8: return 1;
+    case svf::Meta::ConcreteType_tag::i16: return 2;
+    case svf::Meta::ConcreteType_tag::i32: return 4;
+    case svf::Meta::ConcreteType_tag::i64: return 8;
+    case svf::Meta::ConcreteType_tag::f32: return 4;
+    case svf::Meta::ConcreteType_tag::f64: return 8;
+    default: break;
+  }
+  UNREACHABLE;
+  return 0;
+}
+
 PreparedSchema prepare_schema(vm::LinearArena *arena, PreparedSchemaParams *params) {
   PreparedSchemaParams empty = {};
   if (!params) {
@@ -157,14 +179,19 @@ PreparedSchema prepare_schema(vm::LinearArena *arena, PreparedSchemaParams *para
   svf::Meta::StructDefinition base_structs[2] = {
     {
       .typeId = 0x5D00, // "SD" for "Struct Definition".
-      // TODO @proper-alignment: test assumes packed data, need to fix this.
-      // There are other places in this file as well.
-      .size = safe_int_cast<U32>(leading_type_size + sizeof(SVFRT_Reference) + 4 * sizeof(SVFRT_Sequence) + sizeof(U8)),
+      // All fields are at their #natural-alignment already, only the size
+      // needs padding after the choice tag. The leading type is the largest.
+      .size = safe_int_cast<U32>(align_up(
+        leading_type_size + sizeof(SVFRT_Reference) + 4 * sizeof(SVFRT_Sequence) + sizeof(U8),
+        leading_type_size
+      )),
+      .alignment = leading_type_size,
       .fields = entry_fields_sequence,
     },
     {
       .typeId = 0x5D01, // "SD" for "Struct Definition".
       .size = sizeof(SVFRT_Reference),
+      .alignment = alignof(SVFRT_Reference),
       .fields = selfref_fields_sequence,
     },
   };
@@ -203,6 +230,7 @@ PreparedSchema prepare_schema(vm::LinearArena *arena, PreparedSchemaParams *para
     {
       .typeId = 0xCD00, // "CD" for "Choice Definition".
       .payloadSize = 0,
+      .payloadAlignment = 1,
       .options = options,
     },
   };
@@ -231,37 +259,10 @@ PreparedSchema prepare_schema(vm::LinearArena *arena, PreparedSchemaParams *para
   result.entry_choice_offset = base_fields[6].offset;
   result.struct_strides = { struct_strides.pointer, safe_int_cast<U32>(struct_strides.count) };
 
-  if (params->useq_type == svf::Meta::ConcreteType_tag::u8) {
-    result.useq_size = 1;
-  } else if (params->useq_type == svf::Meta::ConcreteType_tag::u16) {
-    result.useq_size = 2;
-  } else if (params->useq_type == svf::Meta::ConcreteType_tag::u32) {
-    result.useq_size = 4;
-  } else if (params->useq_type == svf::Meta::ConcreteType_tag::u64) {
-    result.useq_size = 8;
-  } else {
-    UNREACHABLE;
-  }
-
-  if (params->iseq_type == svf::Meta::ConcreteType_tag::i8) {
-    result.iseq_size = 1;
-  } else if (params->iseq_type == svf::Meta::ConcreteType_tag::i16) {
-    result.iseq_size = 2;
-  } else if (params->iseq_type == svf::Meta::ConcreteType_tag::i32) {
-    result.iseq_size = 4;
-  } else if (params->iseq_type == svf::Meta::ConcreteType_tag::i64) {
-    result.iseq_size = 8;
-  } else {
-    UNREACHABLE;
-  }
-
-  if (params->fseq_type == svf::Meta::ConcreteType_tag::f32) {
-    result.fseq_size = 4;
-  } else if (params->fseq_type == svf::Meta::ConcreteType_tag::f64) {
-    result.fseq_size = 8;
-  } else {
-    UNREACHABLE;
-  }
+  // Any primitive type works for any of the sequences.
+  result.useq_size = primitive_size(params->useq_type);
+  result.iseq_size = primitive_size(params->iseq_type);
+  result.fseq_size = primitive_size(params->fseq_type);
 
   result.schema_content_hash = hash64::begin();
   hash64::add_bytes(&result.schema_content_hash, {result.schema.pointer, result.schema.count});
@@ -317,6 +318,7 @@ SVFRT_Bytes prepare_message(vm::LinearArena *arena, PreparedSchema *schema, Prep
   SVFRT_Sequence useq = {};
   for (U32 i = 0; i < params->useq_count; i++) {
     U64 item = 0;
+    memset(&item, params->primitive_fill, sizeof(item));
     ASSERT(schema->useq_size <= sizeof(item));
     SVFRT_write_sequence_element(&ctx, &item, schema->useq_size, &useq);
   }
@@ -328,6 +330,7 @@ SVFRT_Bytes prepare_message(vm::LinearArena *arena, PreparedSchema *schema, Prep
   SVFRT_Sequence iseq = {};
   for (U32 i = 0; i < params->iseq_count; i++) {
     U64 item = 0;
+    memset(&item, params->primitive_fill, sizeof(item));
     ASSERT(schema->iseq_size <= sizeof(item));
     SVFRT_write_sequence_element(&ctx, &item, schema->iseq_size, &iseq);
   }
@@ -339,6 +342,7 @@ SVFRT_Bytes prepare_message(vm::LinearArena *arena, PreparedSchema *schema, Prep
   SVFRT_Sequence fseq = {};
   for (U32 i = 0; i < params->fseq_count; i++) {
     U64 item = 0;
+    memset(&item, params->primitive_fill, sizeof(item));
     ASSERT(schema->fseq_size <= sizeof(item));
     SVFRT_write_sequence_element(&ctx, &item, schema->fseq_size, &fseq);
   }
@@ -366,3 +370,19 @@ SVFRT_Bytes prepare_message(vm::LinearArena *arena, PreparedSchema *schema, Prep
     .count = safe_int_cast<U32>((U8 *) vm::realign(arena, 1) - (U8 *) message_pointer),
   };
 }
+
+SVFRT_ReadMessageParams prepare_read_params(vm::LinearArena *arena, PreparedSchema *schema) {
+  SVFRT_ReadMessageParams result = {};
+  result.expected_schema_content_hash = schema->schema_content_hash;
+  result.expected_schema_struct_strides = schema->struct_strides;
+  result.expected_schema = schema->schema;
+  result.required_level = SVFRT_compatibility_logical;
+  result.entry_struct_id = schema->entry_struct_id;
+  result.entry_struct_index = 0;
+  result.max_schema_work = UINT32_MAX;
+  result.max_recursion_depth = SVFRT_DEFAULT_MAX_RECURSION_DEPTH;
+  result.max_output_size = SVFRT_NO_SIZE_LIMIT;
+  result.allocator_fn = allocate_arena;
+  result.allocator_ptr = arena;
+  return result;
+}
@@ -47,6 +47,11 @@ struct PreparedMessageParams {
   Bool iseq_invalid;
   U32 fseq_count;
   Bool fseq_invalid;
+  U8 primitive_fill; // Byte value for all primitive sequence items.
 };
 
 SVFRT_Bytes prepare_message(vm::LinearArena *arena, PreparedSchema *schema, PreparedMessageParams *params);
+
+// Params for reading with `schema`, at logical compatibility, with no limits,
+// and allocating from `arena`.
+SVFRT_ReadMessageParams prepare_read_params(vm::LinearArena *arena, PreparedSchema *schema);
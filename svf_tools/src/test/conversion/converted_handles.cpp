@@ -0,0 +1,54 @@
+#define SVF_INCLUDE_BINARY_SCHEMA
+#include <src/svf_runtime.hpp>
+#include "common.hpp"
+
+int main(int /*argc*/, char */*argv*/[]) {
+  auto arena_value = vm::create_linear_arena(1ull << 20);
+  auto arena = &arena_value;
+  PreparedSchemaParams dst_params = {
+    .useq_type = svf::Meta::ConcreteType_tag::u16,
+  };
+  auto schema_dst = prepare_schema(arena, &dst_params);
+
+  U8 scratch_buffer[256];
+  SVFRT_Bytes scratch = { .pointer = scratch_buffer, .count = sizeof(scratch_buffer) };
+
+  SVFRT_ReadMessageParams read_params = prepare_read_params(arena, &schema_dst);
+
+  // Success, and references and sequences in the converted message point at
+  // their converted data.
+  {
+    PreparedSchemaParams prepare_params = { .change_leading_type = true };
+    auto schema_src = prepare_schema(arena, &prepare_params);
+    PreparedMessageParams message_params = {
+      .sequence_count = 2,
+      .nested_reference_count = 2,
+      .useq_count = 3,
+    };
+    auto message = prepare_message(arena, &schema_src, &message_params);
+    SVFRT_ReadMessageResult read_result = {};
+    SVFRT_read_message(&read_params, &read_result, message, scratch);
+    ASSERT(read_result.error_code == 0);
+    ASSERT(read_result.compatibility_level == SVFRT_compatibility_logical);
+
+    auto entry = (U8 const *) read_result.entry;
+
+    SVFRT_Reference reference;
+    memcpy(&reference, entry + schema_dst.entry_reference_offset, sizeof(reference));
+    auto target = (SVFRT_Reference const *) SVFRT_read_reference(&read_result.context, reference, sizeof(reference));
+    ASSERT(target);
+    ASSERT(SVFRT_read_reference(&read_result.context, *target, sizeof(reference)));
+
+    SVFRT_Sequence sequence;
+    memcpy(&sequence, entry + schema_dst.entry_sequence_offset, sizeof(sequence));
+    ASSERT(sequence.count == 2);
+    ASSERT(SVFRT_read_sequence_element(&read_result.context, sequence, 1, 1));
+
+    SVFRT_Sequence useq;
+    memcpy(&useq, entry + schema_dst.entry_useq_offset, sizeof(useq));
+    ASSERT(useq.count == 3);
+    ASSERT(SVFRT_read_sequence_raw(&read_result.context, useq, sizeof(U16)));
+  }
+
+  return 0;
+}
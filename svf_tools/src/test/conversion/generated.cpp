@@ -0,0 +1,310 @@
+#define SVF_INCLUDE_BINARY_SCHEMA
+#include <generated/hpp/A0.hpp>
+#include <generated/hpp/A1.hpp>
+#include <generated/hpp/D0.hpp>
+#include <generated/hpp/D1.hpp>
+#include <generated/hpp/G0.hpp>
+#include <generated/hpp/G1.hpp>
+#include <src/svf_runtime.hpp>
+#include <generated/h/A0_to_A1.h>
+#include <generated/h/D0_to_D1.h>
+#include <generated/h/G0_to_G1.h>
+#include "common.hpp"
+
+static
+Bytes finish_message(vm::LinearArena *arena, void *base) {
+  auto end = arena->reserved_range.pointer + arena->waterline;
+  return {
+    .pointer = (Byte *) base,
+    .count = offset_between<U32>(base, end),
+  };
+}
+
+static
+Bytes write_d0(vm::LinearArena *arena) {
+  namespace schema = svf::D0;
+  auto base = vm::realign(arena, svf::runtime::MESSAGE_PART_ALIGNMENT);
+  auto ctx = svf::runtime::write_start<schema::Entry>(write_arena, arena);
+  schema::Entry entry = {
+    .reorderFields = { .one = 42, .two = 43 },
+    .reorderOptions_tag = schema::ReorderOptions_tag::one,
+    .reorderOptions_payload = { .one = 44 },
+    .addField = { .one = 68, .three = 69 },
+    .removeField = { .one = 45, .two = 46, .three = 47 },
+    .addOption_tag = schema::AddOption_tag::three,
+    .addOption_payload = { .three = 48 },
+    .removeOption1_tag = schema::RemoveOption_tag::one,
+    .removeOption1_payload = { .one = 70 },
+    .removeOption2_tag = schema::RemoveOption_tag::two,
+    .removeOption2_payload = { .two = 71 },
+    .primitives = { .u8u16 = 49, .u16i64 = 58, .i8i64 = -5, .f32f64 = 67.0 },
+  };
+  svf::runtime::write_finish(&ctx, &entry);
+  ASSERT(ctx.finished);
+  return finish_message(arena, base);
+}
+
+static
+Bytes write_a0(vm::LinearArena *arena) {
+  namespace schema = svf::A0;
+  auto base = vm::realign(arena, svf::runtime::MESSAGE_PART_ALIGNMENT);
+  auto ctx = svf::runtime::write_start<schema::Entry>(write_arena, arena);
+  schema::Target target = { .value = 1, .y = 2 };
+  schema::Entry entry = {
+    .reference = svf::runtime::write_reference(&ctx, &target),
+  };
+  svf::runtime::write_finish(&ctx, &entry);
+  ASSERT(ctx.finished);
+  return finish_message(arena, base);
+}
+
+static
+Bytes write_g0(vm::LinearArena *arena, U32 reference_offset_complement) {
+  namespace schema = svf::G0;
+  auto base = vm::realign(arena, svf::runtime::MESSAGE_PART_ALIGNMENT);
+  auto ctx = svf::runtime::write_start<schema::Entry>(write_arena, arena);
+  // Each handle needs its own data, since aliasing is rejected.
+  I8 nested_values[3] = { -1, 2, -3 };
+  schema::Nested nested[3] = {};
+  for (U32 i = 0; i < 3; i++) {
+    nested[i].values = svf::runtime::write_sequence(&ctx, nested_values, 3);
+  }
+  schema::Target targets[4] = {
+    { .value = 1, .nested = svf::runtime::write_reference(&ctx, &nested[0]) },
+    { .value = 3 },
+    { .value = 5, .nested = svf::runtime::write_reference(&ctx, &nested[1]) },
+    { .value = 7, .nested = svf::runtime::write_reference(&ctx, &nested[2]) },
+  };
+  U16 values[3] = { 1, 2, 65535 };
+  U32 same = 7;
+  schema::Entry entry = {
+    .reference = svf::runtime::write_reference(&ctx, &targets[0]),
+    .targets = svf::runtime::write_sequence(&ctx, targets + 1, 2),
+    .values = svf::runtime::write_sequence(&ctx, values, 3),
+    .same = svf::runtime::write_sequence(&ctx, &same, 1),
+    .wrapped_tag = schema::Wrapped_tag::target,
+    .wrapped_payload = { .target = targets[3] },
+  };
+  if (reference_offset_complement) {
+    entry.reference.data_offset_complement = reference_offset_complement;
+  }
+  svf::runtime::write_finish(&ctx, &entry);
+  ASSERT(ctx.finished);
+  return finish_message(arena, base);
+}
+
+template<typename Entry>
+static
+svf::runtime::ReadMessageResult<Entry> read(
+  vm::LinearArena *arena,
+  Bytes message,
+  Bytes scratch,
+  SVFRT_ConverterTable *table
+) {
+  return svf::runtime::read_message<Entry>(
+    { message.pointer, safe_int_cast<U32>(message.count) },
+    { scratch.pointer, safe_int_cast<U32>(scratch.count) },
+    svf::runtime::CompatibilityLevel::compatibility_logical,
+    allocate_arena,
+    arena,
+    NULL,
+    NULL,
+    NULL,
+    table
+  );
+}
+
+// The generated conversion must produce exactly the same bytes as the generic
+// one, even though it gets no scratch memory.
+template<typename Entry>
+static
+svf::runtime::ReadMessageResult<Entry> read_same(
+  vm::LinearArena *arena,
+  Bytes message,
+  Bytes scratch,
+  SVFRT_ConverterTable *table
+) {
+  auto expected = read<Entry>(arena, message, scratch, NULL);
+  ASSERT(expected.error_code == 0);
+  ASSERT(expected.compatibility_level == svf::runtime::CompatibilityLevel::compatibility_logical);
+
+  auto result = read<Entry>(arena, message, {}, table);
+  ASSERT(result.error_code == 0);
+  ASSERT(result.compatibility_level == expected.compatibility_level);
+
+  auto expected_bytes = expected.context.data_range;
+  auto actual_bytes = result.context.data_range;
+  ASSERT(expected_bytes.count == actual_bytes.count);
+  ASSERT(memcmp(expected_bytes.pointer, actual_bytes.pointer, expected_bytes.count) == 0);
+  ASSERT(result.allocation == actual_bytes.pointer);
+  return result;
+}
+
+int main(int /*argc*/, char */*argv*/[]) {
+  auto arena_value = vm::create_linear_arena(1ull << 20);
+  auto arena = &arena_value;
+
+  auto scratch = vm::many<U8>(arena, 4096);
+  auto no_scratch = Bytes {};
+
+  // The headers describe the schemas they were generated from.
+  ASSERT(SVF_D0_to_D1_schema_content_hash_src == svf::D0::_SchemaDescription::content_hash);
+  ASSERT(SVF_D0_to_D1_schema_content_hash_dst == svf::D1::_SchemaDescription::content_hash);
+  ASSERT(SVF_D0_to_D1_converter_count > 0);
+  ASSERT(SVF_G0_to_G1_converter_count > 0);
+
+  // Binary-compatible schemas need no converters.
+  ASSERT(SVF_A0_to_A1_converter_count == 0);
+
+  // Fail, with an invalid slot count.
+  alignas(8) U8 table_buffer[64 * sizeof(void *)];
+  SVFRT_ConverterTable table = {};
+  ASSERT(SVFRT_converter_table_init(
+    &table, { table_buffer, sizeof(table_buffer) }, 3
+  ) == SVFRT_code_converter_table__invalid_slot_count);
+
+  // Fail, when there is no room.
+  ASSERT(SVFRT_converter_table_init(&table, { table_buffer, sizeof(table_buffer) }, 2) == 0);
+  ASSERT(SVFRT_converter_table_add(
+    &table, SVF_D0_to_D1_converters, SVF_D0_to_D1_converter_count
+  ) == SVFRT_code_converter_table__full);
+
+  // Success, and adding the same converters again is fine.
+  ASSERT(SVFRT_converter_table_init(&table, { table_buffer, sizeof(table_buffer) }, 64) == 0);
+  ASSERT(SVFRT_converter_table_add(&table, SVF_A0_to_A1_converters, SVF_A0_to_A1_converter_count) == 0);
+  ASSERT(SVFRT_converter_table_add(&table, SVF_D0_to_D1_converters, SVF_D0_to_D1_converter_count) == 0);
+  ASSERT(SVFRT_converter_table_add(&table, SVF_G0_to_G1_converters, SVF_G0_to_G1_converter_count) == 0);
+  auto converter_count = table.converter_count;
+  ASSERT(SVFRT_converter_table_add(&table, SVF_D0_to_D1_converters, SVF_D0_to_D1_converter_count) == 0);
+  ASSERT(table.converter_count == converter_count);
+
+  auto message_d0 = write_d0(arena);
+  auto message_g0 = write_g0(arena, 0);
+
+  // Fail, without the converters and without scratch memory, since the
+  // schemas have to be checked.
+  {
+    auto result = read<svf::D1::Entry>(arena, message_d0, no_scratch, NULL);
+    ASSERT(result.error_code != 0);
+  }
+
+  // Success, with the generated conversion: primitives, widenings, added and
+  // removed fields, and remapped choice tags.
+  {
+    auto result = read_same<svf::D1::Entry>(arena, message_d0, scratch, &table);
+    auto entry = result.entry;
+    ASSERT(entry->reorderFields.one == 42 && entry->reorderFields.two == 43);
+    ASSERT(entry->reorderOptions_tag == svf::D1::ReorderOptions_tag::one);
+    ASSERT(entry->reorderOptions_payload.one == 44);
+    ASSERT(entry->addField.one == 68 && entry->addField.two == 0 && entry->addField.three == 69);
+    ASSERT(entry->addOption_tag == svf::D1::AddOption_tag::three);
+    ASSERT(entry->removeOption1_tag == svf::D1::RemoveOption_tag::one);
+    ASSERT(entry->removeOption2_tag == svf::D1::RemoveOption_tag::nothing);
+    ASSERT(entry->primitives.u8u16 == 49);
+    ASSERT(entry->primitives.u16i64 == 58);
+    ASSERT(entry->primitives.i8i64 == -5);
+    ASSERT(entry->primitives.f32f64 == 67.0);
+  }
+
+  // Success, with references, sequences (of structs, and of primitives, both
+  // widened and not), and a struct in a choice.
+  {
+    auto result = read_same<svf::G1::Entry>(arena, message_g0, scratch, &table);
+    auto ctx = &result.context;
+    auto entry = result.entry;
+
+    auto target = svf::runtime::read_reference(ctx, entry->reference);
+    ASSERT(target && target->value == 1 && target->extra == 0);
+    auto nested = svf::runtime::read_reference(ctx, target->nested);
+    ASSERT(nested);
+    auto nested_values = svf::runtime::read_sequence_raw(ctx, nested->values);
+    ASSERT(nested_values.count == 3 && nested_values.pointer[0] == -1 && nested_values.pointer[2] == -3);
+
+    auto second = svf::runtime::read_sequence_element(ctx, entry->targets, 1);
+    ASSERT(second && second->value == 5 && svf::runtime::read_reference(ctx, second->nested));
+    auto first = svf::runtime::read_sequence_element(ctx, entry->targets, 0);
+    ASSERT(first && first->value == 3 && first->nested.data_offset_complement == 0);
+
+    auto values = svf::runtime::read_sequence_raw(ctx, entry->values);
+    ASSERT(values.count == 3 && values.pointer[2] == 65535);
+    auto same = svf::runtime::read_sequence_raw(ctx, entry->same);
+    ASSERT(same.count == 1 && same.pointer[0] == 7);
+
+    ASSERT(entry->wrapped_tag == svf::G1::Wrapped_tag::target);
+    ASSERT(entry->wrapped_payload.target.value == 7);
+    ASSERT(svf::runtime::read_reference(ctx, entry->wrapped_payload.target.nested));
+  }
+
+  // Success, binary-compatible messages don't need a converter.
+  {
+    auto message = write_a0(arena);
+    auto result = read<svf::A1::Entry>(arena, message, scratch, &table);
+    ASSERT(result.error_code == 0);
+    ASSERT(result.compatibility_level == svf::runtime::CompatibilityLevel::compatibility_binary);
+  }
+
+  // Fail, same as the generic conversion, when a reference is out of bounds.
+  {
+    auto message = write_g0(arena, ~(U32) 100000);
+    auto expected = read<svf::G1::Entry>(arena, message, scratch, NULL);
+    auto result = read<svf::G1::Entry>(arena, message, no_scratch, &table);
+    ASSERT(expected.error_code == SVFRT_code_conversion__data_out_of_bounds);
+    ASSERT(result.error_code == expected.error_code);
+  }
+
+  // Fail, same as the generic conversion, when the message is too deep.
+  {
+    SVFRT_ReadMessageParams params = svf::runtime::get_read_message_params<svf::G1::Entry>(
+      svf::runtime::CompatibilityLevel::compatibility_logical,
+      allocate_arena, arena, NULL, NULL, NULL
+    );
+    params.max_recursion_depth = 3;
+
+    SVFRT_ReadMessageResult expected = {};
+    SVFRT_read_message(
+      &params, &expected, { message_g0.pointer, safe_int_cast<U32>(message_g0.count) },
+      { scratch.pointer, safe_int_cast<U32>(scratch.count) }
+    );
+    ASSERT(expected.error_code == SVFRT_code_conversion__max_recursion_depth_exceeded);
+
+    params.converter_table = &table;
+    SVFRT_ReadMessageResult result = {};
+    SVFRT_read_message(&params, &result, { message_g0.pointer, safe_int_cast<U32>(message_g0.count) }, {});
+    ASSERT(result.error_code == expected.error_code);
+
+    // Success, just deep enough for the `Nested` fields in the choice.
+    params.max_recursion_depth = 4;
+    result = {};
+    SVFRT_read_message(&params, &result, { message_g0.pointer, safe_int_cast<U32>(message_g0.count) }, {});
+    ASSERT(result.error_code == 0);
+  }
+
+  // Only found for exactly the same src-schema, even with the same hash.
+  {
+    auto schema = Bytes {
+      .pointer = svf::G0::_SchemaDescription::schema_binary_array,
+      .count = svf::G0::_SchemaDescription::schema_binary_size,
+    };
+    auto entry_struct_id = svf::G1::Entry_type_id;
+    ASSERT(SVFRT_converter_table_find(
+      &table,
+      { schema.pointer, safe_int_cast<U32>(schema.count) },
+      SVF_G0_to_G1_schema_content_hash_src,
+      SVF_G0_to_G1_schema_content_hash_dst,
+      entry_struct_id
+    ));
+
+    auto poisoned = vm::many<U8>(arena, schema.count);
+    range_copy(poisoned, schema);
+    poisoned.pointer[0] ^= 1;
+    ASSERT(!SVFRT_converter_table_find(
+      &table,
+      { poisoned.pointer, safe_int_cast<U32>(poisoned.count) },
+      SVF_G0_to_G1_schema_content_hash_src,
+      SVF_G0_to_G1_schema_content_hash_dst,
+      entry_struct_id
+    ));
+  }
+
+  return 0;
+}
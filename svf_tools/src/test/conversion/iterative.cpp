@@ -0,0 +1,130 @@
+#define SVF_INCLUDE_BINARY_SCHEMA
+#include <src/svf_runtime.hpp>
+#include "common.hpp"
+
+// Read the message twice: the first read converts by traversal, the second one
+// converts iteratively with the provided stack. Both must agree.
+static
+SVFRT_ErrorCode read_twice(
+  SVFRT_ReadMessageParams *read_params,
+  SVFRT_Bytes message,
+  SVFRT_Bytes scratch,
+  SVFRT_Bytes stack
+) {
+  SVFRT_ReadMessageParams traversal_params = *read_params;
+  traversal_params.conversion_stack = { 0, 0 };
+  SVFRT_ReadMessageResult traversal_result = {};
+  SVFRT_read_message(&traversal_params, &traversal_result, message, scratch);
+
+  SVFRT_ReadMessageParams iterative_params = *read_params;
+  iterative_params.conversion_stack = stack;
+  SVFRT_ReadMessageResult iterative_result = {};
+  SVFRT_read_message(&iterative_params, &iterative_result, message, scratch);
+
+  ASSERT(iterative_result.error_code == traversal_result.error_code);
+  if (traversal_result.error_code == 0) {
+    auto traversal_bytes = traversal_result.context.data_range;
+    auto iterative_bytes = iterative_result.context.data_range;
+    ASSERT(traversal_bytes.count == iterative_bytes.count);
+    for (U32 i = 0; i < traversal_bytes.count; i++) {
+      ASSERT(traversal_bytes.pointer[i] == iterative_bytes.pointer[i]);
+    }
+  }
+
+  return iterative_result.error_code;
+}
+
+int main(int /*argc*/, char */*argv*/[]) {
+  auto arena_value = vm::create_linear_arena(1ull << 26);
+  auto arena = &arena_value;
+  auto schema_dst = prepare_schema(arena, 0);
+
+  U8 scratch_buffer[256];
+  SVFRT_Bytes scratch = { .pointer = scratch_buffer, .count = sizeof(scratch_buffer) };
+
+  SVFRT_ReadMessageParams default_read_params = prepare_read_params(arena, &schema_dst);
+
+  U32 stack_size = SVFRT_conversion_stack_size(SVFRT_DEFAULT_MAX_RECURSION_DEPTH);
+  auto stack_memory = vm::many<U64>(arena, (stack_size + sizeof(U64) - 1) / sizeof(U64));
+  SVFRT_Bytes stack = { .pointer = (U8 *) stack_memory.pointer, .count = stack_size };
+
+  // Stack size only depends on the depth.
+  {
+    U32 frame_size = SVFRT_conversion_stack_size(0);
+    ASSERT(frame_size > 0);
+    ASSERT(stack_size == frame_size * (1 + 2 * SVFRT_DEFAULT_MAX_RECURSION_DEPTH));
+    ASSERT(SVFRT_conversion_stack_size(UINT32_MAX) == UINT32_MAX);
+  }
+
+  // Success, with sequences, references, choices, and primitives.
+  {
+    PreparedSchemaParams prepare_params = { .change_leading_type = true };
+    auto schema_src = prepare_schema(arena, &prepare_params);
+    PreparedMessageParams message_params = {
+      .sequence_count = 3,
+      .nested_reference_count = 2,
+      .useq_count = 5,
+      .iseq_count = 6,
+      .fseq_count = 7,
+      .primitive_fill = 0x7F,
+    };
+    auto message = prepare_message(arena, &schema_src, &message_params);
+    ASSERT(read_twice(&default_read_params, message, scratch, stack) == 0);
+  }
+
+  // Fail, same as traversal, when nested references are too deep.
+  {
+    PreparedSchemaParams prepare_params = { .change_leading_type = true };
+    auto schema_src = prepare_schema(arena, &prepare_params);
+    PreparedMessageParams message_params = { .nested_reference_count = 256 };
+    auto message = prepare_message(arena, &schema_src, &message_params);
+    ASSERT(
+      read_twice(&default_read_params, message, scratch, stack)
+      == SVFRT_code_conversion__max_recursion_depth_exceeded
+    );
+  }
+
+  // Success, same as traversal, right at the limit.
+  {
+    PreparedSchemaParams prepare_params = { .change_leading_type = true };
+    auto schema_src = prepare_schema(arena, &prepare_params);
+    PreparedMessageParams message_params = { .nested_reference_count = 255 };
+    auto message = prepare_message(arena, &schema_src, &message_params);
+    ASSERT(read_twice(&default_read_params, message, scratch, stack) == 0);
+  }
+
+  // Fail, when the stack is too small.
+  {
+    PreparedSchemaParams prepare_params = { .change_leading_type = true };
+    auto schema_src = prepare_schema(arena, &prepare_params);
+    PreparedMessageParams message_params = { .nested_reference_count = 2 };
+    auto message = prepare_message(arena, &schema_src, &message_params);
+    SVFRT_ReadMessageParams read_params = default_read_params;
+    read_params.conversion_stack = { stack.pointer, SVFRT_conversion_stack_size(0) };
+    SVFRT_ReadMessageResult read_result = {};
+    SVFRT_read_message(&read_params, &read_result, message, scratch);
+    ASSERT(read_result.error_code == SVFRT_code_conversion__not_enough_stack_memory);
+  }
+
+  // Success, with nesting far deeper than traversal could handle.
+  {
+    U32 depth = 100000;
+    PreparedSchemaParams prepare_params = { .change_leading_type = true };
+    auto schema_src = prepare_schema(arena, &prepare_params);
+    PreparedMessageParams message_params = { .nested_reference_count = depth };
+    auto message = prepare_message(arena, &schema_src, &message_params);
+
+    U32 deep_stack_size = SVFRT_conversion_stack_size(depth + 1);
+    auto deep_stack_memory = vm::many<U64>(arena, (deep_stack_size + sizeof(U64) - 1) / sizeof(U64));
+
+    SVFRT_ReadMessageParams read_params = default_read_params;
+    read_params.max_recursion_depth = depth + 1;
+    read_params.conversion_stack = { (U8 *) deep_stack_memory.pointer, deep_stack_size };
+    SVFRT_ReadMessageResult read_result = {};
+    SVFRT_read_message(&read_params, &read_result, message, scratch);
+    ASSERT(read_result.error_code == 0);
+    ASSERT(read_result.compatibility_level == SVFRT_compatibility_logical);
+  }
+
+  return 0;
+}
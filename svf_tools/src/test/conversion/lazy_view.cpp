@@ -0,0 +1,330 @@
+#define SVF_INCLUDE_BINARY_SCHEMA
+#include <generated/hpp/A0.hpp>
+#include <generated/hpp/A1.hpp>
+#include <generated/hpp/D0.hpp>
+#include <generated/hpp/D1.hpp>
+#include <src/svf_runtime.hpp>
+#include "common.hpp"
+
+using svf::runtime::CompatibilityLevel;
+using svf::runtime::view_count;
+using svf::runtime::view_get;
+using svf::runtime::view_materialize;
+using svf::runtime::view_read;
+
+// The generated offsets are the same as the ones of the generated structs.
+static_assert(svf::D1::Entry_fields::addField.offset == offsetof(svf::D1::Entry, addField));
+static_assert(svf::D1::Entry_fields::addOption_payload.offset == offsetof(svf::D1::Entry, addOption_payload));
+static_assert(svf::A1::SomeStruct_fields::sequence.offset == offsetof(svf::A1::SomeStruct, sequence));
+
+static
+Bytes finish_message(vm::LinearArena *arena, void *base) {
+  auto end = arena->reserved_range.pointer + arena->waterline;
+  return {
+    .pointer = (Byte *) base,
+    .count = offset_between<U32>(base, end),
+  };
+}
+
+static
+Bytes write_d0(vm::LinearArena *arena) {
+  namespace schema = svf::D0;
+  auto base = vm::realign(arena, svf::runtime::MESSAGE_PART_ALIGNMENT);
+  auto ctx = svf::runtime::write_start<schema::Entry>(write_arena, arena);
+  schema::Entry entry = {
+    .reorderFields = { .one = 42, .two = 43 },
+    .reorderOptions_tag = schema::ReorderOptions_tag::one,
+    .reorderOptions_payload = { .one = 44 },
+    .addField = { .one = 68, .three = 69 },
+    .removeField = { .one = 45, .two = 46, .three = 47 },
+    .addOption_tag = schema::AddOption_tag::three,
+    .addOption_payload = { .three = 48 },
+    .removeOption1_tag = schema::RemoveOption_tag::one,
+    .removeOption1_payload = { .one = 70 },
+    .removeOption2_tag = schema::RemoveOption_tag::two,
+    .removeOption2_payload = { .two = 71 },
+    .primitives = { .u8u16 = 49, .u16i64 = 58, .f32f64 = 67.0 },
+  };
+  svf::runtime::write_finish(&ctx, &entry);
+  ASSERT(ctx.finished);
+  return finish_message(arena, base);
+}
+
+template<typename Entry, typename Target, typename SomeChoiceTag>
+static
+Bytes write_a(vm::LinearArena *arena, Target const *targets, SomeChoiceTag tag) {
+  auto base = vm::realign(arena, svf::runtime::MESSAGE_PART_ALIGNMENT);
+  auto ctx = svf::runtime::write_start<Entry>(write_arena, arena);
+  Entry entry = {};
+  entry.reference = svf::runtime::write_reference(&ctx, &targets[0]);
+  entry.someStruct.sequence = svf::runtime::write_sequence(&ctx, targets, 3);
+  entry.someStruct.someChoice_tag = tag;
+  entry.someStruct.someChoice_payload.target = targets[1];
+  svf::runtime::write_finish(&ctx, &entry);
+  ASSERT(ctx.finished);
+  return finish_message(arena, base);
+}
+
+template<typename Entry>
+static
+svf::runtime::LazyView<Entry> read_lazy(
+  SVFRT_LazyRead *out_read,
+  vm::LinearArena *arena,
+  Bytes message,
+  Bytes scratch,
+  Bytes memory
+) {
+  return svf::runtime::read_message_lazy<Entry>(
+    out_read,
+    { message.pointer, safe_int_cast<U32>(message.count) },
+    { scratch.pointer, safe_int_cast<U32>(scratch.count) },
+    { memory.pointer, safe_int_cast<U32>(memory.count) },
+    CompatibilityLevel::compatibility_logical,
+    allocate_arena,
+    arena
+  );
+}
+
+template<typename Entry>
+static
+svf::runtime::ReadMessageResult<Entry> read_full(vm::LinearArena *arena, Bytes message, Bytes scratch) {
+  return svf::runtime::read_message<Entry>(
+    { message.pointer, safe_int_cast<U32>(message.count) },
+    { scratch.pointer, safe_int_cast<U32>(scratch.count) },
+    CompatibilityLevel::compatibility_logical,
+    allocate_arena,
+    arena
+  );
+}
+
+// A materialized struct must be the same as that part of the full read.
+template<typename T>
+static
+void check_same_struct(
+  svf::runtime::ReadMessageResult<T> *expected,
+  T const *expected_struct,
+  svf::runtime::ReadMessageResult<T> *actual
+) {
+  ASSERT(actual->error_code == 0);
+  ASSERT(memcmp(expected_struct, actual->entry, sizeof(T)) == 0);
+  auto expected_strides = expected->context.struct_strides;
+  auto actual_strides = actual->context.struct_strides;
+  ASSERT(actual_strides.count == expected_strides.count);
+  ASSERT(memcmp(actual_strides.pointer, expected_strides.pointer, expected_strides.count * sizeof(U32)) == 0);
+}
+
+int main(int /*argc*/, char */*argv*/[]) {
+  auto arena_value = vm::create_linear_arena(1ull << 20);
+  auto arena = &arena_value;
+
+  auto scratch = vm::many<U8>(arena, 4096);
+  auto memory = vm::many<U8>(arena, SVFRT_lazy_read_memory_size(0));
+
+  // Fail, without enough memory for the state.
+  {
+    auto message = write_d0(arena);
+    SVFRT_LazyRead read = {};
+    auto entry = read_lazy<svf::D1::Entry>(&read, arena, message, scratch, { memory.pointer, memory.count - 8 });
+    ASSERT(read.error_code == SVFRT_code_read__not_enough_lazy_memory);
+    ASSERT(view_read(entry, svf::D1::Entry_fields::reorderFields).one == 0);
+  }
+
+  // Logical compatibility, D0 to D1: values are converted one at a time, and
+  // are the same as after the full conversion.
+  {
+    namespace schema = svf::D1;
+    auto message = write_d0(arena);
+    SVFRT_LazyRead read = {};
+    auto entry = read_lazy<schema::Entry>(&read, arena, message, scratch, memory);
+    ASSERT(read.error_code == 0);
+    ASSERT(read.compatibility_level == SVFRT_compatibility_logical);
+
+    // Flat structs as a whole, and their fields through nested views.
+    auto reorder_fields = view_read(entry, schema::Entry_fields::reorderFields);
+    ASSERT(reorder_fields.one == 42 && reorder_fields.two == 43);
+    auto add_field = view_get(entry, schema::Entry_fields::addField);
+    ASSERT(view_read(add_field, schema::AddField_fields::one) == 68);
+    ASSERT(view_read(add_field, schema::AddField_fields::two) == 0);
+    ASSERT(view_read(add_field, schema::AddField_fields::three) == 69);
+    auto primitives = view_get(entry, schema::Entry_fields::primitives);
+    ASSERT(view_read(primitives, schema::Primitives_fields::u8u16) == 49);
+    ASSERT(view_read(primitives, schema::Primitives_fields::u16i64) == 58);
+    ASSERT(view_read(primitives, schema::Primitives_fields::f32f64) == 67.0);
+
+    // Choices, by tag and payload, or as a whole.
+    ASSERT(view_read(entry, schema::Entry_fields::reorderOptions_tag) == schema::ReorderOptions_tag::one);
+    ASSERT(view_read(entry, schema::Entry_fields::reorderOptions_payload, &schema::ReorderOptions_payload::one) == 44);
+    ASSERT(view_read(entry, schema::Entry_fields::addOption_tag) == schema::AddOption_tag::three);
+    ASSERT(view_read(entry, schema::Entry_fields::addOption_payload, &schema::AddOption_payload::three) == 48);
+    ASSERT(view_read(entry, schema::Entry_fields::removeOption2_tag) == schema::RemoveOption_tag::nothing);
+    ASSERT(view_read(entry, schema::Entry_fields::removeOption2_payload, &schema::RemoveOption_payload::three) == 0);
+    ASSERT(read.error_code == 0);
+
+    // Materialized, same as the full read.
+    auto expected = read_full<schema::Entry>(arena, message, scratch);
+    ASSERT(expected.error_code == 0);
+    auto actual = view_materialize(entry);
+    check_same_struct(&expected, expected.entry, &actual);
+    ASSERT(actual.allocation != NULL);
+
+    // Errors are sticky.
+    U32 value = 1;
+    SVFRT_view_read(add_field.view, 1000, &value, sizeof(value));
+    ASSERT(read.error_code == SVFRT_code_view__field_not_found);
+    ASSERT(value == 0);
+    ASSERT(view_read(add_field, schema::AddField_fields::one) == 0);
+    SVFRT_view_read(add_field.view, 0, &value, sizeof(value));
+    ASSERT(read.error_code == SVFRT_code_view__field_not_found);
+    ASSERT(view_materialize(entry).error_code == SVFRT_code_view__field_not_found);
+  }
+
+  // Logical compatibility, with a memo: materializing the same struct again
+  // returns the first result, without another conversion.
+  {
+    namespace schema = svf::D1;
+    auto message = write_d0(arena);
+    auto memo_memory = vm::many<U8>(arena, SVFRT_lazy_read_memory_size(4));
+    SVFRT_LazyRead read = {};
+    auto entry = read_lazy<schema::Entry>(&read, arena, message, scratch, memo_memory);
+    ASSERT(read.error_code == 0);
+
+    auto first = view_materialize(entry);
+    ASSERT(first.error_code == 0);
+    ASSERT(first.allocation != NULL);
+    auto second = view_materialize(entry);
+    ASSERT(second.error_code == 0);
+    ASSERT(second.allocation == NULL);
+    ASSERT(second.entry == first.entry);
+    ASSERT(second.context.data_range.pointer == first.context.data_range.pointer);
+
+    // A different struct is converted on its own.
+    auto add_field = view_materialize(view_get(entry, schema::Entry_fields::addField));
+    ASSERT(add_field.error_code == 0);
+    ASSERT(add_field.allocation != NULL);
+    ASSERT(add_field.entry->one == 68 && add_field.entry->three == 69);
+  }
+
+  // Fail, with the wrong size.
+  {
+    namespace schema = svf::D1;
+    auto message = write_d0(arena);
+    SVFRT_LazyRead read = {};
+    auto entry = read_lazy<schema::Entry>(&read, arena, message, scratch, memory);
+    U8 value = 1;
+    SVFRT_view_read(entry.view, schema::Entry_fields::primitives.offset, &value, sizeof(value));
+    ASSERT(read.error_code == SVFRT_code_view__size_mismatch);
+    ASSERT(value == 0);
+  }
+
+  // Binary compatibility, A0 to A1: values are read in place, with the larger
+  // src-strides. Materializing does not allocate.
+  {
+    namespace schema = svf::A1;
+    svf::A0::Target targets[3] = { { .value = 1, .y = 2 }, { .value = 3, .y = 4 }, { .value = 5, .y = 6 } };
+    auto message = write_a<svf::A0::Entry>(
+      arena, targets, svf::A0::SomeChoice_tag::target
+    );
+    SVFRT_LazyRead read = {};
+    auto entry = read_lazy<schema::Entry>(&read, arena, message, scratch, memory);
+    ASSERT(read.error_code == 0);
+    ASSERT(read.compatibility_level == SVFRT_compatibility_binary);
+
+    auto reference = view_get(entry, schema::Entry_fields::reference);
+    ASSERT(view_read(reference, schema::Target_fields::value) == 1);
+
+    auto some_struct = view_get(entry, schema::Entry_fields::someStruct);
+    ASSERT(view_count(some_struct, schema::SomeStruct_fields::sequence) == 3);
+    auto element = view_get(some_struct, schema::SomeStruct_fields::sequence, 2);
+    ASSERT(view_read(element, schema::Target_fields::value) == 5);
+    schema::Target elements[2] = {};
+    view_read(some_struct, schema::SomeStruct_fields::sequence, 1, elements, 2);
+    ASSERT(elements[0].value == 3 && elements[1].value == 5);
+
+    ASSERT(view_read(some_struct, schema::SomeStruct_fields::someChoice_tag) == schema::SomeChoice_tag::target);
+    auto payload = view_get(some_struct, schema::SomeStruct_fields::someChoice_payload, &schema::SomeChoice_payload::target);
+    ASSERT(view_read(payload, schema::Target_fields::value) == 3);
+    ASSERT(read.error_code == 0);
+
+    auto expected = read_full<schema::Entry>(arena, message, scratch);
+    ASSERT(expected.error_code == 0);
+    auto actual = view_materialize(entry);
+    check_same_struct(&expected, expected.entry, &actual);
+    ASSERT(actual.entry == expected.entry);
+    ASSERT(actual.allocation == NULL);
+
+    // Fail, out of bounds.
+    view_get(some_struct, schema::SomeStruct_fields::sequence, 3);
+    ASSERT(read.error_code == SVFRT_code_view__index_out_of_bounds);
+  }
+
+  // Logical compatibility, with the prepared schemas: references and sequences
+  // are followed in the src-data, with the src-strides.
+  {
+    auto schema_dst = prepare_schema(arena, 0);
+    PreparedSchemaParams prepare_params = { .change_leading_type = true };
+    auto schema_src = prepare_schema(arena, &prepare_params);
+    PreparedMessageParams message_params = {
+      .sequence_count = 3,
+      .nested_reference_count = 2,
+      .useq_count = 5,
+      .primitive_fill = 0x7F,
+    };
+    auto message = prepare_message(arena, &schema_src, &message_params);
+
+    SVFRT_ReadMessageParams read_params = prepare_read_params(arena, &schema_dst);
+
+    SVFRT_LazyRead read = {};
+    SVFRT_read_message_lazy(
+      &read,
+      &read_params,
+      message,
+      { scratch.pointer, safe_int_cast<U32>(scratch.count) },
+      { memory.pointer, safe_int_cast<U32>(memory.count) }
+    );
+    ASSERT(read.error_code == 0);
+    ASSERT(read.compatibility_level == SVFRT_compatibility_logical);
+
+    U64 leading = 1;
+    SVFRT_view_read(read.entry, 0, &leading, sizeof(leading));
+    ASSERT(leading == 0);
+
+    auto outer = SVFRT_view_reference(read.entry, schema_dst.entry_reference_offset);
+    auto inner = SVFRT_view_reference(outer, 0);
+    ASSERT(inner.unsafe_struct_index_src != UINT32_MAX);
+
+    ASSERT(SVFRT_view_sequence_count(read.entry, schema_dst.entry_sequence_offset) == 3);
+    auto element = SVFRT_view_sequence_element(read.entry, schema_dst.entry_sequence_offset, 2);
+    ASSERT(element.unsafe_struct_index_src != UINT32_MAX);
+
+    ASSERT(SVFRT_view_sequence_count(read.entry, schema_dst.entry_useq_offset) == 5);
+    U8 useq[4] = {};
+    SVFRT_view_sequence_read(read.entry, schema_dst.entry_useq_offset, 1, 4, useq, sizeof(useq));
+    for (U32 i = 0; i < 4; i++) {
+      ASSERT(useq[i] == 0x7F);
+    }
+    ASSERT(read.error_code == 0);
+
+    // Materialized, same as the full read.
+    SVFRT_ReadMessageResult expected = {};
+    SVFRT_read_message(&read_params, &expected, message, { scratch.pointer, safe_int_cast<U32>(scratch.count) });
+    ASSERT(expected.error_code == 0);
+    SVFRT_ReadMessageResult actual = {};
+    SVFRT_view_materialize(read.entry, &actual);
+    ASSERT(actual.error_code == 0);
+    ASSERT(actual.allocation != NULL);
+    ASSERT(memcmp(expected.entry, actual.entry, schema_dst.entry_stride) == 0);
+    ASSERT(actual.context.data_range.count == expected.context.data_range.count);
+    ASSERT(memcmp(
+      actual.context.data_range.pointer,
+      expected.context.data_range.pointer,
+      expected.context.data_range.count
+    ) == 0);
+
+    // Fail, when elements with references are read as values.
+    SVFRT_Reference elements[3] = {};
+    SVFRT_view_sequence_read(read.entry, schema_dst.entry_sequence_offset, 0, 3, elements, sizeof(elements));
+    ASSERT(read.error_code == SVFRT_code_view__not_flat);
+  }
+
+  return 0;
+}
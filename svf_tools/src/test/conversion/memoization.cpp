@@ -0,0 +1,100 @@
+#define SVF_INCLUDE_BINARY_SCHEMA
+#include <src/svf_runtime.hpp>
+#include "common.hpp"
+
+// The reference and the sequence in the converted entry point to the same
+// suballocation.
+void check_shared(SVFRT_ReadMessageResult *result, PreparedSchema *schema_dst) {
+  ASSERT(result->error_code == 0);
+  auto entry = (U8 const *) result->entry;
+  SVFRT_Reference reference = {};
+  SVFRT_Sequence sequence = {};
+  memcpy(&reference, entry + schema_dst->entry_reference_offset, sizeof(reference));
+  memcpy(&sequence, entry + schema_dst->entry_sequence_offset, sizeof(sequence));
+  ASSERT(reference.data_offset_complement != 0);
+  ASSERT(reference.data_offset_complement == sequence.data_offset_complement);
+  ASSERT(sequence.count == 1);
+  ASSERT(SVFRT_read_reference(&result->context, reference, sizeof(SVFRT_Reference)) != NULL);
+}
+
+int main(int /*argc*/, char */*argv*/[]) {
+  auto arena_value = vm::create_linear_arena(1ull << 20);
+  auto arena = &arena_value;
+  auto schema_dst = prepare_schema(arena, 0);
+
+  U8 scratch_buffer[256];
+  SVFRT_Bytes scratch = { .pointer = scratch_buffer, .count = sizeof(scratch_buffer) };
+
+  alignas(8) U8 cache_buffer[1 << 14];
+  SVFRT_CompatibilityCache cache = {};
+  ASSERT(SVFRT_compatibility_cache_init(&cache, { cache_buffer, sizeof(cache_buffer) }, 16) == 0);
+
+  alignas(4) U8 memo_buffer[24 * 16];
+
+  SVFRT_ReadMessageParams default_read_params = prepare_read_params(arena, &schema_dst);
+  default_read_params.conversion_memo = { memo_buffer, sizeof(memo_buffer) };
+
+  PreparedSchemaParams prepare_params = { .change_leading_type = true };
+  auto schema_src = prepare_schema(arena, &prepare_params);
+
+  // The reference points to the only element of the sequence.
+  PreparedMessageParams shared_params = {
+    .sequence_count = 1,
+    .alias_reference_and_sequence = true,
+    .useq_count = 3,
+  };
+  auto shared_message = prepare_message(arena, &schema_src, &shared_params);
+
+  // Fail, without the memo, same as before.
+  {
+    SVFRT_ReadMessageParams read_params = default_read_params;
+    read_params.conversion_memo = {};
+    SVFRT_ReadMessageResult read_result = {};
+    SVFRT_read_message(&read_params, &read_result, shared_message, scratch);
+    ASSERT(read_result.error_code == SVFRT_code_conversion__data_aliasing_detected);
+  }
+
+  // Success, by traversing the schemas.
+  {
+    SVFRT_ReadMessageResult read_result = {};
+    SVFRT_read_message(&default_read_params, &read_result, shared_message, scratch);
+    check_shared(&read_result, &schema_dst);
+  }
+
+  // Success, with a conversion plan, in two phases, and in a single one. The
+  // first read fills the cache with the plan.
+  for (U32 single_pass = 0; single_pass < 2; single_pass++) {
+    SVFRT_ReadMessageParams read_params = default_read_params;
+    read_params.compatibility_cache = &cache;
+    read_params.single_pass_conversion = single_pass != 0;
+    for (U32 i = 0; i < 2; i++) {
+      SVFRT_ReadMessageResult read_result = {};
+      SVFRT_read_message(&read_params, &read_result, shared_message, scratch);
+      check_shared(&read_result, &schema_dst);
+    }
+  }
+
+  // Fail, when the reference only points to a part of the sequence, since
+  // that's not the same range.
+  {
+    PreparedMessageParams message_params = {
+      .sequence_count = 3,
+      .alias_reference_and_sequence = true,
+    };
+    auto message = prepare_message(arena, &schema_src, &message_params);
+    SVFRT_ReadMessageResult read_result = {};
+    SVFRT_read_message(&default_read_params, &read_result, message, scratch);
+    ASSERT(read_result.error_code == SVFRT_code_conversion__data_aliasing_detected);
+  }
+
+  // Fail, when the memo does not fit a single entry.
+  {
+    SVFRT_ReadMessageParams read_params = default_read_params;
+    read_params.conversion_memo = { memo_buffer, 23 };
+    SVFRT_ReadMessageResult read_result = {};
+    SVFRT_read_message(&read_params, &read_result, shared_message, scratch);
+    ASSERT(read_result.error_code == SVFRT_code_conversion__data_aliasing_detected);
+  }
+
+  return 0;
+}
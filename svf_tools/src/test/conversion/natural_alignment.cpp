@@ -0,0 +1,134 @@
+#define SVF_INCLUDE_BINARY_SCHEMA
+#include <src/svf_runtime.hpp>
+#include "common.hpp"
+
+#pragma pack(push, 1)
+struct Packed12 {
+  U32 a;
+  U64 b;
+};
+#pragma pack(pop)
+
+static
+U32 get_offset(SVFRT_Sequence sequence) {
+  return ~sequence.data_offset_complement;
+}
+
+int main(int /*argc*/, char */*argv*/[]) {
+  auto arena_value = vm::create_linear_arena(1ull << 20);
+  auto arena = &arena_value;
+
+  ASSERT(SVFRT_natural_alignment(0) == 1);
+  ASSERT(SVFRT_natural_alignment(1) == 1);
+  ASSERT(SVFRT_natural_alignment(2) == 2);
+  ASSERT(SVFRT_natural_alignment(12) == 4);
+  ASSERT(SVFRT_natural_alignment(16) == 8);
+  ASSERT(SVFRT_natural_alignment(25) == 1);
+
+  // The writer pads data in front of references and sequences.
+  {
+    SVFRT_WriteContext ctx = {};
+    SVFRT_write_start(&ctx, write_arena, arena, 0, {}, {}, 0);
+
+    U8 bytes[3] = { 1, 2, 3 };
+    U64 u64s[2] = { 4, 5 };
+    U32 u32 = 6;
+    U16 u16 = 7;
+    Packed12 packed = { 8, 9 };
+
+    auto bytes_sequence = SVFRT_write_sequence(&ctx, bytes, sizeof(U8), 3);
+    ASSERT(get_offset(bytes_sequence) == 0);
+
+    auto u64_sequence = SVFRT_write_sequence(&ctx, u64s, sizeof(U64), 2);
+    ASSERT(get_offset(u64_sequence) == 8);
+
+    SVFRT_write_sequence(&ctx, bytes, sizeof(U8), 1);
+    SVFRT_Sequence u32_sequence = {};
+    SVFRT_write_sequence_element(&ctx, &u32, sizeof(U32), &u32_sequence);
+    SVFRT_write_sequence_element(&ctx, &u32, sizeof(U32), &u32_sequence);
+    ASSERT(get_offset(u32_sequence) == 28);
+    ASSERT(u32_sequence.count == 2);
+
+    // Empty sequences don't need padding.
+    SVFRT_write_sequence(&ctx, bytes, sizeof(U8), 1);
+    U32 before_empty = ctx.data_bytes_written;
+    SVFRT_write_sequence(&ctx, u64s, sizeof(U64), 0);
+    ASSERT(ctx.data_bytes_written == before_empty);
+
+    auto u16_reference = SVFRT_write_reference(&ctx, &u16, sizeof(U16));
+    ASSERT(~u16_reference.data_offset_complement == 38);
+
+    auto packed_reference = SVFRT_write_reference(&ctx, &packed, sizeof(Packed12));
+    ASSERT(~packed_reference.data_offset_complement == 40);
+
+    ASSERT(ctx.error_code == 0);
+  }
+
+  // Converted data is padded as well, so primitive sequences can be read with
+  // aligned loads, both with one and with two phases.
+  PreparedSchemaParams prepare_params_dst = {
+    .useq_type = svf::Meta::ConcreteType_tag::u64,
+    .iseq_type = svf::Meta::ConcreteType_tag::i32,
+    .fseq_type = svf::Meta::ConcreteType_tag::f64,
+  };
+  auto schema_dst = prepare_schema(arena, &prepare_params_dst);
+  PreparedSchemaParams prepare_params_src = { .change_leading_type = true };
+  auto schema_src = prepare_schema(arena, &prepare_params_src);
+
+  PreparedMessageParams message_params = {
+    .sequence_count = 3,
+    .nested_reference_count = 2,
+    .useq_count = 5,
+    .iseq_count = 3,
+    .fseq_count = 7,
+    .primitive_fill = 0x11,
+  };
+  auto message = prepare_message(arena, &schema_src, &message_params);
+
+  U8 scratch_buffer[256];
+  SVFRT_Bytes scratch = { .pointer = scratch_buffer, .count = sizeof(scratch_buffer) };
+
+  alignas(8) U8 cache_buffer[1 << 14];
+  SVFRT_CompatibilityCache cache = {};
+  ASSERT(SVFRT_compatibility_cache_init(&cache, { cache_buffer, sizeof(cache_buffer) }, 16) == 0);
+
+  SVFRT_ReadMessageParams read_params = prepare_read_params(arena, &schema_dst);
+  read_params.compatibility_cache = &cache;
+
+  for (U32 single_pass = 0; single_pass < 2; single_pass++) {
+    read_params.single_pass_conversion = single_pass != 0;
+    SVFRT_ReadMessageResult read_result = {};
+    SVFRT_read_message(&read_params, &read_result, message, scratch);
+    ASSERT(read_result.error_code == 0);
+    ASSERT(read_result.compatibility_level == SVFRT_compatibility_logical);
+
+    auto entry = (U8 const *) read_result.entry;
+    SVFRT_Sequence useq = {};
+    SVFRT_Sequence iseq = {};
+    SVFRT_Sequence fseq = {};
+    memcpy(&useq, entry + schema_dst.entry_useq_offset, sizeof(useq));
+    memcpy(&iseq, entry + schema_dst.entry_iseq_offset, sizeof(iseq));
+    memcpy(&fseq, entry + schema_dst.entry_fseq_offset, sizeof(fseq));
+
+    auto ctx = &read_result.context;
+    auto u64s = SVFRT_READ_SEQUENCE_ALIGNED(U64, ctx, useq);
+    auto i32s = SVFRT_READ_SEQUENCE_ALIGNED(I32, ctx, iseq);
+    ASSERT(u64s && ((uintptr_t) u64s) % 8 == 0);
+    ASSERT(i32s && ((uintptr_t) i32s) % 4 == 0);
+    ASSERT(u64s[4] == 0x11);
+    ASSERT(i32s[2] == 0x11);
+
+    auto f64s = svf::runtime::read_sequence_aligned(
+      ctx,
+      svf::runtime::Sequence<F64> { fseq.data_offset_complement, fseq.count }
+    );
+    ASSERT(f64s.count == 7);
+    ASSERT(((uintptr_t) f64s.pointer) % 8 == 0);
+
+    // Fail, when misaligned.
+    SVFRT_Sequence misaligned = { ~(get_offset(useq) + 1), 1 };
+    ASSERT(!SVFRT_read_sequence_aligned(ctx, misaligned, sizeof(U64)));
+  }
+
+  return 0;
+}
@@ -0,0 +1,159 @@
+#define SVF_INCLUDE_BINARY_SCHEMA
+#include <src/svf_runtime.hpp>
+#include "common.hpp"
+
+// Two choices in one struct, where the second choice's options are not at the
+// same index in the option-matches table, as the second struct's fields are in
+// the field-matches table. The payload of the second choice is widened, to
+// require a logical conversion. The widened payload also moves the second
+// choice, see #natural-alignment.
+static
+PreparedSchema prepare_choice_schema(vm::LinearArena *arena, Bool wide) {
+  svf::runtime::WriteContext<svf::Meta::SchemaDefinition> ctx = {};
+  ctx.writer_fn = write_arena;
+  ctx.writer_ptr = arena;
+  auto schema_pointer = vm::realign(arena);
+
+  U32 second_payload_size = wide ? sizeof(U16) : sizeof(U8);
+  auto second_payload_type = wide ? svf::Meta::ConcreteType_tag::u16 : svf::Meta::ConcreteType_tag::u8;
+
+  // The tag goes right before the aligned payload.
+  U32 second_offset = safe_int_cast<U32>(
+    align_up(2 + SVFRT_TAG_SIZE, second_payload_size) - SVFRT_TAG_SIZE
+  );
+  U32 entry_offsets[2] = { 0, second_offset };
+
+  svf::Meta::FieldDefinition entry_fields[2] = {};
+  for (U32 i = 0; i < 2; i++) {
+    entry_fields[i].fieldId = 0xFD00 + i; // "FD" for "Field Definition".
+    entry_fields[i].offset = entry_offsets[i];
+    entry_fields[i].type_tag = svf::Meta::Type_tag::concrete;
+    entry_fields[i].type_payload.concrete.type_tag = svf::Meta::ConcreteType_tag::definedChoice;
+    entry_fields[i].type_payload.concrete.type_payload.definedChoice.index = i;
+  }
+  auto entry_fields_sequence = svf::runtime::write_sequence(&ctx, entry_fields, 2);
+
+  svf::Meta::FieldDefinition unused_fields[1] = {};
+  unused_fields[0].fieldId = 0xFD10; // "FD" for "Field Definition".
+  unused_fields[0].type_tag = svf::Meta::Type_tag::concrete;
+  unused_fields[0].type_payload.concrete.type_tag = svf::Meta::ConcreteType_tag::u8;
+  auto unused_fields_sequence = svf::runtime::write_sequence(&ctx, unused_fields, 1);
+
+  svf::Meta::StructDefinition structs[2] = {
+    {
+      .typeId = 0x5D00, // "SD" for "Struct Definition".
+      .size = second_offset + SVFRT_TAG_SIZE + second_payload_size,
+      .alignment = second_payload_size,
+      .fields = entry_fields_sequence,
+    },
+    {
+      .typeId = 0x5D01, // "SD" for "Struct Definition".
+      .size = sizeof(U8),
+      .alignment = alignof(U8),
+      .fields = unused_fields_sequence,
+    },
+  };
+  auto structs_sequence = svf::runtime::write_sequence(&ctx, structs, 2);
+
+  svf::Meta::OptionDefinition first_options[3] = {};
+  for (U32 i = 0; i < 3; i++) {
+    first_options[i].optionId = 0x0D00 + i; // "OD" for "Option Definition".
+    first_options[i].tag = safe_int_cast<U8>(i + 1);
+    first_options[i].type_tag = svf::Meta::Type_tag::concrete;
+    first_options[i].type_payload.concrete.type_tag = svf::Meta::ConcreteType_tag::u8;
+  }
+  auto first_options_sequence = svf::runtime::write_sequence(&ctx, first_options, 3);
+
+  svf::Meta::OptionDefinition second_options[1] = {};
+  second_options[0].optionId = 0x0D10; // "OD" for "Option Definition".
+  second_options[0].tag = 1;
+  second_options[0].type_tag = svf::Meta::Type_tag::concrete;
+  second_options[0].type_payload.concrete.type_tag = second_payload_type;
+  auto second_options_sequence = svf::runtime::write_sequence(&ctx, second_options, 1);
+
+  svf::Meta::ChoiceDefinition choices[2] = {
+    {
+      .typeId = 0xCD00, // "CD" for "Choice Definition".
+      .payloadSize = sizeof(U8),
+      .payloadAlignment = alignof(U8),
+      .options = first_options_sequence,
+    },
+    {
+      .typeId = 0xCD01, // "CD" for "Choice Definition".
+      .payloadSize = second_payload_size,
+      .payloadAlignment = second_payload_size,
+      .options = second_options_sequence,
+    },
+  };
+  auto choices_sequence = svf::runtime::write_sequence(&ctx, choices, 2);
+
+  svf::Meta::SchemaDefinition schema_definition = {
+    .schemaId = 0xEDED, // "ED" for "Entry Definition".
+    .structs = structs_sequence,
+    .choices = choices_sequence,
+  };
+  svf::runtime::write_finish(&ctx, &schema_definition);
+  ASSERT(ctx.finished);
+  ASSERT(ctx.error_code == 0);
+
+  PreparedSchema result = {};
+  result.schema.pointer = (U8 *) schema_pointer;
+  result.schema.count = (U8 *) vm::realign(arena, 1) - (U8 *) schema_pointer;
+
+  auto struct_strides = vm::many<U32>(arena, 2);
+  for (U32 i = 0; i < 2; i++) {
+    struct_strides.pointer[i] = structs[i].size;
+  }
+
+  result.entry_stride = structs[0].size;
+  result.entry_struct_id = structs[0].typeId;
+  result.struct_strides = { struct_strides.pointer, safe_int_cast<U32>(struct_strides.count) };
+  result.schema_content_hash = hash64::begin();
+  hash64::add_bytes(&result.schema_content_hash, {result.schema.pointer, result.schema.count});
+  return result;
+}
+
+int main(int /*argc*/, char */*argv*/[]) {
+  auto arena_value = vm::create_linear_arena(1ull << 20);
+  auto arena = &arena_value;
+  auto schema_dst = prepare_choice_schema(arena, true);
+  auto schema_src = prepare_choice_schema(arena, false);
+
+  U8 scratch_buffer[256];
+  SVFRT_Bytes scratch = { .pointer = scratch_buffer, .count = sizeof(scratch_buffer) };
+
+  SVFRT_ReadMessageParams read_params = prepare_read_params(arena, &schema_dst);
+
+  // Success, and each choice finds its own options.
+  {
+    auto message_pointer = vm::realign(arena);
+    SVFRT_WriteContext ctx;
+    SVFRT_write_start(
+      &ctx,
+      write_arena,
+      arena,
+      schema_src.schema_content_hash,
+      schema_src.schema,
+      {},
+      schema_src.entry_struct_id
+    );
+    U8 entry_src[4] = { 2, 7, 1, 9 };
+    SVFRT_write_finish(&ctx, entry_src, sizeof(entry_src));
+    ASSERT(ctx.finished);
+    ASSERT(ctx.error_code == 0);
+    SVFRT_Bytes message = {
+      .pointer = (U8 *) message_pointer,
+      .count = safe_int_cast<U32>((U8 *) vm::realign(arena, 1) - (U8 *) message_pointer),
+    };
+
+    SVFRT_ReadMessageResult read_result = {};
+    SVFRT_read_message(&read_params, &read_result, message, scratch);
+    ASSERT(read_result.error_code == 0);
+    ASSERT(read_result.compatibility_level == SVFRT_compatibility_logical);
+
+    U8 entry_dst[6] = { 2, 7, 0, 1, 9, 0 };
+    ASSERT(memcmp(read_result.entry, entry_dst, sizeof(entry_dst)) == 0);
+  }
+
+  return 0;
+}
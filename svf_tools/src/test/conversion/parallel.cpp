@@ -0,0 +1,185 @@
+#define SVF_INCLUDE_BINARY_SCHEMA
+#include <src/svf_runtime.hpp>
+#include "common.hpp"
+
+struct SpawnControl {
+  U32 spawn_count;
+  U32 task_count;
+};
+
+// Runs the tasks in reverse, to make sure the order does not matter.
+void spawn_reversed(void *spawn_ptr, SVFRT_TaskFn *task_fn, void *task_ptr, uint32_t task_count) {
+  auto control = (SpawnControl *) spawn_ptr;
+  control->spawn_count++;
+  for (U32 i = task_count; i > 0; i--) {
+    task_fn(task_ptr, i - 1);
+    control->task_count++;
+  }
+}
+
+// Each item of the sequence references a chain of a different length, so that
+// the tasks all start at different tallies.
+static
+SVFRT_Bytes prepare_chains_message(
+  vm::LinearArena *arena,
+  vm::LinearArena *temp_arena,
+  PreparedSchema *schema,
+  U32 item_count,
+  U32 invalid_item
+) {
+  auto items = vm::many<SVFRT_Reference>(temp_arena, item_count);
+  auto entry_buffer = vm::many<U8>(temp_arena, schema->entry_stride);
+
+  auto message_pointer = vm::realign(arena);
+  SVFRT_WriteContext ctx;
+  SVFRT_write_start(
+    &ctx,
+    write_arena,
+    arena,
+    schema->schema_content_hash,
+    schema->schema,
+    {},
+    schema->entry_struct_id
+  );
+
+  // Sequence items must be contiguous, so the chains come first.
+  for (U32 i = 0; i < item_count; i++) {
+    SVFRT_Reference reference = {};
+    for (U32 j = 0; j < i % 5; j++) {
+      reference = SVFRT_write_reference(&ctx, &reference, sizeof(reference));
+    }
+    if (i == invalid_item) {
+      reference.data_offset_complement = 0xDEAD;
+    }
+    items.pointer[i] = reference;
+  }
+  auto sequence = SVFRT_write_sequence(&ctx, items.pointer, sizeof(SVFRT_Reference), item_count);
+
+  memcpy(entry_buffer.pointer + schema->entry_sequence_offset, &sequence, sizeof(sequence));
+  SVFRT_write_finish(&ctx, entry_buffer.pointer, entry_buffer.count);
+  ASSERT(ctx.finished);
+  ASSERT(ctx.error_code == 0);
+
+  return {
+    .pointer = (U8 *) message_pointer,
+    .count = safe_int_cast<U32>((U8 *) vm::realign(arena, 1) - (U8 *) message_pointer),
+  };
+}
+
+static
+void assert_same_bytes(SVFRT_Bytes a, SVFRT_Bytes b) {
+  ASSERT(a.count == b.count);
+  for (U32 i = 0; i < a.count; i++) {
+    ASSERT(a.pointer[i] == b.pointer[i]);
+  }
+}
+
+int main(int /*argc*/, char */*argv*/[]) {
+  auto arena_value = vm::create_linear_arena(1ull << 24);
+  auto arena = &arena_value;
+  auto temp_arena_value = vm::create_linear_arena(1ull << 20);
+  auto temp_arena = &temp_arena_value;
+
+  PreparedSchemaParams prepare_params_dst = {};
+  auto schema_dst = prepare_schema(arena, &prepare_params_dst);
+  PreparedSchemaParams prepare_params_src = { .change_leading_type = true };
+  auto schema_src = prepare_schema(arena, &prepare_params_src);
+
+  U32 item_count = 1000;
+  auto message = prepare_chains_message(arena, temp_arena, &schema_src, item_count, UINT32_MAX);
+
+  U8 scratch_buffer[256];
+  SVFRT_Bytes scratch = { .pointer = scratch_buffer, .count = sizeof(scratch_buffer) };
+
+  alignas(8) U8 cache_buffer[1 << 14];
+  SVFRT_CompatibilityCache cache = {};
+  ASSERT(SVFRT_compatibility_cache_init(&cache, { cache_buffer, sizeof(cache_buffer) }, 16) == 0);
+
+  SVFRT_ReadMessageParams default_read_params = prepare_read_params(arena, &schema_dst);
+  default_read_params.compatibility_cache = &cache;
+
+  // Serial, this also fills the cache with a conversion plan.
+  SVFRT_ReadMessageResult serial_result = {};
+  SVFRT_read_message(&default_read_params, &serial_result, message, scratch);
+  ASSERT(serial_result.error_code == 0);
+  ASSERT(serial_result.compatibility_level == SVFRT_compatibility_logical);
+
+  // Success, and the output is the same as the serial one.
+  {
+    SpawnControl control = {};
+    SVFRT_ReadMessageParams read_params = default_read_params;
+    read_params.conversion_spawn_fn = spawn_reversed;
+    read_params.conversion_spawn_ptr = &control;
+    read_params.conversion_task_count = 8;
+    SVFRT_ReadMessageResult read_result = {};
+    SVFRT_read_message(&read_params, &read_result, message, scratch);
+    ASSERT(read_result.error_code == 0);
+    ASSERT(control.spawn_count == 1);
+    ASSERT(control.task_count == 8);
+    assert_same_bytes(read_result.context.data_range, serial_result.context.data_range);
+  }
+
+  // Success, with as many tasks as possible, limited by the sequence length.
+  {
+    SpawnControl control = {};
+    SVFRT_ReadMessageParams read_params = default_read_params;
+    read_params.conversion_spawn_fn = spawn_reversed;
+    read_params.conversion_spawn_ptr = &control;
+    read_params.conversion_task_count = UINT32_MAX;
+    SVFRT_ReadMessageResult read_result = {};
+    SVFRT_read_message(&read_params, &read_result, message, scratch);
+    ASSERT(read_result.error_code == 0);
+    ASSERT(control.spawn_count == 1);
+    ASSERT(control.task_count > 8 && control.task_count <= SVFRT_MAX_CONVERSION_TASKS);
+    assert_same_bytes(read_result.context.data_range, serial_result.context.data_range);
+  }
+
+  // Success, but nothing is spawned for short sequences.
+  {
+    auto short_message = prepare_chains_message(arena, temp_arena, &schema_src, 10, UINT32_MAX);
+    SpawnControl control = {};
+    SVFRT_ReadMessageParams read_params = default_read_params;
+    read_params.conversion_spawn_fn = spawn_reversed;
+    read_params.conversion_spawn_ptr = &control;
+    read_params.conversion_task_count = 8;
+    SVFRT_ReadMessageResult read_result = {};
+    SVFRT_read_message(&read_params, &read_result, short_message, scratch);
+    ASSERT(read_result.error_code == 0);
+    ASSERT(control.spawn_count == 0);
+  }
+
+  // Success, but nothing is spawned without a conversion plan.
+  {
+    SpawnControl control = {};
+    SVFRT_ReadMessageParams read_params = default_read_params;
+    read_params.compatibility_cache = NULL;
+    read_params.conversion_spawn_fn = spawn_reversed;
+    read_params.conversion_spawn_ptr = &control;
+    read_params.conversion_task_count = 8;
+    SVFRT_ReadMessageResult read_result = {};
+    SVFRT_read_message(&read_params, &read_result, message, scratch);
+    ASSERT(read_result.error_code == 0);
+    ASSERT(control.spawn_count == 0);
+    assert_same_bytes(read_result.context.data_range, serial_result.context.data_range);
+  }
+
+  // Fail, when the data is out of bounds in a late task, same as serially.
+  {
+    auto invalid_message = prepare_chains_message(arena, temp_arena, &schema_src, item_count, item_count - 3);
+
+    SVFRT_ReadMessageResult serial_invalid_result = {};
+    SVFRT_read_message(&default_read_params, &serial_invalid_result, invalid_message, scratch);
+    ASSERT(serial_invalid_result.error_code == SVFRT_code_conversion__data_out_of_bounds);
+
+    SpawnControl control = {};
+    SVFRT_ReadMessageParams read_params = default_read_params;
+    read_params.conversion_spawn_fn = spawn_reversed;
+    read_params.conversion_spawn_ptr = &control;
+    read_params.conversion_task_count = 8;
+    SVFRT_ReadMessageResult read_result = {};
+    SVFRT_read_message(&read_params, &read_result, invalid_message, scratch);
+    ASSERT(read_result.error_code == serial_invalid_result.error_code);
+  }
+
+  return 0;
+}
@@ -0,0 +1,170 @@
+#define SVF_INCLUDE_BINARY_SCHEMA
+#include <src/svf_internal.h>
+#include "common.hpp"
+
+// Read the message twice: the first read converts by traversal and caches the
+// result, the second one uses the compiled conversion plan. Both must agree.
+static
+SVFRT_ErrorCode read_twice(
+  SVFRT_ReadMessageParams *read_params,
+  PreparedSchema *schema_src,
+  SVFRT_Bytes message,
+  SVFRT_Bytes scratch
+) {
+  SVFRT_ReadMessageResult traversal_result = {};
+  SVFRT_read_message(read_params, &traversal_result, message, scratch);
+
+  // The plan must be present now.
+  SVFRT_CompatibilityResult check_result = {};
+  Bool found = SVFRT_compatibility_cache_lookup(
+    read_params->compatibility_cache,
+    &check_result,
+    { message.pointer + sizeof(SVFRT_MessageHeader), schema_src->schema.count },
+    read_params->expected_schema,
+    schema_src->schema_content_hash,
+    read_params->expected_schema_content_hash,
+    read_params->entry_struct_id,
+    read_params->required_level,
+    read_params->max_schema_work
+  );
+  ASSERT(found);
+  ASSERT(check_result.error_code == 0);
+  ASSERT(check_result.level == SVFRT_compatibility_logical);
+  ASSERT(check_result.logical.conversion_plan.count > 0);
+
+  SVFRT_ReadMessageResult plan_result = {};
+  SVFRT_read_message(read_params, &plan_result, message, scratch);
+
+  ASSERT(plan_result.error_code == traversal_result.error_code);
+  if (traversal_result.error_code == 0) {
+    auto traversal_bytes = traversal_result.context.data_range;
+    auto plan_bytes = plan_result.context.data_range;
+    ASSERT(traversal_bytes.count == plan_bytes.count);
+    for (U32 i = 0; i < traversal_bytes.count; i++) {
+      ASSERT(traversal_bytes.pointer[i] == plan_bytes.pointer[i]);
+    }
+  }
+
+  return plan_result.error_code;
+}
+
+int main(int /*argc*/, char */*argv*/[]) {
+  auto arena_value = vm::create_linear_arena(1ull << 20);
+  auto arena = &arena_value;
+
+  PreparedSchemaParams prepare_params_dst = {
+    .useq_type = svf::Meta::ConcreteType_tag::u64,
+    .iseq_type = svf::Meta::ConcreteType_tag::i64,
+    .fseq_type = svf::Meta::ConcreteType_tag::f64,
+  };
+  auto schema_dst = prepare_schema(arena, &prepare_params_dst);
+
+  U8 scratch_buffer[256];
+  SVFRT_Bytes scratch = { .pointer = scratch_buffer, .count = sizeof(scratch_buffer) };
+
+  SVFRT_ReadMessageParams default_read_params = prepare_read_params(arena, &schema_dst);
+
+  // Fresh cache for each case, so that the first read always misses.
+  alignas(8) U8 cache_buffer[1 << 14];
+  SVFRT_CompatibilityCache cache = {};
+  default_read_params.compatibility_cache = &cache;
+
+  // Success, when sequences of primitives get widened, including sign extension.
+  {
+    ASSERT(SVFRT_compatibility_cache_init(&cache, { cache_buffer, sizeof(cache_buffer) }, 16) == 0);
+    PreparedSchemaParams prepare_params = { .change_leading_type = true };
+    auto schema_src = prepare_schema(arena, &prepare_params);
+    PreparedMessageParams message_params = {
+      .sequence_count = 3,
+      .nested_reference_count = 2,
+      .useq_count = 5,
+      .iseq_count = 6,
+      .fseq_count = 7,
+      .primitive_fill = 0xFF,
+    };
+    auto message = prepare_message(arena, &schema_src, &message_params);
+    ASSERT(read_twice(&default_read_params, &schema_src, message, scratch) == 0);
+
+    SVFRT_ReadMessageResult read_result = {};
+    SVFRT_read_message(&default_read_params, &read_result, message, scratch);
+    ASSERT(read_result.error_code == 0);
+
+    auto entry = (U8 const *) read_result.entry;
+    SVFRT_Sequence useq = {};
+    SVFRT_Sequence iseq = {};
+    memcpy(&useq, entry + schema_dst.entry_useq_offset, sizeof(useq));
+    memcpy(&iseq, entry + schema_dst.entry_iseq_offset, sizeof(iseq));
+    ASSERT(useq.count == 5);
+    ASSERT(iseq.count == 6);
+
+    auto useq_pointer = (U8 const *) SVFRT_read_sequence_raw(&read_result.context, useq, sizeof(U64));
+    auto iseq_pointer = (U8 const *) SVFRT_read_sequence_raw(&read_result.context, iseq, sizeof(I64));
+    ASSERT(useq_pointer && iseq_pointer);
+    for (U32 i = 0; i < useq.count; i++) {
+      U64 value = 0;
+      memcpy(&value, useq_pointer + i * sizeof(U64), sizeof(value));
+      ASSERT(value == 0xFF);
+    }
+    for (U32 i = 0; i < iseq.count; i++) {
+      I64 value = 0;
+      memcpy(&value, iseq_pointer + i * sizeof(I64), sizeof(value));
+      ASSERT(value == -1);
+    }
+  }
+
+  // Success, when primitive sequences are copied as-is.
+  {
+    ASSERT(SVFRT_compatibility_cache_init(&cache, { cache_buffer, sizeof(cache_buffer) }, 16) == 0);
+    PreparedSchemaParams prepare_params = {
+      .change_leading_type = true,
+      .useq_type = svf::Meta::ConcreteType_tag::u64,
+      .iseq_type = svf::Meta::ConcreteType_tag::i64,
+      .fseq_type = svf::Meta::ConcreteType_tag::f64,
+    };
+    auto schema_src = prepare_schema(arena, &prepare_params);
+    PreparedMessageParams message_params = {
+      .sequence_count = 4,
+      .useq_count = 3,
+      .iseq_count = 3,
+      .fseq_count = 3,
+      .primitive_fill = 0x3F,
+    };
+    auto message = prepare_message(arena, &schema_src, &message_params);
+    ASSERT(read_twice(&default_read_params, &schema_src, message, scratch) == 0);
+  }
+
+  // Fail, when a sequence is out of bounds.
+  {
+    ASSERT(SVFRT_compatibility_cache_init(&cache, { cache_buffer, sizeof(cache_buffer) }, 16) == 0);
+    PreparedSchemaParams prepare_params = { .change_leading_type = true };
+    auto schema_src = prepare_schema(arena, &prepare_params);
+    PreparedMessageParams message_params = { .useq_count = 1, .useq_invalid = true };
+    auto message = prepare_message(arena, &schema_src, &message_params);
+    ASSERT(read_twice(&default_read_params, &schema_src, message, scratch) == SVFRT_code_conversion__data_out_of_bounds);
+  }
+
+  // Success, right at the recursion limit.
+  {
+    ASSERT(SVFRT_compatibility_cache_init(&cache, { cache_buffer, sizeof(cache_buffer) }, 16) == 0);
+    PreparedSchemaParams prepare_params = { .change_leading_type = true };
+    auto schema_src = prepare_schema(arena, &prepare_params);
+    PreparedMessageParams message_params = { .nested_reference_count = 255 };
+    auto message = prepare_message(arena, &schema_src, &message_params);
+    ASSERT(read_twice(&default_read_params, &schema_src, message, scratch) == 0);
+  }
+
+  // Fail, when nested references are too deep.
+  {
+    ASSERT(SVFRT_compatibility_cache_init(&cache, { cache_buffer, sizeof(cache_buffer) }, 16) == 0);
+    PreparedSchemaParams prepare_params = { .change_leading_type = true };
+    auto schema_src = prepare_schema(arena, &prepare_params);
+    PreparedMessageParams message_params = { .nested_reference_count = 256 };
+    auto message = prepare_message(arena, &schema_src, &message_params);
+    ASSERT(
+      read_twice(&default_read_params, &schema_src, message, scratch)
+      == SVFRT_code_conversion__max_recursion_depth_exceeded
+    );
+  }
+
+  return 0;
+}
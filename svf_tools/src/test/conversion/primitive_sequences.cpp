@@ -0,0 +1,99 @@
+#define SVF_INCLUDE_BINARY_SCHEMA
+#include <src/svf_runtime.hpp>
+#include "common.hpp"
+
+// Expected value of a converted sequence item, when every src-byte is `fill`.
+template<typename S, typename D>
+static
+D expected_value(U8 fill) {
+  S value_src;
+  memset(&value_src, fill, sizeof(value_src));
+  return (D) value_src;
+}
+
+template<typename S, typename D>
+static
+void check_sequence(
+  vm::LinearArena *arena,
+  svf::Meta::ConcreteType_tag type_src,
+  svf::Meta::ConcreteType_tag type_dst
+) {
+  // Long enough for any vector width, with a remainder for the scalar loop.
+  U32 count = 67;
+  U8 fill = 0x81;
+
+  PreparedSchemaParams prepare_params_dst = { .useq_type = type_dst };
+  auto schema_dst = prepare_schema(arena, &prepare_params_dst);
+  PreparedSchemaParams prepare_params_src = { .change_leading_type = true, .useq_type = type_src };
+  auto schema_src = prepare_schema(arena, &prepare_params_src);
+  ASSERT(schema_src.useq_size == sizeof(S));
+  ASSERT(schema_dst.useq_size == sizeof(D));
+
+  PreparedMessageParams message_params = { .useq_count = count, .primitive_fill = fill };
+  auto message = prepare_message(arena, &schema_src, &message_params);
+
+  U8 scratch_buffer[256];
+  SVFRT_Bytes scratch = { .pointer = scratch_buffer, .count = sizeof(scratch_buffer) };
+
+  SVFRT_ReadMessageParams read_params = prepare_read_params(arena, &schema_dst);
+
+  SVFRT_ReadMessageResult read_result = {};
+  SVFRT_read_message(&read_params, &read_result, message, scratch);
+  ASSERT(read_result.error_code == 0);
+  ASSERT(read_result.compatibility_level == SVFRT_compatibility_logical);
+
+  SVFRT_Sequence useq = {};
+  memcpy(&useq, (U8 const *) read_result.entry + schema_dst.entry_useq_offset, sizeof(useq));
+  ASSERT(useq.count == count);
+
+  auto pointer = (U8 const *) SVFRT_read_sequence_raw(&read_result.context, useq, sizeof(D));
+  ASSERT(pointer);
+
+  D expected = expected_value<S, D>(fill);
+  for (U32 i = 0; i < count; i++) {
+    D value;
+    memcpy(&value, pointer + i * sizeof(D), sizeof(D));
+    ASSERT(memcmp(&value, &expected, sizeof(D)) == 0);
+  }
+}
+
+int main(int /*argc*/, char */*argv*/[]) {
+  auto arena_value = vm::create_linear_arena(1ull << 20);
+  auto arena = &arena_value;
+
+  using Tag = svf::Meta::ConcreteType_tag;
+
+  // Success, when types match exactly.
+  check_sequence<U8, U8>(arena, Tag::u8, Tag::u8);
+  check_sequence<I32, I32>(arena, Tag::i32, Tag::i32);
+  check_sequence<F64, F64>(arena, Tag::f64, Tag::f64);
+
+  // Success, when unsigned integers are widened.
+  check_sequence<U8, U16>(arena, Tag::u8, Tag::u16);
+  check_sequence<U8, U32>(arena, Tag::u8, Tag::u32);
+  check_sequence<U8, U64>(arena, Tag::u8, Tag::u64);
+  check_sequence<U16, U32>(arena, Tag::u16, Tag::u32);
+  check_sequence<U16, U64>(arena, Tag::u16, Tag::u64);
+  check_sequence<U32, U64>(arena, Tag::u32, Tag::u64);
+
+  // Success, when signed integers are widened.
+  check_sequence<I8, I16>(arena, Tag::i8, Tag::i16);
+  check_sequence<I8, I32>(arena, Tag::i8, Tag::i32);
+  check_sequence<I8, I64>(arena, Tag::i8, Tag::i64);
+  check_sequence<I16, I32>(arena, Tag::i16, Tag::i32);
+  check_sequence<I16, I64>(arena, Tag::i16, Tag::i64);
+  check_sequence<I32, I64>(arena, Tag::i32, Tag::i64);
+
+  // Success, when unsigned integers are widened to signed ones.
+  check_sequence<U8, I16>(arena, Tag::u8, Tag::i16);
+  check_sequence<U8, I32>(arena, Tag::u8, Tag::i32);
+  check_sequence<U8, I64>(arena, Tag::u8, Tag::i64);
+  check_sequence<U16, I32>(arena, Tag::u16, Tag::i32);
+  check_sequence<U16, I64>(arena, Tag::u16, Tag::i64);
+  check_sequence<U32, I64>(arena, Tag::u32, Tag::i64);
+
+  // Success, when floats are widened.
+  check_sequence<F32, F64>(arena, Tag::f32, Tag::f64);
+
+  return 0;
+}
@@ -0,0 +1,217 @@
+#define SVF_INCLUDE_BINARY_SCHEMA
+#include <src/svf_runtime.hpp>
+#include "common.hpp"
+
+static
+void check_same(SVFRT_ReadMessageResult *expected, SVFRT_ReadMessageResult *actual) {
+  ASSERT(actual->error_code == expected->error_code);
+  ASSERT(actual->compatibility_level == expected->compatibility_level);
+  if (expected->error_code != 0) {
+    return;
+  }
+
+  auto expected_bytes = expected->context.data_range;
+  auto actual_bytes = actual->context.data_range;
+  ASSERT(expected_bytes.count == actual_bytes.count);
+  for (U32 i = 0; i < expected_bytes.count; i++) {
+    ASSERT(expected_bytes.pointer[i] == actual_bytes.pointer[i]);
+  }
+  ASSERT(
+    (U8 *) expected->entry - expected_bytes.pointer ==
+    (U8 *) actual->entry - actual_bytes.pointer
+  );
+}
+
+// Read the message with `SVFRT_read_message`, and then resumably, `budget`
+// at a time. Both must agree. Returns the number of steps taken.
+static
+U32 read_both(
+  SVFRT_ReadMessageParams *read_params,
+  SVFRT_Bytes message,
+  SVFRT_Bytes scratch,
+  SVFRT_Bytes memory,
+  U32 budget,
+  SVFRT_ErrorCode expected_error_code
+) {
+  SVFRT_ReadMessageResult expected_result = {};
+  SVFRT_read_message(read_params, &expected_result, message, scratch);
+  ASSERT(expected_result.error_code == expected_error_code);
+
+  SVFRT_ResumableRead read = {};
+  SVFRT_read_message_begin(&read, read_params, message, scratch, memory);
+  U32 step_count = 0;
+  while (!SVFRT_read_message_step(&read, budget)) {
+    step_count++;
+  }
+  ASSERT(read.done);
+
+  SVFRT_ReadMessageResult actual_result = {};
+  SVFRT_read_message_finish(&read, &actual_result);
+  check_same(&expected_result, &actual_result);
+  return step_count;
+}
+
+int main(int /*argc*/, char */*argv*/[]) {
+  auto arena_value = vm::create_linear_arena(1ull << 24);
+  auto arena = &arena_value;
+  auto schema_dst = prepare_schema(arena, 0);
+
+  U8 scratch_buffer[256];
+  SVFRT_Bytes scratch = { .pointer = scratch_buffer, .count = sizeof(scratch_buffer) };
+
+  alignas(8) U8 cache_buffer[1 << 14];
+  SVFRT_CompatibilityCache cache = {};
+  ASSERT(SVFRT_compatibility_cache_init(&cache, { cache_buffer, sizeof(cache_buffer) }, 16) == 0);
+
+  alignas(4) U8 memo_buffer[24 * 16];
+
+  SVFRT_ReadMessageParams default_read_params = prepare_read_params(arena, &schema_dst);
+
+  U32 memory_size = SVFRT_resumable_read_memory_size(SVFRT_DEFAULT_MAX_RECURSION_DEPTH);
+  ASSERT(memory_size > SVFRT_conversion_stack_size(SVFRT_DEFAULT_MAX_RECURSION_DEPTH));
+  ASSERT(SVFRT_resumable_read_memory_size(UINT32_MAX) == UINT32_MAX);
+  auto memory_value = vm::many<U8>(arena, memory_size + 1);
+  SVFRT_Bytes memory = { .pointer = memory_value.pointer, .count = memory_size };
+
+  PreparedSchemaParams prepare_params = { .change_leading_type = true };
+  auto schema_src = prepare_schema(arena, &prepare_params);
+  PreparedMessageParams message_params = {
+    .sequence_count = 5,
+    .nested_reference_count = 4,
+    .useq_count = 5,
+    .iseq_count = 6,
+    .fseq_count = 7,
+    .primitive_fill = 0x7F,
+  };
+  auto message = prepare_message(arena, &schema_src, &message_params);
+
+  // Success, with any budget. Smaller budgets take more steps.
+  {
+    U32 steps_1 = read_both(&default_read_params, message, scratch, memory, 1, 0);
+    U32 steps_4 = read_both(&default_read_params, message, scratch, memory, 4, 0);
+    U32 steps_max = read_both(&default_read_params, message, scratch, memory, UINT32_MAX, 0);
+    ASSERT(steps_1 > steps_4);
+    ASSERT(steps_4 > steps_max);
+    ASSERT(steps_max == 0);
+  }
+
+  // Success, with unaligned memory.
+  {
+    SVFRT_Bytes unaligned = { .pointer = memory_value.pointer + 1, .count = memory_size };
+    read_both(&default_read_params, message, scratch, unaligned, 3, 0);
+  }
+
+  // Success, same as with a conversion plan from the cache, which is not used
+  // when resuming. The first read fills the cache with the plan.
+  {
+    SVFRT_ReadMessageParams read_params = default_read_params;
+    read_params.compatibility_cache = &cache;
+    for (U32 i = 0; i < 2; i++) {
+      read_both(&read_params, message, scratch, memory, 2, 0);
+    }
+  }
+
+  // Success, with shared data and a memo.
+  {
+    SVFRT_ReadMessageParams read_params = default_read_params;
+    read_params.conversion_memo = { memo_buffer, sizeof(memo_buffer) };
+    PreparedMessageParams shared_params = {
+      .sequence_count = 1,
+      .alias_reference_and_sequence = true,
+      .useq_count = 3,
+    };
+    auto shared_message = prepare_message(arena, &schema_src, &shared_params);
+    read_both(&read_params, shared_message, scratch, memory, 1, 0);
+  }
+
+  // Success, with two reads in progress at the same time.
+  {
+    auto other_memory_value = vm::many<U8>(arena, memory_size);
+    SVFRT_Bytes other_memory = { .pointer = other_memory_value.pointer, .count = memory_size };
+
+    SVFRT_ReadMessageResult expected_result = {};
+    SVFRT_read_message(&default_read_params, &expected_result, message, scratch);
+
+    SVFRT_ResumableRead reads[2] = {};
+    SVFRT_read_message_begin(&reads[0], &default_read_params, message, scratch, memory);
+    SVFRT_read_message_begin(&reads[1], &default_read_params, message, scratch, other_memory);
+    bool done[2] = {};
+    while (!done[0] || !done[1]) {
+      done[0] = SVFRT_read_message_step(&reads[0], 1);
+      done[1] = SVFRT_read_message_step(&reads[1], 2);
+    }
+    for (U32 i = 0; i < 2; i++) {
+      SVFRT_ReadMessageResult result = {};
+      SVFRT_read_message_finish(&reads[i], &result);
+      check_same(&expected_result, &result);
+    }
+  }
+
+  // Success, when finishing early, which does the rest.
+  {
+    SVFRT_ReadMessageResult expected_result = {};
+    SVFRT_read_message(&default_read_params, &expected_result, message, scratch);
+
+    SVFRT_ResumableRead read = {};
+    SVFRT_read_message_begin(&read, &default_read_params, message, scratch, memory);
+    ASSERT(!SVFRT_read_message_step(&read, 1));
+    ASSERT(read.result.allocation == NULL);
+    SVFRT_ReadMessageResult result = {};
+    SVFRT_read_message_finish(&read, &result);
+    check_same(&expected_result, &result);
+  }
+
+  // Success, done right away, without a conversion.
+  {
+    auto exact_message = prepare_message(arena, &schema_dst, &message_params);
+    SVFRT_ResumableRead read = {};
+    SVFRT_read_message_begin(&read, &default_read_params, exact_message, scratch, memory);
+    ASSERT(read.done);
+    ASSERT(read.result.error_code == 0);
+    ASSERT(read.result.compatibility_level == SVFRT_compatibility_exact);
+    ASSERT(read_both(&default_read_params, exact_message, scratch, memory, 1, 0) == 0);
+  }
+
+  // Fail, same as `SVFRT_read_message`, when nested references are too deep.
+  {
+    PreparedMessageParams deep_params = { .nested_reference_count = 256 };
+    auto deep_message = prepare_message(arena, &schema_src, &deep_params);
+    read_both(
+      &default_read_params,
+      deep_message,
+      scratch,
+      memory,
+      16,
+      SVFRT_code_conversion__max_recursion_depth_exceeded
+    );
+  }
+
+  // Fail, same as `SVFRT_read_message`, when the output is too large, which
+  // is only known at the end of the first phase.
+  {
+    SVFRT_ReadMessageParams read_params = default_read_params;
+    read_params.max_output_size = 64;
+    read_both(&read_params, message, scratch, memory, 1, SVFRT_code_conversion__total_data_size_limit_exceeded);
+  }
+
+  // Fail, when the memory is too small.
+  {
+    SVFRT_ResumableRead read = {};
+    SVFRT_read_message_begin(&read, &default_read_params, message, scratch, { memory.pointer, 16 });
+    ASSERT(read.done);
+    ASSERT(read.result.error_code == SVFRT_code_read__not_enough_resumable_memory);
+  }
+
+  // Fail, when the stack part of the memory is too small, which depends on
+  // the message.
+  {
+    SVFRT_ResumableRead read = {};
+    SVFRT_Bytes small = { memory.pointer, SVFRT_resumable_read_memory_size(0) };
+    SVFRT_read_message_begin(&read, &default_read_params, message, scratch, small);
+    SVFRT_ReadMessageResult result = {};
+    SVFRT_read_message_finish(&read, &result);
+    ASSERT(result.error_code == SVFRT_code_conversion__not_enough_stack_memory);
+  }
+
+  return 0;
+}
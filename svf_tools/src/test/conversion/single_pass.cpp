@@ -0,0 +1,94 @@
+#define SVF_INCLUDE_BINARY_SCHEMA
+#include <src/svf_runtime.hpp>
+#include "common.hpp"
+
+int main(int /*argc*/, char */*argv*/[]) {
+  auto arena_value = vm::create_linear_arena(1ull << 20);
+  auto arena = &arena_value;
+
+  PreparedSchemaParams prepare_params_dst = {
+    .useq_type = svf::Meta::ConcreteType_tag::u64,
+    .iseq_type = svf::Meta::ConcreteType_tag::i64,
+    .fseq_type = svf::Meta::ConcreteType_tag::f64,
+  };
+  auto schema_dst = prepare_schema(arena, &prepare_params_dst);
+
+  U8 scratch_buffer[256];
+  SVFRT_Bytes scratch = { .pointer = scratch_buffer, .count = sizeof(scratch_buffer) };
+
+  alignas(8) U8 cache_buffer[1 << 14];
+  SVFRT_CompatibilityCache cache = {};
+  ASSERT(SVFRT_compatibility_cache_init(&cache, { cache_buffer, sizeof(cache_buffer) }, 16) == 0);
+
+  SVFRT_ReadMessageParams default_read_params = prepare_read_params(arena, &schema_dst);
+  default_read_params.compatibility_cache = &cache;
+
+  PreparedSchemaParams prepare_params = { .change_leading_type = true };
+  auto schema_src = prepare_schema(arena, &prepare_params);
+  PreparedMessageParams message_params = {
+    .sequence_count = 3,
+    .nested_reference_count = 4,
+    .useq_count = 5,
+    .iseq_count = 6,
+    .fseq_count = 7,
+    .primitive_fill = 0xFF,
+  };
+  auto message = prepare_message(arena, &schema_src, &message_params);
+
+  // Two phases, this also fills the cache with a conversion plan.
+  SVFRT_ReadMessageResult two_pass_result = {};
+  SVFRT_read_message(&default_read_params, &two_pass_result, message, scratch);
+  ASSERT(two_pass_result.error_code == 0);
+  U32 output_size = two_pass_result.context.data_range.count;
+
+  // Success, and the output is the same as with two phases.
+  {
+    SVFRT_ReadMessageParams read_params = default_read_params;
+    read_params.single_pass_conversion = true;
+    SVFRT_ReadMessageResult read_result = {};
+    SVFRT_read_message(&read_params, &read_result, message, scratch);
+    ASSERT(read_result.error_code == 0);
+
+    auto two_pass_bytes = two_pass_result.context.data_range;
+    auto single_pass_bytes = read_result.context.data_range;
+    ASSERT(single_pass_bytes.count == two_pass_bytes.count);
+    ASSERT(read_result.allocation == single_pass_bytes.pointer);
+    for (U32 i = 0; i < two_pass_bytes.count; i++) {
+      ASSERT(two_pass_bytes.pointer[i] == single_pass_bytes.pointer[i]);
+    }
+  }
+
+  // Success, right at the output size limit.
+  {
+    SVFRT_ReadMessageParams read_params = default_read_params;
+    read_params.single_pass_conversion = true;
+    read_params.max_output_size = output_size;
+    SVFRT_ReadMessageResult read_result = {};
+    SVFRT_read_message(&read_params, &read_result, message, scratch);
+    ASSERT(read_result.error_code == 0);
+    ASSERT(read_result.context.data_range.count == output_size);
+  }
+
+  // Fail, when the output size limit is exceeded.
+  {
+    SVFRT_ReadMessageParams read_params = default_read_params;
+    read_params.single_pass_conversion = true;
+    read_params.max_output_size = output_size - 1;
+    SVFRT_ReadMessageResult read_result = {};
+    SVFRT_read_message(&read_params, &read_result, message, scratch);
+    ASSERT(read_result.error_code == SVFRT_code_conversion__total_data_size_limit_exceeded);
+  }
+
+  // Fail, when the data is out of bounds.
+  {
+    PreparedMessageParams invalid_message_params = { .useq_count = 1, .useq_invalid = true };
+    auto invalid_message = prepare_message(arena, &schema_src, &invalid_message_params);
+    SVFRT_ReadMessageParams read_params = default_read_params;
+    read_params.single_pass_conversion = true;
+    SVFRT_ReadMessageResult read_result = {};
+    SVFRT_read_message(&read_params, &read_result, invalid_message, scratch);
+    ASSERT(read_result.error_code == SVFRT_code_conversion__data_out_of_bounds);
+  }
+
+  return 0;
+}
@@ -53,8 +53,9 @@ int main(int /*argc*/, char */*argv*/[]) {
     SVFRT_ReadMessageResult read_result = {};
     SVFRT_ReadMessageParams read_params = default_read_params;
 
-    // TODO @proper-alignment: the test will probably break here.
-    read_params.max_output_size = schema_dst.entry_stride + sizeof(SVFRT_Reference);
+    // The entry is padded up to its #natural-alignment (of the leading `U64`)
+    // after the sequence element.
+    read_params.max_output_size = schema_dst.entry_stride + align_up(sizeof(SVFRT_Reference), sizeof(U64));
 
     SVFRT_read_message(&read_params, &read_result, message, scratch);
     ASSERT(read_result.error_code == 0);
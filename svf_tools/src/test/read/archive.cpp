@@ -0,0 +1,221 @@
+#include <cstdio>
+#include <src/library.hpp>
+#define SVF_INCLUDE_BINARY_SCHEMA
+#include <src/svf_runtime.hpp>
+#include <src/svf_mmap.h>
+#include <generated/hpp/A0.hpp>
+
+namespace schema = svf::A0;
+
+U32 write_arena(void *it, SVFRT_Bytes src) {
+  auto arena = (vm::LinearArena *) it;
+  auto dst = vm::many<U8>(arena, src.count);
+  range_copy(dst, {src.pointer, src.count});
+  return safe_int_cast<U32>(src.count);
+};
+
+struct ReadAheadControl {
+  U32 call_count;
+  U64 bytes_requested;
+};
+
+void read_ahead_counting(void *it, SVFRT_Bytes range) {
+  auto control = (ReadAheadControl *) it;
+  control->call_count++;
+  control->bytes_requested += range.count;
+}
+
+void write_record(svf::runtime::ArchiveWriter *writer, U64 value) {
+  auto ctx = svf::runtime::archive_record_start<schema::Entry>(writer);
+  schema::Target targets[2] = {
+    { .value = value, .y = 1 },
+    { .value = value, .y = 2 },
+  };
+  schema::Entry entry = {};
+  entry.reference = svf::runtime::write_reference(&ctx, &targets[0]);
+  entry.someStruct.sequence = svf::runtime::write_fixed_size_array(&ctx, targets);
+  svf::runtime::write_finish(&ctx, &entry);
+  SVFRT_archive_record_finish(writer, &ctx);
+}
+
+int main(int /*argc*/, char */*argv*/[]) {
+  auto arena_value = vm::create_linear_arena(1ull << 20);
+  auto arena = &arena_value;
+
+  // Prepare: an archive of a few records with the same schema.
+  U32 record_count = 5;
+  SVFRT_ArchiveSchema schemas[2];
+  SVFRT_ArchiveRecord records[5];
+  auto archive_pointer = (U8 *) vm::realign(arena);
+  auto waterline_before = arena->waterline;
+  {
+    svf::runtime::ArchiveWriter writer = {};
+    SVFRT_archive_write_start(&writer, write_arena, arena, schemas, 2, records, record_count);
+    for (U32 i = 0; i < record_count; i++) {
+      write_record(&writer, 100 + i);
+    }
+    ASSERT(SVFRT_archive_write_finish(&writer) == 0);
+    ASSERT(writer.schema_count == 1);
+    ASSERT(writer.record_count == record_count);
+  }
+  SVFRT_Bytes file = {
+    archive_pointer,
+    safe_int_cast<U32>(arena->waterline - waterline_before),
+  };
+
+  // Fail to write, when the index is full.
+  {
+    SVFRT_ArchiveRecord small_records[1];
+    svf::runtime::ArchiveWriter writer = {};
+    SVFRT_archive_write_start(&writer, write_arena, arena, schemas, 2, small_records, 1);
+    write_record(&writer, 1);
+    write_record(&writer, 2);
+    ASSERT(SVFRT_archive_write_finish(&writer) == SVFRT_code_archive__index_full);
+  }
+
+  // Fail to write, when a record was not finished.
+  {
+    svf::runtime::ArchiveWriter writer = {};
+    SVFRT_archive_write_start(&writer, write_arena, arena, schemas, 2, records, record_count);
+    auto ctx = svf::runtime::archive_record_start<schema::Entry>(&writer);
+    SVFRT_archive_record_finish(&writer, &ctx);
+    ASSERT(SVFRT_archive_write_finish(&writer) == SVFRT_code_archive__record_not_finished);
+  }
+
+  // Fail to open, when not aligned.
+  {
+    SVFRT_Archive archive = {};
+    ASSERT(SVFRT_archive_open(&archive, { file.pointer + 1, file.count - 1 }) == SVFRT_code_archive__not_aligned);
+  }
+
+  // Fail to open, when truncated, since the footer is gone.
+  {
+    SVFRT_Archive archive = {};
+    ASSERT(SVFRT_archive_open(&archive, { file.pointer, file.count - 8 }) == SVFRT_code_archive__malformed);
+  }
+
+  // Success, reading records by number.
+  {
+    SVFRT_Archive archive = {};
+    ASSERT(SVFRT_archive_open(&archive, file) == 0);
+    ASSERT(archive.schema_count == 1);
+    ASSERT(archive.record_count == record_count);
+
+    auto schema_bytes = SVFRT_archive_lookup(&archive, schema::_SchemaDescription::content_hash);
+    ASSERT(schema_bytes.count == schema::_SchemaDescription::schema_binary_size);
+    ASSERT(!SVFRT_archive_lookup(&archive, 1).pointer);
+
+    // Backwards, to make sure there is no dependency on order.
+    for (U32 i = record_count; i > 0; i--) {
+      auto message = SVFRT_archive_get_message(&archive, i - 1);
+      ASSERT(message.pointer);
+      ASSERT(((uintptr_t) message.pointer) % SVFRT_MESSAGE_PART_ALIGNMENT == 0);
+      ASSERT(((svf::runtime::MessageHeader *) message.pointer)->schema_length == 0);
+
+      auto read_result = svf::runtime::read_archive_record<schema::Entry>(
+        &archive,
+        i - 1,
+        {},
+        svf::runtime::CompatibilityLevel::compatibility_exact
+      );
+      ASSERT(read_result.error_code == 0);
+      auto target = svf::runtime::read_reference(&read_result.context, read_result.entry->reference);
+      ASSERT(target && target->value == 100 + i - 1);
+    }
+
+    auto read_result = svf::runtime::read_archive_record<schema::Entry>(
+      &archive,
+      record_count,
+      {},
+      svf::runtime::CompatibilityLevel::compatibility_exact
+    );
+    ASSERT(read_result.error_code == SVFRT_code_archive__record_out_of_range);
+  }
+
+  // Success, iterating over records, with read-ahead.
+  {
+    SVFRT_Archive archive = {};
+    ASSERT(SVFRT_archive_open(&archive, file) == 0);
+
+    ReadAheadControl control = {};
+    svf::runtime::ArchiveIterator iterator = {};
+    SVFRT_archive_iterator_init(&iterator, &archive, 1 << 16, read_ahead_counting, &control);
+
+    U32 count = 0;
+    svf::runtime::ReadMessageResult<schema::Entry> read_result = {};
+    while (svf::runtime::archive_iterator_next<schema::Entry>(
+      &iterator,
+      &read_result,
+      {},
+      svf::runtime::CompatibilityLevel::compatibility_exact
+    )) {
+      ASSERT(read_result.error_code == 0);
+      auto target = svf::runtime::read_reference(&read_result.context, read_result.entry->reference);
+      ASSERT(target && target->value == 100 + count);
+      count++;
+    }
+    ASSERT(count == record_count);
+
+    // The whole archive fits into one window.
+    ASSERT(control.call_count == 1);
+    ASSERT(control.bytes_requested > 0);
+  }
+
+  // Success, from a mapped file.
+  {
+    char const *path = "test_read_archive.svfa";
+    auto out = fopen(path, "wb");
+    ASSERT(out);
+    ASSERT(fwrite(file.pointer, 1, file.count, out) == file.count);
+    ASSERT(fclose(out) == 0);
+
+    auto mapped = SVFRT_map_file(path);
+    ASSERT(mapped.pointer);
+
+    SVFRT_Archive archive = {};
+    ASSERT(SVFRT_archive_open(&archive, mapped) == 0);
+
+    svf::runtime::ArchiveIterator iterator = {};
+    SVFRT_archive_iterator_init(&iterator, &archive, 64, SVFRT_read_ahead_mapped, NULL);
+
+    U32 count = 0;
+    svf::runtime::ReadMessageResult<schema::Entry> read_result = {};
+    while (svf::runtime::archive_iterator_next<schema::Entry>(
+      &iterator,
+      &read_result,
+      {},
+      svf::runtime::CompatibilityLevel::compatibility_exact
+    )) {
+      ASSERT(read_result.error_code == 0);
+      count++;
+    }
+    ASSERT(count == record_count);
+
+    SVFRT_unmap_file(mapped);
+
+    // Same, through the 64-bit mapping, which is needed for archives larger
+    // than `UINT32_MAX` bytes.
+    auto mapped64 = SVFRT_map_file64(path);
+    ASSERT(mapped64.pointer);
+    ASSERT(mapped64.count == file.count);
+
+    SVFRT_Archive archive64 = {};
+    ASSERT(SVFRT_archive_open64(&archive64, mapped64) == 0);
+    ASSERT(archive64.record_count == record_count);
+    ASSERT(archive64.file.count == archive.file.count);
+    for (U32 i = 0; i < record_count; i++) {
+      auto read_result64 = svf::runtime::read_archive_record<schema::Entry>(
+        &archive64,
+        i,
+        {},
+        svf::runtime::CompatibilityLevel::compatibility_exact
+      );
+      ASSERT(read_result64.error_code == 0);
+    }
+
+    SVFRT_unmap_file64(mapped64);
+    remove(path);
+  }
+
+  return 0;
+}
@@ -0,0 +1,207 @@
+#include <src/library.hpp>
+#define SVF_INCLUDE_BINARY_SCHEMA
+#include <src/svf_runtime.hpp>
+#include <generated/hpp/C0.hpp>
+#include <generated/hpp/C1.hpp>
+
+namespace schema = svf::C0;
+
+U32 write_arena(void *it, SVFRT_Bytes src) {
+  auto arena = (vm::LinearArena *) it;
+  auto dst = vm::many<U8>(arena, src.count);
+  range_copy(dst, {src.pointer, src.count});
+  return safe_int_cast<U32>(src.count);
+};
+
+void *allocate_arena(void *it, size_t size) {
+  auto arena = (vm::LinearArena *) it;
+
+  // See `SVFRT_AllocatorFn`.
+  vm::realign(arena, SVFRT_MESSAGE_PART_ALIGNMENT);
+  return vm::many<U8>(arena, size).pointer;
+}
+
+U32 const target_count = 100;
+U32 const value_count = 60;
+
+// Both sequences are appended to at the same time, so they end up in many
+// chunks each. `count_delta` is added to the count of targets, to corrupt them.
+svf::runtime::Bytes prepare_message(vm::LinearArena *arena, I32 count_delta) {
+  auto message_pointer = (U8 *) vm::realign(arena);
+  auto waterline_before = arena->waterline;
+  auto ctx = svf::runtime::write_start<schema::Entry>(write_arena, arena);
+
+  svf::runtime::ChunkedSequenceBuilder<schema::Target> targets = {};
+  svf::runtime::ChunkedSequenceBuilder<U16> values = {};
+
+  U32 values_written = 0;
+  for (U32 i = 0; i < target_count; i++) {
+    schema::Target target = { .value = i, .y = 2 * i };
+    svf::runtime::write_chunked_sequence_element(&ctx, &targets, &target);
+
+    // Sometimes several elements at once, or several times in a row.
+    if (i % 5 == 0) {
+      U16 some_values[3] = { U16(values_written), U16(values_written + 1), U16(values_written + 2) };
+      svf::runtime::write_chunked_sequence_elements(&ctx, &values, some_values, 3);
+      values_written += 3;
+    }
+    if (i % 10 == 0) {
+      schema::Target more = { .value = ++i, .y = 2 * i };
+      svf::runtime::write_chunked_sequence_element(&ctx, &targets, &more);
+    }
+  }
+  ASSERT(values_written == value_count);
+
+  schema::Entry entry = {};
+  entry.targets = svf::runtime::write_chunked_sequence_finish(&ctx, &targets);
+  entry.values = svf::runtime::write_chunked_sequence_finish(&ctx, &values);
+  entry.targets.count += count_delta;
+  svf::runtime::write_finish(&ctx, &entry);
+  ASSERT(ctx.error_code == 0);
+
+  return {
+    message_pointer,
+    safe_int_cast<U32>(arena->waterline - waterline_before),
+  };
+}
+
+int main(int /*argc*/, char */*argv*/[]) {
+  auto arena_value = vm::create_linear_arena(1ull << 20);
+  auto arena = &arena_value;
+
+  U8 scratch_buffer[1024];
+  svf::runtime::Bytes scratch = { scratch_buffer, sizeof(scratch_buffer) };
+
+  // Success, reading chunk by chunk, and by chunk index.
+  {
+    auto message = prepare_message(arena, 0);
+    auto result = svf::runtime::read_message<schema::Entry>(
+      message,
+      scratch,
+      svf::runtime::CompatibilityLevel::compatibility_exact
+    );
+    ASSERT(result.error_code == 0);
+    ASSERT(svf::runtime::verify_message(&result) == 0);
+    auto ctx = &result.context;
+
+    ASSERT(result.entry->targets.count == target_count);
+    ASSERT(result.entry->values.count == value_count);
+    U32 chunk_count = svf::runtime::read_chunk_count(ctx, result.entry->targets);
+    ASSERT(chunk_count == 21);
+    ASSERT(svf::runtime::read_chunk_count(ctx, result.entry->values) == 20);
+
+    // Iterating goes from the last chunk to the first one.
+    auto iterator = svf::runtime::chunk_iterator_begin(result.entry->targets);
+    svf::runtime::Sequence<schema::Target> chunk;
+    U32 remaining = target_count;
+    U32 expected_index = chunk_count;
+    while (svf::runtime::chunk_iterator_next(ctx, &iterator, &chunk)) {
+      expected_index -= 1;
+      ASSERT(iterator.chunk_index == expected_index);
+      remaining -= chunk.count;
+      for (U32 i = 0; i < chunk.count; i++) {
+        auto target = svf::runtime::read_sequence_element(ctx, chunk, i);
+        ASSERT(target && target->value == remaining + i && target->y == 2 * (remaining + i));
+      }
+    }
+    ASSERT(iterator.remaining == 0);
+    ASSERT(remaining == 0 && expected_index == 0);
+
+    // All chunks at once, in order.
+    svf::runtime::Sequence<U16> value_chunks[20];
+    ASSERT(svf::runtime::read_chunks(ctx, result.entry->values, { value_chunks, 20 }) == 20);
+    ASSERT(svf::runtime::read_chunks(ctx, result.entry->values, { value_chunks, 19 }) == UINT32_MAX);
+    U32 next_value = 0;
+    for (U32 i = 0; i < 20; i++) {
+      auto range = svf::runtime::read_sequence_raw(ctx, value_chunks[i]);
+      ASSERT(range.pointer && range.count == 3);
+      for (U32 j = 0; j < range.count; j++) {
+        ASSERT(range.pointer[j] == next_value++);
+      }
+    }
+
+    // Random access.
+    ASSERT(svf::runtime::read_chunk(ctx, result.entry->targets, 1, &chunk));
+    ASSERT(chunk.count == 5);
+    ASSERT(svf::runtime::read_sequence_element(ctx, chunk, 0)->value == 1);
+    ASSERT(!svf::runtime::read_chunk(ctx, result.entry->targets, 21, &chunk));
+  }
+
+  // Success, empty.
+  {
+    auto ctx = svf::runtime::write_start<schema::Entry>(write_arena, arena);
+    svf::runtime::ChunkedSequenceBuilder<schema::Target> targets = {};
+    auto sequence = svf::runtime::write_chunked_sequence_finish(&ctx, &targets);
+    ASSERT(ctx.error_code == 0);
+    ASSERT(sequence.data_offset_complement == 0 && sequence.count == 0);
+  }
+
+  // Success, converting to a regular sequence (`targets`), and to a single
+  // chunk (`values`), with widening.
+  {
+    auto message = prepare_message(arena, 0);
+    auto result = svf::runtime::read_message<svf::C1::Entry>(
+      message,
+      scratch,
+      svf::runtime::CompatibilityLevel::compatibility_logical,
+      allocate_arena,
+      arena
+    );
+    ASSERT(result.error_code == 0);
+    ASSERT(result.compatibility_level == svf::runtime::CompatibilityLevel::compatibility_logical);
+    ASSERT(svf::runtime::verify_message(&result) == 0);
+    auto ctx = &result.context;
+
+    ASSERT(result.entry->targets.count == target_count);
+    for (U32 i = 0; i < target_count; i++) {
+      auto target = svf::runtime::read_sequence_element(ctx, result.entry->targets, i);
+      ASSERT(target && target->value == i && target->y == 2 * i);
+    }
+
+    svf::runtime::Sequence<U32> values;
+    ASSERT(svf::runtime::read_chunk_count(ctx, result.entry->values) == 1);
+    ASSERT(svf::runtime::read_chunk(ctx, result.entry->values, 0, &values));
+    auto range = svf::runtime::read_sequence_raw(ctx, values);
+    ASSERT(range.count == value_count);
+    for (U32 i = 0; i < value_count; i++) {
+      ASSERT(range.pointer[i] == i);
+    }
+  }
+
+  // Fail, when the chain does not add up to the count.
+  for (I32 count_delta = -1; count_delta <= 1; count_delta += 2) {
+    auto message = prepare_message(arena, count_delta);
+    auto result = svf::runtime::read_message<schema::Entry>(
+      message,
+      scratch,
+      svf::runtime::CompatibilityLevel::compatibility_exact
+    );
+    ASSERT(result.error_code == 0);
+    ASSERT(svf::runtime::verify_message(&result) == SVFRT_code_verify__bad_chunk_link);
+
+    svf::runtime::Sequence<schema::Target> chunks[21];
+    ASSERT(svf::runtime::read_chunks(&result.context, result.entry->targets, { chunks, 21 }) == UINT32_MAX);
+
+    auto converted = svf::runtime::read_message<svf::C1::Entry>(
+      message,
+      scratch,
+      svf::runtime::CompatibilityLevel::compatibility_logical,
+      allocate_arena,
+      arena
+    );
+    ASSERT(converted.error_code == SVFRT_code_conversion__bad_chunk_link);
+  }
+
+  // Fail, when `T[~]` has to be read as `T[]` without a conversion.
+  {
+    auto message = prepare_message(arena, 0);
+    auto result = svf::runtime::read_message<svf::C1::Entry>(
+      message,
+      scratch,
+      svf::runtime::CompatibilityLevel::compatibility_binary
+    );
+    ASSERT(result.error_code == SVFRT_code_compatibility__type_mismatch);
+  }
+
+  return 0;
+}
@@ -146,14 +146,18 @@ int main(int /*argc*/, char */*argv*/[]) {
 
     auto header = (SVFRT_MessageHeader *) message.pointer;
 
-    message.count = sizeof(*header) + header->schema_length;
+    // Up to the padded end of the appendix, where the data would start.
+    message.count = safe_int_cast<U32>(align_up(
+      align_up(sizeof(*header) + header->schema_length, SVFRT_MESSAGE_PART_ALIGNMENT) + header->appendix_length,
+      SVFRT_MESSAGE_PART_ALIGNMENT
+    ));
     auto read_result = svf::runtime::read_message<schema::Entry>(
       message,
       scratch,
       svf::runtime::CompatibilityLevel::compatibility_exact
     );
 
-    ASSERT(read_result.error_code == SVFRT_code_read__bad_schema_length);
+    ASSERT(read_result.error_code == SVFRT_code_read__data_too_small);
   }
 
   // Success.
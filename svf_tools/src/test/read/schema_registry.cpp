@@ -0,0 +1,183 @@
+#include <cstdio>
+#include <src/library.hpp>
+#define SVF_INCLUDE_BINARY_SCHEMA
+#include <src/svf_runtime.hpp>
+#include <src/svf_mmap.h>
+#include <generated/hpp/A0.hpp>
+
+namespace schema = svf::A0;
+
+U32 write_arena(void *it, SVFRT_Bytes src) {
+  auto arena = (vm::LinearArena *) it;
+  auto dst = vm::many<U8>(arena, src.count);
+  range_copy(dst, {src.pointer, src.count});
+  return safe_int_cast<U32>(src.count);
+};
+
+int main(int /*argc*/, char */*argv*/[]) {
+  // Prepare: create the message, without the schema.
+  auto arena_value = vm::create_linear_arena(1ull << 20);
+  svf::runtime::WriteContext<schema::Entry> ctx = {};
+  SVFRT_write_start(
+    &ctx,
+    write_arena,
+    &arena_value,
+    schema::_SchemaDescription::content_hash,
+    {}, // Empty schema!
+    {},
+    schema::_SchemaDescription::PerType<schema::Entry>::type_id
+  );
+  schema::Entry entry = {};
+  svf::runtime::write_finish(&ctx, &entry);
+
+  ASSERT(ctx.finished);
+  ASSERT(ctx.error_code == 0);
+
+  auto message_pointer = arena_value.reserved_range.pointer;
+  auto message_length = safe_int_cast<U32>(arena_value.waterline);
+
+  // Prepare: a registry with the real schema, and a few unrelated blobs, which
+  // are never checked, unless looked up.
+  U8 other_blob[3] = { 1, 2, 3 };
+  SVFRT_Bytes schemas[] = {
+    { other_blob, 1 },
+    { schema::_SchemaDescription::schema_binary_array, schema::_SchemaDescription::schema_binary_size },
+    { other_blob, 2 },
+    { other_blob, 3 },
+  };
+  U64 hashes[] = {
+    1,
+    schema::_SchemaDescription::content_hash,
+    2,
+    schema::_SchemaDescription::content_hash ^ 1,
+  };
+  U32 schema_count = 4;
+
+  auto arena2_value = vm::create_linear_arena(1ull << 20);
+  auto arena2 = &arena2_value;
+  SVFRT_ErrorCode error_code = 0;
+  auto registry_size = SVFRT_schema_registry_write(schemas, hashes, schema_count, {}, &error_code);
+  ASSERT(error_code == SVFRT_code_registry__buffer_too_small);
+  ASSERT(registry_size > 0);
+
+  auto registry_memory = vm::many<U64>(arena2, registry_size / sizeof(U64) + 1);
+  SVFRT_Bytes registry_bytes = { (U8 *) registry_memory.pointer, registry_size };
+  ASSERT(SVFRT_schema_registry_write(schemas, hashes, schema_count, registry_bytes, &error_code) == registry_size);
+  ASSERT(error_code == 0);
+
+  // Fail to write, when content hashes are not unique.
+  {
+    U64 duplicate_hashes[] = { 1, 2, 1, 3 };
+    SVFRT_schema_registry_write(schemas, duplicate_hashes, schema_count, registry_bytes, &error_code);
+    ASSERT(error_code == SVFRT_code_registry__duplicate_schema);
+
+    // Restore.
+    SVFRT_schema_registry_write(schemas, hashes, schema_count, registry_bytes, &error_code);
+    ASSERT(error_code == 0);
+  }
+
+  // Fail to open, when not aligned.
+  {
+    SVFRT_SchemaRegistry registry = {};
+    auto error_code = SVFRT_schema_registry_open(
+      &registry,
+      { registry_bytes.pointer + 1, registry_bytes.count - 1 }
+    );
+    ASSERT(error_code == SVFRT_code_registry__not_aligned);
+  }
+
+  // Fail to open, when truncated.
+  {
+    SVFRT_SchemaRegistry registry = {};
+    auto error_code = SVFRT_schema_registry_open(&registry, { registry_bytes.pointer, 16 });
+    ASSERT(error_code == SVFRT_code_registry__malformed);
+  }
+
+  // Fail to open, with a wrong magic.
+  {
+    registry_bytes.pointer[3] = 'X';
+    SVFRT_SchemaRegistry registry = {};
+    auto error_code = SVFRT_schema_registry_open(&registry, registry_bytes);
+    ASSERT(error_code == SVFRT_code_registry__malformed);
+    registry_bytes.pointer[3] = 'R';
+  }
+
+  // Success, from memory.
+  {
+    SVFRT_SchemaRegistry registry = {};
+    ASSERT(SVFRT_schema_registry_open(&registry, registry_bytes) == 0);
+    ASSERT(registry.entry_count == schema_count);
+
+    for (U32 i = 0; i < schema_count; i++) {
+      auto result = SVFRT_schema_registry_lookup(&registry, hashes[i]);
+      ASSERT(result.count == schemas[i].count);
+      ASSERT(((uintptr_t) result.pointer) % SVFRT_MESSAGE_PART_ALIGNMENT == 0);
+      for (U32 j = 0; j < result.count; j++) {
+        ASSERT(result.pointer[j] == schemas[i].pointer[j]);
+      }
+    }
+
+    auto missing = SVFRT_schema_registry_lookup(&registry, 3);
+    ASSERT(!missing.pointer);
+  }
+
+  // Prepare: put the registry into a file, and map it.
+  char const *path = "test_read_schema_registry.svfr";
+  {
+    auto file = fopen(path, "wb");
+    ASSERT(file);
+    ASSERT(fwrite(registry_bytes.pointer, 1, registry_bytes.count, file) == registry_bytes.count);
+    ASSERT(fclose(file) == 0);
+  }
+  auto mapped = SVFRT_map_file(path);
+  ASSERT(mapped.pointer);
+  ASSERT(mapped.count == registry_bytes.count);
+
+  SVFRT_SchemaRegistry registry = {};
+  ASSERT(SVFRT_schema_registry_open(&registry, mapped) == 0);
+
+  // Success, reading the message with the mapped registry as the lookup.
+  {
+    svf::runtime::Bytes message = { message_pointer, message_length };
+    svf::runtime::Bytes scratch = {}; // Empty.
+
+    auto read_result = svf::runtime::read_message<schema::Entry>(
+      message,
+      scratch,
+      svf::runtime::CompatibilityLevel::compatibility_exact,
+      0, 0,
+      SVFRT_schema_registry_lookup, &registry
+    );
+
+    ASSERT(read_result.error_code == 0);
+  }
+
+  // Fail, when the schema is not in the registry.
+  {
+    auto other_memory = vm::many<U64>(arena2, registry_size / sizeof(U64) + 1);
+    SVFRT_Bytes other_bytes = { (U8 *) other_memory.pointer, registry_size };
+    SVFRT_schema_registry_write(schemas, hashes, 1, other_bytes, &error_code);
+    ASSERT(error_code == 0);
+
+    SVFRT_SchemaRegistry other_registry = {};
+    ASSERT(SVFRT_schema_registry_open(&other_registry, other_bytes) == 0);
+
+    svf::runtime::Bytes message = { message_pointer, message_length };
+    svf::runtime::Bytes scratch = {}; // Empty.
+
+    auto read_result = svf::runtime::read_message<schema::Entry>(
+      message,
+      scratch,
+      svf::runtime::CompatibilityLevel::compatibility_exact,
+      0, 0,
+      SVFRT_schema_registry_lookup, &other_registry
+    );
+
+    ASSERT(read_result.error_code == SVFRT_code_read__schema_lookup_failed);
+  }
+
+  SVFRT_unmap_file(mapped);
+  remove(path);
+
+  return 0;
+}
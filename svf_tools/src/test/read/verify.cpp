@@ -0,0 +1,168 @@
+#include <src/library.hpp>
+#define SVF_INCLUDE_BINARY_SCHEMA
+#include <src/svf_runtime.hpp>
+#include <generated/hpp/A0.hpp>
+
+namespace schema = svf::A0;
+
+U32 write_arena(void *it, SVFRT_Bytes src) {
+  auto arena = (vm::LinearArena *) it;
+  auto dst = vm::many<U8>(arena, src.count);
+  range_copy(dst, {src.pointer, src.count});
+  return safe_int_cast<U32>(src.count);
+};
+
+enum class Corruption {
+  none,
+  reference_out_of_bounds,
+  sequence_out_of_bounds,
+  sequence_element_aliased,
+  reference_misaligned,
+};
+
+svf::runtime::Bytes prepare_message(vm::LinearArena *arena, Corruption corruption) {
+  auto message_pointer = (U8 *) vm::realign(arena);
+  auto waterline_before = arena->waterline;
+  auto ctx = svf::runtime::write_start<schema::Entry>(write_arena, arena);
+
+  schema::Target targets[3] = {
+    { .value = 1, .y = 2 },
+    { .value = 3, .y = 4 },
+    { .value = 5, .y = 6 },
+  };
+
+  schema::Entry entry = {};
+  entry.reference = svf::runtime::write_reference(&ctx, &targets[0]);
+  entry.someStruct.sequence = svf::runtime::write_fixed_size_array(&ctx, targets);
+  entry.someStruct.someChoice_tag = schema::SomeChoice_tag::target;
+  entry.someStruct.someChoice_payload.target = { .value = 7, .y = 8 };
+
+  switch (corruption) {
+    case Corruption::none: {
+      break;
+    }
+    case Corruption::reference_out_of_bounds: {
+      entry.reference.data_offset_complement = ~U32(1000);
+      break;
+    }
+    case Corruption::sequence_out_of_bounds: {
+      entry.someStruct.sequence.count = UINT32_MAX;
+      break;
+    }
+    case Corruption::sequence_element_aliased: {
+      // The sequence also covers the referenced target, so some data is
+      // reachable twice, which adds up to more than the whole message.
+      entry.someStruct.sequence.data_offset_complement = entry.reference.data_offset_complement;
+      entry.someStruct.sequence.count = 4;
+      break;
+    }
+    case Corruption::reference_misaligned: {
+      entry.reference.data_offset_complement = ~(~entry.reference.data_offset_complement + 4);
+      break;
+    }
+  }
+
+  svf::runtime::write_finish(&ctx, &entry);
+  ASSERT(ctx.finished);
+  ASSERT(ctx.error_code == 0);
+
+  return { message_pointer, safe_int_cast<U32>(arena->waterline - waterline_before) };
+}
+
+int main(int /*argc*/, char */*argv*/[]) {
+  auto arena_value = vm::create_linear_arena(1ull << 20);
+  auto arena = &arena_value;
+
+  // Success, and unchecked accessors agree with checked ones.
+  {
+    auto message = prepare_message(arena, Corruption::none);
+    auto read_result = svf::runtime::read_message<schema::Entry>(
+      message,
+      {},
+      svf::runtime::CompatibilityLevel::compatibility_exact
+    );
+    ASSERT(read_result.error_code == 0);
+    ASSERT(svf::runtime::verify_message(&read_result) == 0);
+
+    auto ctx = &read_result.context;
+    auto entry = read_result.entry;
+
+    auto checked_target = svf::runtime::read_reference(ctx, entry->reference);
+    auto unchecked_target = svf::runtime::read_reference_unchecked(ctx, entry->reference);
+    ASSERT(checked_target && checked_target == unchecked_target);
+    ASSERT(unchecked_target->value == 1);
+
+    auto sequence = entry->someStruct.sequence;
+    ASSERT(sequence.count == 3);
+    for (U32 i = 0; i < sequence.count; i++) {
+      auto checked = svf::runtime::read_sequence_element(ctx, sequence, i);
+      auto unchecked = svf::runtime::read_sequence_element_unchecked(ctx, sequence, i);
+      ASSERT(checked && checked == unchecked);
+      ASSERT(unchecked->value == 2 * i + 1);
+    }
+  }
+
+  // Same, via the C API.
+  {
+    auto message = prepare_message(arena, Corruption::none);
+    SVFRT_ReadMessageParams params = {};
+    params.expected_schema_content_hash = schema::_SchemaDescription::content_hash;
+    params.expected_schema_struct_strides = { (U32 *) schema::struct_strides, 3 };
+    params.expected_schema = { (U8 *) schema::binary::array, schema::binary::size };
+    params.required_level = SVFRT_compatibility_exact;
+    params.entry_struct_id = schema::Entry_type_id;
+    params.entry_struct_index = schema::Entry_struct_index;
+    params.max_schema_work = UINT32_MAX;
+    params.max_recursion_depth = SVFRT_DEFAULT_MAX_RECURSION_DEPTH;
+    params.max_output_size = SVFRT_NO_SIZE_LIMIT;
+
+    SVFRT_ReadMessageResult read_result = {};
+    SVFRT_read_message(&params, &read_result, { message.pointer, message.count }, {});
+    ASSERT(read_result.error_code == 0);
+    ASSERT(SVFRT_verify_message(&params, &read_result) == 0);
+
+    // Too deep for the limit.
+    params.max_recursion_depth = 1;
+    ASSERT(SVFRT_verify_message(&params, &read_result) == SVFRT_code_verify__max_recursion_depth_exceeded);
+
+    // Nothing to verify after a failed read.
+    read_result.error_code = SVFRT_code_read__data_too_small;
+    ASSERT(SVFRT_verify_message(&params, &read_result) == SVFRT_code_verify__no_entry);
+  }
+
+  // Fail, when data is corrupted, even though reading itself succeeds.
+  {
+    struct { Corruption corruption; SVFRT_ErrorCode error_code; } cases[] = {
+      { Corruption::reference_out_of_bounds, SVFRT_code_verify__data_out_of_bounds },
+      { Corruption::sequence_out_of_bounds, SVFRT_code_verify__data_out_of_bounds },
+      { Corruption::sequence_element_aliased, SVFRT_code_verify__data_aliasing_detected },
+      { Corruption::reference_misaligned, SVFRT_code_verify__data_not_aligned },
+    };
+
+    for (auto &it : cases) {
+      auto message = prepare_message(arena, it.corruption);
+      auto read_result = svf::runtime::read_message<schema::Entry>(
+        message,
+        {},
+        svf::runtime::CompatibilityLevel::compatibility_exact
+      );
+      ASSERT(read_result.error_code == 0);
+      ASSERT(svf::runtime::verify_message(&read_result) == it.error_code);
+    }
+  }
+
+  // Fail, when a reference is misaligned, also with the checked accessor. See
+  // #natural-alignment.
+  {
+    auto message = prepare_message(arena, Corruption::reference_misaligned);
+    auto read_result = svf::runtime::read_message<schema::Entry>(
+      message,
+      {},
+      svf::runtime::CompatibilityLevel::compatibility_exact
+    );
+    ASSERT(read_result.error_code == 0);
+    ASSERT(svf::runtime::read_reference(&read_result.context, read_result.entry->reference) == NULL);
+  }
+
+  return 0;
+}
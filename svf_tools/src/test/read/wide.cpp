@@ -0,0 +1,297 @@
+#include <cstdio>
+#include <src/library.hpp>
+#define SVF_INCLUDE_BINARY_SCHEMA
+#include <src/svf_runtime.hpp>
+#include <src/svf_mmap.h>
+#include <generated/hpp/A0.hpp>
+#include <generated/hpp/W0.hpp>
+#include <generated/hpp/W1.hpp>
+
+namespace schema = svf::W0;
+
+U32 write_arena(void *it, SVFRT_Bytes src) {
+  auto arena = (vm::LinearArena *) it;
+  auto dst = vm::many<U8>(arena, src.count);
+  range_copy(dst, {src.pointer, src.count});
+  return safe_int_cast<U32>(src.count);
+};
+
+void *allocate_arena(void *it, size_t size) {
+  auto arena = (vm::LinearArena *) it;
+  vm::realign(arena);
+  return vm::many<U8>(arena, size).pointer;
+}
+
+int main(int /*argc*/, char */*argv*/[]) {
+  auto arena_value = vm::create_linear_arena(1ull << 20);
+  auto arena = &arena_value;
+
+  // References and sequences are twice as large.
+  static_assert(sizeof(schema::Entry) == 8 + 16 + 16);
+
+  // Prepare: a wide message.
+  auto message_pointer = (U8 *) vm::realign(arena);
+  auto waterline_before = arena->waterline;
+  {
+    auto ctx = svf::runtime::write_start64<schema::Entry>(write_arena, arena);
+    schema::Target targets[2] = {
+      { .value = 100, .y = 1 },
+      { .value = 200, .y = 2 },
+    };
+    U32 values[3] = { 7, 8, 9 };
+
+    schema::Entry entry = {};
+    entry.reference = svf::runtime::write_reference(&ctx, &targets[0]);
+    entry.targets = svf::runtime::write_fixed_size_array(&ctx, targets);
+    for (U32 i = 0; i < 3; i++) {
+      svf::runtime::write_sequence_element(&ctx, values + i, &entry.values);
+    }
+    svf::runtime::write_finish(&ctx, &entry);
+    ASSERT(ctx.error_code == 0);
+    ASSERT(entry.values.count == 3);
+  }
+  auto message = svf::runtime::Bytes64 {
+    message_pointer,
+    arena->waterline - waterline_before,
+  };
+  ASSERT(((SVFRT_MessageHeader *) message.pointer)->flags == SVFRT_MESSAGE_FLAG_WIDE);
+
+  // Prepare: a regular message.
+  auto regular_pointer = (U8 *) vm::realign(arena);
+  waterline_before = arena->waterline;
+  {
+    auto ctx = svf::runtime::write_start<svf::A0::Entry>(write_arena, arena);
+    svf::A0::Target target = { .value = 1, .y = 2 };
+    svf::A0::Entry entry = {};
+    entry.reference = svf::runtime::write_reference(&ctx, &target);
+    svf::runtime::write_finish(&ctx, &entry);
+    ASSERT(ctx.error_code == 0);
+  }
+  auto regular = svf::runtime::Bytes {
+    regular_pointer,
+    safe_int_cast<U32>(arena->waterline - waterline_before),
+  };
+
+  // Fail to read the wide message as a regular one.
+  {
+    SVFRT_ReadMessageParams params = svf::runtime::get_read_message_params<schema::Entry>(
+      svf::runtime::CompatibilityLevel::compatibility_exact,
+      NULL, NULL, NULL, NULL, NULL
+    );
+    SVFRT_ReadMessageResult result = {};
+    SVFRT_read_message(&params, &result, { message.pointer, safe_int_cast<U32>(message.count) }, {});
+    ASSERT(result.error_code == SVFRT_code_read__wide_message);
+  }
+
+  // Fail to read a regular message as a wide one.
+  {
+    auto result = svf::runtime::read_message64<svf::A0::Entry>(
+      { regular.pointer, regular.count },
+      {},
+      svf::runtime::CompatibilityLevel::compatibility_exact
+    );
+    ASSERT(result.error_code == SVFRT_code_read__not_wide_message);
+  }
+
+  // Success.
+  {
+    auto result = svf::runtime::read_message64<schema::Entry>(
+      { message.pointer, message.count },
+      {},
+      svf::runtime::CompatibilityLevel::compatibility_exact
+    );
+    ASSERT(result.error_code == 0);
+    ASSERT(result.compatibility_level == svf::runtime::CompatibilityLevel::compatibility_exact);
+    auto ctx = &result.context;
+
+    auto target = svf::runtime::read_reference(ctx, result.entry->reference);
+    ASSERT(target && target->value == 100 && target->y == 1);
+
+    auto second = svf::runtime::read_sequence_element(ctx, result.entry->targets, 1);
+    ASSERT(second && second->value == 200 && second->y == 2);
+    ASSERT(!svf::runtime::read_sequence_element(ctx, result.entry->targets, 2));
+
+    auto values = svf::runtime::read_sequence_raw(ctx, result.entry->values);
+    ASSERT(values.count == 3 && values.pointer[2] == 9);
+    ASSERT(((uintptr_t) values.pointer) % sizeof(U32) == 0);
+
+    // Fail, when out of bounds, including counts and offsets above 32 bits.
+    auto huge = result.entry->values;
+    huge.count = 1ull << 40;
+    ASSERT(!svf::runtime::read_sequence_raw(ctx, huge).pointer);
+    huge.count = UINT64_MAX;
+    ASSERT(!svf::runtime::read_sequence_raw(ctx, huge).pointer);
+    ASSERT(!svf::runtime::read_sequence_element(ctx, svf::runtime::Sequence64<schema::Target> { 0, UINT64_MAX }, UINT64_MAX - 1));
+    ASSERT(!svf::runtime::read_reference(ctx, svf::runtime::Reference64<schema::Target> { ~(1ull << 33) }));
+  }
+
+  // Success, and the message can be verified.
+  {
+    auto result = svf::runtime::read_message64<schema::Entry>(
+      { message.pointer, message.count },
+      {},
+      svf::runtime::CompatibilityLevel::compatibility_exact
+    );
+    ASSERT(svf::runtime::verify_message64(&result) == 0);
+
+    auto ctx = &result.context;
+    auto target = svf::runtime::read_reference_unchecked(ctx, result.entry->reference);
+    ASSERT(target->value == 100);
+    auto second = svf::runtime::read_sequence_element_unchecked(ctx, result.entry->targets, 1);
+    ASSERT(second->value == 200);
+  }
+
+  // Fail to verify, when a reference is out of bounds.
+  {
+    vm::realign(arena);
+    auto copy = vm::many<U8>(arena, message.count);
+    range_copy(copy, { message.pointer, message.count });
+    auto result = svf::runtime::read_message64<schema::Entry>(
+      { copy.pointer, copy.count },
+      {},
+      svf::runtime::CompatibilityLevel::compatibility_exact
+    );
+    ASSERT(result.error_code == 0);
+    ((schema::Entry *) result.entry)->reference.data_offset_complement = ~(1ull << 33);
+    ASSERT(svf::runtime::verify_message64(&result) == SVFRT_code_verify__data_out_of_bounds);
+  }
+
+  // Prepare: a wide message in an older schema, with narrower types.
+  auto older_pointer = (U8 *) vm::realign(arena);
+  waterline_before = arena->waterline;
+  {
+    auto ctx = svf::runtime::write_start64<svf::W1::Entry>(write_arena, arena);
+    svf::W1::Target targets[2] = {
+      { .value = 300, .y = 3 },
+      { .value = 400, .y = 4 },
+    };
+    U16 values[3] = { 10, 11, 12 };
+
+    svf::W1::Entry entry = {};
+    entry.reference = svf::runtime::write_reference(&ctx, &targets[1]);
+    entry.targets = svf::runtime::write_fixed_size_array(&ctx, targets);
+    entry.values = svf::runtime::write_fixed_size_array(&ctx, values);
+    svf::runtime::write_finish(&ctx, &entry);
+    ASSERT(ctx.error_code == 0);
+  }
+  auto older = svf::runtime::Bytes64 {
+    older_pointer,
+    arena->waterline - waterline_before,
+  };
+
+  U8 scratch_buffer[256];
+  svf::runtime::Range<U8> scratch = { scratch_buffer, sizeof(scratch_buffer) };
+
+  // Fail, when logical compatibility is not allowed.
+  {
+    auto result = svf::runtime::read_message64<schema::Entry>(
+      { older.pointer, older.count },
+      scratch,
+      svf::runtime::CompatibilityLevel::compatibility_binary
+    );
+    ASSERT(result.error_code == SVFRT_code_compatibility__concrete_type_mismatch);
+  }
+
+  // Fail, when there is no allocator for the conversion.
+  {
+    auto result = svf::runtime::read_message64<schema::Entry>(
+      { older.pointer, older.count },
+      scratch,
+      svf::runtime::CompatibilityLevel::compatibility_logical
+    );
+    ASSERT(result.error_code == SVFRT_code_read__no_allocator_function);
+  }
+
+  // Fail, when the output would be larger than the limit.
+  {
+    SVFRT_ReadMessageParams params = svf::runtime::get_read_message_params<schema::Entry>(
+      svf::runtime::CompatibilityLevel::compatibility_logical,
+      allocate_arena, arena, NULL, NULL, NULL
+    );
+    params.max_output_size = 16;
+    SVFRT_ReadMessageResult64 result = {};
+    SVFRT_read_message64(&params, &result, { older.pointer, older.count }, { scratch.pointer, scratch.count });
+    ASSERT(result.error_code == SVFRT_code_conversion__total_data_size_limit_exceeded);
+  }
+
+  // Success, converted with logical compatibility.
+  {
+    auto result = svf::runtime::read_message64<schema::Entry>(
+      { older.pointer, older.count },
+      scratch,
+      svf::runtime::CompatibilityLevel::compatibility_logical,
+      allocate_arena,
+      arena
+    );
+    ASSERT(result.error_code == 0);
+    ASSERT(result.compatibility_level == svf::runtime::CompatibilityLevel::compatibility_logical);
+    ASSERT(result.allocation == result.context.data_range.pointer);
+    ASSERT(svf::runtime::verify_message64(&result) == 0);
+    auto ctx = &result.context;
+
+    auto target = svf::runtime::read_reference(ctx, result.entry->reference);
+    ASSERT(target && target->value == 400 && target->y == 4);
+
+    auto first = svf::runtime::read_sequence_element(ctx, result.entry->targets, 0);
+    ASSERT(first && first->value == 300 && first->y == 3);
+    ASSERT(result.entry->targets.count == 2);
+
+    auto values = svf::runtime::read_sequence_raw(ctx, result.entry->values);
+    ASSERT(values.count == 3 && values.pointer[0] == 10 && values.pointer[2] == 12);
+    ASSERT(((uintptr_t) values.pointer) % sizeof(U32) == 0);
+  }
+
+  // Fail, when a sequence count above 32 bits is out of bounds.
+  {
+    vm::realign(arena);
+    auto copy = vm::many<U8>(arena, older.count);
+    range_copy(copy, { older.pointer, older.count });
+    auto entry = (svf::W1::Entry *) (copy.pointer + copy.count - sizeof(svf::W1::Entry));
+    entry->values.count = 1ull << 40;
+    auto result = svf::runtime::read_message64<schema::Entry>(
+      { copy.pointer, copy.count },
+      scratch,
+      svf::runtime::CompatibilityLevel::compatibility_logical,
+      allocate_arena,
+      arena
+    );
+    ASSERT(result.error_code == SVFRT_code_conversion__data_aliasing_detected);
+  }
+
+  // Fail to write elements non-contiguously.
+  {
+    auto ctx = svf::runtime::write_start64<schema::Entry>(write_arena, arena);
+    U32 value = 1;
+    svf::runtime::Sequence64<U32> sequence = {};
+    svf::runtime::write_sequence_element(&ctx, &value, &sequence);
+    svf::runtime::write_reference(&ctx, &value);
+    svf::runtime::write_sequence_element(&ctx, &value, &sequence);
+    ASSERT(ctx.error_code == SVFRT_code_write__sequence_non_contiguous);
+  }
+
+  // Success, from a mapped file.
+  {
+    char const *path = "test_read_wide.svf";
+    auto out = fopen(path, "wb");
+    ASSERT(out);
+    ASSERT(fwrite(message.pointer, 1, message.count, out) == message.count);
+    ASSERT(fclose(out) == 0);
+
+    auto mapped = SVFRT_map_file64(path);
+    ASSERT(mapped.pointer && mapped.count == message.count);
+
+    auto result = svf::runtime::read_message64<schema::Entry>(
+      { mapped.pointer, mapped.count },
+      {},
+      svf::runtime::CompatibilityLevel::compatibility_exact
+    );
+    ASSERT(result.error_code == 0);
+    auto target = svf::runtime::read_reference(&result.context, result.entry->reference);
+    ASSERT(target && target->value == 100);
+
+    SVFRT_unmap_file64(mapped);
+    remove(path);
+  }
+
+  return 0;
+}
@@ -58,9 +58,9 @@ void test_write(svf::runtime::WriterFn *writer_fn, void *writer_ptr) {
       .u16i64 = 58,
       .u32u64 = 59,
       .u32i64 = 60,
-      .i8i16 = 61,
-      .i8i32 = 62,
-      .i8i64 = 63,
+      .i8i16 = -61,
+      .i8i32 = -62,
+      .i8i64 = -63,
       .i16i32 = 64,
       .i16i64 = 65,
       .i32i64 = 66,
@@ -127,9 +127,9 @@ void test_read(vm::LinearArena *arena, Bytes input_range) {
   ASSERT(entry->primitives.u16i64 == 58);
   ASSERT(entry->primitives.u32u64 == 59);
   ASSERT(entry->primitives.u32i64 == 60);
-  ASSERT(entry->primitives.i8i16 == 61);
-  ASSERT(entry->primitives.i8i32 == 62);
-  ASSERT(entry->primitives.i8i64 == 63);
+  ASSERT(entry->primitives.i8i16 == -61);
+  ASSERT(entry->primitives.i8i32 == -62);
+  ASSERT(entry->primitives.i8i64 == -63);
   ASSERT(entry->primitives.i16i32 == 64);
   ASSERT(entry->primitives.i16i64 == 65);
   ASSERT(entry->primitives.i32i64 == 66);
@@ -0,0 +1,154 @@
+#include <cstdlib>
+#include <src/library.hpp>
+#define SVF_INCLUDE_BINARY_SCHEMA
+#include <src/svf_runtime.hpp>
+#include <generated/hpp/A0.hpp>
+
+namespace schema = svf::A0;
+
+struct CountingWriter {
+  vm::LinearArena *arena;
+  U32 call_count;
+};
+
+uint32_t write_counting(void *it, SVFRT_Bytes data) {
+  auto writer = (CountingWriter *) it;
+  writer->call_count++;
+  auto dst = vm::many<U8>(writer->arena, data.count);
+  range_copy(dst, {data.pointer, data.count});
+  return data.count;
+}
+
+bool grow_realloc(void * /*grow_ptr*/, SVFRT_Bytes *inout_buffer, uint32_t min_count) {
+  auto pointer = (U8 *) realloc(inout_buffer->pointer, min_count);
+  if (!pointer) {
+    return false;
+  }
+  inout_buffer->pointer = pointer;
+  inout_buffer->count = min_count;
+  return true;
+}
+
+// Small elements one by one, and a large array at once.
+void write_test_message(svf::runtime::WriteContext<schema::Entry> *ctx) {
+  schema::Target targets[40] = {};
+  for (U32 i = 0; i < 40; i++) {
+    targets[i] = { .value = i, .y = 2 * i };
+  }
+
+  schema::Entry entry = {};
+  for (U32 i = 0; i < 100; i++) {
+    schema::Target target = { .value = i, .y = 0 };
+    svf::runtime::write_sequence_element(ctx, &target, &entry.someStruct.sequence);
+  }
+  entry.reference = svf::runtime::write_reference(ctx, &targets[7]);
+  svf::runtime::write_fixed_size_array(ctx, targets);
+  svf::runtime::write_finish(ctx, &entry);
+}
+
+static
+void assert_same_bytes(SVFRT_Bytes a, SVFRT_Bytes b) {
+  ASSERT(a.count == b.count);
+  for (U32 i = 0; i < a.count; i++) {
+    ASSERT(a.pointer[i] == b.pointer[i]);
+  }
+}
+
+int main(int /*argc*/, char */*argv*/[]) {
+  auto arena_value = vm::create_linear_arena(1ull << 20);
+  auto arena = &arena_value;
+
+  // Prepare: the message, written without a buffer.
+  CountingWriter unbuffered_writer = { .arena = arena };
+  auto message_pointer = (U8 *) vm::realign(arena);
+  auto waterline_before = arena->waterline;
+  {
+    auto ctx = svf::runtime::write_start<schema::Entry>(write_counting, &unbuffered_writer);
+    write_test_message(&ctx);
+    ASSERT(ctx.error_code == 0);
+  }
+  SVFRT_Bytes message = {
+    message_pointer,
+    safe_int_cast<U32>(arena->waterline - waterline_before),
+  };
+
+  // Success, growing the buffer, and the message is the same.
+  {
+    U32 initial_size = 16;
+    auto buffer = (U8 *) malloc(initial_size);
+    auto ctx = svf::runtime::write_start_buffered<schema::Entry>({ buffer, initial_size }, grow_realloc);
+    write_test_message(&ctx);
+    ASSERT(ctx.error_code == 0);
+    ASSERT(ctx.finished);
+    ASSERT(ctx.buffer.count > initial_size);
+    assert_same_bytes({ ctx.buffer.pointer, ctx.buffer_used }, message);
+
+    auto result = svf::runtime::read_message<schema::Entry>(
+      { ctx.buffer.pointer, ctx.buffer_used },
+      {},
+      svf::runtime::CompatibilityLevel::compatibility_exact
+    );
+    ASSERT(result.error_code == 0);
+    auto target = svf::runtime::read_reference(&result.context, result.entry->reference);
+    ASSERT(target && target->value == 7 && target->y == 14);
+    auto element = svf::runtime::read_sequence_element(&result.context, result.entry->someStruct.sequence, 99);
+    ASSERT(element && element->value == 99);
+
+    free(ctx.buffer.pointer);
+  }
+
+  // Success, flushing to a writer in chunks, with far fewer calls.
+  {
+    U8 buffer[256];
+    CountingWriter writer = { .arena = arena };
+    auto pointer = (U8 *) vm::realign(arena);
+    waterline_before = arena->waterline;
+
+    auto ctx = svf::runtime::write_start_buffered<schema::Entry>(
+      { buffer, sizeof(buffer) },
+      NULL,
+      NULL,
+      write_counting,
+      &writer
+    );
+    write_test_message(&ctx);
+    ASSERT(ctx.error_code == 0);
+    ASSERT(ctx.buffer_used == 0);
+
+    SVFRT_Bytes flushed = { pointer, safe_int_cast<U32>(arena->waterline - waterline_before) };
+    assert_same_bytes(flushed, message);
+    ASSERT(writer.call_count * 5 < unbuffered_writer.call_count);
+  }
+
+  // Fail, when the buffer is full, and can't grow or be flushed.
+  {
+    U8 buffer[512];
+    auto ctx = svf::runtime::write_start_buffered<schema::Entry>({ buffer, sizeof(buffer) });
+    ASSERT(ctx.error_code == 0);
+    schema::Target targets[40] = {};
+    svf::runtime::write_fixed_size_array(&ctx, targets);
+    ASSERT(ctx.error_code == SVFRT_code_write__buffer_full);
+  }
+
+  // Fail, when there is no buffer at all.
+  {
+    auto ctx = svf::runtime::write_start_buffered<schema::Entry>({});
+    ASSERT(ctx.error_code == SVFRT_code_write__buffer_full);
+  }
+
+  // Fail, when the writer fails on flush. The schema does not fit, so this
+  // happens right at the start.
+  {
+    U8 buffer[64];
+    auto ctx = svf::runtime::write_start_buffered<schema::Entry>(
+      { buffer, sizeof(buffer) },
+      NULL,
+      NULL,
+      [](void *, SVFRT_Bytes) -> uint32_t { return 0; },
+      NULL
+    );
+    ASSERT(ctx.error_code == SVFRT_code_write__writer_function_failed);
+  }
+
+  return 0;
+}
@@ -0,0 +1,306 @@
+#include <cstdlib>
+#include <cstring>
+#include <src/library.hpp>
+#define SVF_INCLUDE_BINARY_SCHEMA
+#include <src/svf_runtime.hpp>
+#include <generated/hpp/JSON.hpp>
+#include <generated/hpp/A0.hpp>
+#include <generated/hpp/A1.hpp>
+#include <generated/hpp/C0.hpp>
+
+namespace schema = svf::JSON;
+
+bool grow_realloc(void * /*grow_ptr*/, SVFRT_Bytes *inout_buffer, uint32_t min_count) {
+  auto pointer = (U8 *) realloc(inout_buffer->pointer, min_count);
+  if (!pointer) {
+    return false;
+  }
+  inout_buffer->pointer = pointer;
+  inout_buffer->count = min_count;
+  return true;
+}
+
+void *malloc_adapter(void */*unused*/, size_t size) {
+  return malloc(size);
+}
+
+U32 const field_count = 5;
+
+// `[{"aa": 0, "ab": 1, ...}, "xyz"]`. The top level array is the entry.
+svf::runtime::Bytes write_json(U8 **out_pointer) {
+  auto ctx = svf::runtime::write_start_buffered<schema::Item>({ (U8 *) malloc(16), 16 }, grow_realloc);
+
+  U8 names[field_count][2];
+  schema::Field fields[field_count];
+  for (U32 i = 0; i < field_count; i++) {
+    names[i][0] = 'a';
+    names[i][1] = U8('a' + i);
+    fields[i] = {};
+    fields[i].name = svf::runtime::write_fixed_size_array(&ctx, names[i]);
+    fields[i].value_tag = schema::Value_tag::number;
+    fields[i].value_payload.number = i;
+  }
+
+  U8 string[3] = { 'x', 'y', 'z' };
+  schema::Item items[2] = {};
+  items[0].value_tag = schema::Value_tag::object;
+  items[0].value_payload.object = svf::runtime::write_fixed_size_array(&ctx, fields);
+  items[1].value_tag = schema::Value_tag::string;
+  items[1].value_payload.string = svf::runtime::write_fixed_size_array(&ctx, string);
+
+  schema::Item entry = {};
+  entry.value_tag = schema::Value_tag::array;
+  entry.value_payload.array = svf::runtime::write_fixed_size_array(&ctx, items);
+  svf::runtime::write_finish(&ctx, &entry);
+  ASSERT(ctx.error_code == 0);
+
+  *out_pointer = ctx.buffer.pointer;
+  return { ctx.buffer.pointer, ctx.buffer_used };
+}
+
+void check_json(svf::runtime::ReadContext *ctx, svf::runtime::Sequence<schema::Item> items) {
+  ASSERT(items.count == 2);
+  auto object = svf::runtime::read_sequence_element(ctx, items, 0);
+  ASSERT(object && object->value_tag == schema::Value_tag::object);
+  ASSERT(object->value_payload.object.count == field_count);
+  for (U32 i = 0; i < field_count; i++) {
+    auto field = svf::runtime::read_sequence_element(ctx, object->value_payload.object, i);
+    ASSERT(field);
+    auto name = svf::runtime::read_sequence_raw(ctx, field->name);
+    ASSERT(name.pointer && name.count == 2 && name.pointer[1] == 'a' + i);
+    ASSERT(field->value_tag == schema::Value_tag::number);
+    ASSERT(field->value_payload.number == i);
+  }
+  auto string_item = svf::runtime::read_sequence_element(ctx, items, 1);
+  ASSERT(string_item && string_item->value_tag == schema::Value_tag::string);
+  auto string = svf::runtime::read_sequence_raw(ctx, string_item->value_payload.string);
+  ASSERT(string.pointer && string.count == 3 && string.pointer[0] == 'x');
+}
+
+svf::runtime::Bytes write_a0(U8 **out_pointer) {
+  namespace a0 = svf::A0;
+  auto ctx = svf::runtime::write_start_buffered<a0::Entry>({ (U8 *) malloc(16), 16 }, grow_realloc);
+
+  a0::Target target = { .value = 1, .y = 2 };
+  a0::Entry entry = {};
+  entry.reference = svf::runtime::write_reference(&ctx, &target);
+  for (U32 i = 0; i < 3; i++) {
+    target = { .value = 10 + i, .y = 20 + i };
+    svf::runtime::write_sequence_element(&ctx, &target, &entry.someStruct.sequence);
+  }
+  svf::runtime::write_finish(&ctx, &entry);
+  ASSERT(ctx.error_code == 0);
+
+  *out_pointer = ctx.buffer.pointer;
+  return { ctx.buffer.pointer, ctx.buffer_used };
+}
+
+int main(int /*argc*/, char */*argv*/[]) {
+  U8 scratch_buffer[1024];
+  svf::runtime::Bytes scratch = { scratch_buffer, sizeof(scratch_buffer) };
+  U8 copy_scratch_buffer[1024];
+  svf::runtime::Bytes copy_scratch = { copy_scratch_buffer, sizeof(copy_scratch_buffer) };
+
+  // Success, copying nested sequences into a new message, after some other
+  // data, so that all offsets change.
+  {
+    U8 *source_pointer;
+    auto source = write_json(&source_pointer);
+    auto source_result = svf::runtime::read_message<schema::Item>(
+      source,
+      scratch,
+      svf::runtime::CompatibilityLevel::compatibility_exact
+    );
+    ASSERT(source_result.error_code == 0);
+
+    auto ctx = svf::runtime::write_start_buffered<schema::Item>({ (U8 *) malloc(16), 16 }, grow_realloc);
+    U8 padding[5] = {};
+    svf::runtime::write_fixed_size_array(&ctx, padding);
+
+    schema::Item entry = {};
+    entry.value_tag = schema::Value_tag::array;
+    entry.value_payload.array = svf::runtime::copy_subtree(
+      &ctx,
+      &source_result.context,
+      source_result.entry->value_payload.array,
+      copy_scratch
+    );
+    ASSERT(ctx.error_code == 0);
+    svf::runtime::write_finish(&ctx, &entry);
+    ASSERT(ctx.error_code == 0);
+    free(source_pointer);
+
+    auto result = svf::runtime::read_message<schema::Item>(
+      { ctx.buffer.pointer, ctx.buffer_used },
+      scratch,
+      svf::runtime::CompatibilityLevel::compatibility_exact
+    );
+    ASSERT(result.error_code == 0);
+    ASSERT(svf::runtime::verify_message(&result) == 0);
+    ASSERT(result.entry->value_tag == schema::Value_tag::array);
+    check_json(&result.context, result.entry->value_payload.array);
+    free(ctx.buffer.pointer);
+  }
+
+  // Success, when the source has more fields than the schema it is read with.
+  // With binary compatibility, only the known fields are copied, and with
+  // logical compatibility, the data is already converted.
+  for (U32 logical = 0; logical < 2; logical++) {
+    namespace a1 = svf::A1;
+    U8 *source_pointer;
+    auto source = write_a0(&source_pointer);
+    auto source_result = svf::runtime::read_message<a1::Entry>(
+      source,
+      scratch,
+      logical
+        ? svf::runtime::CompatibilityLevel::compatibility_logical
+        : svf::runtime::CompatibilityLevel::compatibility_binary,
+      malloc_adapter
+    );
+    ASSERT(source_result.error_code == 0);
+    auto source_ctx = &source_result.context;
+
+    auto ctx = svf::runtime::write_start_buffered<a1::Entry>({ (U8 *) malloc(16), 16 }, grow_realloc);
+    a1::Entry entry = {};
+    entry.someStruct.sequence = svf::runtime::copy_subtree(
+      &ctx,
+      source_ctx,
+      source_result.entry->someStruct.sequence,
+      copy_scratch
+    );
+    entry.reference = svf::runtime::copy_subtree(&ctx, source_ctx, source_result.entry->reference, copy_scratch);
+    svf::runtime::write_finish(&ctx, &entry);
+    ASSERT(ctx.error_code == 0);
+    free(source_pointer);
+
+    auto result = svf::runtime::read_message<a1::Entry>(
+      { ctx.buffer.pointer, ctx.buffer_used },
+      scratch,
+      svf::runtime::CompatibilityLevel::compatibility_exact
+    );
+    ASSERT(result.error_code == 0);
+    ASSERT(svf::runtime::verify_message(&result) == 0);
+    auto read_ctx = &result.context;
+
+    // Only 8 bytes per target, instead of 16.
+    ASSERT(ctx.buffer_used < source.count);
+    auto target = svf::runtime::read_reference(read_ctx, result.entry->reference);
+    ASSERT(target && target->value == 1);
+    ASSERT(result.entry->someStruct.sequence.count == 3);
+    for (U32 i = 0; i < 3; i++) {
+      auto element = svf::runtime::read_sequence_element(read_ctx, result.entry->someStruct.sequence, i);
+      ASSERT(element && element->value == 10 + i);
+    }
+    free(ctx.buffer.pointer);
+  }
+
+  // Success, with a chunked sequence, which is copied chunk by chunk.
+  {
+    namespace c0 = svf::C0;
+    auto source_ctx = svf::runtime::write_start_buffered<c0::Entry>({ (U8 *) malloc(16), 16 }, grow_realloc);
+    svf::runtime::ChunkedSequenceBuilder<c0::Target> targets = {};
+    for (U32 i = 0; i < 20; i++) {
+      c0::Target target = { .value = i, .y = 2 * i };
+      svf::runtime::write_chunked_sequence_element(&source_ctx, &targets, &target);
+
+      // Breaks the targets into chunks.
+      if (i % 4 == 0) {
+        U8 padding = 0;
+        svf::runtime::write_reference(&source_ctx, &padding);
+      }
+    }
+    c0::Entry source_entry = {};
+    source_entry.targets = svf::runtime::write_chunked_sequence_finish(&source_ctx, &targets);
+    svf::runtime::write_finish(&source_ctx, &source_entry);
+    ASSERT(source_ctx.error_code == 0);
+
+    auto source_result = svf::runtime::read_message<c0::Entry>(
+      { source_ctx.buffer.pointer, source_ctx.buffer_used },
+      scratch,
+      svf::runtime::CompatibilityLevel::compatibility_exact
+    );
+    ASSERT(source_result.error_code == 0);
+    ASSERT(svf::runtime::read_chunk_count(&source_result.context, source_result.entry->targets) > 1);
+
+    auto ctx = svf::runtime::write_start_buffered<c0::Entry>({ (U8 *) malloc(16), 16 }, grow_realloc);
+    c0::Entry entry = {};
+    entry.targets = svf::runtime::copy_subtree(
+      &ctx,
+      &source_result.context,
+      source_result.entry->targets,
+      copy_scratch
+    );
+    svf::runtime::write_finish(&ctx, &entry);
+    ASSERT(ctx.error_code == 0);
+    free(source_ctx.buffer.pointer);
+
+    auto result = svf::runtime::read_message<c0::Entry>(
+      { ctx.buffer.pointer, ctx.buffer_used },
+      scratch,
+      svf::runtime::CompatibilityLevel::compatibility_exact
+    );
+    ASSERT(result.error_code == 0);
+    ASSERT(svf::runtime::verify_message(&result) == 0);
+    auto read_ctx = &result.context;
+    ASSERT(result.entry->targets.count == 20);
+
+    svf::runtime::Sequence<c0::Target> chunks[20];
+    U32 chunk_count = svf::runtime::read_chunks(read_ctx, result.entry->targets, { chunks, 20 });
+    U32 next = 0;
+    for (U32 i = 0; i < chunk_count; i++) {
+      for (U32 j = 0; j < chunks[i].count; j++) {
+        auto target = svf::runtime::read_sequence_element(read_ctx, chunks[i], j);
+        ASSERT(target && target->value == next && target->y == 2 * next);
+        next++;
+      }
+    }
+    ASSERT(next == 20);
+    free(ctx.buffer.pointer);
+  }
+
+  // Fail, when `scratch` can't fit the items with handles in them.
+  {
+    U8 *source_pointer;
+    auto source = write_json(&source_pointer);
+    auto source_result = svf::runtime::read_message<schema::Item>(
+      source,
+      scratch,
+      svf::runtime::CompatibilityLevel::compatibility_exact
+    );
+    ASSERT(source_result.error_code == 0);
+
+    auto ctx = svf::runtime::write_start_buffered<schema::Item>({ (U8 *) malloc(16), 16 }, grow_realloc);
+    svf::runtime::copy_subtree(
+      &ctx,
+      &source_result.context,
+      source_result.entry->value_payload.array,
+      { copy_scratch_buffer, 8 }
+    );
+    ASSERT(ctx.error_code == SVFRT_code_write__not_enough_scratch);
+    free(source_pointer);
+    free(ctx.buffer.pointer);
+  }
+
+  // Fail, when the source is malformed.
+  {
+    U8 *source_pointer;
+    auto source = write_json(&source_pointer);
+    auto source_result = svf::runtime::read_message<schema::Item>(
+      source,
+      scratch,
+      svf::runtime::CompatibilityLevel::compatibility_exact
+    );
+    ASSERT(source_result.error_code == 0);
+
+    auto array = source_result.entry->value_payload.array;
+    array.count = 1000;
+    auto ctx = svf::runtime::write_start_buffered<schema::Item>({ (U8 *) malloc(16), 16 }, grow_realloc);
+    auto copied = svf::runtime::copy_subtree(&ctx, &source_result.context, array, copy_scratch);
+    ASSERT(ctx.error_code == SVFRT_code_write__bad_subtree);
+    ASSERT(copied.count == UINT32_MAX);
+    free(source_pointer);
+    free(ctx.buffer.pointer);
+  }
+
+  return 0;
+}
@@ -0,0 +1,201 @@
+#include <cstdio>
+#include <cstdlib>
+#include <src/library.hpp>
+#define SVF_INCLUDE_BINARY_SCHEMA
+#include <src/svf_runtime.hpp>
+#include <generated/hpp/JSON.hpp>
+
+namespace schema = svf::JSON;
+
+bool grow_realloc(void * /*grow_ptr*/, SVFRT_Bytes *inout_buffer, uint32_t min_count) {
+  auto pointer = (U8 *) realloc(inout_buffer->pointer, min_count);
+  if (!pointer) {
+    return false;
+  }
+  inout_buffer->pointer = pointer;
+  inout_buffer->count = min_count;
+  return true;
+}
+
+U32 count_writer(void *writer_ptr, SVFRT_Bytes data) {
+  *(U32 *) writer_ptr += data.count;
+  return data.count;
+}
+
+U8 const key_name[4] = { 'k', 'e', 'y', 's' };
+
+// The n-th object is `{"keys": "<letter>..."}`, with `length` letters, where the
+// letter repeats every `period` objects.
+U8 object_letter(U32 n, U32 period) {
+  return U8('a' + n % period);
+}
+
+// `[{"keys": "aaa..."}, {"keys": "bbb..."}, ...]`, where the top level array is
+// the entry. The names, the fields, and the objects are interned, if `table`
+// is present.
+void write_objects(
+  svf::runtime::WriteContext<schema::Item> *ctx,
+  SVFRT_InternTable *table,
+  U32 object_count,
+  U32 period,
+  U32 length
+) {
+  schema::Item objects[64];
+  ASSERT(object_count <= 64);
+
+  for (U32 i = 0; i < object_count; i++) {
+    U8 string[32];
+    ASSERT(length <= sizeof(string));
+    for (U32 j = 0; j < length; j++) {
+      string[j] = object_letter(i, period);
+    }
+
+    schema::Field field = {};
+    field.name = svf::runtime::write_sequence_interned(ctx, table, key_name, sizeof(key_name));
+    field.value_tag = schema::Value_tag::string;
+    field.value_payload.string = svf::runtime::write_sequence_interned(ctx, table, string, length);
+
+    objects[i] = {};
+    objects[i].value_tag = schema::Value_tag::object;
+    objects[i].value_payload.object = svf::runtime::write_sequence_interned(ctx, table, &field, 1);
+  }
+
+  schema::Item entry = {};
+  entry.value_tag = schema::Value_tag::array;
+  entry.value_payload.array = svf::runtime::write_sequence(ctx, objects, object_count);
+  svf::runtime::write_finish(ctx, &entry);
+}
+
+void check_objects(svf::runtime::Bytes message, U32 object_count, U32 period, U32 length) {
+  U8 scratch_buffer[1024];
+  auto result = svf::runtime::read_message<schema::Item>(
+    message,
+    { scratch_buffer, sizeof(scratch_buffer) },
+    svf::runtime::CompatibilityLevel::compatibility_exact
+  );
+  ASSERT(result.error_code == 0);
+  auto ctx = &result.context;
+  ASSERT(result.entry->value_payload.array.count == object_count);
+
+  for (U32 i = 0; i < object_count; i++) {
+    auto object = svf::runtime::read_sequence_element(ctx, result.entry->value_payload.array, i);
+    ASSERT(object && object->value_tag == schema::Value_tag::object);
+    auto field = svf::runtime::read_sequence_element(ctx, object->value_payload.object, 0);
+    ASSERT(field && field->value_tag == schema::Value_tag::string);
+    auto name = svf::runtime::read_sequence_raw(ctx, field->name);
+    ASSERT(name.pointer && name.count == sizeof(key_name));
+    for (U32 j = 0; j < name.count; j++) {
+      ASSERT(name.pointer[j] == key_name[j]);
+    }
+    auto string = svf::runtime::read_sequence_raw(ctx, field->value_payload.string);
+    ASSERT(string.pointer && string.count == length);
+    for (U32 j = 0; j < length; j++) {
+      ASSERT(string.pointer[j] == object_letter(i, period));
+    }
+  }
+}
+
+int main(int /*argc*/, char */*argv*/[]) {
+  alignas(8) U8 table_buffer[sizeof(SVFRT_InternEntry) * 64];
+  U32 const object_count = 60;
+  U32 const period = 3;
+  U32 const length = 20;
+
+  // Regular writing, as a reference.
+  U32 plain_size = 0;
+  {
+    auto ctx = svf::runtime::write_start_buffered<schema::Item>({ (U8 *) malloc(16), 16 }, grow_realloc);
+    write_objects(&ctx, NULL, object_count, period, length);
+    ASSERT(ctx.error_code == 0);
+    plain_size = ctx.buffer_used;
+    check_objects({ ctx.buffer.pointer, ctx.buffer_used }, object_count, period, length);
+    free(ctx.buffer.pointer);
+  }
+
+  // Success, with only `period` distinct objects written. The message is
+  // readable, but not verifiable, since the data is aliased.
+  {
+    SVFRT_InternTable table = {};
+    ASSERT(SVFRT_intern_table_init(&table, { table_buffer, sizeof(table_buffer) }, 4));
+    ASSERT(table.capacity == 64);
+
+    auto ctx = svf::runtime::write_start_buffered<schema::Item>({ (U8 *) malloc(16), 16 }, grow_realloc);
+    write_objects(&ctx, &table, object_count, period, length);
+    ASSERT(ctx.error_code == 0);
+    ASSERT(ctx.buffer_used < plain_size / 2);
+
+    // The name and each distinct string and object are written once.
+    ASSERT(table.hit_count == object_count - 1 + 2 * (object_count - period));
+    check_objects({ ctx.buffer.pointer, ctx.buffer_used }, object_count, period, length);
+
+    U8 scratch_buffer[1024];
+    auto result = svf::runtime::read_message<schema::Item>(
+      { ctx.buffer.pointer, ctx.buffer_used },
+      { scratch_buffer, sizeof(scratch_buffer) },
+      svf::runtime::CompatibilityLevel::compatibility_exact
+    );
+    ASSERT(result.error_code == 0);
+    ASSERT(svf::runtime::verify_message(&result) == SVFRT_code_verify__data_aliasing_detected);
+    free(ctx.buffer.pointer);
+  }
+
+  // Success, with a single slot, which is replaced on every miss, and ranges
+  // smaller than `min_size` written as usual. Nothing repeats, so the message
+  // is the same as without interning.
+  {
+    SVFRT_InternTable table = {};
+    ASSERT(SVFRT_intern_table_init(&table, { table_buffer + 1, sizeof(SVFRT_InternEntry) + 7 }, 8));
+    ASSERT(table.capacity == 1);
+
+    auto ctx = svf::runtime::write_start_buffered<schema::Item>({ (U8 *) malloc(16), 16 }, grow_realloc);
+    write_objects(&ctx, &table, object_count, object_count, length);
+    ASSERT(ctx.error_code == 0);
+    ASSERT(table.hit_count == 0);
+    ASSERT(ctx.buffer_used == plain_size);
+    check_objects({ ctx.buffer.pointer, ctx.buffer_used }, object_count, object_count, length);
+    free(ctx.buffer.pointer);
+  }
+
+  // Success, with a writer, where ranges that were flushed can't be matched,
+  // but recent ones still can.
+  {
+    SVFRT_InternTable table = {};
+    ASSERT(SVFRT_intern_table_init(&table, { table_buffer, sizeof(table_buffer) }, 4));
+
+    U32 written = 0;
+    U8 buffer[256];
+    auto ctx = svf::runtime::write_start_buffered<schema::Item>(
+      { buffer, sizeof(buffer) },
+      NULL,
+      NULL,
+      count_writer,
+      &written
+    );
+    write_objects(&ctx, &table, object_count, period, length);
+    ASSERT(ctx.error_code == 0);
+    ASSERT(table.hit_count > 0);
+    ASSERT(written < plain_size);
+  }
+
+  // Success, without a buffer, which is the same as regular writing.
+  {
+    SVFRT_InternTable table = {};
+    ASSERT(SVFRT_intern_table_init(&table, { table_buffer, sizeof(table_buffer) }, 4));
+
+    U32 written = 0;
+    auto ctx = svf::runtime::write_start<schema::Item>(count_writer, &written);
+    write_objects(&ctx, &table, object_count, period, length);
+    ASSERT(ctx.error_code == 0);
+    ASSERT(table.hit_count == 0);
+    ASSERT(written == plain_size);
+  }
+
+  // Fail, when the table memory doesn't fit a single entry.
+  {
+    SVFRT_InternTable table = {};
+    ASSERT(!SVFRT_intern_table_init(&table, { table_buffer + 1, sizeof(SVFRT_InternEntry) }, 4));
+    ASSERT(table.capacity == 0);
+  }
+
+  return 0;
+}
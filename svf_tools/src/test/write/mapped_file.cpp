@@ -0,0 +1,108 @@
+#include <cstdio>
+#include <src/library.hpp>
+#define SVF_INCLUDE_BINARY_SCHEMA
+#include <src/svf_runtime.hpp>
+#include <src/svf_mmap.h>
+#include <generated/hpp/A0.hpp>
+
+namespace schema = svf::A0;
+
+U32 write_arena(void *it, SVFRT_Bytes src) {
+  auto arena = (vm::LinearArena *) it;
+  auto dst = vm::many<U8>(arena, src.count);
+  range_copy(dst, {src.pointer, src.count});
+  return safe_int_cast<U32>(src.count);
+};
+
+void write_test_message(svf::runtime::WriteContext<schema::Entry> *ctx, U32 target_count) {
+  schema::Entry entry = {};
+  for (U32 i = 0; i < target_count; i++) {
+    schema::Target target = { .value = i, .y = 2 * i };
+    svf::runtime::write_sequence_element(ctx, &target, &entry.someStruct.sequence);
+  }
+  schema::Target target = { .value = 42, .y = 43 };
+  entry.reference = svf::runtime::write_reference(ctx, &target);
+  svf::runtime::write_finish(ctx, &entry);
+}
+
+static
+void assert_same_bytes(SVFRT_Bytes a, SVFRT_Bytes b) {
+  ASSERT(a.count == b.count);
+  for (U32 i = 0; i < a.count; i++) {
+    ASSERT(a.pointer[i] == b.pointer[i]);
+  }
+}
+
+int main(int /*argc*/, char */*argv*/[]) {
+  auto arena_value = vm::create_linear_arena(1ull << 20);
+  auto arena = &arena_value;
+  U32 target_count = 10000;
+  char const *path = "test_write_mapped_file.svf";
+
+  // Prepare: the message, written to memory.
+  auto message_pointer = (U8 *) vm::realign(arena);
+  auto waterline_before = arena->waterline;
+  {
+    auto ctx = svf::runtime::write_start<schema::Entry>(write_arena, arena);
+    write_test_message(&ctx, target_count);
+    ASSERT(ctx.error_code == 0);
+  }
+  SVFRT_Bytes message = {
+    message_pointer,
+    safe_int_cast<U32>(arena->waterline - waterline_before),
+  };
+
+  // Success, the file grows a few times, and is trimmed to the message.
+  {
+    SVFRT_MappedFileWriter writer = {};
+    ASSERT(SVFRT_mapped_file_writer_open(&writer, path, 4096));
+    auto ctx = svf::runtime::write_start_buffered<schema::Entry>(
+      { writer.buffer.pointer, writer.buffer.count },
+      SVFRT_mapped_file_writer_grow,
+      &writer
+    );
+    write_test_message(&ctx, target_count);
+    ASSERT(ctx.error_code == 0);
+    ASSERT(ctx.finished);
+    ASSERT(writer.buffer.count > ctx.buffer_used);
+    ASSERT(SVFRT_mapped_file_writer_close(&writer, ctx.buffer_used, true));
+    ASSERT(writer.buffer.pointer == NULL);
+
+    auto mapped = SVFRT_map_file(path);
+    assert_same_bytes(mapped, message);
+
+    auto result = svf::runtime::read_message<schema::Entry>(
+      { mapped.pointer, mapped.count },
+      {},
+      svf::runtime::CompatibilityLevel::compatibility_exact
+    );
+    ASSERT(result.error_code == 0);
+    auto element = svf::runtime::read_sequence_element(
+      &result.context,
+      result.entry->someStruct.sequence,
+      target_count - 1
+    );
+    ASSERT(element && element->value == target_count - 1);
+    SVFRT_unmap_file(mapped);
+  }
+
+  // Fail, when the size to trim to is larger than the mapping. The file is
+  // still closed.
+  {
+    SVFRT_MappedFileWriter writer = {};
+    ASSERT(SVFRT_mapped_file_writer_open(&writer, path, 4096));
+    ASSERT(!SVFRT_mapped_file_writer_close(&writer, 8192, false));
+    auto mapped = SVFRT_map_file(path);
+    ASSERT(mapped.count == 4096);
+    SVFRT_unmap_file(mapped);
+  }
+
+  // Fail, when there is nothing to map.
+  {
+    SVFRT_MappedFileWriter writer = {};
+    ASSERT(!SVFRT_mapped_file_writer_open(&writer, path, 0));
+  }
+
+  remove(path);
+  return 0;
+}
@@ -0,0 +1,272 @@
+#include <cstdio>
+#include <cstdlib>
+#include <src/library.hpp>
+#define SVF_INCLUDE_BINARY_SCHEMA
+#include <src/svf_runtime.hpp>
+#include <src/svf_mmap.h>
+#include <generated/hpp/JSON.hpp>
+#include <generated/hpp/C0.hpp>
+
+namespace schema = svf::JSON;
+
+bool grow_realloc(void * /*grow_ptr*/, SVFRT_Bytes *inout_buffer, uint32_t min_count) {
+  auto pointer = (U8 *) realloc(inout_buffer->pointer, min_count);
+  if (!pointer) {
+    return false;
+  }
+  inout_buffer->pointer = pointer;
+  inout_buffer->count = min_count;
+  return true;
+}
+
+// `[{"count": 0, "name": "aaa"}]`, where the top level array is the entry.
+svf::runtime::WriteContext<schema::Item> write_json() {
+  auto ctx = svf::runtime::write_start_buffered<schema::Item>({ (U8 *) malloc(16), 16 }, grow_realloc);
+
+  U8 count_name[5] = { 'c', 'o', 'u', 'n', 't' };
+  U8 name_name[4] = { 'n', 'a', 'm', 'e' };
+  U8 name[3] = { 'a', 'a', 'a' };
+  schema::Field fields[2] = {};
+  fields[0].name = svf::runtime::write_fixed_size_array(&ctx, count_name);
+  fields[0].value_tag = schema::Value_tag::number;
+  fields[0].value_payload.number = 0;
+  fields[1].name = svf::runtime::write_fixed_size_array(&ctx, name_name);
+  fields[1].value_tag = schema::Value_tag::string;
+  fields[1].value_payload.string = svf::runtime::write_fixed_size_array(&ctx, name);
+
+  schema::Item object = {};
+  object.value_tag = schema::Value_tag::object;
+  object.value_payload.object = svf::runtime::write_fixed_size_array(&ctx, fields);
+
+  schema::Item entry = {};
+  entry.value_tag = schema::Value_tag::array;
+  entry.value_payload.array = svf::runtime::write_sequence(&ctx, &object, 1);
+  svf::runtime::write_finish(&ctx, &entry);
+  ASSERT(ctx.error_code == 0);
+  return ctx;
+}
+
+schema::Field *patch_field(svf::runtime::PatchContext<schema::Item> *ctx, U32 index) {
+  auto entry = svf::runtime::patch_entry(ctx);
+  ASSERT(entry && entry->value_tag == schema::Value_tag::array);
+  auto object = svf::runtime::patch_sequence_element(ctx, entry->value_payload.array, 0);
+  ASSERT(object && object->value_tag == schema::Value_tag::object);
+  auto field = svf::runtime::patch_sequence_element(ctx, object->value_payload.object, index);
+  ASSERT(field);
+  return field;
+}
+
+// Replace the name with `length` copies of `letter`.
+void patch_name(svf::runtime::PatchContext<schema::Item> *ctx, U8 letter, U32 length) {
+  U8 name[16];
+  ASSERT(length <= sizeof(name));
+  for (U32 i = 0; i < length; i++) {
+    name[i] = letter;
+  }
+  auto string = svf::runtime::write_sequence(svf::runtime::patch_writer(ctx), name, length);
+  ASSERT(ctx->write.error_code == 0);
+
+  auto field = patch_field(ctx, 1);
+  svf::runtime::patch_release(ctx, field->value_payload.string);
+  field->value_payload.string = string;
+}
+
+void check_json(svf::runtime::Bytes message, F64 count, U8 letter, U32 length) {
+  U8 scratch_buffer[1024];
+  auto result = svf::runtime::read_message<schema::Item>(
+    message,
+    { scratch_buffer, sizeof(scratch_buffer) },
+    svf::runtime::CompatibilityLevel::compatibility_exact
+  );
+  ASSERT(result.error_code == 0);
+  ASSERT(svf::runtime::verify_message(&result) == 0);
+  auto ctx = &result.context;
+
+  auto object = svf::runtime::read_sequence_element(ctx, result.entry->value_payload.array, 0);
+  ASSERT(object && object->value_payload.object.count == 2);
+  auto count_field = svf::runtime::read_sequence_element(ctx, object->value_payload.object, 0);
+  ASSERT(count_field && count_field->value_payload.number == count);
+  auto name_field = svf::runtime::read_sequence_element(ctx, object->value_payload.object, 1);
+  ASSERT(name_field && name_field->value_tag == schema::Value_tag::string);
+  auto name = svf::runtime::read_sequence_raw(ctx, name_field->value_payload.string);
+  ASSERT(name.pointer && name.count == length);
+  for (U32 i = 0; i < length; i++) {
+    ASSERT(name.pointer[i] == letter);
+  }
+}
+
+int main(int /*argc*/, char */*argv*/[]) {
+  U8 scratch_buffer[1024];
+  svf::runtime::Bytes scratch = { scratch_buffer, sizeof(scratch_buffer) };
+
+  // Success, changing a number in place, which leaves the size as it was.
+  {
+    auto write_ctx = write_json();
+    U32 size = write_ctx.buffer_used;
+    auto ctx = svf::runtime::patch_start<schema::Item>({ write_ctx.buffer.pointer, write_ctx.buffer.count }, size, grow_realloc);
+    ASSERT(ctx.write.error_code == 0);
+
+    patch_field(&ctx, 0)->value_payload.number += 1;
+    svf::runtime::patch_finish(&ctx);
+    ASSERT(ctx.write.error_code == 0);
+    ASSERT(ctx.write.buffer_used == size);
+    ASSERT(ctx.dead_bytes == 0);
+    check_json({ ctx.write.buffer.pointer, ctx.write.buffer_used }, 1, 'a', 3);
+    free(ctx.write.buffer.pointer);
+  }
+
+  // Success, replacing the name a few times, until the dead bytes are over the
+  // threshold. The compacted message is as large as one written from scratch,
+  // where the 5 more bytes of the name are padded up to 8 for the structs after
+  // it, see #natural-alignment.
+  {
+    auto write_ctx = write_json();
+    U32 size = write_ctx.buffer_used;
+    auto ctx = svf::runtime::patch_start<schema::Item>({ write_ctx.buffer.pointer, write_ctx.buffer.count }, size, grow_realloc);
+    U32 const threshold = 48;
+
+    for (U32 i = 0; i < 4; i++) {
+      patch_name(&ctx, U8('d' + i), 8);
+      patch_field(&ctx, 0)->value_payload.number = i;
+      svf::runtime::patch_finish(&ctx, scratch, threshold);
+      ASSERT(ctx.write.error_code == 0);
+      check_json({ ctx.write.buffer.pointer, ctx.write.buffer_used }, i, U8('d' + i), 8);
+
+      if (i < 2) {
+        ASSERT(ctx.dead_bytes > 0 && ctx.dead_bytes <= threshold);
+        ASSERT(ctx.write.buffer_used > size + 5);
+      }
+    }
+    ASSERT(ctx.dead_bytes < threshold);
+
+    svf::runtime::patch_finish(&ctx, scratch, 0);
+    ASSERT(ctx.write.error_code == 0);
+    ASSERT(ctx.dead_bytes == 0);
+    ASSERT(ctx.write.buffer_used == size + 8);
+    check_json({ ctx.write.buffer.pointer, ctx.write.buffer_used }, 3, 'g', 8);
+    free(ctx.write.buffer.pointer);
+  }
+
+  // Success, with chunked sequences, which have their chains moved as well.
+  {
+    namespace c0 = svf::C0;
+    auto write_ctx = svf::runtime::write_start_buffered<c0::Entry>({ (U8 *) malloc(16), 16 }, grow_realloc);
+    svf::runtime::ChunkedSequenceBuilder<c0::Target> targets = {};
+    svf::runtime::ChunkedSequenceBuilder<U16> values = {};
+    for (U32 i = 0; i < 20; i++) {
+      c0::Target target = { .value = i, .y = 2 * i };
+      svf::runtime::write_chunked_sequence_element(&write_ctx, &targets, &target);
+      U16 value = U16(i);
+      svf::runtime::write_chunked_sequence_element(&write_ctx, &values, &value);
+    }
+    c0::Entry entry = {};
+    entry.targets = svf::runtime::write_chunked_sequence_finish(&write_ctx, &targets);
+    entry.values = svf::runtime::write_chunked_sequence_finish(&write_ctx, &values);
+    svf::runtime::write_finish(&write_ctx, &entry);
+    ASSERT(write_ctx.error_code == 0);
+
+    // Replace the values with a single chunk.
+    auto ctx = svf::runtime::patch_start<c0::Entry>({ write_ctx.buffer.pointer, write_ctx.buffer.count }, write_ctx.buffer_used, grow_realloc);
+    svf::runtime::ChunkedSequenceBuilder<U16> new_values = {};
+    U16 value = 7;
+    svf::runtime::write_chunked_sequence_element(svf::runtime::patch_writer(&ctx), &new_values, &value);
+    auto new_values_sequence = svf::runtime::write_chunked_sequence_finish(svf::runtime::patch_writer(&ctx), &new_values);
+    svf::runtime::patch_entry(&ctx)->values = new_values_sequence;
+    svf::runtime::patch_finish(&ctx, scratch, 0);
+    ASSERT(ctx.write.error_code == 0);
+    ASSERT(ctx.write.buffer_used < write_ctx.buffer_used);
+
+    auto result = svf::runtime::read_message<c0::Entry>(
+      { ctx.write.buffer.pointer, ctx.write.buffer_used },
+      scratch,
+      svf::runtime::CompatibilityLevel::compatibility_exact
+    );
+    ASSERT(result.error_code == 0);
+    ASSERT(svf::runtime::verify_message(&result) == 0);
+    auto read_ctx = &result.context;
+
+    svf::runtime::Sequence<c0::Target> chunks[20];
+    U32 chunk_count = svf::runtime::read_chunks(read_ctx, result.entry->targets, { chunks, 20 });
+    ASSERT(chunk_count == 20);
+    for (U32 i = 0; i < chunk_count; i++) {
+      auto target = svf::runtime::read_sequence_element(read_ctx, chunks[i], 0);
+      ASSERT(chunks[i].count == 1 && target && target->value == i && target->y == 2 * i);
+    }
+    svf::runtime::Sequence<U16> value_chunks[1];
+    ASSERT(svf::runtime::read_chunks(read_ctx, result.entry->values, { value_chunks, 1 }) == 1);
+    auto values_read = svf::runtime::read_sequence_raw(read_ctx, value_chunks[0]);
+    ASSERT(values_read.pointer && values_read.count == 1 && values_read.pointer[0] == 7);
+    free(ctx.write.buffer.pointer);
+  }
+
+  // Success, patching a mapped file, which grows, and is trimmed back.
+#ifdef SVFRT_MAPPED_FILE_WRITER_AVAILABLE
+  {
+    char const *path = "test_write_patch.svf";
+    auto write_ctx = write_json();
+    auto file = fopen(path, "wb");
+    ASSERT(file);
+    ASSERT(fwrite(write_ctx.buffer.pointer, 1, write_ctx.buffer_used, file) == write_ctx.buffer_used);
+    fclose(file);
+    free(write_ctx.buffer.pointer);
+
+    SVFRT_MappedFileWriter writer = {};
+    U32 size = 0;
+    ASSERT(SVFRT_mapped_file_writer_open_existing(&writer, path, &size));
+    ASSERT(size == write_ctx.buffer_used);
+    auto ctx = svf::runtime::patch_start<schema::Item>(
+      { writer.buffer.pointer, writer.buffer.count },
+      size,
+      SVFRT_mapped_file_writer_grow,
+      &writer
+    );
+    patch_name(&ctx, 'x', 16);
+    svf::runtime::patch_finish(&ctx, scratch, 0);
+    ASSERT(ctx.write.error_code == 0);
+    ASSERT(SVFRT_mapped_file_writer_close(&writer, ctx.write.buffer_used, true));
+
+    auto mapped = SVFRT_map_file(path);
+    // The 13 more bytes of the name are padded up to 16, see #natural-alignment.
+    ASSERT(mapped.count == size + 16);
+    check_json({ mapped.pointer, mapped.count }, 0, 'x', 16);
+    SVFRT_unmap_file(mapped);
+    remove(path);
+  }
+#endif
+
+  // Fail, when the message has another schema.
+  {
+    auto write_ctx = write_json();
+    auto ctx = svf::runtime::patch_start<svf::C0::Entry>({ write_ctx.buffer.pointer, write_ctx.buffer.count }, write_ctx.buffer_used);
+    ASSERT(ctx.write.error_code == SVFRT_code_write__patch_mismatch);
+    ASSERT(svf::runtime::patch_entry(&ctx) == NULL);
+    free(write_ctx.buffer.pointer);
+  }
+
+  // Fail, when there is not enough scratch memory to compact. The message is
+  // still valid, with the entry moved.
+  {
+    auto write_ctx = write_json();
+    auto ctx = svf::runtime::patch_start<schema::Item>({ write_ctx.buffer.pointer, write_ctx.buffer.count }, write_ctx.buffer_used, grow_realloc);
+    patch_name(&ctx, 'y', 4);
+    svf::runtime::patch_finish(&ctx, { scratch_buffer, 32 }, 0);
+    ASSERT(ctx.write.error_code == SVFRT_code_write__not_enough_scratch);
+    check_json({ ctx.write.buffer.pointer, ctx.write.buffer_used }, 0, 'y', 4);
+    free(ctx.write.buffer.pointer);
+  }
+
+  // Fail, when a handle is broken. Nothing is moved.
+  {
+    auto write_ctx = write_json();
+    auto ctx = svf::runtime::patch_start<schema::Item>({ write_ctx.buffer.pointer, write_ctx.buffer.count }, write_ctx.buffer_used, grow_realloc);
+    auto field = patch_field(&ctx, 1);
+    field->value_payload.string.count = 1000;
+    svf::runtime::patch_release(&ctx, field->value_payload.string);
+    svf::runtime::patch_finish(&ctx, scratch, 0);
+    ASSERT(ctx.write.error_code == SVFRT_code_write__compaction_failed);
+    ASSERT(ctx.write.buffer_used == write_ctx.buffer_used);
+    free(ctx.write.buffer.pointer);
+  }
+
+  return 0;
+}
@@ -0,0 +1,146 @@
+#include <cstdlib>
+#include <src/library.hpp>
+#define SVF_INCLUDE_BINARY_SCHEMA
+#include <src/svf_runtime.hpp>
+#include <generated/hpp/A0.hpp>
+
+namespace schema = svf::A0;
+
+U32 write_arena(void *it, SVFRT_Bytes src) {
+  auto arena = (vm::LinearArena *) it;
+  auto dst = vm::many<U8>(arena, src.count);
+  range_copy(dst, {src.pointer, src.count});
+  return safe_int_cast<U32>(src.count);
+};
+
+bool grow_realloc(void * /*grow_ptr*/, SVFRT_Bytes *inout_buffer, uint32_t min_count) {
+  auto pointer = (U8 *) realloc(inout_buffer->pointer, min_count);
+  if (!pointer) {
+    return false;
+  }
+  inout_buffer->pointer = pointer;
+  inout_buffer->count = min_count;
+  return true;
+}
+
+static
+void assert_same_bytes(SVFRT_Bytes a, SVFRT_Bytes b) {
+  ASSERT(a.count == b.count);
+  for (U32 i = 0; i < a.count; i++) {
+    ASSERT(a.pointer[i] == b.pointer[i]);
+  }
+}
+
+int main(int /*argc*/, char */*argv*/[]) {
+  auto arena_value = vm::create_linear_arena(1ull << 20);
+  auto arena = &arena_value;
+  U32 target_count = 1000;
+
+  // Prepare: the same message, written by copying.
+  auto message_pointer = (U8 *) vm::realign(arena);
+  auto waterline_before = arena->waterline;
+  {
+    auto ctx = svf::runtime::write_start<schema::Entry>(write_arena, arena);
+    schema::Entry entry = {};
+    U8 bytes[3] = { 1, 2, 3 };
+    svf::runtime::write_fixed_size_array(&ctx, bytes);
+    for (U32 i = 0; i < target_count; i++) {
+      schema::Target target = { .value = i, .y = i + 1 };
+      svf::runtime::write_sequence_element(&ctx, &target, &entry.someStruct.sequence);
+    }
+    schema::Target target = { .value = 42, .y = 43 };
+    entry.reference = svf::runtime::write_reference(&ctx, &target);
+    svf::runtime::write_finish(&ctx, &entry);
+    ASSERT(ctx.error_code == 0);
+  }
+  SVFRT_Bytes message = {
+    message_pointer,
+    safe_int_cast<U32>(arena->waterline - waterline_before),
+  };
+
+  // Success, filling in place, both with a growing buffer and with a small
+  // buffer that gets flushed. The message is the same as when copying.
+  for (U32 flushing = 0; flushing < 2; flushing++) {
+    alignas(8) U8 small_buffer[64];
+    SVFRT_Bytes buffer = { small_buffer, sizeof(small_buffer) };
+    if (!flushing) {
+      buffer = { (U8 *) malloc(16), 16 };
+    }
+
+    auto output_pointer = (U8 *) vm::realign(arena);
+    waterline_before = arena->waterline;
+    auto ctx = svf::runtime::write_start_buffered<schema::Entry>(
+      { buffer.pointer, buffer.count },
+      flushing ? NULL : grow_realloc,
+      NULL,
+      flushing ? write_arena : NULL,
+      flushing ? arena : NULL
+    );
+    ASSERT(ctx.error_code == 0);
+
+    schema::Entry entry = {};
+    svf::runtime::Sequence<U8> byte_sequence = {};
+    auto bytes = svf::runtime::reserve_sequence(&ctx, 3, &byte_sequence);
+    ASSERT(bytes);
+    bytes[0] = 1;
+    bytes[1] = 2;
+    bytes[2] = 3;
+
+    // With a flushing buffer, only a few elements fit at once.
+    U32 chunk = flushing ? 2 : target_count;
+    for (U32 i = 0; i < target_count; i += chunk) {
+      svf::runtime::Sequence<schema::Target> part = {};
+      auto targets = svf::runtime::reserve_sequence(&ctx, chunk, &part);
+      ASSERT(targets);
+      ASSERT(((uintptr_t) targets) % 8 == 0);
+      for (U32 j = 0; j < chunk; j++) {
+        targets[j] = { .value = i + j, .y = i + j + 1 };
+      }
+      if (i == 0) {
+        entry.someStruct.sequence = part;
+      }
+    }
+    entry.someStruct.sequence.count = target_count;
+
+    auto target = svf::runtime::reserve_reference(&ctx, &entry.reference);
+    ASSERT(target);
+    *target = { .value = 42, .y = 43 };
+
+    svf::runtime::write_finish(&ctx, &entry);
+    ASSERT(ctx.error_code == 0);
+    ASSERT(ctx.finished);
+
+    if (flushing) {
+      assert_same_bytes({ output_pointer, safe_int_cast<U32>(arena->waterline - waterline_before) }, message);
+    } else {
+      assert_same_bytes({ ctx.buffer.pointer, ctx.buffer_used }, message);
+      free(ctx.buffer.pointer);
+    }
+  }
+
+  // Fail, when not buffered.
+  {
+    auto ctx = svf::runtime::write_start<schema::Entry>(write_arena, arena);
+    svf::runtime::Sequence<schema::Target> sequence = {};
+    ASSERT(!svf::runtime::reserve_sequence(&ctx, 10, &sequence));
+    ASSERT(ctx.error_code == SVFRT_code_write__not_buffered);
+    ASSERT(sequence.count == UINT32_MAX);
+  }
+
+  // Fail, when the reservation does not fit into a buffer that can't grow.
+  {
+    alignas(8) U8 buffer[64];
+    auto ctx = svf::runtime::write_start_buffered<schema::Entry>(
+      { buffer, sizeof(buffer) },
+      NULL,
+      NULL,
+      write_arena,
+      arena
+    );
+    svf::runtime::Sequence<schema::Target> sequence = {};
+    ASSERT(!svf::runtime::reserve_sequence(&ctx, 5, &sequence));
+    ASSERT(ctx.error_code == SVFRT_code_write__buffer_full);
+  }
+
+  return 0;
+}
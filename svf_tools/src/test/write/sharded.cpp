@@ -0,0 +1,272 @@
+#include <cstdlib>
+#include <cstring>
+#include <src/library.hpp>
+#define SVF_INCLUDE_BINARY_SCHEMA
+#include <src/svf_runtime.hpp>
+#include <generated/hpp/JSON.hpp>
+#include <generated/hpp/C0.hpp>
+
+namespace schema = svf::JSON;
+
+U32 write_arena(void *it, SVFRT_Bytes src) {
+  auto arena = (vm::LinearArena *) it;
+  auto dst = vm::many<U8>(arena, src.count);
+  range_copy(dst, {src.pointer, src.count});
+  return safe_int_cast<U32>(src.count);
+};
+
+bool grow_realloc(void * /*grow_ptr*/, SVFRT_Bytes *inout_buffer, uint32_t min_count) {
+  auto pointer = (U8 *) realloc(inout_buffer->pointer, min_count);
+  if (!pointer) {
+    return false;
+  }
+  inout_buffer->pointer = pointer;
+  inout_buffer->count = min_count;
+  return true;
+}
+
+U32 const shard_count = 4;
+U32 const field_count = 10;
+
+// An array with a single object, which has `field_count` fields. Each field
+// has a two-letter name, and a number, unique for all shards.
+svf::runtime::Sequence<schema::Item> write_object(
+  svf::runtime::WriteContext<schema::Item> *ctx,
+  U32 shard_index
+) {
+  schema::Field fields[field_count];
+  for (U32 i = 0; i < field_count; i++) {
+    U8 name[2] = { U8('a' + shard_index), U8('a' + i) };
+    fields[i] = {};
+    fields[i].name = svf::runtime::write_fixed_size_array(ctx, name);
+    fields[i].value_tag = schema::Value_tag::number;
+    fields[i].value_payload.number = shard_index * field_count + i;
+  }
+
+  schema::Item item = {};
+  item.value_tag = schema::Value_tag::object;
+  item.value_payload.object = svf::runtime::write_fixed_size_array(ctx, fields);
+  return svf::runtime::write_sequence(ctx, &item, 1);
+}
+
+svf::runtime::Bytes finish_message(
+  svf::runtime::WriteContext<schema::Item> *ctx,
+  bool buffered,
+  U8 *arena_pointer,
+  U64 arena_waterline,
+  vm::LinearArena *arena
+) {
+  if (buffered) {
+    return { ctx->buffer.pointer, ctx->buffer_used };
+  }
+  return { arena_pointer, safe_int_cast<U32>(arena->waterline - arena_waterline) };
+}
+
+int main(int /*argc*/, char */*argv*/[]) {
+  auto arena_value = vm::create_linear_arena(1ull << 20);
+  auto arena = &arena_value;
+
+  U8 scratch_buffer[1024];
+  svf::runtime::Bytes scratch = { scratch_buffer, sizeof(scratch_buffer) };
+
+  // Success, both into a buffer, and through a writer function. Some data is
+  // written into the message before the shards, so they don't start at zero.
+  // The shards are written one after another here, but they don't share
+  // anything, so they could just as well be written on separate threads.
+  for (U32 buffered = 0; buffered < 2; buffered++) {
+    svf::runtime::WriteShard<schema::Item> shards[shard_count];
+    svf::runtime::Sequence<schema::Item> roots[shard_count];
+    for (U32 i = 0; i < shard_count; i++) {
+      shards[i] = svf::runtime::write_shard_start<schema::Item>(
+        { (U8 *) malloc(16), 16 },
+        grow_realloc
+      );
+      roots[i] = write_object(&shards[i].ctx, i);
+      ASSERT(shards[i].ctx.error_code == 0);
+    }
+
+    auto arena_pointer = (U8 *) vm::realign(arena);
+    auto arena_waterline = arena->waterline;
+    auto ctx = buffered
+      ? svf::runtime::write_start_buffered<schema::Item>({ (U8 *) malloc(16), 16 }, grow_realloc)
+      : svf::runtime::write_start<schema::Item>(write_arena, arena);
+
+    U8 prefix[3] = { 'x', 'y', 'z' };
+    auto prefix_string = svf::runtime::write_fixed_size_array(&ctx, prefix);
+
+    svf::runtime::write_shards(&ctx, { shards, shard_count });
+    ASSERT(ctx.error_code == 0);
+    for (U32 i = 0; i < shard_count; i++) {
+      ASSERT(shards[i].base % 8 == 0);
+      ASSERT(shards[i].base > 0);
+      free(shards[i].ctx.buffer.pointer);
+    }
+
+    // Two levels of arrays in the message itself, the inner ones pointing to
+    // the shards, and a string which is not in any shard.
+    schema::Item items[shard_count + 1];
+    for (U32 i = 0; i < shard_count; i++) {
+      items[i] = {};
+      items[i].value_tag = schema::Value_tag::array;
+      items[i].value_payload.array = svf::runtime::from_shard(&shards[i], roots[i]);
+    }
+    items[shard_count] = {};
+    items[shard_count].value_tag = schema::Value_tag::string;
+    items[shard_count].value_payload.string = prefix_string;
+
+    schema::Item entry = {};
+    entry.value_tag = schema::Value_tag::array;
+    entry.value_payload.array = svf::runtime::write_fixed_size_array(&ctx, items);
+    svf::runtime::write_finish(&ctx, &entry);
+    ASSERT(ctx.error_code == 0);
+
+    auto message = finish_message(&ctx, buffered, arena_pointer, arena_waterline, arena);
+    ASSERT(svf::runtime::relocate_shards<schema::Item>(message, { shards, shard_count }) == 0);
+
+    auto result = svf::runtime::read_message<schema::Item>(
+      message,
+      scratch,
+      svf::runtime::CompatibilityLevel::compatibility_exact
+    );
+    ASSERT(result.error_code == 0);
+    ASSERT(svf::runtime::verify_message(&result) == 0);
+    auto read_ctx = &result.context;
+
+    ASSERT(result.entry->value_tag == schema::Value_tag::array);
+    auto outer = result.entry->value_payload.array;
+    ASSERT(outer.count == shard_count + 1);
+    for (U32 i = 0; i < shard_count; i++) {
+      auto item = svf::runtime::read_sequence_element(read_ctx, outer, i);
+      ASSERT(item && item->value_tag == schema::Value_tag::array);
+      ASSERT(item->value_payload.array.count == 1);
+      auto object = svf::runtime::read_sequence_element(read_ctx, item->value_payload.array, 0);
+      ASSERT(object && object->value_tag == schema::Value_tag::object);
+
+      auto fields = object->value_payload.object;
+      ASSERT(fields.count == field_count);
+      for (U32 j = 0; j < field_count; j++) {
+        auto field = svf::runtime::read_sequence_element(read_ctx, fields, j);
+        ASSERT(field);
+        auto name = svf::runtime::read_sequence_raw(read_ctx, field->name);
+        ASSERT(name.pointer && name.count == 2);
+        ASSERT(name.pointer[0] == 'a' + i && name.pointer[1] == 'a' + j);
+        ASSERT(field->value_tag == schema::Value_tag::number);
+        ASSERT(field->value_payload.number == i * field_count + j);
+      }
+    }
+    auto last = svf::runtime::read_sequence_element(read_ctx, outer, shard_count);
+    ASSERT(last && last->value_tag == schema::Value_tag::string);
+    auto string = svf::runtime::read_sequence_raw(read_ctx, last->value_payload.string);
+    ASSERT(string.pointer && string.count == 3 && string.pointer[2] == 'z');
+
+    if (buffered) {
+      free(ctx.buffer.pointer);
+    }
+  }
+
+  // Success, with chunked sequences, which have their links fixed up as well.
+  {
+    svf::runtime::WriteShard<svf::C0::Entry> shards[2];
+    svf::C0::Entry entry = {};
+    for (U32 i = 0; i < 2; i++) {
+      shards[i] = svf::runtime::write_shard_start<svf::C0::Entry>({ (U8 *) malloc(16), 16 }, grow_realloc);
+    }
+
+    svf::runtime::ChunkedSequenceBuilder<svf::C0::Target> targets = {};
+    svf::runtime::ChunkedSequenceBuilder<U16> values = {};
+    for (U32 i = 0; i < 30; i++) {
+      svf::C0::Target target = { .value = i, .y = 3 * i };
+      svf::runtime::write_chunked_sequence_element(&shards[1].ctx, &targets, &target);
+
+      // Breaks the targets into chunks.
+      U16 value = U16(i);
+      if (i % 3 == 0) {
+        svf::runtime::write_chunked_sequence_element(&shards[1].ctx, &values, &value);
+      }
+    }
+    auto shard_targets = svf::runtime::write_chunked_sequence_finish(&shards[1].ctx, &targets);
+    auto shard_values = svf::runtime::write_chunked_sequence_finish(&shards[1].ctx, &values);
+    ASSERT(shards[1].ctx.error_code == 0);
+
+    auto ctx = svf::runtime::write_start_buffered<svf::C0::Entry>({ (U8 *) malloc(16), 16 }, grow_realloc);
+    svf::runtime::write_shards(&ctx, { shards, 2 });
+    for (U32 i = 0; i < 2; i++) {
+      free(shards[i].ctx.buffer.pointer);
+    }
+    entry.targets = svf::runtime::from_shard(&shards[1], shard_targets);
+    entry.values = svf::runtime::from_shard(&shards[1], shard_values);
+    svf::runtime::write_finish(&ctx, &entry);
+    ASSERT(ctx.error_code == 0);
+
+    svf::runtime::Bytes message = { ctx.buffer.pointer, ctx.buffer_used };
+    ASSERT(svf::runtime::relocate_shards<svf::C0::Entry>(message, { shards, 2 }) == 0);
+
+    auto result = svf::runtime::read_message<svf::C0::Entry>(
+      message,
+      scratch,
+      svf::runtime::CompatibilityLevel::compatibility_exact
+    );
+    ASSERT(result.error_code == 0);
+    ASSERT(svf::runtime::verify_message(&result) == 0);
+    auto read_ctx = &result.context;
+
+    svf::runtime::Sequence<svf::C0::Target> chunks[30];
+    U32 chunk_count = svf::runtime::read_chunk_count(read_ctx, result.entry->targets);
+    ASSERT(chunk_count > 1);
+    ASSERT(svf::runtime::read_chunks(read_ctx, result.entry->targets, { chunks, 30 }) == chunk_count);
+    U32 next = 0;
+    for (U32 i = 0; i < chunk_count; i++) {
+      for (U32 j = 0; j < chunks[i].count; j++) {
+        auto target = svf::runtime::read_sequence_element(read_ctx, chunks[i], j);
+        ASSERT(target && target->value == next && target->y == 3 * next);
+        next++;
+      }
+    }
+    ASSERT(next == 30);
+    ASSERT(result.entry->values.count == 10);
+    ASSERT(svf::runtime::read_chunk_count(read_ctx, result.entry->values) > 1);
+    free(ctx.buffer.pointer);
+  }
+
+  // Fail, when a handle in a shard points outside of it.
+  {
+    auto shard = svf::runtime::write_shard_start<schema::Item>({ (U8 *) malloc(16), 16 }, grow_realloc);
+    auto root = write_object(&shard.ctx, 0);
+
+    // Break the name of the last field, which is written last.
+    auto fields_end = shard.ctx.buffer.pointer + shard.ctx.buffer_used - sizeof(schema::Item);
+    schema::Item item;
+    memcpy(&item, fields_end, sizeof(item));
+    auto last_field = shard.ctx.buffer.pointer + ~item.value_payload.object.data_offset_complement;
+    last_field += (field_count - 1) * sizeof(schema::Field);
+    schema::Field field;
+    memcpy(&field, last_field, sizeof(field));
+    field.name.count = 1000;
+    memcpy(last_field, &field, sizeof(field));
+
+    auto ctx = svf::runtime::write_start_buffered<schema::Item>({ (U8 *) malloc(16), 16 }, grow_realloc);
+    svf::runtime::write_shards(&ctx, { &shard, 1 });
+    free(shard.ctx.buffer.pointer);
+    schema::Item entry = {};
+    entry.value_tag = schema::Value_tag::array;
+    entry.value_payload.array = svf::runtime::from_shard(&shard, root);
+    svf::runtime::write_finish(&ctx, &entry);
+    ASSERT(ctx.error_code == 0);
+
+    svf::runtime::Bytes message = { ctx.buffer.pointer, ctx.buffer_used };
+    ASSERT(svf::runtime::relocate_shards<schema::Item>(message, { &shard, 1 }) == SVFRT_code_write__bad_shard_handle);
+    free(ctx.buffer.pointer);
+  }
+
+  // Fail, when a shard failed.
+  {
+    auto shard = svf::runtime::write_shard_start<schema::Item>({ NULL, 0 });
+    ASSERT(shard.ctx.error_code == SVFRT_code_write__buffer_full);
+
+    auto ctx = svf::runtime::write_start<schema::Item>(write_arena, arena);
+    svf::runtime::write_shards(&ctx, { &shard, 1 });
+    ASSERT(ctx.error_code == SVFRT_code_write__buffer_full);
+  }
+
+  return 0;
+}